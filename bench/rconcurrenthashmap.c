@@ -0,0 +1,200 @@
+#include <rlib/rlib.h>
+#include "util.h"
+
+#define CHM_BENCH_KEYS      (64 * 1024)
+#define CHM_BENCH_OPS       (2 * 1000 * 1000)
+#define CHM_BENCH_KEY(i)    RSIZE_TO_POINTER (((rsize)(i) + 1) * (rsize)0x9e3779b1u)
+
+/* Baseline: the plain hash table behind one mutex. */
+typedef struct {
+  RMutex lock;
+  RHashTable * ht;
+} ChmBenchLocked;
+
+typedef struct {
+  const rchar * name;
+  rpointer (*create) (void);
+  void (*destroy) (rpointer map);
+  rboolean (*lookup) (rpointer map, rpointer key);
+  void (*insert) (rpointer map, rpointer key, rpointer val);
+  void (*remove) (rpointer map, rpointer key);
+} ChmBenchEngine;
+
+static rpointer
+chm_bench_chm_create (void)
+{
+  return r_concurrent_hash_map_new (NULL, NULL);
+}
+
+static rboolean
+chm_bench_chm_lookup (rpointer map, rpointer key)
+{
+  return r_concurrent_hash_map_contains (map, key);
+}
+
+static void
+chm_bench_chm_insert (rpointer map, rpointer key, rpointer val)
+{
+  r_concurrent_hash_map_insert (map, key, val);
+}
+
+static void
+chm_bench_chm_remove (rpointer map, rpointer key)
+{
+  r_concurrent_hash_map_remove (map, key);
+}
+
+static rpointer
+chm_bench_locked_create (void)
+{
+  ChmBenchLocked * ret = r_mem_new (ChmBenchLocked);
+  r_mutex_init (&ret->lock);
+  ret->ht = r_hash_table_new (NULL, NULL);
+  return ret;
+}
+
+static void
+chm_bench_locked_destroy (rpointer map)
+{
+  ChmBenchLocked * l = map;
+  r_hash_table_unref (l->ht);
+  r_mutex_clear (&l->lock);
+  r_free (l);
+}
+
+static rboolean
+chm_bench_locked_lookup (rpointer map, rpointer key)
+{
+  ChmBenchLocked * l = map;
+  rboolean ret;
+
+  r_mutex_lock (&l->lock);
+  ret = r_hash_table_contains (l->ht, key) == R_HASH_TABLE_OK;
+  r_mutex_unlock (&l->lock);
+  return ret;
+}
+
+static void
+chm_bench_locked_insert (rpointer map, rpointer key, rpointer val)
+{
+  ChmBenchLocked * l = map;
+
+  r_mutex_lock (&l->lock);
+  r_hash_table_insert (l->ht, key, val);
+  r_mutex_unlock (&l->lock);
+}
+
+static void
+chm_bench_locked_remove (rpointer map, rpointer key)
+{
+  ChmBenchLocked * l = map;
+
+  r_mutex_lock (&l->lock);
+  r_hash_table_remove (l->ht, key);
+  r_mutex_unlock (&l->lock);
+}
+
+static const ChmBenchEngine chm_bench_engines[] = {
+  { "concurrent", chm_bench_chm_create, r_concurrent_hash_map_unref,
+    chm_bench_chm_lookup, chm_bench_chm_insert, chm_bench_chm_remove },
+  { "mutex+ht  ", chm_bench_locked_create, chm_bench_locked_destroy,
+    chm_bench_locked_lookup, chm_bench_locked_insert, chm_bench_locked_remove },
+};
+
+typedef struct {
+  const ChmBenchEngine * eng;
+  rpointer map;
+  rauint * go;
+  ruint ops;
+  ruint read_pct;
+  ruint seed;
+  rsize hits;
+} ChmBenchThread;
+
+static rpointer
+chm_bench_thread (rpointer data)
+{
+  ChmBenchThread * t = data;
+  ruint x = t->seed, n;
+
+  while (r_atomic_uint_load (t->go) == 0);
+
+  for (n = 0; n < t->ops; n++) {
+    rsize k;
+
+    x = x * 1103515245u + 12345u;
+    k = (x >> 8) % CHM_BENCH_KEYS;
+    if ((x >> 24) % 100 < t->read_pct) {
+      t->hits += t->eng->lookup (t->map, CHM_BENCH_KEY (k));
+    } else if (x & 0x10) {
+      t->eng->insert (t->map, CHM_BENCH_KEY (k), RSIZE_TO_POINTER (k));
+    } else {
+      t->eng->remove (t->map, CHM_BENCH_KEY (k));
+    }
+  }
+
+  return NULL;
+}
+
+static void
+chm_bench_run (ruint read_pct)
+{
+  static const ruint threads[] = { 1, 2, 4, 8, 16, 32, 64 };
+  ChmBenchThread t[64];
+  RThread * th[64];
+  rsize e, s, i;
+
+  for (e = 0; e < R_N_ELEMENTS (chm_bench_engines); e++) {
+    const ChmBenchEngine * eng = &chm_bench_engines[e];
+
+    for (s = 0; s < R_N_ELEMENTS (threads); s++) {
+      rpointer map = eng->create ();
+      rauint go;
+      RClockTime start;
+      rchar * label;
+
+      for (i = 0; i < CHM_BENCH_KEYS; i += 2)
+        eng->insert (map, CHM_BENCH_KEY (i), RSIZE_TO_POINTER (i));
+
+      r_atomic_uint_store (&go, 0);
+      for (i = 0; i < threads[s]; i++) {
+        t[i].eng = eng;
+        t[i].map = map;
+        t[i].go = &go;
+        t[i].ops = CHM_BENCH_OPS / threads[s];
+        t[i].read_pct = read_pct;
+        t[i].seed = (ruint)i * 7919u + 1;
+        t[i].hits = 0;
+        th[i] = r_thread_new (NULL, chm_bench_thread, &t[i]);
+      }
+
+      start = r_time_get_ts_monotonic ();
+      r_atomic_uint_store (&go, 1);
+      for (i = 0; i < threads[s]; i++) {
+        r_thread_join (th[i]);
+        r_thread_unref (th[i]);
+      }
+
+      label = r_strprintf ("%s %u/%u threads=%-2u", eng->name,
+          read_pct, 100 - read_pct, threads[s]);
+      bench_print_ops (label, (CHM_BENCH_OPS / threads[s]) * threads[s],
+          r_time_get_ts_monotonic () - start);
+      r_free (label);
+      eng->destroy (map);
+    }
+  }
+}
+
+RTEST_BENCH (rconcurrenthashmap, scaling_90_10, RTEST_FAST)
+{
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+  chm_bench_run (90);
+}
+RTEST_END;
+
+RTEST_BENCH (rconcurrenthashmap, scaling_50_50, RTEST_FAST)
+{
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+  chm_bench_run (50);
+}
+RTEST_END;
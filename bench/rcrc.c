@@ -3,9 +3,14 @@
 #include "util.h"
 
 /* 16 KiB per call - matches the digest / cipher benches for
- * directly-comparable MiB/s numbers. */
+ * directly-comparable MiB/s numbers. The small sizes are a STUN
+ * message and an MTU-sized datagram, where the folding kernels'
+ * setup and the slicing tail dominate. */
 #define CRC_BENCH_BLOCKSIZE  (16 * 1024)
-#define CRC_BENCH_ITERS      2000
+#define CRC_BENCH_BYTES      (32 * 1024 * 1024)
+#define CRC_BENCH_COMBINE_ITERS 100000
+
+static const rsize crc_bench_sizes[] = { 64, 1500, CRC_BENCH_BLOCKSIZE };
 
 /* CRC update function family - all three variants share the same
  * "running crc, buffer, size -> updated crc" shape, so the bench
@@ -13,27 +18,28 @@
 typedef ruint32 (*RCrcUpdateFn) (ruint32 crc, rconstpointer buffer, rsize size);
 
 static void
-run_crc_bench (RCrcUpdateFn fn, const rchar * label)
+run_crc_bench_size (RCrcUpdateFn fn, const rchar * name, rsize size)
 {
   ruint8 * input;
   ruint32 crc = R_CRC32_INIT;
   RClockTime start, end;
-  ruint i;
+  rchar label[64];
+  ruint i, iters = (ruint)(CRC_BENCH_BYTES / size);
 
-  r_assert_cmpptr ((input = r_malloc (CRC_BENCH_BLOCKSIZE)), !=, NULL);
-  for (i = 0; i < CRC_BENCH_BLOCKSIZE; i++)
+  r_assert_cmpptr ((input = r_malloc (size)), !=, NULL);
+  for (i = 0; i < size; i++)
     input[i] = (ruint8)i;
 
   for (i = 0; i < 5; i++)
-    crc = fn (R_CRC32_INIT, input, CRC_BENCH_BLOCKSIZE);
+    crc = fn (R_CRC32_INIT, input, size);
 
   start = r_time_get_ts_monotonic ();
-  for (i = 0; i < CRC_BENCH_ITERS; i++)
-    crc = fn (R_CRC32_INIT, input, CRC_BENCH_BLOCKSIZE);
+  for (i = 0; i < iters; i++)
+    crc = fn (R_CRC32_INIT, input, size);
   end = r_time_get_ts_monotonic ();
 
-  bench_print_throughput (label, CRC_BENCH_ITERS, CRC_BENCH_BLOCKSIZE,
-      end - start);
+  r_snprintf (label, sizeof (label), "%s %"RSIZE_FMT" bytes", name, size);
+  bench_print_throughput (label, iters, size, end - start);
 
   /* Silence -Wunused-but-set-variable; the indirect call through fn
    * is opaque to the compiler so the loop body can't be elided. */
@@ -41,12 +47,21 @@ run_crc_bench (RCrcUpdateFn fn, const rchar * label)
   r_free (input);
 }
 
+static void
+run_crc_bench (RCrcUpdateFn fn, const rchar * name)
+{
+  rsize i;
+
+  for (i = 0; i < R_N_ELEMENTS (crc_bench_sizes); i++)
+    run_crc_bench_size (fn, name, crc_bench_sizes[i]);
+}
+
 RTEST_BENCH (rcrc, crc32, RTEST_FAST)
 {
   /* IEEE 802.3 / zlib / PNG CRC32 (reflected, polynomial
-   * 0x04C11DB7). Table-driven implementation; the throughput
-   * floor here is essentially the L1 read bandwidth into the
-   * lookup table. */
+   * 0x04C11DB7). PCLMULQDQ / PMULL folding from 64 bytes up,
+   * slicing-by-16 for the tail and on CPUs without carry-less
+   * multiply. */
   r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
   run_crc_bench (r_crc32_update, "CRC32");
 }
@@ -55,12 +70,8 @@ RTEST_END;
 RTEST_BENCH (rcrc, crc32c, RTEST_FAST)
 {
   /* Castagnoli CRC32 (reflected, polynomial 0x1EDC6F41). Used by
-   * SCTP, iSCSI, Btrfs, etc. Same table-driven implementation as
-   * the IEEE variant, so the throughput numbers should be near
-   * identical. x86-64 SSE4.2 ships a single-cycle CRC32C
-   * instruction that's ~10x faster than the software table, but
-   * rlib does not currently wire it in - this number reflects the
-   * software path. */
+   * SCTP, iSCSI, Btrfs, etc. Runs on the SSE4.2 / ARMv8 CRC32C
+   * instructions where present, byte-table otherwise. */
   r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
   run_crc_bench (r_crc32c_update, "CRC32C");
 }
@@ -69,9 +80,27 @@ RTEST_END;
 RTEST_BENCH (rcrc, crc32bzip2, RTEST_FAST)
 {
   /* CRC32 bzip2 - same polynomial as IEEE CRC32 but non-reflected.
-   * Used by the bzip2 compressor. Same table-driven cost shape
-   * as the IEEE variant. */
+   * Used by the bzip2 compressor. Same folding / slicing kernels as
+   * the IEEE variant on byte-reversed lanes. */
   r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
   run_crc_bench (r_crc32bzip2_update, "CRC32-bzip2");
 }
 RTEST_END;
+
+RTEST_BENCH (rcrc, crc32_combine, RTEST_FAST)
+{
+  /* Merging per-chunk CRCs is O(log len2) GF(2) multiplies; this is
+   * the fixed cost per chunk of a parallel checksum. */
+  ruint32 crc = 0;
+  RClockTime start;
+  ruint i;
+
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+  start = r_time_get_ts_monotonic ();
+  for (i = 0; i < CRC_BENCH_COMBINE_ITERS; i++)
+    crc = r_crc32_combine (crc, i, 1024 * 1024 + i);
+  bench_print_ops ("CRC32 combine 1 MiB chunk", CRC_BENCH_COMBINE_ITERS,
+      r_time_get_ts_monotonic () - start);
+  r_assert_cmphex (crc, !=, 0);
+}
+RTEST_END;
@@ -70,7 +70,9 @@ run_dh_bench (RDhNamedGroup group, const rchar * group_name, ruint iters)
 
 /* keygen bench: times a full private-key generation (one g^x mod p with
  * the group's private exponent). This is where the short-exponent sizing
- * for the named safe-prime groups shows up most directly. */
+ * for the named safe-prime groups shows up most directly. The warm-up
+ * calls also build the group's cached generator comb, so the timed loop
+ * sees the steady state. */
 static void
 run_dh_keygen_bench (RDhNamedGroup group, const rchar * group_name, ruint iters)
 {
@@ -117,6 +119,30 @@ RTEST_BENCH (rdh, compute_shared_ffdhe_2048, RTEST_SLOW)
 }
 RTEST_END;
 
+RTEST_BENCH (rdh, compute_shared_ffdhe_3072, RTEST_SLOW)
+{
+  /* FFDHE-3072..6144 fill in the sizes between the two ends above, so
+   * the Karatsuba / IFMA crossovers show up as a curve rather than two
+   * points. */
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+  run_dh_bench (R_DH_GROUP_FFDHE_3072, "FFDHE-3072", 100);
+}
+RTEST_END;
+
+RTEST_BENCH (rdh, compute_shared_ffdhe_4096, RTEST_SLOW)
+{
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+  run_dh_bench (R_DH_GROUP_FFDHE_4096, "FFDHE-4096", 50);
+}
+RTEST_END;
+
+RTEST_BENCH (rdh, compute_shared_ffdhe_6144, RTEST_SLOW)
+{
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+  run_dh_bench (R_DH_GROUP_FFDHE_6144, "FFDHE-6144", 30);
+}
+RTEST_END;
+
 RTEST_BENCH (rdh, compute_shared_ffdhe_8192, RTEST_SLOW)
 {
   /* FFDHE-8192 (RFC 7919) - the largest finite-field group. Its
@@ -134,6 +160,27 @@ RTEST_BENCH (rdh, keygen_ffdhe_2048, RTEST_SLOW)
 }
 RTEST_END;
 
+RTEST_BENCH (rdh, keygen_ffdhe_3072, RTEST_SLOW)
+{
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+  run_dh_keygen_bench (R_DH_GROUP_FFDHE_3072, "FFDHE-3072", 100);
+}
+RTEST_END;
+
+RTEST_BENCH (rdh, keygen_ffdhe_4096, RTEST_SLOW)
+{
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+  run_dh_keygen_bench (R_DH_GROUP_FFDHE_4096, "FFDHE-4096", 50);
+}
+RTEST_END;
+
+RTEST_BENCH (rdh, keygen_ffdhe_6144, RTEST_SLOW)
+{
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+  run_dh_keygen_bench (R_DH_GROUP_FFDHE_6144, "FFDHE-6144", 30);
+}
+RTEST_END;
+
 RTEST_BENCH (rdh, keygen_ffdhe_8192, RTEST_SLOW)
 {
   r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
@@ -77,8 +77,8 @@ run_ecdh_bench (REcurveID curve_id, const rchar * curve_name)
 RTEST_BENCH (recdh, compute_shared_secp256r1, RTEST_FASTSLOW)
 {
   /* ECDH on secp256r1 - the most-used curve in the wild. Exercises
-   * the CT scalar-mul ladder (r_ecurve_point_scalar_mul) end-to-end
-   * with the secret peer-derivation. */
+   * the variable-base CT scalar mul (r_ecurve_point_scalar_mul)
+   * end-to-end with the secret peer-derivation. */
   r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
   run_ecdh_bench (R_ECURVE_ID_SECP256R1, "secp256r1");
 }
@@ -93,3 +93,49 @@ RTEST_BENCH (recdh, compute_shared_secp384r1, RTEST_FASTSLOW)
   run_ecdh_bench (R_ECURVE_ID_SECP384R1, "secp384r1");
 }
 RTEST_END;
+
+/* Ephemeral key generation, the other half of an ECDHE handshake:
+ * a random scalar times the generator, so this runs the fixed-base
+ * comb rather than the variable-base path compute_shared takes. */
+static void
+run_ecdh_keygen_bench (REcurveID curve_id, const rchar * curve_name)
+{
+  RCryptoKey * priv;
+  RPrng * prng;
+  RClockTime start, end;
+  rchar * label;
+  ruint i;
+
+  r_assert_cmpptr ((prng = r_rand_prng_new ()), !=, NULL);
+
+  for (i = 0; i < 5; i++) {
+    r_assert_cmpptr ((priv = r_ecdh_priv_key_new_gen (curve_id, prng)), !=, NULL);
+    r_crypto_key_unref (priv);
+  }
+
+  start = r_time_get_ts_monotonic ();
+  for (i = 0; i < ECDH_BENCH_ITERS; i++) {
+    r_assert_cmpptr ((priv = r_ecdh_priv_key_new_gen (curve_id, prng)), !=, NULL);
+    r_crypto_key_unref (priv);
+  }
+  end = r_time_get_ts_monotonic ();
+
+  label = r_strprintf ("ECDH %s keygen", curve_name);
+  bench_print_ops (label, ECDH_BENCH_ITERS, end - start);
+  r_free (label);
+  r_prng_unref (prng);
+}
+
+RTEST_BENCH (recdh, keygen_secp256r1, RTEST_FASTSLOW)
+{
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+  run_ecdh_keygen_bench (R_ECURVE_ID_SECP256R1, "secp256r1");
+}
+RTEST_END;
+
+RTEST_BENCH (recdh, keygen_secp384r1, RTEST_FASTSLOW)
+{
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+  run_ecdh_keygen_bench (R_ECURVE_ID_SECP384R1, "secp384r1");
+}
+RTEST_END;
@@ -79,7 +79,8 @@ fail_after_priv:
 RTEST_BENCH (recdsa, sign_secp256r1, RTEST_FASTSLOW)
 {
   /* ECDSA sign on secp256r1. Exercises r_ecdsa_sign end-to-end -
-   * nonce sampling, CT k*G via r_ecurve_point_scalar_mul, the
+   * nonce sampling, CT k*G via the generator comb in
+   * r_ecurve_point_scalar_mul, the
    * Fermat-inverter on k, and the s = k^-1 * (e + d*r) FE arithmetic. */
   RCryptoKey * priv, * pub;
   RPrng * prng;
@@ -0,0 +1,65 @@
+#include <rlib/rlib.h>
+#include "util.h"
+
+static volatile rsize hash_bench_sink;
+
+/* The byte-at-a-time DJB2 r_str_hash used before, as the baseline. */
+static rsize
+hash_bench_djb2 (const rchar * data, rssize size)
+{
+  const signed char * p = (const signed char *)data;
+  rsize ret = 5381;
+
+  while (size-- > 0)
+    ret = (ret << 5) + ret + *p++;
+  return ret;
+}
+
+typedef struct {
+  rsize (*hash) (const rchar *, rssize);
+  const rchar * buf;
+  rssize size;
+} HashBenchCtx;
+
+static void
+hash_bench_func (rpointer data, ruint64 iters)
+{
+  HashBenchCtx * ctx = data;
+  rsize acc = 0;
+  ruint64 n;
+
+  for (n = 0; n < iters; n++)
+    acc += ctx->hash (ctx->buf + (n & 7), ctx->size);
+  hash_bench_sink = acc;
+}
+
+static void
+run_hash_bench (rsize (*hash) (const rchar *, rssize), const rchar * name)
+{
+  static const rsize sizes[] = { 8, 16, 32, 64, 256, 1024, 16 * 1024 };
+  rchar * buf = r_malloc (16 * 1024);
+  rsize s, i;
+
+  for (i = 0; i < 16 * 1024; i++)
+    buf[i] = (rchar)('!' + i % 90);
+
+  for (s = 0; s < R_N_ELEMENTS (sizes); s++) {
+    HashBenchCtx ctx = { hash, buf, (rssize)sizes[s] };
+    rchar * label;
+
+    label = r_strprintf ("%s (%"RSIZE_FMT" B keys)", name, sizes[s]);
+    r_test_bench_run (label, hash_bench_func, &ctx, sizes[s], NULL);
+    r_free (label);
+  }
+
+  r_free (buf);
+}
+
+RTEST_BENCH (rhashfuncs, str_hash, RTEST_FAST)
+{
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+  run_hash_bench (hash_bench_djb2, "DJB2");
+  run_hash_bench (r_str_hash_sized, "r_str_hash");
+  run_hash_bench (r_str_hash_keyed_sized, "r_str_hash_keyed");
+}
+RTEST_END;
@@ -0,0 +1,134 @@
+#include <rlib/rlib.h>
+#include "util.h"
+
+/* Keys are a bijective scramble of 1..n (odd multiplier), so they are distinct
+ * and non-zero but carry no sequential pattern for the hash to exploit.
+ * Misses use the same scramble over n+1..2n. */
+#define HT_BENCH_KEY(i)   RSIZE_TO_POINTER (((rsize)(i) + 1) * (rsize)0x9e3779b1u)
+
+typedef struct {
+  const rchar * name;
+  RHashFlags flags;
+} HtBenchEngine;
+
+static const HtBenchEngine ht_bench_engines[] = {
+  { "probing", R_HASH_FLAG_NONE },
+  { "grouped", R_HASH_FLAG_GROUPED },
+};
+
+static void
+ht_bench_report (const rchar * engine, const rchar * op, rsize n,
+    ruint iters, RClockTime elapsed)
+{
+  rchar * label = r_strprintf ("%s %-10s n=%-9"RSIZE_FMT, engine, op, n);
+  bench_print_ops (label, iters, elapsed);
+  r_free (label);
+}
+
+static void
+ht_bench_run (rsize n)
+{
+  RClockTime start;
+  rsize e, i;
+
+  r_print ("%"R_TIME_FORMAT" --- %"RSIZE_FMT" entries ---\n", R_TIME_ARGS (0), n);
+
+  for (e = 0; e < R_N_ELEMENTS (ht_bench_engines); e++) {
+    const HtBenchEngine * eng = &ht_bench_engines[e];
+    RHashTable * ht;
+    rsize hits = 0;
+
+    r_assert_cmpptr ((ht = r_hash_table_new_with_flags (NULL, NULL, NULL, NULL,
+            eng->flags)), !=, NULL);
+
+    start = r_time_get_ts_monotonic ();
+    for (i = 0; i < n; i++)
+      r_hash_table_insert (ht, HT_BENCH_KEY (i), RSIZE_TO_POINTER (i));
+    ht_bench_report (eng->name, "insert", n, (ruint)n,
+        r_time_get_ts_monotonic () - start);
+
+    start = r_time_get_ts_monotonic ();
+    for (i = 0; i < n; i++)
+      hits += r_hash_table_contains (ht, HT_BENCH_KEY (i)) == R_HASH_TABLE_OK;
+    ht_bench_report (eng->name, "lookup-hit", n, (ruint)n,
+        r_time_get_ts_monotonic () - start);
+    r_assert_cmpuint (hits, ==, n);
+
+    start = r_time_get_ts_monotonic ();
+    for (i = 0; i < n; i++)
+      hits += r_hash_table_contains (ht, HT_BENCH_KEY (n + i)) == R_HASH_TABLE_OK;
+    ht_bench_report (eng->name, "lookup-miss", n, (ruint)n,
+        r_time_get_ts_monotonic () - start);
+    r_assert_cmpuint (hits, ==, n);
+
+    /* Steady-state churn: every round erases the oldest key and inserts a new
+     * one, so the table never grows and lives off reclaimed slots. */
+    start = r_time_get_ts_monotonic ();
+    for (i = 0; i < n; i++) {
+      r_hash_table_remove (ht, HT_BENCH_KEY (i));
+      r_hash_table_insert (ht, HT_BENCH_KEY (n + i), RSIZE_TO_POINTER (i));
+    }
+    ht_bench_report (eng->name, "erase+ins", n, (ruint)n,
+        r_time_get_ts_monotonic () - start);
+    r_assert_cmpuint (r_hash_table_size (ht), ==, n);
+
+    r_hash_table_unref (ht);
+  }
+}
+
+RTEST_BENCH (rhashtable, workloads_1k, RTEST_FAST)
+{
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+  ht_bench_run (1000);
+}
+RTEST_END;
+
+RTEST_BENCH (rhashtable, workloads_100k, RTEST_FAST)
+{
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+  ht_bench_run (100 * 1000);
+}
+RTEST_END;
+
+RTEST_BENCH (rhashtable, workloads_1m, RTEST_FAST)
+{
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+  ht_bench_run (1000 * 1000);
+}
+RTEST_END;
+
+RTEST_BENCH (rhashtable, workloads_10m, RTEST_SLOW)
+{
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+  ht_bench_run (10 * 1000 * 1000);
+}
+RTEST_END;
+
+RTEST_BENCH (rhashset, lookup_1m, RTEST_FAST)
+{
+  const rsize n = 1000 * 1000;
+  RClockTime start;
+  rsize e, i;
+
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+  for (e = 0; e < R_N_ELEMENTS (ht_bench_engines); e++) {
+    const HtBenchEngine * eng = &ht_bench_engines[e];
+    RHashSet * hs;
+    rsize hits = 0;
+
+    r_assert_cmpptr ((hs = r_hash_set_new_with_flags (NULL, NULL, NULL,
+            eng->flags)), !=, NULL);
+    for (i = 0; i < n; i++)
+      r_hash_set_insert (hs, HT_BENCH_KEY (i));
+
+    start = r_time_get_ts_monotonic ();
+    for (i = 0; i < 2 * n; i++)
+      hits += r_hash_set_contains (hs, HT_BENCH_KEY (i));
+    ht_bench_report (eng->name, "set-lookup", n, (ruint)(2 * n),
+        r_time_get_ts_monotonic () - start);
+    r_assert_cmpuint (hits, ==, n);
+
+    r_hash_set_unref (hs);
+  }
+}
+RTEST_END;
@@ -0,0 +1,422 @@
+#include <rlib/rlib.h>
+#include "util.h"
+
+#define JSON_BENCH_RECORDS    20000
+#define JSON_BENCH_ITERS      20
+#define JSON_BENCH_CORPUS_MIN (64 * 1024 * 1024)
+
+/* Allocation accounting for one parse: every block carries its size in
+ * a header so peak live bytes can be tracked. Only installed around
+ * code that frees everything it allocated. */
+typedef struct {
+  RMemVTable libc;
+  rsize live, peak;
+  ruint allocs;
+} JsonBenchMem;
+
+static JsonBenchMem json_bench_mem;
+#define JSON_BENCH_HDR    16
+
+static rpointer
+json_bench_account (ruint8 * p, rsize size)
+{
+  if (p == NULL)
+    return NULL;
+  *(rsize *)p = size;
+  json_bench_mem.live += size;
+  json_bench_mem.peak = MAX (json_bench_mem.peak, json_bench_mem.live);
+  json_bench_mem.allocs++;
+  return p + JSON_BENCH_HDR;
+}
+
+static rpointer
+json_bench_malloc (rsize size)
+{
+  return json_bench_account (json_bench_mem.libc.malloc (size + JSON_BENCH_HDR), size);
+}
+
+static rpointer
+json_bench_calloc (rsize count, rsize size)
+{
+  return json_bench_account (json_bench_mem.libc.calloc (1, count * size + JSON_BENCH_HDR),
+      count * size);
+}
+
+static rpointer
+json_bench_realloc (rpointer ptr, rsize size)
+{
+  ruint8 * p = ptr;
+  if (p != NULL) {
+    p -= JSON_BENCH_HDR;
+    json_bench_mem.live -= *(rsize *)p;
+  }
+  return json_bench_account (json_bench_mem.libc.realloc (p, size + JSON_BENCH_HDR), size);
+}
+
+static void
+json_bench_free (rpointer ptr)
+{
+  ruint8 * p = ptr;
+  if (p != NULL) {
+    p -= JSON_BENCH_HDR;
+    json_bench_mem.live -= *(rsize *)p;
+    json_bench_mem.libc.free (p);
+  }
+}
+
+static void
+json_bench_mem_begin (void)
+{
+  RMemVTable vtable = { json_bench_malloc, json_bench_calloc, json_bench_realloc, json_bench_free };
+  r_mem_get_vtable (&json_bench_mem.libc);
+  json_bench_mem.live = json_bench_mem.peak = 0;
+  json_bench_mem.allocs = 0;
+  r_mem_set_vtable (&vtable);
+}
+
+static void
+json_bench_mem_end (void)
+{
+  r_mem_set_vtable (&json_bench_mem.libc);
+}
+
+/* A few MB of typical API payload: an array of flat-ish records. */
+static rchar *
+json_bench_document (rsize * len)
+{
+  RString * str = r_string_new_sized (JSON_BENCH_RECORDS * 200);
+  ruint i;
+
+  r_string_append (str, "[");
+  for (i = 0; i < JSON_BENCH_RECORDS; i++) {
+    r_string_append_printf (str, "%s{\"id\":%u,\"name\":\"user-%u\",\"score\":%u.%02u,"
+        "\"active\":%s,\"tags\":[\"a\",\"b\\n\",\"c\"],\"geo\":{\"lat\":-%u.5,\"lon\":%u},"
+        "\"note\":null}", i > 0 ? "," : "", i, i, i % 1000, i % 100,
+        (i & 1) ? "true" : "false", i % 90, i % 180);
+  }
+  r_string_append (str, "]");
+
+  *len = r_string_length (str);
+  return r_string_free_keep (str);
+}
+
+RTEST_BENCH (rjson, parse_tree_vs_tape, RTEST_FAST)
+{
+  RJsonValue * tree;
+  RJsonTape * tape;
+  RJsonResult res;
+  RClockTime start, elapsed;
+  rchar label[96];
+  rchar * doc;
+  rsize len;
+  ruint i;
+
+  doc = json_bench_document (&len);
+
+  json_bench_mem_begin ();
+  tree = r_json_parse (doc, len, &res);
+  r_json_value_unref (tree);
+  json_bench_mem_end ();
+  r_assert_cmpint (res, ==, R_JSON_OK);
+  r_print ("JSON tree (%"RSIZE_FMT" bytes): %u allocations, %"RSIZE_FMT" bytes peak\n",
+      len, json_bench_mem.allocs, json_bench_mem.peak);
+
+  json_bench_mem_begin ();
+  tape = r_json_tape_parse (doc, len, &res);
+  r_json_tape_unref (tape);
+  json_bench_mem_end ();
+  r_assert_cmpint (res, ==, R_JSON_OK);
+  r_print ("JSON tape (%"RSIZE_FMT" bytes): %u allocations, %"RSIZE_FMT" bytes peak\n",
+      len, json_bench_mem.allocs, json_bench_mem.peak);
+
+  start = r_time_get_ts_monotonic ();
+  for (i = 0; i < JSON_BENCH_ITERS; i++) {
+    tree = r_json_parse (doc, len, NULL);
+    r_json_value_unref (tree);
+  }
+  elapsed = r_time_get_ts_monotonic () - start;
+  r_snprintf (label, sizeof (label), "JSON parse tree");
+  bench_print_throughput (label, JSON_BENCH_ITERS, len, elapsed);
+
+  start = r_time_get_ts_monotonic ();
+  for (i = 0; i < JSON_BENCH_ITERS; i++) {
+    tape = r_json_tape_parse (doc, len, NULL);
+    r_json_tape_unref (tape);
+  }
+  elapsed = r_time_get_ts_monotonic () - start;
+  r_snprintf (label, sizeof (label), "JSON parse tape");
+  bench_print_throughput (label, JSON_BENCH_ITERS, len, elapsed);
+
+  r_free (doc);
+}
+RTEST_END;
+
+/* Shaped after twitter.json: string heavy, escapes and UTF-8, nesting. */
+static rchar *
+json_bench_twitter_like (rsize * len)
+{
+  RString * str = r_string_new_sized (4 * 1024 * 1024);
+  ruint i;
+
+  r_string_append (str, "{\"statuses\":[");
+  for (i = 0; i < 2000; i++) {
+    r_string_append_printf (str, "%s{\"created_at\":\"Sun Aug 31 00:29:15 +0000 2014\","
+        "\"id\":%u50598592,\"id_str\":\"%u50598592\","
+        "\"text\":\"@aym0566x \\n\\n\u540d\u524d:\u524d\u7530\u3042\u3086\u307f\\n"
+        "\u7b2c\u4e00\u5370\u8c61:\\\"\u306a\u3093\u304b\\\" http:\\/\\/t.co\\/%u\","
+        "\"source\":\"<a href=\\\"http:\\/\\/twitter.com\\/download\\/iphone\\\" "
+        "rel=\\\"nofollow\\\">Twitter for iPhone<\\/a>\",\"truncated\":false,"
+        "\"in_reply_to_status_id\":null,\"user\":{\"id\":%u,\"name\":\"\u3086\u3046\u304b\","
+        "\"screen_name\":\"yuttari1998\",\"location\":\"\",\"followers_count\":%u,"
+        "\"friends_count\":%u,\"verified\":false,\"entities\":{\"description\":{\"urls\":[]}}},"
+        "\"retweet_count\":0,\"favorited\":false,\"lang\":\"ja\","
+        "\"entities\":{\"hashtags\":[],\"user_mentions\":[{\"screen_name\":\"aym0566x\","
+        "\"id\":866260188,\"indices\":[0,9]}]}}",
+        i > 0 ? "," : "", 5057 + i, 5057 + i, i, 1186275104 + i, i * 7 % 1000, i * 3 % 500);
+  }
+  r_string_append (str, "]}");
+
+  *len = r_string_length (str);
+  return r_string_free_keep (str);
+}
+
+/* Shaped after citm_catalog.json: number and null heavy, short keys. */
+static rchar *
+json_bench_citm_like (rsize * len)
+{
+  RString * str = r_string_new_sized (4 * 1024 * 1024);
+  ruint i, j;
+
+  r_string_append (str, "{\"performances\":[");
+  for (i = 0; i < 10000; i++) {
+    r_string_append_printf (str, "%s{\"eventId\":%u,\"id\":%u,\"logo\":null,\"name\":null,"
+        "\"prices\":[", i > 0 ? "," : "", 138586341 + i, 339887544 + i);
+    for (j = 0; j < 6; j++) {
+      r_string_append_printf (str, "%s{\"amount\":%u,\"audienceSubCategoryId\":337100890,"
+          "\"seatCategoryId\":%u}", j > 0 ? "," : "", 90250 + j * 1000, 338937295 + j);
+    }
+    r_string_append_printf (str, "],\"seatCategories\":[{\"areas\":[{\"areaId\":205705999,"
+        "\"blockIds\":[]},{\"areaId\":205705998,\"blockIds\":[]}],\"seatCategoryId\":338937295}],"
+        "\"seatMapImage\":null,\"start\":%u000,\"venueCode\":\"PLEYEL_PLEYEL\"}",
+        1372701600 + i * 60);
+  }
+  r_string_append (str, "]}");
+
+  *len = r_string_length (str);
+  return r_string_free_keep (str);
+}
+
+static void
+json_bench_tape_throughput (const rchar * name, const rchar * doc, rsize len)
+{
+  RJsonTape * tape;
+  RClockTime start;
+  rchar label[96];
+  ruint i, iters = (ruint) MAX (JSON_BENCH_CORPUS_MIN / len, 1);
+
+  r_assert_cmpptr ((tape = r_json_tape_parse (doc, len, NULL)), !=, NULL);
+  r_json_tape_unref (tape);
+
+  start = r_time_get_ts_monotonic ();
+  for (i = 0; i < iters; i++) {
+    tape = r_json_tape_parse (doc, len, NULL);
+    r_json_tape_unref (tape);
+  }
+  r_snprintf (label, sizeof (label), "JSON tape parse %s", name);
+  bench_print_throughput (label, iters, len, r_time_get_ts_monotonic () - start);
+}
+
+/* Synthetic stand-ins for the usual corpora. Point RLIB_JSON_CORPUS at
+ * a directory holding the real twitter.json / citm_catalog.json to
+ * measure those as well. */
+RTEST_BENCH (rjson, tape_corpora, RTEST_FAST)
+{
+  static const rchar * corpora[] = { "twitter.json", "citm_catalog.json" };
+  const rchar * dir;
+  rchar * doc;
+  rsize len;
+  ruint i;
+
+  doc = json_bench_twitter_like (&len);
+  json_bench_tape_throughput ("twitter-like", doc, len);
+  r_free (doc);
+  doc = json_bench_citm_like (&len);
+  json_bench_tape_throughput ("citm-like", doc, len);
+  r_free (doc);
+
+  dir = r_getenv ("RLIB_JSON_CORPUS");
+  for (i = 0; dir != NULL && i < R_N_ELEMENTS (corpora); i++) {
+    rchar * path = r_fs_path_build (dir, corpora[i], NULL);
+    ruint8 * data;
+
+    if (r_file_read_all (path, &data, &len)) {
+      json_bench_tape_throughput (corpora[i], (const rchar *) data, len);
+      r_free (data);
+    }
+    r_free (path);
+  }
+}
+RTEST_END;
+
+RTEST_BENCH (rjson, object_field_lookup, RTEST_FAST)
+{
+  static const ruint sizes[] = { 8, 64, 1024 };
+  ruint s, i, n;
+
+  for (s = 0; s < R_N_ELEMENTS (sizes); s++) {
+    RJsonValue * obj = r_json_object_new (), * k, * v;
+    rchar ** names = r_mem_new_n (rchar *, sizes[s]);
+    const ruint lookups = 2000000;
+    RClockTime start, elapsed;
+
+    for (i = 0; i < sizes[s]; i++) {
+      names[i] = r_strprintf ("feature.flag.%u", i);
+      k = r_json_string_new_unescaped (names[i], -1);
+      v = r_json_number_new_double (i);
+      r_json_object_add_field (obj, k, v);
+      r_json_value_unref (k);
+      r_json_value_unref (v);
+    }
+
+    start = r_time_get_ts_monotonic ();
+    for (n = 0; n < lookups; n++) {
+      v = r_json_value_get_object_field (obj, names[(n * 7919) % sizes[s]]);
+      r_json_value_unref (v);
+    }
+    elapsed = r_time_get_ts_monotonic () - start;
+
+    r_print ("%"R_TIME_FORMAT"  JSON object lookup (%u fields): %.1f ns/lookup\n",
+        R_TIME_ARGS (elapsed), sizes[s], (rdouble) elapsed / lookups);
+
+    for (i = 0; i < sizes[s]; i++)
+      r_free (names[i]);
+    r_free (names);
+    r_json_value_unref (obj);
+  }
+}
+RTEST_END;
+
+#define JSON_BENCH_WRITE_RECORDS  2000
+
+static void
+json_bench_object_add (RJsonValue * obj, const rchar * name, RJsonValue * v)
+{
+  RJsonValue * k = r_json_string_new_static_unescaped (name);
+  r_json_object_add_field (obj, k, v);
+  r_json_value_unref (k);
+  r_json_value_unref (v);
+}
+
+/* The response an HTTP handler would build: DOM first, then serialize. */
+static RBuffer *
+json_bench_write_tree (void)
+{
+  RJsonValue * root = r_json_array_new ();
+  RBuffer * ret;
+  rchar name[32];
+  ruint i;
+
+  for (i = 0; i < JSON_BENCH_WRITE_RECORDS; i++) {
+    RJsonValue * rec = r_json_object_new ();
+    RJsonValue * geo = r_json_object_new ();
+
+    r_snprintf (name, sizeof (name), "user-%u", i);
+    json_bench_object_add (rec, "id", r_json_number_new_double (i));
+    json_bench_object_add (rec, "name", r_json_string_new (name, -1, NULL));
+    json_bench_object_add (rec, "score", r_json_number_new_double (i % 1000));
+    json_bench_object_add (rec, "active", (i & 1) ? r_json_true_new () : r_json_false_new ());
+    json_bench_object_add (geo, "lat", r_json_number_new_double (-(rdouble) (i % 90)));
+    json_bench_object_add (geo, "lon", r_json_number_new_double (i % 180));
+    json_bench_object_add (rec, "geo", geo);
+    json_bench_object_add (rec, "note", r_json_null_new ());
+    r_json_array_add_value (root, rec);
+    r_json_value_unref (rec);
+  }
+
+  ret = r_json_value_to_buffer (root, R_JSON_COMPACT, NULL);
+  r_json_value_unref (root);
+  return ret;
+}
+
+static RBuffer *
+json_bench_write_direct (void)
+{
+  RBuffer * ret = r_buffer_new ();
+  RJsonWriter w;
+  rchar name[32];
+  ruint i;
+
+  r_json_writer_init_buffer (&w, ret, 0, R_JSON_COMPACT);
+  r_json_writer_begin_array (&w);
+  for (i = 0; i < JSON_BENCH_WRITE_RECORDS; i++) {
+    int n = r_snprintf (name, sizeof (name), "user-%u", i);
+
+    r_json_writer_begin_object (&w);
+    r_json_writer_key (&w, "id", 2);
+    r_json_writer_int (&w, i);
+    r_json_writer_key (&w, "name", 4);
+    r_json_writer_string (&w, name, n);
+    r_json_writer_key (&w, "score", 5);
+    r_json_writer_int (&w, i % 1000);
+    r_json_writer_key (&w, "active", 6);
+    r_json_writer_bool (&w, i & 1);
+    r_json_writer_key (&w, "geo", 3);
+    r_json_writer_begin_object (&w);
+    r_json_writer_key (&w, "lat", 3);
+    r_json_writer_int (&w, -(rint64) (i % 90));
+    r_json_writer_key (&w, "lon", 3);
+    r_json_writer_int (&w, i % 180);
+    r_json_writer_end_object (&w);
+    r_json_writer_key (&w, "note", 4);
+    r_json_writer_null (&w);
+    r_json_writer_end_object (&w);
+  }
+  r_json_writer_end_array (&w);
+  r_json_writer_finish (&w);
+
+  return ret;
+}
+
+RTEST_BENCH (rjson, write_tree_vs_direct, RTEST_FAST)
+{
+  static const struct {
+    const rchar * name;
+    RBuffer * (*func) (void);
+  } writers[] = {
+    { "JSON write DOM + serialize", json_bench_write_tree },
+    { "JSON write RJsonWriter", json_bench_write_direct },
+  };
+  RBuffer * ref, * buf;
+  RClockTime start, elapsed;
+  rchar * a, * b;
+  rsize asize, bsize;
+  ruint w, i;
+
+  /* Both produce the same bytes. */
+  ref = json_bench_write_tree ();
+  buf = json_bench_write_direct ();
+  a = r_buffer_extract_dup_all (ref, &asize);
+  b = r_buffer_extract_dup_all (buf, &bsize);
+  r_assert_cmpuint (asize, ==, bsize);
+  r_assert_cmpint (r_memcmp (a, b, asize), ==, 0);
+  r_free (a);
+  r_free (b);
+  r_buffer_unref (buf);
+
+  for (w = 0; w < R_N_ELEMENTS (writers); w++) {
+    json_bench_mem_begin ();
+    r_buffer_unref (writers[w].func ());
+    json_bench_mem_end ();
+    r_print ("%s (%"RSIZE_FMT" bytes): %u allocations, %"RSIZE_FMT" bytes peak\n",
+        writers[w].name, asize, json_bench_mem.allocs, json_bench_mem.peak);
+
+    start = r_time_get_ts_monotonic ();
+    for (i = 0; i < JSON_BENCH_ITERS; i++)
+      r_buffer_unref (writers[w].func ());
+    elapsed = r_time_get_ts_monotonic () - start;
+    bench_print_throughput (writers[w].name, JSON_BENCH_ITERS, asize, elapsed);
+  }
+
+  r_buffer_unref (ref);
+}
+RTEST_END;
@@ -0,0 +1,84 @@
+#include <rlib/rlib.h>
+#include "util.h"
+
+R_LOG_CATEGORY_DEFINE_STATIC (logbenchcat, "logbench", "Logging benchmark",
+    R_CLR_FG_CYAN);
+#define R_LOG_CAT_DEFAULT &logbenchcat
+
+#define LOG_BENCH_MSGS    (200 * 1000)
+
+/* What the logging thread pays per message: the stock handler formats and
+ * flushes on the caller, the async sink only copies into its ring and the
+ * binary trace does not format at all. */
+RTEST_BENCH (rlog, handler_cost, RTEST_FAST | RTEST_SYSTEM)
+{
+  static const RLogAsyncOverflow policies[] = {
+    R_LOG_ASYNC_OVERFLOW_BLOCK, R_LOG_ASYNC_OVERFLOW_COUNT,
+  };
+  RLogFunc oldfunc;
+  rpointer olddata;
+  RClockTime start;
+  rsize i, p;
+  FILE * f;
+
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+  r_log_category_set_threshold (R_LOG_CAT_DEFAULT, R_LOG_LEVEL_TRACE);
+
+  r_assert_cmpptr ((f = tmpfile ()), !=, NULL);
+  oldfunc = r_log_override_default_handler (r_log_default_handler, f, &olddata);
+  start = r_time_get_ts_monotonic ();
+  for (i = 0; i < LOG_BENCH_MSGS; i++)
+    R_LOG_TRACE ("packet %"RSIZE_FMT" seq %u len %u", i, (ruint)i & 0xffff, 1200u);
+  bench_print_ops ("default handler", LOG_BENCH_MSGS,
+      r_time_get_ts_monotonic () - start);
+  r_log_override_default_handler (oldfunc, olddata, NULL);
+  fclose (f);
+
+  for (p = 0; p < R_N_ELEMENTS (policies); p++) {
+    RLogAsync * sink;
+    RIOHandle handle;
+    RClockTime caller;
+    rchar * label;
+
+    r_assert_cmpint ((handle = r_io_open_tmp_full (NULL, "rlogbench", R_FILE_WRITE,
+            R_FILE_SHARE_EXCLUSIVE, R_FILE_FLAG_TEMPORARY, NULL, NULL)), !=, R_IO_HANDLE_INVALID);
+    r_assert_cmpptr ((sink = r_log_async_new (handle, policies[p],
+            1024 * 1024)), !=, NULL);
+
+    oldfunc = r_log_override_default_handler (r_log_async_handler, sink, &olddata);
+    start = r_time_get_ts_monotonic ();
+    for (i = 0; i < LOG_BENCH_MSGS; i++)
+      R_LOG_TRACE ("packet %"RSIZE_FMT" seq %u len %u", i, (ruint)i & 0xffff, 1200u);
+    caller = r_time_get_ts_monotonic () - start;
+    r_log_async_flush (sink);
+    r_log_override_default_handler (oldfunc, olddata, NULL);
+
+    label = r_strprintf ("async %s (caller)",
+        policies[p] == R_LOG_ASYNC_OVERFLOW_BLOCK ? "block" : "count");
+    bench_print_ops (label, LOG_BENCH_MSGS, caller);
+    r_free (label);
+    label = r_strprintf ("async %s (written, %u dropped)",
+        policies[p] == R_LOG_ASYNC_OVERFLOW_BLOCK ? "block" : "count",
+        r_log_async_dropped (sink));
+    bench_print_ops (label, LOG_BENCH_MSGS, r_time_get_ts_monotonic () - start);
+    r_free (label);
+
+    r_log_async_unref (sink);
+    r_io_close (handle);
+  }
+
+  {
+    rchar * path = r_fs_path_new_tmpname_full (NULL, "rlogbench", NULL);
+
+    r_assert (r_log_bin_open (path));
+    start = r_time_get_ts_monotonic ();
+    for (i = 0; i < LOG_BENCH_MSGS; i++)
+      R_LOG_TRACE ("packet %"RSIZE_FMT" seq %u len %u", i, (ruint)i & 0xffff, 1200u);
+    bench_print_ops ("binary trace", LOG_BENCH_MSGS,
+        r_time_get_ts_monotonic () - start);
+    r_log_bin_close ();
+    remove (path);
+    r_free (path);
+  }
+}
+RTEST_END;
@@ -0,0 +1,76 @@
+#include <rlib/rnet.h>
+#include "util.h"
+
+#define STUN_BENCH_ITERS    200000
+
+static const rchar stun_bench_pwd[] = "jdZU5MNMAUnq+FM5FHHArfdN1Ys9uw==";
+static const ruint8 stun_bench_tid[R_STUN_TRANSACTION_ID_SIZE] = {
+  0x6f, 0x67, 0x2f, 0x45, 0x4b, 0x78, 0x77, 0x64, 0x38, 0x44, 0x61, 0x34
+};
+
+/* The generic builder: a fresh HMAC key schedule per message plus
+ * attribute-by-attribute encoding. */
+static void
+run_stun_generic_bench (const RSocketAddress * addr, const rchar * label)
+{
+  ruint8 buf[128];
+  RStunMsgCtx ctx;
+  RClockTime start;
+  ruint i;
+
+  start = r_time_get_ts_monotonic ();
+  for (i = 0; i < STUN_BENCH_ITERS; i++) {
+    r_stun_msg_begin (&ctx, buf, sizeof (buf),
+        R_STUN_CLASS_SUCCESS_RESPONSE, R_STUN_METHOD_BINDING, stun_bench_tid);
+    r_stun_msg_add_xor_address (&ctx, R_STUN_ATTR_TYPE_XOR_MAPPED_ADDRESS, addr);
+    r_stun_msg_add_message_integrity_short_cred (&ctx,
+        stun_bench_pwd, sizeof (stun_bench_pwd) - 1);
+    r_assert_cmpuint (r_stun_msg_end (&ctx, TRUE), >, 0);
+  }
+  bench_print_ops (label, STUN_BENCH_ITERS, r_time_get_ts_monotonic () - start);
+}
+
+static void
+run_stun_responder_bench (const RSocketAddress * addr, const rchar * label)
+{
+  ruint8 buf[R_STUN_BINDING_RESPONSE_MAX_SIZE];
+  RStunBindingResponder * resp;
+  RClockTime start;
+  ruint i;
+
+  r_assert_cmpptr ((resp = r_stun_binding_responder_new (stun_bench_pwd,
+          sizeof (stun_bench_pwd) - 1)), !=, NULL);
+
+  start = r_time_get_ts_monotonic ();
+  for (i = 0; i < STUN_BENCH_ITERS; i++) {
+    r_assert_cmpuint (r_stun_binding_responder_build (resp, buf, sizeof (buf),
+          stun_bench_tid, addr), >, 0);
+  }
+  bench_print_ops (label, STUN_BENCH_ITERS, r_time_get_ts_monotonic () - start);
+
+  r_stun_binding_responder_free (resp);
+}
+
+RTEST_BENCH (rstun, binding_response_ipv4, RTEST_FAST)
+{
+  RSocketAddress * addr = r_socket_address_ipv4_new_uint8 (192, 168, 1, 10, 54198);
+
+  run_stun_generic_bench (addr, "STUN binding response IPv4 (generic)");
+  run_stun_responder_bench (addr, "STUN binding response IPv4 (responder)");
+  r_socket_address_unref (addr);
+}
+RTEST_END;
+
+RTEST_BENCH (rstun, binding_response_ipv6, RTEST_FAST)
+{
+  static const ruint8 ip[16] = {
+    0x20, 0x01, 0x0d, 0xb8, 0x12, 0x34, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0xca, 0xfe, 0x00, 0x01
+  };
+  RSocketAddress * addr = r_socket_address_ipv6_new_from_bytes (ip, 54198);
+
+  run_stun_generic_bench (addr, "STUN binding response IPv6 (generic)");
+  run_stun_responder_bench (addr, "STUN binding response IPv6 (responder)");
+  r_socket_address_unref (addr);
+}
+RTEST_END;
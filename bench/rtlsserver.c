@@ -0,0 +1,417 @@
+#include <rlib/rlib.h>
+#include <rlib/rev.h>
+#include <rlib/crypto/rkey.h>
+#include <rlib/crypto/rpem.h>
+#include <rlib/net/rtlsclient.h>
+#include <rlib/net/rtlsserver.h>
+#include "../test/rtlstestcerts.h"
+#include "util.h"
+
+#include <stdlib.h>
+
+/* Handshake flood on one REvLoop: a steady TLS 1.3 connection ping-pongs
+ * application data while TLS_FLOOD_HANDSHAKES fresh connections handshake
+ * against RSA-2048 servers on the same loop. Records move between the
+ * in-memory endpoints through loop callbacks, so every handshake message is
+ * a unit of loop work the pings queue behind. Reported is the ping round-trip
+ * latency distribution: with the signatures inline each CertificateVerify
+ * stalls the loop, offloaded (r_tls_server_offload_priv_key_op) they run on
+ * the loop's task queue. */
+#define TLS_FLOOD_HANDSHAKES    64
+#define TLS_FLOOD_MAX_SAMPLES   65536
+
+typedef struct _TLSFloodBench TLSFloodBench;
+
+typedef struct {
+  TLSFloodBench * bench;
+  RTLSServer * server;
+  RTLSClient * client;
+  RQueue c2s, s2c;              /* records in flight */
+  rboolean scheduled;           /* a delivery callback is queued */
+  rboolean done;
+} TLSFloodPair;
+
+struct _TLSFloodBench {
+  REvLoop * loop;
+  RPrng * prng;
+  RCryptoCert * cert;
+  RCryptoKey * key;
+  const RTLSCallbacks * srvcbs;
+
+  TLSFloodPair steady;
+  TLSFloodPair flood[TLS_FLOOD_HANDSHAKES];
+  ruint flood_started, flood_done;
+
+  RClockTime ping_ts;
+  RClockTime * samples;
+  ruint nsamples;
+};
+
+static const ruint8 ping[] = { 'p', 'i', 'n', 'g' };
+
+static void tls_flood_start (TLSFloodBench * bench, TLSFloodPair * pair);
+
+static void
+tls_flood_deliver (rpointer data, REvLoop * loop)
+{
+  TLSFloodPair * pair = data;
+  RBuffer * buf;
+  (void) loop;
+
+  pair->scheduled = FALSE;
+  while ((buf = r_queue_pop (&pair->c2s)) != NULL) {
+    r_tls_server_incoming_data (pair->server, buf);
+    r_buffer_unref (buf);
+  }
+  while ((buf = r_queue_pop (&pair->s2c)) != NULL) {
+    r_tls_client_incoming_data (pair->client, buf);
+    r_buffer_unref (buf);
+  }
+}
+
+static rboolean
+tls_flood_push (TLSFloodPair * pair, RQueue * q, RBuffer * buf)
+{
+  r_queue_push (q, r_buffer_ref (buf));
+  if (!pair->scheduled) {
+    pair->scheduled = TRUE;
+    r_assert (r_ev_loop_add_callback (pair->bench->loop, FALSE,
+          tls_flood_deliver, pair, NULL));
+  }
+  return TRUE;
+}
+
+static rboolean
+tls_flood_srv_out (rpointer ctx, RBuffer * buf, rpointer session)
+{
+  TLSFloodPair * pair = ctx;
+  (void) session;
+  return tls_flood_push (pair, &pair->s2c, buf);
+}
+
+static rboolean
+tls_flood_cli_out (rpointer ctx, RBuffer * buf, rpointer session)
+{
+  TLSFloodPair * pair = ctx;
+  (void) session;
+  return tls_flood_push (pair, &pair->c2s, buf);
+}
+
+static void
+tls_flood_send_ping (TLSFloodBench * bench)
+{
+  RBuffer * buf;
+
+  r_assert_cmpptr ((buf = r_buffer_new_wrapped (R_MEM_FLAG_NONE,
+          (rpointer)ping, sizeof (ping), sizeof (ping), 0, NULL, NULL)), !=, NULL);
+  bench->ping_ts = r_time_get_ts_monotonic ();
+  r_assert (r_tls_client_send_appdata (bench->steady.client, buf));
+  r_buffer_unref (buf);
+}
+
+/* Server side echoes the ping back. */
+static rboolean
+tls_flood_srv_app (rpointer ctx, RBuffer * buf, rpointer session)
+{
+  (void) ctx;
+  return r_tls_server_send_appdata (session, buf);
+}
+
+/* The echo closes one sample; keep pinging until the flood is through. */
+static rboolean
+tls_flood_cli_app (rpointer ctx, RBuffer * buf, rpointer session)
+{
+  TLSFloodPair * pair = ctx;
+  TLSFloodBench * bench = pair->bench;
+  (void) buf;
+  (void) session;
+
+  if (bench->nsamples < TLS_FLOOD_MAX_SAMPLES)
+    bench->samples[bench->nsamples++] = r_time_get_ts_monotonic () - bench->ping_ts;
+  if (bench->flood_started < TLS_FLOOD_HANDSHAKES)
+    tls_flood_start (bench, &bench->flood[bench->flood_started++]);
+  if (bench->flood_done < TLS_FLOOD_HANDSHAKES)
+    tls_flood_send_ping (bench);
+  return TRUE;
+}
+
+static void
+tls_flood_srv_hs_done (rpointer ctx, rpointer session)
+{
+  TLSFloodPair * pair = ctx;
+  (void) session;
+
+  pair->done = TRUE;
+  if (pair != &pair->bench->steady)
+    pair->bench->flood_done++;
+}
+
+/* Once the steady connection is up, start pinging. */
+static void
+tls_flood_cli_hs_done (rpointer ctx, rpointer session)
+{
+  TLSFloodPair * pair = ctx;
+  (void) session;
+
+  if (pair == &pair->bench->steady)
+    tls_flood_send_ping (pair->bench);
+}
+
+static void
+tls_flood_error (rpointer ctx, RTLSAlertType alert, rpointer session)
+{
+  (void) ctx;
+  (void) alert;
+  (void) session;
+  r_assert_not_reached ();
+}
+
+static const RTLSCallbacks tls_flood_srvcbs_inline = {
+  NULL, tls_flood_srv_hs_done, tls_flood_srv_out, tls_flood_srv_app,
+  tls_flood_error, NULL, NULL, NULL, NULL,
+};
+static const RTLSCallbacks tls_flood_srvcbs_offload = {
+  NULL, tls_flood_srv_hs_done, tls_flood_srv_out, tls_flood_srv_app,
+  tls_flood_error, NULL, NULL, NULL, r_tls_server_offload_priv_key_op,
+};
+static const RTLSCallbacks tls_flood_clicbs = {
+  NULL, tls_flood_cli_hs_done, tls_flood_cli_out, tls_flood_cli_app,
+  tls_flood_error, NULL, NULL, NULL, NULL,
+};
+
+static void
+tls_flood_start (TLSFloodBench * bench, TLSFloodPair * pair)
+{
+  pair->bench = bench;
+  r_queue_init (&pair->c2s);
+  r_queue_init (&pair->s2c);
+  r_assert_cmpptr ((pair->server = r_tls_server_new (bench->srvcbs, pair, NULL)), !=, NULL);
+  r_assert_cmpptr ((pair->client = r_tls_client_new (&tls_flood_clicbs, pair, NULL)), !=, NULL);
+  r_assert_cmpint (r_tls_server_set_cert (pair->server, bench->cert, bench->key),
+      ==, R_TLS_ERROR_OK);
+  r_assert_cmpint (r_tls_server_start (pair->server, bench->loop, bench->prng),
+      ==, R_TLS_ERROR_OK);
+  r_assert_cmpint (r_tls_client_start (pair->client, bench->loop, bench->prng,
+        R_TLS_VERSION_TLS_1_3), ==, R_TLS_ERROR_OK);
+}
+
+static void
+tls_flood_stop (TLSFloodPair * pair)
+{
+  r_tls_client_unref (pair->client);
+  r_tls_server_unref (pair->server);
+  r_queue_clear (&pair->c2s, r_buffer_unref);
+  r_queue_clear (&pair->s2c, r_buffer_unref);
+}
+
+static int
+tls_flood_cmp (const void * a, const void * b)
+{
+  RClockTime x = *(const RClockTime *)a, y = *(const RClockTime *)b;
+  return (x > y) - (x < y);
+}
+
+static void
+run_tls_flood_bench (const rchar * label, const RTLSCallbacks * srvcbs)
+{
+  TLSFloodBench bench;
+  RClockTime start, end;
+  ruint i;
+
+  r_memclear (&bench, sizeof (bench));
+  bench.srvcbs = srvcbs;
+  r_assert_cmpptr ((bench.samples = r_mem_new_n (RClockTime, TLS_FLOOD_MAX_SAMPLES)), !=, NULL);
+  r_assert_cmpptr ((bench.loop = r_ev_loop_new ()), !=, NULL);
+  r_assert_cmpptr ((bench.prng = r_rand_prng_new ()), !=, NULL);
+  r_assert_cmpptr ((bench.cert = r_pem_parse_cert_from_data (rtest_leaf_root_pem, -1)), !=, NULL);
+  r_assert_cmpptr ((bench.key = r_pem_parse_key_from_data (rtest_leaf_root_key_pem,
+          -1, NULL, 0)), !=, NULL);
+
+  start = r_time_get_ts_monotonic ();
+  tls_flood_start (&bench, &bench.steady);
+  r_ev_loop_run (bench.loop, R_EV_LOOP_RUN_LOOP);
+  end = r_time_get_ts_monotonic ();
+
+  r_assert_cmpuint (bench.flood_done, ==, TLS_FLOOD_HANDSHAKES);
+  r_assert_cmpuint (bench.nsamples, >, 0);
+  qsort (bench.samples, bench.nsamples, sizeof (RClockTime), tls_flood_cmp);
+  r_print ("%"R_TIME_FORMAT"  TLS 1.3 flood %s: %u handshakes, %u pings, "
+      "p50 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+      R_TIME_ARGS (end - start), label, TLS_FLOOD_HANDSHAKES, bench.nsamples,
+      (rdouble)bench.samples[bench.nsamples / 2] / R_MSECOND,
+      (rdouble)bench.samples[(bench.nsamples * 99) / 100] / R_MSECOND,
+      (rdouble)bench.samples[bench.nsamples - 1] / R_MSECOND);
+
+  for (i = 0; i < bench.flood_started; i++)
+    tls_flood_stop (&bench.flood[i]);
+  tls_flood_stop (&bench.steady);
+  r_crypto_key_unref (bench.key);
+  r_crypto_cert_unref (bench.cert);
+  r_prng_unref (bench.prng);
+  r_ev_loop_unref (bench.loop);
+  r_free (bench.samples);
+}
+
+RTEST_BENCH (rtlsserver, handshake_flood_inline, RTEST_FAST)
+{
+  run_tls_flood_bench ("inline sign", &tls_flood_srvcbs_inline);
+}
+RTEST_END;
+
+RTEST_BENCH (rtlsserver, handshake_flood_offload, RTEST_FAST)
+{
+  run_tls_flood_bench ("offloaded sign", &tls_flood_srvcbs_offload);
+}
+RTEST_END;
+
+/* Bulk application data, server to client, over an in-memory TLS 1.3 pair:
+ * TLS_BULK_BYTES written as full 16 KiB buffers, as TLS_BULK_SMALL-byte
+ * writes each sealed into its own record, and as the same small writes
+ * corked (r_tls_server_cork) so they coalesce into full records. The client
+ * opens every record, so the figure covers both directions of the AEAD. */
+#define TLS_BULK_BYTES          (64 * 1024 * 1024)
+#define TLS_BULK_SMALL          256
+
+typedef struct {
+  RQueue c2s, s2c;
+  rsize received;
+} TLSBulkBench;
+
+static rboolean
+tls_bulk_srv_out (rpointer ctx, RBuffer * buf, rpointer session)
+{
+  TLSBulkBench * bench = ctx;
+  (void) session;
+  r_queue_push (&bench->s2c, r_buffer_ref (buf));
+  return TRUE;
+}
+
+static rboolean
+tls_bulk_cli_out (rpointer ctx, RBuffer * buf, rpointer session)
+{
+  TLSBulkBench * bench = ctx;
+  (void) session;
+  r_queue_push (&bench->c2s, r_buffer_ref (buf));
+  return TRUE;
+}
+
+static rboolean
+tls_bulk_cli_app (rpointer ctx, RBuffer * buf, rpointer session)
+{
+  TLSBulkBench * bench = ctx;
+  (void) session;
+  bench->received += r_buffer_get_size (buf);
+  return TRUE;
+}
+
+static const RTLSCallbacks tls_bulk_srvcbs = {
+  NULL, NULL, tls_bulk_srv_out, NULL, tls_flood_error, NULL, NULL, NULL, NULL,
+};
+static const RTLSCallbacks tls_bulk_clicbs = {
+  NULL, NULL, tls_bulk_cli_out, tls_bulk_cli_app, tls_flood_error,
+  NULL, NULL, NULL, NULL,
+};
+
+static void
+tls_bulk_pump (TLSBulkBench * bench, RTLSServer * server, RTLSClient * client)
+{
+  RBuffer * buf;
+  rboolean progress;
+
+  do {
+    progress = FALSE;
+    while ((buf = r_queue_pop (&bench->c2s)) != NULL) {
+      r_tls_server_incoming_data (server, buf);
+      r_buffer_unref (buf);
+      progress = TRUE;
+    }
+    while ((buf = r_queue_pop (&bench->s2c)) != NULL) {
+      r_tls_client_incoming_data (client, buf);
+      r_buffer_unref (buf);
+      progress = TRUE;
+    }
+  } while (progress);
+}
+
+static void
+run_tls_bulk_bench (const rchar * label, rsize wsize, rboolean cork)
+{
+  TLSBulkBench bench;
+  REvLoop * loop;
+  RPrng * prng;
+  RCryptoCert * cert;
+  RCryptoKey * key;
+  RTLSServer * server;
+  RTLSClient * client;
+  RBuffer * app;
+  ruint8 * payload;
+  RClockTime start, end;
+  rsize sent;
+
+  r_memclear (&bench, sizeof (bench));
+  r_queue_init (&bench.c2s);
+  r_queue_init (&bench.s2c);
+  r_assert_cmpptr ((payload = r_malloc (wsize)), !=, NULL);
+  r_memset (payload, 0x5a, wsize);
+  r_assert_cmpptr ((loop = r_ev_loop_new ()), !=, NULL);
+  r_assert_cmpptr ((prng = r_rand_prng_new ()), !=, NULL);
+  r_assert_cmpptr ((cert = r_pem_parse_cert_from_data (rtest_leaf_root_pem, -1)), !=, NULL);
+  r_assert_cmpptr ((key = r_pem_parse_key_from_data (rtest_leaf_root_key_pem,
+          -1, NULL, 0)), !=, NULL);
+  r_assert_cmpptr ((server = r_tls_server_new (&tls_bulk_srvcbs, &bench, NULL)), !=, NULL);
+  r_assert_cmpptr ((client = r_tls_client_new (&tls_bulk_clicbs, &bench, NULL)), !=, NULL);
+  r_assert_cmpint (r_tls_server_set_cert (server, cert, key), ==, R_TLS_ERROR_OK);
+  r_assert_cmpint (r_tls_server_start (server, loop, prng), ==, R_TLS_ERROR_OK);
+  r_assert_cmpint (r_tls_client_start (client, loop, prng, R_TLS_VERSION_TLS_1_3),
+      ==, R_TLS_ERROR_OK);
+  tls_bulk_pump (&bench, server, client);
+  r_assert_cmpptr ((app = r_buffer_new_wrapped (R_MEM_FLAG_NONE,
+          payload, wsize, wsize, 0, NULL, NULL)), !=, NULL);
+
+  start = r_time_get_ts_monotonic ();
+  if (cork)
+    r_assert (r_tls_server_cork (server));
+  for (sent = 0; sent < TLS_BULK_BYTES; sent += wsize) {
+    r_assert (r_tls_server_send_appdata (server, app));
+    if (r_queue_size (&bench.s2c) >= 16)
+      tls_bulk_pump (&bench, server, client);
+  }
+  if (cork)
+    r_assert (r_tls_server_uncork (server));
+  tls_bulk_pump (&bench, server, client);
+  end = r_time_get_ts_monotonic ();
+
+  r_assert_cmpuint (bench.received, ==, sent);
+  r_print ("%"R_TIME_FORMAT"  TLS 1.3 bulk %s: %"RSIZE_FMT" MiB, %.1f MiB/s\n",
+      R_TIME_ARGS (end - start), label, sent >> 20,
+      ((rdouble)sent / (1024 * 1024)) / ((rdouble)(end - start) / R_SECOND));
+
+  r_buffer_unref (app);
+  r_tls_client_unref (client);
+  r_tls_server_unref (server);
+  r_queue_clear (&bench.c2s, r_buffer_unref);
+  r_queue_clear (&bench.s2c, r_buffer_unref);
+  r_crypto_key_unref (key);
+  r_crypto_cert_unref (cert);
+  r_prng_unref (prng);
+  r_ev_loop_unref (loop);
+  r_free (payload);
+}
+
+RTEST_BENCH (rtlsserver, bulk_full_records, RTEST_FAST)
+{
+  run_tls_bulk_bench ("16 KiB writes", R_TLS_MAX_PLAINTEXT, FALSE);
+}
+RTEST_END;
+
+RTEST_BENCH (rtlsserver, bulk_small_writes, RTEST_FAST)
+{
+  run_tls_bulk_bench ("256 B writes", TLS_BULK_SMALL, FALSE);
+}
+RTEST_END;
+
+RTEST_BENCH (rtlsserver, bulk_small_writes_corked, RTEST_FAST)
+{
+  run_tls_bulk_bench ("256 B writes corked", TLS_BULK_SMALL, TRUE);
+}
+RTEST_END;
@@ -0,0 +1,252 @@
+#include <rlib/rnet.h>
+#include "util.h"
+
+#define TURN_BENCH_REALM        "rlib"
+#define TURN_BENCH_CLIENTS      256
+#define TURN_BENCH_RELAY_TIME   (3 * R_SECOND)
+#define TURN_BENCH_PAYLOAD      160
+
+typedef struct {
+  RSocket * sock;
+  RSocketAddress * server;
+  RSocketAddress * relay;
+  ruint8 key[16];
+  rchar nonce[64];
+  ruint8 buf[1024];
+} TurnBenchClient;
+
+static rsize
+turn_bench_recv (RSocket * sock, ruint8 * buf, rsize size)
+{
+  RSocketAddress * from = r_socket_address_new ();
+  rsize ret = 0;
+  ruint i;
+
+  for (i = 0; i < 20000; i++) {
+    if (r_socket_receive_from (sock, from, buf, size, &ret) == R_SOCKET_OK)
+      break;
+    ret = 0;
+    r_thread_usleep (100);
+  }
+
+  r_socket_address_unref (from);
+  return ret;
+}
+
+static RSocket *
+turn_bench_socket (void)
+{
+  RSocketAddress * addr = r_socket_address_ipv4_new_uint8 (127, 0, 0, 1, 0);
+  RSocket * ret = r_socket_new (R_SOCKET_FAMILY_IPV4, R_SOCKET_TYPE_DATAGRAM,
+      R_SOCKET_PROTOCOL_UDP);
+
+  r_assert_cmpint (r_socket_bind (ret, addr, FALSE), ==, R_SOCKET_OK);
+  r_assert (r_socket_set_blocking (ret, FALSE));
+  r_socket_address_unref (addr);
+  return ret;
+}
+
+/* One authenticated request; the response's error code or 0. */
+static ruint
+turn_bench_request (TurnBenchClient * client, RStunMethod method,
+    const RSocketAddress * peer, ruint16 channel)
+{
+  static const ruint8 udp[] = { R_SOCKET_PROTOCOL_UDP, 0, 0, 0 };
+  RStunAttrTLV tlv = { NULL, R_STUN_ATTR_TYPE_REQUESTED_TRANSPORT, sizeof (udp), udp };
+  ruint8 tid[R_STUN_TRANSACTION_ID_SIZE];
+  RStunMsgCtx ctx;
+  rsize len, sent;
+  ruint ret = 0;
+
+  r_rand_entropy_fill (tid, sizeof (tid));
+  r_assert (r_stun_msg_begin (&ctx, client->buf, sizeof (client->buf),
+        R_STUN_CLASS_REQUEST, method, tid));
+  if (method == R_STUN_METHOD_ALLOCATE)
+    r_stun_msg_add_attribute (&ctx, &tlv);
+  if (channel != 0)
+    r_stun_msg_add_channel_number (&ctx, channel);
+  if (peer != NULL)
+    r_stun_msg_add_xor_address (&ctx, R_STUN_ATTR_TYPE_XOR_PEER_ADDRESS, peer);
+  if (client->nonce[0] != 0) {
+    r_stun_msg_add_string (&ctx, R_STUN_ATTR_TYPE_USERNAME, "user", -1);
+    r_stun_msg_add_string (&ctx, R_STUN_ATTR_TYPE_REALM, TURN_BENCH_REALM, -1);
+    r_stun_msg_add_string (&ctx, R_STUN_ATTR_TYPE_NONCE, client->nonce, -1);
+    r_stun_msg_add_message_integrity_short_cred (&ctx, client->key, 16);
+  }
+  len = r_stun_msg_end (&ctx, TRUE);
+  r_assert_cmpint (r_socket_send_to (client->sock, client->server,
+        client->buf, len, &sent), ==, R_SOCKET_OK);
+
+  r_assert_cmpuint ((len = turn_bench_recv (client->sock, client->buf,
+          sizeof (client->buf))), >, 0);
+  if (r_stun_attr_tlv_first (client->buf, &tlv)) {
+    do {
+      if (tlv.type == R_STUN_ATTR_TYPE_ERROR_CODE)
+        ret = r_stun_attr_tlv_parse_error_code (client->buf, &tlv);
+      else if (tlv.type == R_STUN_ATTR_TYPE_NONCE && tlv.len < sizeof (client->nonce))
+        r_memcpy (client->nonce, tlv.value, tlv.len);
+      else if (tlv.type == R_STUN_ATTR_TYPE_XOR_RELAYED_ADDRESS && client->relay == NULL)
+        client->relay = r_stun_attr_tlv_parse_xor_address (client->buf, &tlv);
+    } while (r_stun_attr_tlv_next (client->buf, &tlv));
+  }
+
+  return ret;
+}
+
+static RTurnServer *
+turn_bench_server_new (ruint workers)
+{
+  RTurnServerQuota quota = { 0, 0, 0, 0 };
+  RSocketAddress * addr = r_socket_address_ipv4_new_uint8 (127, 0, 0, 1, 0);
+  RTurnServer * ret = r_turn_server_new (TURN_BENCH_REALM);
+
+  r_assert (r_turn_server_add_user (ret, "user", "pass"));
+  r_assert (r_turn_server_set_quota (ret, &quota));
+  r_assert (r_turn_server_start (ret, addr, addr, workers));
+  r_socket_address_unref (addr);
+  return ret;
+}
+
+static void
+turn_bench_client_init (TurnBenchClient * client, RTurnServer * server)
+{
+  r_memclear (client, sizeof (TurnBenchClient));
+  client->sock = turn_bench_socket ();
+  client->server = r_turn_server_get_local_address (server);
+  r_stun_turn_long_term_key ("user", TURN_BENCH_REALM, "pass", client->key);
+}
+
+static void
+turn_bench_client_clear (TurnBenchClient * client)
+{
+  if (client->relay != NULL)
+    r_socket_address_unref (client->relay);
+  r_socket_address_unref (client->server);
+  r_socket_close (client->sock);
+  r_socket_unref (client->sock);
+}
+
+RTEST_BENCH (rturnserver, allocate, RTEST_FASTSLOW | RTEST_SYSTEM)
+{
+  RTurnServer * server = turn_bench_server_new (0);
+  TurnBenchClient * clients = r_mem_new0_n (TurnBenchClient, TURN_BENCH_CLIENTS);
+  RClockTime start;
+  rchar label[64];
+  ruint i;
+
+  for (i = 0; i < TURN_BENCH_CLIENTS; i++) {
+    turn_bench_client_init (&clients[i], server);
+    /* Pick up the nonce outside the timed section. */
+    r_assert_cmpuint (turn_bench_request (&clients[i], R_STUN_METHOD_REFRESH, NULL, 0), ==, 401);
+  }
+
+  start = r_time_get_ts_monotonic ();
+  for (i = 0; i < TURN_BENCH_CLIENTS; i++)
+    r_assert_cmpuint (turn_bench_request (&clients[i], R_STUN_METHOD_ALLOCATE, NULL, 0), ==, 0);
+  r_snprintf (label, sizeof (label), "TURN allocate (%u workers)",
+      r_turn_server_get_worker_count (server));
+  bench_print_ops (label, TURN_BENCH_CLIENTS, r_time_get_ts_monotonic () - start);
+
+  for (i = 0; i < TURN_BENCH_CLIENTS; i++)
+    turn_bench_client_clear (&clients[i]);
+  r_free (clients);
+  r_turn_server_unref (server);
+}
+RTEST_END;
+
+typedef struct {
+  TurnBenchClient * client;
+  raint running;
+  ruint64 sent;
+} TurnBenchSender;
+
+/* Blast ChannelData at the server in batches until told to stop. */
+static rpointer
+turn_bench_channel_send (rpointer data)
+{
+  TurnBenchSender * snd = data;
+  RSocketDatagram dgrams[R_SOCKET_DATAGRAM_BATCH_MAX];
+  ruint8 payload[TURN_BENCH_PAYLOAD], frame[TURN_BENCH_PAYLOAD + 4];
+  rsize i, len, sent;
+
+  r_memset (payload, 0x42, sizeof (payload));
+  len = r_stun_channel_data_encode (frame, sizeof (frame), 0x4000, payload, sizeof (payload));
+  for (i = 0; i < R_N_ELEMENTS (dgrams); i++) {
+    dgrams[i].address = snd->client->server;
+    dgrams[i].data = frame;
+    dgrams[i].size = len;
+  }
+
+  while (r_atomic_int_load (&snd->running)) {
+    if (r_socket_send_datagrams (snd->client->sock, dgrams, R_N_ELEMENTS (dgrams), &sent) == R_SOCKET_OK)
+      snd->sent += sent;
+    else
+      r_thread_usleep (10);
+  }
+
+  return NULL;
+}
+
+RTEST_BENCH (rturnserver, channel_relay, RTEST_FASTSLOW | RTEST_SYSTEM)
+{
+  RTurnServer * server = turn_bench_server_new (1);
+  TurnBenchClient client;
+  TurnBenchSender snd;
+  RTurnServerStats stats;
+  RSocketDatagram dgrams[R_SOCKET_DATAGRAM_BATCH_MAX];
+  ruint8 * mem;
+  RSocket * peer;
+  RSocketAddress * peeraddr;
+  RThread * thread;
+  RClockTime start, elapsed;
+  ruint64 received = 0;
+  rsize i, n;
+
+  turn_bench_client_init (&client, server);
+  peer = turn_bench_socket ();
+  peeraddr = r_socket_get_local_address (peer);
+  r_assert_cmpuint (turn_bench_request (&client, R_STUN_METHOD_ALLOCATE, NULL, 0), ==, 401);
+  r_assert_cmpuint (turn_bench_request (&client, R_STUN_METHOD_ALLOCATE, NULL, 0), ==, 0);
+  r_assert_cmpuint (turn_bench_request (&client, R_STUN_METHOD_CHANNEL_BIND, peeraddr, 0x4000), ==, 0);
+
+  mem = r_malloc (R_N_ELEMENTS (dgrams) * 256);
+  for (i = 0; i < R_N_ELEMENTS (dgrams); i++) {
+    dgrams[i].address = r_socket_address_new ();
+    dgrams[i].data = mem + i * 256;
+    dgrams[i].size = 256;
+  }
+
+  snd.client = &client;
+  snd.sent = 0;
+  r_atomic_int_store (&snd.running, 1);
+  thread = r_thread_new ("turn-bench-send", turn_bench_channel_send, &snd);
+
+  start = r_time_get_ts_monotonic ();
+  while ((elapsed = r_time_get_ts_monotonic () - start) < TURN_BENCH_RELAY_TIME) {
+    if (r_socket_receive_datagrams (peer, dgrams, R_N_ELEMENTS (dgrams), &n) == R_SOCKET_OK)
+      received += n;
+    else
+      r_thread_usleep (10);
+  }
+  r_atomic_int_store (&snd.running, 0);
+  r_thread_join (thread);
+  r_thread_unref (thread);
+
+  r_turn_server_get_stats (server, &stats);
+  r_print ("%"R_TIME_FORMAT"  TURN ChannelData relay: %.0f pps received, "
+      "%"RUINT64_FMT" sent / %"RUINT64_FMT" relayed / %"RUINT64_FMT" received, "
+      "%.1f datagrams per batch\n",
+      R_TIME_ARGS (elapsed), (rdouble) received * R_SECOND / elapsed,
+      snd.sent, stats.peer_packets, received,
+      stats.batches > 0 ? (rdouble) (stats.peer_packets + stats.requests) / stats.batches : 0.0);
+
+  for (i = 0; i < R_N_ELEMENTS (dgrams); i++)
+    r_socket_address_unref (dgrams[i].address);
+  r_free (mem);
+  r_socket_address_unref (peeraddr);
+  r_socket_close (peer);
+  r_socket_unref (peer);
+  turn_bench_client_clear (&client);
+  r_turn_server_unref (server);
+}
+RTEST_END;
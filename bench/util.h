@@ -10,7 +10,9 @@
  *
  * Callers build a descriptive label (e.g. "RSA-2048 decrypt",
  * "ECDH secp256r1 compute_shared", "AES-128 CBC") and pass it as
- * the first argument. */
+ * the first argument. Both also record the single-shot result for
+ * --bench-output / --bench-baseline; benches that want repetitions,
+ * percentiles and outlier rejection use r_test_bench_run instead. */
 
 /* "<label>: X.XXX ms/op, Y.Y ops/sec (iters in s)" — use for
  * asymmetric ops where per-call cost is the metric. */
@@ -25,6 +27,7 @@ bench_print_ops (const rchar * label, ruint iters, RClockTime elapsed)
       "(%u iters in %.3f s)\n",
       R_TIME_ARGS (elapsed), label, per_op_ms, ops_per_sec,
       iters, elapsed_s);
+  r_test_bench_record_once (label, iters, 0, elapsed);
 }
 
 /* "<label>: X.X MiB/s (iters x block-byte blocks in s)" — use
@@ -41,6 +44,7 @@ bench_print_throughput (const rchar * label, ruint iters,
       "(%u x %"RSIZE_FMT"-byte blocks in %.3f s)\n",
       R_TIME_ARGS (elapsed), label, mib_per_s,
       iters, block_bytes, elapsed_s);
+  r_test_bench_record_once (label, iters, block_bytes, elapsed);
 }
 
 #endif /* __RLIB_BENCH_UTIL_H__ */
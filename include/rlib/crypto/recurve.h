@@ -62,6 +62,11 @@
  * strict CT - good enough to remove the dominant key-dependent
  * branch leak; full timing hardening is tracked as a follow-up on
  * the issue that introduced this module.
+ *
+ * secp256r1 and secp384r1 bypass the ladder: they run on dedicated
+ * 64-bit-limb field code with Solinas reduction, a fixed 4-bit
+ * window for arbitrary points and a precomputed comb for @c G,
+ * all with masked table reads and no scalar-dependent branches.
  */
 
 R_BEGIN_DECLS
@@ -149,6 +154,7 @@ typedef struct {
  * exponent used by the constant-time inverter inside the ladder.
  */
 typedef struct {
+  REcurveID id;               /**< @brief Named curve these parameters were initialised for. */
   rmpint p;                   /**< @brief Field prime. */
   rmpint a;                   /**< @brief Curve coefficient a. */
   rmpint b;                   /**< @brief Curve coefficient b. */
@@ -328,6 +334,28 @@ R_API rboolean r_ecurve_point_scalar_mul (REcurveAffinePoint * out,
     const rmpint * scalar, const REcurveAffinePoint * point,
     const REcurve * curve);
 
+/**
+ * @brief Double scalar multiplication for public inputs:
+ * @c out = u1 * G + u2 * Q.
+ *
+ * Meant for signature verification, where the scalars and points
+ * are all public: it is variable-time and must not be fed secrets.
+ * secp256r1 and secp384r1 interleave width-w NAFs of both scalars
+ * over one shared run of doublings, against a cached table of odd
+ * multiples of @c G and a per-call one for @p Q. Other curves fall
+ * back to two @c r_ecurve_point_scalar_mul calls and an add.
+ *
+ * @param out    Destination point (may alias @p Q).
+ * @param u1     Multiplier for the generator.
+ * @param u2     Multiplier for @p Q.
+ * @param Q      Second base point.
+ * @param curve  Curve parameters.
+ * @return @c TRUE on success; @c FALSE on NULL inputs or arithmetic failure.
+ */
+R_API rboolean r_ecurve_point_double_scalar_mul_vartime (REcurveAffinePoint * out,
+    const rmpint * u1, const rmpint * u2, const REcurveAffinePoint * Q,
+    const REcurve * curve);
+
 /**
  * @brief SEC 1 uncompressed encoding: @c 0x04 || X || Y, padded to
  * @c curve->coord_bytes.
@@ -180,6 +180,19 @@ R_API rsize r_msg_digest_blocksize (const RMsgDigest * md);
 /** @brief Reset @p md to the post-construction state, dropping any
  *  accumulated input. */
 R_API void r_msg_digest_reset (RMsgDigest * md);
+/**
+ * @brief Duplicate @p md including its accumulated input.
+ *
+ * Lets a caller absorb a common prefix once and fork the state per
+ * message. Free the copy with @c r_msg_digest_free.
+ */
+R_API RMsgDigest * r_msg_digest_copy (const RMsgDigest * md) R_ATTR_MALLOC;
+/**
+ * @brief Overwrite @p dst with the state of @p src; no allocation.
+ *
+ * @return @c FALSE if the two digests aren't of the same type.
+ */
+R_API rboolean r_msg_digest_copy_state (RMsgDigest * dst, const RMsgDigest * src);
 /**
  * @brief Absorb @p size bytes from @p data into @p md.
  *
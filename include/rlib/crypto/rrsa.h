@@ -65,6 +65,7 @@
 #include <rlib/data/rmpint.h>
 
 #include <rlib/rrand.h>
+#include <rlib/rref.h>
 
 R_BEGIN_DECLS
 
@@ -398,6 +399,71 @@ R_API RCryptoResult r_rsa_pss_verify_hash (const RCryptoKey * key,
     RMsgDigestType mdtype, rconstpointer hash, rsize hashsize,
     rconstpointer sig, rsize sigsize);
 
+/**
+ * @brief One signature in a @ref r_rsa_priv_key_sign_batch call.
+ */
+typedef struct {
+  RMsgDigestType mdtype;  /**< Digest that produced @c hash. */
+  rconstpointer hash;     /**< The digest to sign. */
+  rsize hashsize;         /**< Length of @c hash. */
+  rpointer sig;           /**< Destination for the signature (modulus length). */
+  rsize sigsize;          /**< In: capacity of @c sig; out: bytes written. */
+  RCryptoResult result;   /**< Out: what the single-shot sign call would have returned. */
+} RRsaSignRequest;
+
+/**
+ * @brief Sign several digests with one private key, sharing the modular
+ * exponentiations across SIMD lanes.
+ *
+ * Each request is padded according to the key's padding, exactly as
+ * @ref r_crypto_key_sign would: RSASSA-PKCS1-v1_5 with a DigestInfo for
+ * @c R_RSA_PADDING_PKCS1_V15, RSASSA-PSS for @c R_RSA_PADDING_PKCS1_V21
+ * (which needs @p prng for the salt). Every request is blinded with its
+ * own random factor. Up to eight CRT private operations then run
+ * side-by-side in the 64-bit lanes of the AVX-512 IFMA kernel, one
+ * exponentiation per lane; without IFMA, or for keys without CRT
+ * parameters, the requests are processed one after the other, so the
+ * call is always usable and at worst no faster than a loop.
+ *
+ * @param key Private RSA key.
+ * @param prng PRNG for PSS salts and blinding; @c NULL creates one for
+ *   the call.
+ * @param reqs The requests; each one's @c result and @c sigsize are
+ *   filled in.
+ * @param count Number of requests.
+ * @return @c R_CRYPTO_OK when every request succeeded, otherwise the
+ *   first failing request's result (or an argument error before any
+ *   request ran).
+ */
+R_API RCryptoResult r_rsa_priv_key_sign_batch (const RCryptoKey * key,
+    RPrng * prng, RRsaSignRequest * reqs, rsize count);
+
+/**
+ * @brief One ciphertext in a @ref r_rsa_priv_key_decrypt_batch call.
+ */
+typedef struct {
+  rconstpointer data;     /**< Ciphertext, the modulus length. */
+  rsize size;             /**< Length of @c data. */
+  ruint8 * out;           /**< Destination, exactly @c outsize bytes are written. */
+  rsize outsize;          /**< Expected message length, as for the implicit-rejection decrypt. */
+  RCryptoResult result;   /**< Out: per-request result. */
+} RRsaDecryptRequest;
+
+/**
+ * @brief Batched RSAES-PKCS1-v1_5 decrypt with implicit rejection.
+ *
+ * The batch counterpart of @ref r_rsa_pkcs1v1_5_decrypt_implicit, with
+ * the same per-request contract (a padding failure yields a synthetic
+ * message, not an error) and the same multi-lane exponentiation as
+ * @ref r_rsa_priv_key_sign_batch. Only keys with
+ * @c R_RSA_PADDING_PKCS1_V15 are accepted.
+ *
+ * @return @c R_CRYPTO_OK when every request succeeded, otherwise the
+ *   first failing request's result.
+ */
+R_API RCryptoResult r_rsa_priv_key_decrypt_batch (const RCryptoKey * key,
+    RPrng * prng, RRsaDecryptRequest * reqs, rsize count);
+
 R_END_DECLS
 
 /** @} */
@@ -0,0 +1,165 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2016 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+#ifndef __R_CONCURRENT_HASH_MAP_H__
+#define __R_CONCURRENT_HASH_MAP_H__
+
+#if !defined(__RLIB_H_INCLUDE_GUARD__) && !defined(RLIB_COMPILATION)
+#error "#include <rlib.h> only please."
+#endif
+
+/**
+ * @defgroup r_concurrenthashmap Concurrent hash map
+ * @ingroup r_data
+ *
+ * @brief Refcounted hash map that any number of threads may use at once
+ * without external locking.
+ *
+ * Keys are spread over a fixed set of shards, each with its own writer
+ * lock, so writers only contend when they hit the same shard. Lookups
+ * take no lock at all: every bucket is an immutable snapshot replaced
+ * wholesale on each write, and readers pin what they are looking at with
+ * @ref r_hzrptr hazard pointers. Removed and replaced entries (and the
+ * destroy notifiers of their keys / values) are therefore reclaimed with
+ * a delay, on whichever thread next scans its retired list.
+ *
+ * A value handed back by a lookup is only guaranteed to stay alive if the
+ * map was created with a @c valueref function (typically @c r_ref_ref),
+ * which is applied while the entry is still pinned; without one the
+ * caller must know by other means that the value outlives its use.
+ *
+ * @{
+ */
+
+/**
+ * @file rlib/data/rconcurrenthashmap.h
+ * @brief Sharded hash map with lock-free lookups.
+ */
+
+#include <rlib/rtypes.h>
+#include <rlib/rref.h>
+
+#include <rlib/data/rhashfuncs.h>
+#include <rlib/data/rhashtable.h>
+
+R_BEGIN_DECLS
+
+/** @brief Opaque refcounted concurrent hash map. */
+typedef struct RConcurrentHashMap RConcurrentHashMap;
+
+/** @brief Takes a reference on a value about to be handed out (e.g.
+ * @c r_ref_ref); returns the value to hand out. */
+typedef rpointer (*RConcurrentHashMapRefFunc) (rpointer value);
+/**
+ * @brief Callback for @ref r_concurrent_hash_map_compute_if_present.
+ *
+ * Returns the value to store for @p key: @p value itself to keep the
+ * entry as it is, another value to replace it (@p value then goes through
+ * the value destroy notifier) or @c NULL to remove the entry.
+ */
+typedef rpointer (*RConcurrentHashMapComputeFunc) (rconstpointer key,
+    rpointer value, rpointer user);
+
+/** @brief Convenience: construct a map with no notifiers or value ref. */
+#define r_concurrent_hash_map_new(hash, equal)                                \
+  r_concurrent_hash_map_new_full (hash, equal, NULL, NULL, NULL)
+/**
+ * @brief Construct a concurrent hash map.
+ *
+ * @param hash         Hash function applied to each key.
+ * @param equal        Equality comparator paired with @p hash
+ *                     (@c NULL for pointer identity).
+ * @param keynotify    Destroy notifier for keys, or @c NULL.
+ * @param valuenotify  Destroy notifier for values, or @c NULL.
+ * @param valueref     Applied to every value handed out by a lookup, or
+ *                     @c NULL.
+ */
+R_API RConcurrentHashMap * r_concurrent_hash_map_new_full (RHashFunc hash,
+    REqualFunc equal, RDestroyNotify keynotify, RDestroyNotify valuenotify,
+    RConcurrentHashMapRefFunc valueref) R_ATTR_MALLOC;
+/** @brief Increment the map's refcount. */
+#define r_concurrent_hash_map_ref    r_ref_ref
+/**
+ * @brief Decrement the map's refcount; the last unref notifies every entry.
+ * No other thread may still be using the map at that point.
+ */
+#define r_concurrent_hash_map_unref  r_ref_unref
+
+/** @brief Number of entries; a moment's snapshot while writers run. */
+R_API rsize r_concurrent_hash_map_size (RConcurrentHashMap * map);
+
+/**
+ * @brief Look up @p key without taking any lock.
+ *
+ * @param value  Receives the value, passed through @c valueref, if found
+ *               (may be @c NULL to only test presence).
+ * @return @c TRUE if @p key is present.
+ */
+R_API rboolean r_concurrent_hash_map_lookup (RConcurrentHashMap * map,
+    rconstpointer key, rpointer * value);
+/** @brief @c TRUE if @p key is present. */
+#define r_concurrent_hash_map_contains(map, key)                              \
+  r_concurrent_hash_map_lookup (map, key, NULL)
+/**
+ * @brief Insert or replace @c (key, value).
+ *
+ * A replaced entry's key and value go through their destroy notifiers
+ * once no reader can still see them.
+ *
+ * @return @ref R_HASH_TABLE_OK for a new entry, @ref R_HASH_TABLE_REPLACE
+ * if an existing one was replaced.
+ */
+R_API RHashTableError r_concurrent_hash_map_insert (RConcurrentHashMap * map,
+    rpointer key, rpointer value);
+/**
+ * @brief Insert @c (key, value) only if @p key is not present.
+ *
+ * @param existing  If @p key is present, receives its value passed through
+ *                  @c valueref (may be @c NULL).
+ * @return @c TRUE if the entry was inserted; @c FALSE if @p key was already
+ * present, in which case @p key and @p value still belong to the caller.
+ */
+R_API rboolean r_concurrent_hash_map_insert_if_absent (RConcurrentHashMap * map,
+    rpointer key, rpointer value, rpointer * existing);
+/**
+ * @brief Atomically recompute the value of @p key if it is present.
+ *
+ * @p func runs under the shard's writer lock, so no other write to the
+ * shard can interleave; it must not write to @p map itself.
+ *
+ * @return @c TRUE if @p key was present (and @p func called).
+ */
+R_API rboolean r_concurrent_hash_map_compute_if_present (RConcurrentHashMap * map,
+    rconstpointer key, RConcurrentHashMapComputeFunc func, rpointer user);
+/** @brief Remove @p key; @c TRUE if it was present. */
+R_API rboolean r_concurrent_hash_map_remove (RConcurrentHashMap * map,
+    rconstpointer key);
+/**
+ * @brief Call @p func for every entry.
+ *
+ * Shards are visited one at a time under their writer lock: each shard is
+ * seen consistently, the map as a whole is not. @p func must not write to
+ * @p map.
+ */
+R_API void r_concurrent_hash_map_foreach (RConcurrentHashMap * map,
+    RKeyValueFunc func, rpointer user);
+
+R_END_DECLS
+
+/** @} */
+
+#endif /* __R_CONCURRENT_HASH_MAP_H__ */
@@ -44,6 +44,24 @@
 /** @brief Sentinel returned by hash functions for "no value". */
 #define R_HASH_EMPTY                            RSIZE_MAX
 
+/**
+ * @brief Storage layout for @ref r_hash_table_new_with_flags and
+ * @ref r_hash_set_new_with_flags.
+ */
+typedef enum {
+  /** Default: one @c {key, value, hash} bucket per slot, probed one
+   * bucket at a time. */
+  R_HASH_FLAG_NONE      = 0,
+  /** Grouped (SwissTable-style): a separate byte of hash metadata per
+   * slot, compared 16 slots at a time with SSE2 / NEON, and keys and
+   * values in their own arrays that a probe only reads on a metadata
+   * match. Denser and faster to probe, at the price of calling the hash
+   * function again for every entry when the table grows. */
+  R_HASH_FLAG_GROUPED   = (1 << 0),
+} RHashFlag;
+/** @brief Bitwise-OR of @ref RHashFlag values. */
+typedef ruint32 RHashFlags;
+
 R_BEGIN_DECLS
 
 /**
@@ -59,17 +77,47 @@ R_API rboolean r_direct_equal (rconstpointer a, rconstpointer b);
 /**
  * @brief Hash a NUL-terminated C string.
  *
- * Walks @p data byte-by-byte until the terminator; pair with
- * @ref r_str_equal.
+ * A wyhash-class word-at-a-time hash (AES-NI for long strings where the
+ * CPU has it) keyed with a random seed drawn once per process, so bucket
+ * placement differs between runs and cannot be steered by whoever chose
+ * the keys without seeing the process's hashes. Values are therefore not
+ * stable across processes: never persist them or put them on the wire.
+ * Pair with @ref r_str_equal.
  */
 R_API rsize r_str_hash (rconstpointer data);
 /**
  * @brief Hash a byte string of caller-supplied length.
  *
- * Useful when the key isn't NUL-terminated. Pass @p size = @c -1
- * for the same behaviour as @ref r_str_hash.
+ * Same function as @ref r_str_hash, for keys that aren't NUL-terminated;
+ * a string hashes identically through either entry point. Pass
+ * @p size = @c -1 for the same behaviour as @ref r_str_hash.
  */
 R_API rsize r_str_hash_sized (const rchar * data, rssize size);
+/**
+ * @brief Hash a NUL-terminated C string with keyed SipHash-2-4.
+ *
+ * Slower than @ref r_str_hash, but with a per-process random 128-bit key
+ * it is a PRF: even an attacker who observes some hash values cannot
+ * construct colliding keys. Opt in for tables keyed by untrusted input
+ * (HTTP header names, JSON object keys, SDP attributes) by passing it as
+ * the @c RHashFunc, with @ref r_str_equal.
+ */
+R_API rsize r_str_hash_keyed (rconstpointer data);
+/** @brief @ref r_str_hash_keyed for a byte string of caller-supplied length
+ * (@c -1 for NUL-terminated). */
+R_API rsize r_str_hash_keyed_sized (const rchar * data, rssize size);
+/**
+ * @brief wyhash of @p size bytes at @p data with an explicit @p seed.
+ *
+ * Deterministic: the same bytes and seed give the same value on every
+ * platform and in every process (the scalar path only), for callers that
+ * need a fast non-cryptographic digest they can reproduce.
+ */
+R_API ruint64 r_hash_bytes (rconstpointer data, rsize size, ruint64 seed);
+/**
+ * @brief SipHash-2-4 of @p size bytes at @p data under the 128-bit @p key.
+ */
+R_API ruint64 r_siphash24 (const ruint8 key[16], rconstpointer data, rsize size);
 /** @brief Equality for NUL-terminated C strings (via @c strcmp). */
 R_API rboolean r_str_equal (rconstpointer a, rconstpointer b);
 
@@ -63,6 +63,14 @@ typedef struct RHashSet RHashSet;
  */
 R_API RHashSet * r_hash_set_new_full (RHashFunc hash, REqualFunc equal,
     RDestroyNotify notify) R_ATTR_MALLOC;
+/**
+ * @brief As @ref r_hash_set_new_full, choosing the storage layout (see
+ * @ref r_hash_table_new_with_flags).
+ *
+ * @param flags  @ref RHashFlag bits.
+ */
+R_API RHashSet * r_hash_set_new_with_flags (RHashFunc hash, REqualFunc equal,
+    RDestroyNotify notify, RHashFlags flags) R_ATTR_MALLOC;
 /** @brief Increment the set's refcount. */
 #define r_hash_set_ref    r_ref_ref
 /** @brief Decrement the set's refcount; clears all entries when it reaches zero. */
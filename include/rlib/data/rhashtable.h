@@ -94,6 +94,19 @@ typedef enum {
  */
 R_API RHashTable * r_hash_table_new_full (RHashFunc hash, REqualFunc equal,
     RDestroyNotify keynotify, RDestroyNotify valuenotify) R_ATTR_MALLOC;
+/**
+ * @brief As @ref r_hash_table_new_full, choosing the storage layout.
+ *
+ * With @ref R_HASH_FLAG_GROUPED the table starts without storage and
+ * @ref r_hash_table_current_alloc_size reports slots (a multiple of 16,
+ * or 0 before the first insert); @ref r_hash_table_max_probe counts
+ * 16-slot groups. Behaviour is otherwise identical.
+ *
+ * @param flags  @ref RHashFlag bits.
+ */
+R_API RHashTable * r_hash_table_new_with_flags (RHashFunc hash, REqualFunc equal,
+    RDestroyNotify keynotify, RDestroyNotify valuenotify,
+    RHashFlags flags) R_ATTR_MALLOC;
 /** @brief Increment the table's refcount. */
 #define r_hash_table_ref    r_ref_ref
 /** @brief Decrement the table's refcount; clears all entries when it reaches zero. */
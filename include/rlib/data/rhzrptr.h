@@ -93,6 +93,23 @@ R_API void     r_hzr_ptr_release (rhzrptr * hzrptr, RHzrPtrRec * rec);
  */
 R_API void r_hzr_ptr_replace (rhzrptr * hzrptr, rpointer ptr);
 
+/**
+ * @brief Publish (or, with @c NULL, clear) a hazard on @p ptr in @p rec.
+ *
+ * The building block under @ref r_hzr_ptr_acquire for structures whose
+ * links are not @ref rhzrptr slots: load the link, protect what it points
+ * to, then re-load the link (or otherwise prove the object is still
+ * reachable) before dereferencing -- a hazard published after the object
+ * was retired protects nothing. A thread walking several objects at once
+ * holds one @ref RHzrPtrRec per object.
+ */
+R_API void r_hzr_ptr_protect (RHzrPtrRec * rec, rpointer ptr);
+/**
+ * @brief Hand @p ptr, already unlinked from every shared structure, to
+ * delayed reclamation: @p notify runs once no record holds a hazard on it.
+ */
+R_API void r_hzr_ptr_retire (rpointer ptr, RDestroyNotify notify);
+
 
 /** @brief Allocate a per-thread hazard record. */
 R_API RHzrPtrRec * r_hzr_ptr_rec_new (void);
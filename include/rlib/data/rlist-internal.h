@@ -402,15 +402,14 @@ FUNCSPECS rsize RTYPE_LOW##_foreach_remove (RTYPE ** head,                    \
     RFuncReturn func, rpointer user)                                          \
 {                                                                             \
   rsize ret = 0;                                                              \
-  RTYPE * it, * prev;                                                         \
-  for (it = *head, prev = NULL; it != NULL; prev = it, it = it->next) {       \
+  RTYPE * it, ** link;                                                        \
+  for (link = head; (it = *link) != NULL;) {                                  \
     if (func (RREF it->data, user)) {                                         \
-      if (prev != NULL)                                                       \
-        prev->next = it->next;                                                \
-      else                                                                    \
-        head = &it->next;                                                     \
+      *link = it->next;                                                       \
       RTYPE_LOW##_free1 (it);                                                 \
       ret++;                                                                  \
+    } else {                                                                  \
+      link = &it->next;                                                       \
     }                                                                         \
   }                                                                           \
   return ret;                                                                 \
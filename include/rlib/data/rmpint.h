@@ -472,6 +472,10 @@ R_API rboolean r_mpint_invmod (rmpint * dst, const rmpint * a, const rmpint * m)
  *
  * Variable-time on the exponent; not safe for secret exponents.
  * Use @ref r_mpint_expmod_ct for RSA / DSA private operations.
+ *
+ * On CPUs with AVX-512 IFMA, odd moduli from 256-bit up to the
+ * @ref R_MPINT_FE_BIG_MAX_DIGITS limit run through the same 52-bit
+ * limb kernel as @ref r_mpint_fe_big_expmod_ct.
  */
 R_API rboolean r_mpint_expmod (rmpint * dst, const rmpint * b, const rmpint * e, const rmpint * m);
 /**
@@ -868,6 +872,11 @@ R_API void r_mpint_fe_big_mod_ct (RMpintFE_Big * out, const RMpintFE_Big * a,
  *                  wanting a uniform timing profile across keys can
  *                  pass the modulus's bit length (or any constant
  *                  >= the exponent's true bit length).
+ *
+ * @note When the CPU has AVX-512 IFMA (@ref R_CPU_FEATURE_AVX512IFMA)
+ * and @p m is 256-bit or wider, the exponentiation runs on 52-bit
+ * limbs with VPMADD52LUQ / VPMADD52HUQ instead of 32-bit CIOS. The
+ * result and the constant-time properties are the same.
  */
 R_API rboolean r_mpint_fe_big_expmod_ct (rmpint * dst,
     const rmpint * base, const rmpint * exp, const rmpint * m,
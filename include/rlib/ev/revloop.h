@@ -31,6 +31,7 @@
 #include <rlib/rclock.h>
 #include <rlib/rref.h>
 #include <rlib/concurrency/rtaskqueue.h>
+#include <rlib/os/rperf.h>
 
 #include <stdarg.h>
 
@@ -96,6 +97,46 @@ R_API rsize r_ev_loop_get_iterations (const REvLoop * loop);
 /** @brief Number of registered idle callbacks. */
 R_API rsize r_ev_loop_get_idle_count (const REvLoop * loop);
 
+/**
+ * @brief Receives the counters for the last @p iterations loop iterations.
+ *
+ * Time spent blocked waiting for events costs no cycles or instructions,
+ * so the counts reflect the work the iterations did.
+ */
+typedef void (*REvLoopPerfFunc) (rpointer data, REvLoop * loop,
+    const RPerfSample * sample, rsize iterations);
+/**
+ * @brief Count @ref r_perf counters over the loop's iterations.
+ *
+ * The counters are opened for whichever thread runs the loop, the first
+ * time it runs after this call (and again should another thread take
+ * over). Every @p interval iterations they are read, added to the totals
+ * of @ref r_ev_loop_get_perf_stats and handed to @p func, if given.
+ * Sampling costs a @c read system call per sample and per
+ * @ref r_ev_loop_run, so use a larger @p interval on busy loops. Call
+ * this while the loop is not running or from the loop thread.
+ *
+ * @param mask      @ref RPerfCounter bits to count, or @c 0 to stop
+ *                  sampling (the other arguments are then ignored).
+ * @param interval  Iterations per sample, at least 1.
+ * @param func      Per-sample callback, or @c NULL to only keep totals.
+ * @return @c FALSE on invalid arguments.
+ */
+R_API rboolean r_ev_loop_set_perf_sampler (REvLoop * loop, ruint32 mask,
+    rsize interval, REvLoopPerfFunc func, rpointer data,
+    RDestroyNotify datanotify);
+/**
+ * @brief Counter totals since @ref r_ev_loop_set_perf_sampler.
+ *
+ * @param total       Receives the summed counters.
+ * @param iterations  Receives the number of iterations they cover; may
+ *                    be @c NULL.
+ * @return @c FALSE if the loop isn't sampled or no counter could be
+ *         opened.
+ */
+R_API rboolean r_ev_loop_get_perf_stats (const REvLoop * loop,
+    RPerfSample * total, rsize * iterations);
+
 /** @brief Number of task groups in the loop's task queue. */
 R_API ruint r_ev_loop_task_group_count (REvLoop * loop);
 
@@ -0,0 +1,110 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2016-2017 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+#ifndef __R_EV_RSA_SIGN_QUEUE_H__
+#define __R_EV_RSA_SIGN_QUEUE_H__
+
+#if !defined(__RLIB_H_INCLUDE_GUARD__) && !defined(RLIB_COMPILATION)
+#error "#include <rlib.h> only please."
+#endif
+
+/**
+ * @file rlib/ev/revrsasignqueue.h
+ * @brief Event-loop queue batching RSA signatures.
+ */
+
+#include <rlib/rtypes.h>
+
+#include <rlib/crypto/rrsa.h>
+#include <rlib/ev/revloop.h>
+#include <rlib/rref.h>
+
+/**
+ * @defgroup r_evrsasignqueue Event-loop RSA sign queue
+ * @ingroup r_ev
+ *
+ * @brief Gathers the RSA signatures a loop's connections ask for and
+ * signs them together with @ref r_rsa_priv_key_sign_batch.
+ *
+ * @{
+ */
+
+R_BEGIN_DECLS
+
+/**
+ * @brief Event-loop queue that collects signing requests and runs them
+ * through @ref r_rsa_priv_key_sign_batch.
+ *
+ * Connections served by one @ref REvLoop push their digests as they
+ * arrive; the queue flushes them as one batch from a callback at the end
+ * of the current loop iteration, or immediately once a full batch of
+ * eight is waiting. Completion is reported through each request's
+ * @ref RRsaSignDoneFunc on the loop thread. The queue is not
+ * thread-safe; use one per loop.
+ */
+typedef struct RRsaSignQueue RRsaSignQueue;
+
+/**
+ * @brief Completion callback for @ref r_rsa_sign_queue_push.
+ *
+ * @p sig is only valid for the duration of the call.
+ */
+typedef void (*RRsaSignDoneFunc) (rpointer data, RCryptoResult res,
+    const ruint8 * sig, rsize sigsize);
+
+/**
+ * @brief Create a signing queue for @p key on @p loop.
+ *
+ * @param key Private RSA key; the queue holds a reference.
+ * @param prng PRNG for PSS salts and blinding, or @c NULL to create one.
+ * @param loop Loop whose iterations delimit a batch; the queue holds a
+ *   reference.
+ */
+R_API RRsaSignQueue * r_rsa_sign_queue_new (RCryptoKey * key, RPrng * prng,
+    REvLoop * loop) R_ATTR_MALLOC;
+/** @brief Increment the queue's refcount. */
+#define r_rsa_sign_queue_ref    r_ref_ref
+/** @brief Decrement the refcount; requests still queued are failed with
+ * @c R_CRYPTO_ERROR before the queue goes away. */
+#define r_rsa_sign_queue_unref  r_ref_unref
+
+/**
+ * @brief Queue one digest for signing.
+ *
+ * @p hash is copied. @p done runs exactly once, from the flush that
+ * signs the request, and @p datanotify (if set) is called on @p data
+ * afterwards. When this push completes a full batch, that flush happens
+ * before the function returns.
+ *
+ * @return @c FALSE (without calling @p done) on bad arguments.
+ */
+R_API rboolean r_rsa_sign_queue_push (RRsaSignQueue * queue,
+    RMsgDigestType mdtype, rconstpointer hash, rsize hashsize,
+    RRsaSignDoneFunc done, rpointer data, RDestroyNotify datanotify);
+
+/**
+ * @brief Sign everything queued now instead of waiting for the loop.
+ *
+ * @return The number of requests completed.
+ */
+R_API rsize r_rsa_sign_queue_flush (RRsaSignQueue * queue);
+
+R_END_DECLS
+
+/** @} */
+
+#endif /* __R_EV_RSA_SIGN_QUEUE_H__ */
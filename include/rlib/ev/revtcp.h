@@ -35,6 +35,7 @@
 #include <rlib/rbuffer.h>
 #include <rlib/net/rsocketaddress.h>
 #include <rlib/net/rsocket.h>
+#include <rlib/net/proto/rtls.h>
 #include <rlib/rref.h>
 
 /**
@@ -63,6 +64,13 @@ typedef RBuffer * (*REvTCPBufferAllocFunc) (rpointer data, REvTCP * evtcp);
  * error handler is installed — a receive error).
  */
 typedef void (*REvTCPBufferFunc) (rpointer data, RBuffer * buf, REvTCP * evtcp);
+/**
+ * @brief Deliver one record of content @p type opened by kernel TLS (see
+ * @ref r_ev_tcp_set_ktls_rx). End-of-stream still arrives through the
+ * @ref REvTCPBufferFunc given to @ref r_ev_tcp_recv_start.
+ */
+typedef void (*REvTCPRecordFunc) (rpointer data, RTLSContentType type,
+    RBuffer * buf, REvTCP * evtcp);
 /** @brief Connection-attempt result; @p status is 0 on success. */
 typedef void (*REvTCPConnectedFunc) (rpointer data, REvTCP * evtcp, int status);
 /** @brief Fired on a listening socket when a new connection @p newtcp is ready. */
@@ -196,6 +204,49 @@ R_API rboolean r_ev_tcp_send_take (REvTCP * evtcp, rpointer buffer, rsize size,
 /** @brief Send a copy of @p size bytes from @p buffer. */
 R_API rboolean r_ev_tcp_send_dup (REvTCP * evtcp, rconstpointer buffer, rsize size,
     REvTCPBufferFunc done, rpointer data, RDestroyNotify datanotify);
+/**
+ * @brief Send @p size bytes of @p file from @p offset, in order with the
+ * other sends, without copying them through user space (see
+ * @ref r_socket_send_file). Kernel TLS, if on, seals them as they go.
+ *
+ * @p file must stay open until @p done fires, with a @c NULL buffer. Returns
+ * @c FALSE where the platform can't queue it; the connection fails with an
+ * error if the file turns out to be unusable or shorter than @p size.
+ */
+R_API rboolean r_ev_tcp_send_file (REvTCP * evtcp, RIOHandle file,
+    ruint64 offset, rsize size,
+    REvTCPBufferFunc done, rpointer data, RDestroyNotify datanotify);
+
+/**
+ * @brief Have the kernel seal everything sent from now on (see @ref r_ktls).
+ *
+ * The first call requires every queued send to reach the socket first; what
+ * cannot be flushed right away makes it return @ref R_SOCKET_WOULD_BLOCK with
+ * nothing changed, so the caller can retry once the queue has drained.
+ * @ref R_SOCKET_NOT_SUPPORTED likewise leaves the connection as it was. Once
+ * installed, a further call rekeys after the sends already queued; the
+ * connection fails with an error if the kernel then refuses it.
+ */
+R_API RSocketStatus r_ev_tcp_set_ktls_tx (REvTCP * evtcp,
+    const RTLSTrafficKeys * keys);
+/**
+ * @brief Have the kernel open every record read from now on (see @ref r_ktls).
+ *
+ * Must be called between records: right after the receive callback consumed
+ * the last whole record, with nothing of the next one read yet. From then on
+ * each opened record goes to @p record instead of the receive callback, with
+ * the @c recv_start data. A further call (after a KeyUpdate) installs new keys
+ * for what follows. @ref R_SOCKET_NOT_SUPPORTED leaves the connection as it
+ * was, so the caller can keep opening records itself.
+ */
+R_API RSocketStatus r_ev_tcp_set_ktls_rx (REvTCP * evtcp,
+    const RTLSTrafficKeys * keys, REvTCPRecordFunc record);
+/**
+ * @brief Queue @p buf as one record of content @p type on a connection set up
+ * with @ref r_ev_tcp_set_ktls_tx, in order with plain sends.
+ */
+R_API rboolean r_ev_tcp_send_ktls_record (REvTCP * evtcp, RTLSContentType type,
+    RBuffer * buf, REvTCPBufferFunc done, rpointer data, RDestroyNotify datanotify);
 
 R_END_DECLS
 
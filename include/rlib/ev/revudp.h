@@ -60,6 +60,8 @@ typedef RBuffer * (*REvUDPBufferAllocFunc) (rpointer data, REvUDP * evudp);
 typedef void (*REvUDPBufferFunc) (rpointer data, RBuffer * buf, RSocketAddress * addr, REvUDP * evudp);
 /** @brief Fired on an asynchronous socket error; @p error is the failing @ref RSocketStatus. */
 typedef void (*REvUDPErrorFunc) (rpointer data, REvUDP * evudp, RSocketStatus error);
+/** @brief Deliver @p count received datagrams; entries are only valid during the call. */
+typedef void (*REvUDPBatchFunc) (rpointer data, RSocketDatagram * dgrams, rsize count, REvUDP * evudp);
 
 /** @brief Create a UDP socket of @p family on @p loop. */
 R_API REvUDP * r_ev_udp_new (RSocketFamily family, REvLoop * loop);
@@ -82,6 +84,17 @@ R_API RSocketAddress * r_ev_udp_get_local_address (const REvUDP * evudp);
 R_API rboolean r_ev_udp_recv_start (REvUDP * evudp,
     REvUDPBufferAllocFunc alloc, REvUDPBufferFunc recv,
     rpointer data, RDestroyNotify datanotify);
+/**
+ * @brief Start receiving datagrams in batches (@c recvmmsg where available).
+ *
+ * Each readiness event drains the socket into @p dgrams, @p count at a time,
+ * and hands every filled batch to @p recv. The caller owns @p dgrams (buffers
+ * and addresses) and keeps it alive until receiving stops; as callbacks on a
+ * loop never nest, sockets on the same loop may share one array.
+ */
+R_API rboolean r_ev_udp_recv_batch_start (REvUDP * evudp,
+    RSocketDatagram * dgrams, rsize count, REvUDPBatchFunc recv,
+    rpointer data, RDestroyNotify datanotify);
 /** @brief Stop receiving. */
 R_API rboolean r_ev_udp_recv_stop (REvUDP * evudp);
 /**
@@ -107,6 +120,19 @@ R_API rboolean r_ev_udp_send (REvUDP * evudp, RBuffer * buf,
 R_API rboolean r_ev_udp_send_take (REvUDP * evudp, rpointer buffer, rsize size,
     RSocketAddress * address, REvUDPBufferFunc done,
     rpointer data, RDestroyNotify datanotify);
+/**
+ * @brief Send @p count datagrams now, with as few syscalls as possible
+ * (@c sendmmsg where available).
+ *
+ * Nothing in @p dgrams is referenced after the call: datagrams that can't
+ * leave immediately (the socket would block, or earlier sends are still
+ * queued) are copied onto the send queue, and a datagram that fails is
+ * dropped and reported to the error handler.
+ *
+ * @return @c FALSE if a datagram could not be queued.
+ */
+R_API rboolean r_ev_udp_send_batch (REvUDP * evudp,
+    RSocketDatagram * dgrams, rsize count);
 
 R_END_DECLS
 
@@ -0,0 +1,115 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2018 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+#ifndef __R_JSON_READER_H__
+#define __R_JSON_READER_H__
+
+/**
+ * @file rlib/format/rjsonreader.h
+ * @brief Incremental reader for newline-delimited / concatenated JSON.
+ */
+
+#include <rlib/rtypes.h>
+#include <rlib/rref.h>
+
+#include <rlib/rbuffer.h>
+#include <rlib/format/rjson.h>
+#include <rlib/format/rjsontape.h>
+
+/**
+ * @defgroup r_json_reader JSON stream reader
+ * @ingroup r_json
+ *
+ * @brief Split a stream of JSON documents into records as bytes arrive.
+ *
+ * Feed chunks in any size with @ref r_json_reader_push_buffer (for
+ * example straight from a @c REvTCP receive callback or successive
+ * @c RFile reads) and the reader calls back once per complete
+ * top-level document, parsed into an @ref RJsonTape. Documents may be
+ * separated by newlines (NDJSON / JSON Lines), by any whitespace, or
+ * not at all (@c {"a":1}{"a":2}).
+ *
+ * Every input byte is scanned once for the record boundary. A record
+ * that lies within one pushed chunk is parsed in place and its tape
+ * keeps that chunk alive; only a record straddling chunks is copied,
+ * so the reader itself never holds more than one partial record.
+ * Records larger than the limit set with
+ * @ref r_json_reader_set_max_record_size are reported as
+ * @ref R_JSON_OUT_OF_RANGE and skipped.
+ *
+ * A record that fails to parse is reported to the callback with a
+ * @c NULL tape and reading carries on with the next one.
+ *
+ * @{
+ */
+
+R_BEGIN_DECLS
+
+/** @brief Opaque, refcounted reader. */
+typedef struct RJsonReader RJsonReader;
+/** @brief Take a reference (alias for @ref r_ref_ref). */
+#define r_json_reader_ref    r_ref_ref
+/** @brief Drop a reference (alias for @ref r_ref_unref). */
+#define r_json_reader_unref  r_ref_unref
+
+/**
+ * @brief Per-record callback.
+ *
+ * @p tape is borrowed for the duration of the call (take a reference
+ * to keep it); it is @c NULL when @p res is not @ref R_JSON_OK.
+ */
+typedef void (*RJsonReaderFunc) (rpointer data, RJsonTape * tape,
+    RJsonResult res, RJsonReader * reader);
+
+/** @brief Default for @ref r_json_reader_set_max_record_size (16 MiB). */
+#define R_JSON_READER_DEFAULT_MAX_RECORD_SIZE   (16 * 1024 * 1024)
+
+/** @brief Create a reader calling @p func for every record. */
+R_API RJsonReader * r_json_reader_new (RJsonReaderFunc func, rpointer data,
+    RDestroyNotify notify);
+/** @brief Limit the size of one record (0: no limit). */
+R_API void r_json_reader_set_max_record_size (RJsonReader * reader, rsize size);
+
+/**
+ * @brief Feed the next chunk; callbacks run before this returns.
+ *
+ * @return @ref R_JSON_OK, or @ref R_JSON_INVAL / @ref R_JSON_MAP_FAILED /
+ * @ref R_JSON_OOM when the chunk itself could not be consumed. Errors
+ * in individual records go to the callback instead.
+ */
+R_API RJsonResult r_json_reader_push_buffer (RJsonReader * reader, RBuffer * buf);
+/** @brief Like @ref r_json_reader_push_buffer, copying @p size bytes at @p data. */
+R_API RJsonResult r_json_reader_push (RJsonReader * reader, rconstpointer data, rsize size);
+/**
+ * @brief Signal the end of the stream.
+ *
+ * Flushes a final top-level scalar that had no trailing delimiter. An
+ * unfinished record is reported as @ref R_JSON_END, which is also
+ * returned. The reader can be reused for a new stream afterwards.
+ */
+R_API RJsonResult r_json_reader_end (RJsonReader * reader);
+
+/** @brief Records passed to the callback so far (including failed ones). */
+R_API ruint64 r_json_reader_get_record_count (const RJsonReader * reader);
+/** @brief Bytes of the partial record currently held by the reader. */
+R_API rsize r_json_reader_get_pending_size (const RJsonReader * reader);
+
+R_END_DECLS
+
+/** @} */
+
+#endif /* __R_JSON_READER_H__ */
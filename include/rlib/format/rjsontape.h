@@ -0,0 +1,152 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2018 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+#ifndef __R_JSON_TAPE_H__
+#define __R_JSON_TAPE_H__
+
+/**
+ * @file rlib/format/rjsontape.h
+ * @brief Immutable, arena-backed JSON DOM stored as a flat tape.
+ */
+
+#include <rlib/rtypes.h>
+#include <rlib/rref.h>
+
+#include <rlib/rbuffer.h>
+#include <rlib/format/rjson.h>
+#include <rlib/format/rjsonparser.h>
+
+/**
+ * @defgroup r_json_tape JSON tape
+ * @ingroup r_json
+ *
+ * @brief Read-only JSON document parsed into a single tape.
+ *
+ * Where the @ref r_json tree allocates one refcounted node per value,
+ * a @ref RJsonTape holds the whole document as one array of tagged
+ * 64 bit words: containers record where they end and how many entries
+ * they hold, numbers are stored parsed, and strings are views into the
+ * source bytes. Only strings containing escapes are copied (unescaped)
+ * into the tape's own arena. Parsing a document costs a handful of
+ * allocations regardless of its size.
+ *
+ * Values are addressed with @ref RJsonTapeValue handles, small structs
+ * passed by value that stay valid as long as the tape does. The
+ * accessors mirror the @c r_json_value_get_* family; strings are
+ * returned with their length and are @b not NUL-terminated. The tape
+ * keeps the source @c RBuffer alive; a tape from @ref r_json_tape_parse
+ * borrows the caller's memory instead.
+ *
+ * Only whitespace may follow the top-level value.
+ *
+ * @{
+ */
+
+R_BEGIN_DECLS
+
+/** @brief Opaque, refcounted tape document. */
+typedef struct RJsonTape RJsonTape;
+/** @brief Take a reference (alias for @ref r_ref_ref). */
+#define r_json_tape_ref    r_ref_ref
+/** @brief Drop a reference (alias for @ref r_ref_unref). */
+#define r_json_tape_unref  r_ref_unref
+
+/**
+ * @brief Handle of one value on a tape.
+ *
+ * A handle with a @c NULL @c tape is invalid (field not found, index
+ * out of range, wrong type); every accessor accepts it and returns the
+ * empty result.
+ */
+typedef struct {
+  const RJsonTape * tape;   /**< Owning tape, @c NULL when invalid. */
+  rsize idx;                /**< Word index of the value. */
+} RJsonTapeValue;
+/** @brief Initialiser for an invalid @ref RJsonTapeValue. */
+#define R_JSON_TAPE_VALUE_INIT    { NULL, 0 }
+
+/** @name Parse
+ *  @{ */
+/**
+ * @brief Parse @p len bytes at @p data into a tape.
+ *
+ * The tape borrows @p data: keep it alive and unmodified while the
+ * tape or any string returned from it is in use.
+ */
+R_API RJsonTape * r_json_tape_parse (rconstpointer data, rsize len, RJsonResult * res);
+/** @brief Parse @p buf into a tape holding a reference to @p buf. */
+R_API RJsonTape * r_json_tape_parse_buffer (RBuffer * buf, RJsonResult * res);
+/** @brief Parse the parser's whole input into a tape (tape counterpart of
+ *  @ref r_json_parser_parse_all). */
+R_API RJsonTape * r_json_parser_parse_tape (RJsonParser * parser, RJsonResult * res);
+/** @} */
+
+/** @name Tape
+ *  @{ */
+/** @brief The top-level value. */
+R_API RJsonTapeValue r_json_tape_get_root (const RJsonTape * tape);
+/** @brief Bytes held by the tape and its string arena (excluding the source). */
+R_API rsize r_json_tape_get_memory_size (const RJsonTape * tape);
+/** @} */
+
+/** @name Accessors
+ *  @{ */
+/** @brief Type of @p value, @ref R_JSON_TYPE_NONE when invalid. */
+R_API RJsonType r_json_tape_value_get_type (RJsonTapeValue value);
+/** @brief Number of fields in an object. */
+R_API rsize r_json_tape_value_get_object_field_count (RJsonTapeValue value);
+/** @brief The @p idx-th field name (@p len receives its size). */
+R_API const rchar * r_json_tape_value_get_object_field_name (RJsonTapeValue value,
+    rsize idx, rsize * len);
+/** @brief The @p idx-th field value. */
+R_API RJsonTapeValue r_json_tape_value_get_object_field_value (RJsonTapeValue value, rsize idx);
+/** @brief Look up a field by NUL-terminated name; the first match wins. */
+R_API RJsonTapeValue r_json_tape_value_get_object_field (RJsonTapeValue value, const rchar * key);
+/**
+ * @brief Iterate every field.
+ *
+ * @p func is called with a @c const @ref RStrChunk * key and a
+ * @c const @ref RJsonTapeValue * value.
+ */
+R_API void r_json_tape_value_foreach_object_field (RJsonTapeValue value,
+    RKeyValueFunc func, rpointer user);
+/** @brief Number of values in an array. */
+R_API rsize r_json_tape_value_get_array_size (RJsonTapeValue value);
+/** @brief The @p idx-th array entry (linear in @p idx; prefer foreach to walk). */
+R_API RJsonTapeValue r_json_tape_value_get_array_value (RJsonTapeValue value, rsize idx);
+/** @brief Iterate every array entry; @p func gets a @c const @ref RJsonTapeValue *. */
+R_API void r_json_tape_value_foreach_array_value (RJsonTapeValue value,
+    RFunc func, rpointer user);
+/** @brief A number truncated to @c int. */
+R_API int r_json_tape_value_get_number_int (RJsonTapeValue value);
+/** @brief A number as @c double. */
+R_API rdouble r_json_tape_value_get_number_double (RJsonTapeValue value);
+/** @brief A string's unescaped contents (@p len receives its size). */
+R_API const rchar * r_json_tape_value_get_string (RJsonTapeValue value, rsize * len);
+/** @brief @c TRUE for @c true. */
+R_API rboolean r_json_tape_value_is_true (RJsonTapeValue value);
+/** @brief @c TRUE for @c false. */
+R_API rboolean r_json_tape_value_is_false (RJsonTapeValue value);
+/** @brief @c TRUE for @c null. */
+R_API rboolean r_json_tape_value_is_null (RJsonTapeValue value);
+/** @} */
+
+R_END_DECLS
+
+/** @} */
+
+#endif /* __R_JSON_TAPE_H__ */
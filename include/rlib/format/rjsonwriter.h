@@ -0,0 +1,140 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2018 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+#ifndef __R_JSON_WRITER_H__
+#define __R_JSON_WRITER_H__
+
+/**
+ * @file rlib/format/rjsonwriter.h
+ * @brief Push-style JSON writer producing output without a value tree.
+ */
+
+#include <rlib/rtypes.h>
+
+#include <rlib/rbuffer.h>
+#include <rlib/data/rstring.h>
+#include <rlib/format/rjson.h>
+
+/**
+ * @defgroup r_json_writer JSON writer
+ * @ingroup r_json
+ *
+ * @brief Emit JSON token by token straight into an @c RString or an
+ * @c RBuffer.
+ *
+ * The writer lives on the stack and needs no allocations of its own:
+ * output is staged in a window that is flushed into the target as it
+ * fills. An @c RString target is appended to; an @c RBuffer target
+ * receives a chain of fixed-size segments, so earlier output is never
+ * copied or reallocated.
+ *
+ * @code
+ * RJsonWriter w;
+ * r_json_writer_init_buffer (&w, buf, 0, R_JSON_COMPACT);
+ * r_json_writer_begin_object (&w);
+ * r_json_writer_key (&w, "id", -1);
+ * r_json_writer_int (&w, 42);
+ * r_json_writer_end_object (&w);
+ * res = r_json_writer_finish (&w);
+ * @endcode
+ *
+ * Formatting follows @ref r_json_value_to_buffer for the same
+ * @ref RJsonFlags. Strings are escaped like @ref r_json_str_escape,
+ * so control characters and all non-ASCII become \\uXXXX (UTF-16, with
+ * surrogate pairs), and malformed UTF-8 fails with
+ * R_JSON_FAILED_TO_UNESCAPE_STRING. Integral numbers are
+ * written as integers; other doubles use the shortest of up to 17
+ * significant digits that reads back to the same value.
+ *
+ * Every call returns the writer's result. The first error (misplaced
+ * key or value, unbalanced end, allocation failure) sticks and makes
+ * every later call a no-op returning it.
+ *
+ * @{
+ */
+
+R_BEGIN_DECLS
+
+/** @brief Deepest container nesting a writer accepts. */
+#define R_JSON_WRITER_MAX_DEPTH           64
+/** @brief Size of the staging window used for @c RString targets. */
+#define R_JSON_WRITER_WINDOW_SIZE         2048
+/** @brief Default segment size for @c RBuffer targets. */
+#define R_JSON_WRITER_DEFAULT_SEGMENT     (16 * 1024)
+
+/** @brief Writer state; treat the fields as private. */
+typedef struct {
+  RString * str;
+  RBuffer * buf;
+  rsize segsize;
+  rchar * base, * ptr, * end;
+  RJsonFlags flags;
+  RJsonResult res;
+  ruint depth;
+  rboolean haskey;
+  rboolean done;
+  rchar kind[R_JSON_WRITER_MAX_DEPTH];
+  rboolean nonempty[R_JSON_WRITER_MAX_DEPTH];
+  rchar window[R_JSON_WRITER_WINDOW_SIZE];
+} RJsonWriter;
+
+/** @brief Start writing, appending to @p str. */
+R_API void r_json_writer_init_string (RJsonWriter * writer, RString * str, RJsonFlags flags);
+/**
+ * @brief Start writing, appending segments of @p segsize bytes to @p buf
+ * (0: @ref R_JSON_WRITER_DEFAULT_SEGMENT).
+ */
+R_API void r_json_writer_init_buffer (RJsonWriter * writer, RBuffer * buf,
+    rsize segsize, RJsonFlags flags);
+/**
+ * @brief Flush pending output and release the writer's resources.
+ *
+ * Must be called once for every init, also after an error.
+ * @return @ref R_JSON_OK once exactly one complete top-level value
+ * was written, @ref R_JSON_END if it is unfinished, or the first error.
+ */
+R_API RJsonResult r_json_writer_finish (RJsonWriter * writer);
+
+/** @brief Open an object. */
+R_API RJsonResult r_json_writer_begin_object (RJsonWriter * writer);
+/** @brief Close the innermost object. */
+R_API RJsonResult r_json_writer_end_object (RJsonWriter * writer);
+/** @brief Open an array. */
+R_API RJsonResult r_json_writer_begin_array (RJsonWriter * writer);
+/** @brief Close the innermost array. */
+R_API RJsonResult r_json_writer_end_array (RJsonWriter * writer);
+/** @brief Write an object field name (@p len -1: NUL-terminated). */
+R_API RJsonResult r_json_writer_key (RJsonWriter * writer, const rchar * key, rssize len);
+
+/** @brief Write a string value (@p len -1: NUL-terminated). */
+R_API RJsonResult r_json_writer_string (RJsonWriter * writer, const rchar * str, rssize len);
+/** @brief Write an integer value. */
+R_API RJsonResult r_json_writer_int (RJsonWriter * writer, rint64 value);
+/** @brief Write a number; NaN and infinities are rejected with @ref R_JSON_INVAL. */
+R_API RJsonResult r_json_writer_double (RJsonWriter * writer, rdouble value);
+/** @brief Write @c true or @c false. */
+R_API RJsonResult r_json_writer_bool (RJsonWriter * writer, rboolean value);
+/** @brief Write @c null. */
+R_API RJsonResult r_json_writer_null (RJsonWriter * writer);
+/** @brief Write a whole value tree at the current position. */
+R_API RJsonResult r_json_writer_value (RJsonWriter * writer, const RJsonValue * value);
+
+R_END_DECLS
+
+/** @} */
+
+#endif /* __R_JSON_WRITER_H__ */
@@ -32,6 +32,7 @@
 
 #include <rlib/rbuffer.h>
 #include <rlib/rref.h>
+#include <rlib/rtime.h>
 
 /**
  * @defgroup r_rtp RTP
@@ -169,6 +170,17 @@ R_API rboolean r_rtp_buffer_has_extension (const RRTPBuffer * rtp);
 R_API rboolean r_rtp_buffer_get_extension (const RRTPBuffer * rtp, ruint16 * profile, const ruint8 ** data, ruint16 * size);
 /** @brief @c TRUE if the marker bit is set. */
 R_API rboolean r_rtp_buffer_has_marker (const RRTPBuffer * rtp);
+/**
+ * @brief Locate the RFC 8285 header-extension element with id @p id.
+ * @param rtp   The mapped RTP buffer.
+ * @param id    Element id (1..14 for the one-byte @c 0xBEDE profile, 1..255
+ *              for the two-byte @c 0x100x profile).
+ * @param data  Out: pointer to the element value, inside the mapping.
+ * @param size  Out: element value size in bytes.
+ * @return @c TRUE if the element is present, else @c FALSE.
+ */
+R_API rboolean r_rtp_buffer_get_hdrext_element (const RRTPBuffer * rtp,
+    ruint8 id, ruint8 ** data, rsize * size);
 /** @brief Return the synchronisation source (SSRC) identifier. */
 R_API ruint32 r_rtp_buffer_get_ssrc (const RRTPBuffer * rtp);
 /** @brief Return the payload type. */
@@ -197,6 +209,34 @@ R_API void r_rtp_buffer_set_timestamp (RRTPBuffer * rtp, ruint32 ts);
 R_API rboolean r_rtp_buffer_set_csrc (RRTPBuffer * rtp, ruint8 n, ruint32 csrc);
 
 
+/* Transport-wide sequence numbers (draft-holmer-rmcat-transport-wide-cc-
+ * extensions-01): a 16-bit counter shared by every stream on a transport,
+ * carried in a two-octet RFC 8285 element and echoed back in TWCC feedback. */
+/** @brief URI of the transport-wide sequence number header extension. */
+#define R_RTP_HDREXT_TRANSPORT_CC     "http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01"
+/** @brief Size of a one-byte (@c 0xBEDE) extension body holding just the transport-cc element. */
+#define R_RTP_TRANSPORT_CC_EXT_SIZE   4
+
+/**
+ * @brief Write a one-byte-header extension body carrying a transport-cc element.
+ * @param ext  Output; @c R_RTP_TRANSPORT_CC_EXT_SIZE bytes, for use as the
+ *             @p extdata of @ref r_buffer_new_rtp_buffer_ext with profile @c 0xBEDE.
+ * @param id   Negotiated element id (1..14).
+ * @param seq  Transport-wide sequence number.
+ * @return @c FALSE if @p id doesn't fit the one-byte form.
+ */
+R_API rboolean r_rtp_transport_cc_ext_write (ruint8 * ext, ruint8 id, ruint16 seq);
+/** @brief Read the transport-wide sequence number from element @p id into @p seq. */
+R_API rboolean r_rtp_buffer_get_transport_cc (const RRTPBuffer * rtp, ruint8 id, ruint16 * seq);
+/**
+ * @brief Overwrite the transport-wide sequence number carried in element @p id.
+ *
+ * The element must already be present (with a placeholder value) and @p rtp
+ * mapped with @c R_MEM_MAP_WRITE; senders stamp the number as late as possible
+ * so it follows the actual order packets leave the transport.
+ */
+R_API rboolean r_rtp_buffer_set_transport_cc (RRTPBuffer * rtp, ruint8 id, ruint16 seq);
+
 /** @brief Extend a 16-bit sequence number @p seq to a 48-bit index, given the current index @p curidx. */
 R_API ruint64 r_rtp_estimate_seq_idx (ruint16 seq, ruint64 curidx);
 /** @brief Extend @p rtp's sequence number to a 48-bit index, given the current index @p curidx. */
@@ -497,6 +537,7 @@ typedef enum {
   R_RTCP_RTPFB_FMT_NACK   = 1,    /**< Generic NACK (RFC 4585). */
   R_RTCP_RTPFB_FMT_TMMBR  = 3,    /**< Temporary Max Media Bitrate Request (RFC 5104). */
   R_RTCP_RTPFB_FMT_TMMBN  = 4,    /**< Temporary Max Media Bitrate Notification (RFC 5104). */
+  R_RTCP_RTPFB_FMT_TWCC   = 15,   /**< Transport-wide congestion control feedback. */
 } RRTCPRTPFBType;
 
 /** @brief Payload-specific (PSFB) feedback message type. */
@@ -521,6 +562,60 @@ R_API ruint32 r_rtcp_packet_fb_get_media_ssrc (const RRTCPPacket * packet);
 R_API const ruint8 * r_rtcp_packet_fb_get_fci (const RRTCPPacket * packet, ruint16 * size);
 
 
+/* Transport-wide congestion control feedback -- RTPFB FMT 15
+ * (draft-holmer-rmcat-transport-wide-cc-extensions-01).  The FCI reports,
+ * for a run of transport-wide sequence numbers starting at a base, whether
+ * each packet arrived and when: a 24-bit reference time in 64 ms units,
+ * then run-length / status-vector chunks and 250 us receive deltas.
+ *
+ * Arrival times are exchanged as @ref RClockTime on the receiver's clock,
+ * reduced modulo 2^24 reference-time units; only their differences carry
+ * meaning to the sender.  @c R_CLOCK_TIME_NONE marks a packet not received. */
+/** @brief Resolution of a TWCC receive delta. */
+#define R_RTCP_TWCC_DELTA_UNIT    (250 * R_USECOND)
+/** @brief Resolution of a TWCC reference time. */
+#define R_RTCP_TWCC_REF_UNIT      (64 * R_MSECOND)
+
+/** @brief Decoded fixed part of a TWCC feedback packet. */
+typedef struct {
+  ruint16 base_seq;   /**< @brief Transport-wide sequence number of the first reported packet. */
+  ruint16 count;      /**< @brief Number of reported packets (packet status count). */
+  ruint32 reftime;    /**< @brief Reference time, in @c R_RTCP_TWCC_REF_UNIT (24 bits). */
+  ruint8 fbcount;     /**< @brief Feedback packet counter (wraps at 256). */
+} RRTCPTWCCInfo;
+
+/**
+ * @brief Append a TWCC feedback packet.
+ * @param buf       Compound RTCP buffer to append to.
+ * @param sender    SSRC of the feedback sender.
+ * @param media     SSRC of the media source.
+ * @param fbcount   Feedback packet counter.
+ * @param base_seq  Transport-wide sequence number of @p arrival[0].
+ * @param arrival   Arrival time per packet, @c R_CLOCK_TIME_NONE if lost.
+ * @param count     Number of entries in @p arrival (>= 1).
+ * @return @c TRUE on success; @c FALSE on bad arguments, or if two
+ *         consecutive arrivals are further apart than a 16-bit delta can
+ *         express (about 8 s) -- split the report there.
+ */
+R_API rboolean r_rtcp_buffer_add_twcc (RBuffer * buf, ruint32 sender,
+    ruint32 media, ruint8 fbcount, ruint16 base_seq,
+    const RClockTime * arrival, ruint16 count);
+/** @brief Decode the fixed part of a TWCC @p packet into @p info. */
+R_API rboolean r_rtcp_packet_twcc_get_info (const RRTCPPacket * packet,
+    RRTCPTWCCInfo * info);
+/**
+ * @brief Decode the per-packet arrival times of a TWCC @p packet.
+ * @param packet   The RTPFB FMT 15 packet.
+ * @param arrival  Out: @p len entries; receives the @c count reported
+ *                 arrivals (@c R_CLOCK_TIME_NONE for lost packets).
+ * @param len      Capacity of @p arrival.
+ * @return Parse result; @c R_RTCP_PARSE_BUF_TOO_SMALL if @p len is below the
+ *         packet status count.
+ */
+R_API RRTCPParseResult r_rtcp_packet_twcc_get_arrivals (const RRTCPPacket * packet,
+    RClockTime * arrival, rsize len);
+
+
 /* Extended Report (XR) -- RFC 3611.  The RTCP header is followed by the
  * reporter SSRC (@ref r_rtcp_packet_get_ssrc) and a sequence of report blocks,
  * each a 1-octet block type, a type-specific octet, a 16-bit block length and
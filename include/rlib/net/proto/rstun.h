@@ -30,6 +30,7 @@
 
 #include <rlib/rtypes.h>
 
+#include <rlib/crypto/rhmac.h>
 #include <rlib/net/rsocketaddress.h>
 
 /**
@@ -47,6 +48,11 @@
  * caller buffer: @ref r_stun_msg_begin, add attributes, then
  * @ref r_stun_msg_end (optionally appending a FINGERPRINT).
  *
+ * Hot paths keyed by the same credential over and over (ICE
+ * connectivity checks and keepalives) should key an @ref RHmac once
+ * and use the @c _hmac integrity variants, or an
+ * @ref RStunBindingResponder for Binding success responses.
+ *
  * @{
  */
 
@@ -276,6 +282,9 @@ R_API rboolean r_stun_msg_add_xor_address (RStunMsgCtx * ctx,
 /** @brief Append a short-term-credential MESSAGE-INTEGRITY attribute keyed by @p key. */
 R_API rboolean r_stun_msg_add_message_integrity_short_cred (RStunMsgCtx * ctx,
     rconstpointer key, rsize keysize);
+/** @brief Append a MESSAGE-INTEGRITY attribute using the pre-keyed HMAC-SHA1 @p hmac (reset first). */
+R_API rboolean r_stun_msg_add_message_integrity_hmac (RStunMsgCtx * ctx,
+    RHmac * hmac);
 /** @brief Append an ERROR-CODE attribute with numeric @p code and optional @p reason. */
 R_API rboolean r_stun_msg_add_error_code (RStunMsgCtx * ctx, ruint code,
     const rchar * reason);
@@ -323,6 +332,9 @@ R_API ruint r_stun_attr_tlv_parse_error_code (rconstpointer buf, const RStunAttr
 /** @brief Verify a short-term-credential MESSAGE-INTEGRITY against @p key. */
 R_API rboolean r_stun_msg_check_integrity_short_cred (rconstpointer buf,
     const RStunAttrTLV * tlv, rconstpointer key, rsize keysize);
+/** @brief Verify MESSAGE-INTEGRITY against the pre-keyed HMAC-SHA1 @p hmac (reset first). */
+R_API rboolean r_stun_msg_check_integrity_hmac (rconstpointer buf,
+    const RStunAttrTLV * tlv, RHmac * hmac);
 /** @brief Compute the FINGERPRINT (CRC-32 XOR @ref R_STUN_FINGERPRINT_XOR) over @p buf. */
 R_API ruint32 r_stun_msg_calc_fingerprint (rconstpointer buf,
     const RStunAttrTLV * tlv);
@@ -331,6 +343,44 @@ R_API ruint32 r_stun_msg_calc_fingerprint (rconstpointer buf,
   (r_stun_msg_calc_fingerprint (buf, tlv) == RUINT32_FROM_BE (*(ruint32 *)((tlv)->value)))
 /** @} */
 
+/** @name Binding response fast path
+ *  Binding success responses to one credential differ only in the
+ *  transaction ID and XOR-MAPPED-ADDRESS. An @ref RStunBindingResponder
+ *  keeps a pre-laid-out response per address family and an HMAC with the
+ *  key pads already absorbed, so building one is a copy, two patches,
+ *  one HMAC-SHA1 over the message and the FINGERPRINT CRC.
+ *  @{ */
+/** @brief Largest response built by @ref r_stun_binding_responder_build (IPv6). */
+#define R_STUN_BINDING_RESPONSE_MAX_SIZE    76
+
+/** @brief Opaque Binding success response builder for one credential. */
+typedef struct RStunBindingResponder RStunBindingResponder;
+
+/** @brief Create a responder signing with short-term credential @p key. */
+R_API RStunBindingResponder * r_stun_binding_responder_new (rconstpointer key,
+    rsize keysize) R_ATTR_MALLOC;
+/** @brief Free @p resp and wipe its keyed state; @p resp may be @c NULL. */
+R_API void r_stun_binding_responder_free (RStunBindingResponder * resp);
+/**
+ * @brief Write a Binding success response to @p buf.
+ * @param resp            The responder.
+ * @param buf             Destination, at least @ref R_STUN_BINDING_RESPONSE_MAX_SIZE bytes.
+ * @param size            Capacity of @p buf.
+ * @param transaction_id  The request's transaction ID.
+ * @param addr            Reflexive address for XOR-MAPPED-ADDRESS.
+ * @return Response size, identical to what @ref r_stun_msg_begin,
+ *         @ref r_stun_msg_add_xor_address,
+ *         @ref r_stun_msg_add_message_integrity_short_cred and
+ *         @ref r_stun_msg_end (with FINGERPRINT) produce; 0 on error.
+ */
+R_API rsize r_stun_binding_responder_build (RStunBindingResponder * resp,
+    rpointer buf, rsize size, const ruint8 transaction_id[R_STUN_TRANSACTION_ID_SIZE],
+    const RSocketAddress * addr);
+/** @brief Verify a request's MESSAGE-INTEGRITY @p tlv with the responder's key. */
+R_API rboolean r_stun_binding_responder_check_integrity (RStunBindingResponder * resp,
+    rconstpointer buf, const RStunAttrTLV * tlv);
+/** @} */
+
 R_END_DECLS
 
 /** @} */
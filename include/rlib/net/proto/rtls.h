@@ -72,6 +72,8 @@ R_BEGIN_DECLS
 #define R_DTLS_HS_HDR_SIZE                (R_TLS_HS_HDR_SIZE + R_TLS_HS_EXTRA_DTLS_SIZE) /**< @brief DTLS handshake header size in bytes. */
 #define R_TLS_SESSION_TICKET_LIFETIME     7200 /**< @brief Default session-ticket lifetime hint, in seconds. */
 #define R_TLS_MAX_PLAINTEXT               16384 /**< @brief Maximum protected-record plaintext (2^14), the default record_size_limit (RFC 8449). */
+#define R_TLS_MAX_CIPHERTEXT              (R_TLS_MAX_PLAINTEXT + 2048) /**< @brief Maximum record fragment on the wire up to TLS 1.2 (2^14 + 2048, RFC 5246 6.2.3); the record parser's bound, as the record version can't tell TLS 1.3 apart. */
+#define R_TLS13_MAX_CIPHERTEXT            (R_TLS_MAX_PLAINTEXT + 256) /**< @brief Maximum protected record fragment in TLS 1.3 (2^14 + 256, RFC 8446 5.2). */
 /** @} */
 
 /** @brief TLS / DTLS protocol version (the 16-bit version field; DTLS uses 0xfe**). */
@@ -359,6 +361,7 @@ typedef enum {
 
 /** @brief Result code returned by the TLS / DTLS parsing and building API (negative values are errors). */
 typedef enum {
+  R_TLS_ERROR_PENDING                                   =  0x03, /**< Operation suspended; it resumes asynchronously. */
   R_TLS_ERROR_NOT_NEEDED                                =  0x02, /**< Operation was a no-op / not required. */
   R_TLS_ERROR_EOB                                       =  0x01, /**< End of buffer reached. */
   R_TLS_ERROR_OK                                        =  0x00, /**< Success. */
@@ -382,6 +385,7 @@ typedef enum {
   R_TLS_ERROR_ILLEGAL_PARAMETER                         = -0x12, /**< Field value well-formed but out of range. */
   R_TLS_ERROR_NO_APPLICATION_PROTOCOL                   = -0x13, /**< No ALPN protocol in common with the peer. */
   R_TLS_ERROR_INAPPROPRIATE_FALLBACK                    = -0x14, /**< Client signalled a fallback below the highest common version (RFC 7507). */
+  R_TLS_ERROR_NOT_SUPPORTED                             = -0x15, /**< Not supported for the negotiated parameters, or refused by the lower layer. */
 } RTLSError;
 
 /** @brief TLS record compression method (only @c NULL is supported / non-deprecated). */
@@ -389,6 +393,32 @@ typedef enum {
   R_TLS_COMPRESSION_NULL                                =  0,
 } RTLSCompressionMethod;
 
+/** @brief Largest AEAD record key carried by @ref RTLSTrafficKeys (AES-256, ChaCha20). */
+#define R_TLS_TRAFFIC_KEY_MAX                           32
+/** @brief Largest static IV carried by @ref RTLSTrafficKeys. */
+#define R_TLS_TRAFFIC_IV_MAX                            12
+
+/**
+ * @brief One direction's record-protection state, for an external record layer.
+ *
+ * What an established session hands to e.g. kernel TLS so it can seal records
+ * in its place: the negotiated AEAD, the raw traffic key, the static IV and the
+ * sequence number of the next record. Only AEAD suites (AES-GCM,
+ * ChaCha20-Poly1305) over TLS 1.2 / 1.3 are expressed this way.
+ */
+typedef struct {
+  RTLSVersion version;                  /**< @c R_TLS_VERSION_TLS_1_2 or @c R_TLS_VERSION_TLS_1_3. */
+  const RCryptoCipherInfo * cipher;     /**< Record AEAD. */
+  ruint8 key[R_TLS_TRAFFIC_KEY_MAX];    /**< Traffic key. */
+  rsize keylen;                         /**< Length of @c key in bytes. */
+  /** Static IV: all 12 bytes for TLS 1.3 and ChaCha20-Poly1305, the 4-byte
+   * implicit salt for TLS 1.2 AES-GCM (whose explicit nonce is the sequence
+   * number). */
+  ruint8 iv[R_TLS_TRAFFIC_IV_MAX];
+  rsize ivlen;                          /**< Length of @c iv in bytes. */
+  ruint64 seqno;                        /**< Sequence number of the next record. */
+} RTLSTrafficKeys;
+
 
 /** @name Hello message layout
  *  Sizes used when parsing / building Hello messages.
@@ -1050,6 +1080,41 @@ R_API RBuffer * r_tls_encrypt_buffer_aead (RBuffer * buf, ruint64 seqno,
  */
 R_API RBuffer * r_dtls_encrypt_buffer_aead (RBuffer * buf,
     const RCryptoCipher * cipher, const ruint8 * salt);
+/**
+ * @brief Bytes a TLS 1.2 AEAD record adds around its plaintext.
+ *
+ * @param cipher AEAD record cipher.
+ * @param prefix Set to the bytes ahead of the plaintext -- the record header
+ *  and, for AES-GCM, the explicit nonce; may be @c NULL.
+ * @return @p prefix plus the tag, or 0 if @p cipher is not an AEAD.
+ */
+R_API rsize r_tls_aead_record_overhead (const RCryptoCipher * cipher,
+    rsize * prefix);
+/**
+ * @brief Seal one TLS 1.2 AEAD record straight into @p out.
+ *
+ * Writes the same record @ref r_tls_encrypt_buffer_aead returns -- header,
+ * explicit nonce, ciphertext and tag -- in one pass from @p plain, without a
+ * plaintext record or buffer in between. @p plain may sit in @p out at the
+ * prefix offset (@ref r_tls_aead_record_overhead) to seal in place.
+ *
+ * @param out      Destination; at least @p plainlen plus the overhead bytes.
+ * @param outsize  Size of @p out.
+ * @param reclen   Set to the record's size on success.
+ * @param type     Record content type.
+ * @param version  Record version.
+ * @param plain    Plaintext fragment.
+ * @param plainlen Its length.
+ * @param seqno    Record sequence number.
+ * @param cipher   AEAD record cipher.
+ * @param salt     Write IV from key expansion (4-byte GCM salt, or the
+ *  12-byte ChaCha20-Poly1305 IV).
+ * @return @c TRUE on success.
+ */
+R_API rboolean r_tls_seal_record_aead (ruint8 * out, rsize outsize,
+    rsize * reclen, RTLSContentType type, RTLSVersion version,
+    const ruint8 * plain, rsize plainlen, ruint64 seqno,
+    const RCryptoCipher * cipher, const ruint8 * salt);
 
 /** @brief Largest DTLS 1.3 connection id this implementation uses, in bytes. */
 #define R_DTLS13_CID_MAX                 20
@@ -140,6 +140,23 @@ R_API RTLSClientCertMode r_http_server_get_client_cert_mode (RHttpServer * serve
  */
 R_API void r_http_server_set_client_trust_store (RHttpServer * server,
     RTrustStore * store);
+/**
+ * @brief Hand record sealing of HTTPS responses to kernel TLS (@ref r_ktls).
+ *
+ * Tried per connection ahead of its response; where the platform, kernel or
+ * negotiated suite cannot take it (see @ref r_tls_server_set_tx_offload) the
+ * connection keeps sealing in user space. Off by default.
+ */
+R_API void r_http_server_set_ktls_tx (RHttpServer * server, rboolean enable);
+/**
+ * @brief Hand record opening of HTTPS requests to kernel TLS (@ref r_ktls).
+ *
+ * Tried per connection once its handshake is done, at the first read that
+ * ends on a record boundary; where it cannot be had (see
+ * @ref r_tls_server_set_rx_offload) the connection keeps opening records in
+ * user space. Off by default.
+ */
+R_API void r_http_server_set_ktls_rx (RHttpServer * server, rboolean enable);
 
 /**
  * @brief Add an SNI virtual host: serve @p cert / @p privkey to clients that
@@ -94,6 +94,20 @@ typedef enum {
   R_SOCKET_MSG_SIZE         = -13,/**< Datagram exceeds the size limit (or was truncated on receive). */
 } RSocketStatus;
 
+/**
+ * @brief One datagram of a batched receive / send
+ * (@ref r_io_socket_receive_datagrams, @ref r_io_socket_send_datagrams).
+ */
+typedef struct {
+  RSocketAddress * address; /**< Receive: filled with the sender. Send: the destination. */
+  rpointer data;            /**< Payload buffer. */
+  rsize size;               /**< Receive: capacity of @c data. Send: payload length. */
+  rsize len;                /**< Bytes received / sent. */
+} RSocketDatagram;
+
+/** @brief Datagrams moved per @c recvmmsg / @c sendmmsg syscall. */
+#define R_SOCKET_DATAGRAM_BATCH_MAX   64
+
 
 /**
  * @brief Open a new socket of the given family / type / protocol;
@@ -169,6 +183,39 @@ R_API RSocketStatus r_io_socket_send (RIOHandle handle, rconstpointer buffer, rs
 R_API RSocketStatus r_io_socket_send_to (RIOHandle handle, const RSocketAddress * address, rconstpointer buffer, rsize size, rsize * sent);
 /** @brief @c sendmsg variant; payload comes from the chained @p buf. */
 R_API RSocketStatus r_io_socket_send_message (RIOHandle handle, const RSocketAddress * address, RBuffer * buf, rsize * sent);
+/**
+ * @brief @c sendfile: send up to @p size bytes of @p file from @p offset
+ * without copying them through user space; sets @p sent to the byte count
+ * (0 at the end of @p file).
+ *
+ * @return @ref R_SOCKET_NOT_SUPPORTED where the platform or @p file can't do
+ * it, so the caller can read and send the bytes itself.
+ */
+R_API RSocketStatus r_io_socket_send_file (RIOHandle handle, RIOHandle file, ruint64 offset, rsize size, rsize * sent);
+/**
+ * @brief Receive up to @p count datagrams with as few syscalls as possible
+ * (@c recvmmsg where available).
+ *
+ * Each @p dgrams entry supplies its buffer (@c data / @c size) and an address
+ * to fill; @c len is set per received datagram. Only the first datagram may
+ * wait on a blocking socket. @p received is set to the number filled.
+ *
+ * @return @ref R_SOCKET_OK if at least one datagram arrived, otherwise the
+ * status of the failed receive (@ref R_SOCKET_WOULD_BLOCK when drained).
+ */
+R_API RSocketStatus r_io_socket_receive_datagrams (RIOHandle handle, RSocketDatagram * dgrams, rsize count, rsize * received);
+/**
+ * @brief Send @p count datagrams with as few syscalls as possible
+ * (@c sendmmsg where available).
+ *
+ * Sends in order and stops at the first datagram that can't go out;
+ * @p sent is set to the number sent. Retrying the rest reports that
+ * datagram's error.
+ *
+ * @return @ref R_SOCKET_OK if at least one datagram was sent, otherwise the
+ * status of the first one.
+ */
+R_API RSocketStatus r_io_socket_send_datagrams (RIOHandle handle, RSocketDatagram * dgrams, rsize count, rsize * sent);
 /** @} */
 
 /** @name IPv4-specific options
@@ -0,0 +1,119 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2016 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+#ifndef __R_NET_KTLS_H__
+#define __R_NET_KTLS_H__
+
+#if !defined(__RLIB_H_INCLUDE_GUARD__) && !defined(RLIB_COMPILATION)
+#error "#include <rlib.h> only please."
+#endif
+
+/**
+ * @file rlib/net/rktls.h
+ * @brief Kernel TLS (Linux kTLS) record sealing and opening on a connected
+ * TCP socket.
+ */
+
+#include <rlib/rtypes.h>
+
+#include <rlib/rbuffer.h>
+#include <rlib/net/rsocket.h>
+#include <rlib/net/proto/rtls.h>
+
+/**
+ * @defgroup r_ktls Kernel TLS
+ * @ingroup r_net
+ *
+ * @brief Hand a TLS session's record layer to the kernel.
+ *
+ * Once @ref r_ktls_set_tx has installed the write keys of an established
+ * session (see @ref r_tls_server_set_tx_offload), every byte written to the
+ * socket is sealed by the kernel as application_data; plain sends -- and
+ * @ref r_socket_send_file -- replace the user-space record layer. Other
+ * record types (alerts, post-handshake messages) go out through
+ * @ref r_ktls_send_record.
+ *
+ * Likewise, once @ref r_ktls_set_rx has installed the read keys (see
+ * @ref r_tls_server_set_rx_offload), the kernel opens what arrives and
+ * @ref r_ktls_receive_record reads plaintext, telling application data from
+ * the records the session still has to see.
+ *
+ * Only Linux implements this; everywhere else, and when the kernel lacks the
+ * @c tls upper-layer protocol or the negotiated cipher, the calls fail with
+ * @ref R_SOCKET_NOT_SUPPORTED and the socket is left as it was, so the caller
+ * can keep sealing in user space.
+ *
+ * @{
+ */
+
+R_BEGIN_DECLS
+
+/**
+ * @brief Install (or, once installed, replace) the kernel's transmit keys.
+ *
+ * The first call attaches the @c tls upper-layer protocol. Nothing sealed in
+ * user space may still be queued for the socket, or it would be sealed twice.
+ * A later call rekeys (TLS 1.3 KeyUpdate), which needs a kernel that supports
+ * it.
+ *
+ * @param socket Connected TCP socket.
+ * @param keys   Write-direction keys of the established session.
+ * @return @ref R_SOCKET_OK, or @ref R_SOCKET_NOT_SUPPORTED if the platform,
+ *  kernel or cipher cannot do it (the socket keeps sending as before).
+ */
+R_API RSocketStatus r_ktls_set_tx (RSocket * socket, const RTLSTrafficKeys * keys);
+/**
+ * @brief Install (or, once installed, replace) the kernel's receive keys.
+ *
+ * The counterpart of @ref r_ktls_set_tx. The kernel takes over at the next
+ * record boundary of the stream, so nothing of a partly read record may be
+ * left in user space. After a TLS 1.3 KeyUpdate has been read the kernel
+ * holds further records back until the next keys are installed here, which
+ * needs a kernel that supports it.
+ *
+ * @param socket Connected TCP socket.
+ * @param keys   Read-direction keys of the established session.
+ * @return @ref R_SOCKET_OK, or @ref R_SOCKET_NOT_SUPPORTED if the platform,
+ *  kernel or cipher cannot do it (the socket keeps receiving as before).
+ */
+R_API RSocketStatus r_ktls_set_rx (RSocket * socket, const RTLSTrafficKeys * keys);
+/**
+ * @brief Send @p buf as one record of content type @p type.
+ *
+ * For a socket set up with @ref r_ktls_set_tx; application data needs no
+ * special call.
+ */
+R_API RSocketStatus r_ktls_send_record (RSocket * socket, RTLSContentType type,
+    RBuffer * buf, rsize * sent);
+/**
+ * @brief Receive opened record content into @p buf.
+ *
+ * For a socket set up with @ref r_ktls_set_rx. Application data may span
+ * several records; any other record is returned alone, with its content type
+ * in @p type. A @p received of 0 is the end of the stream.
+ *
+ * @return @ref R_SOCKET_OK; @ref R_SOCKET_WOULD_BLOCK; @ref R_SOCKET_ERROR
+ *  when a record failed to authenticate, a fatal condition for the session.
+ */
+R_API RSocketStatus r_ktls_receive_record (RSocket * socket,
+    RTLSContentType * type, RBuffer * buf, rsize * received);
+
+R_END_DECLS
+
+/** @} */
+
+#endif /* __R_NET_KTLS_H__ */
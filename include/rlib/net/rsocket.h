@@ -212,6 +212,12 @@ R_API RSocketStatus r_socket_send (RSocket * socket, const ruint8 * buffer, rsiz
 R_API RSocketStatus r_socket_send_to (RSocket * socket, const RSocketAddress * address, const ruint8 * buffer, rsize size, rsize * sent);
 /** @brief @c sendmsg variant; payload comes from the chained @p buf. */
 R_API RSocketStatus r_socket_send_message (RSocket * socket, const RSocketAddress * address, RBuffer * buf, rsize * sent);
+/** @brief @c sendfile variant; see @ref r_io_socket_send_file. */
+R_API RSocketStatus r_socket_send_file (RSocket * socket, RIOHandle file, ruint64 offset, rsize size, rsize * sent);
+/** @brief Batched receive; see @ref r_io_socket_receive_datagrams. */
+R_API RSocketStatus r_socket_receive_datagrams (RSocket * socket, RSocketDatagram * dgrams, rsize count, rsize * received);
+/** @brief Batched send; see @ref r_io_socket_send_datagrams. */
+R_API RSocketStatus r_socket_send_datagrams (RSocket * socket, RSocketDatagram * dgrams, rsize count, rsize * sent);
 /** @} */
 
 R_END_DECLS
@@ -298,8 +298,18 @@ R_API rboolean r_tls_client_get_early_data_accepted (const RTLSClient * client);
 R_API RTLSError r_tls_client_start (RTLSClient * client, REvLoop * loop,
     RPrng * prng, RTLSVersion version) R_ATTR_WARN_UNUSED_RESULT;
 
-/** @brief Feed received ciphertext bytes into the session. */
+/**
+ * @brief Feed received ciphertext bytes into the session.
+ *
+ * Refused once receiving is offloaded (@ref r_tls_client_set_rx_offload).
+ */
 R_API rboolean r_tls_client_incoming_data (RTLSClient * client, RBuffer * buffer);
+/**
+ * @brief Feed one record opened by the lower layer of a receive-offloaded
+ * session; see @ref r_tls_server_incoming_record.
+ */
+R_API rboolean r_tls_client_incoming_record (RTLSClient * client,
+    RTLSContentType type, RBuffer * buf);
 /** @brief Encrypt and send application data through the session. */
 R_API rboolean r_tls_client_send_appdata (RTLSClient * client, RBuffer * buffer);
 /**
@@ -329,6 +339,22 @@ R_API rboolean r_tls_client_key_update (RTLSClient * client,
  */
 R_API rboolean r_tls_client_close (RTLSClient * client);
 
+/**
+ * @brief Hand record sealing for our sending direction to a lower layer; the
+ * client side of @ref r_tls_server_set_tx_offload.
+ *
+ * Qualifies for an established TLS (not DTLS) session with an AEAD suite and
+ * no record_size_limit echoed by the server.
+ */
+R_API RTLSError r_tls_client_set_tx_offload (RTLSClient * client,
+    RTLSTxRecordCb record, RTLSTxKeysCb keys);
+/**
+ * @brief Hand record opening for the server's direction to a lower layer; the
+ * client side of @ref r_tls_server_set_rx_offload.
+ */
+R_API RTLSError r_tls_client_set_rx_offload (RTLSClient * client,
+    RTLSRxKeysCb keys);
+
 /** @brief Export RFC 5705 keying material for an application label / context. */
 R_API RTLSError r_tls_client_export_keying_material (const RTLSClient * client,
     ruint8 * material, rsize size, const rchar * label, rsize len,
@@ -149,6 +149,65 @@ typedef RTLSError (*RTLSServerNameCb) (rpointer ctx, const rchar * name, rpointe
  */
 typedef void (*RTLSPostHandshakeAuthCb) (rpointer ctx, rboolean ok, rpointer session);
 
+/**
+ * @brief A handshake private-key operation (server only).
+ *
+ * Handed to an @ref RTLSPrivKeyOpCb when the server needs its certificate key
+ * -- today the TLS 1.3 CertificateVerify and the TLS 1.2 ServerKeyExchange
+ * signatures. The op owns its inputs, a reference to the key and its own PRNG,
+ * so @ref r_tls_priv_key_op_run may be called from any thread; the session is
+ * kept alive until @ref r_tls_priv_key_op_complete.
+ */
+typedef struct RTLSPrivKeyOp RTLSPrivKeyOp;
+
+/**
+ * @brief Callback offloading a handshake private-key operation (server only).
+ *
+ * Return @c FALSE to have the server run @p op inline, as it does with no
+ * callback installed. Returning @c TRUE takes ownership: the handshake is
+ * suspended -- records already built are sent and further input is buffered --
+ * until the callback's owner calls @ref r_tls_priv_key_op_run (on any thread)
+ * followed by @ref r_tls_priv_key_op_complete on the thread driving the
+ * session, which resumes the handshake. @ref r_tls_server_offload_priv_key_op
+ * is a ready-made implementation on the session's @ref REvLoop task queue.
+ * @p session is the @ref RTLSServer.
+ */
+typedef rboolean (*RTLSPrivKeyOpCb) (rpointer ctx, RTLSPrivKeyOp * op, rpointer session);
+
+/**
+ * @brief Record sink of a transmit-offloaded session (see
+ * @ref r_tls_server_set_tx_offload, @ref r_tls_client_set_tx_offload).
+ *
+ * @p buf is the plaintext content of one record of content type @p type,
+ * to be sealed by the lower layer under the keys handed to the
+ * @ref RTLSTxKeysCb. @p session is the @ref RTLSServer or @ref RTLSClient.
+ */
+typedef rboolean (*RTLSTxRecordCb) (rpointer ctx, RTLSContentType type,
+    RBuffer * buf, rpointer session);
+/**
+ * @brief Install the write keys of a transmit-offloaded session.
+ *
+ * Called once from @ref r_tls_server_set_tx_offload -- where returning
+ * @c FALSE declines the offload -- and again after every TLS 1.3 KeyUpdate
+ * we send, taking effect after the records handed over before it, where
+ * @c FALSE fails the KeyUpdate. @p session is the @ref RTLSServer or
+ * @ref RTLSClient.
+ */
+typedef rboolean (*RTLSTxKeysCb) (rpointer ctx, const RTLSTrafficKeys * keys,
+    rpointer session);
+/**
+ * @brief Install the read keys of a receive-offloaded session.
+ *
+ * Called once from @ref r_tls_server_set_rx_offload -- where returning
+ * @c FALSE declines the offload -- and again for every TLS 1.3 KeyUpdate
+ * received, from within the @ref r_tls_server_incoming_record that carried
+ * it: the new keys apply to the records after it. Returning @c FALSE then
+ * fails the session, as the records behind the KeyUpdate can no longer be
+ * read. @p session is the @ref RTLSServer or @ref RTLSClient.
+ */
+typedef rboolean (*RTLSRxKeysCb) (rpointer ctx, const RTLSTrafficKeys * keys,
+    rpointer session);
+
 /** @brief Callback bundle wiring a session to its transport and policy. */
 typedef struct {
   RTLSPreferredCipherSuitesCb   preferred_cipher_suites; /**< Choose cipher suites; may be @c NULL for defaults. */
@@ -159,6 +218,7 @@ typedef struct {
   RTLSCertVerifyCb              verify_cert;             /**< Verify the peer certificate chain; may be @c NULL. */
   RTLSClosedCb                  closed;                  /**< Fired on a peer close_notify; may be @c NULL. */
   RTLSPostHandshakeAuthCb       post_handshake_auth;     /**< Post-handshake auth result (server); may be @c NULL. */
+  RTLSPrivKeyOpCb               priv_key_op;             /**< Offload handshake signatures (server); may be @c NULL to sign inline. */
 } RTLSCallbacks;
 
 /** @brief Create a TLS server with the given callbacks and user context. */
@@ -394,10 +454,45 @@ R_API RTLSError r_tls_server_set_random (RTLSServer * server,
 R_API RTLSError r_tls_server_start (RTLSServer * server, REvLoop * loop,
     RPrng * prng) R_ATTR_WARN_UNUSED_RESULT;
 
-/** @brief Feed received ciphertext bytes into the session. */
+/**
+ * @brief Feed received ciphertext bytes into the session.
+ *
+ * Refused once receiving is offloaded (@ref r_tls_server_set_rx_offload).
+ */
 R_API rboolean r_tls_server_incoming_data (RTLSServer * server, RBuffer * buffer);
-/** @brief Encrypt and send application data through the session. */
+/**
+ * @brief Feed one record opened by the lower layer of a receive-offloaded
+ * session (@ref r_tls_server_set_rx_offload).
+ *
+ * @p buf is the plaintext content of a record of content type @p type.
+ * Application data may hold several records' worth and goes straight to
+ * @ref RTLSCallbacks::appdata; alerts and post-handshake messages (KeyUpdate,
+ * post-handshake authentication) are handled as if they had been decrypted
+ * by the session.
+ */
+R_API rboolean r_tls_server_incoming_record (RTLSServer * server,
+    RTLSContentType type, RBuffer * buf);
+/**
+ * @brief Encrypt and send application data through the session.
+ *
+ * Over TLS with an AEAD suite the payload is sealed straight into one
+ * outgoing buffer holding as many full-size records as it needs.
+ */
 R_API rboolean r_tls_server_send_appdata (RTLSServer * server, RBuffer * buffer);
+/**
+ * @brief Hold back application data until it fills a record.
+ *
+ * Until @ref r_tls_server_uncork, @ref r_tls_server_send_appdata coalesces
+ * small writes into full-size records instead of sealing one record per
+ * call. Held-back data also goes out ahead of a KeyUpdate or close_notify.
+ * Only TLS sessions with an AEAD suite hold anything back.
+ *
+ * @return @c FALSE unless the session is established.
+ */
+R_API rboolean r_tls_server_cork (RTLSServer * server);
+/** @brief Seal and send what @ref r_tls_server_cork held back, and stop
+ *  holding back. */
+R_API rboolean r_tls_server_uncork (RTLSServer * server);
 /**
  * @brief Rekey an established TLS 1.3 session (RFC 8446, section 4.6.3).
  *
@@ -425,6 +520,47 @@ R_API rboolean r_tls_server_key_update (RTLSServer * server,
  */
 R_API rboolean r_tls_server_close (RTLSServer * server);
 
+/**
+ * @brief Hand record sealing for our sending direction to a lower layer,
+ * e.g. kernel TLS (@ref r_ktls, @ref r_ev_tcp_set_ktls_tx).
+ *
+ * @p keys is called with the current write keys; once it accepts, every
+ * record the session sends -- application data, alerts, KeyUpdate -- goes to
+ * @p record as plaintext instead of @ref RTLSCallbacks::out, and
+ * @ref r_tls_server_send_appdata passes its buffer through without copying
+ * or splitting it. Receiving is unaffected.
+ *
+ * Only an established TLS (not DTLS) session with an AEAD suite and no
+ * negotiated max_fragment_length / record_size_limit qualifies; otherwise,
+ * or when @p keys declines, the session keeps sealing records itself.
+ *
+ * @return @c R_TLS_ERROR_OK; @c R_TLS_ERROR_WRONG_STATE before the handshake
+ *  has finished or when already offloaded; @c R_TLS_ERROR_NOT_SUPPORTED as
+ *  described above.
+ */
+R_API RTLSError r_tls_server_set_tx_offload (RTLSServer * server,
+    RTLSTxRecordCb record, RTLSTxKeysCb keys);
+/**
+ * @brief Hand record opening for the peer's direction to a lower layer,
+ * e.g. kernel TLS (@ref r_ktls, @ref r_ev_tcp_set_ktls_rx).
+ *
+ * @p keys is called with the current read keys; once it accepts, the
+ * session takes opened records through @ref r_tls_server_incoming_record
+ * and refuses @ref r_tls_server_incoming_data. Sending is unaffected.
+ *
+ * The lower layer has to start reading at a record boundary: nothing may be
+ * left of a partly received record, so this is refused with
+ * @c R_TLS_ERROR_WRONG_STATE until the rest of it has been fed in. The same
+ * sessions as for @ref r_tls_server_set_tx_offload qualify.
+ *
+ * @return @c R_TLS_ERROR_OK; @c R_TLS_ERROR_WRONG_STATE before the handshake
+ *  has finished, with a partial record buffered or when already offloaded;
+ *  @c R_TLS_ERROR_NOT_SUPPORTED for an unsuitable session or when @p keys
+ *  declines, the session then keeps opening records itself.
+ */
+R_API RTLSError r_tls_server_set_rx_offload (RTLSServer * server,
+    RTLSRxKeysCb keys);
+
 /** @brief Export RFC 5705 keying material for an application label / context. */
 R_API RTLSError r_tls_server_export_keying_material (const RTLSServer * server,
     ruint8 * material, rsize size, const rchar * label, rsize len,
@@ -447,6 +583,31 @@ R_API const ruint8 * r_tls_server_get_dtls_srtp_mki (const RTLSServer * server,
  */
 R_API const rchar * r_tls_server_get_alpn_selected (const RTLSServer * server, rsize * len);
 
+/**
+ * @brief Perform an offloaded private-key operation.
+ *
+ * Touches only state the op owns, so it may run on a worker thread. Returns
+ * the operation's result, which @ref r_tls_priv_key_op_complete also acts on.
+ */
+R_API RTLSError r_tls_priv_key_op_run (RTLSPrivKeyOp * op);
+/**
+ * @brief Hand a finished operation back and resume the suspended handshake.
+ *
+ * Must be called exactly once, on the thread driving the session, after
+ * @ref r_tls_priv_key_op_run; consumes @p op. A failed (or never run)
+ * operation aborts the handshake with an @c internal_error alert.
+ */
+R_API void r_tls_priv_key_op_complete (RTLSPrivKeyOp * op);
+/**
+ * @brief Stock @ref RTLSPrivKeyOpCb running the operation on the session's
+ * @ref REvLoop task queue and completing it on the loop thread.
+ *
+ * Falls back to inline signing (returns @c FALSE) when the session was started
+ * without a loop or the task cannot be queued. @p ctx is unused.
+ */
+R_API rboolean r_tls_server_offload_priv_key_op (rpointer ctx,
+    RTLSPrivKeyOp * op, rpointer session);
+
 R_END_DECLS
 
 /** @} */
@@ -0,0 +1,146 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2017 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+#ifndef __R_NET_TURN_SERVER_H__
+#define __R_NET_TURN_SERVER_H__
+
+#if !defined(__RLIB_H_INCLUDE_GUARD__) && !defined(RLIB_COMPILATION)
+#error "#include <rlib.h> only please."
+#endif
+
+/**
+ * @file rlib/net/rturnserver.h
+ * @brief Multi-threaded UDP TURN relay server (RFC 8656).
+ */
+
+#include <rlib/rtypes.h>
+#include <rlib/rref.h>
+
+#include <rlib/net/rsocketaddress.h>
+
+/**
+ * @defgroup r_turn_server TURN server
+ * @ingroup r_net
+ *
+ * @brief Refcounted TURN server relaying UDP between clients and peers.
+ *
+ * The server runs one worker per core, each with its own thread,
+ * @ref REvLoop and listening socket bound to the same address with
+ * @c SO_REUSEPORT. The kernel pins a client's 5-tuple to one of those
+ * sockets, so every allocation lives on exactly one worker and the relay
+ * path takes no locks. Allocations, permissions and channels are hashed;
+ * datagrams are received and sent in batches (@c recvmmsg / @c sendmmsg,
+ * see @ref r_ev_udp_recv_batch_start).
+ *
+ * Clients authenticate with long-term credentials
+ * (@ref r_turn_server_add_user). Each allocation is bound by an
+ * @ref RTurnServerQuota: a request that would exceed it is refused, and
+ * relayed data over the bandwidth quota is dropped. Traffic counters
+ * are summed across workers by @ref r_turn_server_get_stats.
+ *
+ * Only UDP allocations are supported (no TCP / TLS transports).
+ *
+ * @{
+ */
+
+R_BEGIN_DECLS
+
+/** @brief Default allocation lifetime, in seconds. */
+#define R_TURN_SERVER_LIFETIME        600
+/** @brief Longest allocation lifetime a client may request, in seconds. */
+#define R_TURN_SERVER_MAX_LIFETIME    3600
+/** @brief Permission lifetime, in seconds (RFC 8656 9). */
+#define R_TURN_SERVER_PERM_LIFETIME   300
+/** @brief Channel binding lifetime, in seconds (RFC 8656 12). */
+#define R_TURN_SERVER_CHAN_LIFETIME   600
+
+/** @brief Limits applied by a @ref RTurnServer; 0 means unlimited. */
+typedef struct {
+  ruint max_allocations;  /**< Allocations per server (486 when reached). */
+  ruint max_permissions;  /**< Permissions per allocation (508 when reached). */
+  ruint max_channels;     /**< Channel bindings per allocation (508 when reached). */
+  ruint64 max_bps;        /**< Relayed bits per second per allocation, both directions. */
+} RTurnServerQuota;
+
+/** @brief Counters summed over all workers. */
+typedef struct {
+  rsize allocations;          /**< Currently active allocations. */
+  ruint64 allocations_total;  /**< Allocations created. */
+  ruint64 requests;           /**< STUN requests handled. */
+  ruint64 auth_failures;      /**< Requests answered with a 401 challenge. */
+  ruint64 quota_rejects;      /**< Requests refused by the quota. */
+  ruint64 peer_packets;       /**< Datagrams relayed to peers. */
+  ruint64 peer_bytes;         /**< Payload bytes relayed to peers. */
+  ruint64 client_packets;     /**< Datagrams relayed to clients. */
+  ruint64 client_bytes;       /**< Payload bytes relayed to clients. */
+  ruint64 dropped;            /**< Datagrams without allocation / permission or over quota. */
+  ruint64 batches;            /**< Receive batches processed. */
+} RTurnServerStats;
+
+/** @brief Opaque, refcounted TURN server. */
+typedef struct RTurnServer RTurnServer;
+
+/** @brief Create a server answering for @p realm. */
+R_API RTurnServer * r_turn_server_new (const rchar * realm) R_ATTR_MALLOC;
+/** @brief Take a reference (alias for @ref r_ref_ref). */
+#define r_turn_server_ref    r_ref_ref
+/** @brief Drop a reference (alias for @ref r_ref_unref); the last one stops the server. */
+#define r_turn_server_unref  r_ref_unref
+
+/** @brief Accept the long-term credential @p user / @p pass; only before starting. */
+R_API rboolean r_turn_server_add_user (RTurnServer * server,
+    const rchar * user, const rchar * pass);
+/** @brief Replace the quota; only before starting. */
+R_API rboolean r_turn_server_set_quota (RTurnServer * server,
+    const RTurnServerQuota * quota);
+
+/**
+ * @brief Bind the listeners and start the workers.
+ * @param server   The server.
+ * @param listen   Address clients send to; port 0 picks one
+ *                 (see @ref r_turn_server_get_local_address).
+ * @param relay    Address relayed sockets are bound to (its port is ignored).
+ * @param workers  Worker threads, 0 for one per allowed CPU. Without
+ *                 @c SO_REUSEPORT a single worker is used.
+ * @return @c TRUE once every worker is listening.
+ */
+R_API rboolean r_turn_server_start (RTurnServer * server,
+    const RSocketAddress * listen, const RSocketAddress * relay, ruint workers);
+/**
+ * @brief Stop the workers and release all allocations.
+ *
+ * Workers notice within one housekeeping tick (100 ms); this joins them.
+ */
+R_API void r_turn_server_stop (RTurnServer * server);
+
+/** @brief Bound listening address; caller unrefs. @c NULL before starting. */
+R_API RSocketAddress * r_turn_server_get_local_address (RTurnServer * server);
+/** @brief Number of running workers. */
+R_API ruint r_turn_server_get_worker_count (const RTurnServer * server);
+/**
+ * @brief Sum every worker's counters into @p stats.
+ *
+ * Workers publish their counters once per batch, so a snapshot may trail
+ * the wire by the datagrams currently being processed.
+ */
+R_API void r_turn_server_get_stats (RTurnServer * server, RTurnServerStats * stats);
+
+R_END_DECLS
+
+/** @} */
+
+#endif /* __R_NET_TURN_SERVER_H__ */
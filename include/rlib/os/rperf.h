@@ -0,0 +1,142 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2016 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+#ifndef __R_PERF_H__
+#define __R_PERF_H__
+
+#if !defined(__RLIB_H_INCLUDE_GUARD__) && !defined(RLIB_COMPILATION)
+#error "#include <rlib.h> only please."
+#endif
+
+/**
+ * @file rlib/os/rperf.h
+ * @brief Hardware performance counters (cycles, instructions, cache and
+ * branch misses, context switches) around a code region.
+ */
+
+#include <rlib/rtypes.h>
+#include <rlib/rref.h>
+
+/**
+ * @defgroup r_perf Performance counters
+ * @ingroup r_os
+ *
+ * @brief Count CPU events for the calling thread, on Linux via
+ * @c perf_event_open.
+ *
+ * @code
+ *   RPerfCounters * pc = r_perf_counters_new (R_PERF_COUNTER_MASK_ALL);
+ *   RPerfSample s;
+ *
+ *   if (pc != NULL) {
+ *     r_perf_counters_start (pc);
+ *     ...
+ *     r_perf_counters_stop (pc, &s);
+ *     if (r_perf_sample_has (&s, R_PERF_COUNTER_INSTRUCTIONS))
+ *       r_print ("IPC %.2f\n", r_perf_sample_ipc (&s));
+ *     r_perf_counters_unref (pc);
+ *   }
+ * @endcode
+ *
+ * Counters are opened as one group so that they are scheduled onto the
+ * PMU together; when the kernel has to multiplex them the values are
+ * scaled up by the enabled / running time ratio. Only user space of the
+ * calling thread is counted (kernel counting is used where permitted),
+ * and threads it creates are not included.
+ *
+ * Not every counter is available everywhere: virtual machines often have
+ * no PMU at all, and @c kernel.perf_event_paranoid may forbid access.
+ * Whatever could be opened is used, @ref r_perf_counters_get_mask tells
+ * which, and @ref r_perf_counters_new only fails when nothing could.
+ *
+ * @{
+ */
+
+R_BEGIN_DECLS
+
+/** @brief The events an @ref RPerfCounters can count. */
+typedef enum {
+  R_PERF_COUNTER_CYCLES,            /**< CPU cycles. */
+  R_PERF_COUNTER_INSTRUCTIONS,      /**< Retired instructions. */
+  R_PERF_COUNTER_CACHE_MISSES,      /**< Last level cache misses. */
+  R_PERF_COUNTER_BRANCH_MISSES,     /**< Mispredicted branches. */
+  R_PERF_COUNTER_CONTEXT_SWITCHES,  /**< Context switches (software). */
+  R_PERF_COUNTER_COUNT
+} RPerfCounter;
+
+/** @brief Bit for @p c in a counter mask. */
+#define R_PERF_COUNTER_BIT(c)         (1u << (c))
+/** @brief Mask selecting every @ref RPerfCounter. */
+#define R_PERF_COUNTER_MASK_ALL       (R_PERF_COUNTER_BIT (R_PERF_COUNTER_COUNT) - 1)
+
+/** @brief Counter values; only those flagged in @c valid are meaningful. */
+typedef struct {
+  ruint32 valid;                            /**< Mask of @ref R_PERF_COUNTER_BIT. */
+  ruint64 value[R_PERF_COUNTER_COUNT];      /**< Indexed by @ref RPerfCounter. */
+} RPerfSample;
+
+/** @brief @c TRUE if @p s holds a value for counter @p c. */
+#define r_perf_sample_has(s, c)       (((s)->valid & R_PERF_COUNTER_BIT (c)) != 0)
+
+/** @brief Instructions per cycle, or @c 0.0 if either is missing. */
+R_API rdouble r_perf_sample_ipc (const RPerfSample * s);
+/** @brief @p dest = @p a - @p b for the counters valid in both. */
+R_API void r_perf_sample_sub (RPerfSample * dest, const RPerfSample * a,
+    const RPerfSample * b);
+/** @brief @p dest += @p s; counters missing in @p s are dropped from @p dest. */
+R_API void r_perf_sample_add (RPerfSample * dest, const RPerfSample * s);
+/** @brief Short name of @p c (e.g. "cache-misses"), as @c perf stat prints it. */
+R_API const rchar * r_perf_counter_name (RPerfCounter c);
+
+/** @brief Opaque refcounted counter group bound to the creating thread. */
+typedef struct RPerfCounters RPerfCounters;
+
+/**
+ * @brief Open the counters in @p mask for the calling thread.
+ *
+ * The counters start out stopped.
+ * @return @c NULL if none of them could be opened (always the case on
+ *         systems without @c perf_event_open).
+ */
+R_API RPerfCounters * r_perf_counters_new (ruint32 mask) R_ATTR_MALLOC;
+/** @brief Increment the refcount. */
+#define r_perf_counters_ref     r_ref_ref
+/** @brief Decrement the refcount; the last unref closes the counters. */
+#define r_perf_counters_unref   r_ref_unref
+
+/** @brief Mask of the counters that were actually opened. */
+R_API ruint32 r_perf_counters_get_mask (const RPerfCounters * pc);
+/** @brief Zero and start the counters. */
+R_API rboolean r_perf_counters_start (RPerfCounters * pc);
+/** @brief Stop the counters and read them into @p s. */
+R_API rboolean r_perf_counters_stop (RPerfCounters * pc, RPerfSample * s);
+/** @brief Read the counts since the last start into @p s, leaving them running. */
+R_API rboolean r_perf_counters_read (RPerfCounters * pc, RPerfSample * s);
+/**
+ * @brief Stop running counters without reading them.
+ * @return @c FALSE if they were not running, i.e. there is nothing to
+ *         @ref r_perf_counters_resume.
+ */
+R_API rboolean r_perf_counters_pause (RPerfCounters * pc);
+/** @brief Restart stopped counters, adding on to the counts they hold. */
+R_API rboolean r_perf_counters_resume (RPerfCounters * pc);
+
+R_END_DECLS
+
+/** @} */
+
+#endif /* __R_PERF_H__ */
@@ -124,6 +124,10 @@ typedef ruint64 RCpuFeature;
 /** @brief x86 AVX-512VL; lets 128/256-bit ops use AVX-512 features
  * (masking, extended register file). Implies F. */
 #define R_CPU_FEATURE_AVX512VL          R_CPU_BIT_(13)
+/** @brief x86 AVX-512 IFMA (Cannon Lake+, Zen 4+); 52-bit integer
+ * fused multiply-add (@c VPMADD52LUQ / @c VPMADD52HUQ), the building
+ * block of vectorised big-number Montgomery multiplication. Implies F. */
+#define R_CPU_FEATURE_AVX512IFMA        R_CPU_BIT_(14)
 
 /* x86 / x86_64 misc (bits 16-23) */
 
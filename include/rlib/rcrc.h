@@ -49,6 +49,11 @@
  * checksum bytes incrementally; seed the first call with
  * @c R_CRC32_INIT. The macro shorthands (@c r_crc32 / @c r_crc32c /
  * @c r_crc32bzip2) wrap the one-shot case.
+ *
+ * CRC32C runs on the SSE4.2 / ARMv8 CRC instructions where available.
+ * CRC32 and CRC32 bzip2 fold 64 byte stripes with carry-less multiply
+ * (PCLMULQDQ / PMULL) and fall back to slicing-by-16 tables; the
+ * @c _combine functions merge CRCs of independently checksummed chunks.
  */
 
 /** @brief Seed value for an empty / unstarted CRC32 stream. */
@@ -88,6 +93,25 @@ R_API ruint32 r_crc32c_update (ruint32 crc, rconstpointer buffer, rsize size);
  */
 R_API ruint32 r_crc32bzip2_update (ruint32 crc, rconstpointer buffer, rsize size);
 
+/**
+ * @brief CRC32 (IEEE) of the concatenation A || B from the CRCs of
+ * both parts.
+ *
+ * Lets a large buffer be checksummed in independent chunks (e.g. one
+ * per thread) and the results merged in order. Costs O(log @p len2)
+ * and does not touch the data.
+ *
+ * @param crc1  CRC of A.
+ * @param crc2  CRC of B.
+ * @param len2  Length of B in bytes.
+ * @return CRC of A followed by B.
+ */
+R_API ruint32 r_crc32_combine (ruint32 crc1, ruint32 crc2, ruint64 len2);
+/** @brief CRC32C counterpart of @c r_crc32_combine. */
+R_API ruint32 r_crc32c_combine (ruint32 crc1, ruint32 crc2, ruint64 len2);
+/** @brief CRC32 bzip2 counterpart of @c r_crc32_combine. */
+R_API ruint32 r_crc32bzip2_combine (ruint32 crc1, ruint32 crc2, ruint64 len2);
+
 R_END_DECLS
 
 /** @} */ /* r_crc group */
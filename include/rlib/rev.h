@@ -36,6 +36,7 @@
 
 #include <rlib/ev/revloop.h>
 #include <rlib/ev/revresolve.h>
+#include <rlib/ev/revrsasignqueue.h>
 #include <rlib/ev/revtcp.h>
 #include <rlib/ev/revudp.h>
 #include <rlib/ev/revwakeup.h>
@@ -40,8 +40,13 @@
 #include <rlib/format/rasn1.h>
 #include <rlib/format/rjson.h>
 #include <rlib/format/rjsonparser.h>
+#include <rlib/format/rjsonreader.h>
+#include <rlib/format/rjsontape.h>
+#include <rlib/format/rjsonwriter.h>
 #include <rlib/format/roid.h>
 #include <rlib/rlog.h>
+#include <rlib/rlogasync.h>
+#include <rlib/rlogbin.h>
 #include <rlib/rmath.h>
 #include <rlib/rmem.h>
 #include <rlib/rmemallocator.h>
@@ -68,6 +73,7 @@
 
 /* DATA TYPES */
 #include <rlib/data/rbitset.h>
+#include <rlib/data/rconcurrenthashmap.h>
 #include <rlib/data/rdictionary.h>
 #include <rlib/data/rdirtree.h>
 #include <rlib/data/rhashfuncs.h>
@@ -157,6 +157,33 @@ R_API void r_logv (RLogCategory * cat, RLogLevel lvl,
 R_API void r_log_msg (RLogCategory * cat, RLogLevel lvl,
     const rchar * file, ruint line, const rchar * func,
     const rchar * msg);
+
+/** @brief Most arguments a call site can record in binary form. */
+#define R_LOG_SITE_MAX_ARGS     16
+/**
+ * @brief Per call site state behind the @c R_LOG_* macros.
+ *
+ * Each macro expansion owns one, zero-initialised and static. It is
+ * untouched unless binary logging (see @ref r_log_bin) is on: the site
+ * then registers its format string once, and every later message only
+ * records the raw arguments. A site must always be used with the same
+ * format string. Treat the fields as private.
+ */
+typedef struct
+{
+  rauint          session;      /**< Binary log session last registered in. */
+  ruint           id;           /**< Site id within that session. */
+  ruint8          nargs;        /**< Argument count, or 0xff if not recordable. */
+  ruint8          argt[R_LOG_SITE_MAX_ARGS]; /**< Argument C types. */
+} RLogSite;
+
+/**
+ * @brief @ref r_log for a macro call site; records @p fmt's arguments
+ * unformatted when binary logging is on.
+ */
+R_API void r_log_site (RLogSite * site, RLogCategory * cat, RLogLevel lvl,
+    const rchar * file, ruint line, const rchar * func,
+    const rchar * fmt, ...) R_ATTR_PRINTF (7, 8);
 /** @brief Hex-dump @p str; @p bytesperline controls the row width. */
 R_API void r_log_str_dump (RLogCategory * cat, RLogLevel lvl,
     const rchar * file, ruint line, const rchar * func,
@@ -177,8 +204,11 @@ R_API void r_log_buf_dump (RLogCategory * cat, RLogLevel lvl,
 /** @brief Build a per-category, per-level log macro body. */
 #define R_LOG_CAT_LEVEL(cat,lvl,...) R_STMT_START {                           \
   _r_test_mark_position (__FILE__, __LINE__, R_STRFUNC, FALSE);               \
-  if (R_UNLIKELY (lvl <= R_LOG_LEVEL_MAX && (int)lvl<=(int)_r_log_level_min)) \
-    r_log ((cat), (lvl), __FILE__, __LINE__, R_STRFUNC, __VA_ARGS__);         \
+  if (R_UNLIKELY (lvl <= R_LOG_LEVEL_MAX && (int)lvl<=(int)_r_log_level_min)) {\
+    static RLogSite _r_log_site;                                              \
+    r_log_site (&_r_log_site, (cat), (lvl), __FILE__, __LINE__, R_STRFUNC,    \
+        __VA_ARGS__);                                                         \
+  }                                                                           \
 } R_STMT_END
 
 #define R_LOG_CAT_ERROR(cat,...)    R_LOG_CAT_LEVEL (cat, R_LOG_LEVEL_ERROR,    __VA_ARGS__) /**< @brief Log @c ERROR in @p cat. */
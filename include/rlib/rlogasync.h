@@ -0,0 +1,119 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2015  Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+#ifndef __R_LOG_ASYNC_H__
+#define __R_LOG_ASYNC_H__
+
+#if !defined(__RLIB_H_INCLUDE_GUARD__) && !defined(RLIB_COMPILATION)
+#error "#include <rlib.h> only please."
+#endif
+
+/**
+ * @file rlib/rlogasync.h
+ * @brief Asynchronous log sink: per-thread lock-free rings drained by a
+ * background writer.
+ */
+
+#include <rlib/rtypes.h>
+#include <rlib/rlog.h>
+#include <rlib/rref.h>
+
+/**
+ * @defgroup r_log_async Asynchronous log sink
+ * @ingroup r_log
+ *
+ * @brief An @ref RLogFunc that takes formatting and I/O off the logging
+ * thread.
+ *
+ * Each logging thread appends its records (category, level, source
+ * position, timestamp and the already formatted message) to its own
+ * single-producer ring, so logging costs one copy and no lock or system
+ * call. A background writer thread formats the line prefixes and hands
+ * whole batches of lines to the output with one @c writev.
+ *
+ * Install it like any other sink:
+ * @code
+ *   RLogAsync * sink = r_log_async_new_file ("trace.log",
+ *       R_LOG_ASYNC_OVERFLOW_COUNT, 0);
+ *   old = r_log_override_default_handler (r_log_async_handler, sink, &olddata);
+ *   ...
+ *   r_log_override_default_handler (old, olddata, NULL);
+ *   r_log_async_unref (sink);    // drains what is still queued
+ * @endcode
+ *
+ * Lines from one thread keep their order; lines from different threads
+ * are interleaved per batch and carry their own timestamps.
+ *
+ * @{
+ */
+
+R_BEGIN_DECLS
+
+/** @brief What a logging thread does when its ring is full. */
+typedef enum {
+  R_LOG_ASYNC_OVERFLOW_DROP,    /**< Discard the message. */
+  R_LOG_ASYNC_OVERFLOW_COUNT,   /**< Discard it, and have the writer report
+                                     how many were lost in the output. */
+  R_LOG_ASYNC_OVERFLOW_BLOCK,   /**< Wait for the writer to make room. */
+} RLogAsyncOverflow;
+
+/** @brief Default per-thread ring size in bytes. */
+#define R_LOG_ASYNC_RING_SIZE_DEFAULT   (64 * 1024)
+
+/** @brief Opaque refcounted asynchronous log sink. */
+typedef struct RLogAsync RLogAsync;
+
+/**
+ * @brief Create a sink writing to @p handle and start its writer thread.
+ *
+ * @param handle    Output; not closed by the sink.
+ * @param overflow  Policy for a full ring.
+ * @param ringsize  Bytes per logging thread (rounded up to a power of
+ *                  two), or @c 0 for @ref R_LOG_ASYNC_RING_SIZE_DEFAULT.
+ */
+R_API RLogAsync * r_log_async_new (RIOHandle handle,
+    RLogAsyncOverflow overflow, rsize ringsize) R_ATTR_MALLOC;
+/** @brief Like @ref r_log_async_new, writing to (and owning) a freshly
+ * truncated file at @p path. */
+R_API RLogAsync * r_log_async_new_file (const rchar * path,
+    RLogAsyncOverflow overflow, rsize ringsize) R_ATTR_MALLOC;
+/** @brief Increment the sink's refcount. */
+#define r_log_async_ref     r_ref_ref
+/**
+ * @brief Decrement the sink's refcount; the last unref writes out every
+ * queued record and stops the writer. The sink must no longer be
+ * installed at that point.
+ */
+#define r_log_async_unref   r_ref_unref
+
+/**
+ * @brief The @ref RLogFunc to install; @p user_data is the @ref RLogAsync.
+ */
+R_API void r_log_async_handler (RLogCategory * cat, RLogLevel lvl,
+    const rchar * file, ruint line, const rchar * func,
+    const rchar * msg, rpointer user_data);
+
+/** @brief Block until everything logged before the call has been written. */
+R_API void r_log_async_flush (RLogAsync * sink);
+/** @brief Number of messages discarded because a ring was full. */
+R_API ruint r_log_async_dropped (RLogAsync * sink);
+
+R_END_DECLS
+
+/** @} */
+
+#endif /* __R_LOG_ASYNC_H__ */
@@ -0,0 +1,92 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2015  Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+#ifndef __R_LOG_BIN_H__
+#define __R_LOG_BIN_H__
+
+#if !defined(__RLIB_H_INCLUDE_GUARD__) && !defined(RLIB_COMPILATION)
+#error "#include <rlib.h> only please."
+#endif
+
+/**
+ * @file rlib/rlogbin.h
+ * @brief Binary trace log with deferred formatting.
+ */
+
+#include <rlib/rtypes.h>
+#include <rlib/rlog.h>
+
+/**
+ * @defgroup r_log_bin Binary trace log
+ * @ingroup r_log
+ *
+ * @brief Record @c R_LOG_* messages as raw arguments and format them
+ * offline.
+ *
+ * While a trace file is open, every @c R_LOG_* call site registers its
+ * category, level, source position and format string in the file once.
+ * After that a message costs a timestamp and a copy of its arguments into
+ * a per-thread buffer; nothing is formatted and no lock is taken until the
+ * buffer fills up and is written out as one chunk. The installed
+ * @ref RLogFunc is bypassed for those messages.
+ *
+ * Messages whose format cannot be recorded argument by argument
+ * (positional arguments, @c %n, wide strings) are formatted on the spot
+ * and stored as text. Strings are stored by value, truncated to
+ * @ref R_LOG_BIN_STR_MAX bytes.
+ *
+ * Decode a trace with @c tools/rlogbin_decode.py, which prints the same
+ * lines as the default handler. Setting @c R_DEBUG_BIN_FILE in the
+ * environment opens a trace file when rlib initialises.
+ *
+ * The file is written in host byte order. It starts with a header
+ * (@c "RLOGBIN1", version, pointer size, endianness, pid, start time)
+ * followed by chunks of @c {type, size}: SITE chunks describe a call site,
+ * DATA chunks carry one thread's records.
+ *
+ * @{
+ */
+
+R_BEGIN_DECLS
+
+/** @brief Bytes of a string argument kept in a record. */
+#define R_LOG_BIN_STR_MAX       1024
+
+/**
+ * @brief Start recording to a freshly truncated file at @p path.
+ *
+ * Closes any trace file already open.
+ * @return @c FALSE if the file could not be created.
+ */
+R_API rboolean r_log_bin_open (const rchar * path);
+/**
+ * @brief Write out every thread's buffered records and close the file.
+ *
+ * Threads must not be logging at the same time; ones that log afterwards
+ * go back to the installed @ref RLogFunc.
+ */
+R_API void r_log_bin_close (void);
+/** @brief Write out the calling thread's buffered records. */
+R_API void r_log_bin_flush (void);
+/** @brief @c TRUE while a trace file is open. */
+R_API rboolean r_log_bin_is_enabled (void);
+
+R_END_DECLS
+
+/** @} */
+
+#endif /* __R_LOG_BIN_H__ */
@@ -49,10 +49,12 @@
 #include <rlib/net/rresolve.h>
 #include <rlib/net/rhttpclient.h>
 #include <rlib/net/rhttpserver.h>
+#include <rlib/net/rktls.h>
 #include <rlib/net/rsrtp.h>
 #include <rlib/net/rtlssessiontickets.h>
 #include <rlib/net/rtlsclient.h>
 #include <rlib/net/rtlsserver.h>
+#include <rlib/net/rturnserver.h>
 #include <rlib/net/proto/rhttp.h>
 #include <rlib/net/proto/rrtp.h>
 #include <rlib/net/proto/rsdp.h>
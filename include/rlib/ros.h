@@ -22,9 +22,10 @@
  * @defgroup r_os Operating system
  *
  * @brief OS-system facing primitives: processes, signals, system
- * info, environment variables, dynamic loading and TTY detection.
+ * info, environment variables, dynamic loading, TTY detection and
+ * hardware performance counters.
  *
- * Six headers:
+ * Seven headers:
  *
  *   - @c r_proc — process introspection and management.
  *   - @c r_signal — signal handlers and synchronous delivery.
@@ -32,12 +33,14 @@
  *   - @c r_env — environment-variable accessors.
  *   - @c r_module — dynamic-library loading (@c dlopen / @c LoadLibrary).
  *   - @c r_tty — terminal detection and capability queries.
+ *   - @c r_perf — hardware performance counters (@c perf_event_open).
  */
 
 #include <rlib/rlib.h>
 
 #include <rlib/os/renv.h>
 #include <rlib/os/rmodule.h>
+#include <rlib/os/rperf.h>
 #include <rlib/os/rproc.h>
 #include <rlib/os/rsignal.h>
 #include <rlib/os/rsys.h>
@@ -36,6 +36,7 @@
 #include <rlib/rlib.h>
 
 #include <rlib/rtc/rrtctypes.h>
+#include <rlib/rtc/rrtccongestion.h>
 #include <rlib/rtc/rrtccryptotransport.h>
 #include <rlib/rtc/rrtcicecandidate.h>
 #include <rlib/rtc/rrtcicetransport.h>
@@ -0,0 +1,166 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2017 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+#ifndef __R_RTC_CONGESTION_H__
+#define __R_RTC_CONGESTION_H__
+
+#if !defined(__RLIB_H_INCLUDE_GUARD__) && !defined(RLIB_COMPILATION)
+#error "#include <rlib.h> only please."
+#endif
+
+/**
+ * @file rlib/rtc/rrtccongestion.h
+ * @brief WebRTC send-side congestion control: a delay-based bandwidth
+ * estimator fed by transport-wide feedback, and a leaky-bucket pacer.
+ */
+
+#include <rlib/rtypes.h>
+#include <rlib/rtc/rrtctypes.h>
+#include <rlib/rref.h>
+
+#include <rlib/net/proto/rrtp.h>
+
+#include <rlib/ev/revloop.h>
+
+/**
+ * @defgroup r_rtc_congestion WebRTC congestion control
+ * @ingroup r_rtc
+ *
+ * @brief Send-side bandwidth estimation and packet pacing.
+ *
+ * The sender stamps every outgoing packet with a transport-wide sequence
+ * number (@ref r_rtp_buffer_set_transport_cc) and records it with
+ * @ref r_rtc_bwe_on_packet_sent. The receiver reports arrival times back in
+ * TWCC feedback (@ref r_rtcp_buffer_add_twcc); @ref r_rtc_bwe_on_feedback
+ * matches those against the send times, tracks the trend of the one-way
+ * queuing delay over packet groups and runs an AIMD rate controller on the
+ * result, backed off further by the reported loss.
+ *
+ * An @ref RRtcPacer then spreads packets out on an @ref REvLoop at a
+ * multiple of that estimate, so a frame's worth of packets doesn't leave as
+ * one burst and overflow the NIC or a queue along the path.
+ * @ref r_rtc_rtp_sender_enable_congestion_control wires both into an
+ * @ref RRtcRtpSender.
+ *
+ * @{
+ */
+
+R_BEGIN_DECLS
+
+/** @brief Bandwidth usage state detected from the delay trend. */
+typedef enum {
+  R_RTC_BWE_NORMAL = 0,   /**< Queuing delay is stable. */
+  R_RTC_BWE_OVERUSE,      /**< Queuing delay is growing: the path is congested. */
+  R_RTC_BWE_UNDERUSE,     /**< Queuing delay is draining. */
+} RRtcBweUsage;
+
+/** @brief Opaque, refcounted delay-based bandwidth estimator. */
+typedef struct RRtcBwe RRtcBwe;
+
+/** @brief Take a reference (alias for @ref r_ref_ref). */
+#define r_rtc_bwe_ref             r_ref_ref
+/** @brief Release a reference (alias for @ref r_ref_unref). */
+#define r_rtc_bwe_unref           r_ref_unref
+
+/**
+ * @brief Create a bandwidth estimator.
+ * @param start_bps  Initial estimate in bits per second.
+ * @param min_bps    Lower bound for the estimate.
+ * @param max_bps    Upper bound for the estimate (0 for unbounded).
+ * @return New estimator, or @c NULL on bad arguments / allocation failure.
+ */
+R_API RRtcBwe * r_rtc_bwe_new (ruint64 start_bps, ruint64 min_bps,
+    ruint64 max_bps) R_ATTR_MALLOC;
+/**
+ * @brief Record a packet leaving the transport.
+ * @param bwe   The estimator.
+ * @param tseq  Transport-wide sequence number the packet was stamped with.
+ * @param size  Packet size in bytes.
+ * @param now   Send time.
+ */
+R_API void r_rtc_bwe_on_packet_sent (RRtcBwe * bwe, ruint16 tseq, rsize size,
+    RClockTime now);
+/**
+ * @brief Feed a TWCC feedback @p packet into the estimator.
+ * @param bwe     The estimator.
+ * @param packet  RTPFB FMT 15 packet from a mapped @ref RRTCPBuffer.
+ * @param now     Time the feedback was received.
+ * @return @ref R_RTC_OK, or @ref R_RTC_INVAL if @p packet isn't a well-formed
+ *         TWCC feedback packet.
+ */
+R_API RRtcError r_rtc_bwe_on_feedback (RRtcBwe * bwe, const RRTCPPacket * packet,
+    RClockTime now);
+/** @brief Current bandwidth estimate in bits per second. */
+R_API ruint64 r_rtc_bwe_get_bitrate (const RRtcBwe * bwe);
+/** @brief Throughput acknowledged by the receiver, in bits per second (0 until measured). */
+R_API ruint64 r_rtc_bwe_get_acked_bitrate (const RRtcBwe * bwe);
+/** @brief Loss fraction (0.0 - 1.0) over the most recently reported packets. */
+R_API rdouble r_rtc_bwe_get_loss (const RRtcBwe * bwe);
+/** @brief Usage state from the most recent delay-trend update. */
+R_API RRtcBweUsage r_rtc_bwe_get_usage (const RRtcBwe * bwe);
+
+
+/** @brief Pacing interval: how often an @ref RRtcPacer drains its budget. */
+#define R_RTC_PACER_INTERVAL      (5 * R_MSECOND)
+/** @brief Pacing rate relative to the bandwidth estimate, in percent. */
+#define R_RTC_PACER_FACTOR        250
+
+/** @brief Transmit function a pacer hands released packets to. */
+typedef RRtcError (*RRtcPacerSendFunc) (rpointer data, RBuffer * buf);
+
+/** @brief Opaque, refcounted leaky-bucket packet pacer. */
+typedef struct RRtcPacer RRtcPacer;
+
+/** @brief Take a reference (alias for @ref r_ref_ref). */
+#define r_rtc_pacer_ref           r_ref_ref
+/** @brief Release a reference (alias for @ref r_ref_unref). */
+#define r_rtc_pacer_unref         r_ref_unref
+
+/**
+ * @brief Create a pacer on @p loop.
+ * @param loop    Event loop whose clock and timers drive the pacer.
+ * @param bps     Pacing rate in bits per second; 0 sends straight through.
+ * @param send    Called on the loop thread for every released packet.
+ * @param data    User data for @p send.
+ * @param notify  Destroy notifier for @p data.
+ * @return New pacer, or @c NULL on bad arguments / allocation failure.
+ */
+R_API RRtcPacer * r_rtc_pacer_new (REvLoop * loop, ruint64 bps,
+    RRtcPacerSendFunc send, rpointer data, RDestroyNotify notify) R_ATTR_MALLOC;
+/** @brief Change the pacing rate; 0 releases everything queued and stops pacing. */
+R_API void r_rtc_pacer_set_bitrate (RRtcPacer * pacer, ruint64 bps);
+/** @brief Current pacing rate in bits per second. */
+R_API ruint64 r_rtc_pacer_get_bitrate (const RRtcPacer * pacer);
+/**
+ * @brief Queue @p buf for paced transmission.
+ *
+ * The packet goes out immediately if the bucket has budget left, otherwise
+ * on a later pacing interval, always in submission order.
+ */
+R_API RRtcError r_rtc_pacer_enqueue (RRtcPacer * pacer, RBuffer * buf);
+/** @brief Release every queued packet now, ignoring the budget. */
+R_API void r_rtc_pacer_flush (RRtcPacer * pacer);
+/** @brief Number of packets waiting in the queue. */
+R_API rsize r_rtc_pacer_get_queue_size (const RRtcPacer * pacer);
+/** @brief Number of bytes waiting in the queue. */
+R_API rsize r_rtc_pacer_get_queue_bytes (const RRtcPacer * pacer);
+
+R_END_DECLS
+
+/** @} */
+
+#endif /* __R_RTC_CONGESTION_H__ */
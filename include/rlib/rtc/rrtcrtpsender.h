@@ -32,6 +32,7 @@
 #include <rlib/rref.h>
 
 #include <rlib/rtc/rrtcrtpparameters.h>
+#include <rlib/rtc/rrtccongestion.h>
 
 #include <rlib/ev/revloop.h>
 
@@ -89,11 +90,42 @@ R_API RRtcError r_rtc_rtp_sender_stop (RRtcRtpSender * s);
 /**
  * @brief Transmit one prepared RTP @p packet.
  * @param s The sender.
- * @param packet The RTP packet to send.
+ * @param packet The RTP packet to send; with congestion control on its
+ *        transport-cc element is overwritten, see
+ *        @ref r_rtc_rtp_sender_enable_congestion_control.
  * @return @ref R_RTC_OK on success, otherwise an @ref RRtcError.
  */
 R_API RRtcError r_rtc_rtp_sender_send (RRtcRtpSender * s, RBuffer * packet);
 
+/**
+ * @brief Enable transport-wide congestion control on the sender.
+ *
+ * Every RTP packet sent afterwards must carry the transport-cc header
+ * extension element @p twcc_id (a placeholder value is fine), or
+ * @ref r_rtc_rtp_sender_send refuses it with @ref R_RTC_INVAL. The sender
+ * stamps the element with the next transport-wide sequence number as the
+ * packet leaves, feeds TWCC feedback from the remote into an @ref RRtcBwe
+ * and paces the packets out at @ref R_RTC_PACER_FACTOR percent of its
+ * estimate.
+ *
+ * The number is written into the caller's @c RBuffer in place, possibly
+ * only later from the pacer; a buffer that is sent again (or shared with
+ * another sender) is stamped afresh each time it leaves.
+ * Must be called before @ref r_rtc_rtp_sender_start.
+ * @param s The sender.
+ * @param twcc_id Negotiated id of @ref R_RTP_HDREXT_TRANSPORT_CC (1..14).
+ * @param start_bps Initial bandwidth estimate.
+ * @param min_bps Lower bound for the estimate.
+ * @param max_bps Upper bound for the estimate (0 for unbounded).
+ * @return @ref R_RTC_OK on success, otherwise an @ref RRtcError.
+ */
+R_API RRtcError r_rtc_rtp_sender_enable_congestion_control (RRtcRtpSender * s,
+    ruint8 twcc_id, ruint64 start_bps, ruint64 min_bps, ruint64 max_bps);
+/** @brief New reference to the sender's bandwidth estimator, @c NULL if congestion control is off. */
+R_API RRtcBwe * r_rtc_rtp_sender_get_bwe (RRtcRtpSender * s);
+/** @brief Rate RTP is currently paced out at, 0 unless congestion control is on and started. */
+R_API ruint64 r_rtc_rtp_sender_get_pacing_bitrate (RRtcRtpSender * s);
+
 R_END_DECLS
 
 /** @} */
@@ -27,6 +27,8 @@
 
 #include <rlib/data/rlist.h>
 #include <rlib/os/rmodule.h>
+#include <rlib/os/rperf.h>
+#include <rlib/rargparse.h>
 #include <rlib/rtime.h>
 
 #include <stdio.h>
@@ -434,6 +436,22 @@ int main (int argc, rchar ** argv) {
       "Filter on test path - default is * (\"/<suite>/<name>\")", NULL, NULL }, \
     { "output",      'o', R_ARG_OPTION_TYPE_FILENAME, R_ARG_OPTION_FLAG_NONE,   \
       "File to print results to, use - for stdout [default]", NULL, NULL },     \
+    { "bench-reps",   0, R_ARG_OPTION_TYPE_INT,       R_ARG_OPTION_FLAG_NONE,   \
+      "Measured samples per benchmark [10]", NULL, NULL },                      \
+    { "bench-warmup", 0, R_ARG_OPTION_TYPE_INT,       R_ARG_OPTION_FLAG_NONE,   \
+      "Discarded warmup samples per benchmark [1]", NULL, NULL },               \
+    { "bench-time",   0, R_ARG_OPTION_TYPE_INT,       R_ARG_OPTION_FLAG_NONE,   \
+      "Minimum milliseconds per benchmark sample [10]", NULL, NULL },           \
+    { "bench-cpu",    0, R_ARG_OPTION_TYPE_INT,       R_ARG_OPTION_FLAG_NONE,   \
+      "Pin benchmarks to this CPU", NULL, NULL },                               \
+    { "bench-format", 0, R_ARG_OPTION_TYPE_STRING,    R_ARG_OPTION_FLAG_NONE,   \
+      "Benchmark results format, json or csv [json]", NULL, NULL },             \
+    { "bench-output", 0, R_ARG_OPTION_TYPE_FILENAME,  R_ARG_OPTION_FLAG_NONE,   \
+      "File to write benchmark results to", NULL, NULL },                       \
+    { "bench-baseline", 0, R_ARG_OPTION_TYPE_FILENAME, R_ARG_OPTION_FLAG_NONE,  \
+      "Benchmark results file to compare against", NULL, NULL },                \
+    { "bench-threshold", 0, R_ARG_OPTION_TYPE_DOUBLE, R_ARG_OPTION_FLAG_NONE,   \
+      "Slowdown in percent reported as a regression [10]", NULL, NULL },        \
   };                                                                            \
   r_arg_parser_add_option_entries (parser, entries, R_N_ELEMENTS (entries));    \
                                                                                 \
@@ -464,11 +482,13 @@ int main (int argc, rchar ** argv) {
     }                                                                           \
                                                                                 \
     filters = r_arg_parse_ctx_get_option_string_array (ctx, "filter");          \
-    if ((tests = r_test_get_module_tests (NULL, &count)) != NULL &&             \
+    if (r_test_bench_setup_from_args (ctx) &&                                   \
+        (tests = r_test_get_module_tests (NULL, &count)) != NULL &&             \
         (report = r_test_run_tests (tests, count, run_flags, f,                 \
             R_TEST_ALL_MASK, filters)) != NULL) {                               \
       r_test_report_print (report, report_flags, f);                            \
       ret = (int) (report->fail + report->error);                               \
+      ret += (int) r_test_bench_output_end (f);                                 \
       r_test_report_free (report);                                              \
     }                                                                           \
     if (f != stdout)                                                            \
@@ -573,6 +593,123 @@ R_API RTestReport * r_test_run_tests (const RTest * tests, rsize count,
  */
 R_API void r_test_report_print (RTestReport * report, RTestReportFlag flags, FILE * f);
 
+/**
+ * @name Benchmark harness
+ *
+ * Statistics for @c RTEST_BENCH bodies. @c r_test_bench_run calibrates
+ * how many iterations of a callback fill @c target, runs @c warmup
+ * samples it throws away and then @c reps measured samples. It reports
+ * the median, p95, minimum, mean and standard deviation per iteration,
+ * with samples outside the Tukey fences (1.5 IQR) counted as outliers and
+ * left out of the mean and deviation. Where @ref r_perf counters can be
+ * opened the measured samples are also counted in cycles, instructions,
+ * cache misses, branch misses and context switches; without them x86
+ * still gets cycles from the time stamp counter. The measuring thread
+ * can be pinned to one CPU. Every @c RTEST_BENCH additionally prints the
+ * counters for its whole body, less the measured samples of any
+ * r_test_bench_run in it so that the two groups never share the PMU.
+ *
+ * Results always print as a text line. When @c RTEST_MAIN runs with
+ * @c --bench-output or @c --bench-baseline, each result is also collected
+ * (from forked children too). They are then written as JSON or CSV,
+ * and/or compared against a results file saved from an earlier run. A
+ * median slower than the baseline by more than the threshold is reported
+ * as a regression and counts toward the exit code.
+ * @{
+ */
+/** @brief Results file format for @c r_test_bench_output_begin. */
+typedef enum {
+  R_TEST_BENCH_FORMAT_JSON,     /**< One object with a @c results array. */
+  R_TEST_BENCH_FORMAT_CSV,      /**< Header line plus one line per result. */
+} RTestBenchFormat;
+
+/** @brief How @c r_test_bench_run measures. */
+typedef struct {
+  RClockTime target;      /**< Minimum duration of one sample. */
+  ruint warmup;           /**< Samples run first and discarded. */
+  ruint reps;             /**< Samples measured. */
+  int cpu;                /**< CPU to pin the measuring thread to, or -1. */
+} RTestBenchConfig;
+/** @brief Defaults: 10 ms samples, 1 warmup, 10 measured, no pinning. */
+#define R_TEST_BENCH_CONFIG_INIT    { 10 * R_MSECOND, 1, 10, -1 }
+/** @brief Default regression threshold (fraction of the baseline median). */
+#define R_TEST_BENCH_THRESHOLD_DEFAULT  0.10
+
+/** @brief Outcome of one measurement; times are ns per iteration. */
+typedef struct {
+  ruint64 iters;          /**< Iterations per sample. */
+  ruint reps;             /**< Samples measured. */
+  ruint outliers;         /**< Samples outside the Tukey fences. */
+  rsize bytes;            /**< Bytes per iteration, 0 for op benchmarks. */
+  rdouble min;            /**< Fastest sample. */
+  rdouble median;         /**< Median sample. */
+  rdouble p95;            /**< 95th percentile sample. */
+  rdouble mean;           /**< Mean, outliers excluded. */
+  rdouble stddev;         /**< Standard deviation, outliers excluded. */
+  rdouble cycles;         /**< Median cycles per iteration, 0 if unknown. */
+  ruint32 perf;           /**< @c R_PERF_COUNTER_BIT mask of the counters
+                               measured for the fields below. */
+  rdouble instructions;   /**< Instructions per iteration. */
+  rdouble cache_misses;   /**< Cache misses per iteration. */
+  rdouble branch_misses;  /**< Branch misses per iteration. */
+  ruint64 ctxswitches;    /**< Context switches during the measured samples. */
+} RTestBenchResult;
+
+/** @brief Benchmark body: run the operation @p iters times. */
+typedef void (*RTestBenchFunc) (rpointer data, ruint64 iters);
+
+/** @brief Current measurement settings. */
+R_API void r_test_bench_get_config (RTestBenchConfig * config);
+/** @brief Replace the measurement settings (inherited by forked tests). */
+R_API void r_test_bench_set_config (const RTestBenchConfig * config);
+
+/**
+ * @brief Measure @p func, print a result line and record it.
+ *
+ * @param label   Names the measurement within the current test.
+ * @param func    Body; must do the same work for the same @c iters.
+ * @param data    Passed to @p func.
+ * @param bytes   Bytes processed per iteration (adds MiB/s), or 0.
+ * @param result  Receives the statistics; may be @c NULL.
+ * @return @c FALSE if the configuration asks for no samples.
+ */
+R_API rboolean r_test_bench_run (const rchar * label, RTestBenchFunc func,
+    rpointer data, rsize bytes, RTestBenchResult * result);
+/** @brief Record a result for the results file and baseline comparison. */
+R_API void r_test_bench_record (const rchar * label,
+    const RTestBenchResult * result);
+/**
+ * @brief Record a single self-timed run of @p iters iterations, for
+ * benchmarks that do their own timing.
+ */
+R_API void r_test_bench_record_once (const rchar * label, ruint64 iters,
+    rsize bytes, RClockTime elapsed);
+
+/**
+ * @brief Start collecting results.
+ *
+ * @param format     Format of @p output.
+ * @param output     File to write the results to, or @c NULL.
+ * @param baseline   Results file (JSON or CSV) to compare against, or @c NULL.
+ * @param threshold  Relative slowdown of the median that counts as a
+ *                   regression, e.g. 0.10.
+ * @return @c FALSE if nothing can be collected.
+ */
+R_API rboolean r_test_bench_output_begin (RTestBenchFormat format,
+    const rchar * output, const rchar * baseline, rdouble threshold);
+/**
+ * @brief Write the collected results and print the baseline comparison
+ * to @p f.
+ * @return Number of regressions against the baseline.
+ */
+R_API rsize r_test_bench_output_end (FILE * f);
+/**
+ * @brief Apply the @c --bench-* options parsed by @c RTEST_MAIN.
+ * @return @c FALSE on an invalid option value.
+ */
+R_API rboolean r_test_bench_setup_from_args (RArgParseCtx * ctx);
+/** @} */
+
 R_END_DECLS
 
 /** @} */ /* r_test group */
@@ -27,6 +27,7 @@
 #include <rlib/crypto/rkey.h>
 #include <rlib/crypto/rcert.h>
 #include <rlib/crypto/rcipher.h>
+#include <rlib/crypto/recurve.h>
 
 R_BEGIN_DECLS
 
@@ -101,6 +102,16 @@ R_API_HIDDEN void r_poly1305_init (RPoly1305Ctx * ctx, const ruint8 key[32]);
 R_API_HIDDEN void r_poly1305_update (RPoly1305Ctx * ctx, const ruint8 * m, rsize bytes);
 R_API_HIDDEN void r_poly1305_finish (RPoly1305Ctx * ctx, ruint8 mac[16]);
 
+/* Dedicated secp256r1 / secp384r1 scalar multiplication (64 bit limbs,
+ * Solinas reduction, generator comb) and the variable-time u1 G + u2 Q
+ * of verification. Return FALSE without touching @out for any other
+ * curve, leaving it to the generic code. */
+R_API_HIDDEN rboolean r_ecurve_nist_scalar_mul (REcurveAffinePoint * out,
+    const rmpint * scalar, const REcurveAffinePoint * point, const REcurve * curve);
+R_API_HIDDEN rboolean r_ecurve_nist_double_scalar_mul_vartime (REcurveAffinePoint * out,
+    const rmpint * u1, const rmpint * u2, const REcurveAffinePoint * Q,
+    const REcurve * curve);
+
 R_API_HIDDEN RCryptoCipher * r_cipher_aes_new_with_info (const RCryptoCipherInfo * info, const ruint8 * key);
 R_API_HIDDEN extern const RCryptoCipherInfo g__r_crypto_null_cipher;
 R_API_HIDDEN extern const RCryptoCipherInfo g__r_crypto_cipher_aes_128_ecb;
@@ -21,11 +21,18 @@
 
 #include <rlib/crypto/rdh.h>
 
+#include <rlib/concurrency/rthreads.h>
 #include <rlib/format/roid.h>
 #include <rlib/rmem.h>
 
+#include "../data/rmpint-private.h"
 #include "rdh-groups.inc"
 
+/* Comb width for the named-group generator tables. 2^8 entries make a
+ * 2*strength-bit exponent one squaring and one multiply per 8 bits; the
+ * ffdhe8192 table is ~320 KB. */
+#define R_DH_COMB_TEETH     8
+
 typedef struct {
   const ruint8 * p;
   rsize p_len;
@@ -49,6 +56,21 @@ static const RDhGroupParams g__dh_groups[R_DH_GROUP_COUNT] = {
   { rfc7919_ffdhe8192_p, sizeof (rfc7919_ffdhe8192_p), 2, 192 },
 };
 
+/* Per named group state, built on first use and shared read-only from
+ * then on: the Montgomery context and R^2 for p, and a fixed-base comb
+ * over g sized for the group's short private exponent. */
+typedef struct {
+  ROnce once;
+  rmpint p;
+  RMpintFE_BigMontCtx ctx;
+  RMpintFE_Big rr;
+  RMpintFE_BigComb * comb;
+  /* Short private exponent width the comb is sized for, 2*strength */
+  ruint xbits;
+} RDhGroupCache;
+
+static RDhGroupCache g__dh_group_cache[R_DH_GROUP_COUNT];
+
 typedef struct {
   RCryptoKey key;
 
@@ -257,6 +279,73 @@ r_dh_priv_key_new_binary (rconstpointer p, rsize psize,
   return (RCryptoKey *)ret;
 }
 
+static rpointer
+r_dh_group_cache_init (rpointer data)
+{
+  RDhGroupCache * c = data;
+  const RDhGroupParams * gp = &g__dh_groups[c - g__dh_group_cache];
+  rmpint g;
+
+  r_mpint_init_binary (&c->p, gp->p, gp->p_len);
+  if (!r_mpint_fe_big_mont_ctx_init (&c->ctx, &c->p) ||
+      !r_mpint_fe_big_compute_r_squared (&c->rr, &c->p,
+        r_mpint_digits_used (&c->p)))
+    return NULL;
+
+  r_mpint_init (&g);
+  r_mpint_set_u32 (&g, gp->g);
+  c->xbits = 2u * gp->strength;
+  c->comb = r_mpint_fe_big_comb_new (&g, &c->ctx, &c->rr,
+      c->xbits, R_DH_COMB_TEETH);
+  r_mpint_clear (&g);
+
+  return c->comb != NULL ? c : NULL;
+}
+
+/* The cache entry for the named group (p, g) is, or NULL when (p, g) isn't
+ * one or its setup failed. p and g are public, so the comparison doesn't
+ * need to be constant-time. */
+static const RDhGroupCache *
+r_dh_group_cache_lookup (const rmpint * p, const rmpint * g)
+{
+  RDhGroupCache * c;
+  rsize i, pbytes = (r_mpint_bits_used (p) + 7) / 8;
+  ruint8 * pbuf;
+
+  if (r_mpint_cmp_i32 (g, 0) <= 0 || r_mpint_cmp_i32 (g, 255) > 0)
+    return NULL;
+
+  pbuf = r_alloca (pbytes);
+  if (!r_mpint_to_binary_with_size (p, pbuf, pbytes))
+    return NULL;
+  for (i = 0; i < R_DH_GROUP_COUNT; i++) {
+    const RDhGroupParams * gp = &g__dh_groups[i];
+
+    if (gp->p_len == pbytes && r_mpint_cmp_i32 (g, gp->g) == 0 &&
+        r_memcmp (gp->p, pbuf, pbytes) == 0) {
+      c = &g__dh_group_cache[i];
+      return r_call_once (&c->once, r_dh_group_cache_init, c);
+    }
+  }
+
+  return NULL;
+}
+
+/* y := g^x mod p, through the group's comb when (p, g) is a named group
+ * and x fits its table, the generic exponentiation otherwise. */
+static rboolean
+r_dh_compute_y (rmpint * y, const rmpint * g, const rmpint * x,
+    const rmpint * p)
+{
+  const RDhGroupCache * c;
+
+  if ((c = r_dh_group_cache_lookup (p, g)) != NULL &&
+      r_mpint_fe_big_comb_expmod (y, c->comb, x))
+    return TRUE;
+
+  return r_mpint_expmod (y, g, x, p);
+}
+
 /* Generate a DH private key on group (p, g). @ebits caps the private
  * exponent's bit length; 0 (or a value >= the modulus width) means a
  * full-width exponent, the conservative default for arbitrary,
@@ -341,7 +430,7 @@ r_dh_priv_key_gen (const rmpint * p, const rmpint * g, ruint ebits, RPrng * prng
    * it lives (secure-cleared) in ret->x. */
   r_memclear_secure (xbuf, pbytes);
 
-  if (!r_mpint_expmod (&ret->pub.y, &ret->pub.g, &ret->x, &ret->pub.p)) {
+  if (!r_dh_compute_y (&ret->pub.y, &ret->pub.g, &ret->x, &ret->pub.p)) {
     r_dh_priv_key_free (ret);
     ret = NULL;
   } else {
@@ -409,8 +498,10 @@ r_dh_compute_shared (const RCryptoKey * priv, const RCryptoKey * peer_pub,
 {
   const RDhPrivKey * me;
   const RDhPubKey * peer;
+  const RDhGroupCache * c;
   rmpint shared, p_1;
   rsize pbytes;
+  ruint ebits;
   RCryptoResult ret;
 
   if (R_UNLIKELY (priv == NULL || peer_pub == NULL))
@@ -448,8 +539,20 @@ r_dh_compute_shared (const RCryptoKey * priv, const RCryptoKey * peer_pub,
   }
   r_mpint_clear (&p_1);
 
+  /* Named groups skip the per-call Montgomery setup (a full-width
+   * division for R^2) by using the cached context. The loop runs over a
+   * public bit count, never x's own length: the group's short exponent
+   * width for keys generated on it, the modulus width for anything else
+   * (imported or full-width keys), as RSA does with d < n. */
   r_mpint_init (&shared);
-  if (!r_mpint_expmod (&shared, &peer->y, &me->x, &me->pub.p)) {
+  if ((c = r_dh_group_cache_lookup (&me->pub.p, &me->pub.g)) != NULL) {
+    ebits = r_mpint_bits_used (&me->x) <= c->xbits ?
+      c->xbits : r_mpint_bits_used (&c->p);
+  }
+  if (c != NULL ?
+      !r_mpint_fe_big_expmod_ct (&shared, &peer->y, &me->x, &c->p, &c->ctx,
+        &c->rr, ebits) :
+      !r_mpint_expmod (&shared, &peer->y, &me->x, &me->pub.p)) {
     ret = R_CRYPTO_ERROR;
   } else if (!r_mpint_to_binary_with_size (&shared, out, pbytes)) {
     ret = R_CRYPTO_ERROR;
@@ -493,7 +596,7 @@ r_dh_priv_key_new_from_asn1 (RAsn1BinDecoder * dec, RAsn1BinTLV * tlv)
 
   /* Recover y from (g, x, p) so the caller has a complete key without
    * having to compute it themselves. */
-  if (!r_mpint_expmod (&ret->pub.y, &ret->pub.g, &ret->x, &ret->pub.p)) {
+  if (!r_dh_compute_y (&ret->pub.y, &ret->pub.g, &ret->x, &ret->pub.p)) {
     r_dh_priv_key_free (ret);
     return NULL;
   }
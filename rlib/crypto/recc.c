@@ -603,7 +603,7 @@ r_ecdsa_verify (const RCryptoKey * key, RMsgDigestType mdtype,
    * info structs), so cast through the pub view either way. */
   const REccPubKey * pk = (const REccPubKey *)key;
   rmpint r, s, e, w, u1, u2, x_mod_n;
-  REcurveAffinePoint u1G, u2Q, P;
+  REcurveAffinePoint P;
   RCryptoResult ret = R_CRYPTO_VERIFY_FAILED;
 
   (void) mdtype;
@@ -628,19 +628,16 @@ r_ecdsa_verify (const RCryptoKey * key, RMsgDigestType mdtype,
   r_mpint_init (&u1);
   r_mpint_init (&u2);
   r_mpint_init (&x_mod_n);
-  r_ecurve_point_init (&u1G);
-  r_ecurve_point_init (&u2Q);
   r_ecurve_point_init (&P);
 
   /* P = u1*G + u2*Q where u1 = e*w, u2 = r*w, w = s^-1 mod n. Valid
    * iff P is finite and P.x mod n == r. Variable-time throughout -
-   * all inputs are public so no CT requirement. */
+   * all inputs are public so no CT requirement, which lets the
+   * double scalar mul share its doublings between both terms. */
   if (r_mpint_invmod (&w, &s, &pk->curve.n) &&
       r_mpint_mul (&u1, &e, &w) && r_mpint_mod (&u1, &u1, &pk->curve.n) &&
       r_mpint_mul (&u2, &r, &w) && r_mpint_mod (&u2, &u2, &pk->curve.n) &&
-      r_ecurve_point_scalar_mul (&u1G, &u1, &pk->curve.G, &pk->curve) &&
-      r_ecurve_point_scalar_mul (&u2Q, &u2, &pk->Q, &pk->curve) &&
-      r_ecurve_point_add (&P, &u1G, &u2Q, &pk->curve) &&
+      r_ecurve_point_double_scalar_mul_vartime (&P, &u1, &u2, &pk->Q, &pk->curve) &&
       !P.is_infinity &&
       r_mpint_mod (&x_mod_n, &P.x, &pk->curve.n) &&
       r_mpint_cmp (&x_mod_n, &r) == 0) {
@@ -652,8 +649,6 @@ r_ecdsa_verify (const RCryptoKey * key, RMsgDigestType mdtype,
   r_mpint_clear (&u1);
   r_mpint_clear (&u2);
   r_mpint_clear (&x_mod_n);
-  r_ecurve_point_clear (&u1G);
-  r_ecurve_point_clear (&u2Q);
   r_ecurve_point_clear (&P);
 
 out:
@@ -0,0 +1,861 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2016  Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+
+#include "config.h"
+#include "rcrypto-private.h"
+
+#include <rlib/crypto/recurve.h>
+
+#include <rlib/concurrency/rthreads.h>
+#include <rlib/rmem.h>
+
+/* secp256r1 and secp384r1 scalar multiplication on dedicated field
+ * code. Elements are 4 / 6 little-endian 64 bit limbs in normal form
+ * (no Montgomery domain): a product is computed in full and folded
+ * back with the Solinas reduction for the special form of p (NIST
+ * FIPS 186-4, D.2), so there is no conversion in or out.
+ *
+ * Everything that touches the scalar runs the same instruction
+ * sequence whatever its value: table entries are read by scanning the
+ * whole table with masks, identities are handled by masked selects
+ * and carries by masks rather than branches. */
+
+#define R_NIST_MAX_LIMBS      6
+#define R_NIST_COMB_TEETH     4
+#define R_NIST_COMB_SIZE      (1 << R_NIST_COMB_TEETH)
+#define R_NIST_WINDOW_BITS    4
+#define R_NIST_WINDOW_SIZE    (1 << R_NIST_WINDOW_BITS)
+/* wNAF widths for the variable-time u1 * G + u2 * Q of verification:
+ * a wide one against the cached odd multiples of G, a narrower one
+ * for Q whose table is rebuilt per call. */
+#define R_NIST_WNAF_G_BITS    7
+#define R_NIST_WNAF_Q_BITS    5
+#define R_NIST_WNAF_G_SIZE    (1 << (R_NIST_WNAF_G_BITS - 2))
+#define R_NIST_WNAF_Q_SIZE    (1 << (R_NIST_WNAF_Q_BITS - 2))
+
+typedef struct {
+  ruint64 v[R_NIST_MAX_LIMBS];
+} RNistFE;
+
+/* Jacobian (X/Z^2, Y/Z^3); Z = 0 is the identity. */
+typedef struct {
+  RNistFE X, Y, Z;
+} RNistJacobian;
+
+typedef struct {
+  RNistFE x, y;
+} RNistAffine;
+
+typedef struct RNistCurve RNistCurve;
+struct RNistCurve {
+  REcurveID id;
+  ruint limbs;
+  ruint bits;
+  RNistFE p;
+  RNistFE p_minus_2;
+  void (*mul) (RNistFE * r, const RNistFE * a, const RNistFE * b);
+
+  /* Generator comb: table t holds, for every nonzero 4 bit index j,
+   * sum over set bits i of j of 2^((2i + t) * bits / 8) * G. */
+  ROnce comb_once;
+  RNistAffine * comb;
+  /* G, 3G, 5G, ... for the wNAF in verification. */
+  ROnce wnaf_once;
+  RNistAffine * wnaf;
+};
+
+/* ------------------------------------------------------------------ */
+/* Limb arithmetic                                                    */
+/* ------------------------------------------------------------------ */
+
+/* a * b + c + d as 128 bits; never overflows. */
+static inline ruint64
+r_nist_mac (ruint64 a, ruint64 b, ruint64 c, ruint64 d, ruint64 * hi)
+{
+#if defined (__SIZEOF_INT128__)
+  unsigned __int128 t = (unsigned __int128)a * b + c + d;
+  *hi = (ruint64)(t >> 64);
+  return (ruint64)t;
+#else
+  ruint64 al = a & RUINT32_MAX, ah = a >> 32;
+  ruint64 bl = b & RUINT32_MAX, bh = b >> 32;
+  ruint64 ll = al * bl, lh = al * bh, hl = ah * bl, hh = ah * bh;
+  ruint64 mid = (ll >> 32) + (lh & RUINT32_MAX) + (hl & RUINT32_MAX);
+  ruint64 lo = (ll & RUINT32_MAX) | (mid << 32), carry;
+
+  hh += (mid >> 32) + (lh >> 32) + (hl >> 32);
+  lo += c;
+  carry = lo < c;
+  lo += d;
+  carry += lo < d;
+  *hi = hh + carry;
+  return lo;
+#endif
+}
+
+static inline void
+r_nist_mul_wide (ruint64 * t, const ruint64 * a, const ruint64 * b, ruint n)
+{
+  ruint i, j;
+  ruint64 carry;
+
+  for (i = 0; i < n; i++)
+    t[i] = 0;
+  for (i = 0; i < n; i++) {
+    carry = 0;
+    for (j = 0; j < n; j++)
+      t[i + j] = r_nist_mac (a[i], b[j], t[i + j], carry, &carry);
+    t[i + n] = carry;
+  }
+}
+
+/* r = a - b over @n limbs, returning the borrow (0 or 1). */
+static inline ruint64
+r_nist_sub_limbs (ruint64 * r, const ruint64 * a, const ruint64 * b, ruint n)
+{
+  ruint64 borrow = 0, bw, t;
+  ruint i;
+
+  for (i = 0; i < n; i++) {
+    t = a[i] - b[i];
+    bw = (a[i] < b[i]) | (t < borrow);
+    r[i] = t - borrow;
+    borrow = bw;
+  }
+  return borrow;
+}
+
+/* r = a + b over @n limbs, returning the carry (0 or 1). */
+static inline ruint64
+r_nist_add_limbs (ruint64 * r, const ruint64 * a, const ruint64 * b, ruint n)
+{
+  ruint64 carry = 0, t;
+  ruint i;
+
+  for (i = 0; i < n; i++) {
+    t = a[i] + carry;
+    carry = t < carry;
+    r[i] = t + b[i];
+    carry |= r[i] < t;
+  }
+  return carry;
+}
+
+/* r = mask ? a : r, @mask all ones or zero. */
+static inline void
+r_nist_fe_cmov (RNistFE * r, const RNistFE * a, ruint64 mask, ruint n)
+{
+  ruint i;
+  for (i = 0; i < n; i++)
+    r->v[i] = (r->v[i] & ~mask) | (a->v[i] & mask);
+}
+
+/* All ones if @a is zero. */
+static inline ruint64
+r_nist_fe_iszero_mask (const RNistFE * a, ruint n)
+{
+  ruint64 acc = 0;
+  ruint i;
+
+  for (i = 0; i < n; i++)
+    acc |= a->v[i];
+  return ((acc | ((ruint64)0 - acc)) >> 63) - 1;
+}
+
+/* ------------------------------------------------------------------ */
+/* Solinas reduction                                                  */
+/* ------------------------------------------------------------------ */
+
+/* Carry signed 32 bit word sums @w down to 0..2^32-1 each, returning
+ * the signed overflow above the top word. */
+static inline rint64
+r_nist_carry (rint64 * w, ruint nw)
+{
+  rint64 carry = 0;
+  ruint i;
+
+  for (i = 0; i < nw; i++) {
+    w[i] += carry;
+    carry = w[i] >> 32;
+    w[i] &= RUINT32_MAX;
+  }
+  return carry;
+}
+
+/* Pack carried 32 bit words into limbs, then subtract p once if the
+ * value is not already below it. */
+static inline void
+r_nist_pack (RNistFE * r, const rint64 * w, const RNistFE * p, ruint limbs)
+{
+  RNistFE t;
+  ruint64 mask;
+  ruint i;
+
+  for (i = 0; i < limbs; i++)
+    r->v[i] = (ruint64)w[2 * i] | ((ruint64)w[2 * i + 1] << 32);
+  mask = r_nist_sub_limbs (t.v, r->v, p->v, limbs) - 1;
+  r_nist_fe_cmov (r, &t, mask, limbs);
+}
+
+#define R_NIST_WORDS(t, c, nw) R_STMT_START {                               \
+  ruint _i;                                                                 \
+  for (_i = 0; _i < (nw); _i++)                                             \
+    (c)[_i] = (rint64)(((t)[_i / 2] >> (32 * (_i & 1))) & RUINT32_MAX);     \
+} R_STMT_END
+
+static RNistCurve g__nist_p256;
+static RNistCurve g__nist_p384;
+
+/* p = 2^256 - 2^224 + 2^192 + 2^96 - 1 */
+static void
+r_nist_p256_mul (RNistFE * r, const RNistFE * a, const RNistFE * b)
+{
+  ruint64 t[8];
+  rint64 c[16], w[8], carry;
+  ruint i;
+
+  r_nist_mul_wide (t, a->v, b->v, 4);
+  R_NIST_WORDS (t, c, 16);
+
+  w[0] = c[0] + c[8] + c[9] - c[11] - c[12] - c[13] - c[14];
+  w[1] = c[1] + c[9] + c[10] - c[12] - c[13] - c[14] - c[15];
+  w[2] = c[2] + c[10] + c[11] - c[13] - c[14] - c[15];
+  w[3] = c[3] + 2 * c[11] + 2 * c[12] + c[13] - c[15] - c[8] - c[9];
+  w[4] = c[4] + 2 * c[12] + 2 * c[13] + c[14] - c[9] - c[10];
+  w[5] = c[5] + 2 * c[13] + 2 * c[14] + c[15] - c[10] - c[11];
+  w[6] = c[6] + 3 * c[14] + 2 * c[15] + c[13] - c[8] - c[9];
+  w[7] = c[7] + 3 * c[15] + c[8] - c[10] - c[11] - c[12] - c[13];
+
+  /* The overflow above 2^256 folds back as 2^256 mod p =
+   * 2^224 - 2^192 - 2^96 + 1. Two folds always leave none, and a
+   * value below 2p. */
+  carry = r_nist_carry (w, 8);
+  for (i = 0; i < 2; i++) {
+    w[0] += carry;
+    w[3] -= carry;
+    w[6] -= carry;
+    w[7] += carry;
+    carry = r_nist_carry (w, 8);
+  }
+  r_nist_pack (r, w, &g__nist_p256.p, 4);
+}
+
+/* p = 2^384 - 2^128 - 2^96 + 2^32 - 1 */
+static void
+r_nist_p384_mul (RNistFE * r, const RNistFE * a, const RNistFE * b)
+{
+  ruint64 t[12];
+  rint64 c[24], w[12], carry;
+  ruint i;
+
+  r_nist_mul_wide (t, a->v, b->v, 6);
+  R_NIST_WORDS (t, c, 24);
+
+  w[0] = c[0] + c[12] + c[20] + c[21] - c[23];
+  w[1] = c[1] - c[12] + c[13] - c[20] + c[22] + c[23];
+  w[2] = c[2] - c[13] + c[14] - c[21] + c[23];
+  w[3] = c[3] + c[12] - c[14] + c[15] + c[20] + c[21] - c[22] - c[23];
+  w[4] = c[4] + c[12] + c[13] - c[15] + c[16] + c[20] + 2 * c[21] + c[22] - 2 * c[23];
+  w[5] = c[5] + c[13] + c[14] - c[16] + c[17] + c[21] + 2 * c[22] + c[23];
+  w[6] = c[6] + c[14] + c[15] - c[17] + c[18] + c[22] + 2 * c[23];
+  w[7] = c[7] + c[15] + c[16] - c[18] + c[19] + c[23];
+  w[8] = c[8] + c[16] + c[17] - c[19] + c[20];
+  w[9] = c[9] + c[17] + c[18] - c[20] + c[21];
+  w[10] = c[10] + c[18] + c[19] - c[21] + c[22];
+  w[11] = c[11] + c[19] + c[20] - c[22] + c[23];
+
+  /* 2^384 mod p = 2^128 + 2^96 - 2^32 + 1, folded as for P-256. */
+  carry = r_nist_carry (w, 12);
+  for (i = 0; i < 2; i++) {
+    w[0] += carry;
+    w[1] -= carry;
+    w[3] += carry;
+    w[4] += carry;
+    carry = r_nist_carry (w, 12);
+  }
+  r_nist_pack (r, w, &g__nist_p384.p, 6);
+}
+
+static RNistAffine g__nist_p256_comb[2 * (R_NIST_COMB_SIZE - 1)];
+static RNistAffine g__nist_p384_comb[2 * (R_NIST_COMB_SIZE - 1)];
+static RNistAffine g__nist_p256_wnaf[R_NIST_WNAF_G_SIZE];
+static RNistAffine g__nist_p384_wnaf[R_NIST_WNAF_G_SIZE];
+
+static RNistCurve g__nist_p256 = {
+  R_ECURVE_ID_SECP256R1, 4, 256,
+  { { RUINT64_CONSTANT (0xffffffffffffffff), RUINT64_CONSTANT (0x00000000ffffffff),
+      RUINT64_CONSTANT (0x0000000000000000), RUINT64_CONSTANT (0xffffffff00000001) } },
+  { { RUINT64_CONSTANT (0xfffffffffffffffd), RUINT64_CONSTANT (0x00000000ffffffff),
+      RUINT64_CONSTANT (0x0000000000000000), RUINT64_CONSTANT (0xffffffff00000001) } },
+  r_nist_p256_mul,
+  R_ONCE_INIT, g__nist_p256_comb,
+  R_ONCE_INIT, g__nist_p256_wnaf,
+};
+
+static RNistCurve g__nist_p384 = {
+  R_ECURVE_ID_SECP384R1, 6, 384,
+  { { RUINT64_CONSTANT (0x00000000ffffffff), RUINT64_CONSTANT (0xffffffff00000000),
+      RUINT64_CONSTANT (0xfffffffffffffffe), RUINT64_CONSTANT (0xffffffffffffffff),
+      RUINT64_CONSTANT (0xffffffffffffffff), RUINT64_CONSTANT (0xffffffffffffffff) } },
+  { { RUINT64_CONSTANT (0x00000000fffffffd), RUINT64_CONSTANT (0xffffffff00000000),
+      RUINT64_CONSTANT (0xfffffffffffffffe), RUINT64_CONSTANT (0xffffffffffffffff),
+      RUINT64_CONSTANT (0xffffffffffffffff), RUINT64_CONSTANT (0xffffffffffffffff) } },
+  r_nist_p384_mul,
+  R_ONCE_INIT, g__nist_p384_comb,
+  R_ONCE_INIT, g__nist_p384_wnaf,
+};
+
+static RNistCurve *
+r_nist_curve_for (const REcurve * curve)
+{
+  switch (curve->id) {
+    case R_ECURVE_ID_SECP256R1: return &g__nist_p256;
+    case R_ECURVE_ID_SECP384R1: return &g__nist_p384;
+    default: return NULL;
+  }
+}
+
+/* ------------------------------------------------------------------ */
+/* Field operations                                                   */
+/* ------------------------------------------------------------------ */
+
+static inline void
+r_nist_fe_mul (const RNistCurve * c, RNistFE * r, const RNistFE * a, const RNistFE * b)
+{
+  c->mul (r, a, b);
+}
+
+static inline void
+r_nist_fe_sqr (const RNistCurve * c, RNistFE * r, const RNistFE * a)
+{
+  c->mul (r, a, a);
+}
+
+static void
+r_nist_fe_add (const RNistCurve * c, RNistFE * r, const RNistFE * a, const RNistFE * b)
+{
+  RNistFE t;
+  ruint64 carry, borrow;
+
+  carry = r_nist_add_limbs (r->v, a->v, b->v, c->limbs);
+  borrow = r_nist_sub_limbs (t.v, r->v, c->p.v, c->limbs);
+  /* Keep r - p unless the sum fit and was below p. */
+  r_nist_fe_cmov (r, &t, (ruint64)0 - (carry | (borrow ^ 1)), c->limbs);
+}
+
+static void
+r_nist_fe_sub (const RNistCurve * c, RNistFE * r, const RNistFE * a, const RNistFE * b)
+{
+  RNistFE t;
+  ruint64 borrow;
+  ruint i;
+
+  borrow = r_nist_sub_limbs (r->v, a->v, b->v, c->limbs);
+  for (i = 0; i < c->limbs; i++)
+    t.v[i] = c->p.v[i] & ((ruint64)0 - borrow);
+  r_nist_add_limbs (r->v, r->v, t.v, c->limbs);
+}
+
+/* a^(p-2); the exponent is public so the branch on its bits is fine. */
+static void
+r_nist_fe_inv (const RNistCurve * c, RNistFE * r, const RNistFE * a)
+{
+  RNistFE t = *a;
+  ruint i;
+
+  for (i = c->bits - 1; i-- > 0;) {
+    r_nist_fe_sqr (c, &t, &t);
+    if ((c->p_minus_2.v[i / 64] >> (i % 64)) & 1)
+      r_nist_fe_mul (c, &t, &t, a);
+  }
+  *r = t;
+  r_memclear_secure (&t, sizeof (t));
+}
+
+static void
+r_nist_fe_from_mpint (const RNistCurve * c, RNistFE * r, const rmpint * a)
+{
+  ruint i;
+
+  r_memclear (r, sizeof (*r));
+  for (i = 0; i < a->dig_used && i < 2 * c->limbs; i++)
+    r->v[i / 2] |= (ruint64)a->data[i] << (32 * (i & 1));
+}
+
+static void
+r_nist_fe_to_mpint (const RNistCurve * c, rmpint * r, const RNistFE * a)
+{
+  ruint8 bin[R_NIST_MAX_LIMBS * 8];
+  rsize size = c->limbs * 8;
+  ruint i;
+
+  for (i = 0; i < size; i++)
+    bin[size - 1 - i] = (ruint8)(a->v[i / 8] >> (8 * (i % 8)));
+  r_mpint_set_binary (r, bin, size);
+  r_memclear_secure (bin, sizeof (bin));
+}
+
+/* ------------------------------------------------------------------ */
+/* Point arithmetic, a = -3                                           */
+/* ------------------------------------------------------------------ */
+
+/* dbl-2001-b. Z = 0 stays Z = 0, so doubling the identity needs no
+ * special case. @r may alias @p. */
+static void
+r_nist_jp_dbl (const RNistCurve * c, RNistJacobian * r, const RNistJacobian * p)
+{
+  RNistFE delta, gamma, beta, alpha, t0, t1;
+
+  r_nist_fe_sqr (c, &delta, &p->Z);
+  r_nist_fe_sqr (c, &gamma, &p->Y);
+  r_nist_fe_mul (c, &beta, &p->X, &gamma);
+
+  /* alpha = 3 * (X - delta) * (X + delta) */
+  r_nist_fe_sub (c, &t0, &p->X, &delta);
+  r_nist_fe_add (c, &t1, &p->X, &delta);
+  r_nist_fe_mul (c, &alpha, &t0, &t1);
+  r_nist_fe_add (c, &t0, &alpha, &alpha);
+  r_nist_fe_add (c, &alpha, &t0, &alpha);
+
+  /* Z3 = (Y + Z)^2 - gamma - delta */
+  r_nist_fe_add (c, &t0, &p->Y, &p->Z);
+  r_nist_fe_sqr (c, &t0, &t0);
+  r_nist_fe_sub (c, &t0, &t0, &gamma);
+  r_nist_fe_sub (c, &r->Z, &t0, &delta);
+
+  /* X3 = alpha^2 - 8 * beta */
+  r_nist_fe_add (c, &beta, &beta, &beta);
+  r_nist_fe_add (c, &beta, &beta, &beta);
+  r_nist_fe_sqr (c, &t0, &alpha);
+  r_nist_fe_add (c, &t1, &beta, &beta);
+  r_nist_fe_sub (c, &r->X, &t0, &t1);
+
+  /* Y3 = alpha * (4 * beta - X3) - 8 * gamma^2 */
+  r_nist_fe_sub (c, &t0, &beta, &r->X);
+  r_nist_fe_mul (c, &t0, &alpha, &t0);
+  r_nist_fe_sqr (c, &gamma, &gamma);
+  r_nist_fe_add (c, &gamma, &gamma, &gamma);
+  r_nist_fe_add (c, &gamma, &gamma, &gamma);
+  r_nist_fe_add (c, &gamma, &gamma, &gamma);
+  r_nist_fe_sub (c, &r->Y, &t0, &gamma);
+}
+
+/* add-2007-bl, or madd-2007-bl when @q_affine (q->Z is taken as 1).
+ * An identity on either side is patched in with masked selects. The
+ * formula can't double; equal inputs only occur for a negligible set
+ * of scalars (an accumulated multiple colliding with the addend), and
+ * that case branches to the doubling. @r may alias @p. */
+static void
+r_nist_jp_add (const RNistCurve * c, RNistJacobian * r, const RNistJacobian * p,
+    const RNistJacobian * q, rboolean q_affine, ruint64 q_inf)
+{
+  RNistFE z1z1, z2z2, u1, u2, s1, s2, h, i, j, rr, v, t;
+  RNistJacobian out;
+  ruint64 p_inf = r_nist_fe_iszero_mask (&p->Z, c->limbs);
+  ruint n = c->limbs;
+
+  r_nist_fe_sqr (c, &z1z1, &p->Z);
+  r_nist_fe_mul (c, &u2, &q->X, &z1z1);
+  r_nist_fe_mul (c, &s2, &q->Y, &p->Z);
+  r_nist_fe_mul (c, &s2, &s2, &z1z1);
+  if (q_affine) {
+    u1 = p->X;
+    s1 = p->Y;
+  } else {
+    r_nist_fe_sqr (c, &z2z2, &q->Z);
+    r_nist_fe_mul (c, &u1, &p->X, &z2z2);
+    r_nist_fe_mul (c, &s1, &p->Y, &q->Z);
+    r_nist_fe_mul (c, &s1, &s1, &z2z2);
+  }
+
+  r_nist_fe_sub (c, &h, &u2, &u1);
+  r_nist_fe_sub (c, &rr, &s2, &s1);
+
+  if (R_UNLIKELY ((r_nist_fe_iszero_mask (&h, n) & r_nist_fe_iszero_mask (&rr, n) &
+          ~p_inf & ~q_inf) != 0)) {
+    r_nist_jp_dbl (c, r, p);
+    return;
+  }
+
+  /* I = (2H)^2, J = H * I, r = 2 (S2 - S1), V = U1 * I */
+  r_nist_fe_add (c, &i, &h, &h);
+  r_nist_fe_sqr (c, &i, &i);
+  r_nist_fe_mul (c, &j, &h, &i);
+  r_nist_fe_add (c, &rr, &rr, &rr);
+  r_nist_fe_mul (c, &v, &u1, &i);
+
+  /* X3 = r^2 - J - 2V */
+  r_nist_fe_sqr (c, &out.X, &rr);
+  r_nist_fe_sub (c, &out.X, &out.X, &j);
+  r_nist_fe_sub (c, &out.X, &out.X, &v);
+  r_nist_fe_sub (c, &out.X, &out.X, &v);
+
+  /* Y3 = r (V - X3) - 2 S1 J */
+  r_nist_fe_sub (c, &t, &v, &out.X);
+  r_nist_fe_mul (c, &out.Y, &rr, &t);
+  r_nist_fe_mul (c, &t, &s1, &j);
+  r_nist_fe_add (c, &t, &t, &t);
+  r_nist_fe_sub (c, &out.Y, &out.Y, &t);
+
+  /* Z3 = ((Z1 + Z2)^2 - Z1Z1 - Z2Z2) H, i.e. 2 Z1 Z2 H */
+  if (q_affine) {
+    r_nist_fe_add (c, &t, &p->Z, &p->Z);
+  } else {
+    r_nist_fe_mul (c, &t, &p->Z, &q->Z);
+    r_nist_fe_add (c, &t, &t, &t);
+  }
+  r_nist_fe_mul (c, &out.Z, &t, &h);
+
+  /* Identity fix-ups: p = O gives q, q = O gives p. */
+  r_nist_fe_cmov (&out.X, &q->X, p_inf, n);
+  r_nist_fe_cmov (&out.Y, &q->Y, p_inf, n);
+  if (q_affine) {
+    r_memclear (&t, sizeof (t));
+    t.v[0] = 1;
+    r_nist_fe_cmov (&out.Z, &t, p_inf, n);
+  } else {
+    r_nist_fe_cmov (&out.Z, &q->Z, p_inf, n);
+  }
+  r_nist_fe_cmov (&out.X, &p->X, q_inf, n);
+  r_nist_fe_cmov (&out.Y, &p->Y, q_inf, n);
+  r_nist_fe_cmov (&out.Z, &p->Z, q_inf, n);
+
+  *r = out;
+}
+
+static void
+r_nist_jp_to_affine (const RNistCurve * c, RNistAffine * r, const RNistJacobian * p)
+{
+  RNistFE zi, zi2;
+
+  r_nist_fe_inv (c, &zi, &p->Z);
+  r_nist_fe_sqr (c, &zi2, &zi);
+  r_nist_fe_mul (c, &r->x, &p->X, &zi2);
+  r_nist_fe_mul (c, &zi2, &zi2, &zi);
+  r_nist_fe_mul (c, &r->y, &p->Y, &zi2);
+}
+
+static rboolean
+r_nist_jp_to_point (const RNistCurve * c, REcurveAffinePoint * out,
+    const RNistJacobian * p)
+{
+  RNistAffine a;
+
+  /* Whether the result is the identity is public (it's the output). */
+  if (r_nist_fe_iszero_mask (&p->Z, c->limbs) != 0) {
+    r_ecurve_point_set_infinity (out);
+    return TRUE;
+  }
+
+  r_nist_jp_to_affine (c, &a, p);
+  r_nist_fe_to_mpint (c, &out->x, &a.x);
+  r_nist_fe_to_mpint (c, &out->y, &a.y);
+  out->is_infinity = FALSE;
+  r_memclear_secure (&a, sizeof (a));
+  return TRUE;
+}
+
+/* ------------------------------------------------------------------ */
+/* Scalar multiplication                                              */
+/* ------------------------------------------------------------------ */
+
+static inline ruint
+r_nist_scalar_bit (const RNistFE * k, ruint bit)
+{
+  return (ruint)(k->v[bit / 64] >> (bit % 64)) & 1;
+}
+
+static rpointer
+r_nist_comb_init (rpointer data)
+{
+  const REcurve * curve = data;
+  RNistCurve * c = r_nist_curve_for (curve);
+  RNistJacobian base[2 * R_NIST_COMB_TEETH], t[R_NIST_COMB_SIZE];
+  ruint spacing = c->bits / (2 * R_NIST_COMB_TEETH);
+  ruint i, j, tab;
+
+  /* base[i] = 2^(i * spacing) G */
+  r_memclear (&base[0], sizeof (base[0]));
+  r_nist_fe_from_mpint (c, &base[0].X, &curve->G.x);
+  r_nist_fe_from_mpint (c, &base[0].Y, &curve->G.y);
+  base[0].Z.v[0] = 1;
+  for (i = 1; i < R_N_ELEMENTS (base); i++) {
+    base[i] = base[i - 1];
+    for (j = 0; j < spacing; j++)
+      r_nist_jp_dbl (c, &base[i], &base[i]);
+  }
+
+  for (tab = 0; tab < 2; tab++) {
+    r_memclear (&t[0], sizeof (t[0]));
+    for (j = 1; j < R_NIST_COMB_SIZE; j++) {
+      ruint low = RUINT32_CTZ (j);
+      r_nist_jp_add (c, &t[j], &t[j & (j - 1)], &base[2 * low + tab], FALSE, 0);
+      r_nist_jp_to_affine (c, &c->comb[tab * (R_NIST_COMB_SIZE - 1) + j - 1], &t[j]);
+    }
+  }
+
+  return c->comb;
+}
+
+/* Masked read of entry @idx (1-based; 0 yields the identity) of a
+ * comb table. Returns all ones in @inf for the identity. */
+static void
+r_nist_comb_lookup (const RNistCurve * c, RNistJacobian * r, ruint64 * inf,
+    const RNistAffine * tab, ruint idx)
+{
+  ruint i;
+
+  r_memclear (r, sizeof (*r));
+  for (i = 1; i < R_NIST_COMB_SIZE; i++) {
+    ruint64 mask = (ruint64)0 - (ruint64)(((i ^ idx) - 1) >> 31 & 1);
+    r_nist_fe_cmov (&r->X, &tab[i - 1].x, mask, c->limbs);
+    r_nist_fe_cmov (&r->Y, &tab[i - 1].y, mask, c->limbs);
+  }
+  *inf = (ruint64)0 - (ruint64)((idx - 1) >> 31 & 1);
+}
+
+/* k * G with a two table, 8 teeth comb: bits/8 rounds of one doubling
+ * and two mixed additions. */
+static void
+r_nist_mul_base (RNistCurve * c, RNistJacobian * acc, const RNistFE * k,
+    const REcurve * curve)
+{
+  const RNistAffine * comb = r_call_once (&c->comb_once,
+      r_nist_comb_init, (rpointer)curve);
+  ruint spacing = c->bits / (2 * R_NIST_COMB_TEETH);
+  RNistJacobian q;
+  ruint64 inf;
+  ruint i, t, tab, idx;
+
+  r_memclear (acc, sizeof (*acc));
+  for (i = spacing; i-- > 0;) {
+    if (i + 1 < spacing)
+      r_nist_jp_dbl (c, acc, acc);
+    for (tab = 0; tab < 2; tab++) {
+      for (t = 0, idx = 0; t < R_NIST_COMB_TEETH; t++)
+        idx |= r_nist_scalar_bit (k, i + (2 * t + tab) * spacing) << t;
+      r_nist_comb_lookup (c, &q, &inf, comb + tab * (R_NIST_COMB_SIZE - 1), idx);
+      r_nist_jp_add (c, acc, acc, &q, TRUE, inf);
+    }
+  }
+
+  r_memclear_secure (&q, sizeof (q));
+}
+
+/* k * P with fixed 4 bit windows over a table of 0..15 P. */
+static void
+r_nist_mul_point (const RNistCurve * c, RNistJacobian * acc, const RNistFE * k,
+    const REcurveAffinePoint * point)
+{
+  RNistJacobian tab[R_NIST_WINDOW_SIZE], q;
+  ruint i, j, idx;
+
+  r_memclear (&tab[0], sizeof (tab[0]));
+  r_memclear (&tab[1], sizeof (tab[1]));
+  r_nist_fe_from_mpint (c, &tab[1].X, &point->x);
+  r_nist_fe_from_mpint (c, &tab[1].Y, &point->y);
+  tab[1].Z.v[0] = 1;
+  r_nist_jp_dbl (c, &tab[2], &tab[1]);
+  for (i = 3; i < R_NIST_WINDOW_SIZE; i++)
+    r_nist_jp_add (c, &tab[i], &tab[i - 1], &tab[1], FALSE, 0);
+
+  r_memclear (acc, sizeof (*acc));
+  for (i = c->bits / R_NIST_WINDOW_BITS; i-- > 0;) {
+    if (i + 1 < c->bits / R_NIST_WINDOW_BITS) {
+      for (j = 0; j < R_NIST_WINDOW_BITS; j++)
+        r_nist_jp_dbl (c, acc, acc);
+    }
+
+    idx = (ruint)(k->v[i / 16] >> (4 * (i % 16))) & (R_NIST_WINDOW_SIZE - 1);
+    r_memclear (&q, sizeof (q));
+    for (j = 0; j < R_NIST_WINDOW_SIZE; j++) {
+      ruint64 mask = (ruint64)0 - (ruint64)(((j ^ idx) - 1) >> 31 & 1);
+      r_nist_fe_cmov (&q.X, &tab[j].X, mask, c->limbs);
+      r_nist_fe_cmov (&q.Y, &tab[j].Y, mask, c->limbs);
+      r_nist_fe_cmov (&q.Z, &tab[j].Z, mask, c->limbs);
+    }
+    r_nist_jp_add (c, acc, acc, &q, FALSE, r_nist_fe_iszero_mask (&q.Z, c->limbs));
+  }
+
+  r_memclear_secure (tab, sizeof (tab));
+  r_memclear_secure (&q, sizeof (q));
+}
+
+/* ------------------------------------------------------------------ */
+/* Variable-time double scalar multiplication                         */
+/* ------------------------------------------------------------------ */
+
+static rpointer
+r_nist_wnaf_init (rpointer data)
+{
+  const REcurve * curve = data;
+  RNistCurve * c = r_nist_curve_for (curve);
+  RNistJacobian g, g2, t;
+  ruint i;
+
+  r_memclear (&g, sizeof (g));
+  r_nist_fe_from_mpint (c, &g.X, &curve->G.x);
+  r_nist_fe_from_mpint (c, &g.Y, &curve->G.y);
+  g.Z.v[0] = 1;
+  r_nist_jp_dbl (c, &g2, &g);
+
+  t = g;
+  c->wnaf[0].x = g.X;
+  c->wnaf[0].y = g.Y;
+  for (i = 1; i < R_NIST_WNAF_G_SIZE; i++) {
+    r_nist_jp_add (c, &t, &t, &g2, FALSE, 0);
+    r_nist_jp_to_affine (c, &c->wnaf[i], &t);
+  }
+
+  return c->wnaf;
+}
+
+/* Width-@w NAF of @k (at most @bits bits): every nonzero digit is
+ * odd, below 2^(w-1) in magnitude and followed by at least w-1
+ * zeros. Writes bits + 1 digits and returns the index just above the
+ * top nonzero one. Variable time, only for public scalars. */
+static ruint
+r_nist_wnaf (rint8 * naf, const RNistFE * k, ruint limbs, ruint bits, ruint w)
+{
+  ruint64 v[R_NIST_MAX_LIMBS + 1];
+  ruint64 mask = ((ruint64)1 << w) - 1;
+  rint64 d;
+  ruint i, j, top = 0;
+
+  for (i = 0; i < limbs; i++)
+    v[i] = k->v[i];
+  v[limbs] = 0;
+
+  for (i = 0; i <= bits; i++) {
+    d = 0;
+    if (v[0] & 1) {
+      d = (rint64)(v[0] & mask);
+      if (d >= ((rint64)1 << (w - 1)))
+        d -= (rint64)1 << w;
+      /* v -= d, which clears the low w bits; a negative d carries. */
+      if (d > 0) {
+        v[0] -= (ruint64)d;
+      } else {
+        ruint64 add = (ruint64)-d;
+        for (j = 0; j <= limbs && add != 0; j++) {
+          v[j] += add;
+          add = v[j] < add;
+        }
+      }
+      top = i + 1;
+    }
+    naf[i] = (rint8)d;
+
+    for (j = 0; j < limbs; j++)
+      v[j] = (v[j] >> 1) | (v[j + 1] << 63);
+    v[limbs] >>= 1;
+  }
+
+  return top;
+}
+
+rboolean
+r_ecurve_nist_double_scalar_mul_vartime (REcurveAffinePoint * out,
+    const rmpint * u1, const rmpint * u2, const REcurveAffinePoint * Q,
+    const REcurve * curve)
+{
+  rint8 naf1[R_NIST_MAX_LIMBS * 64 + 1], naf2[R_NIST_MAX_LIMBS * 64 + 1];
+  RNistJacobian qtab[R_NIST_WNAF_Q_SIZE], q2, acc, t;
+  const RNistAffine * gtab;
+  RNistFE k1, k2, zero;
+  RNistCurve * c;
+  ruint i, top1, top2;
+  rint32 d;
+
+  if ((c = r_nist_curve_for (curve)) == NULL)
+    return FALSE;
+  gtab = r_call_once (&c->wnaf_once, r_nist_wnaf_init, (rpointer)curve);
+
+  r_nist_fe_from_mpint (c, &k1, u1);
+  r_nist_fe_from_mpint (c, &k2, u2);
+  top1 = r_nist_wnaf (naf1, &k1, c->limbs, c->bits, R_NIST_WNAF_G_BITS);
+  top2 = 0;
+  if (!Q->is_infinity) {
+    top2 = r_nist_wnaf (naf2, &k2, c->limbs, c->bits, R_NIST_WNAF_Q_BITS);
+
+    /* Q, 3Q, 5Q, ... */
+    r_memclear (&qtab[0], sizeof (qtab[0]));
+    r_nist_fe_from_mpint (c, &qtab[0].X, &Q->x);
+    r_nist_fe_from_mpint (c, &qtab[0].Y, &Q->y);
+    qtab[0].Z.v[0] = 1;
+    r_nist_jp_dbl (c, &q2, &qtab[0]);
+    for (i = 1; i < R_NIST_WNAF_Q_SIZE; i++)
+      r_nist_jp_add (c, &qtab[i], &qtab[i - 1], &q2, FALSE, 0);
+  }
+
+  /* Shared doublings, an addition per nonzero digit of either. */
+  r_memclear (&zero, sizeof (zero));
+  r_memclear (&acc, sizeof (acc));
+  for (i = MAX (top1, top2); i-- > 0;) {
+    r_nist_jp_dbl (c, &acc, &acc);
+
+    if (i < top1 && (d = naf1[i]) != 0) {
+      const RNistAffine * g = &gtab[(d < 0 ? -d : d) >> 1];
+      t.X = g->x;
+      if (d < 0)
+        r_nist_fe_sub (c, &t.Y, &zero, &g->y);
+      else
+        t.Y = g->y;
+      r_nist_jp_add (c, &acc, &acc, &t, TRUE, 0);
+    }
+    if (i < top2 && (d = naf2[i]) != 0) {
+      t = qtab[(d < 0 ? -d : d) >> 1];
+      if (d < 0)
+        r_nist_fe_sub (c, &t.Y, &zero, &t.Y);
+      r_nist_jp_add (c, &acc, &acc, &t, FALSE, 0);
+    }
+  }
+
+  return r_nist_jp_to_point (c, out, &acc);
+}
+
+rboolean
+r_ecurve_nist_scalar_mul (REcurveAffinePoint * out, const rmpint * scalar,
+    const REcurveAffinePoint * point, const REcurve * curve)
+{
+  RNistCurve * c;
+  RNistJacobian acc;
+  RNistFE k;
+  rboolean ret;
+
+  if ((c = r_nist_curve_for (curve)) == NULL)
+    return FALSE;
+
+  if (point->is_infinity) {
+    r_ecurve_point_set_infinity (out);
+    return TRUE;
+  }
+
+  /* Like the generic ladder, the scalar is taken modulo 2^bits. */
+  r_nist_fe_from_mpint (c, &k, scalar);
+  if (point == &curve->G || (r_mpint_cmp (&point->x, &curve->G.x) == 0 &&
+        r_mpint_cmp (&point->y, &curve->G.y) == 0))
+    r_nist_mul_base (c, &acc, &k, curve);
+  else
+    r_nist_mul_point (c, &acc, &k, point);
+
+  ret = r_nist_jp_to_point (c, out, &acc);
+  r_memclear_secure (&k, sizeof (k));
+  r_memclear_secure (&acc, sizeof (acc));
+  return ret;
+}
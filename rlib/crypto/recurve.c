@@ -100,6 +100,7 @@ r_ecurve_init (REcurve * curve, REcurveID named)
   r_mpint_set_binary (&curve->G.y, pd->gy_data, pd->gy_size);
   curve->G.is_infinity = FALSE;
   curve->coord_bytes = pd->coord_bytes;
+  curve->id = named;
 
   /* Precompute Montgomery setup constants used by the constant-time
    * scalar-mul ladder. mont_mp = -p^-1 mod 2^digit_bits is the per-
@@ -153,6 +154,7 @@ r_ecurve_clear (REcurve * curve)
   r_mpint_clear (&curve->mont_r_squared);
   r_mpint_clear (&curve->mont_a);
   r_mpint_clear (&curve->p_minus_2);
+  curve->id = R_ECURVE_ID_NONE;
 }
 
 /* --- Internal ECC field-element context and Jacobian point arithmetic.
@@ -694,6 +696,11 @@ r_ecurve_point_scalar_mul (REcurveAffinePoint * out, const rmpint * scalar,
     return TRUE;
   }
 
+  /* secp256r1 / secp384r1 have their own field code and generator
+   * tables; this ladder serves the remaining curves. */
+  if (r_ecurve_nist_scalar_mul (out, scalar, point, curve))
+    return TRUE;
+
   /* Build the FE context from the curve's precomputed rmpint
    * constants. This is a few digit copies per constant - much cheaper
    * than one ladder iteration. */
@@ -794,6 +801,31 @@ r_ecurve_point_scalar_mul (REcurveAffinePoint * out, const rmpint * scalar,
   return ok;
 }
 
+rboolean
+r_ecurve_point_double_scalar_mul_vartime (REcurveAffinePoint * out,
+    const rmpint * u1, const rmpint * u2, const REcurveAffinePoint * Q,
+    const REcurve * curve)
+{
+  REcurveAffinePoint u1G, u2Q;
+  rboolean ok;
+
+  if (R_UNLIKELY (out == NULL || u1 == NULL || u2 == NULL || Q == NULL ||
+        curve == NULL))
+    return FALSE;
+
+  if (r_ecurve_nist_double_scalar_mul_vartime (out, u1, u2, Q, curve))
+    return TRUE;
+
+  r_ecurve_point_init (&u1G);
+  r_ecurve_point_init (&u2Q);
+  ok = r_ecurve_point_scalar_mul (&u1G, u1, &curve->G, curve) &&
+    r_ecurve_point_scalar_mul (&u2Q, u2, Q, curve) &&
+    r_ecurve_point_add (out, &u1G, &u2Q, curve);
+  r_ecurve_point_clear (&u1G);
+  r_ecurve_point_clear (&u2Q);
+  return ok;
+}
+
 rboolean
 r_ecurve_point_to_uncompressed (const REcurveAffinePoint * point,
     const REcurve * curve, ruint8 * out, rsize * outsize)
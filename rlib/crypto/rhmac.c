@@ -22,17 +22,22 @@
 #include <rlib/rmem.h>
 #include <rlib/rstr.h>
 
+/* The keyed ipad / opad blocks are absorbed once, into ipad / opad; every
+ * message then starts from a copy of those states instead of hashing two
+ * more blocks (RFC 2104 section 4). */
 struct RHmac {
   RMsgDigest * inner;
   RMsgDigest * outer;
-  ruint32 * keyblock;
-  rsize blocksize;
+  RMsgDigest * ipad;
+  RMsgDigest * opad;
 };
 
 RHmac *
 r_hmac_new (RMsgDigestType type, rconstpointer key, rsize keysize)
 {
   RHmac * hmac;
+  ruint32 * keyblock, * block;
+  rsize blocksize, i;
 
   if (R_UNLIKELY (key == NULL && keysize > 0))
     return NULL;
@@ -40,25 +45,37 @@ r_hmac_new (RMsgDigestType type, rconstpointer key, rsize keysize)
   if ((hmac = r_mem_new0 (RHmac)) != NULL) {
     hmac->inner = r_msg_digest_new (type);
     hmac->outer = r_msg_digest_new (type);
-    if (hmac->inner == NULL || hmac->outer == NULL) {
+    hmac->ipad = r_msg_digest_new (type);
+    hmac->opad = r_msg_digest_new (type);
+    if (hmac->inner == NULL || hmac->outer == NULL ||
+        hmac->ipad == NULL || hmac->opad == NULL ||
+        (blocksize = r_msg_digest_blocksize (hmac->inner)) == 0) {
       r_hmac_free (hmac);
       return NULL;
     }
 
-    hmac->blocksize = r_msg_digest_blocksize (hmac->inner);
-    hmac->keyblock = r_malloc0 (hmac->blocksize);
-    if (hmac->blocksize == 0 || hmac->keyblock == NULL) {
-      r_hmac_free (hmac);
-      return NULL;
-    }
-
-    if (keysize > hmac->blocksize) {
+    keyblock = r_alloca0 (blocksize);
+    block = r_alloca (blocksize);
+    if (keysize > blocksize) {
       r_msg_digest_update (hmac->inner, key, keysize);
-      r_msg_digest_get_data (hmac->inner, (ruint8 *)hmac->keyblock, hmac->blocksize, NULL);
+      r_msg_digest_get_data (hmac->inner, (ruint8 *)keyblock, blocksize, NULL);
     } else {
-      r_memcpy (hmac->keyblock, key, keysize);
+      r_memcpy (keyblock, key, keysize);
     }
 
+    for (i = 0; i < blocksize / sizeof (ruint32); i++)
+      block[i] = keyblock[i] ^ 0x36363636;
+    r_msg_digest_update (hmac->ipad, block, blocksize);
+
+    for (i = 0; i < blocksize / sizeof (ruint32); i++)
+      block[i] = keyblock[i] ^ 0x5c5c5c5c;
+    r_msg_digest_update (hmac->opad, block, blocksize);
+
+    /* keyblock holds the post-hash or zero-padded HMAC key and block its
+     * keyed ipad/opad expansions; wipe before the stack frame is popped. */
+    r_memclear_secure (keyblock, blocksize);
+    r_memclear_secure (block, blocksize);
+
     r_hmac_reset (hmac);
   }
 
@@ -69,13 +86,11 @@ void
 r_hmac_free (RHmac * hmac)
 {
   if (hmac != NULL) {
+    /* r_msg_digest_free wipes the keyed pad states. */
     r_msg_digest_free (hmac->inner);
     r_msg_digest_free (hmac->outer);
-    if (hmac->keyblock != NULL) {
-      /* keyblock holds the post-hash or zero-padded HMAC key. */
-      r_memclear_secure (hmac->keyblock, hmac->blocksize);
-      r_free (hmac->keyblock);
-    }
+    r_msg_digest_free (hmac->ipad);
+    r_msg_digest_free (hmac->opad);
     r_free (hmac);
   }
 }
@@ -90,23 +105,8 @@ r_hmac_size (const RHmac * hmac)
 void
 r_hmac_reset (RHmac * hmac)
 {
-  rsize i;
-  ruint32 * block = r_alloca (hmac->blocksize);
-
-  r_msg_digest_reset (hmac->inner);
-  r_msg_digest_reset (hmac->outer);
-
-  for (i = 0; i < hmac->blocksize / sizeof (ruint32); i++)
-    block[i] = hmac->keyblock[i] ^ 0x36363636;
-  r_msg_digest_update (hmac->inner, block, hmac->blocksize);
-
-  for (i = 0; i < hmac->blocksize / sizeof (ruint32); i++)
-    block[i] = hmac->keyblock[i] ^ 0x5c5c5c5c;
-  r_msg_digest_update (hmac->outer, block, hmac->blocksize);
-
-  /* block carried the keyed ipad/opad expansions; wipe before the
-   * stack frame is popped. */
-  r_memclear_secure (block, hmac->blocksize);
+  r_msg_digest_copy_state (hmac->inner, hmac->ipad);
+  r_msg_digest_copy_state (hmac->outer, hmac->opad);
 }
 
 
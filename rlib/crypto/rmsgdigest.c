@@ -310,6 +310,24 @@ r_msg_digest_reset (RMsgDigest * md)
   md->init (md);
 }
 
+RMsgDigest *
+r_msg_digest_copy (const RMsgDigest * md)
+{
+  if (R_UNLIKELY (md == NULL)) return NULL;
+  return r_memdup (md, md->mdsize);
+}
+
+rboolean
+r_msg_digest_copy_state (RMsgDigest * dst, const RMsgDigest * src)
+{
+  if (R_UNLIKELY (dst == NULL || src == NULL)) return FALSE;
+  if (R_UNLIKELY (dst->type != src->type)) return FALSE;
+
+  /* Header and per-algorithm state are one block of mdsize bytes. */
+  r_memcpy (dst, src, src->mdsize);
+  return TRUE;
+}
+
 rboolean
 r_msg_digest_update (RMsgDigest * md, rconstpointer data, rsize size)
 {
@@ -23,6 +23,8 @@
 
 #include <rlib/crypto/rhmac.h>
 
+#include "../data/rmpint-private.h"
+
 #include <rlib/format/rasn1.h>
 #include <rlib/format/roid.h>
 #include <rlib/rmem.h>
@@ -30,6 +32,9 @@
 #define R_RSA_EMSA_PKCS1        0x01
 #define R_RSA_EME_PKCS1         0x02
 
+/* Private operations one batched exponentiation handles at once. */
+#define R_RSA_BATCH_LANES       R_MPINT_FE_BIG_IFMA_LANES
+
 typedef struct {
   RCryptoKey key;
   RRsaPadding padding;
@@ -38,6 +43,14 @@ typedef struct {
   rmpint e;
 } RRsaPubKey;
 
+/* k of RFC 8017: the modulus length in bytes, which is the length of every
+ * ciphertext, signature and encoded message under the key. */
+static inline rsize
+r_rsa_pub_key_len (const RRsaPubKey * key)
+{
+  return (r_mpint_bits_used (&key->n) + 7) / 8;
+}
+
 typedef struct {
   RRsaPubKey pub;
 
@@ -692,7 +705,7 @@ r_rsa_raw_encrypt_internal (const RRsaPubKey * key,
   rsize k;
   rmpint c, m;
 
-  k = r_mpint_digits_used (&key->n) * sizeof (rmpint_digit);
+  k = r_rsa_pub_key_len (key);
   if (size != k)
     return R_CRYPTO_INVAL;
 
@@ -754,11 +767,54 @@ r_rsa_raw_encrypt (const RCryptoKey * key, RPrng * prng,
  * which dominated this codepath's leakage surface, is what this
  * commit eliminates. */
 static rboolean
-r_rsa_modexp_private (const RRsaPrivKey * key, const rmpint * c, rmpint * m)
+r_rsa_priv_key_has_crt (const RRsaPrivKey * key)
 {
-  if (!r_mpint_iszero (&key->p) && !r_mpint_iszero (&key->q) &&
+  return !r_mpint_iszero (&key->p) && !r_mpint_iszero (&key->q) &&
       !r_mpint_iszero (&key->dp) && !r_mpint_iszero (&key->dq) &&
-      !r_mpint_iszero (&key->qp)) {
+      !r_mpint_iszero (&key->qp);
+}
+
+/* CT CRT recombination, m := m2 + q * ((m1 - m2) * qInv mod p). Only
+ * valid for bits(p) >= bits(q); see r_rsa_modexp_private. */
+static rboolean
+r_rsa_crt_combine_ct (const RRsaPrivKey * key, const rmpint * m1,
+    const rmpint * m2, rmpint * m)
+{
+  RMpintFE_Big m1_fe, m2_fe, m2_p_fe, h_fe, q_fe, m_wide;
+  ruint16 n_p = key->ctx_p.n_digits;
+  ruint16 n_q = key->ctx_q.n_digits;
+  rboolean ok;
+
+  r_mpint_fe_big_from_mpint (&m1_fe, m1, n_p);
+  r_mpint_fe_big_from_mpint (&m2_fe, m2, n_p);
+  r_mpint_fe_big_mod_ct (&m2_p_fe, &m2_fe, &key->ctx_p);
+
+  r_mpint_fe_big_sub (&h_fe, &m1_fe, &m2_p_fe, &key->ctx_p);
+  r_mpint_fe_big_mont_in (&h_fe, &h_fe, &key->r2_p, &key->ctx_p);
+  r_mpint_fe_big_mul_mont (&h_fe, &h_fe, &key->qInv_M_p, &key->ctx_p);
+  r_mpint_fe_big_mont_out (&h_fe, &h_fe, &key->ctx_p);
+
+  r_mpint_fe_big_from_mpint (&q_fe, &key->q, n_q);
+  r_mpint_fe_big_mul_ct (&m_wide, &h_fe, n_p, &q_fe, n_q);
+  r_mpint_fe_big_from_mpint (&m2_fe, m2, n_q);
+  r_mpint_fe_big_add_ct (&m_wide, &m_wide,
+      (ruint16)(n_p + n_q), &m2_fe, n_q);
+
+  ok = r_mpint_fe_big_to_mpint (m, &m_wide, (ruint16)(n_p + n_q));
+
+  r_memclear_secure (&m1_fe, sizeof (m1_fe));
+  r_memclear_secure (&m2_fe, sizeof (m2_fe));
+  r_memclear_secure (&m2_p_fe, sizeof (m2_p_fe));
+  r_memclear_secure (&h_fe, sizeof (h_fe));
+  r_memclear_secure (&q_fe, sizeof (q_fe));
+  r_memclear_secure (&m_wide, sizeof (m_wide));
+  return ok;
+}
+
+static rboolean
+r_rsa_modexp_private (const RRsaPrivKey * key, const rmpint * c, rmpint * m)
+{
+  if (r_rsa_priv_key_has_crt (key)) {
     /* CRT path: ~4x faster than computing c^d mod n directly.
      *   m1 = c^dp mod p
      *   m2 = c^dq mod q
@@ -768,9 +824,6 @@ r_rsa_modexp_private (const RRsaPrivKey * key, const rmpint * c, rmpint * m)
      * keeps q < 2p and lets mod_ct reduce m2 with a single
      * conditional subtract. */
     if (r_mpint_bits_used (&key->p) >= r_mpint_bits_used (&key->q)) {
-      RMpintFE_Big m1_fe, m2_fe, m2_p_fe, h_fe, q_fe, m_wide;
-      ruint16 n_p = key->ctx_p.n_digits;
-      ruint16 n_q = key->ctx_q.n_digits;
       rmpint m1, m2;
       rboolean ok;
 
@@ -780,32 +833,9 @@ r_rsa_modexp_private (const RRsaPrivKey * key, const rmpint * c, rmpint * m)
       ok = r_mpint_fe_big_expmod_ct (&m1, c, &key->dp, &key->p,
               &key->ctx_p, &key->r2_p, r_mpint_bits_used (&key->p))
         && r_mpint_fe_big_expmod_ct (&m2, c, &key->dq, &key->q,
-              &key->ctx_q, &key->r2_q, r_mpint_bits_used (&key->q));
-      if (ok) {
-        r_mpint_fe_big_from_mpint (&m1_fe, &m1, n_p);
-        r_mpint_fe_big_from_mpint (&m2_fe, &m2, n_p);
-        r_mpint_fe_big_mod_ct (&m2_p_fe, &m2_fe, &key->ctx_p);
-
-        r_mpint_fe_big_sub (&h_fe, &m1_fe, &m2_p_fe, &key->ctx_p);
-        r_mpint_fe_big_mont_in (&h_fe, &h_fe, &key->r2_p, &key->ctx_p);
-        r_mpint_fe_big_mul_mont (&h_fe, &h_fe, &key->qInv_M_p, &key->ctx_p);
-        r_mpint_fe_big_mont_out (&h_fe, &h_fe, &key->ctx_p);
-
-        r_mpint_fe_big_from_mpint (&q_fe, &key->q, n_q);
-        r_mpint_fe_big_mul_ct (&m_wide, &h_fe, n_p, &q_fe, n_q);
-        r_mpint_fe_big_from_mpint (&m2_fe, &m2, n_q);
-        r_mpint_fe_big_add_ct (&m_wide, &m_wide,
-            (ruint16)(n_p + n_q), &m2_fe, n_q);
-
-        ok = r_mpint_fe_big_to_mpint (m, &m_wide, (ruint16)(n_p + n_q));
-      }
+              &key->ctx_q, &key->r2_q, r_mpint_bits_used (&key->q))
+        && r_rsa_crt_combine_ct (key, &m1, &m2, m);
 
-      r_memclear_secure (&m1_fe, sizeof (m1_fe));
-      r_memclear_secure (&m2_fe, sizeof (m2_fe));
-      r_memclear_secure (&m2_p_fe, sizeof (m2_p_fe));
-      r_memclear_secure (&h_fe, sizeof (h_fe));
-      r_memclear_secure (&q_fe, sizeof (q_fe));
-      r_memclear_secure (&m_wide, sizeof (m_wide));
       r_mpint_clear (&m1);
       r_mpint_clear (&m2);
       return ok;
@@ -849,18 +879,134 @@ r_rsa_modexp_private (const RRsaPrivKey * key, const rmpint * c, rmpint * m)
   }
 }
 
+/* r_rsa_modexp_private for count <= R_RSA_BATCH_LANES ciphertexts under
+ * the same key. With CRT parameters and bits(p) >= bits(q) the c^dP and
+ * c^dQ halves each run as one multi-buffer exponentiation, all lanes
+ * sharing the exponent, followed by the usual CT recombination per
+ * element. Anything the multi-buffer kernel doesn't take (no IFMA, small
+ * or non-CRT keys) runs through r_rsa_modexp_private one at a time. */
+static void
+r_rsa_modexp_private_batch (const RRsaPrivKey * key, const rmpint * c,
+    rmpint * m, rboolean * ok, rsize count)
+{
+  rsize i;
+
+  if (count > 1 && r_rsa_priv_key_has_crt (key) &&
+      r_mpint_bits_used (&key->p) >= r_mpint_bits_used (&key->q)) {
+    RMpintFE_Big * base, * out_p, * out_q;
+    ruint16 n_p = key->ctx_p.n_digits;
+    ruint16 n_q = key->ctx_q.n_digits;
+    rmpint t, m1, m2;
+    rboolean done;
+
+    if ((base = r_mem_new_n (RMpintFE_Big, 3 * count)) == NULL)
+      goto fallback;
+    out_p = base + count;
+    out_q = out_p + count;
+
+    r_mpint_init_secure (&t);
+    r_mpint_init_secure (&m1);
+    r_mpint_init_secure (&m2);
+
+    /* Reducing the (blinded) input is variable-time on c, the same
+     * trade-off r_mpint_fe_big_expmod_ct makes. */
+    for (i = 0, done = TRUE; i < count && done; i++) {
+      if ((done = r_mpint_mod (&t, &c[i], &key->p)))
+        r_mpint_fe_big_from_mpint (&base[i], &t, n_p);
+    }
+    done = done && r_mpint_fe_big_expmod_ifma_x8 (out_p, base, count,
+        &key->dp, r_mpint_bits_used (&key->p), &key->ctx_p, &key->r2_p);
+    for (i = 0; i < count && done; i++) {
+      if ((done = r_mpint_mod (&t, &c[i], &key->q)))
+        r_mpint_fe_big_from_mpint (&base[i], &t, n_q);
+    }
+    done = done && r_mpint_fe_big_expmod_ifma_x8 (out_q, base, count,
+        &key->dq, r_mpint_bits_used (&key->q), &key->ctx_q, &key->r2_q);
+
+    for (i = 0; i < count && done; i++) {
+      ok[i] = r_mpint_fe_big_to_mpint (&m1, &out_p[i], n_p)
+        && r_mpint_fe_big_to_mpint (&m2, &out_q[i], n_q)
+        && r_rsa_crt_combine_ct (key, &m1, &m2, &m[i]);
+    }
+
+    r_memclear_secure (base, 3 * count * sizeof (RMpintFE_Big));
+    r_free (base);
+    r_mpint_clear (&t);
+    r_mpint_clear (&m1);
+    r_mpint_clear (&m2);
+    if (done)
+      return;
+  }
+
+fallback:
+  for (i = 0; i < count; i++)
+    ok[i] = r_rsa_modexp_private (key, &c[i], &m[i]);
+}
+
+/* RSA blinding: instead of computing m = c^d mod n directly — whose
+ * timing would correlate with d — sample a random r in (0, n) with
+ * gcd(r, n) = 1, compute c' = c * r^e mod n, run the private-key op
+ * on c', then unblind via m = m' * r^-1 mod n. rbuf is size bytes of
+ * scratch for the PRNG output; the caller wipes it. */
+static rboolean
+r_rsa_blind_sample (const RRsaPrivKey * key, RPrng * prng, rmpint * r,
+    ruint8 * rbuf, rsize size)
+{
+  do {
+    if (!r_prng_fill (prng, rbuf, size))
+      return FALSE;
+    r_mpint_set_binary (r, rbuf, size);
+    r_mpint_mod (r, r, &key->pub.n);
+  } while (r_mpint_iszero (r));
+
+  return TRUE;
+}
+
+static rboolean
+r_rsa_blind_apply (const RRsaPrivKey * key, rmpint * c, const rmpint * r)
+{
+  rmpint r_e;
+  rboolean ok;
+
+  r_mpint_init_secure (&r_e);
+  ok = r_mpint_expmod (&r_e, r, &key->pub.e, &key->pub.n)
+    && r_mpint_mulmod (c, c, &r_e, &key->pub.n);
+  r_mpint_clear (&r_e);
+  return ok;
+}
+
+/* For random 2048-bit r and n = p*q the gcd is essentially always 1,
+ * but we still iterate until invmod succeeds rather than silently
+ * failing. */
+static rboolean
+r_rsa_blind (const RRsaPrivKey * key, RPrng * prng, rmpint * c,
+    rmpint * r_inv, ruint8 * rbuf, rsize size)
+{
+  rmpint r;
+  rboolean ok;
+
+  r_mpint_init_secure (&r);
+  do {
+    ok = r_rsa_blind_sample (key, prng, &r, rbuf, size);
+  } while (ok && !r_mpint_invmod (r_inv, &r, &key->pub.n));
+
+  ok = ok && r_rsa_blind_apply (key, c, &r);
+  r_mpint_clear (&r);
+  return ok;
+}
+
 static RCryptoResult
 r_rsa_raw_decrypt_internal (const RRsaPrivKey * key, RPrng * prng,
     rconstpointer data, ruint8 * out, rsize size)
 {
   RCryptoResult ret;
   rsize k;
-  rmpint c, m, r, r_inv, r_e;
+  rmpint c, m, r_inv;
   ruint8 * rbuf;
   rboolean own_prng = FALSE;
   rboolean ok;
 
-  k = r_mpint_digits_used (&key->pub.n) * sizeof (rmpint_digit);
+  k = r_rsa_pub_key_len (&key->pub);
   if (size != k)
     return R_CRYPTO_INVAL;
 
@@ -878,38 +1024,18 @@ r_rsa_raw_decrypt_internal (const RRsaPrivKey * key, RPrng * prng,
     own_prng = TRUE;
   }
 
-  /* m ends up holding the plaintext; r / r_inv / r_e are the blinding
-   * factor and its variants. None of those should linger in freed
-   * heap after this function returns. */
+  /* m ends up holding the plaintext; r_inv is the unblinding factor.
+   * Neither should linger in freed heap after this function returns. */
   r_mpint_init_size (&m, r_mpint_digits_used (&key->pub.n));
   r_mpint_set_secure_clear (&m);
-  r_mpint_init_secure (&r);
   r_mpint_init_secure (&r_inv);
-  r_mpint_init_secure (&r_e);
   rbuf = r_alloca (size);
 
-  /* RSA blinding: instead of computing m = c^d mod n directly — whose
-   * timing would correlate with d — sample a random r in (0, n) with
-   * gcd(r, n) = 1, compute c' = c * r^e mod n, run the private-key op
-   * on c', then unblind via m = m' * r^-1 mod n. For random 2048-bit r
-   * and n = p*q the gcd is essentially always 1, but we still iterate
-   * until invmod succeeds rather than silently failing. */
-  do {
-    if (!r_prng_fill (prng, rbuf, size)) {
-      ok = FALSE;
-      goto done;
-    }
-    r_mpint_set_binary (&r, rbuf, size);
-    r_mpint_mod (&r, &r, &key->pub.n);
-  } while (r_mpint_iszero (&r) || !r_mpint_invmod (&r_inv, &r, &key->pub.n));
-
-  ok = r_mpint_expmod (&r_e, &r, &key->pub.e, &key->pub.n)
-    && r_mpint_mulmod (&c, &c, &r_e, &key->pub.n)
+  ok = r_rsa_blind (key, prng, &c, &r_inv, rbuf, size)
     && r_rsa_modexp_private (key, &c, &m)
     && r_mpint_mulmod (&m, &m, &r_inv, &key->pub.n)
     && r_mpint_to_binary_with_size (&m, out, k);
 
-done:
   ret = ok ? R_CRYPTO_OK : R_CRYPTO_DECRYPT_FAILED;
 
   /* rbuf held raw PRNG output used to seed the blinding factor; the
@@ -917,15 +1043,107 @@ done:
   r_memclear_secure (rbuf, size);
   r_mpint_clear (&c);
   r_mpint_clear (&m);
-  r_mpint_clear (&r);
   r_mpint_clear (&r_inv);
-  r_mpint_clear (&r_e);
   if (own_prng)
     r_prng_unref (prng);
 
   return ret;
 }
 
+/* r_rsa_raw_decrypt_internal in place on count <= R_RSA_BATCH_LANES
+ * blocks of the modulus byte length. Every block gets its own blinding
+ * factor; the exponentiations then share one batched run. The inverse
+ * of a blinding factor costs about as much as a whole CRT exponentiation
+ * on the batched kernel, so the factors are inverted together
+ * (Montgomery's trick: one invmod of their product, then three mulmods
+ * each). res[i] is the outcome for blocks[i]. */
+static void
+r_rsa_raw_decrypt_batch_internal (const RRsaPrivKey * key, RPrng * prng,
+    ruint8 * const * blocks, RCryptoResult * res, rsize count)
+{
+  rmpint c[R_RSA_BATCH_LANES], m[R_RSA_BATCH_LANES];
+  rmpint r[R_RSA_BATCH_LANES], r_inv[R_RSA_BATCH_LANES], inv;
+  rboolean ok[R_RSA_BATCH_LANES], blind_ok[R_RSA_BATCH_LANES];
+  rsize idx[R_RSA_BATCH_LANES];
+  rsize i, j, k, live;
+  ruint8 * rbuf;
+  rboolean own_prng = FALSE, blinded;
+
+  if (count == 0)
+    return;
+  if (prng == NULL) {
+    if ((prng = r_rand_prng_new ()) == NULL) {
+      for (i = 0; i < count; i++)
+        res[i] = R_CRYPTO_ERROR;
+      return;
+    }
+    own_prng = TRUE;
+  }
+
+  k = r_rsa_pub_key_len (&key->pub);
+  rbuf = r_alloca (k);
+  r_mpint_init_secure (&inv);
+
+  for (i = live = 0; i < count; i++) {
+    r_mpint_init_binary (&c[live], blocks[i], k);
+    if (r_mpint_iszero (&c[live])) {
+      r_mpint_clear (&c[live]);
+      res[i] = R_CRYPTO_WRONG_SIZE;
+      continue;
+    }
+    r_mpint_init_secure (&r[live]);
+    r_mpint_init_secure (&r_inv[live]);
+    r_mpint_init_size (&m[live], r_mpint_digits_used (&key->pub.n));
+    r_mpint_set_secure_clear (&m[live]);
+    idx[live++] = i;
+  }
+
+  /* r_inv[j] := r[0] * ... * r[j], invert the full product once, then
+   * walk back down peeling one factor per step. */
+  for (j = 0, blinded = TRUE; j < live && blinded; j++) {
+    if ((blinded = r_rsa_blind_sample (key, prng, &r[j], rbuf, k))) {
+      if (j == 0)
+        r_mpint_set (&r_inv[0], &r[0]);
+      else
+        blinded = r_mpint_mulmod (&r_inv[j], &r_inv[j - 1], &r[j], &key->pub.n);
+    }
+  }
+  blinded = blinded && live > 0 &&
+    r_mpint_invmod (&inv, &r_inv[live - 1], &key->pub.n);
+  for (j = live; j > 1 && blinded; j--) {
+    blinded = r_mpint_mulmod (&r_inv[j - 1], &inv, &r_inv[j - 2], &key->pub.n)
+      && r_mpint_mulmod (&inv, &inv, &r[j - 1], &key->pub.n);
+  }
+  if (blinded && live > 0)
+    r_mpint_set (&r_inv[0], &inv);
+
+  for (j = 0; j < live; j++) {
+    /* A factor sharing a prime with n (or a PRNG failure) spoils the
+     * product; redo those blocks one at a time. */
+    blind_ok[j] = blinded ? r_rsa_blind_apply (key, &c[j], &r[j]) :
+      r_rsa_blind (key, prng, &c[j], &r_inv[j], rbuf, k);
+  }
+
+  r_rsa_modexp_private_batch (key, c, m, ok, live);
+
+  for (j = 0; j < live; j++) {
+    i = idx[j];
+    res[i] = (blind_ok[j] && ok[j]
+        && r_mpint_mulmod (&m[j], &m[j], &r_inv[j], &key->pub.n)
+        && r_mpint_to_binary_with_size (&m[j], blocks[i], k)) ?
+      R_CRYPTO_OK : R_CRYPTO_DECRYPT_FAILED;
+    r_mpint_clear (&c[j]);
+    r_mpint_clear (&m[j]);
+    r_mpint_clear (&r[j]);
+    r_mpint_clear (&r_inv[j]);
+  }
+
+  r_memclear_secure (rbuf, k);
+  r_mpint_clear (&inv);
+  if (own_prng)
+    r_prng_unref (prng);
+}
+
 RCryptoResult
 r_rsa_raw_decrypt (const RCryptoKey * key,
     rconstpointer data, rsize size, ruint8 * out, rsize * outsize)
@@ -966,7 +1184,7 @@ r_rsa_pkcs1v1_5_encrypt (const RCryptoKey * key, RPrng * prng,
   if (R_UNLIKELY (data == NULL)) return R_CRYPTO_INVAL;
   if (R_UNLIKELY (out == NULL || outsize == NULL)) return R_CRYPTO_INVAL;
 
-  k = r_mpint_digits_used (&((const RRsaPubKey*)key)->n) * sizeof (rmpint_digit);
+  k = r_rsa_pub_key_len ((const RRsaPubKey*)key);
   if (size > k - 11 || *outsize < k)
     return R_CRYPTO_WRONG_SIZE;
 
@@ -998,7 +1216,7 @@ r_rsa_pkcs1v1_5_decrypt (const RCryptoKey * key,
 
   if (R_UNLIKELY (data == NULL || out == NULL || outsize == NULL))
     return R_CRYPTO_INVAL;
-  if (size != r_mpint_digits_used (&((const RRsaPrivKey*)key)->pub.n) * sizeof (rmpint_digit))
+  if (size != r_rsa_pub_key_len ((const RRsaPubKey*)key))
     return R_CRYPTO_WRONG_SIZE;
 
   /* When out is big enough we decrypt straight into it; otherwise a
@@ -1125,48 +1343,22 @@ r_rsa_pkcs1v1_5_synthetic (const rmpint * d, rconstpointer ciphertext,
   return ok;
 }
 
-RCryptoResult
-r_rsa_pkcs1v1_5_decrypt_implicit (const RCryptoKey * key,
-    rconstpointer data, rsize size, ruint8 * out, rsize out_size)
+/* Implicit-rejection tail of r_rsa_pkcs1v1_5_decrypt_implicit: given the
+ * raw-decrypted em of ciphertext data, write out_size bytes of either the
+ * real message or the synthetic one, with no data-dependent branches. */
+static RCryptoResult
+r_rsa_pkcs1v1_5_implicit_select (const RRsaPrivKey * pk,
+    rconstpointer data, const ruint8 * em, rsize k, ruint8 * out, rsize out_size)
 {
-  RCryptoResult ret;
-  const RRsaPrivKey * pk;
-  ruint8 * em;
   ruint8 * synth;
-  rsize k, i;
+  rsize i;
   ruint32 valid;
   ruint32 zero_seen;
   ruint32 zero_pos;
 
-  if (R_UNLIKELY (key == NULL)) return R_CRYPTO_INVAL;
-  if (R_UNLIKELY (key->algo->algo != R_CRYPTO_ALGO_RSA)) return R_CRYPTO_WRONG_TYPE;
-  if (R_UNLIKELY (key->type != R_CRYPTO_PRIVATE_KEY)) return R_CRYPTO_WRONG_TYPE;
-  if (R_UNLIKELY (data == NULL || out == NULL)) return R_CRYPTO_INVAL;
-
-  pk = (const RRsaPrivKey *)key;
-  k = r_mpint_digits_used (&pk->pub.n) * sizeof (rmpint_digit);
-  if (R_UNLIKELY (size != k)) return R_CRYPTO_WRONG_SIZE;
-  /* PKCS#1 v1.5 requires |PS| >= 8 plus the 0x00 0x02 prefix and the
-   * 0x00 separator, so the message can be at most k - 11 bytes. */
-  if (R_UNLIKELY (out_size == 0 || out_size > k - 11))
-    return R_CRYPTO_WRONG_SIZE;
-
-  em = r_alloca (size);
   synth = r_alloca (out_size);
-
-  /* Raw decrypt: out-of-range / zero ciphertexts surface as an error
-   * here. Bleichenbacher candidates are always in [0, n), so this
-   * doesn't expose a useful oracle - it's input validation, not a
-   * padding check. */
-  if ((ret = r_rsa_raw_decrypt_internal (pk, NULL, data, em, size)) != R_CRYPTO_OK) {
-    r_memclear_secure (em, size);
-    return ret;
-  }
-
-  if (!r_rsa_pkcs1v1_5_synthetic (&pk->d, data, size, synth, out_size)) {
-    r_memclear_secure (em, size);
+  if (!r_rsa_pkcs1v1_5_synthetic (&pk->d, data, k, synth, out_size))
     return R_CRYPTO_ERROR;
-  }
 
   /* Padding shape:
    *   em[0] == 0x00
@@ -1176,12 +1368,12 @@ r_rsa_pkcs1v1_5_decrypt_implicit (const RCryptoKey * key,
    * position k - out_size - 1. The scan accumulates the position of
    * the FIRST 0x00 in em[2..k-1] using a once-set "zero_seen" mask;
    * a too-early zero (PS shorter than 8) trips the position check
-   * against k - out_size - 1, which we enforced to be >= 10 above. */
+   * against k - out_size - 1, which the caller enforced to be >= 10. */
   valid = r_ct_byte_eq (em[0], 0x00) & r_ct_byte_eq (em[1], R_RSA_EME_PKCS1);
 
   zero_seen = 0;
   zero_pos = 0;
-  for (i = 2; i < size; i++) {
+  for (i = 2; i < k; i++) {
     ruint32 is_zero = r_ct_byte_eq (em[i], 0x00);
     ruint32 first_zero = is_zero & ~zero_seen;
     zero_pos = r_ct_u32_select (first_zero, (ruint32)i, zero_pos);
@@ -1202,11 +1394,45 @@ r_rsa_pkcs1v1_5_decrypt_implicit (const RCryptoKey * key,
     out[i] = (ruint8)r_ct_u32_select (valid, real_byte, synth_byte);
   }
 
-  r_memclear_secure (em, size);
   r_memclear_secure (synth, out_size);
   return R_CRYPTO_OK;
 }
 
+RCryptoResult
+r_rsa_pkcs1v1_5_decrypt_implicit (const RCryptoKey * key,
+    rconstpointer data, rsize size, ruint8 * out, rsize out_size)
+{
+  RCryptoResult ret;
+  const RRsaPrivKey * pk;
+  ruint8 * em;
+  rsize k;
+
+  if (R_UNLIKELY (key == NULL)) return R_CRYPTO_INVAL;
+  if (R_UNLIKELY (key->algo->algo != R_CRYPTO_ALGO_RSA)) return R_CRYPTO_WRONG_TYPE;
+  if (R_UNLIKELY (key->type != R_CRYPTO_PRIVATE_KEY)) return R_CRYPTO_WRONG_TYPE;
+  if (R_UNLIKELY (data == NULL || out == NULL)) return R_CRYPTO_INVAL;
+
+  pk = (const RRsaPrivKey *)key;
+  k = r_rsa_pub_key_len (&pk->pub);
+  if (R_UNLIKELY (size != k)) return R_CRYPTO_WRONG_SIZE;
+  /* PKCS#1 v1.5 requires |PS| >= 8 plus the 0x00 0x02 prefix and the
+   * 0x00 separator, so the message can be at most k - 11 bytes. */
+  if (R_UNLIKELY (out_size == 0 || out_size > k - 11))
+    return R_CRYPTO_WRONG_SIZE;
+
+  em = r_alloca (size);
+
+  /* Raw decrypt: out-of-range / zero ciphertexts surface as an error
+   * here. Bleichenbacher candidates are always in [0, n), so this
+   * doesn't expose a useful oracle - it's input validation, not a
+   * padding check. */
+  if ((ret = r_rsa_raw_decrypt_internal (pk, NULL, data, em, size)) == R_CRYPTO_OK)
+    ret = r_rsa_pkcs1v1_5_implicit_select (pk, data, em, k, out, out_size);
+
+  r_memclear_secure (em, size);
+  return ret;
+}
+
 RCryptoResult
 r_rsa_pkcs1v1_5_sign_msg (const RCryptoKey * key, RPrng * prng,
     RMsgDigestType mdtype, rconstpointer msg, rsize msgsize,
@@ -1264,26 +1490,15 @@ r_rsa_oid_from_msg_digest (RMsgDigestType mdtype, ruint8 oid[16])
   return 0;
 }
 
-RCryptoResult
-r_rsa_pkcs1v1_5_sign_msg_hash (const RCryptoKey * key, RPrng * prng,
-    RMsgDigestType mdtype, rconstpointer hash, rsize hashsize,
-    rpointer sig, rsize * sigsize)
+/* EMSA-PKCS1-v1_5 encoding of a DigestInfo over hash into the k-byte em. */
+static RCryptoResult
+r_rsa_pkcs1v1_5_sign_encode (RMsgDigestType mdtype,
+    rconstpointer hash, rsize hashsize, ruint8 * em, rsize k)
 {
   RAsn1BinEncoder * enc;
-  rsize k, oidsize, di_size;
+  rsize oidsize, di_size;
   ruint8 * ptr, * di, oidbuf[16];
-  RCryptoResult ret;
-
-  (void) prng;
-
-  if (R_UNLIKELY (key == NULL)) return R_CRYPTO_INVAL;
-  if (R_UNLIKELY (key->algo->algo != R_CRYPTO_ALGO_RSA)) return R_CRYPTO_WRONG_TYPE;
-  if (R_UNLIKELY (key->type != R_CRYPTO_PRIVATE_KEY)) return R_CRYPTO_WRONG_TYPE;
-  if (R_UNLIKELY (hash == NULL || hashsize == 0 || sig == NULL || sigsize == NULL))
-    return R_CRYPTO_INVAL;
 
-  if (*sigsize < (k = r_crypto_key_get_bitsize (key) / 8))
-    return R_CRYPTO_BUFFER_TOO_SMALL;
   if ((oidsize = r_rsa_oid_from_msg_digest (mdtype, oidbuf)) == 0)
     return R_CRYPTO_HASH_FAILED;
 
@@ -1323,8 +1538,7 @@ r_rsa_pkcs1v1_5_sign_msg_hash (const RCryptoKey * key, RPrng * prng,
     return R_CRYPTO_BUFFER_TOO_SMALL;
   }
 
-  *sigsize = k;
-  ptr = sig;
+  ptr = em;
   *ptr++ = 0x00;
   *ptr++ = R_RSA_EMSA_PKCS1;
   r_memset (ptr, 0xff, k - 3 - di_size);
@@ -1333,6 +1547,29 @@ r_rsa_pkcs1v1_5_sign_msg_hash (const RCryptoKey * key, RPrng * prng,
   r_memcpy (ptr, di, di_size);
   r_free (di);
 
+  return R_CRYPTO_OK;
+}
+
+RCryptoResult
+r_rsa_pkcs1v1_5_sign_msg_hash (const RCryptoKey * key, RPrng * prng,
+    RMsgDigestType mdtype, rconstpointer hash, rsize hashsize,
+    rpointer sig, rsize * sigsize)
+{
+  RCryptoResult ret;
+  rsize k;
+
+  if (R_UNLIKELY (key == NULL)) return R_CRYPTO_INVAL;
+  if (R_UNLIKELY (key->algo->algo != R_CRYPTO_ALGO_RSA)) return R_CRYPTO_WRONG_TYPE;
+  if (R_UNLIKELY (key->type != R_CRYPTO_PRIVATE_KEY)) return R_CRYPTO_WRONG_TYPE;
+  if (R_UNLIKELY (hash == NULL || hashsize == 0 || sig == NULL || sigsize == NULL))
+    return R_CRYPTO_INVAL;
+
+  if (*sigsize < (k = r_rsa_pub_key_len ((const RRsaPubKey *)key)))
+    return R_CRYPTO_BUFFER_TOO_SMALL;
+  if ((ret = r_rsa_pkcs1v1_5_sign_encode (mdtype, hash, hashsize, sig, k)) != R_CRYPTO_OK)
+    return ret;
+
+  *sigsize = k;
   if (r_rsa_raw_decrypt_internal ((const RRsaPrivKey *)key, prng, sig, sig, k) != R_CRYPTO_OK)
     ret = R_CRYPTO_SIGN_FAILED;
   else
@@ -1353,7 +1590,7 @@ r_rsa_pkcs1v1_5_sign_hash (const RCryptoKey * key, RPrng * prng,
   if (R_UNLIKELY (hash == NULL || hashsize == 0 || sig == NULL || sigsize == NULL))
     return R_CRYPTO_INVAL;
 
-  if (*sigsize < (k = r_crypto_key_get_bitsize (key) / 8))
+  if (*sigsize < (k = r_rsa_pub_key_len ((const RRsaPubKey *)key)))
     return R_CRYPTO_BUFFER_TOO_SMALL;
   if (R_UNLIKELY (hashsize + 3 > k))
     return R_CRYPTO_BUFFER_TOO_SMALL;
@@ -1677,41 +1914,57 @@ r_rsa_emsa_pss_verify (RMsgDigestType mdtype, const ruint8 * mhash, rsize hlen,
   return (r_memcmp (hprime, h, hlen) == 0) ? R_CRYPTO_OK : R_CRYPTO_VERIFY_FAILED;
 }
 
-RCryptoResult
-r_rsa_pss_sign_hash (const RCryptoKey * key, RPrng * prng,
+/* EMSA-PSS encoding of hash, right-aligned in the k-byte em (leading
+ * zeros when emLen < k) for the RSA private-key primitive. */
+static RCryptoResult
+r_rsa_pss_sign_encode (const RCryptoKey * key, RPrng * prng,
     RMsgDigestType mdtype, rconstpointer hash, rsize hashsize,
-    rpointer sig, rsize * sigsize)
+    ruint8 * em, rsize k)
 {
-  rsize k, modbits, embits, emlen, hlen;
-  ruint8 * em;
-
-  if (R_UNLIKELY (key == NULL)) return R_CRYPTO_INVAL;
-  if (R_UNLIKELY (key->algo->algo != R_CRYPTO_ALGO_RSA)) return R_CRYPTO_WRONG_TYPE;
-  if (R_UNLIKELY (key->type != R_CRYPTO_PRIVATE_KEY)) return R_CRYPTO_WRONG_TYPE;
-  if (R_UNLIKELY (prng == NULL || hash == NULL || sig == NULL || sigsize == NULL))
-    return R_CRYPTO_INVAL;
+  rsize modbits, embits, emlen, hlen;
 
   hlen = r_msg_digest_type_size (mdtype);
   if (R_UNLIKELY (hlen == 0 || hashsize != hlen))
     return R_CRYPTO_INVAL;
 
   modbits = r_crypto_key_get_bitsize (key);
-  k = modbits / 8;
   embits = modbits - 1;
   emlen = (embits + 7) / 8;
-  if (R_UNLIKELY (*sigsize < k))
-    return R_CRYPTO_BUFFER_TOO_SMALL;
   if (R_UNLIKELY (emlen > k || emlen < hlen + hlen + 2))
     return R_CRYPTO_BUFFER_TOO_SMALL;
 
-  /* Build EM right-aligned in a k-octet buffer (leading zeros when
-   * emLen < k), then apply the RSA private-key primitive. */
-  em = r_alloca (k);
   r_memset (em, 0, k - emlen);
   if (r_rsa_emsa_pss_encode (prng, mdtype, hash, hlen, embits,
           em + (k - emlen), emlen) != R_CRYPTO_OK)
     return R_CRYPTO_SIGN_FAILED;
 
+  return R_CRYPTO_OK;
+}
+
+RCryptoResult
+r_rsa_pss_sign_hash (const RCryptoKey * key, RPrng * prng,
+    RMsgDigestType mdtype, rconstpointer hash, rsize hashsize,
+    rpointer sig, rsize * sigsize)
+{
+  RCryptoResult ret;
+  rsize k;
+  ruint8 * em;
+
+  if (R_UNLIKELY (key == NULL)) return R_CRYPTO_INVAL;
+  if (R_UNLIKELY (key->algo->algo != R_CRYPTO_ALGO_RSA)) return R_CRYPTO_WRONG_TYPE;
+  if (R_UNLIKELY (key->type != R_CRYPTO_PRIVATE_KEY)) return R_CRYPTO_WRONG_TYPE;
+  if (R_UNLIKELY (prng == NULL || hash == NULL || sig == NULL || sigsize == NULL))
+    return R_CRYPTO_INVAL;
+
+  k = r_rsa_pub_key_len ((const RRsaPubKey *)key);
+  if (R_UNLIKELY (*sigsize < k))
+    return R_CRYPTO_BUFFER_TOO_SMALL;
+
+  em = r_alloca (k);
+  if ((ret = r_rsa_pss_sign_encode (key, prng, mdtype, hash, hashsize,
+          em, k)) != R_CRYPTO_OK)
+    return ret;
+
   if (r_rsa_raw_decrypt_internal ((const RRsaPrivKey *) key, prng, em, sig, k)
         != R_CRYPTO_OK)
     return R_CRYPTO_SIGN_FAILED;
@@ -1737,7 +1990,7 @@ r_rsa_pss_verify_hash (const RCryptoKey * key,
     return R_CRYPTO_INVAL;
 
   modbits = r_crypto_key_get_bitsize (key);
-  k = modbits / 8;
+  k = (modbits + 7) / 8;
   embits = modbits - 1;
   emlen = (embits + 7) / 8;
   if (R_UNLIKELY (sigsize != k || emlen > k))
@@ -1751,3 +2004,128 @@ r_rsa_pss_verify_hash (const RCryptoKey * key,
   return r_rsa_emsa_pss_verify (mdtype, hash, hlen, embits, em + (k - emlen), emlen);
 }
 
+
+RCryptoResult
+r_rsa_priv_key_sign_batch (const RCryptoKey * key, RPrng * prng,
+    RRsaSignRequest * reqs, rsize count)
+{
+  const RRsaPrivKey * pk = (const RRsaPrivKey *)key;
+  ruint8 * blocks[R_RSA_BATCH_LANES];
+  RCryptoResult res[R_RSA_BATCH_LANES], ret = R_CRYPTO_OK;
+  rsize idx[R_RSA_BATCH_LANES];
+  rsize off, i, j, k, n;
+  rboolean own_prng = FALSE;
+
+  if (R_UNLIKELY (key == NULL)) return R_CRYPTO_INVAL;
+  if (R_UNLIKELY (key->algo->algo != R_CRYPTO_ALGO_RSA)) return R_CRYPTO_WRONG_TYPE;
+  if (R_UNLIKELY (key->type != R_CRYPTO_PRIVATE_KEY)) return R_CRYPTO_WRONG_TYPE;
+  if (R_UNLIKELY (reqs == NULL && count > 0)) return R_CRYPTO_INVAL;
+  if (pk->pub.padding != R_RSA_PADDING_PKCS1_V15 &&
+      pk->pub.padding != R_RSA_PADDING_PKCS1_V21)
+    return R_CRYPTO_NOT_AVAILABLE;
+
+  if (prng == NULL) {
+    if ((prng = r_rand_prng_new ()) == NULL)
+      return R_CRYPTO_ERROR;
+    own_prng = TRUE;
+  }
+
+  k = r_rsa_pub_key_len (&pk->pub);
+  for (off = 0; off < count; off += R_RSA_BATCH_LANES) {
+    rsize chunk = MIN (count - off, R_RSA_BATCH_LANES);
+
+    for (i = n = 0; i < chunk; i++) {
+      RRsaSignRequest * req = &reqs[off + i];
+
+      if (R_UNLIKELY (req->hash == NULL || req->hashsize == 0 || req->sig == NULL))
+        req->result = R_CRYPTO_INVAL;
+      else if (req->sigsize < k)
+        req->result = R_CRYPTO_BUFFER_TOO_SMALL;
+      else if (pk->pub.padding == R_RSA_PADDING_PKCS1_V15)
+        req->result = r_rsa_pkcs1v1_5_sign_encode (req->mdtype,
+            req->hash, req->hashsize, req->sig, k);
+      else
+        req->result = r_rsa_pss_sign_encode (key, prng, req->mdtype,
+            req->hash, req->hashsize, req->sig, k);
+
+      if (req->result == R_CRYPTO_OK) {
+        blocks[n] = req->sig;
+        idx[n++] = off + i;
+      }
+    }
+
+    r_rsa_raw_decrypt_batch_internal (pk, prng, blocks, res, n);
+
+    for (j = 0; j < n; j++) {
+      RRsaSignRequest * req = &reqs[idx[j]];
+
+      if (res[j] == R_CRYPTO_OK)
+        req->sigsize = k;
+      else
+        req->result = R_CRYPTO_SIGN_FAILED;
+    }
+    for (i = 0; i < chunk && ret == R_CRYPTO_OK; i++)
+      ret = reqs[off + i].result;
+  }
+
+  if (own_prng)
+    r_prng_unref (prng);
+  return ret;
+}
+
+RCryptoResult
+r_rsa_priv_key_decrypt_batch (const RCryptoKey * key, RPrng * prng,
+    RRsaDecryptRequest * reqs, rsize count)
+{
+  const RRsaPrivKey * pk = (const RRsaPrivKey *)key;
+  ruint8 * blocks[R_RSA_BATCH_LANES];
+  RCryptoResult res[R_RSA_BATCH_LANES], ret = R_CRYPTO_OK;
+  rsize idx[R_RSA_BATCH_LANES];
+  rsize off, i, j, k, n;
+  ruint8 * em;
+
+  if (R_UNLIKELY (key == NULL)) return R_CRYPTO_INVAL;
+  if (R_UNLIKELY (key->algo->algo != R_CRYPTO_ALGO_RSA)) return R_CRYPTO_WRONG_TYPE;
+  if (R_UNLIKELY (key->type != R_CRYPTO_PRIVATE_KEY)) return R_CRYPTO_WRONG_TYPE;
+  if (R_UNLIKELY (reqs == NULL && count > 0)) return R_CRYPTO_INVAL;
+  if (pk->pub.padding != R_RSA_PADDING_PKCS1_V15)
+    return R_CRYPTO_NOT_AVAILABLE;
+
+  k = r_rsa_pub_key_len (&pk->pub);
+  em = r_alloca (R_RSA_BATCH_LANES * k);
+
+  for (off = 0; off < count; off += R_RSA_BATCH_LANES) {
+    rsize chunk = MIN (count - off, R_RSA_BATCH_LANES);
+
+    for (i = n = 0; i < chunk; i++) {
+      RRsaDecryptRequest * req = &reqs[off + i];
+
+      /* Same argument checks as r_rsa_pkcs1v1_5_decrypt_implicit. */
+      if (R_UNLIKELY (req->data == NULL || req->out == NULL)) {
+        req->result = R_CRYPTO_INVAL;
+      } else if (R_UNLIKELY (req->size != k ||
+            req->outsize == 0 || req->outsize > k - 11)) {
+        req->result = R_CRYPTO_WRONG_SIZE;
+      } else {
+        blocks[n] = em + n * k;
+        r_memcpy (blocks[n], req->data, k);
+        idx[n++] = off + i;
+      }
+    }
+
+    r_rsa_raw_decrypt_batch_internal (pk, prng, blocks, res, n);
+
+    for (j = 0; j < n; j++) {
+      RRsaDecryptRequest * req = &reqs[idx[j]];
+
+      if ((req->result = res[j]) == R_CRYPTO_OK)
+        req->result = r_rsa_pkcs1v1_5_implicit_select (pk, req->data,
+            blocks[j], k, req->out, req->outsize);
+    }
+    for (i = 0; i < chunk && ret == R_CRYPTO_OK; i++)
+      ret = reqs[off + i].result;
+  }
+
+  r_memclear_secure (em, R_RSA_BATCH_LANES * k);
+  return ret;
+}
@@ -0,0 +1,610 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2016 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+
+#include "config.h"
+#include "rhash-private.h"
+#include <rlib/data/rconcurrenthashmap.h>
+
+#include <rlib/data/rhzrptr.h>
+#include <rlib/concurrency/ratomic.h>
+#include <rlib/concurrency/rthreads.h>
+#include <rlib/rmem.h>
+
+/* Layout: shard -> table (bucket array) -> bucket (immutable vector of
+ * {hash, node}) -> node (immutable {key, value}). A node is the one physical
+ * copy of an entry for its whole life; buckets and tables are copied on
+ * write, under the shard lock, and the copies swapped in atomically.
+ *
+ * A reader pins the table, then the bucket, then a candidate node with one
+ * hazard pointer each, re-checking after every pin that what it pinned is
+ * still reachable from the shard. Once the node is proven reachable after its
+ * hazard went up, the writer that unlinks it will only retire it later, and
+ * the retirement scan will see the hazard. A stale table or bucket just
+ * restarts the lookup. */
+#define R_CHM_SHARD_BITS        6
+#define R_CHM_SHARDS            (1 << R_CHM_SHARD_BITS)
+#define R_CHM_MIN_BUCKETS       8
+/* Average bucket length at which a shard's table doubles. */
+#define R_CHM_MAX_LOAD          2
+
+typedef struct {
+  rpointer key;
+  rpointer val;
+  /* Applied when the node is reclaimed after being unlinked; a node whose
+   * key lives on in its successor has keynotify cleared. */
+  RDestroyNotify keynotify;
+  RDestroyNotify valuenotify;
+} RCHMNode;
+
+typedef struct {
+  rsize hash;
+  RCHMNode * node;
+} RCHMSlot;
+
+typedef struct {
+  rsize count;
+  RCHMSlot slot[];
+} RCHMBucket;
+
+typedef struct {
+  rsize mask;
+  raptr bucket[];       /* (RCHMBucket *), NULL when empty */
+} RCHMTable;
+
+typedef struct {
+  RMutex lock;          /* serialises writers */
+  raptr table;          /* (RCHMTable *) */
+  rauint count;
+} RCHMShard;
+
+struct RConcurrentHashMap {
+  RRef ref;
+
+  RHashFunc hashfunc;
+  REqualFunc equalfunc;
+  RDestroyNotify keynotify;
+  RDestroyNotify valuenotify;
+  RConcurrentHashMapRefFunc valueref;
+
+  RCHMShard shard[R_CHM_SHARDS];
+};
+
+/* One hazard record per level a reader pins at once; per thread, shared by
+ * every map. */
+typedef struct {
+  RHzrPtrRec * table;
+  RHzrPtrRec * bucket;
+  RHzrPtrRec * node;
+} RCHMRecs;
+
+static void
+r_chm_recs_free (RCHMRecs * recs)
+{
+  r_hzr_ptr_rec_free (recs->table);
+  r_hzr_ptr_rec_free (recs->bucket);
+  r_hzr_ptr_rec_free (recs->node);
+  r_free (recs);
+}
+
+static RTss g__r_chm_tss = R_TSS_INIT (r_chm_recs_free);
+
+static RCHMRecs *
+r_chm_recs (void)
+{
+  RCHMRecs * ret;
+
+  if (R_UNLIKELY ((ret = r_tss_get (&g__r_chm_tss)) == NULL)) {
+    ret = r_mem_new (RCHMRecs);
+    ret->table = r_hzr_ptr_rec_new ();
+    ret->bucket = r_hzr_ptr_rec_new ();
+    ret->node = r_hzr_ptr_rec_new ();
+    r_tss_set (&g__r_chm_tss, ret);
+  }
+
+  return ret;
+}
+
+static void
+r_chm_node_free (RCHMNode * node)
+{
+  if (node->keynotify != NULL)
+    node->keynotify (node->key);
+  if (node->valuenotify != NULL)
+    node->valuenotify (node->val);
+  r_free (node);
+}
+
+static RCHMNode *
+r_chm_node_new (RConcurrentHashMap * map, rpointer key, rpointer val)
+{
+  RCHMNode * ret;
+
+  if ((ret = r_mem_new (RCHMNode)) != NULL) {
+    ret->key = key;
+    ret->val = val;
+    ret->keynotify = map->keynotify;
+    ret->valuenotify = map->valuenotify;
+  }
+
+  return ret;
+}
+
+static RCHMTable *
+r_chm_table_new (rsize buckets)
+{
+  RCHMTable * ret;
+
+  if ((ret = r_malloc (sizeof (RCHMTable) + buckets * sizeof (raptr))) != NULL) {
+    rsize i;
+    ret->mask = buckets - 1;
+    for (i = 0; i < buckets; i++)
+      r_atomic_ptr_store (&ret->bucket[i], NULL);
+  }
+
+  return ret;
+}
+
+/* Frees the table and the buckets it still links, never the nodes: they
+ * have moved on to the table that replaced it. */
+static void
+r_chm_table_free (RCHMTable * table)
+{
+  rsize i;
+
+  for (i = 0; i <= table->mask; i++)
+    r_free (r_atomic_ptr_load (&table->bucket[i]));
+  r_free (table);
+}
+
+static inline rsize
+r_chm_mix (rsize hash)
+{
+  return hash * R_HASH_GOLDEN;
+}
+
+static inline RCHMShard *
+r_chm_shard (RConcurrentHashMap * map, rsize mix)
+{
+  return &map->shard[mix >> (sizeof (rsize) * 8 - R_CHM_SHARD_BITS)];
+}
+
+static inline rsize
+r_chm_bucket_idx (const RCHMTable * table, rsize mix)
+{
+  return (mix ^ (mix >> (sizeof (rsize) * 4))) & table->mask;
+}
+
+static inline rboolean
+r_chm_key_equal (RConcurrentHashMap * map, rconstpointer a, rconstpointer b)
+{
+  return map->equalfunc != NULL ? map->equalfunc (a, b) : a == b;
+}
+
+static inline rpointer
+r_chm_ref_value (RConcurrentHashMap * map, rpointer val)
+{
+  return (map->valueref != NULL && val != NULL) ? map->valueref (val) : val;
+}
+
+static void
+r_concurrent_hash_map_free (RConcurrentHashMap * map)
+{
+  rsize s, i, j;
+
+  for (s = 0; s < R_CHM_SHARDS; s++) {
+    RCHMTable * table = r_atomic_ptr_load (&map->shard[s].table);
+
+    for (i = 0; i <= table->mask; i++) {
+      RCHMBucket * b = r_atomic_ptr_load (&table->bucket[i]);
+      if (b == NULL)
+        continue;
+      for (j = 0; j < b->count; j++)
+        r_chm_node_free (b->slot[j].node);
+    }
+
+    r_chm_table_free (table);
+    r_mutex_clear (&map->shard[s].lock);
+  }
+
+  r_free (map);
+}
+
+RConcurrentHashMap *
+r_concurrent_hash_map_new_full (RHashFunc hash, REqualFunc equal,
+    RDestroyNotify keynotify, RDestroyNotify valuenotify,
+    RConcurrentHashMapRefFunc valueref)
+{
+  RConcurrentHashMap * ret;
+
+  if ((ret = r_mem_new0 (RConcurrentHashMap)) != NULL) {
+    rsize s;
+
+    r_ref_init (ret, r_concurrent_hash_map_free);
+    ret->hashfunc = hash != NULL ? hash : r_direct_hash;
+    ret->equalfunc = equal;
+    ret->keynotify = keynotify;
+    ret->valuenotify = valuenotify;
+    ret->valueref = valueref;
+
+    for (s = 0; s < R_CHM_SHARDS; s++) {
+      r_mutex_init (&ret->shard[s].lock);
+      r_atomic_ptr_store (&ret->shard[s].table, r_chm_table_new (R_CHM_MIN_BUCKETS));
+      r_atomic_uint_store (&ret->shard[s].count, 0);
+    }
+  }
+
+  return ret;
+}
+
+rsize
+r_concurrent_hash_map_size (RConcurrentHashMap * map)
+{
+  rsize s, ret = 0;
+
+  if (R_UNLIKELY (map == NULL)) return 0;
+
+  for (s = 0; s < R_CHM_SHARDS; s++)
+    ret += r_atomic_uint_load (&map->shard[s].count);
+  return ret;
+}
+
+rboolean
+r_concurrent_hash_map_lookup (RConcurrentHashMap * map, rconstpointer key,
+    rpointer * value)
+{
+  RCHMRecs * recs;
+  RCHMShard * shard;
+  rsize hash, mix, i;
+  rboolean ret;
+
+  if (R_UNLIKELY (map == NULL)) return FALSE;
+
+  hash = map->hashfunc (key);
+  mix = r_chm_mix (hash);
+  shard = r_chm_shard (map, mix);
+  recs = r_chm_recs ();
+
+retry:
+  {
+    RCHMTable * table;
+    RCHMBucket * b;
+    raptr * link;
+
+    do {
+      table = r_atomic_ptr_load (&shard->table);
+      r_hzr_ptr_protect (recs->table, table);
+    } while (r_atomic_ptr_load (&shard->table) != table);
+
+    link = &table->bucket[r_chm_bucket_idx (table, mix)];
+    do {
+      b = r_atomic_ptr_load (link);
+      r_hzr_ptr_protect (recs->bucket, b);
+    } while (r_atomic_ptr_load (link) != b);
+
+    ret = FALSE;
+    for (i = 0; b != NULL && i < b->count; i++) {
+      RCHMNode * node;
+
+      if (b->slot[i].hash != hash)
+        continue;
+
+      node = b->slot[i].node;
+      r_hzr_ptr_protect (recs->node, node);
+      if (r_atomic_ptr_load (&shard->table) != table ||
+          r_atomic_ptr_load (link) != b) {
+        r_hzr_ptr_protect (recs->node, NULL);
+        goto retry;
+      }
+
+      if (r_chm_key_equal (map, key, node->key)) {
+        if (value != NULL)
+          *value = r_chm_ref_value (map, node->val);
+        ret = TRUE;
+        break;
+      }
+    }
+  }
+
+  r_hzr_ptr_protect (recs->node, NULL);
+  r_hzr_ptr_protect (recs->bucket, NULL);
+  r_hzr_ptr_protect (recs->table, NULL);
+  return ret;
+}
+
+/* Everything below runs with the shard lock held: the current table and its
+ * buckets are stable, and writes publish fresh copies. */
+
+static RCHMBucket *
+r_chm_bucket_alloc (rsize count)
+{
+  RCHMBucket * ret;
+
+  if ((ret = r_malloc (sizeof (RCHMBucket) + count * sizeof (RCHMSlot))) != NULL)
+    ret->count = count;
+  return ret;
+}
+
+static rsize
+r_chm_find_locked (RConcurrentHashMap * map, RCHMBucket * b,
+    rconstpointer key, rsize hash)
+{
+  rsize i;
+
+  for (i = 0; b != NULL && i < b->count; i++) {
+    if (b->slot[i].hash == hash && r_chm_key_equal (map, key, b->slot[i].node->key))
+      return i;
+  }
+
+  return RSIZE_MAX;
+}
+
+/* Double the shard's table; the nodes are shared, only the buckets copied. */
+static void
+r_chm_grow_locked (RCHMShard * shard, RCHMTable * old)
+{
+  RCHMTable * table;
+  rsize i, j, n = (old->mask + 1) * 2;
+  rsize * counts;
+
+  if ((table = r_chm_table_new (n)) == NULL)
+    return;
+  counts = r_mem_new0_n (rsize, n);
+
+  for (i = 0; i <= old->mask; i++) {
+    RCHMBucket * b = r_atomic_ptr_load (&old->bucket[i]);
+    for (j = 0; b != NULL && j < b->count; j++)
+      counts[r_chm_bucket_idx (table, r_chm_mix (b->slot[j].hash))]++;
+  }
+  for (i = 0; i < n; i++) {
+    if (counts[i] > 0) {
+      RCHMBucket * nb = r_chm_bucket_alloc (counts[i]);
+      nb->count = 0;
+      r_atomic_ptr_store (&table->bucket[i], nb);
+    }
+  }
+  for (i = 0; i <= old->mask; i++) {
+    RCHMBucket * b = r_atomic_ptr_load (&old->bucket[i]);
+    for (j = 0; b != NULL && j < b->count; j++) {
+      RCHMBucket * nb = r_atomic_ptr_load (&table->bucket[
+          r_chm_bucket_idx (table, r_chm_mix (b->slot[j].hash))]);
+      nb->slot[nb->count++] = b->slot[j];
+    }
+  }
+
+  r_free (counts);
+  r_atomic_ptr_store (&shard->table, table);
+  r_hzr_ptr_retire (old, (RDestroyNotify)r_chm_table_free);
+}
+
+/* Publish @b with slot @idx replaced by @node (@idx == count appends,
+ * @node == NULL removes) and retire the bucket it replaces. */
+static rboolean
+r_chm_bucket_update_locked (raptr * link, RCHMBucket * b, rsize idx,
+    rsize hash, RCHMNode * node)
+{
+  rsize count = b != NULL ? b->count : 0, ncount;
+  RCHMBucket * nb;
+
+  if (R_UNLIKELY (node == NULL && idx >= count))
+    return FALSE;
+  ncount = node == NULL ? count - 1 : (idx == count ? count + 1 : count);
+  if (ncount == 0) {
+    nb = NULL;
+  } else if ((nb = r_chm_bucket_alloc (ncount)) != NULL) {
+    if (node == NULL) {
+      r_memcpy (nb->slot, b->slot, idx * sizeof (RCHMSlot));
+      r_memcpy (nb->slot + idx, b->slot + idx + 1, (count - idx - 1) * sizeof (RCHMSlot));
+    } else {
+      if (count > 0)
+        r_memcpy (nb->slot, b->slot, count * sizeof (RCHMSlot));
+      nb->slot[idx].hash = hash;
+      nb->slot[idx].node = node;
+    }
+  } else {
+    return FALSE;
+  }
+
+  r_atomic_ptr_store (link, nb);
+  r_hzr_ptr_retire (b, r_free);
+  return TRUE;
+}
+
+/* Unlinked @node is reclaimed once no reader has it pinned. */
+static inline void
+r_chm_node_retire (RCHMNode * node, rboolean keep_key)
+{
+  if (keep_key)
+    node->keynotify = NULL;
+  r_hzr_ptr_retire (node, (RDestroyNotify)r_chm_node_free);
+}
+
+typedef enum {
+  R_CHM_PUT_REPLACE,
+  R_CHM_PUT_IF_ABSENT,
+} RCHMPutMode;
+
+static RHashTableError
+r_chm_put (RConcurrentHashMap * map, rpointer key, rpointer value,
+    RCHMPutMode mode, rpointer * existing)
+{
+  RCHMShard * shard;
+  RCHMTable * table;
+  RCHMBucket * b;
+  RCHMNode * node;
+  raptr * link;
+  rsize hash, mix, idx;
+  RHashTableError ret;
+
+  hash = map->hashfunc (key);
+  mix = r_chm_mix (hash);
+  shard = r_chm_shard (map, mix);
+
+  r_mutex_lock (&shard->lock);
+  table = r_atomic_ptr_load (&shard->table);
+  link = &table->bucket[r_chm_bucket_idx (table, mix)];
+  b = r_atomic_ptr_load (link);
+
+  if ((idx = r_chm_find_locked (map, b, key, hash)) != RSIZE_MAX) {
+    RCHMNode * old = b->slot[idx].node;
+
+    if (mode == R_CHM_PUT_IF_ABSENT) {
+      if (existing != NULL)
+        *existing = r_chm_ref_value (map, old->val);
+      ret = R_HASH_TABLE_REPLACE;
+    } else if ((node = r_chm_node_new (map, key, value)) == NULL) {
+      ret = R_HASH_TABLE_ERROR;
+    } else if (!r_chm_bucket_update_locked (link, b, idx, hash, node)) {
+      r_free (node);
+      ret = R_HASH_TABLE_ERROR;
+    } else {
+      r_chm_node_retire (old, FALSE);
+      ret = R_HASH_TABLE_REPLACE;
+    }
+  } else if ((node = r_chm_node_new (map, key, value)) == NULL) {
+    ret = R_HASH_TABLE_ERROR;
+  } else if (!r_chm_bucket_update_locked (link, b,
+        b != NULL ? b->count : 0, hash, node)) {
+    r_free (node);
+    ret = R_HASH_TABLE_ERROR;
+  } else {
+    ruint count = r_atomic_uint_fetch_add (&shard->count, 1) + 1;
+    if (count > (table->mask + 1) * R_CHM_MAX_LOAD)
+      r_chm_grow_locked (shard, table);
+    ret = R_HASH_TABLE_OK;
+  }
+
+  r_mutex_unlock (&shard->lock);
+  return ret;
+}
+
+RHashTableError
+r_concurrent_hash_map_insert (RConcurrentHashMap * map,
+    rpointer key, rpointer value)
+{
+  if (R_UNLIKELY (map == NULL)) return R_HASH_TABLE_INVAL;
+  return r_chm_put (map, key, value, R_CHM_PUT_REPLACE, NULL);
+}
+
+rboolean
+r_concurrent_hash_map_insert_if_absent (RConcurrentHashMap * map,
+    rpointer key, rpointer value, rpointer * existing)
+{
+  if (R_UNLIKELY (map == NULL)) return FALSE;
+  return r_chm_put (map, key, value, R_CHM_PUT_IF_ABSENT, existing) == R_HASH_TABLE_OK;
+}
+
+rboolean
+r_concurrent_hash_map_compute_if_present (RConcurrentHashMap * map,
+    rconstpointer key, RConcurrentHashMapComputeFunc func, rpointer user)
+{
+  RCHMShard * shard;
+  RCHMTable * table;
+  RCHMBucket * b;
+  raptr * link;
+  rsize hash, mix, idx;
+
+  if (R_UNLIKELY (map == NULL || func == NULL)) return FALSE;
+
+  hash = map->hashfunc (key);
+  mix = r_chm_mix (hash);
+  shard = r_chm_shard (map, mix);
+
+  r_mutex_lock (&shard->lock);
+  table = r_atomic_ptr_load (&shard->table);
+  link = &table->bucket[r_chm_bucket_idx (table, mix)];
+  b = r_atomic_ptr_load (link);
+
+  if ((idx = r_chm_find_locked (map, b, key, hash)) != RSIZE_MAX) {
+    RCHMNode * old = b->slot[idx].node, * node;
+    rpointer val = func (old->key, old->val, user);
+
+    if (val == NULL) {
+      if (r_chm_bucket_update_locked (link, b, idx, hash, NULL)) {
+        r_atomic_uint_fetch_sub (&shard->count, 1);
+        r_chm_node_retire (old, FALSE);
+      }
+    } else if (val != old->val) {
+      /* The key moves to the new node; only the old value is notified. */
+      if ((node = r_chm_node_new (map, old->key, val)) != NULL) {
+        if (r_chm_bucket_update_locked (link, b, idx, hash, node))
+          r_chm_node_retire (old, TRUE);
+        else
+          r_free (node);
+      }
+    }
+  }
+
+  r_mutex_unlock (&shard->lock);
+  return idx != RSIZE_MAX;
+}
+
+rboolean
+r_concurrent_hash_map_remove (RConcurrentHashMap * map, rconstpointer key)
+{
+  RCHMShard * shard;
+  RCHMTable * table;
+  RCHMBucket * b;
+  raptr * link;
+  rsize hash, mix, idx;
+  rboolean ret = FALSE;
+
+  if (R_UNLIKELY (map == NULL)) return FALSE;
+
+  hash = map->hashfunc (key);
+  mix = r_chm_mix (hash);
+  shard = r_chm_shard (map, mix);
+
+  r_mutex_lock (&shard->lock);
+  table = r_atomic_ptr_load (&shard->table);
+  link = &table->bucket[r_chm_bucket_idx (table, mix)];
+  b = r_atomic_ptr_load (link);
+
+  if ((idx = r_chm_find_locked (map, b, key, hash)) != RSIZE_MAX) {
+    RCHMNode * old = b->slot[idx].node;
+    if ((ret = r_chm_bucket_update_locked (link, b, idx, hash, NULL))) {
+      r_atomic_uint_fetch_sub (&shard->count, 1);
+      r_chm_node_retire (old, FALSE);
+    }
+  }
+
+  r_mutex_unlock (&shard->lock);
+  return ret;
+}
+
+void
+r_concurrent_hash_map_foreach (RConcurrentHashMap * map,
+    RKeyValueFunc func, rpointer user)
+{
+  rsize s, i, j;
+
+  if (R_UNLIKELY (map == NULL || func == NULL)) return;
+
+  for (s = 0; s < R_CHM_SHARDS; s++) {
+    RCHMShard * shard = &map->shard[s];
+    RCHMTable * table;
+
+    r_mutex_lock (&shard->lock);
+    table = r_atomic_ptr_load (&shard->table);
+    for (i = 0; i <= table->mask; i++) {
+      RCHMBucket * b = r_atomic_ptr_load (&table->bucket[i]);
+      for (j = 0; b != NULL && j < b->count; j++)
+        func (b->slot[j].node->key, b->slot[j].node->val, user);
+    }
+    r_mutex_unlock (&shard->lock);
+  }
+}
@@ -41,4 +41,43 @@
   (rsize) (((hash) * R_HASH_GOLDEN) >>                                        \
       (sizeof (rsize) * 8 - ((allocidx) + 3)))
 
+/* Grouped open addressing (R_HASH_FLAG_GROUPED), shared by RHashTable and
+ * RHashSet. One control byte per slot -- EMPTY, DELETED, or the top 7 bits of
+ * the mixed hash for a full slot -- lives in its own array and is probed
+ * R_HASH_GROUP_WIDTH slots per compare; keys (and values) sit in parallel
+ * arrays that are only touched on a control-byte match. The control array
+ * carries R_HASH_GROUP_WIDTH cloned bytes past the end so a group load may
+ * start at any slot. */
+#define R_HASH_GROUP_WIDTH        16
+#define R_HASH_GROUPS_NONE        RSIZE_MAX
+#define R_HASH_CTRL_EMPTY         ((ruint8) 0x80)
+#define R_HASH_CTRL_DELETED       ((ruint8) 0xfe)
+#define R_HASH_CTRL_IS_FULL(c)    (((c) & 0x80) == 0)
+
+typedef struct {
+  ruint8 * ctrl;
+  rpointer * keys;
+  rpointer * vals;      /* NULL for a set */
+  rsize mask;           /* capacity - 1; 0 until the first insert */
+  rsize size;
+  rsize growth_left;    /* inserts into EMPTY slots before the next rehash */
+  rboolean values;
+} RHashGroups;
+
+#define r_hash_groups_capacity(g) \
+  ((g)->keys != NULL ? (g)->mask + 1 : (rsize) 0)
+
+R_API_HIDDEN void r_hash_groups_init (RHashGroups * g, rboolean values);
+R_API_HIDDEN void r_hash_groups_clear (RHashGroups * g,
+    RDestroyNotify keynotify, RDestroyNotify valuenotify);
+R_API_HIDDEN void r_hash_groups_remove_all (RHashGroups * g,
+    RDestroyNotify keynotify, RDestroyNotify valuenotify);
+R_API_HIDDEN rsize r_hash_groups_find (const RHashGroups * g,
+    rconstpointer key, rsize hash, REqualFunc equal);
+R_API_HIDDEN rsize r_hash_groups_insert_slot (RHashGroups * g,
+    rconstpointer key, rsize hash, REqualFunc equal, RHashFunc hashfunc,
+    rboolean * found);
+R_API_HIDDEN void r_hash_groups_erase (RHashGroups * g, rsize idx);
+R_API_HIDDEN rsize r_hash_groups_max_probe (const RHashGroups * g);
+
 #endif /* __R_HASH_PRIV_H__ */
@@ -17,10 +17,18 @@
  */
 
 #include "config.h"
+#include "rlib-private.h"
 #include <rlib/data/rhashfuncs.h>
 
+#include <rlib/rcpufeatures.h>
+#include <rlib/rmem.h>
+#include <rlib/rrand.h>
 #include <rlib/rstr.h>
 
+#ifdef HAVE_WMMINTRIN_H
+# include <wmmintrin.h>           /* AES-NI */
+#endif
+
 
 rsize
 r_direct_hash (rconstpointer data)
@@ -35,40 +43,296 @@ r_direct_equal (rconstpointer a, rconstpointer b)
 }
 
 
-/*
- * Based upon the commonly used algorithm posted
- * by Daniel Bernstein to comp.lang.c mailinglist.
- */
-rsize
-r_str_hash (rconstpointer data)
+/* wyhash (final version 4, public domain, Wang Yi): 64x64->128 multiply-fold
+ * over 48-byte stripes in three independent lanes, 16-byte steps after that
+ * and overlapping loads for the tail -- no byte-at-a-time loop at any length.
+ * r_str_hash mixes in a per-process random seed so the bucket layout of a
+ * string-keyed table cannot be predicted from outside the process. */
+static const ruint64 g__r_hash_secret[4] = {
+  RUINT64_CONSTANT (0xa0761d6478bd642f), RUINT64_CONSTANT (0xe7037ed1a0b428db),
+  RUINT64_CONSTANT (0x8ebc6af09c88c6e3), RUINT64_CONSTANT (0x589965cc75374cc3),
+};
+
+/* Inputs from this length up take the AES-NI path of r_str_hash. */
+#define R_HASH_AES_MIN                  256
+
+static ruint64 g__r_hash_seed;         /* premixed, see r_hash_wy_premix */
+static ruint8 g__r_hash_sipkey[16];
+
+static inline ruint64
+r_hash_mum (ruint64 a, ruint64 b, ruint64 * hi)
+{
+#if defined (__SIZEOF_INT128__)
+  unsigned __int128 r = (unsigned __int128)a * b;
+  *hi = (ruint64)(r >> 64);
+  return (ruint64)r;
+#else
+  ruint64 ha = a >> 32, hb = b >> 32, la = (ruint32)a, lb = (ruint32)b;
+  ruint64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  ruint64 t = rl + (rm0 << 32), lo, c = t < rl;
+  lo = t + (rm1 << 32);
+  c += lo < t;
+  *hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+  return lo;
+#endif
+}
+
+static inline ruint64
+r_hash_mix (ruint64 a, ruint64 b)
+{
+  ruint64 hi, lo = r_hash_mum (a, b, &hi);
+  return lo ^ hi;
+}
+
+static inline ruint64
+r_hash_r3 (const ruint8 * p, rsize k)
+{
+  return ((ruint64)p[0] << 16) | ((ruint64)p[k >> 1] << 8) | p[k - 1];
+}
+
+/* Bulk stripes of wyhash; returns the state and leaves @p / @len at the
+ * remaining (at most 48, at least 17) bytes. */
+static inline ruint64
+r_hash_wy_stripes (const ruint8 ** p, rsize * len, ruint64 seed)
+{
+  const ruint8 * d = *p;
+  rsize i = *len;
+
+  if (i >= 48) {
+    ruint64 see1 = seed, see2 = seed;
+    do {
+      seed = r_hash_mix (r_load_le64 (d) ^ g__r_hash_secret[1],
+          r_load_le64 (d + 8) ^ seed);
+      see1 = r_hash_mix (r_load_le64 (d + 16) ^ g__r_hash_secret[2],
+          r_load_le64 (d + 24) ^ see1);
+      see2 = r_hash_mix (r_load_le64 (d + 32) ^ g__r_hash_secret[3],
+          r_load_le64 (d + 40) ^ see2);
+      d += 48;
+      i -= 48;
+    } while (i >= 48);
+    seed ^= see1 ^ see2;
+  }
+  while (i > 16) {
+    seed = r_hash_mix (r_load_le64 (d) ^ g__r_hash_secret[1],
+        r_load_le64 (d + 8) ^ seed);
+    d += 16;
+    i -= 16;
+  }
+
+  *p = d;
+  *len = i;
+  return seed;
+}
+
+static inline ruint64
+r_hash_wy_final (ruint64 a, ruint64 b, ruint64 seed, rsize len)
+{
+  ruint64 hi;
+
+  a ^= g__r_hash_secret[1];
+  b ^= seed;
+  a = r_hash_mum (a, b, &hi);
+  return r_hash_mix (a ^ g__r_hash_secret[0] ^ (ruint64)len,
+      hi ^ g__r_hash_secret[1]);
+}
+
+static inline ruint64
+r_hash_wy_premix (ruint64 seed)
+{
+  return seed ^ r_hash_mix (seed ^ g__r_hash_secret[0], g__r_hash_secret[1]);
+}
+
+/* wyhash proper, with @seed already through r_hash_wy_premix. */
+static inline ruint64
+r_hash_wy (const ruint8 * p, rsize len, ruint64 seed)
+{
+  ruint64 a, b;
+
+  if (R_LIKELY (len <= 16)) {
+    if (len >= 4) {
+      rsize off = (len >> 3) << 2;
+      a = ((ruint64)r_load_le32 (p) << 32) | r_load_le32 (p + off);
+      b = ((ruint64)r_load_le32 (p + len - 4) << 32) | r_load_le32 (p + len - 4 - off);
+    } else if (len > 0) {
+      a = r_hash_r3 (p, len);
+      b = 0;
+    } else {
+      a = b = 0;
+    }
+  } else {
+    rsize i = len;
+    seed = r_hash_wy_stripes (&p, &i, seed);
+    a = r_load_le64 (p + i - 16);
+    b = r_load_le64 (p + i - 8);
+  }
+
+  return r_hash_wy_final (a, b, seed, len);
+}
+
+#ifdef HAVE_WMMINTRIN_H
+# if defined(__GNUC__) || defined(__clang__)
+#  define R_HASH_AES_TARGET __attribute__((target("aes,sse2")))
+# else
+#  define R_HASH_AES_TARGET
+# endif
+
+/* Long keys: four AES lanes absorb 64 bytes per step, one AESENC per
+ * 16 bytes with the lanes independent so the rounds pipeline. The last 64
+ * bytes (overlapping what came before) are absorbed as a final block, the
+ * lanes folded together with two more rounds and the 128-bit result reduced
+ * with the wyhash finaliser. Not a cryptographic construction: its job is
+ * the same as the scalar path's, only at a multiple of the throughput. */
+R_HASH_AES_TARGET static ruint64
+r_hash_aes (const ruint8 * p, rsize len, ruint64 seed)
 {
-  const signed char * p;
-  rsize ret = 5381;
+  const __m128i k0 = _mm_set_epi64x ((rlong)g__r_hash_secret[0], (rlong)seed);
+  const __m128i k1 = _mm_set_epi64x ((rlong)g__r_hash_secret[1], (rlong)(seed ^ len));
+  __m128i s0 = _mm_xor_si128 (k0, _mm_set_epi64x (0, (rlong)g__r_hash_secret[2]));
+  __m128i s1 = _mm_xor_si128 (k1, _mm_set_epi64x (0, (rlong)g__r_hash_secret[3]));
+  __m128i s2 = _mm_aesenc_si128 (s0, k1), s3 = _mm_aesenc_si128 (s1, k0);
+  const ruint8 * end = p + len - 64;
+  ruint64 lo, hi;
 
-  if (data != NULL) {
-    for (p = data; *p != 0; p++)
-      ret = (ret << 5) + ret + *p;
+# define R_HASH_AES_ABSORB(d)                                                  \
+  s0 = _mm_aesenc_si128 (_mm_xor_si128 (s0, _mm_loadu_si128 ((const __m128i *)(d))), k0);      \
+  s1 = _mm_aesenc_si128 (_mm_xor_si128 (s1, _mm_loadu_si128 ((const __m128i *)((d) + 16))), k1); \
+  s2 = _mm_aesenc_si128 (_mm_xor_si128 (s2, _mm_loadu_si128 ((const __m128i *)((d) + 32))), k0); \
+  s3 = _mm_aesenc_si128 (_mm_xor_si128 (s3, _mm_loadu_si128 ((const __m128i *)((d) + 48))), k1)
+
+  for (; p < end; p += 64) {
+    R_HASH_AES_ABSORB (p);
   }
+  R_HASH_AES_ABSORB (end);
+# undef R_HASH_AES_ABSORB
+
+  s0 = _mm_aesenc_si128 (s0, s2);
+  s1 = _mm_aesenc_si128 (s1, s3);
+  s0 = _mm_aesenc_si128 (s0, s1);
+  s0 = _mm_aesenc_si128 (s0, k0);
 
-  return ret;
+  lo = (ruint64)_mm_cvtsi128_si64 (s0);
+  hi = (ruint64)_mm_cvtsi128_si64 (_mm_unpackhi_epi64 (s0, s0));
+  return r_hash_wy_final (lo, hi, seed, len);
+}
+#endif
+
+ruint64
+r_hash_bytes (rconstpointer data, rsize size, ruint64 seed)
+{
+  if (R_UNLIKELY (data == NULL))
+    size = 0;
+  return r_hash_wy (data, size, r_hash_wy_premix (seed));
+}
+
+static inline rsize
+r_str_hash_mem (const ruint8 * data, rsize size)
+{
+#ifdef HAVE_WMMINTRIN_H
+  if (size >= R_HASH_AES_MIN && r_cpu_has (R_CPU_FEATURE_AES_NI))
+    return (rsize)r_hash_aes (data, size, g__r_hash_seed);
+#endif
+  return (rsize)r_hash_wy (data, size, g__r_hash_seed);
+}
+
+rsize
+r_str_hash (rconstpointer data)
+{
+  return r_str_hash_mem (data, data != NULL ? r_strlen (data) : 0);
 }
 
 rsize
 r_str_hash_sized (const rchar * data, rssize size)
 {
-  rsize ret = 5381;
+  if (size < 0)
+    return r_str_hash (data);
+  return r_str_hash_mem ((const ruint8 *)data, data != NULL ? (rsize)size : 0);
+}
+
+/* SipHash-2-4 (Aumasson & Bernstein). */
+#define R_SIPROUND(v0, v1, v2, v3) R_STMT_START {                             \
+  v0 += v1; v1 = RUINT64_ROTL (v1, 13); v1 ^= v0; v0 = RUINT64_ROTL (v0, 32); \
+  v2 += v3; v3 = RUINT64_ROTL (v3, 16); v3 ^= v2;                             \
+  v0 += v3; v3 = RUINT64_ROTL (v3, 21); v3 ^= v0;                             \
+  v2 += v1; v1 = RUINT64_ROTL (v1, 17); v1 ^= v2; v2 = RUINT64_ROTL (v2, 32); \
+} R_STMT_END
+
+ruint64
+r_siphash24 (const ruint8 key[16], rconstpointer data, rsize size)
+{
+  const ruint8 * p = data, * end;
+  ruint64 k0 = r_load_le64 (key), k1 = r_load_le64 (key + 8);
+  ruint64 v0 = k0 ^ RUINT64_CONSTANT (0x736f6d6570736575);
+  ruint64 v1 = k1 ^ RUINT64_CONSTANT (0x646f72616e646f6d);
+  ruint64 v2 = k0 ^ RUINT64_CONSTANT (0x6c7967656e657261);
+  ruint64 v3 = k1 ^ RUINT64_CONSTANT (0x7465646279746573);
+  ruint64 m, b = (ruint64)size << 56;
 
-  if (size > 0) {
-    const signed char * p;
+  if (R_UNLIKELY (p == NULL))
+    size = 0;
 
-    for (p = (const signed char *)data; size-- > 0; p++)
-      ret = (ret << 5) + ret + *p;
+  for (end = p + (size & ~(rsize)7); p != end; p += 8) {
+    m = r_load_le64 (p);
+    v3 ^= m;
+    R_SIPROUND (v0, v1, v2, v3);
+    R_SIPROUND (v0, v1, v2, v3);
+    v0 ^= m;
+  }
 
-  } else if (size < 0 && data != NULL) {
-    ret = r_str_hash (data);
+  switch (size & 7) {
+    case 7: b |= (ruint64)p[6] << 48; /* fall through */
+    case 6: b |= (ruint64)p[5] << 40; /* fall through */
+    case 5: b |= (ruint64)p[4] << 32; /* fall through */
+    case 4: b |= (ruint64)p[3] << 24; /* fall through */
+    case 3: b |= (ruint64)p[2] << 16; /* fall through */
+    case 2: b |= (ruint64)p[1] << 8;  /* fall through */
+    case 1: b |= (ruint64)p[0];       /* fall through */
+    default: break;
   }
 
-  return ret;
+  v3 ^= b;
+  R_SIPROUND (v0, v1, v2, v3);
+  R_SIPROUND (v0, v1, v2, v3);
+  v0 ^= b;
+  v2 ^= 0xff;
+  R_SIPROUND (v0, v1, v2, v3);
+  R_SIPROUND (v0, v1, v2, v3);
+  R_SIPROUND (v0, v1, v2, v3);
+  R_SIPROUND (v0, v1, v2, v3);
+  return v0 ^ v1 ^ v2 ^ v3;
+}
+
+rsize
+r_str_hash_keyed (rconstpointer data)
+{
+  return (rsize)r_siphash24 (g__r_hash_sipkey, data,
+      data != NULL ? r_strlen (data) : 0);
+}
+
+rsize
+r_str_hash_keyed_sized (const rchar * data, rssize size)
+{
+  if (size < 0)
+    return r_str_hash_keyed (data);
+  return (rsize)r_siphash24 (g__r_hash_sipkey, data,
+      data != NULL ? (rsize)size : 0);
+}
+
+void
+r_hash_funcs_init (void)
+{
+  ruint8 seed[8];
+
+  /* Falls back to a time/address mix rather than failing library load. */
+  if (!r_rand_entropy_fill (seed, sizeof (seed)) ||
+      !r_rand_entropy_fill (g__r_hash_sipkey, sizeof (g__r_hash_sipkey))) {
+    ruint64 v = r_rand_entropy_u64 ();
+    r_memcpy (seed, &v, sizeof (v));
+    v = r_rand_entropy_u64 ();
+    r_memcpy (g__r_hash_sipkey, &v, sizeof (v));
+    v = r_rand_entropy_u64 ();
+    r_memcpy (g__r_hash_sipkey + 8, &v, sizeof (v));
+  }
+  g__r_hash_seed = r_hash_wy_premix (r_load_le64 (seed));
 }
 
 rboolean
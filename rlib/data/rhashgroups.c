@@ -0,0 +1,362 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2016-2017 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+
+#include "config.h"
+#include "rhash-private.h"
+
+#include <rlib/rmem.h>
+
+/* SSE2 and NEON are part of the x86-64 and AArch64 baselines, so the group
+ * compare needs no runtime dispatch on the lookup path. */
+#if defined(HAVE_IMMINTRIN_H) && (defined(__SSE2__) || defined(_M_X64))
+# include <emmintrin.h>
+# define R_HASH_GROUPS_SSE2
+#elif defined(HAVE_ARM_NEON_H) && defined(__aarch64__)
+# include <arm_neon.h>
+# define R_HASH_GROUPS_NEON
+#endif
+
+/* Bit i set: slot i of the group matched. */
+typedef ruint RHashGroupMask;
+
+/* Mix once; the top 7 bits become the control byte (H2) and the rest pick
+ * the first group (H1), so the two are independent for any table size. */
+#define R_HASH_GROUPS_MIX(hash)   ((rsize) (hash) * R_HASH_GOLDEN)
+#define R_HASH_GROUPS_H1(m)       ((m) ^ ((m) >> (sizeof (rsize) * 4)))
+#define R_HASH_GROUPS_H2(m)       ((ruint8) ((m) >> (sizeof (rsize) * 8 - 7)))
+
+/* Lookups in a table that has never held anything probe this instead of
+ * allocating: one group, all EMPTY. */
+static const ruint8 r_hash_groups_empty_group[R_HASH_GROUP_WIDTH] = {
+  0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+  0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+};
+
+#if defined(R_HASH_GROUPS_SSE2)
+static inline RHashGroupMask
+r_hash_group_match (const ruint8 * ctrl, ruint8 h2)
+{
+  const __m128i g = _mm_loadu_si128 ((const __m128i *) ctrl);
+  return (RHashGroupMask) _mm_movemask_epi8 (
+      _mm_cmpeq_epi8 (g, _mm_set1_epi8 ((char) h2)));
+}
+
+/* EMPTY and DELETED are the only bytes with the top bit set. */
+static inline RHashGroupMask
+r_hash_group_match_free (const ruint8 * ctrl)
+{
+  return (RHashGroupMask) _mm_movemask_epi8 (
+      _mm_loadu_si128 ((const __m128i *) ctrl));
+}
+#elif defined(R_HASH_GROUPS_NEON)
+static inline RHashGroupMask
+r_hash_group_neon_mask (uint8x16_t m)
+{
+  static const ruint8 bits[16] = {
+    0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+    0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+  };
+  uint8x16_t s = vandq_u8 (m, vld1q_u8 (bits));
+
+  s = vpaddq_u8 (s, s);
+  s = vpaddq_u8 (s, s);
+  s = vpaddq_u8 (s, s);
+  return vgetq_lane_u16 (vreinterpretq_u16_u8 (s), 0);
+}
+
+static inline RHashGroupMask
+r_hash_group_match (const ruint8 * ctrl, ruint8 h2)
+{
+  return r_hash_group_neon_mask (vceqq_u8 (vld1q_u8 (ctrl), vdupq_n_u8 (h2)));
+}
+
+static inline RHashGroupMask
+r_hash_group_match_free (const ruint8 * ctrl)
+{
+  return r_hash_group_neon_mask (vtstq_u8 (vld1q_u8 (ctrl), vdupq_n_u8 (0x80)));
+}
+#else
+static inline RHashGroupMask
+r_hash_group_match (const ruint8 * ctrl, ruint8 h2)
+{
+  RHashGroupMask ret = 0;
+  ruint i;
+
+  for (i = 0; i < R_HASH_GROUP_WIDTH; i++)
+    ret |= (RHashGroupMask) (ctrl[i] == h2) << i;
+  return ret;
+}
+
+static inline RHashGroupMask
+r_hash_group_match_free (const ruint8 * ctrl)
+{
+  RHashGroupMask ret = 0;
+  ruint i;
+
+  for (i = 0; i < R_HASH_GROUP_WIDTH; i++)
+    ret |= (RHashGroupMask) (ctrl[i] >> 7) << i;
+  return ret;
+}
+#endif
+
+static inline RHashGroupMask
+r_hash_group_match_empty (const ruint8 * ctrl)
+{
+  return r_hash_group_match (ctrl, R_HASH_CTRL_EMPTY);
+}
+
+/* Write slot @i's control byte, and its clone past the end when @i is in the
+ * first group. For @i beyond the first group both stores hit the same byte. */
+static inline void
+r_hash_groups_set_ctrl (RHashGroups * g, rsize i, ruint8 c)
+{
+  g->ctrl[i] = c;
+  g->ctrl[((i - R_HASH_GROUP_WIDTH) & g->mask) + R_HASH_GROUP_WIDTH] = c;
+}
+
+static inline rsize
+r_hash_groups_growth (rsize cap)
+{
+  /* Max load 7/8: a probe always meets an EMPTY byte within a few groups. */
+  return cap - (cap >> 3);
+}
+
+void
+r_hash_groups_init (RHashGroups * g, rboolean values)
+{
+  g->ctrl = (ruint8 *) r_hash_groups_empty_group;
+  g->keys = NULL;
+  g->vals = NULL;
+  g->mask = 0;
+  g->size = 0;
+  g->growth_left = 0;
+  g->values = values;
+}
+
+static void
+r_hash_groups_notify_all (RHashGroups * g,
+    RDestroyNotify keynotify, RDestroyNotify valuenotify)
+{
+  rsize i, cap = r_hash_groups_capacity (g);
+
+  if (keynotify == NULL && valuenotify == NULL)
+    return;
+
+  for (i = 0; i < cap; i++) {
+    if (R_HASH_CTRL_IS_FULL (g->ctrl[i])) {
+      if (keynotify != NULL)
+        keynotify (g->keys[i]);
+      if (valuenotify != NULL)
+        valuenotify (g->vals[i]);
+    }
+  }
+}
+
+void
+r_hash_groups_clear (RHashGroups * g,
+    RDestroyNotify keynotify, RDestroyNotify valuenotify)
+{
+  r_hash_groups_notify_all (g, keynotify, valuenotify);
+  if (g->keys != NULL) {
+    r_free (g->ctrl);
+    r_free (g->keys);
+    r_free (g->vals);
+  }
+  r_hash_groups_init (g, g->values);
+}
+
+void
+r_hash_groups_remove_all (RHashGroups * g,
+    RDestroyNotify keynotify, RDestroyNotify valuenotify)
+{
+  rsize cap = r_hash_groups_capacity (g);
+
+  r_hash_groups_notify_all (g, keynotify, valuenotify);
+  if (cap > 0)
+    r_memset (g->ctrl, R_HASH_CTRL_EMPTY, cap + R_HASH_GROUP_WIDTH);
+  g->size = 0;
+  g->growth_left = r_hash_groups_growth (cap);
+}
+
+rsize
+r_hash_groups_find (const RHashGroups * g, rconstpointer key, rsize hash,
+    REqualFunc equal)
+{
+  rsize m = R_HASH_GROUPS_MIX (hash);
+  rsize pos = R_HASH_GROUPS_H1 (m) & g->mask, step = 0;
+  ruint8 h2 = R_HASH_GROUPS_H2 (m);
+
+  for (;;) {
+    RHashGroupMask match = r_hash_group_match (g->ctrl + pos, h2);
+
+    while (match != 0) {
+      rsize idx = (pos + RUINT_CTZ (match)) & g->mask;
+      if (equal == NULL ? key == g->keys[idx] : equal (key, g->keys[idx]))
+        return idx;
+      match &= match - 1;
+    }
+    if (r_hash_group_match_empty (g->ctrl + pos) != 0)
+      return R_HASH_GROUPS_NONE;
+
+    /* Triangular steps in whole groups visit every group of a
+     * power-of-two table. */
+    step += R_HASH_GROUP_WIDTH;
+    pos = (pos + step) & g->mask;
+  }
+}
+
+static rsize
+r_hash_groups_find_free (const RHashGroups * g, rsize m)
+{
+  rsize pos = R_HASH_GROUPS_H1 (m) & g->mask, step = 0;
+  RHashGroupMask free;
+
+  while ((free = r_hash_group_match_free (g->ctrl + pos)) == 0) {
+    step += R_HASH_GROUP_WIDTH;
+    pos = (pos + step) & g->mask;
+  }
+
+  return (pos + RUINT_CTZ (free)) & g->mask;
+}
+
+static rboolean
+r_hash_groups_resize (RHashGroups * g, rsize cap, RHashFunc hashfunc)
+{
+  ruint8 * ctrl = g->ctrl;
+  rpointer * keys = g->keys, * vals = g->vals;
+  rsize i, oldcap = r_hash_groups_capacity (g);
+
+  g->ctrl = r_malloc (cap + R_HASH_GROUP_WIDTH);
+  g->keys = r_mem_new_n (rpointer, cap);
+  g->vals = g->values ? r_mem_new_n (rpointer, cap) : NULL;
+  if (g->ctrl == NULL || g->keys == NULL || (g->values && g->vals == NULL)) {
+    r_free (g->ctrl);
+    r_free (g->keys);
+    r_free (g->vals);
+    g->ctrl = ctrl;
+    g->keys = keys;
+    g->vals = vals;
+    return FALSE;
+  }
+
+  r_memset (g->ctrl, R_HASH_CTRL_EMPTY, cap + R_HASH_GROUP_WIDTH);
+  g->mask = cap - 1;
+  g->growth_left = r_hash_groups_growth (cap) - g->size;
+
+  for (i = 0; i < oldcap; i++) {
+    rsize m, idx;
+
+    if (!R_HASH_CTRL_IS_FULL (ctrl[i]))
+      continue;
+
+    m = R_HASH_GROUPS_MIX (hashfunc (keys[i]));
+    idx = r_hash_groups_find_free (g, m);
+    r_hash_groups_set_ctrl (g, idx, R_HASH_GROUPS_H2 (m));
+    g->keys[idx] = keys[i];
+    if (vals != NULL)
+      g->vals[idx] = vals[i];
+  }
+
+  if (keys != NULL) {
+    r_free (ctrl);
+    r_free (keys);
+    r_free (vals);
+  }
+  return TRUE;
+}
+
+rsize
+r_hash_groups_insert_slot (RHashGroups * g, rconstpointer key, rsize hash,
+    REqualFunc equal, RHashFunc hashfunc, rboolean * found)
+{
+  rsize m, idx;
+
+  if ((idx = r_hash_groups_find (g, key, hash, equal)) != R_HASH_GROUPS_NONE) {
+    *found = TRUE;
+    return idx;
+  }
+
+  *found = FALSE;
+  m = R_HASH_GROUPS_MIX (hash);
+  idx = r_hash_groups_find_free (g, m);
+
+  /* A DELETED slot is reused for free; only claiming an EMPTY one eats into
+   * the growth budget. When that is spent, grow -- unless live entries fill
+   * no more than 25/32 of the slots, in which case rebuilding at the same
+   * size reclaims the tombstones. */
+  if (g->growth_left == 0 && g->ctrl[idx] == R_HASH_CTRL_EMPTY) {
+    rsize cap = r_hash_groups_capacity (g);
+
+    if (cap == 0)
+      cap = R_HASH_GROUP_WIDTH;
+    else if (cap <= R_HASH_GROUP_WIDTH || g->size * 32 > cap * 25)
+      cap *= 2;
+    if (!r_hash_groups_resize (g, cap, hashfunc))
+      return R_HASH_GROUPS_NONE;
+    idx = r_hash_groups_find_free (g, m);
+  }
+
+  if (g->ctrl[idx] == R_HASH_CTRL_EMPTY)
+    g->growth_left--;
+  r_hash_groups_set_ctrl (g, idx, R_HASH_GROUPS_H2 (m));
+  g->size++;
+  return idx;
+}
+
+void
+r_hash_groups_erase (RHashGroups * g, rsize idx)
+{
+  const rsize before = (idx - R_HASH_GROUP_WIDTH) & g->mask;
+  const RHashGroupMask eafter = r_hash_group_match_empty (g->ctrl + idx);
+  const RHashGroupMask ebefore = r_hash_group_match_empty (g->ctrl + before);
+
+  /* If every group-sized window over @idx also holds an EMPTY byte, no probe
+   * ever ran past this slot, so it can go straight back to EMPTY. Otherwise
+   * it must stay a tombstone to keep longer probe chains intact. */
+  if (eafter != 0 && ebefore != 0 &&
+      (RUINT_CLZ (ebefore) - (sizeof (ruint) * 8 - R_HASH_GROUP_WIDTH)) +
+      RUINT_CTZ (eafter) < R_HASH_GROUP_WIDTH) {
+    r_hash_groups_set_ctrl (g, idx, R_HASH_CTRL_EMPTY);
+    g->growth_left++;
+  } else {
+    r_hash_groups_set_ctrl (g, idx, R_HASH_CTRL_DELETED);
+  }
+  g->size--;
+}
+
+/* Diagnostic: the most groups an unsuccessful lookup can load, over every
+ * possible starting slot. */
+rsize
+r_hash_groups_max_probe (const RHashGroups * g)
+{
+  rsize start, max = 0, cap = r_hash_groups_capacity (g);
+
+  for (start = 0; start < cap; start++) {
+    rsize pos = start, step = 0, len = 1;
+
+    while (r_hash_group_match_empty (g->ctrl + pos) == 0 && len <= cap) {
+      step += R_HASH_GROUP_WIDTH;
+      pos = (pos + step) & g->mask;
+      len++;
+    }
+    if (len > max)
+      max = len;
+  }
+
+  return max;
+}
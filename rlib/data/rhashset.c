@@ -42,6 +42,9 @@ struct RHashSet {
   rsize tombs;        /* tombstoned buckets; reclaimed on resize/rehash */
   ruint8 allocidx;
   RHashSetBucket * buckets;
+  /* R_HASH_FLAG_GROUPED: the grouped engine replaces the buckets above. */
+  rboolean grouped;
+  RHashGroups groups;
 
   RHashFunc hashfunc;
   REqualFunc equalfunc;
@@ -51,6 +54,12 @@ struct RHashSet {
 static void
 r_hash_set_free (RHashSet * hs)
 {
+  if (hs->grouped) {
+    r_hash_groups_clear (&hs->groups, hs->notify, NULL);
+    r_free (hs);
+    return;
+  }
+
   if (hs->notify != NULL) {
     rsize i, c = R_HASH_CONTAINER_ALLOC_IDX_TO_SIZE (hs->allocidx);
     for (i = 0; i < c; i++) {
@@ -98,6 +107,13 @@ r_hash_set_resize (RHashSet * hs, ruint8 allocidx)
 
 RHashSet *
 r_hash_set_new_full (RHashFunc hash, REqualFunc equal, RDestroyNotify notify)
+{
+  return r_hash_set_new_with_flags (hash, equal, notify, R_HASH_FLAG_NONE);
+}
+
+RHashSet *
+r_hash_set_new_with_flags (RHashFunc hash, REqualFunc equal,
+    RDestroyNotify notify, RHashFlags flags)
 {
   RHashSet * ret;
 
@@ -108,10 +124,15 @@ r_hash_set_new_full (RHashFunc hash, REqualFunc equal, RDestroyNotify notify)
     ret->size = 0;
     ret->tombs = 0;
     ret->allocidx = 0;
-    size = R_HASH_CONTAINER_ALLOC_IDX_TO_SIZE (ret->allocidx);
-    ret->buckets = r_mem_new_n (RHashSetBucket, size);
-    for (i = 0; i < size; i++)
-      ret->buckets[i].hash = R_HASH_EMPTY;
+    if ((ret->grouped = (flags & R_HASH_FLAG_GROUPED) != 0)) {
+      ret->buckets = NULL;
+      r_hash_groups_init (&ret->groups, FALSE);
+    } else {
+      size = R_HASH_CONTAINER_ALLOC_IDX_TO_SIZE (ret->allocidx);
+      ret->buckets = r_mem_new_n (RHashSetBucket, size);
+      for (i = 0; i < size; i++)
+        ret->buckets[i].hash = R_HASH_EMPTY;
+    }
     ret->hashfunc = hash != NULL ? hash : r_direct_hash;
     ret->equalfunc = equal;
     ret->notify = notify;
@@ -123,12 +144,14 @@ r_hash_set_new_full (RHashFunc hash, REqualFunc equal, RDestroyNotify notify)
 rsize
 r_hash_set_size (RHashSet * hs)
 {
-  return hs->size;
+  return hs->grouped ? hs->groups.size : hs->size;
 }
 
 rsize
 r_hash_set_current_alloc_size (RHashSet * hs)
 {
+  if (hs->grouped)
+    return r_hash_groups_capacity (&hs->groups);
   return R_HASH_CONTAINER_ALLOC_IDX_TO_SIZE (hs->allocidx);
 }
 
@@ -141,6 +164,8 @@ r_hash_set_max_probe (RHashSet * hs)
   rsize size, mask, h, max = 0;
 
   if (R_UNLIKELY (hs == NULL)) return 0;
+  if (hs->grouped)
+    return r_hash_groups_max_probe (&hs->groups);
   size = R_HASH_CONTAINER_ALLOC_IDX_TO_SIZE (hs->allocidx);
   mask = size - 1;
 
@@ -189,12 +214,38 @@ r_hash_set_lookup_bucket (RHashSet * hs, rconstpointer item, rsize * hash)
   return idx;
 }
 
+/* Slot of @item in a grouped set, or R_HASH_GROUPS_NONE. */
+static inline rsize
+r_hash_set_grouped_find (RHashSet * hs, rconstpointer item)
+{
+  return r_hash_groups_find (&hs->groups, item, hs->hashfunc (item), hs->equalfunc);
+}
+
+static rboolean
+r_hash_set_grouped_insert (RHashSet * hs, rpointer item)
+{
+  rboolean found;
+  rsize idx;
+
+  idx = r_hash_groups_insert_slot (&hs->groups, item, hs->hashfunc (item),
+      hs->equalfunc, hs->hashfunc, &found);
+  if (R_UNLIKELY (idx == R_HASH_GROUPS_NONE))
+    return FALSE;
+
+  if (found && hs->notify != NULL)
+    hs->notify (hs->groups.keys[idx]);
+  hs->groups.keys[idx] = item;
+  return TRUE;
+}
+
 rboolean
 r_hash_set_insert (RHashSet * hs, rpointer item)
 {
   rsize idx, hash;
 
   if (R_UNLIKELY (hs == NULL)) return FALSE;
+  if (hs->grouped)
+    return r_hash_set_grouped_insert (hs, item);
 
   /* Resize at 3/4 occupancy so a probe always has an EMPTY bucket to terminate
    * on (a full table makes an absent-item lookup loop forever). Count tombstones
@@ -226,6 +277,8 @@ r_hash_set_contains (RHashSet * hs, rconstpointer item)
   rsize idx, hash;
 
   if (R_UNLIKELY (hs == NULL)) return FALSE;
+  if (hs->grouped)
+    return r_hash_set_grouped_find (hs, item) != R_HASH_GROUPS_NONE;
 
   idx = r_hash_set_lookup_bucket (hs, item, &hash);
   return hs->buckets[idx].hash == hash;
@@ -238,6 +291,13 @@ r_hash_set_contains_full (RHashSet * hs, rconstpointer item,
   rsize idx, hash;
 
   if (R_UNLIKELY (hs == NULL)) return FALSE;
+  if (hs->grouped) {
+    if ((idx = r_hash_set_grouped_find (hs, item)) == R_HASH_GROUPS_NONE)
+      return FALSE;
+    if (out != NULL)
+      *out = hs->groups.keys[idx];
+    return TRUE;
+  }
 
   idx = r_hash_set_lookup_bucket (hs, item, &hash);
   if (hs->buckets[idx].hash == hash) {
@@ -255,6 +315,10 @@ r_hash_set_remove_all (RHashSet * hs)
   rsize i, c;
 
   if (R_UNLIKELY (hs == NULL)) return;
+  if (hs->grouped) {
+    r_hash_groups_remove_all (&hs->groups, hs->notify, NULL);
+    return;
+  }
   if (R_UNLIKELY (hs->size == 0 && hs->tombs == 0)) return;
 
   c = R_HASH_CONTAINER_ALLOC_IDX_TO_SIZE (hs->allocidx);
@@ -274,6 +338,14 @@ r_hash_set_remove (RHashSet * hs, rconstpointer item)
   rsize idx, hash;
 
   if (R_UNLIKELY (hs == NULL)) return FALSE;
+  if (hs->grouped) {
+    if ((idx = r_hash_set_grouped_find (hs, item)) == R_HASH_GROUPS_NONE)
+      return FALSE;
+    if (hs->notify != NULL)
+      hs->notify (hs->groups.keys[idx]);
+    r_hash_groups_erase (&hs->groups, idx);
+    return TRUE;
+  }
 
   idx = r_hash_set_lookup_bucket (hs, item, &hash);
   if (R_UNLIKELY (hs->buckets[idx].hash != hash))
@@ -294,6 +366,17 @@ r_hash_set_steal (RHashSet * hs, rconstpointer item, rpointer * out)
   rsize idx, hash;
 
   if (R_UNLIKELY (hs == NULL)) return FALSE;
+  if (hs->grouped) {
+    if ((idx = r_hash_set_grouped_find (hs, item)) == R_HASH_GROUPS_NONE) {
+      if (out != NULL)
+        *out = NULL;
+      return FALSE;
+    }
+    if (out != NULL)
+      *out = hs->groups.keys[idx];
+    r_hash_groups_erase (&hs->groups, idx);
+    return TRUE;
+  }
 
   idx = r_hash_set_lookup_bucket (hs, item, &hash);
   if (R_UNLIKELY (hs->buckets[idx].hash != hash)) {
@@ -319,6 +402,15 @@ r_hash_set_foreach (RHashSet * hs, RFunc func, rpointer user)
   if (R_UNLIKELY (hs == NULL)) return FALSE;
   if (R_UNLIKELY (func == NULL)) return FALSE;
 
+  if (hs->grouped) {
+    c = r_hash_groups_capacity (&hs->groups);
+    for (i = 0; i < c; i++) {
+      if (R_HASH_CTRL_IS_FULL (hs->groups.ctrl[i]))
+        func (hs->groups.keys[i], user);
+    }
+    return TRUE;
+  }
+
   c = R_HASH_CONTAINER_ALLOC_IDX_TO_SIZE (hs->allocidx);
   for (i = 0; i < c; i++) {
     if (R_HASH_BUCKET_LIVE (hs->buckets[i].hash))
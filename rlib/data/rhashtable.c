@@ -44,6 +44,9 @@ struct RHashTable {
   rsize tombs;        /* tombstoned buckets; reclaimed on resize/rehash */
   ruint8 allocidx;
   RHashTableBucket * buckets;
+  /* R_HASH_FLAG_GROUPED: the grouped engine replaces the buckets above. */
+  rboolean grouped;
+  RHashGroups groups;
 
   RHashFunc hashfunc;
   REqualFunc equalfunc;
@@ -56,6 +59,12 @@ r_hash_table_free (RHashTable * ht)
 {
   rsize i, c = R_HASH_CONTAINER_ALLOC_IDX_TO_SIZE (ht->allocidx);
 
+  if (ht->grouped) {
+    r_hash_groups_clear (&ht->groups, ht->keynotify, ht->valuenotify);
+    r_free (ht);
+    return;
+  }
+
   if (ht->keynotify != NULL && ht->valuenotify != NULL) {
     for (i = 0; i < c; i++) {
       if (R_HASH_BUCKET_LIVE (ht->buckets[i].hash)) {
@@ -115,6 +124,14 @@ r_hash_table_resize (RHashTable * ht, ruint8 allocidx)
 RHashTable *
 r_hash_table_new_full (RHashFunc hash, REqualFunc equal,
     RDestroyNotify keynotify, RDestroyNotify valuenotify)
+{
+  return r_hash_table_new_with_flags (hash, equal, keynotify, valuenotify,
+      R_HASH_FLAG_NONE);
+}
+
+RHashTable *
+r_hash_table_new_with_flags (RHashFunc hash, REqualFunc equal,
+    RDestroyNotify keynotify, RDestroyNotify valuenotify, RHashFlags flags)
 {
   RHashTable * ret;
 
@@ -125,10 +142,15 @@ r_hash_table_new_full (RHashFunc hash, REqualFunc equal,
     ret->size = 0;
     ret->tombs = 0;
     ret->allocidx = 0;
-    size = R_HASH_CONTAINER_ALLOC_IDX_TO_SIZE (ret->allocidx);
-    ret->buckets = r_mem_new_n (RHashTableBucket, size);
-    for (i = 0; i < size; i++)
-      ret->buckets[i].hash = R_HASH_EMPTY;
+    if ((ret->grouped = (flags & R_HASH_FLAG_GROUPED) != 0)) {
+      ret->buckets = NULL;
+      r_hash_groups_init (&ret->groups, TRUE);
+    } else {
+      size = R_HASH_CONTAINER_ALLOC_IDX_TO_SIZE (ret->allocidx);
+      ret->buckets = r_mem_new_n (RHashTableBucket, size);
+      for (i = 0; i < size; i++)
+        ret->buckets[i].hash = R_HASH_EMPTY;
+    }
     ret->hashfunc = hash != NULL ? hash : r_direct_hash;
     ret->equalfunc = equal;
     ret->keynotify = keynotify;
@@ -141,12 +163,14 @@ r_hash_table_new_full (RHashFunc hash, REqualFunc equal,
 rsize
 r_hash_table_size (RHashTable * ht)
 {
-  return ht->size;
+  return ht->grouped ? ht->groups.size : ht->size;
 }
 
 rsize
 r_hash_table_current_alloc_size (RHashTable * ht)
 {
+  if (ht->grouped)
+    return r_hash_groups_capacity (&ht->groups);
   return R_HASH_CONTAINER_ALLOC_IDX_TO_SIZE (ht->allocidx);
 }
 
@@ -159,6 +183,8 @@ r_hash_table_max_probe (RHashTable * ht)
   rsize size, mask, h, max = 0;
 
   if (R_UNLIKELY (ht == NULL)) return 0;
+  if (ht->grouped)
+    return r_hash_groups_max_probe (&ht->groups);
   size = R_HASH_CONTAINER_ALLOC_IDX_TO_SIZE (ht->allocidx);
   mask = size - 1;
 
@@ -207,12 +233,45 @@ r_hash_table_lookup_bucket (RHashTable * ht, rconstpointer key, rsize * hash)
   return idx;
 }
 
+static RHashTableError
+r_hash_table_grouped_insert (RHashTable * ht, rpointer key, rpointer value)
+{
+  RHashGroups * g = &ht->groups;
+  rboolean found;
+  rsize idx;
+
+  idx = r_hash_groups_insert_slot (g, key, ht->hashfunc (key), ht->equalfunc,
+      ht->hashfunc, &found);
+  if (R_UNLIKELY (idx == R_HASH_GROUPS_NONE))
+    return R_HASH_TABLE_ERROR;
+
+  if (found) {
+    if (ht->keynotify != NULL && g->keys[idx] != NULL)
+      ht->keynotify (g->keys[idx]);
+    if (ht->valuenotify != NULL && g->vals[idx] != NULL)
+      ht->valuenotify (g->vals[idx]);
+  }
+
+  g->keys[idx] = key;
+  g->vals[idx] = value;
+  return R_HASH_TABLE_OK;
+}
+
+/* Slot of @key in a grouped table, or R_HASH_GROUPS_NONE. */
+static inline rsize
+r_hash_table_grouped_find (RHashTable * ht, rconstpointer key)
+{
+  return r_hash_groups_find (&ht->groups, key, ht->hashfunc (key), ht->equalfunc);
+}
+
 RHashTableError
 r_hash_table_insert (RHashTable * ht, rpointer key, rpointer value)
 {
   rsize idx, hash;
 
   if (R_UNLIKELY (ht == NULL)) return R_HASH_TABLE_INVAL;
+  if (ht->grouped)
+    return r_hash_table_grouped_insert (ht, key, value);
 
   /* Grow before the table fills. Open addressing needs at least one empty
    * bucket for a probe to terminate -- a fully populated table makes a lookup
@@ -247,6 +306,12 @@ rpointer
 r_hash_table_lookup (RHashTable * ht, rconstpointer key)
 {
   rsize idx, hash;
+
+  if (ht->grouped) {
+    idx = r_hash_table_grouped_find (ht, key);
+    return (idx != R_HASH_GROUPS_NONE) ? ht->groups.vals[idx] : NULL;
+  }
+
   idx = r_hash_table_lookup_bucket (ht, key, &hash);
   return (ht->buckets[idx].hash == hash) ? ht->buckets[idx].val : NULL;
 }
@@ -259,6 +324,16 @@ r_hash_table_lookup_full (RHashTable * ht, rconstpointer key,
 
   if (R_UNLIKELY (ht == NULL)) return R_HASH_TABLE_INVAL;
 
+  if (ht->grouped) {
+    if ((idx = r_hash_table_grouped_find (ht, key)) == R_HASH_GROUPS_NONE)
+      return R_HASH_TABLE_NOT_FOUND;
+    if (keyout != NULL)
+      *keyout = ht->groups.keys[idx];
+    if (valueout != NULL)
+      *valueout = ht->groups.vals[idx];
+    return R_HASH_TABLE_OK;
+  }
+
   idx = r_hash_table_lookup_bucket (ht, key, &hash);
   if (ht->buckets[idx].hash == hash) {
     if (keyout != NULL)
@@ -278,6 +353,11 @@ r_hash_table_contains (RHashTable * ht, rconstpointer key)
 
   if (R_UNLIKELY (ht == NULL)) return R_HASH_TABLE_INVAL;
 
+  if (ht->grouped) {
+    return r_hash_table_grouped_find (ht, key) != R_HASH_GROUPS_NONE ?
+      R_HASH_TABLE_OK : R_HASH_TABLE_NOT_FOUND;
+  }
+
   idx = r_hash_table_lookup_bucket (ht, key, &hash);
   return ht->buckets[idx].hash == hash ? R_HASH_TABLE_OK : R_HASH_TABLE_NOT_FOUND;
 }
@@ -288,6 +368,10 @@ r_hash_table_remove_all (RHashTable * ht)
   rsize i, c;
 
   if (R_UNLIKELY (ht == NULL)) return;
+  if (ht->grouped) {
+    r_hash_groups_remove_all (&ht->groups, ht->keynotify, ht->valuenotify);
+    return;
+  }
   if (R_UNLIKELY (ht->size == 0 && ht->tombs == 0)) return;
 
   c = R_HASH_CONTAINER_ALLOC_IDX_TO_SIZE (ht->allocidx);
@@ -306,6 +390,16 @@ r_hash_table_remove_all (RHashTable * ht)
   ht->tombs = 0;
 }
 
+static void
+r_hash_table_grouped_remove (RHashTable * ht, rsize idx)
+{
+  if (ht->keynotify != NULL)
+    ht->keynotify (ht->groups.keys[idx]);
+  if (ht->valuenotify != NULL)
+    ht->valuenotify (ht->groups.vals[idx]);
+  r_hash_groups_erase (&ht->groups, idx);
+}
+
 static void
 r_hash_table_internal_remove (RHashTable * ht, rsize idx)
 {
@@ -326,6 +420,13 @@ r_hash_table_remove (RHashTable * ht, rconstpointer key)
 
   if (R_UNLIKELY (ht == NULL)) return R_HASH_TABLE_INVAL;
 
+  if (ht->grouped) {
+    if ((idx = r_hash_table_grouped_find (ht, key)) == R_HASH_GROUPS_NONE)
+      return R_HASH_TABLE_NOT_FOUND;
+    r_hash_table_grouped_remove (ht, idx);
+    return R_HASH_TABLE_OK;
+  }
+
   idx = r_hash_table_lookup_bucket (ht, key, &hash);
   if (R_UNLIKELY (ht->buckets[idx].hash != hash))
     return R_HASH_TABLE_NOT_FOUND;
@@ -334,6 +435,32 @@ r_hash_table_remove (RHashTable * ht, rconstpointer key)
   return R_HASH_TABLE_OK;
 }
 
+/* remove_full (@notify) and steal for a grouped table. */
+static RHashTableError
+r_hash_table_grouped_take (RHashTable * ht, rconstpointer key,
+    rpointer * keyout, rpointer * valueout, rboolean notify)
+{
+  rsize idx;
+
+  if ((idx = r_hash_table_grouped_find (ht, key)) == R_HASH_GROUPS_NONE) {
+    if (keyout != NULL)
+      *keyout = NULL;
+    if (valueout != NULL)
+      *valueout = NULL;
+    return R_HASH_TABLE_NOT_FOUND;
+  }
+
+  if (keyout != NULL)
+    *keyout = ht->groups.keys[idx];
+  if (valueout != NULL)
+    *valueout = ht->groups.vals[idx];
+  if (notify)
+    r_hash_table_grouped_remove (ht, idx);
+  else
+    r_hash_groups_erase (&ht->groups, idx);
+  return R_HASH_TABLE_OK;
+}
+
 RHashTableError
 r_hash_table_remove_full (RHashTable * ht, rconstpointer key,
     rpointer * keyout, rpointer * valueout)
@@ -342,6 +469,9 @@ r_hash_table_remove_full (RHashTable * ht, rconstpointer key,
 
   if (R_UNLIKELY (ht == NULL)) return R_HASH_TABLE_INVAL;
 
+  if (ht->grouped)
+    return r_hash_table_grouped_take (ht, key, keyout, valueout, TRUE);
+
   idx = r_hash_table_lookup_bucket (ht, key, &hash);
   if (R_UNLIKELY (ht->buckets[idx].hash != hash)) {
     if (keyout != NULL)
@@ -368,6 +498,9 @@ r_hash_table_steal (RHashTable * ht, rconstpointer key,
 
   if (R_UNLIKELY (ht == NULL)) return R_HASH_TABLE_INVAL;
 
+  if (ht->grouped)
+    return r_hash_table_grouped_take (ht, key, keyout, valueout, FALSE);
+
   idx = r_hash_table_lookup_bucket (ht, key, &hash);
   if (R_UNLIKELY (ht->buckets[idx].hash != hash)) {
     if (keyout != NULL)
@@ -404,6 +537,16 @@ r_hash_table_remove_with_func (RHashTable * ht,
   if (R_UNLIKELY (ht == NULL)) return R_HASH_TABLE_INVAL;
   if (R_UNLIKELY (func == NULL)) return R_HASH_TABLE_INVAL;
 
+  if (ht->grouped) {
+    RHashGroups * g = &ht->groups;
+    c = r_hash_groups_capacity (g);
+    for (i = 0; i < c; i++) {
+      if (R_HASH_CTRL_IS_FULL (g->ctrl[i]) && func (g->keys[i], g->vals[i], user))
+        r_hash_table_grouped_remove (ht, i);
+    }
+    return R_HASH_TABLE_OK;
+  }
+
   c = R_HASH_CONTAINER_ALLOC_IDX_TO_SIZE (ht->allocidx);
   for (i = 0; i < c; i++) {
     if (R_HASH_BUCKET_LIVE (ht->buckets[i].hash) &&
@@ -423,6 +566,16 @@ r_hash_table_foreach (RHashTable * ht, RKeyValueFunc func, rpointer user)
   if (R_UNLIKELY (ht == NULL)) return R_HASH_TABLE_INVAL;
   if (R_UNLIKELY (func == NULL)) return R_HASH_TABLE_INVAL;
 
+  if (ht->grouped) {
+    RHashGroups * g = &ht->groups;
+    c = r_hash_groups_capacity (g);
+    for (i = 0; i < c; i++) {
+      if (R_HASH_CTRL_IS_FULL (g->ctrl[i]))
+        func (g->keys[i], g->vals[i], user);
+    }
+    return R_HASH_TABLE_OK;
+  }
+
   c = R_HASH_CONTAINER_ALLOC_IDX_TO_SIZE (ht->allocidx);
   for (i = 0; i < c; i++) {
     if (R_HASH_BUCKET_LIVE (ht->buckets[i].hash))
@@ -22,16 +22,22 @@
 #include <rlib/data/rlist.h>
 
 #include <rlib/rassert.h>
+#include <rlib/rmem.h>
 #include <rlib/concurrency/rthreads.h>
 
-#define R_HZR_PTR_R g__r_hzrptr_count
+#include <stdlib.h>
+
+/* Scan once a record has retired more than twice as many pointers as there
+ * are hazards; at least half the retired list is then reclaimable, which
+ * keeps reclamation amortised O(1) per retire. */
+#define R_HZR_PTR_R (2 * r_atomic_uint_load (&g__r_hzrptr_count))
 
 static raptr        g__r_hzrptr; /* (RHzrPtrRec *) */
-static ruint        g__r_hzrptr_count;
+static rauint       g__r_hzrptr_count;
 static RTss         g__r_hzrptr_tss = R_TSS_INIT (r_hzr_ptr_rec_free);
 
 struct RHzrPtrRec {
-  rpointer ptr;
+  raptr ptr;          /* published hazard; scanned by other threads */
   raboolean active;
 
   RFreeList * rlist;
@@ -51,11 +57,13 @@ r_hzr_ptr_acquire (rhzrptr * hzrptr, RHzrPtrRec * rec)
       r_tss_set (&g__r_hzrptr_tss, (rec = r_hzr_ptr_rec_new ()));
   }
 
-  r_assert_cmpptr (rec->ptr, ==, NULL);
+  r_assert_cmpptr (r_atomic_ptr_load (&rec->ptr), ==, NULL);
 
+  /* The hazard store must be visible before the re-load, or a writer could
+   * retire and scan in between without seeing it; both are seq_cst. */
   do {
     ret = r_atomic_ptr_load (&hzrptr->ptr);
-    rec->ptr = ret; /* ret could be NULL! */
+    r_atomic_ptr_store (&rec->ptr, ret); /* ret could be NULL! */
   } while (r_atomic_ptr_load (&hzrptr->ptr) != ret);
 
   return ret;
@@ -72,50 +80,91 @@ r_hzr_ptr_release (rhzrptr * hzrptr, RHzrPtrRec * rec)
   }
 
   /* We can't assert that rec->ptr is non-NULL */
-  rec->ptr = NULL;
+  r_atomic_ptr_store (&rec->ptr, NULL);
+}
+
+typedef struct {
+  rpointer * hp;
+  rsize count;
+} RHzrPtrScan;
+
+static int
+r_hzr_ptr_cmp (const void * a, const void * b)
+{
+  ruintptr pa = (ruintptr)*(rpointer const *)a, pb = (ruintptr)*(rpointer const *)b;
+  return (pa > pb) - (pa < pb);
 }
 
 static rboolean
 r_hzr_ptr_remove_entry (rpointer data, rpointer user)
 {
-  RSList * plist = user;
+  RHzrPtrScan * scan = user;
   RFreePtrCtx * ctx = data;
-  /* Remove from rlist if not found in plist */
-  return !r_slist_contains (plist, ctx->ptr);
+
+  if (bsearch (&ctx->ptr, scan->hp, scan->count, sizeof (rpointer),
+        r_hzr_ptr_cmp) != NULL)
+    return FALSE;
+
+  /* No hazard is published on it: reclaim (the list link itself is freed
+   * without touching the pointer, so notify here). */
+  if (ctx->notify != NULL)
+    ctx->notify (ctx->ptr);
+  return TRUE;
 }
 
 static void
 r_hzr_ptr_rec_scan (RHzrPtrRec * rec)
 {
-  RSList * plist = NULL;
-  RHzrPtrRec * it;
-
-  /* FIXME: Optimize by using a sorted data structure and binary search? */
-  for (it = r_atomic_ptr_load (&g__r_hzrptr); it != NULL; it = it->next) {
-    if (it->ptr != NULL)
-      plist = r_slist_prepend (plist, it->ptr);
+  RHzrPtrScan scan = { NULL, 0 };
+  RHzrPtrRec * head, * it;
+  rsize n = 0;
+
+  /* Records are only ever prepended, and one created after this snapshot
+   * cannot hold a valid hazard on anything already retired. */
+  head = r_atomic_ptr_load (&g__r_hzrptr);
+  for (it = head; it != NULL; it = it->next)
+    n++;
+
+  scan.hp = r_mem_new_n (rpointer, n);
+  for (it = head; it != NULL; it = it->next) {
+    rpointer p = r_atomic_ptr_load (&it->ptr);
+    if (p != NULL)
+      scan.hp[scan.count++] = p;
   }
+  qsort (scan.hp, scan.count, sizeof (rpointer), r_hzr_ptr_cmp);
 
-  r_free_list_foreach_remove (&rec->rlist, r_hzr_ptr_remove_entry, plist);
+  r_free_list_foreach_remove (&rec->rlist, r_hzr_ptr_remove_entry, &scan);
+  rec->rcount = (ruint)r_free_list_len (rec->rlist);
 
-  r_slist_destroy (plist);
+  r_free (scan.hp);
 }
 
 void
-r_hzr_ptr_replace (rhzrptr * hzrptr, rpointer ptr)
+r_hzr_ptr_protect (RHzrPtrRec * rec, rpointer ptr)
+{
+  r_atomic_ptr_store (&rec->ptr, ptr);
+}
+
+void
+r_hzr_ptr_retire (rpointer ptr, RDestroyNotify notify)
 {
   RHzrPtrRec * rec;
-  rpointer retired;
+
+  if (ptr == NULL)
+    return;
 
   if ((rec = r_tss_get (&g__r_hzrptr_tss)) == NULL)
     r_tss_set (&g__r_hzrptr_tss, (rec = r_hzr_ptr_rec_new ()));
 
-  retired = r_atomic_ptr_exchange (&hzrptr->ptr, ptr);
-  if (retired != NULL) {
-    rec->rlist = r_free_list_prepend (rec->rlist, retired, hzrptr->notify);
-    if (++rec->rcount > R_HZR_PTR_R)
-      r_hzr_ptr_rec_scan (rec);
-  }
+  rec->rlist = r_free_list_prepend (rec->rlist, ptr, notify);
+  if (++rec->rcount > R_HZR_PTR_R)
+    r_hzr_ptr_rec_scan (rec);
+}
+
+void
+r_hzr_ptr_replace (rhzrptr * hzrptr, rpointer ptr)
+{
+  r_hzr_ptr_retire (r_atomic_ptr_exchange (&hzrptr->ptr, ptr), hzrptr->notify);
 }
 
 RHzrPtrRec *
@@ -137,6 +186,7 @@ r_hzr_ptr_rec_new (void)
   do {
     rec->next = old;
   } while (!r_atomic_ptr_cmp_xchg_weak (&g__r_hzrptr, &old, rec));
+  r_atomic_uint_fetch_add (&g__r_hzrptr_count, 1);
 
 done:
   return rec;
@@ -146,7 +196,7 @@ void
 r_hzr_ptr_rec_free (RHzrPtrRec * rec)
 {
   if (rec != NULL) {
-    r_assert_cmpptr (rec->ptr, ==, NULL);
+    r_assert_cmpptr (r_atomic_ptr_load (&rec->ptr), ==, NULL);
     r_atomic_bool_unset (&rec->active);
   }
 }
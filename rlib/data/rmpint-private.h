@@ -59,6 +59,59 @@ R_API_HIDDEN rboolean r_mpint_montgomery_reduce_ct_into (rmpint * a,
     const rmpint * m, rmpint_digit mp, rmpint * c);
 R_API_HIDDEN rboolean r_mpint_montgomery_normalize (rmpint * a, const rmpint * m);
 
+/* Below this modulus width the 52-bit limb repacking and the R'^2 setup
+ * outweigh what the IFMA kernel saves over 32-bit CIOS. */
+#define R_MPINT_FE_BIG_IFMA_MIN_DIGITS  8
+/* out := base^exp mod m on the AVX-512 IFMA kernel (rmpint_fe_big_ifma.c),
+ * constant-time in base and exp. base must be reduced below m. Returns
+ * FALSE without touching out when the kernel is unavailable (not built,
+ * no CPU support, or n_digits below R_MPINT_FE_BIG_IFMA_MIN_DIGITS); the
+ * caller then uses the CIOS path. */
+R_API_HIDDEN rboolean r_mpint_fe_big_expmod_ifma (RMpintFE_Big * out,
+    const RMpintFE_Big * base, const rmpint * exp, ruint exp_bits,
+    const RMpintFE_BigMontCtx * ctx, const RMpintFE_Big * mont_r_squared);
+
+/* Buffers one r_mpint_fe_big_expmod_ifma_x8 call exponentiates at once. */
+#define R_MPINT_FE_BIG_IFMA_LANES       8
+/* out[i] := base[i]^exp mod m for i < count <= R_MPINT_FE_BIG_IFMA_LANES,
+ * one buffer per 64-bit vector lane. All lanes share the modulus and the
+ * exponent (the CRT halves of one RSA key), so the window sequence is
+ * common and only the data differs. Same preconditions and FALSE cases
+ * as r_mpint_fe_big_expmod_ifma. */
+R_API_HIDDEN rboolean r_mpint_fe_big_expmod_ifma_x8 (RMpintFE_Big * out,
+    const RMpintFE_Big * base, rsize count, const rmpint * exp,
+    ruint exp_bits, const RMpintFE_BigMontCtx * ctx,
+    const RMpintFE_Big * mont_r_squared);
+
+/* Fixed-base comb on the IFMA kernel, driven by rmpint_fe_big_comb.c.
+ * The stride is the table entry size in 64-bit limbs, or 0 when the
+ * kernel can't take the modulus; build and expmod may only be called
+ * after a nonzero stride. */
+R_API_HIDDEN ruint r_mpint_fe_big_comb_ifma_stride (
+    const RMpintFE_BigMontCtx * ctx);
+R_API_HIDDEN void r_mpint_fe_big_comb_ifma_build (ruint64 * table,
+    ruint teeth, ruint spacing, const RMpintFE_Big * base,
+    const RMpintFE_BigMontCtx * ctx, const RMpintFE_Big * mont_r_squared);
+R_API_HIDDEN void r_mpint_fe_big_comb_ifma_expmod (RMpintFE_Big * out,
+    const ruint64 * table, ruint teeth, ruint spacing, const rmpint * exp,
+    const RMpintFE_BigMontCtx * ctx);
+
+/* Precomputed fixed-base table for base^exp mod m with exp below
+ * 2^exp_bits (Lim-Lee comb). With t teeth the table holds 2^t entries
+ * and one exponentiation is ceil(exp_bits / t) squarings and
+ * multiplications, none of them building powers of the base. The
+ * object is read-only after r_mpint_fe_big_comb_new, so one instance
+ * can serve any number of threads. */
+typedef struct RMpintFE_BigComb RMpintFE_BigComb;
+R_API_HIDDEN RMpintFE_BigComb * r_mpint_fe_big_comb_new (const rmpint * base,
+    const RMpintFE_BigMontCtx * ctx, const RMpintFE_Big * mont_r_squared,
+    ruint exp_bits, ruint teeth);
+R_API_HIDDEN void r_mpint_fe_big_comb_free (RMpintFE_BigComb * comb);
+/* dst := base^exp mod m, constant-time in exp. FALSE when exp is
+ * negative or wider than the table's exp_bits. */
+R_API_HIDDEN rboolean r_mpint_fe_big_comb_expmod (rmpint * dst,
+    const RMpintFE_BigComb * comb, const rmpint * exp);
+
 R_END_DECLS
 
 #endif /* __R_MPINT_PRIVATE_H__ */
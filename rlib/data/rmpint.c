@@ -21,6 +21,7 @@
 
 #include <rlib/charset/rascii.h>
 
+#include <rlib/rcpufeatures.h>
 #include <rlib/rmem.h>
 #include <rlib/rstr.h>
 
@@ -1229,12 +1230,145 @@ r_mpint_mul_comba (rmpint_digit * out, const rmpint_digit * a,
   }
 }
 
+/* Below this many digits a Karatsuba split costs more in add/sub passes
+ * than the quarter of the digit products it saves. Tuned on x86-64 with
+ * the Comba kernel above as the base case; the crossover is flat between
+ * roughly 24 and 40 digits. */
+#define R_MPINT_KARATSUBA_THRESHOLD   32
+
+/* r := a - b over n digits; returns the borrow out as an all-ones /
+ * all-zeros mask. r may alias a. */
+static rmpint_digit
+r_mpint_digits_sub_mask (rmpint_digit * r, const rmpint_digit * a,
+    const rmpint_digit * b, ruint n)
+{
+  rmpint_word u;
+  rmpint_digit borrow = 0;
+  ruint i;
+
+  for (i = 0; i < n; i++) {
+    u = (rmpint_word)a[i] - b[i] - borrow;
+    r[i] = (rmpint_digit)u;
+    borrow = (rmpint_digit)(u >> (sizeof (rmpint_digit) * 8)) & 1u;
+  }
+  return (rmpint_digit)0 - borrow;
+}
+
+/* r := |a0 - a1| where a0 has m digits and a1 has k <= m digits. The
+ * returned mask is all-ones when a0 < a1. Both the subtract and the
+ * conditional negate touch every digit, so timing depends on m and k
+ * only. */
+static rmpint_digit
+r_mpint_digits_absdiff (rmpint_digit * r, const rmpint_digit * a0, ruint m,
+    const rmpint_digit * a1, ruint k)
+{
+  rmpint_word u;
+  rmpint_digit neg, c;
+  ruint i;
+
+  for (i = 0; i < k; i++)
+    r[i] = a1[i];
+  for (; i < m; i++)
+    r[i] = 0;
+  neg = r_mpint_digits_sub_mask (r, a0, r, m);
+
+  for (i = 0, c = neg & 1u; i < m; i++) {
+    u = (rmpint_word)(r[i] ^ neg) + c;
+    r[i] = (rmpint_digit)u;
+    c = (rmpint_digit)(u >> (sizeof (rmpint_digit) * 8));
+  }
+  return neg;
+}
+
+/* Scratch digits r_mpint_mul_karatsuba needs for an n-digit multiply:
+ * each level holds |a0 - a1|, |b0 - b1|, their 2m-digit product and the
+ * 2m+1-digit middle term, then recurses on m = ceil(n / 2). */
+static rsize
+r_mpint_karatsuba_scratch (ruint n)
+{
+  rsize ret = 0;
+
+  while (n >= R_MPINT_KARATSUBA_THRESHOLD) {
+    n = (n + 1) / 2;
+    ret += 6 * (rsize)n + 1;
+  }
+  return ret;
+}
+
+/* Karatsuba multiply of two n-digit operands into out[0 .. 2n-1], with
+ * Comba as the base case below R_MPINT_KARATSUBA_THRESHOLD.
+ *
+ * Uses the subtractive form, a0*b1 + a1*b0 = z0 + z2 - (a0 - a1)(b0 - b1),
+ * so the middle product stays at m = ceil(n / 2) digits instead of m + 1.
+ * The sign of (a0 - a1)(b0 - b1) is folded in with masks rather than a
+ * branch, and every loop bound depends on n only: like the Comba kernel,
+ * this is constant-time in the operand values. @p out must not alias
+ * @p a or @p b; @p scratch holds r_mpint_karatsuba_scratch(n) digits. */
+static void
+r_mpint_mul_karatsuba (rmpint_digit * out, const rmpint_digit * a,
+    const rmpint_digit * b, ruint n, rmpint_digit * scratch)
+{
+  rmpint_digit * da, * db, * z1, * t, * next;
+  rmpint_digit sub, c;
+  rmpint_word u;
+  ruint m, k, i;
+
+  if (n < R_MPINT_KARATSUBA_THRESHOLD) {
+    r_mpint_mul_comba (out, a, b, n);
+    return;
+  }
+
+  m = (n + 1) / 2;
+  k = n - m;
+  da = scratch;
+  db = da + m;
+  z1 = db + m;
+  t = z1 + 2 * m;
+  next = t + 2 * m + 1;
+
+  /* z0 = a0 * b0 in out[0 .. 2m), z2 = a1 * b1 in out[2m .. 2n). */
+  r_mpint_mul_karatsuba (out, a, b, m, next);
+  r_mpint_mul_karatsuba (out + 2 * m, a + m, b + m, k, next);
+
+  /* z1 = |a0 - a1| * |b0 - b1|; subtract it when both differences have
+   * the same sign, add it otherwise. */
+  sub = ~(r_mpint_digits_absdiff (da, a, m, a + m, k) ^
+      r_mpint_digits_absdiff (db, b, m, b + m, k));
+  r_mpint_mul_karatsuba (z1, da, db, m, next);
+
+  /* t = z0 + z2 over 2m + 1 digits. */
+  for (i = 0, c = 0; i < 2 * m; i++) {
+    u = (rmpint_word)out[i] + (i < 2 * k ? out[2 * m + i] : 0) + c;
+    t[i] = (rmpint_digit)u;
+    c = (rmpint_digit)(u >> (sizeof (rmpint_digit) * 8));
+  }
+  t[2 * m] = c;
+
+  /* t +/-= z1, as t + (z1 ^ sub) + (sub & 1) with z1 sign-extended by one
+   * digit. The true middle term is non-negative and below 2 * B^2m, so
+   * the wrapped 2m + 1 digit result is exact. */
+  for (i = 0, c = sub & 1u; i < 2 * m; i++) {
+    u = (rmpint_word)t[i] + (z1[i] ^ sub) + c;
+    t[i] = (rmpint_digit)u;
+    c = (rmpint_digit)(u >> (sizeof (rmpint_digit) * 8));
+  }
+  t[2 * m] += sub + c;
+
+  /* out += t * B^m. The full product fits 2n digits, so the carry out of
+   * the top digit is always zero. */
+  for (i = 0, c = 0; m + i < 2 * n; i++) {
+    u = (rmpint_word)out[m + i] + (i <= 2 * m ? t[i] : 0) + c;
+    out[m + i] = (rmpint_digit)u;
+    c = (rmpint_digit)(u >> (sizeof (rmpint_digit) * 8));
+  }
+}
+
 /* Based on Paul G. Combas algorithm/method */
 rboolean
 r_mpint_mul (rmpint * dst, const rmpint * a, const rmpint * b)
 {
   rint32 ix, iy, iz, tx, ty;
-  ruint16 used;
+  ruint16 used, n, alloc;
   rmpint * tmp, * out;
   rmpint_word w, acc, c;
 
@@ -1245,24 +1379,72 @@ r_mpint_mul (rmpint * dst, const rmpint * a, const rmpint * b)
   if (R_UNLIKELY (used < a->dig_used || used < b->dig_used))
     return FALSE;
 
+  /* Operands within a factor of two of each other are zero-padded to a
+   * common width n and run through the fixed-size kernels, which then
+   * write all 2n digits. This covers the Montgomery ladders, where the
+   * clamped intermediates differ by a digit or so. */
+  n = MAX (a->dig_used, b->dig_used);
+  if (2 * (ruint)MIN (a->dig_used, b->dig_used) >= n &&
+      2 * (ruint)n <= RUINT16_MAX)
+    alloc = 2 * n;
+  else
+    alloc = n = 0;
+
   if (a == dst || b == dst) {
     /* dst aliases one of the operands; build the full product in a
      * fresh scratch first, then r_mpint_set into dst. The scratch
      * holds the entire a*b product so it leaks bits of both -
      * inherit secure-clear from either. */
     tmp = r_mem_newa (rmpint);
-    r_mpint_init_size_from (tmp, used, a, b, NULL);
+    r_mpint_init_size_from (tmp, MAX (used, alloc), a, b, NULL);
     out = tmp;
   } else {
     tmp = NULL;
-    r_mpint_ensure_digits (dst, used);
+    r_mpint_ensure_digits (dst, MAX (used, alloc));
     out = dst;
   }
 
-  /* Fixed-size fast path for the hot RSA operand sizes (1024 / 2048 bit). */
-  if (a->dig_used == b->dig_used &&
-      (a->dig_used == 32 || a->dig_used == 64)) {
-    r_mpint_mul_comba (out->data, a->data, b->data, a->dig_used);
+  if (n > 0) {
+    const rmpint_digit * ad = a->data, * bd = b->data;
+    rmpint_digit * pad = NULL, * scratch, * buf = NULL;
+    rsize scratch_size = r_mpint_karatsuba_scratch (n);
+    rsize buf_size = scratch_size + (a->dig_used != b->dig_used ? n : 0);
+
+    /* Operands are as wide as the caller lets them be (up to 64K digits),
+     * so only default-sized ones get their scratch off the stack */
+    if (buf_size > 0) {
+      if (n <= RMPINT_DEF_DIGITS) {
+        buf = r_mem_newa_n (rmpint_digit, buf_size);
+      } else if ((buf = r_mem_new_n (rmpint_digit, buf_size)) == NULL) {
+        if (tmp != NULL)
+          r_mpint_clear (tmp);
+        return FALSE;
+      }
+    }
+    scratch = buf;
+
+    if (a->dig_used != b->dig_used) {
+      pad = buf + scratch_size;
+      r_memcpy (pad, a->dig_used < n ? a->data : b->data,
+          MIN (a->dig_used, b->dig_used) * sizeof (rmpint_digit));
+      r_memclear (pad + MIN (a->dig_used, b->dig_used),
+          (n - MIN (a->dig_used, b->dig_used)) * sizeof (rmpint_digit));
+      if (a->dig_used < n)
+        ad = pad;
+      else
+        bd = pad;
+    }
+
+    if (scratch_size > 0)
+      r_mpint_mul_karatsuba (out->data, ad, bd, n, scratch);
+    else
+      r_mpint_mul_comba (out->data, ad, bd, n);
+
+    if (buf != NULL) {
+      r_memclear_secure (buf, buf_size * sizeof (rmpint_digit));
+      if (n > RMPINT_DEF_DIGITS)
+        r_free (buf);
+    }
   } else for (ix = 0, acc = 0; ix < used; ix++) {
     ty = MIN (ix, b->dig_used - 1);
     tx = ix - ty;
@@ -1714,6 +1896,41 @@ r_mpint_invmod (rmpint * dst, const rmpint * a, const rmpint * m)
     r_mpint_invmod_odd (dst, a, m) : r_mpint_invmod_even (dst, a, m);
 }
 
+/* Windowed exponentiation on the AVX-512 IFMA kernel for odd moduli in
+ * RMpintFE_Big range. The per-call context and R^2 setup is one division,
+ * small next to a DH-sized exponentiation. Returns FALSE (dst untouched)
+ * whenever the kernel can't take the operands. */
+static rboolean
+r_mpint_expmod_ifma (rmpint * dst, const rmpint * b, const rmpint * e,
+    const rmpint * m)
+{
+  RMpintFE_BigMontCtx ctx;
+  RMpintFE_Big rr, x;
+  rmpint t;
+  ruint16 n = r_mpint_digits_used (m);
+  rboolean ret = FALSE;
+
+  if (n < R_MPINT_FE_BIG_IFMA_MIN_DIGITS || n > R_MPINT_FE_BIG_MAX_DIGITS ||
+      !r_mpint_isodd (m) || m->sign != 0 || b->sign != 0 || e->sign != 0 ||
+      !r_cpu_has (R_CPU_FEATURE_AVX512IFMA))
+    return FALSE;
+
+  r_mpint_init_from (&t, b, e, m, NULL);
+  if (r_mpint_fe_big_mont_ctx_init (&ctx, m) &&
+      r_mpint_fe_big_compute_r_squared (&rr, m, n) &&
+      r_mpint_mod (&t, b, m)) {
+    r_mpint_fe_big_from_mpint (&x, &t, n);
+    ret = r_mpint_fe_big_expmod_ifma (&x, &x, e,
+          (ruint)r_mpint_digits_used (e) * sizeof (rmpint_digit) * 8,
+          &ctx, &rr) &&
+      r_mpint_fe_big_to_mpint (dst, &x, n);
+  }
+
+  r_memclear_secure (&x, sizeof (x));
+  r_mpint_clear (&t);
+  return ret;
+}
+
 rboolean
 r_mpint_expmod (rmpint * dst, const rmpint * b, const rmpint * e, const rmpint * m)
 {
@@ -1724,6 +1941,9 @@ r_mpint_expmod (rmpint * dst, const rmpint * b, const rmpint * e, const rmpint *
   if (R_UNLIKELY (dst == NULL || b == NULL || e == NULL || m == NULL))
     return FALSE;
 
+  if (r_mpint_expmod_ifma (dst, b, e, m))
+    return TRUE;
+
   if (!r_mpint_montgomery_setup (&mp, m))
      return FALSE;
 
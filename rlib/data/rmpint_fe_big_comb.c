@@ -0,0 +1,229 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2016  Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+
+/* Fixed-base exponentiation with a precomputed comb (Lim & Lee, "More
+ * Flexible Exponentiation with Precomputation").
+ *
+ * The exponent's exp_bits are laid out as a t x d matrix, d = ceil(exp_bits
+ * / t), bit k * d + i in row k, column i. The table holds, for every t-bit
+ * column value v, the product over set bits k of v of g^(2^(k d)); one
+ * exponentiation then walks the d columns from the top with one squaring
+ * and one CT table multiply each. Against the 4-bit window expmod that is
+ * d squarings instead of exp_bits, and no per-call power table.
+ *
+ * The table lives in whichever Montgomery domain the exponentiation runs
+ * in: the 52-bit IFMA limbs when r_mpint_fe_big_comb_ifma_stride says the
+ * kernel takes the modulus, the 32-bit CIOS digits otherwise. */
+
+#include "config.h"
+#include "rmpint-private.h"
+
+#include <rlib/rmem.h>
+
+/* 2^16 entries is far past the point where the lookups cost more than
+ * the multiplications they save. */
+#define R_MPINT_FE_BIG_COMB_MAX_TEETH   16
+
+struct RMpintFE_BigComb {
+  RMpintFE_BigMontCtx ctx;
+  ruint teeth;
+  ruint spacing;
+  ruint exp_bits;
+  /* Entry size: 64-bit limbs with ifma, digits without. */
+  rsize stride;
+  rboolean ifma;
+  rpointer table;
+};
+
+/* dst := table[idx] over n-digit entries, reading every entry. The tail
+ * of dst above n is zeroed so it feeds the FE_Big primitives as-is. */
+static void
+r_mpint_fe_big_comb_select (RMpintFE_Big * dst, const rmpint_digit * table,
+    ruint entries, ruint idx, ruint16 n)
+{
+  ruint i;
+  ruint16 d;
+
+  r_mpint_fe_big_zero (dst);
+  for (i = 0; i < entries; i++) {
+    rmpint_digit x = (rmpint_digit)(i ^ idx);
+    rmpint_digit mask = ((x | ((rmpint_digit)0 - x)) >>
+        (sizeof (rmpint_digit) * 8 - 1)) - (rmpint_digit)1;
+    const rmpint_digit * e = table + (rsize)i * n;
+
+    for (d = 0; d < n; d++)
+      dst->d[d] |= e[d] & mask;
+  }
+}
+
+static void
+r_mpint_fe_big_comb_build (RMpintFE_BigComb * comb, const RMpintFE_Big * base,
+    const RMpintFE_Big * mont_r_squared)
+{
+  rmpint_digit * table = comb->table;
+  RMpintFE_Big g, prev, t;
+  ruint16 n = comb->ctx.n_digits;
+  ruint i, k, v;
+
+  r_mpint_fe_big_zero (&t);
+  t.d[0] = 1;
+  r_mpint_fe_big_mont_in (&t, &t, mont_r_squared, &comb->ctx);
+  r_memcpy (table, t.d, n * sizeof (rmpint_digit));
+  r_mpint_fe_big_mont_in (&g, base, mont_r_squared, &comb->ctx);
+
+  for (k = 0; k < comb->teeth; k++) {
+    if (k > 0) {
+      for (i = 0; i < comb->spacing; i++)
+        r_mpint_fe_big_sqr_mont (&g, &g, &comb->ctx);
+    }
+    for (v = 1u << k; v < 2u << k; v++) {
+      r_mpint_fe_big_zero (&prev);
+      r_memcpy (prev.d, table + (v - (1u << k)) * comb->stride,
+          n * sizeof (rmpint_digit));
+      r_mpint_fe_big_mul_mont (&t, &prev, &g, &comb->ctx);
+      r_memcpy (table + v * comb->stride, t.d, n * sizeof (rmpint_digit));
+    }
+  }
+
+  r_memclear_secure (&g, sizeof (g));
+  r_memclear_secure (&prev, sizeof (prev));
+  r_memclear_secure (&t, sizeof (t));
+}
+
+RMpintFE_BigComb *
+r_mpint_fe_big_comb_new (const rmpint * base, const RMpintFE_BigMontCtx * ctx,
+    const RMpintFE_Big * mont_r_squared, ruint exp_bits, ruint teeth)
+{
+  RMpintFE_BigComb * ret;
+  RMpintFE_Big base_fe;
+  rmpint m, b;
+  rsize size;
+  ruint16 n;
+
+  if (R_UNLIKELY (base == NULL || ctx == NULL || mont_r_squared == NULL))
+    return NULL;
+  if (R_UNLIKELY (exp_bits == 0 || teeth == 0 ||
+        teeth > R_MPINT_FE_BIG_COMB_MAX_TEETH))
+    return NULL;
+  n = ctx->n_digits;
+  if (R_UNLIKELY (n == 0 || n > R_MPINT_FE_BIG_MAX_DIGITS || base->sign != 0))
+    return NULL;
+
+  if ((ret = r_mem_new (RMpintFE_BigComb)) == NULL)
+    return NULL;
+  r_memcpy (&ret->ctx, ctx, sizeof (RMpintFE_BigMontCtx));
+  ret->teeth = teeth;
+  ret->spacing = (exp_bits + teeth - 1) / teeth;
+  ret->exp_bits = exp_bits;
+  if ((ret->stride = r_mpint_fe_big_comb_ifma_stride (ctx)) > 0) {
+    ret->ifma = TRUE;
+    size = ret->stride * sizeof (ruint64);
+  } else {
+    ret->ifma = FALSE;
+    ret->stride = n;
+    size = ret->stride * sizeof (rmpint_digit);
+  }
+  if ((ret->table = r_malloc (size << teeth)) == NULL) {
+    r_free (ret);
+    return NULL;
+  }
+
+  /* The base is public (a group generator), so the reduction can take
+   * the variable-time path. */
+  r_mpint_init (&m);
+  r_mpint_init (&b);
+  if (!r_mpint_fe_big_to_mpint (&m, &ctx->p, n) || !r_mpint_mod (&b, base, &m)) {
+    r_mpint_clear (&m);
+    r_mpint_clear (&b);
+    r_free (ret->table);
+    r_free (ret);
+    return NULL;
+  }
+  r_mpint_fe_big_from_mpint (&base_fe, &b, n);
+  r_mpint_clear (&m);
+  r_mpint_clear (&b);
+
+  if (ret->ifma) {
+    r_mpint_fe_big_comb_ifma_build (ret->table, teeth, ret->spacing,
+        &base_fe, ctx, mont_r_squared);
+  } else {
+    r_mpint_fe_big_comb_build (ret, &base_fe, mont_r_squared);
+  }
+
+  return ret;
+}
+
+void
+r_mpint_fe_big_comb_free (RMpintFE_BigComb * comb)
+{
+  if (comb != NULL) {
+    r_free (comb->table);
+    r_free (comb);
+  }
+}
+
+rboolean
+r_mpint_fe_big_comb_expmod (rmpint * dst, const RMpintFE_BigComb * comb,
+    const rmpint * exp)
+{
+  RMpintFE_Big result, picked;
+  ruint16 n;
+  ruint i, k, idx;
+  rboolean ret;
+
+  if (R_UNLIKELY (dst == NULL || comb == NULL || exp == NULL))
+    return FALSE;
+  /* Public bound on the exponent length, not its value. */
+  if (R_UNLIKELY (exp->sign != 0 || r_mpint_bits_used (exp) > comb->exp_bits))
+    return FALSE;
+
+  n = comb->ctx.n_digits;
+  if (comb->ifma) {
+    r_mpint_fe_big_comb_ifma_expmod (&result, comb->table, comb->teeth,
+        comb->spacing, exp, &comb->ctx);
+    ret = r_mpint_fe_big_to_mpint (dst, &result, n);
+    r_memclear_secure (&result, sizeof (result));
+    return ret;
+  }
+
+  r_mpint_fe_big_zero (&result);
+  r_memcpy (result.d, comb->table, n * sizeof (rmpint_digit));
+
+  for (i = comb->spacing; i-- > 0;) {
+    if (i + 1 < comb->spacing)
+      r_mpint_fe_big_sqr_mont (&result, &result, &comb->ctx);
+
+    for (k = 0, idx = 0; k < comb->teeth; k++) {
+      ruint bp = k * comb->spacing + i;
+      idx |= (ruint)((r_mpint_get_digit_ct (exp,
+                (ruint32)(bp / (sizeof (rmpint_digit) * 8))) >>
+            (bp % (sizeof (rmpint_digit) * 8))) & 1u) << k;
+    }
+
+    r_mpint_fe_big_comb_select (&picked, comb->table, 1u << comb->teeth,
+        idx, n);
+    r_mpint_fe_big_mul_mont (&result, &result, &picked, &comb->ctx);
+  }
+
+  r_mpint_fe_big_mont_out (&result, &result, &comb->ctx);
+  ret = r_mpint_fe_big_to_mpint (dst, &result, n);
+
+  r_memclear_secure (&result, sizeof (result));
+  r_memclear_secure (&picked, sizeof (picked));
+  return ret;
+}
@@ -107,6 +107,13 @@ r_mpint_fe_big_expmod_ct (rmpint * dst, const rmpint * base,
   }
   r_mpint_fe_big_from_mpint (&base_fe, &reduced_base, n);
 
+  /* Same exponentiation on 52-bit limbs when the CPU has IFMA. */
+  if (r_mpint_fe_big_expmod_ifma (&result, &base_fe, exp, exp_bits,
+        ctx, mont_r_squared)) {
+    ok = r_mpint_fe_big_to_mpint (dst, &result, n);
+    goto cleanup;
+  }
+
   /* table[0] = 1_M (= R mod m). Build via mont_in(1). */
   r_mpint_fe_big_zero (&one_fe);
   one_fe.d[0] = 1;
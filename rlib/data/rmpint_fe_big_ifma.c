@@ -0,0 +1,703 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2016  Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+
+/* AVX-512 IFMA Montgomery exponentiation for RMpintFE_Big moduli.
+ *
+ * VPMADD52LUQ / VPMADD52HUQ multiply eight pairs of 52-bit lanes and
+ * accumulate the low or high 52 bits of each 104-bit product into 64-bit
+ * lanes. Holding operands as radix-2^52 limbs, one multiply-accumulate
+ * instruction does the work of eight 32x32 digit products plus their
+ * carries, and the 12 bits of headroom per lane let a whole Montgomery
+ * multiplication run without carry propagation until the end.
+ *
+ * The multiplication is the "almost Montgomery" form (Gueron & Krasnov,
+ * "Accelerating Big Integer Arithmetic Using Intel IFMA Extensions"):
+ * with R' = 2^(52 L) > 4m, inputs below 2m give an output below 2m, so
+ * the conditional subtract drops out of the inner loop and only runs
+ * once, on the final result. Every loop bound is a function of the
+ * modulus width, and table lookups touch every entry, so the kernel is
+ * constant-time in base and exponent like the CIOS path it replaces.
+ *
+ * r_mpint_fe_big_expmod_ifma returns FALSE when the kernel isn't built
+ * in, the CPU lacks IFMA or the modulus is too narrow to benefit; the
+ * callers then fall back to the 32-bit CIOS code. */
+
+#include "config.h"
+#include "rmpint-private.h"
+
+#include <rlib/rcpufeatures.h>
+#include <rlib/rmem.h>
+
+#if defined(HAVE_IMMINTRIN_H) && defined(R_ARCH_X86_64) && \
+    (defined(__GNUC__) || defined(__clang__))
+# include <immintrin.h>
+# define R_MPINT_IFMA
+# define R_MPINT_IFMA_TARGET __attribute__((target("avx512f,avx512ifma")))
+#endif
+
+#ifdef R_MPINT_IFMA
+
+#define R_MPINT_IFMA_LIMB_BITS      52
+#define R_MPINT_IFMA_LIMB_MASK      ((RUINT64_CONSTANT (1) << R_MPINT_IFMA_LIMB_BITS) - 1)
+/* Limbs needed for n digits with R' = 2^(52 L) > 4m. */
+#define R_MPINT_IFMA_LIMBS(n) \
+  (((ruint)(n) * 32u + 2u + R_MPINT_IFMA_LIMB_BITS - 1u) / R_MPINT_IFMA_LIMB_BITS)
+#define R_MPINT_IFMA_MAX_VECS       ((R_MPINT_IFMA_LIMBS (R_MPINT_FE_BIG_MAX_DIGITS) + 7u) / 8u)
+#define R_MPINT_IFMA_MAX_LIMBS      (R_MPINT_IFMA_MAX_VECS * 8u)
+
+#define R_MPINT_IFMA_WINDOW_BITS    4
+#define R_MPINT_IFMA_WINDOW_SIZE    (1u << R_MPINT_IFMA_WINDOW_BITS)
+
+typedef struct {
+  ruint64 m[R_MPINT_IFMA_MAX_LIMBS];
+  ruint64 k0;                 /* -m^-1 mod 2^52 */
+  ruint limbs;                /* L, the Montgomery loop count */
+  ruint vecs;                 /* ceil(L / 8) */
+} RMpintIfmaCtx;
+
+/* Repack n 32-bit digits into radix-2^52 limbs, zero-filling up to
+ * limbs. Each limb straddles at most three digits; the indices depend on
+ * the (public) width only. */
+static void
+r_mpint_ifma_from_digits (ruint64 * r, ruint limbs, const rmpint_digit * d,
+    ruint16 n)
+{
+  ruint i;
+
+  for (i = 0; i < limbs; i++) {
+    ruint bit = i * R_MPINT_IFMA_LIMB_BITS, w = bit / 32, s = bit % 32;
+    ruint64 v = 0;
+
+    if (w < n)
+      v |= (ruint64)d[w] >> s;
+    if (w + 1 < n)
+      v |= (ruint64)d[w + 1] << (32 - s);
+    if (w + 2 < n && s > 12)
+      v |= (ruint64)d[w + 2] << (64 - s);
+    r[i] = v & R_MPINT_IFMA_LIMB_MASK;
+  }
+}
+
+static void
+r_mpint_ifma_to_digits (rmpint_digit * d, ruint16 n, const ruint64 * r,
+    ruint limbs)
+{
+  ruint16 j;
+
+  for (j = 0; j < n; j++) {
+    ruint bit = (ruint)j * 32, w = bit / R_MPINT_IFMA_LIMB_BITS;
+    ruint s = bit % R_MPINT_IFMA_LIMB_BITS;
+    ruint64 v = 0;
+
+    if (w < limbs)
+      v |= r[w] >> s;
+    if (w + 1 < limbs)
+      v |= r[w + 1] << (R_MPINT_IFMA_LIMB_BITS - s);
+    d[j] = (rmpint_digit)v;
+  }
+}
+
+/* r := a * b / R' mod m, "almost" reduced: r < 2m for a, b < 2m. r may
+ * alias a or b. Limbs of a, b and m must be normalised (< 2^52); the
+ * accumulator lanes are not, and absorb up to 4 L additions of 52-bit
+ * halves before the single carry pass at the end. */
+R_MPINT_IFMA_TARGET static inline __attribute__((always_inline)) void
+r_mpint_ifma_amm_n (ruint64 * r, const ruint64 * a, const ruint64 * b,
+    const RMpintIfmaCtx * ctx, const ruint nv)
+{
+  __m512i acc[R_MPINT_IFMA_MAX_VECS], av[R_MPINT_IFMA_MAX_VECS];
+  __m512i mv[R_MPINT_IFMA_MAX_VECS];
+  const __m512i zero = _mm512_setzero_si512 ();
+  ruint64 t[R_MPINT_IFMA_MAX_LIMBS], c, m0 = ctx->m[0];
+  ruint i, v;
+
+  for (v = 0; v < nv; v++) {
+    acc[v] = zero;
+    av[v] = _mm512_loadu_si512 (a + 8 * v);
+    mv[v] = _mm512_loadu_si512 (ctx->m + 8 * v);
+  }
+
+  for (i = 0; i < ctx->limbs; i++) {
+    __m512i bi = _mm512_set1_epi64 ((long long)b[i]), yv;
+    ruint64 a0, y;
+
+    for (v = 0; v < nv; v++)
+      acc[v] = _mm512_madd52lo_epu64 (acc[v], av[v], bi);
+
+    /* y zeroes the low 52 bits of lane 0 once y * m is added; the carry
+     * out of that lane is computed on the scalar side so the vector
+     * pipeline doesn't have to be drained a second time. */
+    a0 = (ruint64)_mm_cvtsi128_si64 (_mm512_castsi512_si128 (acc[0]));
+    y = (a0 * ctx->k0) & R_MPINT_IFMA_LIMB_MASK;
+    c = (a0 + ((m0 * y) & R_MPINT_IFMA_LIMB_MASK)) >> R_MPINT_IFMA_LIMB_BITS;
+    yv = _mm512_set1_epi64 ((long long)y);
+
+    for (v = 0; v < nv; v++)
+      acc[v] = _mm512_madd52lo_epu64 (acc[v], mv[v], yv);
+
+    /* Divide by 2^52: shift every lane down one position across the
+     * vector chain, then fold lane 0's carry into the new lane 0. */
+    for (v = 0; v + 1 < nv; v++)
+      acc[v] = _mm512_alignr_epi64 (acc[v + 1], acc[v], 1);
+    acc[nv - 1] = _mm512_alignr_epi64 (zero, acc[nv - 1], 1);
+    acc[0] = _mm512_mask_add_epi64 (acc[0], 1, acc[0],
+        _mm512_set1_epi64 ((long long)c));
+
+    /* The high halves belong one limb up, which after the shift is the
+     * same lane index as their operands. */
+    for (v = 0; v < nv; v++) {
+      acc[v] = _mm512_madd52hi_epu64 (acc[v], av[v], bi);
+      acc[v] = _mm512_madd52hi_epu64 (acc[v], mv[v], yv);
+    }
+  }
+
+  for (v = 0; v < nv; v++)
+    _mm512_storeu_si512 (t + 8 * v, acc[v]);
+  for (i = 0, c = 0; i < 8 * nv; i++) {
+    c += t[i];
+    r[i] = c & R_MPINT_IFMA_LIMB_MASK;
+    c >>= R_MPINT_IFMA_LIMB_BITS;
+  }
+  r_memclear_secure (t, sizeof (t));
+}
+
+/* Constant vector counts let the compiler keep acc / av / mv in zmm
+ * registers instead of spilling them every limb. That is worth ~30% for
+ * the RSA-1024/2048 CRT halves (2 and 3 vectors); from 4 vectors up the
+ * multiply throughput dominates and the generic body does as well. */
+R_MPINT_IFMA_TARGET static void
+r_mpint_ifma_amm (ruint64 * r, const ruint64 * a, const ruint64 * b,
+    const RMpintIfmaCtx * ctx)
+{
+  switch (ctx->vecs) {
+    case 2: r_mpint_ifma_amm_n (r, a, b, ctx, 2); break;
+    case 3: r_mpint_ifma_amm_n (r, a, b, ctx, 3); break;
+    default: r_mpint_ifma_amm_n (r, a, b, ctx, ctx->vecs); break;
+  }
+}
+
+/* dst := table[idx] out of entries spaced stride limbs apart, reading
+ * every entry. */
+R_MPINT_IFMA_TARGET static void
+r_mpint_ifma_table_select (ruint64 * dst, const ruint64 * table,
+    ruint entries, rsize stride, ruint idx, ruint nv)
+{
+  __m512i sel[R_MPINT_IFMA_MAX_VECS];
+  ruint i, v;
+
+  for (v = 0; v < nv; v++)
+    sel[v] = _mm512_setzero_si512 ();
+
+  for (i = 0; i < entries; i++) {
+    ruint64 x = (ruint64)(i ^ idx);
+    __m512i mask = _mm512_set1_epi64 ((long long)
+        (((x | ((ruint64)0 - x)) >> 63) - 1));
+    const ruint64 * e = table + (rsize)i * stride;
+
+    for (v = 0; v < nv; v++)
+      sel[v] = _mm512_or_si512 (sel[v],
+          _mm512_and_si512 (_mm512_loadu_si512 (e + 8 * v), mask));
+  }
+
+  for (v = 0; v < nv; v++)
+    _mm512_storeu_si512 (dst + 8 * v, sel[v]);
+}
+
+static void
+r_mpint_ifma_ctx_init (RMpintIfmaCtx * ctx, const RMpintFE_BigMontCtx * mctx)
+{
+  ruint64 inv;
+  int i;
+
+  ctx->limbs = R_MPINT_IFMA_LIMBS (mctx->n_digits);
+  ctx->vecs = (ctx->limbs + 7) / 8;
+  r_mpint_ifma_from_digits (ctx->m, 8 * ctx->vecs, mctx->p.d, mctx->n_digits);
+
+  /* Newton iteration for m^-1 mod 2^64; each step doubles the correct
+   * low bits, starting from 3 (m is odd, so m * m == 1 mod 8). */
+  for (i = 0, inv = ctx->m[0]; i < 5; i++)
+    inv *= 2 - ctx->m[0] * inv;
+  ctx->k0 = ((ruint64)0 - inv) & R_MPINT_IFMA_LIMB_MASK;
+}
+
+/* rr52 := R'^2 mod m from the 32-bit domain's R^2 = 2^(64n) mod m: R' is
+ * at most a few limbs wider than R, so this is a short run of CT modular
+ * doublings. Fills 8 * vecs limbs. */
+static void
+r_mpint_ifma_r_squared (ruint64 * rr52, const RMpintIfmaCtx * ictx,
+    const RMpintFE_BigMontCtx * ctx, const RMpintFE_Big * mont_r_squared)
+{
+  RMpintFE_Big rr;
+  ruint i;
+
+  r_mpint_fe_big_copy (&rr, mont_r_squared);
+  for (i = 64u * ctx->n_digits; i < 2 * R_MPINT_IFMA_LIMB_BITS * ictx->limbs; i++)
+    r_mpint_fe_big_add (&rr, &rr, &rr, ctx);
+  r_mpint_ifma_from_digits (rr52, 8 * ictx->vecs, rr.d, ctx->n_digits);
+  r_memclear_secure (&rr, sizeof (rr));
+}
+
+/* out := x / R' mod m, canonical. AMM(x, 1) lands in [0, m], so one
+ * masked subtract of m finishes the reduction. Clobbers x. */
+R_MPINT_IFMA_TARGET static void
+r_mpint_ifma_mont_out (RMpintFE_Big * out, ruint64 * x,
+    const RMpintIfmaCtx * ictx, ruint16 n)
+{
+  ruint64 one[R_MPINT_IFMA_MAX_LIMBS], diff[R_MPINT_IFMA_MAX_LIMBS];
+  ruint64 borrow, mask;
+  ruint j, lanes = 8 * ictx->vecs;
+
+  r_memclear (one, sizeof (one));
+  one[0] = 1;
+  r_mpint_ifma_amm (x, x, one, ictx);
+  for (j = 0, borrow = 0; j < lanes; j++) {
+    ruint64 t = x[j] - ictx->m[j] - borrow;
+    diff[j] = t & R_MPINT_IFMA_LIMB_MASK;
+    borrow = t >> 63;
+  }
+  mask = borrow - 1;
+  for (j = 0; j < lanes; j++)
+    x[j] = (x[j] & ~mask) | (diff[j] & mask);
+
+  r_mpint_fe_big_zero (out);
+  r_mpint_ifma_to_digits (out->d, n, x, lanes);
+  r_memclear_secure (diff, sizeof (diff));
+}
+
+rboolean
+r_mpint_fe_big_expmod_ifma (RMpintFE_Big * out, const RMpintFE_Big * base,
+    const rmpint * exp, ruint exp_bits, const RMpintFE_BigMontCtx * ctx,
+    const RMpintFE_Big * mont_r_squared)
+{
+  RMpintIfmaCtx ictx;
+  ruint64 table[R_MPINT_IFMA_WINDOW_SIZE][R_MPINT_IFMA_MAX_LIMBS];
+  ruint64 result[R_MPINT_IFMA_MAX_LIMBS], picked[R_MPINT_IFMA_MAX_LIMBS];
+  ruint64 rr52[R_MPINT_IFMA_MAX_LIMBS];
+  ruint16 n = ctx->n_digits;
+  ruint i, j, w, bits, lanes;
+
+  if (n < R_MPINT_FE_BIG_IFMA_MIN_DIGITS || n > R_MPINT_FE_BIG_MAX_DIGITS ||
+      !r_cpu_has (R_CPU_FEATURE_AVX512IFMA))
+    return FALSE;
+
+  r_mpint_ifma_ctx_init (&ictx, ctx);
+  lanes = 8 * ictx.vecs;
+  r_mpint_ifma_r_squared (rr52, &ictx, ctx, mont_r_squared);
+
+  /* table[0] = 1 * R', table[1] = base * R', table[w] = base^w * R'. */
+  r_memclear (picked, sizeof (picked));
+  picked[0] = 1;
+  r_mpint_ifma_amm (table[0], picked, rr52, &ictx);
+  r_mpint_ifma_from_digits (picked, lanes, base->d, n);
+  r_mpint_ifma_amm (table[1], picked, rr52, &ictx);
+  for (w = 2; w < R_MPINT_IFMA_WINDOW_SIZE; w++)
+    r_mpint_ifma_amm (table[w], table[w - 1], table[1], &ictx);
+
+  r_memcpy (result, table[0], lanes * sizeof (ruint64));
+
+  bits = (exp_bits + (R_MPINT_IFMA_WINDOW_BITS - 1u)) &
+      ~(ruint)(R_MPINT_IFMA_WINDOW_BITS - 1u);
+  for (i = bits; i >= R_MPINT_IFMA_WINDOW_BITS; i -= R_MPINT_IFMA_WINDOW_BITS) {
+    ruint window = 0;
+
+    for (j = 0; j < R_MPINT_IFMA_WINDOW_BITS; j++)
+      r_mpint_ifma_amm (result, result, result, &ictx);
+
+    for (j = R_MPINT_IFMA_WINDOW_BITS; j > 0; j--) {
+      ruint bp = i - (R_MPINT_IFMA_WINDOW_BITS - j + 1);
+      rmpint_digit bit = (r_mpint_get_digit_ct (exp,
+              (ruint32)(bp / (sizeof (rmpint_digit) * 8))) >>
+              (bp % (sizeof (rmpint_digit) * 8))) & 1u;
+      window = (window << 1) | bit;
+    }
+
+    r_mpint_ifma_table_select (picked, &table[0][0], R_MPINT_IFMA_WINDOW_SIZE,
+        R_MPINT_IFMA_MAX_LIMBS, window, ictx.vecs);
+    r_mpint_ifma_amm (result, result, picked, &ictx);
+  }
+
+  r_mpint_ifma_mont_out (out, result, &ictx, n);
+
+  r_memclear_secure (rr52, sizeof (rr52));
+  r_memclear_secure (table, sizeof (table));
+  r_memclear_secure (result, sizeof (result));
+  r_memclear_secure (picked, sizeof (picked));
+  return TRUE;
+}
+
+/* Fixed-base comb on the single-buffer kernel. Entry v of the table is
+ * the product over set bits k of v of base^(2^(k * spacing)), in R'
+ * Montgomery form and spaced r_mpint_fe_big_comb_ifma_stride limbs
+ * apart. */
+
+ruint
+r_mpint_fe_big_comb_ifma_stride (const RMpintFE_BigMontCtx * ctx)
+{
+  ruint16 n = ctx->n_digits;
+
+  if (n < R_MPINT_FE_BIG_IFMA_MIN_DIGITS || n > R_MPINT_FE_BIG_MAX_DIGITS ||
+      !r_cpu_has (R_CPU_FEATURE_AVX512IFMA))
+    return 0;
+  return 8 * ((R_MPINT_IFMA_LIMBS (n) + 7) / 8);
+}
+
+void
+r_mpint_fe_big_comb_ifma_build (ruint64 * table, ruint teeth, ruint spacing,
+    const RMpintFE_Big * base, const RMpintFE_BigMontCtx * ctx,
+    const RMpintFE_Big * mont_r_squared)
+{
+  RMpintIfmaCtx ictx;
+  ruint64 rr52[R_MPINT_IFMA_MAX_LIMBS], g[R_MPINT_IFMA_MAX_LIMBS];
+  rsize stride;
+  ruint i, k, v;
+
+  r_mpint_ifma_ctx_init (&ictx, ctx);
+  stride = 8 * ictx.vecs;
+  r_mpint_ifma_r_squared (rr52, &ictx, ctx, mont_r_squared);
+
+  r_memclear (g, sizeof (g));
+  g[0] = 1;
+  r_mpint_ifma_amm (table, g, rr52, &ictx);
+  r_mpint_ifma_from_digits (g, stride, base->d, ctx->n_digits);
+  r_mpint_ifma_amm (g, g, rr52, &ictx);
+
+  /* g walks base^(2^(k * spacing)); entries [2^k, 2^(k+1)) are the ones
+   * below 2^k times g. */
+  for (k = 0; k < teeth; k++) {
+    if (k > 0) {
+      for (i = 0; i < spacing; i++)
+        r_mpint_ifma_amm (g, g, g, &ictx);
+    }
+    for (v = 1u << k; v < 2u << k; v++)
+      r_mpint_ifma_amm (table + v * stride, table + (v - (1u << k)) * stride,
+          g, &ictx);
+  }
+
+  r_memclear_secure (rr52, sizeof (rr52));
+  r_memclear_secure (g, sizeof (g));
+}
+
+void
+r_mpint_fe_big_comb_ifma_expmod (RMpintFE_Big * out, const ruint64 * table,
+    ruint teeth, ruint spacing, const rmpint * exp,
+    const RMpintFE_BigMontCtx * ctx)
+{
+  RMpintIfmaCtx ictx;
+  ruint64 result[R_MPINT_IFMA_MAX_LIMBS], picked[R_MPINT_IFMA_MAX_LIMBS];
+  rsize stride;
+  ruint i, k, idx;
+
+  r_mpint_ifma_ctx_init (&ictx, ctx);
+  stride = 8 * ictx.vecs;
+  r_memcpy (result, table, stride * sizeof (ruint64));
+
+  for (i = spacing; i-- > 0;) {
+    if (i + 1 < spacing)
+      r_mpint_ifma_amm (result, result, result, &ictx);
+
+    for (k = 0, idx = 0; k < teeth; k++) {
+      ruint bp = k * spacing + i;
+      idx |= (ruint)((r_mpint_get_digit_ct (exp,
+                (ruint32)(bp / (sizeof (rmpint_digit) * 8))) >>
+            (bp % (sizeof (rmpint_digit) * 8))) & 1u) << k;
+    }
+
+    r_mpint_ifma_table_select (picked, table, 1u << teeth, stride, idx,
+        ictx.vecs);
+    r_mpint_ifma_amm (result, result, picked, &ictx);
+  }
+
+  r_mpint_ifma_mont_out (out, result, &ictx, ctx->n_digits);
+
+  r_memclear_secure (result, sizeof (result));
+  r_memclear_secure (picked, sizeof (picked));
+}
+
+/* Multi-buffer variant: eight independent exponentiations, one per
+ * 64-bit lane. Limb j of buffer k lives at x[8 * j + k], so a vector
+ * holds the same limb of every buffer and the schoolbook loop is the
+ * plain per-limb recurrence, with no cross-lane shuffles. Where the
+ * single-buffer kernel is bound by the latency of its scalar y chain,
+ * here each lane's reduction factor comes out of one madd52lo, and the
+ * eight lanes hide each other's latency. */
+
+/* Eight r := a * b / R' mod m, lane by lane, against a shared m. Same
+ * bounds as r_mpint_ifma_amm_n. acc is L vectors of scratch; r may alias
+ * a or b. */
+R_MPINT_IFMA_TARGET static void
+r_mpint_ifma_amm_x8 (ruint64 * r, const ruint64 * a, const ruint64 * b,
+    const RMpintIfmaCtx * ctx, __m512i * acc)
+{
+  const __m512i zero = _mm512_setzero_si512 ();
+  const __m512i mask = _mm512_set1_epi64 ((long long)R_MPINT_IFMA_LIMB_MASK);
+  const __m512i k0 = _mm512_set1_epi64 ((long long)ctx->k0);
+  ruint L = ctx->limbs, i, j;
+  __m512i carry;
+
+  for (j = 0; j < L; j++)
+    acc[j] = zero;
+
+  for (i = 0; i < L; i++) {
+    __m512i bi = _mm512_loadu_si512 (b + 8 * i), y;
+
+    /* y only depends on the low 52 bits of acc[0], which is exactly
+     * what madd52lo reads. */
+    acc[0] = _mm512_madd52lo_epu64 (acc[0], _mm512_loadu_si512 (a), bi);
+    y = _mm512_madd52lo_epu64 (zero, acc[0], k0);
+    acc[0] = _mm512_madd52lo_epu64 (acc[0],
+        _mm512_set1_epi64 ((long long)ctx->m[0]), y);
+    for (j = 1; j < L; j++) {
+      acc[j] = _mm512_madd52lo_epu64 (acc[j],
+          _mm512_loadu_si512 (a + 8 * j), bi);
+      acc[j] = _mm512_madd52lo_epu64 (acc[j],
+          _mm512_set1_epi64 ((long long)ctx->m[j]), y);
+    }
+
+    /* acc[0] is now 0 mod 2^52: shift down one limb, folding in its
+     * carry and the high halves of this step's products. */
+    carry = _mm512_srli_epi64 (acc[0], R_MPINT_IFMA_LIMB_BITS);
+    for (j = 0; j + 1 < L; j++) {
+      acc[j] = _mm512_madd52hi_epu64 (acc[j + 1],
+          _mm512_loadu_si512 (a + 8 * j), bi);
+      acc[j] = _mm512_madd52hi_epu64 (acc[j],
+          _mm512_set1_epi64 ((long long)ctx->m[j]), y);
+    }
+    acc[L - 1] = _mm512_madd52hi_epu64 (zero,
+        _mm512_loadu_si512 (a + 8 * (L - 1)), bi);
+    acc[L - 1] = _mm512_madd52hi_epu64 (acc[L - 1],
+        _mm512_set1_epi64 ((long long)ctx->m[L - 1]), y);
+    acc[0] = _mm512_add_epi64 (acc[0], carry);
+  }
+
+  for (j = 0, carry = zero; j < L; j++) {
+    __m512i t = _mm512_add_epi64 (acc[j], carry);
+    _mm512_storeu_si512 (r + 8 * j, _mm512_and_si512 (t, mask));
+    carry = _mm512_srli_epi64 (t, R_MPINT_IFMA_LIMB_BITS);
+  }
+}
+
+R_MPINT_IFMA_TARGET static void
+r_mpint_ifma_table_select_x8 (ruint64 * dst, const ruint64 * table,
+    ruint idx, ruint L)
+{
+  ruint i, j;
+
+  for (j = 0; j < L; j++)
+    _mm512_storeu_si512 (dst + 8 * j, _mm512_setzero_si512 ());
+
+  for (i = 0; i < R_MPINT_IFMA_WINDOW_SIZE; i++) {
+    ruint64 x = (ruint64)(i ^ idx);
+    __m512i mask = _mm512_set1_epi64 ((long long)
+        (((x | ((ruint64)0 - x)) >> 63) - 1));
+    const ruint64 * e = table + (rsize)i * 8 * L;
+
+    for (j = 0; j < L; j++)
+      _mm512_storeu_si512 (dst + 8 * j,
+          _mm512_or_si512 (_mm512_loadu_si512 (dst + 8 * j),
+            _mm512_and_si512 (_mm512_loadu_si512 (e + 8 * j), mask)));
+  }
+}
+
+/* Final canonical step for all lanes: x < 2m, so subtract m where that
+ * doesn't borrow. */
+R_MPINT_IFMA_TARGET static void
+r_mpint_ifma_reduce_x8 (ruint64 * x, ruint64 * diff, const RMpintIfmaCtx * ctx)
+{
+  const __m512i mask = _mm512_set1_epi64 ((long long)R_MPINT_IFMA_LIMB_MASK);
+  const __m512i one = _mm512_set1_epi64 (1);
+  __m512i borrow = _mm512_setzero_si512 (), keep;
+  ruint j;
+
+  for (j = 0; j < ctx->limbs; j++) {
+    __m512i t = _mm512_sub_epi64 (_mm512_sub_epi64 (
+          _mm512_loadu_si512 (x + 8 * j),
+          _mm512_set1_epi64 ((long long)ctx->m[j])), borrow);
+    _mm512_storeu_si512 (diff + 8 * j, _mm512_and_si512 (t, mask));
+    borrow = _mm512_srli_epi64 (t, 63);
+  }
+
+  /* keep is all-ones in lanes that didn't borrow (x >= m). */
+  keep = _mm512_sub_epi64 (borrow, one);
+  for (j = 0; j < ctx->limbs; j++)
+    _mm512_storeu_si512 (x + 8 * j, _mm512_or_si512 (
+          _mm512_andnot_si512 (keep, _mm512_loadu_si512 (x + 8 * j)),
+          _mm512_and_si512 (keep, _mm512_loadu_si512 (diff + 8 * j))));
+}
+
+rboolean
+r_mpint_fe_big_expmod_ifma_x8 (RMpintFE_Big * out, const RMpintFE_Big * base,
+    rsize count, const rmpint * exp, ruint exp_bits,
+    const RMpintFE_BigMontCtx * ctx, const RMpintFE_Big * mont_r_squared)
+{
+  __m512i acc[R_MPINT_IFMA_MAX_LIMBS];
+  RMpintIfmaCtx ictx;
+  ruint64 limbs[R_MPINT_IFMA_MAX_LIMBS];
+  ruint64 * ws, * table, * result, * picked, * rrx;
+  rsize stride, wsize;
+  ruint16 n = ctx->n_digits;
+  ruint i, j, k, w, bits, L;
+
+  if (count == 0 || count > R_MPINT_FE_BIG_IFMA_LANES ||
+      n < R_MPINT_FE_BIG_IFMA_MIN_DIGITS || n > R_MPINT_FE_BIG_MAX_DIGITS ||
+      !r_cpu_has (R_CPU_FEATURE_AVX512IFMA))
+    return FALSE;
+
+  r_mpint_ifma_ctx_init (&ictx, ctx);
+  L = ictx.limbs;
+  stride = 8 * (rsize)L;
+
+  /* 16 table entries plus result, picked and the broadcast R'^2, each L
+   * limbs in all eight lanes: about 190 KB at the largest width, so it
+   * lives on the heap. */
+  wsize = (R_MPINT_IFMA_WINDOW_SIZE + 3) * stride * sizeof (ruint64);
+  if ((ws = r_malloc (wsize)) == NULL)
+    return FALSE;
+  table = ws;
+  result = table + R_MPINT_IFMA_WINDOW_SIZE * stride;
+  picked = result + stride;
+  rrx = picked + stride;
+
+  r_mpint_ifma_r_squared (limbs, &ictx, ctx, mont_r_squared);
+  for (j = 0; j < L; j++)
+    for (k = 0; k < 8; k++)
+      rrx[8 * j + k] = limbs[j];
+
+  /* table[0] = 1 * R' in every lane, table[1] = base[k] * R' in lane k
+   * (unused lanes run on zero). */
+  r_memclear (picked, stride * sizeof (ruint64));
+  for (k = 0; k < 8; k++)
+    picked[k] = 1;
+  r_mpint_ifma_amm_x8 (table, picked, rrx, &ictx, acc);
+  r_memclear (picked, stride * sizeof (ruint64));
+  for (k = 0; k < count; k++) {
+    r_mpint_ifma_from_digits (limbs, L, base[k].d, n);
+    for (j = 0; j < L; j++)
+      picked[8 * j + k] = limbs[j];
+  }
+  r_mpint_ifma_amm_x8 (table + stride, picked, rrx, &ictx, acc);
+  for (w = 2; w < R_MPINT_IFMA_WINDOW_SIZE; w++)
+    r_mpint_ifma_amm_x8 (table + w * stride, table + (w - 1) * stride,
+        table + stride, &ictx, acc);
+
+  r_memcpy (result, table, stride * sizeof (ruint64));
+
+  bits = (exp_bits + (R_MPINT_IFMA_WINDOW_BITS - 1u)) &
+      ~(ruint)(R_MPINT_IFMA_WINDOW_BITS - 1u);
+  for (i = bits; i >= R_MPINT_IFMA_WINDOW_BITS; i -= R_MPINT_IFMA_WINDOW_BITS) {
+    ruint window = 0;
+
+    for (j = 0; j < R_MPINT_IFMA_WINDOW_BITS; j++)
+      r_mpint_ifma_amm_x8 (result, result, result, &ictx, acc);
+
+    for (j = R_MPINT_IFMA_WINDOW_BITS; j > 0; j--) {
+      ruint bp = i - (R_MPINT_IFMA_WINDOW_BITS - j + 1);
+      rmpint_digit bit = (r_mpint_get_digit_ct (exp,
+              (ruint32)(bp / (sizeof (rmpint_digit) * 8))) >>
+              (bp % (sizeof (rmpint_digit) * 8))) & 1u;
+      window = (window << 1) | bit;
+    }
+
+    r_mpint_ifma_table_select_x8 (picked, table, window, L);
+    r_mpint_ifma_amm_x8 (result, result, picked, &ictx, acc);
+  }
+
+  r_memclear (picked, stride * sizeof (ruint64));
+  for (k = 0; k < 8; k++)
+    picked[k] = 1;
+  r_mpint_ifma_amm_x8 (result, result, picked, &ictx, acc);
+  r_mpint_ifma_reduce_x8 (result, picked, &ictx);
+
+  for (k = 0; k < count; k++) {
+    for (j = 0; j < L; j++)
+      limbs[j] = result[8 * j + k];
+    r_mpint_fe_big_zero (&out[k]);
+    r_mpint_ifma_to_digits (out[k].d, n, limbs, L);
+  }
+
+  r_memclear_secure (ws, wsize);
+  r_free (ws);
+  r_memclear_secure (acc, sizeof (acc));
+  r_memclear_secure (limbs, sizeof (limbs));
+  return TRUE;
+}
+
+#else
+
+rboolean
+r_mpint_fe_big_expmod_ifma (RMpintFE_Big * out, const RMpintFE_Big * base,
+    const rmpint * exp, ruint exp_bits, const RMpintFE_BigMontCtx * ctx,
+    const RMpintFE_Big * mont_r_squared)
+{
+  (void) out;
+  (void) base;
+  (void) exp;
+  (void) exp_bits;
+  (void) ctx;
+  (void) mont_r_squared;
+  return FALSE;
+}
+
+rboolean
+r_mpint_fe_big_expmod_ifma_x8 (RMpintFE_Big * out, const RMpintFE_Big * base,
+    rsize count, const rmpint * exp, ruint exp_bits,
+    const RMpintFE_BigMontCtx * ctx, const RMpintFE_Big * mont_r_squared)
+{
+  (void) out;
+  (void) base;
+  (void) count;
+  (void) exp;
+  (void) exp_bits;
+  (void) ctx;
+  (void) mont_r_squared;
+  return FALSE;
+}
+
+ruint
+r_mpint_fe_big_comb_ifma_stride (const RMpintFE_BigMontCtx * ctx)
+{
+  (void) ctx;
+  return 0;
+}
+
+void
+r_mpint_fe_big_comb_ifma_build (ruint64 * table, ruint teeth, ruint spacing,
+    const RMpintFE_Big * base, const RMpintFE_BigMontCtx * ctx,
+    const RMpintFE_Big * mont_r_squared)
+{
+  (void) table;
+  (void) teeth;
+  (void) spacing;
+  (void) base;
+  (void) ctx;
+  (void) mont_r_squared;
+}
+
+void
+r_mpint_fe_big_comb_ifma_expmod (RMpintFE_Big * out, const ruint64 * table,
+    ruint teeth, ruint spacing, const rmpint * exp,
+    const RMpintFE_BigMontCtx * ctx)
+{
+  (void) out;
+  (void) table;
+  (void) teeth;
+  (void) spacing;
+  (void) exp;
+  (void) ctx;
+}
+
+#endif
@@ -187,11 +187,29 @@ r_string_append_printf (RString * str, const rchar * fmt, ...)
 rsize
 r_string_append_vprintf (RString * str, const rchar * fmt, va_list ap)
 {
-  rchar * cstr = r_strvprintf (fmt, ap);
-  rsize ret = r_string_append (str, cstr);
-  r_free (cstr);
+  va_list copy;
+  int ret;
 
-  return ret;
+  if (R_UNLIKELY (fmt == NULL))
+    return 0;
+
+  /* Format straight into the spare room, growing once if it's short. */
+  va_copy (copy, ap);
+  ret = r_vsnprintf (str->cstr + str->len, str->size - str->len, fmt, copy);
+  va_end (copy);
+  if (ret > 0 && (rsize)ret >= str->size - str->len) {
+    if (R_UNLIKELY (!r_string_ensure_additional_size (str, (rsize)ret)))
+      return 0;
+    ret = r_vsnprintf (str->cstr + str->len, str->size - str->len, fmt, ap);
+  }
+  if (R_UNLIKELY (ret <= 0)) {
+    if (str->cstr != NULL)
+      str->cstr[str->len] = 0;
+    return 0;
+  }
+
+  str->len += (rsize)ret;
+  return (rsize)ret;
 }
 
 rsize
@@ -80,6 +80,23 @@ r_ev_loop_deinit (void)
 {
 }
 
+/* Optional hardware counter sampling, see r_ev_loop_set_perf_sampler */
+typedef struct {
+  ruint32 mask;
+  rsize interval;
+  REvLoopPerfFunc func;
+  rpointer data;
+  RDestroyNotify datanotify;
+
+  RPerfCounters * pc;
+  rboolean attached;
+  ruint thread;           /* r_thread_get_id of the thread pc counts */
+  rsize pending;          /* Iterations since the last sample */
+  RPerfSample last;       /* Running counts at the last sample */
+  RPerfSample total;
+  rsize iterations;       /* Iterations covered by total */
+} REvLoopPerf;
+
 static raptr g__r_ev_loop_default; /* (REvLoop *) */
 static RTss  g__r_ev_loop_tss = R_TSS_INIT (NULL);
 
@@ -126,8 +143,20 @@ struct REvLoop {
 #endif
   RQueue active;
   RQueue chg;
+
+  REvLoopPerf * perf;
 };
 
+static void
+r_ev_loop_perf_free (REvLoopPerf * perf)
+{
+  if (perf->datanotify != NULL)
+    perf->datanotify (perf->data);
+  if (perf->pc != NULL)
+    r_perf_counters_unref (perf->pc);
+  r_free (perf);
+}
+
 static void
 r_ev_loop_free (REvLoop * loop)
 {
@@ -161,6 +190,9 @@ r_ev_loop_free (REvLoop * loop)
     loop->handle = R_IO_HANDLE_INVALID;
   }
 
+  if (loop->perf != NULL)
+    r_ev_loop_perf_free (loop->perf);
+
   r_free (loop);
 }
 
@@ -173,6 +205,7 @@ r_ev_loop_setup (REvLoop * loop, RClock * clock, RTaskQueue * tq)
   r_cbqueue_init (&loop->bcbs);
   r_cbqueue_init (&loop->acbs);
   loop->prepare = loop->idle = NULL;
+  loop->perf = NULL;
   r_queue_init (&loop->active);
   r_queue_init (&loop->chg);
 
@@ -793,6 +826,58 @@ r_ev_loop_outstanding_events (REvLoop * loop)
     r_queue_size (&loop->active);
 }
 
+/* Counters count the thread that opened them; (re)open them on the
+ * thread running the loop and skip whatever ran outside of it. */
+static void
+r_ev_loop_perf_begin (REvLoopPerf * perf)
+{
+  ruint thread = r_thread_get_id (r_thread_current ());
+
+  if (!perf->attached || perf->thread != thread) {
+    if (perf->pc != NULL)
+      r_perf_counters_unref (perf->pc);
+    perf->attached = TRUE;
+    perf->thread = thread;
+    if ((perf->pc = r_perf_counters_new (perf->mask)) != NULL &&
+        !r_perf_counters_start (perf->pc)) {
+      r_perf_counters_unref (perf->pc);
+      perf->pc = NULL;
+    }
+  }
+
+  perf->pending = 0;
+  if (perf->pc != NULL && !r_perf_counters_read (perf->pc, &perf->last))
+    r_memset (&perf->last, 0, sizeof (RPerfSample));
+}
+
+static void
+r_ev_loop_perf_sample (REvLoop * loop, REvLoopPerf * perf, rboolean flush)
+{
+  RPerfSample now, delta;
+  rsize n;
+
+  if (perf->pc == NULL || perf->pending == 0 ||
+      (perf->pending < perf->interval && !flush))
+    return;
+
+  n = perf->pending;
+  perf->pending = 0;
+  if (!r_perf_counters_read (perf->pc, &now))
+    return;
+
+  r_perf_sample_sub (&delta, &now, &perf->last);
+  perf->last = now;
+  if (perf->iterations == 0)
+    perf->total = delta;
+  else
+    r_perf_sample_add (&perf->total, &delta);
+  perf->iterations += n;
+
+  /* Last; the callback is free to replace the sampler */
+  if (perf->func != NULL)
+    perf->func (perf->data, loop, &delta, n);
+}
+
 ruint
 r_ev_loop_run (REvLoop * loop, REvLoopRunMode mode)
 {
@@ -807,6 +892,8 @@ r_ev_loop_run (REvLoop * loop, REvLoopRunMode mode)
   }
 
   r_tss_set (&g__r_ev_loop_tss, loop);
+  if (loop->perf != NULL)
+    r_ev_loop_perf_begin (loop->perf);
   ret = (ruint) r_ev_loop_outstanding_events (loop);
   while (!loop->stop_request && ret != 0 && res >= 0) {
     r_ev_loop_prepare (loop);
@@ -832,11 +919,19 @@ r_ev_loop_run (REvLoop * loop, REvLoopRunMode mode)
 
     r_ev_loop_update_timers (loop);
     loop->iterations++;
+    if (loop->perf != NULL) {
+      if (!loop->perf->attached)
+        r_ev_loop_perf_begin (loop->perf);
+      loop->perf->pending++;
+      r_ev_loop_perf_sample (loop, loop->perf, FALSE);
+    }
 
     ret = (ruint) r_ev_loop_outstanding_events (loop);
     if (mode != R_EV_LOOP_RUN_LOOP)
       break;
   }
+  if (loop->perf != NULL)
+    r_ev_loop_perf_sample (loop, loop->perf, TRUE);
   r_tss_set (&g__r_ev_loop_tss, NULL);
 
   return ret;
@@ -867,6 +962,52 @@ r_ev_loop_get_idle_count (const REvLoop * loop)
   return loop->idle_count;
 }
 
+rboolean
+r_ev_loop_set_perf_sampler (REvLoop * loop, ruint32 mask, rsize interval,
+    REvLoopPerfFunc func, rpointer data, RDestroyNotify datanotify)
+{
+  REvLoopPerf * perf = NULL;
+
+  if (R_UNLIKELY (loop == NULL)) return FALSE;
+
+  if (mask != 0) {
+    if (R_UNLIKELY (interval == 0)) return FALSE;
+    if (R_UNLIKELY ((perf = r_mem_new0 (REvLoopPerf)) == NULL)) return FALSE;
+
+    perf->mask = mask;
+    perf->interval = interval;
+    perf->func = func;
+    perf->data = data;
+    perf->datanotify = datanotify;
+  }
+
+  if (loop->perf != NULL)
+    r_ev_loop_perf_free (loop->perf);
+  loop->perf = perf;
+  return TRUE;
+}
+
+rboolean
+r_ev_loop_get_perf_stats (const REvLoop * loop, RPerfSample * total,
+    rsize * iterations)
+{
+  const REvLoopPerf * perf;
+
+  if (R_UNLIKELY (loop == NULL || total == NULL)) return FALSE;
+  if ((perf = loop->perf) == NULL || (perf->pc == NULL && perf->iterations == 0))
+    return FALSE;
+
+  if (perf->iterations > 0) {
+    *total = perf->total;
+  } else {
+    r_memset (total, 0, sizeof (RPerfSample));
+    total->valid = r_perf_counters_get_mask (perf->pc);
+  }
+  if (iterations != NULL)
+    *iterations = perf->iterations;
+  return TRUE;
+}
+
 ruint
 r_ev_loop_task_group_count (REvLoop * loop)
 {
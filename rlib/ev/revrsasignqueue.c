@@ -0,0 +1,182 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2016-2017 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+
+#include "config.h"
+#include "rev-private.h"
+#include <rlib/ev/revrsasignqueue.h>
+
+#include "../data/rmpint-private.h"
+
+#include <rlib/rmem.h>
+
+/* One r_rsa_priv_key_sign_batch exponentiation run. */
+#define R_RSA_SIGN_QUEUE_BATCH      R_MPINT_FE_BIG_IFMA_LANES
+
+/* Digest bytes a queued request can carry; SHA-512 is the widest. */
+#define R_RSA_SIGN_QUEUE_HASH_MAX   64
+
+typedef struct {
+  RMsgDigestType mdtype;
+  ruint8 hash[R_RSA_SIGN_QUEUE_HASH_MAX];
+  rsize hashsize;
+  RRsaSignDoneFunc done;
+  rpointer data;
+  RDestroyNotify datanotify;
+} RRsaSignQueueEntry;
+
+struct RRsaSignQueue {
+  RRef ref;
+
+  RCryptoKey * key;
+  RPrng * prng;
+  REvLoop * loop;
+
+  rboolean flush_pending;
+  rsize count;
+  RRsaSignQueueEntry entries[R_RSA_SIGN_QUEUE_BATCH];
+};
+
+static void
+r_rsa_sign_queue_complete (RRsaSignQueueEntry * e, RCryptoResult res,
+    const ruint8 * sig, rsize sigsize)
+{
+  e->done (e->data, res, sig, sigsize);
+  if (e->datanotify != NULL)
+    e->datanotify (e->data);
+}
+
+static void
+r_rsa_sign_queue_free (rpointer data)
+{
+  RRsaSignQueue * queue = data;
+  rsize i;
+
+  for (i = 0; i < queue->count; i++)
+    r_rsa_sign_queue_complete (&queue->entries[i], R_CRYPTO_ERROR, NULL, 0);
+
+  r_crypto_key_unref (queue->key);
+  r_prng_unref (queue->prng);
+  r_ev_loop_unref (queue->loop);
+  r_free (queue);
+}
+
+RRsaSignQueue *
+r_rsa_sign_queue_new (RCryptoKey * key, RPrng * prng, REvLoop * loop)
+{
+  RRsaSignQueue * ret;
+
+  if (R_UNLIKELY (key == NULL || loop == NULL)) return NULL;
+  if (R_UNLIKELY (r_crypto_key_get_algo (key) != R_CRYPTO_ALGO_RSA)) return NULL;
+  if (R_UNLIKELY (r_crypto_key_get_type (key) != R_CRYPTO_PRIVATE_KEY)) return NULL;
+
+  if ((ret = r_mem_new0 (RRsaSignQueue)) != NULL) {
+    if (prng != NULL) {
+      ret->prng = r_prng_ref (prng);
+    } else if ((ret->prng = r_rand_prng_new ()) == NULL) {
+      r_free (ret);
+      return NULL;
+    }
+    r_ref_init (ret, r_rsa_sign_queue_free);
+    ret->key = r_crypto_key_ref (key);
+    ret->loop = r_ev_loop_ref (loop);
+  }
+
+  return ret;
+}
+
+static void
+r_rsa_sign_queue_flush_cb (rpointer data, REvLoop * loop)
+{
+  RRsaSignQueue * queue = data;
+  (void) loop;
+
+  queue->flush_pending = FALSE;
+  r_rsa_sign_queue_flush (queue);
+}
+
+rboolean
+r_rsa_sign_queue_push (RRsaSignQueue * queue,
+    RMsgDigestType mdtype, rconstpointer hash, rsize hashsize,
+    RRsaSignDoneFunc done, rpointer data, RDestroyNotify datanotify)
+{
+  RRsaSignQueueEntry * e;
+
+  if (R_UNLIKELY (queue == NULL || hash == NULL || done == NULL)) return FALSE;
+  if (R_UNLIKELY (hashsize == 0 || hashsize > R_RSA_SIGN_QUEUE_HASH_MAX))
+    return FALSE;
+
+  e = &queue->entries[queue->count++];
+  e->mdtype = mdtype;
+  r_memcpy (e->hash, hash, hashsize);
+  e->hashsize = hashsize;
+  e->done = done;
+  e->data = data;
+  e->datanotify = datanotify;
+
+  /* A full batch goes right away; anything less waits for the rest of
+   * this loop iteration's requests. The pending callback holds a ref so
+   * the queue outlives it. */
+  if (queue->count == R_RSA_SIGN_QUEUE_BATCH) {
+    r_rsa_sign_queue_flush (queue);
+  } else if (!queue->flush_pending) {
+    r_rsa_sign_queue_ref (queue);
+    if (!(queue->flush_pending = r_ev_loop_add_callback (queue->loop, FALSE,
+            r_rsa_sign_queue_flush_cb, queue, r_ref_unref)))
+      r_rsa_sign_queue_unref (queue);
+  }
+
+  return TRUE;
+}
+
+rsize
+r_rsa_sign_queue_flush (RRsaSignQueue * queue)
+{
+  RRsaSignQueueEntry entries[R_RSA_SIGN_QUEUE_BATCH];
+  RRsaSignRequest reqs[R_RSA_SIGN_QUEUE_BATCH];
+  rsize i, count, k;
+  ruint8 * sigs;
+
+  if (R_UNLIKELY (queue == NULL) || (count = queue->count) == 0)
+    return 0;
+
+  /* Take the batch off the queue first; done callbacks may push more. */
+  r_memcpy (entries, queue->entries, count * sizeof (RRsaSignQueueEntry));
+  queue->count = 0;
+
+  k = (r_crypto_key_get_bitsize (queue->key) + 7) / 8;
+  sigs = r_alloca (count * k);
+  for (i = 0; i < count; i++) {
+    reqs[i].mdtype = entries[i].mdtype;
+    reqs[i].hash = entries[i].hash;
+    reqs[i].hashsize = entries[i].hashsize;
+    reqs[i].sig = sigs + i * k;
+    reqs[i].sigsize = k;
+    reqs[i].result = R_CRYPTO_ERROR;
+  }
+
+  r_rsa_priv_key_sign_batch (queue->key, queue->prng, reqs, count);
+
+  for (i = 0; i < count; i++) {
+    if (reqs[i].result == R_CRYPTO_OK)
+      r_rsa_sign_queue_complete (&entries[i], R_CRYPTO_OK, reqs[i].sig, reqs[i].sigsize);
+    else
+      r_rsa_sign_queue_complete (&entries[i], reqs[i].result, NULL, 0);
+  }
+
+  return count;
+}
@@ -23,6 +23,7 @@
 #include "../net/rsocket-private.h"
 #include "../net/rnet-private.h"
 #include <rlib/ev/revtcp.h>
+#include <rlib/net/rktls.h>
 
 #include <rlib/rmem.h>
 
@@ -30,6 +31,12 @@
 
 typedef struct {
   RBuffer * buf;
+  rsize offset;                 /* bytes of buf (or the file range) already written */
+  RTLSContentType record;       /* kTLS: non-application_data record, else 0 */
+  RTLSTrafficKeys * keys;       /* kTLS: rekey queued behind earlier records; no buf */
+  RIOHandle file;               /* sendfile: source of a range; no buf / keys */
+  ruint64 fileoffset;
+  rsize filesize;
   REvTCPBufferFunc done;
   rpointer data;
   RDestroyNotify datanotify;
@@ -37,7 +44,12 @@ typedef struct {
 
 #define r_ev_tcp_send_ctx_clear(send)                                         \
   R_STMT_START {                                                              \
-    r_buffer_unref ((send)->buf);                                             \
+    if ((send)->buf != NULL)                                                  \
+      r_buffer_unref ((send)->buf);                                           \
+    if ((send)->keys != NULL) {                                               \
+      r_memclear_secure ((send)->keys, sizeof (RTLSTrafficKeys));             \
+      r_free ((send)->keys);                                                  \
+    }                                                                         \
     if ((send)->datanotify != NULL)                                           \
       (send)->datanotify ((send)->data);                                      \
   } R_STMT_END
@@ -82,6 +94,10 @@ struct REvTCP {
   rpointer send_iocb_ctx;
 
   RQueue qsend;
+  /* Kernel TLS seals what we write (r_ev_tcp_set_ktls_tx). */
+  rboolean ktls_tx;
+  /* Kernel TLS opens what we read; records go here (r_ev_tcp_set_ktls_rx). */
+  REvTCPRecordFunc ktls_rx;
 
   /* Graceful close (r_ev_tcp_close): set while the send queue is draining
    * before the half-close. Once qsend empties (or a send fails) the write
@@ -977,23 +993,36 @@ r_ev_tcp_recv_iocb (REvTCP * evtcp)
 {
   RBuffer * buf;
   RSocketStatus res = R_SOCKET_WOULD_BLOCK;
+  REvTCPRecordFunc record;
+  RTLSContentType type;
   rsize size;
 
   do {
     if (R_UNLIKELY (r_socket_is_closed (evtcp->socket)))
       break;
-    if ((buf = evtcp->alloc (evtcp->recv_data, evtcp)) == NULL) {
+    /* The callback may switch to kernel TLS, so look again every time */
+    if ((record = evtcp->ktls_rx) != NULL)
+      buf = r_buffer_new_alloc (NULL, R_TLS_MAX_PLAINTEXT, NULL);
+    else
+      buf = evtcp->alloc (evtcp->recv_data, evtcp);
+    if (buf == NULL) {
       res = R_SOCKET_OOM;
       break;
     }
 
-    res = r_socket_receive_message (evtcp->socket, NULL, buf, &size);
+    if (record != NULL)
+      res = r_ktls_receive_record (evtcp->socket, &type, buf, &size);
+    else
+      res = r_socket_receive_message (evtcp->socket, NULL, buf, &size);
     switch (res) {
       case R_SOCKET_OK:
         if (size > 0) {
           R_LOG_TRACE ("loop %p evio "R_EV_IO_FORMAT,
               evtcp->evio.loop, R_EV_IO_ARGS (evtcp));
-          evtcp->recv (evtcp->recv_data, buf, evtcp);
+          if (record != NULL)
+            record (evtcp->recv_data, type, buf, evtcp);
+          else
+            evtcp->recv (evtcp->recv_data, buf, evtcp);
         } else {
           R_LOG_DEBUG ("loop %p evio "R_EV_IO_FORMAT" EOS",
               evtcp->evio.loop, R_EV_IO_ARGS (evtcp));
@@ -1035,10 +1064,39 @@ r_ev_tcp_send_iocb (REvTCP * evtcp)
 {
   REvTCPSendCtx * ctx;
   RSocketStatus res = R_SOCKET_OK;
+  RBuffer * rest;
   rsize sent;
 
   while ((ctx = r_queue_peek (&evtcp->qsend)) != NULL) {
-    res = r_socket_send_message (evtcp->socket, NULL, ctx->buf, &sent);
+    sent = 0;
+    if (ctx->keys != NULL) {
+      /* A refused rekey is fatal: what follows must not go out under the
+       * previous keys. */
+      if ((res = r_ktls_set_tx (evtcp->socket, ctx->keys)) == R_SOCKET_NOT_SUPPORTED)
+        res = R_SOCKET_ERROR;
+    } else if (ctx->buf == NULL) {
+      res = r_socket_send_file (evtcp->socket, ctx->file,
+          ctx->fileoffset + ctx->offset, ctx->filesize - ctx->offset, &sent);
+      /* Nothing left to read: the file is shorter than the range queued */
+      if (res == R_SOCKET_OK && sent == 0)
+        res = R_SOCKET_ERROR;
+      else if (res == R_SOCKET_OK && (ctx->offset += sent) < ctx->filesize)
+        res = R_SOCKET_WOULD_BLOCK;
+    } else if ((rest = (ctx->offset == 0) ? r_buffer_ref (ctx->buf) :
+          r_buffer_view (ctx->buf, ctx->offset, -1)) == NULL) {
+      res = R_SOCKET_OOM;
+    } else {
+      if (ctx->record != 0)
+        res = r_ktls_send_record (evtcp->socket, ctx->record, rest, &sent);
+      else
+        res = r_socket_send_message (evtcp->socket, NULL, rest, &sent);
+      r_buffer_unref (rest);
+      /* A stream socket may take only part of the buffer; keep the rest at
+       * the head of the queue and wait for the socket to drain. */
+      if (res == R_SOCKET_OK &&
+          (ctx->offset += sent) < r_buffer_get_size (ctx->buf))
+        res = R_SOCKET_WOULD_BLOCK;
+    }
     R_LOG_TRACE ("loop %p evio "R_EV_IO_FORMAT" res %d sent %"RSIZE_FMT,
         evtcp->evio.loop, R_EV_IO_ARGS (evtcp), res, sent);
     if (res == R_SOCKET_OK) {
@@ -1187,8 +1245,24 @@ r_ev_tcp_set_error_handler (REvTCP * evtcp, REvTCPErrorFunc error,
   evtcp->error_datanotify = datanotify;
 }
 
-rboolean
-r_ev_tcp_send (REvTCP * evtcp, RBuffer * buf,
+static rboolean
+r_ev_tcp_send_push (REvTCP * evtcp, REvTCPSendCtx * ctx)
+{
+  r_queue_push (&evtcp->qsend, ctx);
+  if (r_queue_size (&evtcp->qsend) > 1)
+    return TRUE;
+
+#if defined (R_OS_WIN32) && !defined (R_EV_USE_RPOLL)
+  /* Post the head; subsequent sends drain in order as each completes. */
+  return r_ev_tcp_iocp_post_send (evtcp);
+#else
+  return r_ev_loop_add_callback (evtcp->evio.loop, TRUE,
+      r_ev_tcp_send_iocb_ev, r_ev_tcp_ref (evtcp), r_ev_tcp_unref);
+#endif
+}
+
+static rboolean
+r_ev_tcp_send_full (REvTCP * evtcp, RBuffer * buf, RTLSContentType record,
     REvTCPBufferFunc done, rpointer data, RDestroyNotify datanotify)
 {
   REvTCPSendCtx * ctx;
@@ -1202,29 +1276,28 @@ r_ev_tcp_send (REvTCP * evtcp, RBuffer * buf,
   if ((evtcp->evio.flags & R_EV_IO_CLOSED) || evtcp->closing)
     return FALSE;
 
-  if ((ret = (ctx = r_mem_new (REvTCPSendCtx)) != NULL)) {
+  if ((ret = (ctx = r_mem_new0 (REvTCPSendCtx)) != NULL)) {
     ctx->buf = r_buffer_ref (buf);
+    ctx->record = record;
     ctx->done = done;
     ctx->data = data;
     ctx->datanotify = datanotify;
-    r_queue_push (&evtcp->qsend, ctx);
 
     R_LOG_TRACE ("loop %p evio "R_EV_IO_FORMAT" buf %p",
         evtcp->evio.loop, R_EV_IO_ARGS (evtcp), buf);
-    if (r_queue_size (&evtcp->qsend) == 1) {
-#if defined (R_OS_WIN32) && !defined (R_EV_USE_RPOLL)
-      /* Post the head; subsequent sends drain in order as each completes. */
-      ret = r_ev_tcp_iocp_post_send (evtcp);
-#else
-      ret = r_ev_loop_add_callback (evtcp->evio.loop, TRUE,
-          r_ev_tcp_send_iocb_ev, r_ev_tcp_ref (evtcp), r_ev_tcp_unref);
-#endif
-    }
+    ret = r_ev_tcp_send_push (evtcp, ctx);
   }
 
   return ret;
 }
 
+rboolean
+r_ev_tcp_send (REvTCP * evtcp, RBuffer * buf,
+    REvTCPBufferFunc done, rpointer data, RDestroyNotify datanotify)
+{
+  return r_ev_tcp_send_full (evtcp, buf, 0, done, data, datanotify);
+}
+
 rboolean
 r_ev_tcp_send_take (REvTCP * evtcp, rpointer buffer, rsize size,
     REvTCPBufferFunc done, rpointer data, RDestroyNotify datanotify)
@@ -1259,3 +1332,116 @@ r_ev_tcp_send_dup (REvTCP * evtcp, rconstpointer buffer, rsize size,
   return ret;
 }
 
+rboolean
+r_ev_tcp_send_file (REvTCP * evtcp, RIOHandle file, ruint64 offset,
+    rsize size, REvTCPBufferFunc done, rpointer data, RDestroyNotify datanotify)
+{
+  REvTCPSendCtx * ctx;
+
+  if (R_UNLIKELY (evtcp == NULL || file == R_IO_HANDLE_INVALID)) return FALSE;
+  if (R_UNLIKELY (size == 0)) return FALSE;
+  /* As in r_ev_tcp_send_full: no write side left to send on */
+  if ((evtcp->evio.flags & R_EV_IO_CLOSED) || evtcp->closing)
+    return FALSE;
+
+#if !defined (HAVE_SENDFILE) || (defined (R_OS_WIN32) && !defined (R_EV_USE_RPOLL))
+  (void) ctx;
+  (void) offset;
+  (void) done;
+  (void) data;
+  (void) datanotify;
+  return FALSE;
+#else
+  if ((ctx = r_mem_new0 (REvTCPSendCtx)) == NULL)
+    return FALSE;
+  ctx->file = file;
+  ctx->fileoffset = offset;
+  ctx->filesize = size;
+  ctx->done = done;
+  ctx->data = data;
+  ctx->datanotify = datanotify;
+
+  R_LOG_TRACE ("loop %p evio "R_EV_IO_FORMAT" file %"R_IO_HANDLE_FMT" size %"RSIZE_FMT,
+      evtcp->evio.loop, R_EV_IO_ARGS (evtcp), file, size);
+  return r_ev_tcp_send_push (evtcp, ctx);
+#endif
+}
+
+RSocketStatus
+r_ev_tcp_set_ktls_tx (REvTCP * evtcp, const RTLSTrafficKeys * keys)
+{
+  REvTCPSendCtx * ctx;
+  RSocketStatus res;
+
+  if (R_UNLIKELY (evtcp == NULL || keys == NULL)) return R_SOCKET_INVAL;
+  if ((evtcp->evio.flags & R_EV_IO_CLOSED) || evtcp->closing)
+    return R_SOCKET_INVALID_OP;
+
+#if defined (R_OS_WIN32) && !defined (R_EV_USE_RPOLL)
+  (void) ctx;
+  (void) res;
+  return R_SOCKET_NOT_SUPPORTED;
+#else
+  if (!evtcp->ktls_tx) {
+    /* Records sealed in user space must reach the wire before the kernel
+     * starts sealing, or they would be sealed twice. Flush what the socket
+     * takes now; the caller retries later if some is still queued. */
+    if (r_queue_size (&evtcp->qsend) > 0)
+      r_ev_tcp_send_iocb (evtcp);
+    if (r_queue_size (&evtcp->qsend) > 0)
+      return R_SOCKET_WOULD_BLOCK;
+    if ((res = r_ktls_set_tx (evtcp->socket, keys)) == R_SOCKET_OK)
+      evtcp->ktls_tx = TRUE;
+    return res;
+  }
+
+  /* Rekey: takes effect after everything queued under the current keys. */
+  if (r_queue_size (&evtcp->qsend) == 0)
+    return r_ktls_set_tx (evtcp->socket, keys);
+  if ((ctx = r_mem_new0 (REvTCPSendCtx)) == NULL)
+    return R_SOCKET_OOM;
+  if ((ctx->keys = r_memdup (keys, sizeof (RTLSTrafficKeys))) == NULL) {
+    r_free (ctx);
+    return R_SOCKET_OOM;
+  }
+  r_queue_push (&evtcp->qsend, ctx);
+  return R_SOCKET_OK;
+#endif
+}
+
+RSocketStatus
+r_ev_tcp_set_ktls_rx (REvTCP * evtcp, const RTLSTrafficKeys * keys,
+    REvTCPRecordFunc record)
+{
+  RSocketStatus res;
+
+  if (R_UNLIKELY (evtcp == NULL || keys == NULL || record == NULL))
+    return R_SOCKET_INVAL;
+  if ((evtcp->evio.flags & R_EV_IO_CLOSED) || evtcp->closing)
+    return R_SOCKET_INVALID_OP;
+
+#if defined (R_OS_WIN32) && !defined (R_EV_USE_RPOLL)
+  (void) res;
+  return R_SOCKET_NOT_SUPPORTED;
+#else
+  /* Unlike sending there is nothing queued on our side; whatever the
+   * kernel has not handed us yet is opened under these keys. A rekey is
+   * installed as soon as the KeyUpdate has been read, which is exactly
+   * where the kernel stopped (it refuses to read past a control record). */
+  if ((res = r_ktls_set_rx (evtcp->socket, keys)) == R_SOCKET_OK)
+    evtcp->ktls_rx = record;
+  return res;
+#endif
+}
+
+rboolean
+r_ev_tcp_send_ktls_record (REvTCP * evtcp, RTLSContentType type, RBuffer * buf,
+    REvTCPBufferFunc done, rpointer data, RDestroyNotify datanotify)
+{
+  if (R_UNLIKELY (evtcp == NULL || buf == NULL)) return FALSE;
+  if (R_UNLIKELY (!evtcp->ktls_tx)) return FALSE;
+
+  return r_ev_tcp_send_full (evtcp, buf,
+      type == R_TLS_CONTENT_TYPE_APPLICATION_DATA ? 0 : type,
+      done, data, datanotify);
+}
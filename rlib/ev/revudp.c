@@ -61,6 +61,9 @@ struct REvUDP {
 
   REvUDPBufferAllocFunc alloc;
   REvUDPBufferFunc recv;
+  REvUDPBatchFunc recv_batch;
+  RSocketDatagram * batch;
+  rsize batch_count;
   rpointer recv_data;
   REvUDPErrorFunc error;
   rpointer error_data;
@@ -198,6 +201,29 @@ r_ev_udp_recv_iocb (REvUDP * evudp)
   if (res != R_SOCKET_WOULD_BLOCK && evudp->error != NULL)
     evudp->error (evudp->error_data, evudp, res);
 }
+
+static void
+r_ev_udp_recv_batch_iocb (REvUDP * evudp)
+{
+  RSocketStatus res;
+  rsize count;
+
+  /* The loop is edge-triggered: drain until the socket would block (or the
+   * callback stops receiving). */
+  do {
+    res = r_socket_receive_datagrams (evudp->socket,
+        evudp->batch, evudp->batch_count, &count);
+    if (res == R_SOCKET_OK)
+      evudp->recv_batch (evudp->recv_data, evudp->batch, count, evudp);
+  } while (res == R_SOCKET_OK && evudp->recv_iocb_ctx != NULL);
+
+  if (res != R_SOCKET_OK && res != R_SOCKET_WOULD_BLOCK) {
+    R_LOG_ERROR ("loop %p evio "R_EV_IO_FORMAT" recv res %d",
+        evudp->evio.loop, R_EV_IO_ARGS (evudp), res);
+    if (evudp->error != NULL)
+      evudp->error (evudp->error_data, evudp, res);
+  }
+}
 #endif
 
 static void
@@ -260,7 +286,12 @@ r_ev_udp_iocb (rpointer data, REvIOEvents events, REvIO * evio)
 {
   (void) data;
 
-  if (events & R_EV_IO_READABLE) r_ev_udp_recv_iocb ((REvUDP *)evio);
+  if (events & R_EV_IO_READABLE) {
+    if (((REvUDP *)evio)->recv_batch != NULL)
+      r_ev_udp_recv_batch_iocb ((REvUDP *)evio);
+    else
+      r_ev_udp_recv_iocb ((REvUDP *)evio);
+  }
   if (events & R_EV_IO_WRITABLE) r_ev_udp_send_iocb ((REvUDP *)evio);
   if (events & R_EV_IO_ERROR) r_ev_udp_error_iocb ((REvUDP *)evio);
 }
@@ -532,6 +563,56 @@ r_ev_udp_recv_start (REvUDP * evudp,
 #endif
 }
 
+#if defined (R_OS_WIN32) && !defined (R_EV_USE_RPOLL)
+/* The completion backend has no batched receive: deliver each overlapped
+ * datagram as a batch of one. */
+static void
+r_ev_udp_recv_batch_one (rpointer data, RBuffer * buf, RSocketAddress * addr,
+    REvUDP * evudp)
+{
+  RMemMapInfo info = R_MEM_MAP_INFO_INIT;
+  RSocketDatagram dgram;
+
+  if (r_buffer_map (buf, &info, R_MEM_MAP_READ)) {
+    dgram.address = addr;
+    dgram.data = info.data;
+    dgram.size = dgram.len = info.size;
+    evudp->recv_batch (data, &dgram, 1, evudp);
+    r_buffer_unmap (buf, &info);
+  }
+}
+#endif
+
+rboolean
+r_ev_udp_recv_batch_start (REvUDP * evudp,
+    RSocketDatagram * dgrams, rsize count, REvUDPBatchFunc recv,
+    rpointer data, RDestroyNotify datanotify)
+{
+  if (R_UNLIKELY (recv == NULL)) return FALSE;
+  if (R_UNLIKELY (dgrams == NULL || count == 0)) return FALSE;
+  if (R_UNLIKELY (evudp->recv_iocb_ctx != NULL)) return FALSE;
+
+  evudp->recv_batch = recv;
+  evudp->batch = dgrams;
+  evudp->batch_count = count;
+#if defined (R_OS_WIN32) && !defined (R_EV_USE_RPOLL)
+  if (r_ev_udp_recv_start (evudp, NULL, r_ev_udp_recv_batch_one, data, datanotify))
+    return TRUE;
+#else
+  if ((evudp->recv_iocb_ctx = r_ev_io_start (&evudp->evio, R_EV_IO_READABLE,
+      r_ev_udp_iocb, data, datanotify))) {
+    evudp->recv = NULL;
+    evudp->recv_data = data;
+    return TRUE;
+  }
+#endif
+
+  evudp->recv_batch = NULL;
+  evudp->batch = NULL;
+  evudp->batch_count = 0;
+  return FALSE;
+}
+
 rboolean
 r_ev_udp_recv_stop (REvUDP * evudp)
 {
@@ -547,6 +628,9 @@ r_ev_udp_recv_stop (REvUDP * evudp)
 
   ret = r_ev_io_stop (&evudp->evio, evudp->recv_iocb_ctx);
   evudp->recv_iocb_ctx = NULL;
+  evudp->recv_batch = NULL;
+  evudp->batch = NULL;
+  evudp->batch_count = 0;
 
   return ret;
 #endif
@@ -620,3 +704,42 @@ r_ev_udp_send_take (REvUDP * evudp, rpointer buffer, rsize size,
   return ret;
 }
 
+rboolean
+r_ev_udp_send_batch (REvUDP * evudp, RSocketDatagram * dgrams, rsize count)
+{
+  RBuffer * buf;
+  rsize done = 0;
+  rboolean ret = TRUE;
+#if !defined (R_OS_WIN32) || defined (R_EV_USE_RPOLL)
+  RSocketStatus res;
+  rsize sent;
+
+  /* Straight out while nothing is queued ahead (ordering); what's left
+   * after the socket would block goes through the send queue. */
+  while (done < count && r_queue_size (&evudp->qsend) == 0) {
+    res = r_socket_send_datagrams (evudp->socket, &dgrams[done], count - done, &sent);
+    if (res == R_SOCKET_OK) {
+      done += sent;
+    } else if (res == R_SOCKET_WOULD_BLOCK) {
+      break;
+    } else {
+      R_LOG_ERROR ("loop %p evio "R_EV_IO_FORMAT" send res %d",
+          evudp->evio.loop, R_EV_IO_ARGS (evudp), res);
+      if (evudp->error != NULL)
+        evudp->error (evudp->error_data, evudp, res);
+      done++;
+    }
+  }
+#endif
+
+  for (; done < count && ret; done++) {
+    if ((buf = r_buffer_new_dup (dgrams[done].data, dgrams[done].size)) != NULL) {
+      ret = r_ev_udp_send (evudp, buf, dgrams[done].address, NULL, NULL, NULL);
+      r_buffer_unref (buf);
+    } else {
+      ret = FALSE;
+    }
+  }
+
+  return ret;
+}
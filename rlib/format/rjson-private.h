@@ -23,15 +23,25 @@
 #endif
 
 #include <rlib/format/rjson.h>
+#include <rlib/format/rjsonparser.h>
+#include <rlib/format/rjsontape.h>
 
+#include <rlib/concurrency/ratomic.h>
+#include <rlib/data/rhashtable.h>
 #include <rlib/data/rkvptrarray.h>
 #include <rlib/data/rptrarray.h>
+#include <rlib/rmemfile.h>
 
 R_BEGIN_DECLS
 
+/* Objects with at least this many fields get a key -> index hash table
+ * on their first lookup by name. */
+#define R_JSON_OBJECT_INDEX_MIN_FIELDS    16
+
 struct RJsonObject {
   RJsonValue value;
   RKVPtrArray array;
+  raptr index;        /* RHashTable *, built lazily; values are idx + 1 */
 };
 
 struct RJsonArray  {
@@ -62,6 +72,45 @@ struct RJsonNull {
   RJsonValue value;
 };
 
+struct RJsonParser {
+  RRef ref;
+
+  RMemMapInfo info;
+
+  RBuffer * buf;
+  RMemFile * file;
+};
+
+/* Unescape @size bytes of a JSON string body into @dst (room for @size + 1
+ * bytes), NUL-terminating it; the unescaped length is stored in @dstsize. */
+R_API_HIDDEN RJsonResult r_json_str_unescape (rchar * dst, const rchar * src,
+    rssize size, rsize * dstsize);
+
+/* Stage 1 structural index: byte offsets of every structural character
+ * ({}[]:,), of both quotes of every string and of the first byte of
+ * every other scalar, in document order. Offsets are 32 bit, so the
+ * input must be shorter than 4 GiB. */
+typedef struct {
+  ruint32 * pos;
+  rsize count;
+} RJsonIndex;
+
+/* R_JSON_STRING_NOT_TERMINATED when the input ends inside a string. */
+R_API_HIDDEN RJsonResult r_json_index_build (RJsonIndex * index,
+    const rchar * src, rsize size);
+R_API_HIDDEN void r_json_index_clear (RJsonIndex * index);
+
+/* r_json_tape_parse_buffer over @size bytes (-1: to the end) at @offset
+ * of @buf. A range within one segment is parsed in place. */
+R_API_HIDDEN RJsonTape * r_json_tape_parse_buffer_range (RBuffer * buf,
+    rsize offset, rssize size, RJsonResult * res);
+
+/* Length of the leading run of @src that goes into a JSON string as is:
+ * no quote, backslash or control character and, with @ascii, nothing
+ * from 0x80 up either. */
+R_API_HIDDEN rsize r_json_str_escape_safe_len (const rchar * src, rsize size,
+    rboolean ascii);
+
 R_END_DECLS
 
 #endif /* __R_JSON_PRIV_H__ */
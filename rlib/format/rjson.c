@@ -27,7 +27,16 @@
 
 #include <math.h>
 
-static RJsonResult
+static runichar2
+r_json_str_unescape_u16 (const rchar * hex)
+{
+  return ((r_ascii_xdigit_value (hex[0]) & 0xf) << 12) |
+    ((r_ascii_xdigit_value (hex[1]) & 0xf) << 8) |
+    ((r_ascii_xdigit_value (hex[2]) & 0xf) << 4) |
+     (r_ascii_xdigit_value (hex[3]) & 0xf);
+}
+
+RJsonResult
 r_json_str_unescape (rchar * dst, const rchar * src, rssize size, rsize * dstsize)
 {
   const rchar * end, * ptr, * last, * next;
@@ -72,16 +81,24 @@ r_json_str_unescape (rchar * dst, const rchar * src, rssize size, rsize * dstsiz
         if (next + 4 <= end &&
             r_ascii_isxdigit (next[0]) && r_ascii_isxdigit (next[1]) &&
             r_ascii_isxdigit (next[2]) && r_ascii_isxdigit (next[3])) {
-          rsize s;
-          runichar2 uc2 = ((r_ascii_xdigit_value (next[0]) & 0xf) << 12) |
-            ((r_ascii_xdigit_value (next[1]) & 0xf) << 8) |
-            ((r_ascii_xdigit_value (next[2]) & 0xf) << 4) |
-             (r_ascii_xdigit_value (next[3]) & 0xf);
+          rsize s, n = 1;
+          runichar2 uc2[2];
+
+          uc2[0] = r_json_str_unescape_u16 (next);
+          /* Outside the BMP: a surrogate pair, as two escapes */
+          if (uc2[0] >= 0xd800 && uc2[0] < 0xdc00 && next + 10 <= end &&
+              next[4] == '\\' && next[5] == 'u' &&
+              r_ascii_isxdigit (next[6]) && r_ascii_isxdigit (next[7]) &&
+              r_ascii_isxdigit (next[8]) && r_ascii_isxdigit (next[9])) {
+            uc2[1] = r_json_str_unescape_u16 (next + 6);
+            n = 2;
+          }
 
-          if (r_utf16_to_utf8 (dstptr, 6, &uc2, 1, &s, NULL) != R_UNICODE_OK)
+          if (r_utf16_to_utf8 (dstptr, 6, uc2, n, &s, NULL) != R_UNICODE_OK)
             return R_JSON_FAILED_TO_UNESCAPE_STRING;
 
           dstptr += s;
+          next += (n - 1) * 6;
         } else {
           return R_JSON_FAILED_TO_UNESCAPE_STRING;
         }
@@ -118,6 +135,14 @@ r_json_str_escape (RString * dst, const rchar * src, rssize size)
     size = r_strlen (src);
 
   for (i = 0; i < size && src[i] != 0; i++) {
+    rsize run = r_json_str_escape_safe_len (src + i, (rsize)(size - i), TRUE);
+
+    if (run > 0) {
+      r_string_append_len (dst, src + i, run);
+      if ((i += (rssize)run) >= size || src[i] == 0)
+        break;
+    }
+
     switch (src[i]) {
       case '\"': r_string_append (dst, "\\\"");   break;
       case '\\': r_string_append (dst, "\\\\");   break;
@@ -483,10 +508,67 @@ r_json_value_equal (rconstpointer a, rconstpointer b)
 static void
 r_json_object_free (RJsonObject * object)
 {
+  RHashTable * index;
+
+  if ((index = r_atomic_ptr_load (&object->index)) != NULL)
+    r_hash_table_unref (index);
   r_kv_ptr_array_clear (&object->array);
   r_free (object);
 }
 
+static rsize
+r_json_object_key_hash (rconstpointer key)
+{
+  const RJsonString * str = key;
+  return r_str_hash_sized (str->v, (rssize) str->len);
+}
+
+static rboolean
+r_json_object_key_equal (rconstpointer a, rconstpointer b)
+{
+  const RJsonString * sa = a, * sb = b;
+  return sa->len == sb->len && r_memcmp (sa->v, sb->v, sa->len) == 0;
+}
+
+/* Add field @idx unless its key is already there, so the first of
+ * duplicate keys wins just like the linear search. */
+static void
+r_json_object_index_add (RHashTable * index, RJsonObject * object, rsize idx)
+{
+  rpointer key = r_kv_ptr_array_get_key (&object->array, idx);
+
+  if (r_hash_table_contains (index, key) == R_HASH_TABLE_NOT_FOUND)
+    r_hash_table_insert (index, key, RSIZE_TO_POINTER (idx + 1));
+}
+
+/* The object's index, built on first use. Concurrent readers may each
+ * build one; the first to publish wins. */
+static RHashTable *
+r_json_object_get_index (RJsonObject * object)
+{
+  RHashTable * ret;
+  rpointer old = NULL;
+  rsize i, count;
+
+  if ((ret = r_atomic_ptr_load (&object->index)) != NULL)
+    return ret;
+
+  count = r_kv_ptr_array_size (&object->array);
+  if (count < R_JSON_OBJECT_INDEX_MIN_FIELDS)
+    return NULL;
+  if ((ret = r_hash_table_new (r_json_object_key_hash, r_json_object_key_equal)) == NULL)
+    return NULL;
+  for (i = 0; i < count; i++)
+    r_json_object_index_add (ret, object, i);
+
+  if (!r_atomic_ptr_cmp_xchg_strong (&object->index, &old, ret)) {
+    r_hash_table_unref (ret);
+    ret = old;
+  }
+
+  return ret;
+}
+
 RJsonValue *
 r_json_object_new (void)
 {
@@ -619,6 +701,7 @@ RJsonResult
 r_json_object_add_field (RJsonValue * obj, RJsonValue * key, RJsonValue * value)
 {
   RJsonObject * o = (RJsonObject *)obj;
+  RHashTable * index;
 
   if (R_UNLIKELY (obj == NULL || key == NULL || value == NULL))
     return R_JSON_INVAL;
@@ -627,6 +710,8 @@ r_json_object_add_field (RJsonValue * obj, RJsonValue * key, RJsonValue * value)
 
   r_kv_ptr_array_add (&o->array, r_json_value_ref (key), r_json_value_unref,
       r_json_value_ref (value), r_json_value_unref);
+  if ((index = r_atomic_ptr_load (&o->index)) != NULL)
+    r_json_object_index_add (index, o, r_kv_ptr_array_size (&o->array) - 1);
   return R_JSON_OK;
 }
 
@@ -691,15 +776,25 @@ r_json_value_get_object_field (RJsonValue * value, const rchar * key)
 {
   RJsonValue * ret = NULL;
 
-  if (value != NULL && value->type == R_JSON_TYPE_OBJECT) {
+  if (value != NULL && value->type == R_JSON_TYPE_OBJECT && key != NULL) {
     RJsonObject * object = (RJsonObject *) value;
-    RJsonValue * cmp = r_json_string_new_static_unescaped (key);
+    RHashTable * index;
+    RJsonString cmp;
+    rsize idx;
 
-    if ((ret = r_kv_ptr_array_get_val (&object->array,
-            r_kv_ptr_array_find (&object->array, cmp))) != NULL) {
+    /* Only used for comparing, never referenced. */
+    r_memclear (&cmp, sizeof (cmp));
+    cmp.value.type = R_JSON_TYPE_STRING;
+    cmp.v = key;
+    cmp.len = r_strlen (key);
+
+    if ((index = r_json_object_get_index (object)) != NULL)
+      idx = RPOINTER_TO_SIZE (r_hash_table_lookup (index, &cmp)) - 1;
+    else
+      idx = r_kv_ptr_array_find (&object->array, &cmp);
+
+    if ((ret = r_kv_ptr_array_get_val (&object->array, idx)) != NULL)
       r_json_value_ref (ret);
-    }
-    r_json_value_unref (cmp);
   }
 
   return ret;
@@ -0,0 +1,316 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2018 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+
+#include "config.h"
+#include "rjson-private.h"
+
+#include <rlib/rcpufeatures.h>
+#include <rlib/rmem.h>
+
+#if defined(HAVE_IMMINTRIN_H) && (defined(__GNUC__) || defined(__clang__))
+# include <immintrin.h>
+# define R_JSON_INDEX_AVX2
+# define R_JSON_INDEX_AVX2_TARGET __attribute__((target("avx2")))
+#elif defined(HAVE_ARM_NEON_H) && defined(__aarch64__)
+# include <arm_neon.h>
+# define R_JSON_INDEX_NEON
+#endif
+
+/* Stage 1 works on 64 byte blocks, one bit per byte. A classifier turns
+ * a block into character class masks; everything after that is plain
+ * 64 bit arithmetic shared by all classifiers (the approach of
+ * Langdale & Lemire, "Parsing Gigabytes of JSON per Second"). */
+#define R_JSON_INDEX_BLOCK      64
+
+typedef struct {
+  ruint64 bs;       /* '\\' */
+  ruint64 quote;    /* '"' */
+  ruint64 op;       /* { } [ ] : , */
+  ruint64 ws;       /* space, \t, \n, \r */
+} RJsonIndexBlock;
+
+typedef void (*RJsonIndexClassify) (const ruint8 * ptr, RJsonIndexBlock * blk);
+
+#define R_JSON_CLASS_WS     0x01
+#define R_JSON_CLASS_OP     0x02
+#define R_JSON_CLASS_QUOTE  0x04
+#define R_JSON_CLASS_BS     0x08
+
+static const ruint8 r_json_index_class[256] = {
+  ['\t'] = R_JSON_CLASS_WS, ['\n'] = R_JSON_CLASS_WS,
+  ['\r'] = R_JSON_CLASS_WS, [' '] = R_JSON_CLASS_WS,
+  ['{'] = R_JSON_CLASS_OP, ['}'] = R_JSON_CLASS_OP,
+  ['['] = R_JSON_CLASS_OP, [']'] = R_JSON_CLASS_OP,
+  [':'] = R_JSON_CLASS_OP, [','] = R_JSON_CLASS_OP,
+  ['"'] = R_JSON_CLASS_QUOTE, ['\\'] = R_JSON_CLASS_BS,
+};
+
+static void
+r_json_index_classify_scalar (const ruint8 * ptr, RJsonIndexBlock * blk)
+{
+  ruint64 bs = 0, quote = 0, op = 0, ws = 0;
+  ruint i;
+
+  for (i = 0; i < R_JSON_INDEX_BLOCK; i++) {
+    ruint8 c = r_json_index_class[ptr[i]];
+    ws    |= (ruint64) (c & R_JSON_CLASS_WS) << i;
+    op    |= (ruint64) ((c & R_JSON_CLASS_OP) >> 1) << i;
+    quote |= (ruint64) ((c & R_JSON_CLASS_QUOTE) >> 2) << i;
+    bs    |= (ruint64) ((c & R_JSON_CLASS_BS) >> 3) << i;
+  }
+
+  blk->bs = bs;
+  blk->quote = quote;
+  blk->op = op;
+  blk->ws = ws;
+}
+
+#ifdef R_JSON_INDEX_AVX2
+R_JSON_INDEX_AVX2_TARGET
+static inline ruint64
+r_json_index_avx2_mask (__m256i lo, __m256i hi)
+{
+  return (ruint64) (ruint32) _mm256_movemask_epi8 (lo) |
+    ((ruint64) (ruint32) _mm256_movemask_epi8 (hi) << 32);
+}
+
+R_JSON_INDEX_AVX2_TARGET
+static void
+r_json_index_classify_avx2 (const ruint8 * ptr, RJsonIndexBlock * blk)
+{
+  const __m256i lo = _mm256_loadu_si256 ((const __m256i *) ptr);
+  const __m256i hi = _mm256_loadu_si256 ((const __m256i *) (ptr + 32));
+  /* '[' | 0x20 == '{' and ']' | 0x20 == '}' */
+  const __m256i lo20 = _mm256_or_si256 (lo, _mm256_set1_epi8 (0x20));
+  const __m256i hi20 = _mm256_or_si256 (hi, _mm256_set1_epi8 (0x20));
+#define R_JSON_EQ(v, c) _mm256_cmpeq_epi8 ((v), _mm256_set1_epi8 (c))
+
+  blk->bs = r_json_index_avx2_mask (R_JSON_EQ (lo, '\\'), R_JSON_EQ (hi, '\\'));
+  blk->quote = r_json_index_avx2_mask (R_JSON_EQ (lo, '"'), R_JSON_EQ (hi, '"'));
+  blk->op = r_json_index_avx2_mask (
+      _mm256_or_si256 (
+        _mm256_or_si256 (R_JSON_EQ (lo20, '{'), R_JSON_EQ (lo20, '}')),
+        _mm256_or_si256 (R_JSON_EQ (lo, ':'), R_JSON_EQ (lo, ','))),
+      _mm256_or_si256 (
+        _mm256_or_si256 (R_JSON_EQ (hi20, '{'), R_JSON_EQ (hi20, '}')),
+        _mm256_or_si256 (R_JSON_EQ (hi, ':'), R_JSON_EQ (hi, ','))));
+  blk->ws = r_json_index_avx2_mask (
+      _mm256_or_si256 (
+        _mm256_or_si256 (R_JSON_EQ (lo, ' '), R_JSON_EQ (lo, '\t')),
+        _mm256_or_si256 (R_JSON_EQ (lo, '\n'), R_JSON_EQ (lo, '\r'))),
+      _mm256_or_si256 (
+        _mm256_or_si256 (R_JSON_EQ (hi, ' '), R_JSON_EQ (hi, '\t')),
+        _mm256_or_si256 (R_JSON_EQ (hi, '\n'), R_JSON_EQ (hi, '\r'))));
+#undef R_JSON_EQ
+}
+#endif
+
+#ifdef R_JSON_INDEX_NEON
+static inline ruint64
+r_json_index_neon_mask (uint8x16_t m0, uint8x16_t m1, uint8x16_t m2, uint8x16_t m3)
+{
+  static const ruint8 bits[16] = {
+    0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+    0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+  };
+  const uint8x16_t b = vld1q_u8 (bits);
+  uint8x16_t s0 = vpaddq_u8 (vandq_u8 (m0, b), vandq_u8 (m1, b));
+  uint8x16_t s1 = vpaddq_u8 (vandq_u8 (m2, b), vandq_u8 (m3, b));
+
+  s0 = vpaddq_u8 (s0, s1);
+  s0 = vpaddq_u8 (s0, s0);
+  return vgetq_lane_u64 (vreinterpretq_u64_u8 (s0), 0);
+}
+
+static void
+r_json_index_classify_neon (const ruint8 * ptr, RJsonIndexBlock * blk)
+{
+  uint8x16_t v[4], bs[4], quote[4], op[4], ws[4];
+  ruint i;
+
+  for (i = 0; i < 4; i++) {
+    uint8x16_t v20;
+    v[i] = vld1q_u8 (ptr + 16 * i);
+    /* '[' | 0x20 == '{' and ']' | 0x20 == '}' */
+    v20 = vorrq_u8 (v[i], vdupq_n_u8 (0x20));
+    bs[i] = vceqq_u8 (v[i], vdupq_n_u8 ('\\'));
+    quote[i] = vceqq_u8 (v[i], vdupq_n_u8 ('"'));
+    op[i] = vorrq_u8 (
+        vorrq_u8 (vceqq_u8 (v20, vdupq_n_u8 ('{')), vceqq_u8 (v20, vdupq_n_u8 ('}'))),
+        vorrq_u8 (vceqq_u8 (v[i], vdupq_n_u8 (':')), vceqq_u8 (v[i], vdupq_n_u8 (','))));
+    ws[i] = vorrq_u8 (
+        vorrq_u8 (vceqq_u8 (v[i], vdupq_n_u8 (' ')), vceqq_u8 (v[i], vdupq_n_u8 ('\t'))),
+        vorrq_u8 (vceqq_u8 (v[i], vdupq_n_u8 ('\n')), vceqq_u8 (v[i], vdupq_n_u8 ('\r'))));
+  }
+
+  blk->bs = r_json_index_neon_mask (bs[0], bs[1], bs[2], bs[3]);
+  blk->quote = r_json_index_neon_mask (quote[0], quote[1], quote[2], quote[3]);
+  blk->op = r_json_index_neon_mask (op[0], op[1], op[2], op[3]);
+  blk->ws = r_json_index_neon_mask (ws[0], ws[1], ws[2], ws[3]);
+}
+#endif
+
+static RJsonIndexClassify
+r_json_index_classifier (void)
+{
+#if defined(R_JSON_INDEX_AVX2)
+  if (r_cpu_has (R_CPU_FEATURE_AVX2))
+    return r_json_index_classify_avx2;
+#elif defined(R_JSON_INDEX_NEON)
+  if (r_cpu_has (R_CPU_FEATURE_ARM_NEON))
+    return r_json_index_classify_neon;
+#endif
+  return r_json_index_classify_scalar;
+}
+
+/* Each bit becomes the XOR of itself and all lower bits: with @x the
+ * unescaped quotes, a set bit means "inside a string" (opening quote
+ * included, closing quote excluded). */
+static inline ruint64
+r_json_index_prefix_xor (ruint64 x)
+{
+  x ^= x << 1;
+  x ^= x << 2;
+  x ^= x << 4;
+  x ^= x << 8;
+  x ^= x << 16;
+  x ^= x << 32;
+  return x;
+}
+
+typedef struct {
+  ruint64 escaped;    /* first byte of the next block is escaped */
+  ruint64 in_string;  /* all ones when the next block starts inside a string */
+  ruint64 scalar;     /* last byte of the block was part of a scalar */
+} RJsonIndexCarry;
+
+/* Bytes preceded by an odd-length run of backslashes. */
+static inline ruint64
+r_json_index_escaped (ruint64 bs, RJsonIndexCarry * carry)
+{
+  const ruint64 even = RUINT64_CONSTANT (0x5555555555555555);
+  ruint64 follows, odd_starts, seq, invert;
+
+  bs &= ~carry->escaped;
+  follows = (bs << 1) | carry->escaped;
+  odd_starts = bs & ~even & ~follows;
+  seq = odd_starts + bs;
+  carry->escaped = seq < bs;
+  invert = seq << 1;
+  return (even ^ invert) & follows;
+}
+
+static inline ruint64
+r_json_index_structurals (const RJsonIndexBlock * blk, RJsonIndexCarry * carry)
+{
+  ruint64 quote, in_string, scalar, scalar_start;
+
+  quote = blk->quote & ~r_json_index_escaped (blk->bs, carry);
+  in_string = r_json_index_prefix_xor (quote) ^ carry->in_string;
+  carry->in_string = (ruint64) ((rint64) in_string >> 63);
+
+  scalar = ~(blk->op | blk->ws | quote);
+  scalar_start = scalar & ~((scalar << 1) | carry->scalar);
+  carry->scalar = scalar >> 63;
+
+  return ((blk->op | scalar_start) & ~in_string) | quote;
+}
+
+static inline rboolean
+r_json_index_reserve (RJsonIndex * index, rsize * alloc, rsize n)
+{
+  if (R_UNLIKELY (index->count + n > *alloc)) {
+    rsize size = MAX (*alloc * 2, index->count + n);
+    ruint32 * pos;
+
+    if ((pos = r_realloc (index->pos, size * sizeof (ruint32))) == NULL)
+      return FALSE;
+    index->pos = pos;
+    *alloc = size;
+  }
+  return TRUE;
+}
+
+static inline void
+r_json_index_flatten (RJsonIndex * index, ruint32 base, ruint64 bits)
+{
+  ruint32 * pos = index->pos + index->count;
+
+  index->count += RUINT64_POPCOUNT (bits);
+  while (bits != 0) {
+    *pos++ = base + RUINT64_CTZ (bits);
+    bits &= bits - 1;
+  }
+}
+
+RJsonResult
+r_json_index_build (RJsonIndex * index, const rchar * src, rsize size)
+{
+  RJsonIndexClassify classify = r_json_index_classifier ();
+  RJsonIndexCarry carry = { 0, 0, 0 };
+  RJsonIndexBlock blk;
+  const ruint8 * ptr = (const ruint8 *) src;
+  rsize off, alloc = 0;
+
+  index->pos = NULL;
+  index->count = 0;
+  if (R_UNLIKELY (size > RUINT32_MAX))
+    return R_JSON_OUT_OF_RANGE;
+
+  /* Typical documents have a structural every 4-8 bytes. */
+  if (!r_json_index_reserve (index, &alloc, size / 4 + R_JSON_INDEX_BLOCK))
+    return R_JSON_OOM;
+
+  for (off = 0; off + R_JSON_INDEX_BLOCK <= size; off += R_JSON_INDEX_BLOCK) {
+    if (!r_json_index_reserve (index, &alloc, R_JSON_INDEX_BLOCK))
+      goto oom;
+    classify (ptr + off, &blk);
+    r_json_index_flatten (index, (ruint32) off, r_json_index_structurals (&blk, &carry));
+  }
+
+  if (off < size) {
+    /* Pad the tail with whitespace, which never adds a structural. */
+    ruint8 tail[R_JSON_INDEX_BLOCK];
+    r_memset (tail, ' ', sizeof (tail));
+    r_memcpy (tail, ptr + off, size - off);
+
+    if (!r_json_index_reserve (index, &alloc, R_JSON_INDEX_BLOCK))
+      goto oom;
+    classify (tail, &blk);
+    r_json_index_flatten (index, (ruint32) off, r_json_index_structurals (&blk, &carry));
+  }
+
+  if (carry.in_string != 0) {
+    r_json_index_clear (index);
+    return R_JSON_STRING_NOT_TERMINATED;
+  }
+
+  return R_JSON_OK;
+
+oom:
+  r_json_index_clear (index);
+  return R_JSON_OOM;
+}
+
+void
+r_json_index_clear (RJsonIndex * index)
+{
+  r_free (index->pos);
+  index->pos = NULL;
+  index->count = 0;
+}
@@ -25,15 +25,6 @@
 #include <rlib/rmem.h>
 #include <rlib/rmemfile.h>
 
-struct RJsonParser {
-  RRef ref;
-
-  RMemMapInfo info;
-
-  RBuffer * buf;
-  RMemFile * file;
-};
-
 static void
 r_json_parser_free (RJsonParser * parser)
 {
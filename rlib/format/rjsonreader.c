@@ -0,0 +1,314 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2018 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+
+#include "config.h"
+#include "rjson-private.h"
+#include <rlib/format/rjsonreader.h>
+
+#include <rlib/rmem.h>
+
+struct RJsonReader {
+  RRef ref;
+
+  RJsonReaderFunc func;
+  rpointer data;
+  RDestroyNotify notify;
+
+  rsize maxrec;
+  ruint64 records;
+
+  /* Record boundary scanner, carried across chunks. */
+  rsize depth;
+  rboolean inrec;
+  rboolean instr;
+  rboolean esc;
+  rboolean inscalar;
+  rboolean skipping;
+
+  /* Head of the current record from earlier chunks. */
+  rchar * pend;
+  rsize pendsize, pendalloc;
+};
+
+static void
+r_json_reader_free (RJsonReader * reader)
+{
+  if (reader->notify != NULL)
+    reader->notify (reader->data);
+  r_free (reader->pend);
+  r_free (reader);
+}
+
+RJsonReader *
+r_json_reader_new (RJsonReaderFunc func, rpointer data, RDestroyNotify notify)
+{
+  RJsonReader * ret;
+
+  if (R_UNLIKELY (func == NULL))
+    return NULL;
+
+  if ((ret = r_mem_new0 (RJsonReader)) != NULL) {
+    r_ref_init (ret, r_json_reader_free);
+    ret->func = func;
+    ret->data = data;
+    ret->notify = notify;
+    ret->maxrec = R_JSON_READER_DEFAULT_MAX_RECORD_SIZE;
+  }
+
+  return ret;
+}
+
+void
+r_json_reader_set_max_record_size (RJsonReader * reader, rsize size)
+{
+  reader->maxrec = size > 0 ? size : RSIZE_MAX;
+}
+
+ruint64
+r_json_reader_get_record_count (const RJsonReader * reader)
+{
+  return reader->records;
+}
+
+rsize
+r_json_reader_get_pending_size (const RJsonReader * reader)
+{
+  return reader->pendsize;
+}
+
+static void
+r_json_reader_reset_record (RJsonReader * reader)
+{
+  reader->depth = 0;
+  reader->inrec = reader->instr = reader->esc = FALSE;
+  reader->inscalar = reader->skipping = FALSE;
+  r_free (reader->pend);
+  reader->pend = NULL;
+  reader->pendsize = reader->pendalloc = 0;
+}
+
+static void
+r_json_reader_emit (RJsonReader * reader, RJsonTape * tape, RJsonResult res)
+{
+  reader->records++;
+  reader->func (reader->data, tape, res, reader);
+  if (tape != NULL)
+    r_json_tape_unref (tape);
+}
+
+static rboolean
+r_json_reader_append (RJsonReader * reader, const ruint8 * data, rsize size)
+{
+  if (reader->pendsize + size > reader->pendalloc) {
+    rsize alloc = MAX (reader->pendalloc * 2, reader->pendsize + size);
+    rchar * pend;
+
+    if ((pend = r_realloc (reader->pend, alloc)) == NULL)
+      return FALSE;
+    reader->pend = pend;
+    reader->pendalloc = alloc;
+  }
+
+  r_memcpy (reader->pend + reader->pendsize, data, size);
+  reader->pendsize += size;
+  return TRUE;
+}
+
+/* The record ends after @size bytes at @offset of @buf. */
+static RJsonResult
+r_json_reader_finish_record (RJsonReader * reader, RBuffer * buf,
+    const ruint8 * data, rsize offset, rsize size)
+{
+  RJsonTape * tape = NULL;
+  RJsonResult res;
+
+  if (reader->skipping) {
+    /* Already reported when it outgrew the limit. */
+    r_json_reader_reset_record (reader);
+    return R_JSON_OK;
+  }
+
+  if (reader->pendsize + size > reader->maxrec) {
+    res = R_JSON_OUT_OF_RANGE;
+  } else if (reader->pendsize == 0) {
+    tape = r_json_tape_parse_buffer_range (buf, offset, (rssize) size, &res);
+  } else {
+    RBuffer * rec;
+
+    if (!r_json_reader_append (reader, data + offset, size))
+      return R_JSON_OOM;
+    /* The tape takes over the accumulated bytes. */
+    rec = r_buffer_new_wrapped (R_MEM_FLAG_NONE, reader->pend, reader->pendalloc,
+        reader->pendsize, 0, reader->pend, r_free);
+    reader->pend = NULL;
+    reader->pendsize = reader->pendalloc = 0;
+    if (rec == NULL)
+      return R_JSON_OOM;
+    tape = r_json_tape_parse_buffer (rec, &res);
+    r_buffer_unref (rec);
+  }
+
+  r_json_reader_reset_record (reader);
+  r_json_reader_emit (reader, tape, res);
+  return R_JSON_OK;
+}
+
+RJsonResult
+r_json_reader_push_buffer (RJsonReader * reader, RBuffer * buf)
+{
+  RMemMapInfo info = R_MEM_MAP_INFO_INIT;
+  const ruint8 * data;
+  RJsonResult ret = R_JSON_OK;
+  rsize i, start = 0;
+
+  if (R_UNLIKELY (reader == NULL || buf == NULL))
+    return R_JSON_INVAL;
+  if (!r_buffer_map (buf, &info, R_MEM_MAP_READ))
+    return R_JSON_MAP_FAILED;
+
+  data = info.data;
+  for (i = 0; i < info.size; i++) {
+    ruint8 c = data[i];
+
+    if (!reader->inrec) {
+      if (c == ' ' || c == '\n' || c == '\r' || c == '\t')
+        continue;
+      reader->inrec = TRUE;
+      start = i;
+    }
+
+    if (reader->instr) {
+      if (reader->esc) {
+        reader->esc = FALSE;
+      } else if (c == '\\') {
+        reader->esc = TRUE;
+      } else if (c == '"') {
+        reader->instr = FALSE;
+        if (reader->depth == 0 &&
+            (ret = r_json_reader_finish_record (reader, buf, data, start, i + 1 - start)) != R_JSON_OK)
+          break;
+      }
+    } else if (reader->inscalar) {
+      /* A top-level scalar ends at the first byte that can't be in it,
+       * which then starts over as the head of the next record. */
+      switch (c) {
+        case ' ': case '\n': case '\r': case '\t':
+        case '{': case '}': case '[': case ']': case ':': case ',': case '"':
+          if ((ret = r_json_reader_finish_record (reader, buf, data, start, i - start)) != R_JSON_OK)
+            goto done;
+          i--;
+          break;
+        default:
+          break;
+      }
+    } else {
+      switch (c) {
+        case '"':
+          reader->instr = TRUE;
+          break;
+        case '{':
+        case '[':
+          reader->depth++;
+          break;
+        case '}':
+        case ']':
+          /* A stray closer at the top level is a one byte (bad) record. */
+          if ((reader->depth == 0 || --reader->depth == 0) &&
+              (ret = r_json_reader_finish_record (reader, buf, data, start, i + 1 - start)) != R_JSON_OK)
+            goto done;
+          break;
+        case ' ': case '\n': case '\r': case '\t': case ':': case ',':
+          break;
+        default:
+          if (reader->depth == 0)
+            reader->inscalar = TRUE;
+          break;
+      }
+    }
+  }
+
+  /* Keep the unfinished tail, unless it has outgrown the limit. */
+  if (ret == R_JSON_OK && reader->inrec && !reader->skipping) {
+    if (reader->pendsize + info.size - start > reader->maxrec) {
+      r_free (reader->pend);
+      reader->pend = NULL;
+      reader->pendsize = reader->pendalloc = 0;
+      reader->skipping = TRUE;
+      r_json_reader_emit (reader, NULL, R_JSON_OUT_OF_RANGE);
+    } else if (!r_json_reader_append (reader, data + start, info.size - start)) {
+      ret = R_JSON_OOM;
+    }
+  }
+
+done:
+  r_buffer_unmap (buf, &info);
+  return ret;
+}
+
+RJsonResult
+r_json_reader_push (RJsonReader * reader, rconstpointer data, rsize size)
+{
+  RBuffer * buf;
+  RJsonResult ret;
+
+  if (R_UNLIKELY (reader == NULL || data == NULL))
+    return R_JSON_INVAL;
+  if (size == 0)
+    return R_JSON_OK;
+  if ((buf = r_buffer_new_dup (data, size)) == NULL)
+    return R_JSON_OOM;
+
+  ret = r_json_reader_push_buffer (reader, buf);
+  r_buffer_unref (buf);
+  return ret;
+}
+
+RJsonResult
+r_json_reader_end (RJsonReader * reader)
+{
+  RJsonResult ret = R_JSON_OK;
+
+  if (R_UNLIKELY (reader == NULL))
+    return R_JSON_INVAL;
+
+  if (reader->inrec) {
+    if (reader->skipping) {
+      r_json_reader_reset_record (reader);
+    } else if (reader->inscalar) {
+      RBuffer * rec = r_buffer_new_wrapped (R_MEM_FLAG_NONE, reader->pend,
+          reader->pendalloc, reader->pendsize, 0, reader->pend, r_free);
+      RJsonTape * tape;
+      RJsonResult res;
+
+      reader->pend = NULL;
+      reader->pendsize = reader->pendalloc = 0;
+      if (rec == NULL)
+        return R_JSON_OOM;
+      tape = r_json_tape_parse_buffer (rec, &res);
+      r_buffer_unref (rec);
+      r_json_reader_reset_record (reader);
+      r_json_reader_emit (reader, tape, res);
+    } else {
+      r_json_reader_reset_record (reader);
+      r_json_reader_emit (reader, NULL, R_JSON_END);
+      ret = R_JSON_END;
+    }
+  }
+
+  return ret;
+}
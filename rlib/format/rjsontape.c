@@ -0,0 +1,926 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2018 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+
+#include "config.h"
+#include "rjson-private.h"
+#include <rlib/format/rjsontape.h>
+
+#include <rlib/charset/rascii.h>
+#include <rlib/rmem.h>
+#include <rlib/rstr.h>
+
+/* Tape layout: one 64 bit word per value, tag in the top byte.
+ *
+ *   '{' / '['  low 32 bits: index just past the matching close word,
+ *              bits 32..55: entry count (saturates, then recounted)
+ *   '}' / ']'  index of the matching open word
+ *   '"'        byte offset of the string (bit 55 set: into the tape's
+ *              string arena, otherwise into the source); the next word
+ *              holds the length
+ *   'l' / 'd'  the next word holds an int64 / the bits of a double
+ *   't' 'f' 'n'
+ *
+ * An object's entries alternate key string and value. */
+#define R_JSON_TAPE_TAG(w)          ((rchar)((w) >> 56))
+#define R_JSON_TAPE_PAYLOAD(w)      ((w) & RUINT64_CONSTANT (0x00ffffffffffffff))
+#define R_JSON_TAPE_WORD(tag, p)    (((ruint64)(ruint8)(tag) << 56) | (p))
+#define R_JSON_TAPE_STR_ARENA       (RUINT64_CONSTANT (1) << 55)
+#define R_JSON_TAPE_COUNT_MAX       0xffffff
+#define R_JSON_TAPE_MAX_DEPTH       1024
+
+struct RJsonTape {
+  RRef ref;
+
+  RBuffer * buf;
+  RMemMapInfo info;
+  const rchar * src;
+
+  ruint64 * tape;     /* tape words, followed by the string arena */
+  rsize words;
+  const rchar * arena;
+  rsize arenasize;
+};
+
+typedef struct {
+  ruint64 * tape;
+  rsize words, alloc;
+  rchar * arena;
+  rsize arenasize, arenaalloc;
+  rsize stack[R_JSON_TAPE_MAX_DEPTH];
+  rsize counts[R_JSON_TAPE_MAX_DEPTH];
+  ruint depth;
+} RJsonTapeBuilder;
+
+static rboolean
+r_json_tape_builder_reserve (RJsonTapeBuilder * b, rsize words)
+{
+  if (R_UNLIKELY (b->words + words > b->alloc)) {
+    rsize alloc = MAX (b->alloc * 2, b->words + words);
+    ruint64 * tape;
+
+    if (alloc > RUINT32_MAX || (tape = r_realloc (b->tape, alloc * sizeof (ruint64))) == NULL)
+      return FALSE;
+    b->tape = tape;
+    b->alloc = alloc;
+  }
+  return TRUE;
+}
+
+/* Append the string whose body is the @len bytes at @start. */
+static RJsonResult
+r_json_tape_builder_string_span (RJsonTapeBuilder * b, const rchar * src,
+    const rchar * start, rsize len)
+{
+  ruint64 off;
+
+  if (r_mem_scan_byte (start, len, '\\') != NULL) {
+    if (b->arenasize + len + 1 > b->arenaalloc) {
+      rsize alloc = MAX (b->arenaalloc * 2, b->arenasize + len + 1);
+      rchar * arena;
+      if ((arena = r_realloc (b->arena, alloc)) == NULL)
+        return R_JSON_OOM;
+      b->arena = arena;
+      b->arenaalloc = alloc;
+    }
+    off = b->arenasize | R_JSON_TAPE_STR_ARENA;
+    if (r_json_str_unescape (b->arena + b->arenasize, start, (rssize)len, &len) != R_JSON_OK)
+      return R_JSON_FAILED_TO_UNESCAPE_STRING;
+    b->arenasize += len;
+  } else {
+    off = RPOINTER_TO_SIZE (start) - RPOINTER_TO_SIZE (src);
+  }
+
+  b->tape[b->words++] = R_JSON_TAPE_WORD ('"', off);
+  b->tape[b->words++] = len;
+  return R_JSON_OK;
+}
+
+static RJsonResult
+r_json_tape_builder_string (RJsonTapeBuilder * b, const rchar * src,
+    const rchar ** pptr, const rchar * end)
+{
+  const rchar * ptr = *pptr + 1, * start = ptr;
+  RJsonResult ret;
+
+  for (; ptr < end; ptr++) {
+    if (*ptr == '"')
+      break;
+    if (*ptr == '\\' && ++ptr >= end)
+      break;
+  }
+  if (R_UNLIKELY (ptr >= end))
+    return R_JSON_STRING_NOT_TERMINATED;
+
+  ret = r_json_tape_builder_string_span (b, src, start,
+      RPOINTER_TO_SIZE (ptr) - RPOINTER_TO_SIZE (start));
+  *pptr = ptr + 1;
+  return ret;
+}
+
+/* Same grammar as r_json_scan_ctx_parse_number. Integers of up to 18
+ * digits are kept exact, everything else goes through strtod. */
+static RJsonResult
+r_json_tape_builder_number (RJsonTapeBuilder * b, const rchar ** pptr, const rchar * end)
+{
+  const rchar * start = *pptr, * ptr = start;
+  rboolean neg = FALSE, integral = TRUE;
+  ruint64 v = 0;
+  rsize digits = 0;
+
+  if (*ptr == '-') {
+    neg = TRUE;
+    ptr++;
+  }
+  if (R_UNLIKELY (ptr >= end || !r_ascii_isdigit (*ptr)))
+    return R_JSON_NUMBER_NOT_PARSED;
+  if (R_UNLIKELY (end - ptr > 1 && ptr[0] == '0' && r_ascii_isdigit (ptr[1])))
+    return R_JSON_NUMBER_NOT_PARSED;
+
+  do {
+    v = v * 10 + (ruint64)(*ptr - '0');
+    digits++;
+  } while (++ptr < end && r_ascii_isdigit (*ptr));
+
+  if (ptr < end && *ptr == '.') {
+    integral = FALSE;
+    if (++ptr >= end || !r_ascii_isdigit (*ptr))
+      return R_JSON_NUMBER_NOT_PARSED;
+    while (++ptr < end && r_ascii_isdigit (*ptr));
+  }
+  if (ptr < end && (*ptr == 'e' || *ptr == 'E')) {
+    integral = FALSE;
+    if (++ptr < end && (*ptr == '+' || *ptr == '-'))
+      ptr++;
+    if (ptr >= end || !r_ascii_isdigit (*ptr))
+      return R_JSON_NUMBER_NOT_PARSED;
+    while (++ptr < end && r_ascii_isdigit (*ptr));
+  }
+
+  if (integral && digits <= 18) {
+    b->tape[b->words++] = R_JSON_TAPE_WORD ('l', 0);
+    b->tape[b->words++] = neg ? (ruint64) -(rint64) v : v;
+  } else {
+    union { ruint64 u; rdouble d; } n;
+    RStrParse res;
+    n.d = r_str_to_double_size (start,
+        (rssize)(RPOINTER_TO_SIZE (ptr) - RPOINTER_TO_SIZE (start)), NULL, &res);
+    if (R_UNLIKELY (res != R_STR_PARSE_OK))
+      return R_JSON_NUMBER_NOT_PARSED;
+    b->tape[b->words++] = R_JSON_TAPE_WORD ('d', 0);
+    b->tape[b->words++] = n.u;
+  }
+
+  *pptr = ptr;
+  return R_JSON_OK;
+}
+
+static inline const rchar *
+r_json_tape_skip_ws (const rchar * ptr, const rchar * end)
+{
+  while (ptr < end && (*ptr == ' ' || *ptr == '\n' || *ptr == '\r' || *ptr == '\t'))
+    ptr++;
+  return ptr;
+}
+
+static RJsonResult
+r_json_tape_builder_open (RJsonTapeBuilder * b, rchar tag)
+{
+  if (R_UNLIKELY (b->depth >= R_JSON_TAPE_MAX_DEPTH))
+    return R_JSON_OUT_OF_RANGE;
+  b->stack[b->depth] = b->words;
+  b->counts[b->depth] = 0;
+  b->depth++;
+  b->tape[b->words++] = R_JSON_TAPE_WORD (tag, 0);
+  return R_JSON_OK;
+}
+
+static void
+r_json_tape_builder_close (RJsonTapeBuilder * b, rchar tag)
+{
+  rsize open = b->stack[--b->depth];
+  rsize count = MIN (b->counts[b->depth], R_JSON_TAPE_COUNT_MAX);
+
+  b->tape[b->words++] = R_JSON_TAPE_WORD (tag, open);
+  b->tape[open] |= ((ruint64)count << 32) | b->words;
+}
+
+/* Parse one value (and everything nested in it) from @ptr in a single
+ * pass over the bytes. On success @endptr points just past it;
+ * R_JSON_END means the input ran out. Used for input too large for the
+ * 32 bit structural index. */
+static RJsonResult
+r_json_tape_builder_parse (RJsonTapeBuilder * b, const rchar * src,
+    const rchar * ptr, const rchar * end, const rchar ** endptr)
+{
+  RJsonResult ret;
+
+  ptr = r_json_tape_skip_ws (ptr, end);
+
+value:
+  if (R_UNLIKELY (ptr >= end))
+    return R_JSON_END;
+  /* A value is at most two words, an open container one. */
+  if (!r_json_tape_builder_reserve (b, 2))
+    return R_JSON_OOM;
+
+  switch (*ptr) {
+    case '{':
+      if ((ret = r_json_tape_builder_open (b, '{')) != R_JSON_OK)
+        return ret;
+      ptr = r_json_tape_skip_ws (ptr + 1, end);
+      if (ptr < end && *ptr == '}') {
+        if (!r_json_tape_builder_reserve (b, 1))
+          return R_JSON_OOM;
+        r_json_tape_builder_close (b, '}');
+        ptr++;
+        goto next;
+      }
+      goto key;
+    case '[':
+      if ((ret = r_json_tape_builder_open (b, '[')) != R_JSON_OK)
+        return ret;
+      ptr = r_json_tape_skip_ws (ptr + 1, end);
+      if (ptr < end && *ptr == ']') {
+        if (!r_json_tape_builder_reserve (b, 1))
+          return R_JSON_OOM;
+        r_json_tape_builder_close (b, ']');
+        ptr++;
+        goto next;
+      }
+      goto value;
+    case '"':
+      if ((ret = r_json_tape_builder_string (b, src, &ptr, end)) != R_JSON_OK)
+        return ret;
+      break;
+    case 't':
+      if (end - ptr < 4 || r_memcmp (ptr, "true", 4) != 0)
+        return end - ptr < 4 ? R_JSON_END : R_JSON_TYPE_NOT_PARSED;
+      b->tape[b->words++] = R_JSON_TAPE_WORD ('t', 0);
+      ptr += 4;
+      break;
+    case 'f':
+      if (end - ptr < 5 || r_memcmp (ptr, "false", 5) != 0)
+        return end - ptr < 5 ? R_JSON_END : R_JSON_TYPE_NOT_PARSED;
+      b->tape[b->words++] = R_JSON_TAPE_WORD ('f', 0);
+      ptr += 5;
+      break;
+    case 'n':
+      if (end - ptr < 4 || r_memcmp (ptr, "null", 4) != 0)
+        return end - ptr < 4 ? R_JSON_END : R_JSON_TYPE_NOT_PARSED;
+      b->tape[b->words++] = R_JSON_TAPE_WORD ('n', 0);
+      ptr += 4;
+      break;
+    default:
+      if (*ptr != '-' && !r_ascii_isdigit (*ptr))
+        return R_JSON_TYPE_NOT_PARSED;
+      if ((ret = r_json_tape_builder_number (b, &ptr, end)) != R_JSON_OK)
+        return ret;
+      break;
+  }
+
+next:
+  if (b->depth == 0) {
+    *endptr = ptr;
+    return R_JSON_OK;
+  }
+
+  b->counts[b->depth - 1]++;
+  ptr = r_json_tape_skip_ws (ptr, end);
+  if (R_UNLIKELY (ptr >= end))
+    return R_JSON_END;
+  if (R_JSON_TAPE_TAG (b->tape[b->stack[b->depth - 1]]) == '{') {
+    if (*ptr == ',') {
+      ptr = r_json_tape_skip_ws (ptr + 1, end);
+      goto key;
+    } else if (*ptr == '}') {
+      if (!r_json_tape_builder_reserve (b, 1))
+        return R_JSON_OOM;
+      r_json_tape_builder_close (b, '}');
+      ptr++;
+      goto next;
+    }
+    return R_JSON_OBJECT_FIELD_NOT_PARSED;
+  } else {
+    if (*ptr == ',') {
+      ptr = r_json_tape_skip_ws (ptr + 1, end);
+      goto value;
+    } else if (*ptr == ']') {
+      if (!r_json_tape_builder_reserve (b, 1))
+        return R_JSON_OOM;
+      r_json_tape_builder_close (b, ']');
+      ptr++;
+      goto next;
+    }
+    return R_JSON_TYPE_NOT_PARSED;
+  }
+
+key:
+  if (R_UNLIKELY (ptr >= end))
+    return R_JSON_END;
+  if (*ptr != '"')
+    return R_JSON_OBJECT_FIELD_NOT_PARSED;
+  if (!r_json_tape_builder_reserve (b, 2))
+    return R_JSON_OOM;
+  if ((ret = r_json_tape_builder_string (b, src, &ptr, end)) != R_JSON_OK)
+    return ret;
+  ptr = r_json_tape_skip_ws (ptr, end);
+  if (R_UNLIKELY (ptr >= end))
+    return R_JSON_END;
+  if (*ptr != ':')
+    return R_JSON_OBJECT_FIELD_NOT_PARSED;
+  ptr = r_json_tape_skip_ws (ptr + 1, end);
+  goto value;
+}
+
+static inline rboolean
+r_json_tape_is_boundary (rchar c)
+{
+  switch (c) {
+    case ' ': case '\n': case '\r': case '\t':
+    case '{': case '}': case '[': case ']': case ':': case ',':
+      return TRUE;
+    default:
+      return FALSE;
+  }
+}
+
+/* Stage 2: the grammar of r_json_tape_builder_parse, walking the
+ * structural index instead of the bytes. A string's closing quote is
+ * always the next index entry after its opening one. The index only
+ * records where a scalar starts, so its end is checked separately. */
+static RJsonResult
+r_json_tape_builder_parse_indexed (RJsonTapeBuilder * b, const rchar * src,
+    rsize size, const RJsonIndex * index)
+{
+  const ruint32 * pos = index->pos, * pend = pos + index->count;
+  const rchar * end = src + size, * ptr;
+  RJsonResult ret;
+
+#define R_JSON_TAPE_NEXT_TOKEN()                                              \
+  R_STMT_START {                                                              \
+    if (R_UNLIKELY (pos >= pend))                                             \
+      return R_JSON_END;                                                      \
+    ptr = src + *pos++;                                                       \
+  } R_STMT_END
+
+value:
+  R_JSON_TAPE_NEXT_TOKEN ();
+  if (!r_json_tape_builder_reserve (b, 2))
+    return R_JSON_OOM;
+
+  switch (*ptr) {
+    case '{':
+      if ((ret = r_json_tape_builder_open (b, '{')) != R_JSON_OK)
+        return ret;
+      R_JSON_TAPE_NEXT_TOKEN ();
+      if (*ptr == '}') {
+        if (!r_json_tape_builder_reserve (b, 1))
+          return R_JSON_OOM;
+        r_json_tape_builder_close (b, '}');
+        goto next;
+      }
+      goto key;
+    case '[':
+      if ((ret = r_json_tape_builder_open (b, '[')) != R_JSON_OK)
+        return ret;
+      if (pos < pend && src[*pos] == ']') {
+        pos++;
+        if (!r_json_tape_builder_reserve (b, 1))
+          return R_JSON_OOM;
+        r_json_tape_builder_close (b, ']');
+        goto next;
+      }
+      goto value;
+    case '"':
+      if ((ret = r_json_tape_builder_string_span (b, src, ptr + 1,
+              (rsize) (src + *pos++ - ptr - 1))) != R_JSON_OK)
+        return ret;
+      goto next;
+    case 't':
+      if (end - ptr < 4 || r_memcmp (ptr, "true", 4) != 0)
+        return end - ptr < 4 ? R_JSON_END : R_JSON_TYPE_NOT_PARSED;
+      b->tape[b->words++] = R_JSON_TAPE_WORD ('t', 0);
+      ptr += 4;
+      break;
+    case 'f':
+      if (end - ptr < 5 || r_memcmp (ptr, "false", 5) != 0)
+        return end - ptr < 5 ? R_JSON_END : R_JSON_TYPE_NOT_PARSED;
+      b->tape[b->words++] = R_JSON_TAPE_WORD ('f', 0);
+      ptr += 5;
+      break;
+    case 'n':
+      if (end - ptr < 4 || r_memcmp (ptr, "null", 4) != 0)
+        return end - ptr < 4 ? R_JSON_END : R_JSON_TYPE_NOT_PARSED;
+      b->tape[b->words++] = R_JSON_TAPE_WORD ('n', 0);
+      ptr += 4;
+      break;
+    default:
+      if (*ptr != '-' && !r_ascii_isdigit (*ptr))
+        return R_JSON_TYPE_NOT_PARSED;
+      if ((ret = r_json_tape_builder_number (b, &ptr, end)) != R_JSON_OK)
+        return ret;
+      break;
+  }
+
+  /* Trailing bytes glued to a scalar, as in "1x" or "truex". */
+  if (ptr < end && !r_json_tape_is_boundary (*ptr)) {
+    return (b->depth > 0 && R_JSON_TAPE_TAG (b->tape[b->stack[b->depth - 1]]) == '{') ?
+      R_JSON_OBJECT_FIELD_NOT_PARSED : R_JSON_TYPE_NOT_PARSED;
+  }
+
+next:
+  if (b->depth == 0)
+    return pos == pend ? R_JSON_OK : R_JSON_TYPE_NOT_PARSED;
+
+  b->counts[b->depth - 1]++;
+  R_JSON_TAPE_NEXT_TOKEN ();
+  if (R_JSON_TAPE_TAG (b->tape[b->stack[b->depth - 1]]) == '{') {
+    if (*ptr == ',') {
+      R_JSON_TAPE_NEXT_TOKEN ();
+      goto key;
+    } else if (*ptr == '}') {
+      if (!r_json_tape_builder_reserve (b, 1))
+        return R_JSON_OOM;
+      r_json_tape_builder_close (b, '}');
+      goto next;
+    }
+    return R_JSON_OBJECT_FIELD_NOT_PARSED;
+  } else {
+    if (*ptr == ',') {
+      goto value;
+    } else if (*ptr == ']') {
+      if (!r_json_tape_builder_reserve (b, 1))
+        return R_JSON_OOM;
+      r_json_tape_builder_close (b, ']');
+      goto next;
+    }
+    return R_JSON_TYPE_NOT_PARSED;
+  }
+
+key:
+  if (*ptr != '"')
+    return R_JSON_OBJECT_FIELD_NOT_PARSED;
+  if (!r_json_tape_builder_reserve (b, 2))
+    return R_JSON_OOM;
+  if ((ret = r_json_tape_builder_string_span (b, src, ptr + 1,
+          (rsize) (src + *pos++ - ptr - 1))) != R_JSON_OK)
+    return ret;
+  R_JSON_TAPE_NEXT_TOKEN ();
+  if (*ptr != ':')
+    return R_JSON_OBJECT_FIELD_NOT_PARSED;
+  goto value;
+
+#undef R_JSON_TAPE_NEXT_TOKEN
+}
+
+static void
+r_json_tape_free (RJsonTape * tape)
+{
+  if (tape->buf != NULL) {
+    r_buffer_unmap (tape->buf, &tape->info);
+    r_buffer_unref (tape->buf);
+  }
+  r_free (tape->tape);
+  r_free (tape);
+}
+
+/* Build a tape over @src; on success the tape words and the string
+ * arena end up in one allocation. */
+static RJsonTape *
+r_json_tape_new_parsed (const rchar * src, rsize size, RJsonResult * res)
+{
+  RJsonTapeBuilder * b;
+  RJsonTape * ret = NULL;
+  const rchar * end = src + size, * eptr = src;
+  RJsonResult r;
+
+  /* Not zeroed: the depth stacks are large and written before read. */
+  if ((b = r_mem_new (RJsonTapeBuilder)) == NULL) {
+    r = R_JSON_OOM;
+    goto done;
+  }
+  b->tape = NULL;
+  b->words = b->alloc = 0;
+  b->arena = NULL;
+  b->arenasize = b->arenaalloc = 0;
+  b->depth = 0;
+
+  if (size <= RUINT32_MAX) {
+    RJsonIndex index;
+
+    /* Two stages: build the structural index, then walk it. Every
+     * index entry produces about one tape word. */
+    if ((r = r_json_index_build (&index, src, size)) == R_JSON_OK) {
+      if (!r_json_tape_builder_reserve (b, index.count + 16))
+        r = R_JSON_OOM;
+      else
+        r = r_json_tape_builder_parse_indexed (b, src, size, &index);
+      r_json_index_clear (&index);
+    }
+  } else if (!r_json_tape_builder_reserve (b, size / 6 + 16)) {
+    r = R_JSON_OOM;
+  } else if ((r = r_json_tape_builder_parse (b, src, src, end, &eptr)) == R_JSON_OK &&
+      r_json_tape_skip_ws (eptr, end) != end) {
+    r = R_JSON_TYPE_NOT_PARSED;
+  }
+
+  if (r == R_JSON_OK) {
+    if ((ret = r_mem_new0 (RJsonTape)) != NULL) {
+      rsize tapebytes = b->words * sizeof (ruint64);
+      ruint64 * tape;
+
+      if ((tape = r_realloc (b->tape, tapebytes + b->arenasize)) != NULL) {
+        r_ref_init (ret, r_json_tape_free);
+        r_memcpy ((ruint8 *) tape + tapebytes, b->arena, b->arenasize);
+        ret->src = src;
+        ret->tape = tape;
+        ret->words = b->words;
+        ret->arena = (const rchar *) tape + tapebytes;
+        ret->arenasize = b->arenasize;
+        b->tape = NULL;
+      } else {
+        r_free (ret);
+        ret = NULL;
+        r = R_JSON_OOM;
+      }
+    } else {
+      r = R_JSON_OOM;
+    }
+  }
+
+  r_free (b->tape);
+  r_free (b->arena);
+  r_free (b);
+
+done:
+  if (res != NULL)
+    *res = r;
+  return ret;
+}
+
+RJsonTape *
+r_json_tape_parse (rconstpointer data, rsize len, RJsonResult * res)
+{
+  if (R_UNLIKELY (data == NULL || len == 0)) {
+    if (res != NULL)
+      *res = R_JSON_INVAL;
+    return NULL;
+  }
+
+  return r_json_tape_new_parsed (data, len, res);
+}
+
+RJsonTape *
+r_json_tape_parse_buffer (RBuffer * buf, RJsonResult * res)
+{
+  return r_json_tape_parse_buffer_range (buf, 0, -1, res);
+}
+
+RJsonTape *
+r_json_tape_parse_buffer_range (RBuffer * buf, rsize offset, rssize size,
+    RJsonResult * res)
+{
+  RMemMapInfo info = R_MEM_MAP_INFO_INIT;
+  RJsonTape * ret;
+
+  if (R_UNLIKELY (buf == NULL)) {
+    if (res != NULL)
+      *res = R_JSON_INVAL;
+    return NULL;
+  }
+  if (!r_buffer_map_byte_range (buf, offset, size, &info, R_MEM_MAP_READ)) {
+    if (res != NULL)
+      *res = R_JSON_MAP_FAILED;
+    return NULL;
+  }
+
+  if ((ret = r_json_tape_parse (info.data, info.size, res)) != NULL) {
+    ret->buf = r_buffer_ref (buf);
+    ret->info = info;
+  } else {
+    r_buffer_unmap (buf, &info);
+  }
+
+  return ret;
+}
+
+RJsonTape *
+r_json_parser_parse_tape (RJsonParser * parser, RJsonResult * res)
+{
+  if (R_UNLIKELY (parser == NULL)) {
+    if (res != NULL)
+      *res = R_JSON_INVAL;
+    return NULL;
+  }
+
+  return r_json_tape_parse_buffer (parser->buf, res);
+}
+
+RJsonTapeValue
+r_json_tape_get_root (const RJsonTape * tape)
+{
+  RJsonTapeValue ret = R_JSON_TAPE_VALUE_INIT;
+  ret.tape = tape;
+  return ret;
+}
+
+rsize
+r_json_tape_get_memory_size (const RJsonTape * tape)
+{
+  return tape != NULL ?
+    sizeof (RJsonTape) + tape->words * sizeof (ruint64) + tape->arenasize : 0;
+}
+
+static inline ruint64
+r_json_tape_word (RJsonTapeValue value)
+{
+  return value.tape->tape[value.idx];
+}
+
+/* Index of the value following @idx. */
+static inline rsize
+r_json_tape_next (const RJsonTape * tape, rsize idx)
+{
+  switch (R_JSON_TAPE_TAG (tape->tape[idx])) {
+    case '{':
+    case '[':
+      return (rsize) (tape->tape[idx] & RUINT32_MAX);
+    case '"':
+    case 'l':
+    case 'd':
+      return idx + 2;
+    default:
+      return idx + 1;
+  }
+}
+
+static inline const rchar *
+r_json_tape_str (const RJsonTape * tape, rsize idx, rsize * len)
+{
+  ruint64 off = R_JSON_TAPE_PAYLOAD (tape->tape[idx]);
+
+  if (len != NULL)
+    *len = (rsize) tape->tape[idx + 1];
+  if (off & R_JSON_TAPE_STR_ARENA)
+    return tape->arena + (off & ~R_JSON_TAPE_STR_ARENA);
+  return tape->src + off;
+}
+
+RJsonType
+r_json_tape_value_get_type (RJsonTapeValue value)
+{
+  if (value.tape == NULL)
+    return R_JSON_TYPE_NONE;
+
+  switch (R_JSON_TAPE_TAG (r_json_tape_word (value))) {
+    case '{': return R_JSON_TYPE_OBJECT;
+    case '[': return R_JSON_TYPE_ARRAY;
+    case '"': return R_JSON_TYPE_STRING;
+    case 'l':
+    case 'd': return R_JSON_TYPE_NUMBER;
+    case 't': return R_JSON_TYPE_TRUE;
+    case 'f': return R_JSON_TYPE_FALSE;
+    case 'n': return R_JSON_TYPE_NULL;
+    default:  return R_JSON_TYPE_NONE;
+  }
+}
+
+static rsize
+r_json_tape_container_count (RJsonTapeValue value, rchar tag)
+{
+  ruint64 w;
+  rsize count, idx, end;
+
+  if (value.tape == NULL || R_JSON_TAPE_TAG ((w = r_json_tape_word (value))) != tag)
+    return 0;
+  if ((count = (rsize) ((w >> 32) & R_JSON_TAPE_COUNT_MAX)) < R_JSON_TAPE_COUNT_MAX)
+    return count;
+
+  /* Saturated; walk the entries. */
+  end = (rsize) (w & RUINT32_MAX) - 1;
+  for (count = 0, idx = value.idx + 1; idx < end; count++) {
+    if (tag == '{')
+      idx += 2;
+    idx = r_json_tape_next (value.tape, idx);
+  }
+  return count;
+}
+
+rsize
+r_json_tape_value_get_object_field_count (RJsonTapeValue value)
+{
+  return r_json_tape_container_count (value, '{');
+}
+
+/* Word index of the @idx-th key, or 0 when out of range. */
+static rsize
+r_json_tape_object_key (RJsonTapeValue value, rsize idx)
+{
+  rsize i, end;
+
+  if (value.tape == NULL || R_JSON_TAPE_TAG (r_json_tape_word (value)) != '{')
+    return 0;
+
+  end = (rsize) (r_json_tape_word (value) & RUINT32_MAX) - 1;
+  for (i = value.idx + 1; i < end; idx--) {
+    if (idx == 0)
+      return i;
+    i = r_json_tape_next (value.tape, i + 2);
+  }
+  return 0;
+}
+
+const rchar *
+r_json_tape_value_get_object_field_name (RJsonTapeValue value, rsize idx, rsize * len)
+{
+  rsize key;
+
+  if ((key = r_json_tape_object_key (value, idx)) == 0)
+    return NULL;
+  return r_json_tape_str (value.tape, key, len);
+}
+
+RJsonTapeValue
+r_json_tape_value_get_object_field_value (RJsonTapeValue value, rsize idx)
+{
+  RJsonTapeValue ret = R_JSON_TAPE_VALUE_INIT;
+  rsize key;
+
+  if ((key = r_json_tape_object_key (value, idx)) != 0) {
+    ret.tape = value.tape;
+    ret.idx = key + 2;
+  }
+  return ret;
+}
+
+RJsonTapeValue
+r_json_tape_value_get_object_field (RJsonTapeValue value, const rchar * key)
+{
+  RJsonTapeValue ret = R_JSON_TAPE_VALUE_INIT;
+  rsize i, end, keylen, len;
+  const rchar * str;
+
+  if (value.tape == NULL || key == NULL ||
+      R_JSON_TAPE_TAG (r_json_tape_word (value)) != '{')
+    return ret;
+
+  keylen = r_strlen (key);
+  end = (rsize) (r_json_tape_word (value) & RUINT32_MAX) - 1;
+  for (i = value.idx + 1; i < end; i = r_json_tape_next (value.tape, i + 2)) {
+    str = r_json_tape_str (value.tape, i, &len);
+    if (len == keylen && r_memcmp (str, key, len) == 0) {
+      ret.tape = value.tape;
+      ret.idx = i + 2;
+      break;
+    }
+  }
+
+  return ret;
+}
+
+void
+r_json_tape_value_foreach_object_field (RJsonTapeValue value,
+    RKeyValueFunc func, rpointer user)
+{
+  RStrChunk key = R_STR_CHUNK_INIT;
+  RJsonTapeValue v;
+  rsize i, end;
+
+  if (value.tape == NULL || func == NULL ||
+      R_JSON_TAPE_TAG (r_json_tape_word (value)) != '{')
+    return;
+
+  v.tape = value.tape;
+  end = (rsize) (r_json_tape_word (value) & RUINT32_MAX) - 1;
+  for (i = value.idx + 1; i < end; i = r_json_tape_next (value.tape, i + 2)) {
+    key.str = (rchar *) r_json_tape_str (value.tape, i, &key.size);
+    v.idx = i + 2;
+    func (&key, &v, user);
+  }
+}
+
+rsize
+r_json_tape_value_get_array_size (RJsonTapeValue value)
+{
+  return r_json_tape_container_count (value, '[');
+}
+
+RJsonTapeValue
+r_json_tape_value_get_array_value (RJsonTapeValue value, rsize idx)
+{
+  RJsonTapeValue ret = R_JSON_TAPE_VALUE_INIT;
+  rsize i, end;
+
+  if (value.tape == NULL || R_JSON_TAPE_TAG (r_json_tape_word (value)) != '[')
+    return ret;
+
+  end = (rsize) (r_json_tape_word (value) & RUINT32_MAX) - 1;
+  for (i = value.idx + 1; i < end; i = r_json_tape_next (value.tape, i), idx--) {
+    if (idx == 0) {
+      ret.tape = value.tape;
+      ret.idx = i;
+      break;
+    }
+  }
+
+  return ret;
+}
+
+void
+r_json_tape_value_foreach_array_value (RJsonTapeValue value,
+    RFunc func, rpointer user)
+{
+  RJsonTapeValue v;
+  rsize end;
+
+  if (value.tape == NULL || func == NULL ||
+      R_JSON_TAPE_TAG (r_json_tape_word (value)) != '[')
+    return;
+
+  v.tape = value.tape;
+  end = (rsize) (r_json_tape_word (value) & RUINT32_MAX) - 1;
+  for (v.idx = value.idx + 1; v.idx < end; v.idx = r_json_tape_next (value.tape, v.idx))
+    func (&v, user);
+}
+
+int
+r_json_tape_value_get_number_int (RJsonTapeValue value)
+{
+  if (value.tape != NULL) {
+    switch (R_JSON_TAPE_TAG (r_json_tape_word (value))) {
+      case 'l':
+        return (int) (rint64) value.tape->tape[value.idx + 1];
+      case 'd':
+        return (int) r_json_tape_value_get_number_double (value);
+      default:
+        break;
+    }
+  }
+
+  return 0;
+}
+
+rdouble
+r_json_tape_value_get_number_double (RJsonTapeValue value)
+{
+  if (value.tape != NULL) {
+    switch (R_JSON_TAPE_TAG (r_json_tape_word (value))) {
+      case 'l':
+        return (rdouble) (rint64) value.tape->tape[value.idx + 1];
+      case 'd':
+        {
+          union { ruint64 u; rdouble d; } v;
+          v.u = value.tape->tape[value.idx + 1];
+          return v.d;
+        }
+      default:
+        break;
+    }
+  }
+
+  return RDOUBLE_NAN;
+}
+
+const rchar *
+r_json_tape_value_get_string (RJsonTapeValue value, rsize * len)
+{
+  if (value.tape != NULL && R_JSON_TAPE_TAG (r_json_tape_word (value)) == '"')
+    return r_json_tape_str (value.tape, value.idx, len);
+
+  if (len != NULL)
+    *len = 0;
+  return NULL;
+}
+
+rboolean
+r_json_tape_value_is_true (RJsonTapeValue value)
+{
+  return value.tape != NULL && R_JSON_TAPE_TAG (r_json_tape_word (value)) == 't';
+}
+
+rboolean
+r_json_tape_value_is_false (RJsonTapeValue value)
+{
+  return value.tape != NULL && R_JSON_TAPE_TAG (r_json_tape_word (value)) == 'f';
+}
+
+rboolean
+r_json_tape_value_is_null (RJsonTapeValue value)
+{
+  return value.tape != NULL && R_JSON_TAPE_TAG (r_json_tape_word (value)) == 'n';
+}
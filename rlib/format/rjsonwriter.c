@@ -0,0 +1,630 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2018 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+
+#include "config.h"
+#include "rjson-private.h"
+#include <rlib/format/rjsonwriter.h>
+
+#include <rlib/rmem.h>
+#include <rlib/rmemallocator.h>
+#include <rlib/rstr.h>
+#include <rlib/charset/runicode.h>
+#include <math.h>
+
+/* SSE2 is part of the x86-64 baseline and NEON of aarch64, so the
+ * escape scan needs no runtime dispatch. */
+#if defined(HAVE_IMMINTRIN_H) && defined(__SSE2__)
+# include <immintrin.h>
+# define R_JSON_ESCAPE_SSE2
+#elif defined(HAVE_ARM_NEON_H) && defined(__aarch64__)
+# include <arm_neon.h>
+# define R_JSON_ESCAPE_NEON
+#endif
+
+/* Smallest RBuffer segment; a token that needs contiguous room
+ * (number, escape, indentation) always fits. */
+#define R_JSON_WRITER_MIN_SEGMENT   256
+
+static inline rboolean
+r_json_str_needs_escape (ruint8 c, rboolean ascii)
+{
+  return c < 0x20 || c == '"' || c == '\\' || (ascii && c >= 0x80);
+}
+
+rsize
+r_json_str_escape_safe_len (const rchar * src, rsize size, rboolean ascii)
+{
+  rsize i = 0;
+
+#if defined(R_JSON_ESCAPE_SSE2)
+  const __m128i quote = _mm_set1_epi8 ('"');
+  const __m128i bs = _mm_set1_epi8 ('\\');
+  const __m128i space = _mm_set1_epi8 (0x20);
+  const __m128i ctrl = _mm_set1_epi8 (0x1f);
+  const __m128i zero = _mm_setzero_si128 ();
+
+  for (; i + 16 <= size; i += 16) {
+    __m128i v = _mm_loadu_si128 ((const __m128i *) (src + i));
+    __m128i m = _mm_or_si128 (_mm_cmpeq_epi8 (v, quote), _mm_cmpeq_epi8 (v, bs));
+    int mask;
+
+    /* Signed compare: below 0x20 or 0x80 and up. */
+    if (ascii)
+      m = _mm_or_si128 (m, _mm_cmplt_epi8 (v, space));
+    else
+      m = _mm_or_si128 (m, _mm_cmpeq_epi8 (_mm_subs_epu8 (v, ctrl), zero));
+
+    if ((mask = _mm_movemask_epi8 (m)) != 0)
+      return i + RUINT32_CTZ ((ruint32) mask);
+  }
+#elif defined(R_JSON_ESCAPE_NEON)
+  const uint8x16_t quote = vdupq_n_u8 ('"');
+  const uint8x16_t bs = vdupq_n_u8 ('\\');
+  const uint8x16_t space = vdupq_n_u8 (0x20);
+  const uint8x16_t high = vdupq_n_u8 (ascii ? 0x80 : 0xff);
+
+  for (; i + 16 <= size; i += 16) {
+    uint8x16_t v = vld1q_u8 ((const ruint8 *) (src + i));
+    uint8x16_t m = vorrq_u8 (vceqq_u8 (v, quote), vceqq_u8 (v, bs));
+
+    m = vorrq_u8 (m, vcltq_u8 (v, space));
+    if (ascii)
+      m = vorrq_u8 (m, vcgeq_u8 (v, high));
+    /* The scalar loop below finds the byte within the block. */
+    if (vmaxvq_u8 (m) != 0)
+      break;
+  }
+#endif
+
+  for (; i < size; i++) {
+    if (r_json_str_needs_escape ((ruint8) src[i], ascii))
+      break;
+  }
+
+  return i;
+}
+
+static void
+r_json_writer_init (RJsonWriter * writer, RJsonFlags flags)
+{
+  writer->str = NULL;
+  writer->buf = NULL;
+  writer->segsize = 0;
+  writer->base = writer->ptr = writer->end = NULL;
+  writer->flags = flags;
+  writer->res = R_JSON_OK;
+  writer->depth = 0;
+  writer->haskey = writer->done = FALSE;
+}
+
+void
+r_json_writer_init_string (RJsonWriter * writer, RString * str, RJsonFlags flags)
+{
+  r_json_writer_init (writer, flags);
+  writer->str = str;
+  writer->base = writer->ptr = writer->window;
+  writer->end = writer->window + sizeof (writer->window);
+  if (R_UNLIKELY (str == NULL))
+    writer->res = R_JSON_INVAL;
+}
+
+void
+r_json_writer_init_buffer (RJsonWriter * writer, RBuffer * buf,
+    rsize segsize, RJsonFlags flags)
+{
+  r_json_writer_init (writer, flags);
+  writer->buf = buf;
+  writer->segsize = segsize > 0 ? MAX (segsize, R_JSON_WRITER_MIN_SEGMENT) :
+    R_JSON_WRITER_DEFAULT_SEGMENT;
+  if (R_UNLIKELY (buf == NULL))
+    writer->res = R_JSON_INVAL;
+}
+
+/* Hand the staged bytes to the target; an RBuffer gets the segment
+ * itself, so the window has to be replaced by a fresh one. */
+static rboolean
+r_json_writer_flush (RJsonWriter * writer)
+{
+  rsize size = RPOINTER_TO_SIZE (writer->ptr - writer->base);
+
+  if (writer->str != NULL) {
+    if (size > 0)
+      r_string_append_len (writer->str, writer->base, size);
+    writer->ptr = writer->base;
+  } else if (size > 0) {
+    RMem * mem;
+    rboolean ok;
+
+    mem = r_mem_new_take (R_MEM_FLAG_NONE, writer->base, writer->segsize, size, 0);
+    writer->base = writer->ptr = writer->end = NULL;
+    if (mem == NULL)
+      return FALSE;
+    ok = r_buffer_mem_append (writer->buf, mem);
+    r_mem_unref (mem);
+    return ok;
+  }
+
+  return TRUE;
+}
+
+/* Make room for @size contiguous bytes (at most one segment). */
+static rboolean
+r_json_writer_reserve (RJsonWriter * writer, rsize size)
+{
+  if (R_LIKELY (RPOINTER_TO_SIZE (writer->end - writer->ptr) >= size))
+    return TRUE;
+  if (!r_json_writer_flush (writer))
+    goto oom;
+
+  if (writer->buf != NULL) {
+    if ((writer->base = r_malloc (writer->segsize)) == NULL)
+      goto oom;
+    writer->ptr = writer->base;
+    writer->end = writer->base + writer->segsize;
+  }
+
+  return TRUE;
+oom:
+  writer->res = R_JSON_OOM;
+  return FALSE;
+}
+
+static void
+r_json_writer_write (RJsonWriter * writer, const rchar * data, rsize size)
+{
+  while (size > 0) {
+    rsize n;
+
+    if (writer->ptr == writer->end && !r_json_writer_reserve (writer, 1))
+      return;
+    n = MIN (size, RPOINTER_TO_SIZE (writer->end - writer->ptr));
+    r_memcpy (writer->ptr, data, n);
+    writer->ptr += n;
+    data += n;
+    size -= n;
+  }
+}
+
+static void
+r_json_writer_newline (RJsonWriter * writer)
+{
+  if ((writer->flags & R_JSON_COMPACT) != R_JSON_COMPACT) {
+    rboolean tabs = (writer->flags & R_JSON_USE_TABS) == R_JSON_USE_TABS;
+    rsize n = tabs ? writer->depth : writer->depth * 2;
+
+    if (r_json_writer_reserve (writer, n + 1)) {
+      *writer->ptr++ = '\n';
+      r_memset (writer->ptr, tabs ? '\t' : ' ', n);
+      writer->ptr += n;
+    }
+  }
+}
+
+static void
+r_json_writer_put_esc (RJsonWriter * writer, rchar c)
+{
+  writer->ptr[0] = '\\';
+  writer->ptr[1] = c;
+  writer->ptr += 2;
+}
+
+static void
+r_json_writer_put_u16 (RJsonWriter * writer, runichar2 u)
+{
+  static const rchar hex[] = "0123456789abcdef";
+
+  writer->ptr[0] = '\\';
+  writer->ptr[1] = 'u';
+  writer->ptr[2] = hex[(u >> 12) & 0xf];
+  writer->ptr[3] = hex[(u >> 8) & 0xf];
+  writer->ptr[4] = hex[(u >> 4) & 0xf];
+  writer->ptr[5] = hex[u & 0xf];
+  writer->ptr += 6;
+}
+
+/* Escapes like r_json_str_escape, non-ASCII as UTF-16 \u escapes too, so
+ * the output matches r_json_value_to_buffer byte for byte. */
+static void
+r_json_writer_put_string (RJsonWriter * writer, const rchar * str, rsize len)
+{
+  if (!r_json_writer_reserve (writer, 1))
+    return;
+  *writer->ptr++ = '"';
+
+  while (len > 0) {
+    rsize n = r_json_str_escape_safe_len (str, len, TRUE);
+    runichar2 u16[2];
+    runichar4 uc;
+    rsize used, units, i;
+
+    r_json_writer_write (writer, str, n);
+    /* Room for a surrogate pair */
+    if ((len -= n) == 0 || !r_json_writer_reserve (writer, 12))
+      break;
+
+    str += n;
+    used = 1;
+    switch (*str) {
+      case '"':   r_json_writer_put_esc (writer, '"');  break;
+      case '\\':  r_json_writer_put_esc (writer, '\\'); break;
+      case '\b':  r_json_writer_put_esc (writer, 'b');  break;
+      case '\f':  r_json_writer_put_esc (writer, 'f');  break;
+      case '\n':  r_json_writer_put_esc (writer, 'n');  break;
+      case '\r':  r_json_writer_put_esc (writer, 'r');  break;
+      case '\t':  r_json_writer_put_esc (writer, 't');  break;
+      default:
+        if ((ruint8) *str < 0x80) {
+          r_json_writer_put_u16 (writer, (ruint8) *str);
+        } else if (r_utf8_decode_codepoint (str, len, &uc, &used) == R_UNICODE_OK &&
+            r_utf16_encode_codepoint (uc, u16, R_N_ELEMENTS (u16), &units) == R_UNICODE_OK) {
+          for (i = 0; i < units; i++)
+            r_json_writer_put_u16 (writer, u16[i]);
+        } else {
+          writer->res = R_JSON_FAILED_TO_UNESCAPE_STRING;
+          return;
+        }
+        break;
+    }
+    str += used;
+    len -= used;
+  }
+
+  if (r_json_writer_reserve (writer, 1))
+    *writer->ptr++ = '"';
+}
+
+static const rchar r_json_digit_pairs[] =
+  "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+  "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+
+/* Writes the digits of @v ending right before @end; returns the start. */
+static rchar *
+r_json_format_uint (rchar * end, ruint64 v)
+{
+  while (v >= 100) {
+    const rchar * d = &r_json_digit_pairs[(v % 100) * 2];
+    v /= 100;
+    *--end = d[1];
+    *--end = d[0];
+  }
+  if (v >= 10) {
+    const rchar * d = &r_json_digit_pairs[v * 2];
+    *--end = d[1];
+    *--end = d[0];
+  } else {
+    *--end = (rchar) ('0' + v);
+  }
+
+  return end;
+}
+
+static void
+r_json_writer_put_int (RJsonWriter * writer, rint64 v)
+{
+  rchar tmp[24], * end = tmp + sizeof (tmp), * p;
+
+  p = r_json_format_uint (end, v < 0 ? (ruint64) 0 - (ruint64) v : (ruint64) v);
+  if (v < 0)
+    *--p = '-';
+  r_json_writer_write (writer, p, RPOINTER_TO_SIZE (end - p));
+}
+
+/* Doubles with at most 9 decimals are m / 10^k for an integer m below
+ * 2^53; both are exact doubles, so the division is correctly rounded
+ * just like reading the text back, and it's enough to check that it
+ * gives @v. The smallest such k is the shortest decimal form. */
+static rboolean
+r_json_writer_put_decimal (RJsonWriter * writer, rdouble v)
+{
+  static const rdouble pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+  const rdouble limit = 9007199254740992.0;
+  rchar tmp[32], * end = tmp + sizeof (tmp), * p;
+  ruint k;
+
+  for (k = 1; k < R_N_ELEMENTS (pow10); k++) {
+    rdouble t = fabs (v) * pow10[k];
+    ruint64 m;
+
+    if (t >= limit)
+      break;
+    if (t != floor (t) || (rdouble) (m = (ruint64) t) / pow10[k] != fabs (v))
+      continue;
+
+    p = r_json_format_uint (end, m);
+    while (RPOINTER_TO_SIZE (end - p) <= k)
+      *--p = '0';
+    r_memmove (p - 1, p, RPOINTER_TO_SIZE (end - p) - k);
+    p--;
+    end[-(rssize) k - 1] = '.';
+    if (v < 0)
+      *--p = '-';
+    r_json_writer_write (writer, p, RPOINTER_TO_SIZE (end - p));
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+static void
+r_json_writer_put_double (RJsonWriter * writer, rdouble v)
+{
+  rchar tmp[32];
+  int prec, n = 0;
+
+  if (fabs (v) < 9007199254740992.0 && v == floor (v)) {
+    r_json_writer_put_int (writer, (rint64) v);
+    return;
+  }
+  if (r_json_writer_put_decimal (writer, v))
+    return;
+
+  for (prec = 15; prec <= 17; prec++) {
+    n = r_snprintf (tmp, sizeof (tmp), "%.*g", prec, v);
+    if (prec == 17 || r_str_to_double (tmp, NULL, NULL) == v)
+      break;
+  }
+  r_json_writer_write (writer, tmp, (rsize) n);
+}
+
+/* Separator and indentation before a value; FALSE if none may go here. */
+static rboolean
+r_json_writer_pre_value (RJsonWriter * writer)
+{
+  if (writer->res != R_JSON_OK)
+    return FALSE;
+
+  if (writer->depth == 0) {
+    if (writer->done) {
+      writer->res = R_JSON_WRONG_TYPE;
+      return FALSE;
+    }
+  } else if (writer->kind[writer->depth - 1] == '{') {
+    if (!writer->haskey) {
+      writer->res = R_JSON_WRONG_TYPE;
+      return FALSE;
+    }
+    writer->haskey = FALSE;
+  } else {
+    if (writer->nonempty[writer->depth - 1] && r_json_writer_reserve (writer, 1))
+      *writer->ptr++ = ',';
+    writer->nonempty[writer->depth - 1] = TRUE;
+    r_json_writer_newline (writer);
+  }
+
+  return writer->res == R_JSON_OK;
+}
+
+static RJsonResult
+r_json_writer_post_value (RJsonWriter * writer)
+{
+  if (writer->depth == 0)
+    writer->done = TRUE;
+  return writer->res;
+}
+
+static RJsonResult
+r_json_writer_begin (RJsonWriter * writer, rchar kind)
+{
+  if (!r_json_writer_pre_value (writer))
+    return writer->res;
+  if (writer->depth >= R_JSON_WRITER_MAX_DEPTH)
+    return writer->res = R_JSON_OUT_OF_RANGE;
+
+  if (r_json_writer_reserve (writer, 1)) {
+    *writer->ptr++ = kind;
+    writer->kind[writer->depth] = kind;
+    writer->nonempty[writer->depth] = FALSE;
+    writer->depth++;
+  }
+
+  return writer->res;
+}
+
+static RJsonResult
+r_json_writer_end (RJsonWriter * writer, rchar kind)
+{
+  if (writer->res != R_JSON_OK)
+    return writer->res;
+  if (writer->depth == 0 || writer->kind[writer->depth - 1] != kind || writer->haskey)
+    return writer->res = R_JSON_WRONG_TYPE;
+
+  writer->depth--;
+  if (writer->nonempty[writer->depth])
+    r_json_writer_newline (writer);
+  if (r_json_writer_reserve (writer, 1))
+    *writer->ptr++ = kind == '{' ? '}' : ']';
+
+  return r_json_writer_post_value (writer);
+}
+
+RJsonResult
+r_json_writer_begin_object (RJsonWriter * writer)
+{
+  return r_json_writer_begin (writer, '{');
+}
+
+RJsonResult
+r_json_writer_end_object (RJsonWriter * writer)
+{
+  return r_json_writer_end (writer, '{');
+}
+
+RJsonResult
+r_json_writer_begin_array (RJsonWriter * writer)
+{
+  return r_json_writer_begin (writer, '[');
+}
+
+RJsonResult
+r_json_writer_end_array (RJsonWriter * writer)
+{
+  return r_json_writer_end (writer, '[');
+}
+
+RJsonResult
+r_json_writer_key (RJsonWriter * writer, const rchar * key, rssize len)
+{
+  if (writer->res != R_JSON_OK)
+    return writer->res;
+  if (R_UNLIKELY (key == NULL))
+    return writer->res = R_JSON_INVAL;
+  if (writer->depth == 0 || writer->kind[writer->depth - 1] != '{' || writer->haskey)
+    return writer->res = R_JSON_WRONG_TYPE;
+
+  if (writer->nonempty[writer->depth - 1] && r_json_writer_reserve (writer, 1))
+    *writer->ptr++ = ',';
+  writer->nonempty[writer->depth - 1] = TRUE;
+  r_json_writer_newline (writer);
+
+  r_json_writer_put_string (writer, key, len < 0 ? r_strlen (key) : (rsize) len);
+  if (r_json_writer_reserve (writer, 2)) {
+    *writer->ptr++ = ':';
+    if ((writer->flags & R_JSON_COMPACT) != R_JSON_COMPACT)
+      *writer->ptr++ = ' ';
+  }
+  writer->haskey = TRUE;
+
+  return writer->res;
+}
+
+RJsonResult
+r_json_writer_string (RJsonWriter * writer, const rchar * str, rssize len)
+{
+  if (R_UNLIKELY (str == NULL) && writer->res == R_JSON_OK)
+    return writer->res = R_JSON_INVAL;
+  if (!r_json_writer_pre_value (writer))
+    return writer->res;
+
+  r_json_writer_put_string (writer, str, len < 0 ? r_strlen (str) : (rsize) len);
+  return r_json_writer_post_value (writer);
+}
+
+RJsonResult
+r_json_writer_int (RJsonWriter * writer, rint64 value)
+{
+  if (!r_json_writer_pre_value (writer))
+    return writer->res;
+
+  r_json_writer_put_int (writer, value);
+  return r_json_writer_post_value (writer);
+}
+
+RJsonResult
+r_json_writer_double (RJsonWriter * writer, rdouble value)
+{
+  if (R_UNLIKELY (isnan (value) || isinf (value)) && writer->res == R_JSON_OK)
+    return writer->res = R_JSON_INVAL;
+  if (!r_json_writer_pre_value (writer))
+    return writer->res;
+
+  r_json_writer_put_double (writer, value);
+  return r_json_writer_post_value (writer);
+}
+
+static RJsonResult
+r_json_writer_literal (RJsonWriter * writer, const rchar * lit, rsize len)
+{
+  if (!r_json_writer_pre_value (writer))
+    return writer->res;
+
+  r_json_writer_write (writer, lit, len);
+  return r_json_writer_post_value (writer);
+}
+
+RJsonResult
+r_json_writer_bool (RJsonWriter * writer, rboolean value)
+{
+  return value ? r_json_writer_literal (writer, "true", 4) :
+    r_json_writer_literal (writer, "false", 5);
+}
+
+RJsonResult
+r_json_writer_null (RJsonWriter * writer)
+{
+  return r_json_writer_literal (writer, "null", 4);
+}
+
+RJsonResult
+r_json_writer_value (RJsonWriter * writer, const RJsonValue * value)
+{
+  rsize i;
+
+  if (R_UNLIKELY (value == NULL) && writer->res == R_JSON_OK)
+    return writer->res = R_JSON_INVAL;
+
+  switch (value != NULL ? value->type : R_JSON_TYPE_NONE) {
+    case R_JSON_TYPE_OBJECT:
+      {
+        const RJsonObject * o = (const RJsonObject *) value;
+        const RJsonString * k;
+        const RJsonValue * v;
+
+        r_json_writer_begin_object (writer);
+        for (i = 0; i < o->array.nsize && writer->res == R_JSON_OK; i++) {
+          v = r_kv_ptr_array_get_const (&o->array, i, (rconstpointer *)&k);
+          r_json_writer_key (writer, k->v, (rssize) k->len);
+          r_json_writer_value (writer, v);
+        }
+        return r_json_writer_end_object (writer);
+      }
+    case R_JSON_TYPE_ARRAY:
+      {
+        const RJsonArray * a = (const RJsonArray *) value;
+
+        r_json_writer_begin_array (writer);
+        for (i = 0; i < a->array.nsize && writer->res == R_JSON_OK; i++)
+          r_json_writer_value (writer, r_ptr_array_get_const (&a->array, i));
+        return r_json_writer_end_array (writer);
+      }
+    case R_JSON_TYPE_NUMBER:
+      return r_json_writer_double (writer, ((const RJsonNumber *) value)->v);
+    case R_JSON_TYPE_STRING:
+      return r_json_writer_string (writer,
+          ((const RJsonString *) value)->v, (rssize) ((const RJsonString *) value)->len);
+    case R_JSON_TYPE_TRUE:
+      return r_json_writer_bool (writer, TRUE);
+    case R_JSON_TYPE_FALSE:
+      return r_json_writer_bool (writer, FALSE);
+    case R_JSON_TYPE_NULL:
+      return r_json_writer_null (writer);
+    default:
+      break;
+  }
+
+  return writer->res;
+}
+
+RJsonResult
+r_json_writer_finish (RJsonWriter * writer)
+{
+  RJsonResult ret = writer->res;
+
+  if (ret == R_JSON_OK && !r_json_writer_flush (writer))
+    ret = R_JSON_OOM;
+  /* On error the unflushed segment is dropped, not handed over. */
+  if (writer->buf != NULL)
+    r_free (writer->base);
+
+  if (ret == R_JSON_OK && (writer->depth > 0 || !writer->done))
+    ret = R_JSON_END;
+
+  writer->base = writer->ptr = writer->end = NULL;
+  writer->res = ret != R_JSON_OK ? ret : R_JSON_WRONG_TYPE;
+  return ret;
+}
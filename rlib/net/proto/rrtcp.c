@@ -709,6 +709,248 @@ r_rtcp_buffer_add_fb (RBuffer * buf, RRTCPPacketType pt, ruint8 fmt,
   return res;
 }
 
+/* TWCC packet status symbols and chunk layout. */
+#define R_RTCP_TWCC_NOT_RECEIVED    0
+#define R_RTCP_TWCC_SMALL_DELTA     1
+#define R_RTCP_TWCC_LARGE_DELTA     2
+#define R_RTCP_TWCC_FCI_HDR_SIZE    (2 * sizeof (ruint32))
+#define R_RTCP_TWCC_RUN_MAX         0x1fff
+#define R_RTCP_TWCC_VEC1_SYMBOLS    14
+#define R_RTCP_TWCC_VEC2_SYMBOLS    7
+/* Reference-time units expressed in receive-delta ticks (64 ms / 250 us). */
+#define R_RTCP_TWCC_TICKS_PER_REF   (R_RTCP_TWCC_REF_UNIT / R_RTCP_TWCC_DELTA_UNIT)
+
+rboolean
+r_rtcp_buffer_add_twcc (RBuffer * buf, ruint32 sender, ruint32 media,
+    ruint8 fbcount, ruint16 base_seq, const RClockTime * arrival, ruint16 count)
+{
+  ruint8 * body, * status, * fci, * ptr;
+  rint64 prevtick = 0;
+  ruint64 reftime = 0;
+  rsize bodylen, i, n;
+  rboolean res = FALSE;
+
+  if (R_UNLIKELY (buf == NULL || arrival == NULL || count == 0))
+    return FALSE;
+
+  for (i = 0; i < count; i++) {
+    if (R_CLOCK_TIME_IS_VALID (arrival[i])) {
+      reftime = arrival[i] / R_RTCP_TWCC_REF_UNIT;
+      prevtick = (rint64)reftime * R_RTCP_TWCC_TICKS_PER_REF;
+      break;
+    }
+  }
+
+  /* Worst case: one chunk and a two-octet delta per packet. */
+  bodylen = 2 * sizeof (ruint32) + R_RTCP_TWCC_FCI_HDR_SIZE +
+    (rsize)count * (2 * sizeof (ruint16)) + sizeof (ruint32);
+  if (R_UNLIKELY ((body = r_malloc0 (bodylen + count)) == NULL))
+    return FALSE;
+  status = body + bodylen;
+
+  r_store_be32 (&body[0], sender);
+  r_store_be32 (&body[sizeof (ruint32)], media);
+  fci = body + 2 * sizeof (ruint32);
+  r_store_be16 (&fci[0], base_seq);
+  r_store_be16 (&fci[2], count);
+  r_store_be32 (&fci[4], (ruint32)((reftime & 0xffffff) << 8) | fbcount);
+
+  /* Classify every packet by the size of its receive delta.  Ticks are
+   * taken from the absolute arrival time so rounding never accumulates. */
+  for (i = 0; i < count; i++) {
+    if (R_CLOCK_TIME_IS_VALID (arrival[i])) {
+      rint64 tick = (rint64)((arrival[i] + R_RTCP_TWCC_DELTA_UNIT / 2) /
+          R_RTCP_TWCC_DELTA_UNIT);
+      rint64 delta = tick - prevtick;
+
+      if (delta < RINT16_MIN || delta > RINT16_MAX)
+        goto beach;
+      status[i] = (delta >= 0 && delta <= RUINT8_MAX) ?
+        R_RTCP_TWCC_SMALL_DELTA : R_RTCP_TWCC_LARGE_DELTA;
+      prevtick = tick;
+    } else {
+      status[i] = R_RTCP_TWCC_NOT_RECEIVED;
+    }
+  }
+
+  /* Packet chunks: long runs of one symbol become run-length chunks, the
+   * rest one-bit (no large deltas) or two-bit status vectors. */
+  ptr = fci + R_RTCP_TWCC_FCI_HDR_SIZE;
+  for (i = 0; i < count; i += n) {
+    rsize run, j;
+    ruint16 chunk;
+
+    for (run = 1; i + run < count && status[i + run] == status[i] &&
+        run < R_RTCP_TWCC_RUN_MAX; run++);
+
+    if (run < R_RTCP_TWCC_VEC1_SYMBOLS) {
+      rboolean onebit = TRUE;
+      for (j = i; j < count && j < i + R_RTCP_TWCC_VEC1_SYMBOLS; j++) {
+        if (status[j] == R_RTCP_TWCC_LARGE_DELTA) {
+          onebit = FALSE;
+          break;
+        }
+      }
+
+      if (onebit) {
+        n = R_RTCP_TWCC_VEC1_SYMBOLS;
+        for (chunk = 0x8000, j = 0; j < n && i + j < count; j++)
+          chunk |= (ruint16)(status[i + j] << (13 - j));
+        r_store_be16 (ptr, chunk);
+        ptr += sizeof (ruint16);
+        continue;
+      } else if (run < R_RTCP_TWCC_VEC2_SYMBOLS) {
+        n = R_RTCP_TWCC_VEC2_SYMBOLS;
+        for (chunk = 0xc000, j = 0; j < n && i + j < count; j++)
+          chunk |= (ruint16)(status[i + j] << (12 - 2 * j));
+        r_store_be16 (ptr, chunk);
+        ptr += sizeof (ruint16);
+        continue;
+      }
+    }
+
+    n = run;
+    r_store_be16 (ptr, (ruint16)((status[i] << 13) | run));
+    ptr += sizeof (ruint16);
+  }
+
+  /* Receive deltas, in packet order, for every received packet. */
+  prevtick = (rint64)reftime * R_RTCP_TWCC_TICKS_PER_REF;
+  for (i = 0; i < count; i++) {
+    rint64 tick;
+
+    if (status[i] == R_RTCP_TWCC_NOT_RECEIVED)
+      continue;
+    tick = (rint64)((arrival[i] + R_RTCP_TWCC_DELTA_UNIT / 2) /
+        R_RTCP_TWCC_DELTA_UNIT);
+    if (status[i] == R_RTCP_TWCC_SMALL_DELTA) {
+      *ptr++ = (ruint8)(tick - prevtick);
+    } else {
+      r_store_be16 (ptr, (ruint16)(rint16)(tick - prevtick));
+      ptr += sizeof (ruint16);
+    }
+    prevtick = tick;
+  }
+
+  /* Zero padding (already cleared) up to the next 32-bit boundary. */
+  bodylen = (((rsize)(ptr - body)) + 3) & ~(rsize)3;
+  res = r_rtcp_append (buf, R_RTCP_PT_RTPFB, R_RTCP_RTPFB_FMT_TWCC,
+      body, bodylen);
+
+beach:
+  r_free (body);
+  return res;
+}
+
+static const ruint8 *
+r_rtcp_packet_twcc_get_fci (const RRTCPPacket * packet, ruint16 * size)
+{
+  const ruint8 * fci;
+
+  if (r_rtcp_packet_get_type (packet) != R_RTCP_PT_RTPFB ||
+      r_rtcp_packet_fb_get_fmt (packet) != R_RTCP_RTPFB_FMT_TWCC)
+    return NULL;
+  if ((fci = r_rtcp_packet_fb_get_fci (packet, size)) == NULL ||
+      *size < R_RTCP_TWCC_FCI_HDR_SIZE)
+    return NULL;
+
+  return fci;
+}
+
+rboolean
+r_rtcp_packet_twcc_get_info (const RRTCPPacket * packet, RRTCPTWCCInfo * info)
+{
+  const ruint8 * fci;
+  ruint16 size;
+
+  if (R_UNLIKELY (info == NULL))
+    return FALSE;
+  if ((fci = r_rtcp_packet_twcc_get_fci (packet, &size)) == NULL)
+    return FALSE;
+
+  info->base_seq = r_load_be16 (&fci[0]);
+  info->count = r_load_be16 (&fci[2]);
+  info->reftime = r_load_be32 (&fci[4]) >> 8;
+  info->fbcount = fci[7];
+  return TRUE;
+}
+
+RRTCPParseResult
+r_rtcp_packet_twcc_get_arrivals (const RRTCPPacket * packet,
+    RClockTime * arrival, rsize len)
+{
+  const ruint8 * fci, * ptr, * end;
+  RRTCPTWCCInfo info;
+  ruint16 size;
+  rint64 tick;
+  rsize i, n;
+
+  if (R_UNLIKELY (arrival == NULL))
+    return R_RTCP_PARSE_INVAL;
+  if ((fci = r_rtcp_packet_twcc_get_fci (packet, &size)) == NULL ||
+      !r_rtcp_packet_twcc_get_info (packet, &info))
+    return R_RTCP_PARSE_WRONG_PT;
+  if (len < info.count)
+    return R_RTCP_PARSE_BUF_TOO_SMALL;
+
+  ptr = fci + R_RTCP_TWCC_FCI_HDR_SIZE;
+  end = fci + size;
+
+  /* First pass: expand the packet chunks into per-packet status symbols,
+   * parked in @arrival until the deltas are walked. */
+  for (n = 0; n < info.count; ) {
+    ruint16 chunk;
+
+    if (ptr + sizeof (ruint16) > end)
+      return R_RTCP_PARSE_OVERFLOW;
+    chunk = r_load_be16 (ptr);
+    ptr += sizeof (ruint16);
+
+    if ((chunk & 0x8000) == 0) {
+      ruint8 sym = (chunk >> 13) & 0x3;
+      rsize run = chunk & R_RTCP_TWCC_RUN_MAX;
+      if (sym > R_RTCP_TWCC_LARGE_DELTA)
+        return R_RTCP_PARSE_UNEXPECTED;
+      for (i = 0; i < run && n < info.count; i++)
+        arrival[n++] = sym;
+    } else if ((chunk & 0x4000) == 0) {
+      for (i = 0; i < R_RTCP_TWCC_VEC1_SYMBOLS && n < info.count; i++)
+        arrival[n++] = (chunk >> (13 - i)) & 0x1;
+    } else {
+      for (i = 0; i < R_RTCP_TWCC_VEC2_SYMBOLS && n < info.count; i++) {
+        ruint8 sym = (chunk >> (12 - 2 * i)) & 0x3;
+        if (sym > R_RTCP_TWCC_LARGE_DELTA)
+          return R_RTCP_PARSE_UNEXPECTED;
+        arrival[n++] = sym;
+      }
+    }
+  }
+
+  /* Second pass: accumulate the receive deltas onto the reference time. */
+  tick = (rint64)info.reftime * R_RTCP_TWCC_TICKS_PER_REF;
+  for (i = 0; i < info.count; i++) {
+    switch (arrival[i]) {
+      case R_RTCP_TWCC_SMALL_DELTA:
+        if (ptr + sizeof (ruint8) > end)
+          return R_RTCP_PARSE_OVERFLOW;
+        tick += *ptr++;
+        break;
+      case R_RTCP_TWCC_LARGE_DELTA:
+        if (ptr + sizeof (ruint16) > end)
+          return R_RTCP_PARSE_OVERFLOW;
+        tick += (rint16)r_load_be16 (ptr);
+        ptr += sizeof (ruint16);
+        break;
+      default:
+        arrival[i] = R_CLOCK_TIME_NONE;
+        continue;
+    }
+    arrival[i] = tick > 0 ? (RClockTime)tick * R_RTCP_TWCC_DELTA_UNIT : 0;
+  }
+
+  return R_RTCP_PARSE_OK;
+}
+
 rboolean
 r_rtcp_buffer_add_packet (RBuffer * buf, const RRTCPPacket * packet)
 {
@@ -347,6 +347,58 @@ r_rtp_buffer_get_extension (const RRTPBuffer * rtp, ruint16 * profile,
   return TRUE;
 }
 
+rboolean
+r_rtp_buffer_get_hdrext_element (const RRTPBuffer * rtp, ruint8 id,
+    ruint8 ** out, rsize * outsize)
+{
+  ruint16 profile, size;
+  const ruint8 * data;
+  rsize p = 0;
+
+  if (id == 0 || !r_rtp_buffer_get_extension (rtp, &profile, &data, &size))
+    return FALSE;
+
+  if (profile == 0xBEDE) {
+    while (p < size) {
+      ruint8 eid = data[p] >> 4;
+      ruint8 elen = (data[p] & 0x0F) + 1;
+      p++;
+      if (eid == 0)             /* padding */
+        continue;
+      if (eid == 15)            /* reserved: stop parsing (RFC 8285 4.2) */
+        break;
+      if (p + elen > size)
+        break;
+      if (eid == id) {
+        *out = (ruint8 *)data + p;
+        *outsize = elen;
+        return TRUE;
+      }
+      p += elen;
+    }
+  } else if ((profile & 0xFFF0) == 0x1000) {
+    while (p < size) {
+      ruint8 eid = data[p++];
+      ruint8 elen;
+      if (eid == 0)             /* padding */
+        continue;
+      if (p >= size)            /* truncated: missing length octet */
+        break;
+      elen = data[p++];
+      if (p + elen > size)
+        break;
+      if (eid == id) {
+        *out = (ruint8 *)data + p;
+        *outsize = elen;
+        return TRUE;
+      }
+      p += elen;
+    }
+  }
+
+  return FALSE;
+}
+
 rboolean
 r_rtp_buffer_has_marker (const RRTPBuffer * rtp)
 {
@@ -472,3 +524,45 @@ r_rtp_buffer_estimate_seq_idx (RRTPBuffer * rtp, ruint64 curidx)
   return r_rtp_estimate_seq_idx (r_rtp_buffer_get_seq (rtp), curidx);
 }
 
+
+rboolean
+r_rtp_transport_cc_ext_write (ruint8 * ext, ruint8 id, ruint16 seq)
+{
+  if (R_UNLIKELY (ext == NULL || id == 0 || id >= 15))
+    return FALSE;
+
+  /* [id | len-1] seq(16) + one octet of padding to fill the word. */
+  ext[0] = (ruint8)((id << 4) | (sizeof (ruint16) - 1));
+  r_store_be16 (&ext[1], seq);
+  ext[3] = 0;
+  return TRUE;
+}
+
+rboolean
+r_rtp_buffer_get_transport_cc (const RRTPBuffer * rtp, ruint8 id, ruint16 * seq)
+{
+  ruint8 * val;
+  rsize size;
+
+  if (!r_rtp_buffer_get_hdrext_element (rtp, id, &val, &size) ||
+      size != sizeof (ruint16))
+    return FALSE;
+
+  if (seq != NULL)
+    *seq = r_load_be16 (val);
+  return TRUE;
+}
+
+rboolean
+r_rtp_buffer_set_transport_cc (RRTPBuffer * rtp, ruint8 id, ruint16 seq)
+{
+  ruint8 * val;
+  rsize size;
+
+  if (!r_rtp_buffer_get_hdrext_element (rtp, id, &val, &size) ||
+      size != sizeof (ruint16))
+    return FALSE;
+
+  r_store_be16 (val, seq);
+  return TRUE;
+}
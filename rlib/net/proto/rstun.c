@@ -138,14 +138,14 @@ r_stun_msg_add_xor_address (RStunMsgCtx * ctx, RStunAttrType type,
 }
 
 rboolean
-r_stun_msg_add_message_integrity_short_cred (RStunMsgCtx * ctx,
-    rconstpointer key, rsize keysize)
+r_stun_msg_add_message_integrity_hmac (RStunMsgCtx * ctx, RHmac * hmac)
 {
   RStunAttrTLV tlv;
   ruint8 val[R_STUN_MSG_INTEGRITY_SIZE];
-  RHmac * hmac;
   rboolean ret = FALSE;
 
+  if (R_UNLIKELY (hmac == NULL)) return FALSE;
+
   tlv.start = NULL;
   tlv.type = R_STUN_ATTR_TYPE_MESSAGE_INTEGRITY;
   tlv.len = sizeof (val);
@@ -154,19 +154,32 @@ r_stun_msg_add_message_integrity_short_cred (RStunMsgCtx * ctx,
   if (ctx->alloc_size - ctx->used_size >= R_STUN_ATTR_TLV_HEADER_SIZE + R_STUN_MSG_INTEGRITY_SIZE) {
     /* Update message len including the MESSAGE-INTEGRITY attribute */
     ruint16 l = ctx->used_size + R_STUN_ATTR_TLV_HEADER_SIZE + tlv.len - R_STUN_HEADER_SIZE;
+    rsize datasize;
     *(ruint16 *)&ctx->buf[R_STUN_MSGLEN_OFFSET] = RUINT16_TO_BE (l);
 
-    if ((hmac = r_hmac_new (R_MSG_DIGEST_TYPE_SHA1, key, keysize)) != NULL) {
-      rsize datasize;
-      if (r_hmac_update (hmac, ctx->buf, ctx->used_size) &&
-          r_hmac_get_data (hmac, val, sizeof (val), &datasize))
-        ret = r_stun_msg_add_attribute (ctx, &tlv);
-      r_hmac_free (hmac);
-    }
+    r_hmac_reset (hmac);
+    if (r_hmac_update (hmac, ctx->buf, ctx->used_size) &&
+        r_hmac_get_data (hmac, val, sizeof (val), &datasize))
+      ret = r_stun_msg_add_attribute (ctx, &tlv);
   }
   return ret;
 }
 
+rboolean
+r_stun_msg_add_message_integrity_short_cred (RStunMsgCtx * ctx,
+    rconstpointer key, rsize keysize)
+{
+  RHmac * hmac;
+  rboolean ret;
+
+  if ((hmac = r_hmac_new (R_MSG_DIGEST_TYPE_SHA1, key, keysize)) == NULL)
+    return FALSE;
+
+  ret = r_stun_msg_add_message_integrity_hmac (ctx, hmac);
+  r_hmac_free (hmac);
+  return ret;
+}
+
 rboolean
 r_stun_msg_add_error_code (RStunMsgCtx * ctx, ruint code, const rchar * reason)
 {
@@ -478,33 +491,43 @@ r_stun_attr_tlv_parse_error_code (rconstpointer buf, const RStunAttrTLV * tlv)
 }
 
 rboolean
-r_stun_msg_check_integrity_short_cred (rconstpointer buf,
-    const RStunAttrTLV * tlv, rconstpointer key, rsize keysize)
+r_stun_msg_check_integrity_hmac (rconstpointer buf,
+    const RStunAttrTLV * tlv, RHmac * hmac)
 {
-  RHmac * hmac;
-  rboolean ret;
   rsize len;
+  ruint16 be;
 
+  if (R_UNLIKELY (hmac == NULL)) return FALSE;
   if (R_UNLIKELY (tlv->type != R_STUN_ATTR_TYPE_MESSAGE_INTEGRITY)) return FALSE;
   if (R_UNLIKELY (tlv->len != R_STUN_MSG_INTEGRITY_SIZE)) return FALSE;
 
   len = (ruint16)(tlv->start - (const ruint8 *)buf);
   if (R_UNLIKELY (len <= R_STUN_HEADER_SIZE)) return FALSE;
 
-  if ((hmac = r_hmac_new (R_MSG_DIGEST_TYPE_SHA1, key, keysize)) != NULL) {
-    ruint16 be = RUINT16_TO_BE ((ruint16)len +
-        R_STUN_ATTR_TLV_HEADER_SIZE + tlv->len - R_STUN_HEADER_SIZE);
-
-    ret = r_hmac_update (hmac, buf, R_STUN_MSGLEN_OFFSET) &&
-          r_hmac_update (hmac, &be, sizeof (ruint16)) &&
-          r_hmac_update (hmac, ((const ruint8 *)buf) + R_STUN_MAGIC_COOKIE_OFFSET,
-            len - (R_STUN_MSGLEN_OFFSET + sizeof (ruint16))) &&
-          r_hmac_verify (hmac, tlv->value, tlv->len);
-    r_hmac_free (hmac);
-  } else {
-    ret = FALSE;
-  }
+  be = RUINT16_TO_BE ((ruint16)len +
+      R_STUN_ATTR_TLV_HEADER_SIZE + tlv->len - R_STUN_HEADER_SIZE);
+
+  r_hmac_reset (hmac);
+  return r_hmac_update (hmac, buf, R_STUN_MSGLEN_OFFSET) &&
+    r_hmac_update (hmac, &be, sizeof (ruint16)) &&
+    r_hmac_update (hmac, ((const ruint8 *)buf) + R_STUN_MAGIC_COOKIE_OFFSET,
+        len - (R_STUN_MSGLEN_OFFSET + sizeof (ruint16))) &&
+    r_hmac_verify (hmac, tlv->value, tlv->len);
+}
+
+rboolean
+r_stun_msg_check_integrity_short_cred (rconstpointer buf,
+    const RStunAttrTLV * tlv, rconstpointer key, rsize keysize)
+{
+  RHmac * hmac;
+  rboolean ret;
 
+  if (R_UNLIKELY (tlv->type != R_STUN_ATTR_TYPE_MESSAGE_INTEGRITY)) return FALSE;
+  if ((hmac = r_hmac_new (R_MSG_DIGEST_TYPE_SHA1, key, keysize)) == NULL)
+    return FALSE;
+
+  ret = r_stun_msg_check_integrity_hmac (buf, tlv, hmac);
+  r_hmac_free (hmac);
   return ret;
 }
 
@@ -520,3 +543,128 @@ r_stun_msg_calc_fingerprint (rconstpointer buf, const RStunAttrTLV * tlv)
   return crc ^ R_STUN_FINGERPRINT_XOR;
 }
 
+/* Binding success response layout; offsets of the variable parts. */
+#define R_STUN_BINDING_XMA_OFFSET     (R_STUN_HEADER_SIZE + R_STUN_ATTR_TLV_HEADER_SIZE)
+#define R_STUN_BINDING_V4_MI_OFFSET   (R_STUN_BINDING_XMA_OFFSET + 8)
+#define R_STUN_BINDING_V6_MI_OFFSET   (R_STUN_BINDING_XMA_OFFSET + 20)
+#define R_STUN_BINDING_MI_SIZE        (R_STUN_ATTR_TLV_HEADER_SIZE + R_STUN_MSG_INTEGRITY_SIZE)
+#define R_STUN_BINDING_FP_SIZE        (R_STUN_ATTR_TLV_HEADER_SIZE + sizeof (ruint32))
+#define R_STUN_BINDING_V4_SIZE        (R_STUN_BINDING_V4_MI_OFFSET + R_STUN_BINDING_MI_SIZE + R_STUN_BINDING_FP_SIZE)
+#define R_STUN_BINDING_V6_SIZE        (R_STUN_BINDING_V6_MI_OFFSET + R_STUN_BINDING_MI_SIZE + R_STUN_BINDING_FP_SIZE)
+
+struct RStunBindingResponder {
+  RHmac * hmac;
+  ruint8 v4[R_STUN_BINDING_V4_SIZE];
+  ruint8 v6[R_STUN_BINDING_V6_SIZE];
+};
+
+/* Lay out everything but the transaction ID, the address and the two
+ * trailing values. The length field holds the MESSAGE-INTEGRITY length
+ * until the HMAC is computed. */
+static void
+r_stun_binding_template_init (ruint8 * tmpl, ruint8 family, rsize mioff)
+{
+  *(ruint16 *)&tmpl[0] = RUINT16_TO_BE (R_STUN_CLASS_SUCCESS_RESPONSE | R_STUN_METHOD_BINDING);
+  *(ruint16 *)&tmpl[R_STUN_MSGLEN_OFFSET] =
+    RUINT16_TO_BE (mioff + R_STUN_BINDING_MI_SIZE - R_STUN_HEADER_SIZE);
+  *(ruint32 *)&tmpl[R_STUN_MAGIC_COOKIE_OFFSET] = RUINT32_TO_BE (R_STUN_MAGIC_COOKIE);
+
+  *(ruint16 *)&tmpl[R_STUN_HEADER_SIZE] = RUINT16_TO_BE (R_STUN_ATTR_TYPE_XOR_MAPPED_ADDRESS);
+  *(ruint16 *)&tmpl[R_STUN_HEADER_SIZE + 2] =
+    RUINT16_TO_BE (mioff - R_STUN_BINDING_XMA_OFFSET);
+  tmpl[R_STUN_BINDING_XMA_OFFSET + 0] = 0;
+  tmpl[R_STUN_BINDING_XMA_OFFSET + 1] = family;
+
+  *(ruint16 *)&tmpl[mioff] = RUINT16_TO_BE (R_STUN_ATTR_TYPE_MESSAGE_INTEGRITY);
+  *(ruint16 *)&tmpl[mioff + 2] = RUINT16_TO_BE (R_STUN_MSG_INTEGRITY_SIZE);
+  *(ruint16 *)&tmpl[mioff + R_STUN_BINDING_MI_SIZE] = RUINT16_TO_BE (R_STUN_ATTR_TYPE_FINGERPRINT);
+  *(ruint16 *)&tmpl[mioff + R_STUN_BINDING_MI_SIZE + 2] = RUINT16_TO_BE (sizeof (ruint32));
+}
+
+RStunBindingResponder *
+r_stun_binding_responder_new (rconstpointer key, rsize keysize)
+{
+  RStunBindingResponder * ret;
+
+  if ((ret = r_mem_new0 (RStunBindingResponder)) != NULL) {
+    if ((ret->hmac = r_hmac_new (R_MSG_DIGEST_TYPE_SHA1, key, keysize)) == NULL) {
+      r_free (ret);
+      return NULL;
+    }
+    r_stun_binding_template_init (ret->v4, 1, R_STUN_BINDING_V4_MI_OFFSET);
+    r_stun_binding_template_init (ret->v6, 2, R_STUN_BINDING_V6_MI_OFFSET);
+  }
+
+  return ret;
+}
+
+void
+r_stun_binding_responder_free (RStunBindingResponder * resp)
+{
+  if (resp != NULL) {
+    r_hmac_free (resp->hmac);
+    r_free (resp);
+  }
+}
+
+rsize
+r_stun_binding_responder_build (RStunBindingResponder * resp,
+    rpointer buf, rsize size, const ruint8 transaction_id[R_STUN_TRANSACTION_ID_SIZE],
+    const RSocketAddress * addr)
+{
+  ruint8 * ptr = buf, * xma;
+  ruint8 ip[16];
+  rsize mioff, ret, datasize, i;
+  ruint32 crc;
+
+  if (R_UNLIKELY (resp == NULL || buf == NULL || addr == NULL)) return 0;
+
+  switch (r_socket_address_get_family (addr)) {
+    case R_SOCKET_FAMILY_IPV4:
+      if (R_UNLIKELY (size < (ret = R_STUN_BINDING_V4_SIZE))) return 0;
+      mioff = R_STUN_BINDING_V4_MI_OFFSET;
+      r_memcpy (ptr, resp->v4, ret);
+      xma = ptr + R_STUN_BINDING_XMA_OFFSET;
+      *(ruint16 *)&xma[2] = RUINT16_TO_BE (r_socket_address_ipv4_get_port (addr) ^
+          (R_STUN_MAGIC_COOKIE >> 16));
+      *(ruint32 *)&xma[4] = RUINT32_TO_BE (r_socket_address_ipv4_get_ip (addr) ^
+          R_STUN_MAGIC_COOKIE);
+      r_memcpy (ptr + R_STUN_TRANSACTION_ID_OFFSET, transaction_id, R_STUN_TRANSACTION_ID_SIZE);
+      break;
+    case R_SOCKET_FAMILY_IPV6:
+      if (R_UNLIKELY (size < (ret = R_STUN_BINDING_V6_SIZE))) return 0;
+      if (!r_socket_address_ipv6_get_ip_bytes (addr, ip)) return 0;
+      mioff = R_STUN_BINDING_V6_MI_OFFSET;
+      r_memcpy (ptr, resp->v6, ret);
+      r_memcpy (ptr + R_STUN_TRANSACTION_ID_OFFSET, transaction_id, R_STUN_TRANSACTION_ID_SIZE);
+      xma = ptr + R_STUN_BINDING_XMA_OFFSET;
+      *(ruint16 *)&xma[2] = RUINT16_TO_BE (r_socket_address_ipv6_get_port (addr) ^
+          (R_STUN_MAGIC_COOKIE >> 16));
+      /* X-Address = address XOR (magic cookie || transaction id). */
+      for (i = 0; i < 16; i++)
+        xma[4 + i] = ip[i] ^ ptr[R_STUN_MAGIC_COOKIE_OFFSET + i];
+      break;
+    default:
+      return 0;
+  }
+
+  r_hmac_reset (resp->hmac);
+  if (!r_hmac_update (resp->hmac, ptr, mioff) ||
+      !r_hmac_get_data (resp->hmac, ptr + mioff + R_STUN_ATTR_TLV_HEADER_SIZE,
+        R_STUN_MSG_INTEGRITY_SIZE, &datasize))
+    return 0;
+
+  *(ruint16 *)&ptr[R_STUN_MSGLEN_OFFSET] = RUINT16_TO_BE (ret - R_STUN_HEADER_SIZE);
+  crc = r_crc32 (ptr, ret - R_STUN_BINDING_FP_SIZE) ^ R_STUN_FINGERPRINT_XOR;
+  *(ruint32 *)&ptr[ret - sizeof (ruint32)] = RUINT32_TO_BE (crc);
+
+  return ret;
+}
+
+rboolean
+r_stun_binding_responder_check_integrity (RStunBindingResponder * resp,
+    rconstpointer buf, const RStunAttrTLV * tlv)
+{
+  if (R_UNLIKELY (resp == NULL)) return FALSE;
+  return r_stun_msg_check_integrity_hmac (buf, tlv, resp->hmac);
+}
@@ -450,7 +450,7 @@ r_tls_parser_init_buffer (RTLSParser * parser, RBuffer * buf)
     r_buffer_unmap (buf, &dtlsext);
   }
 
-  if ((fraglen & 0xc000) > 0) {
+  if (fraglen > R_TLS_MAX_CIPHERTEXT) {
     ret = R_TLS_ERROR_RECORD_OVERFLOW;
     goto beach;
   }
@@ -1798,6 +1798,77 @@ r_dtls_encrypt_buffer_aead (RBuffer * buf, const RCryptoCipher * cipher,
   return ret;
 }
 
+rsize
+r_tls_aead_record_overhead (const RCryptoCipher * cipher, rsize * prefix)
+{
+  rsize pre, tagsize;
+
+  if (R_UNLIKELY (cipher == NULL)) return 0;
+
+  if (cipher->info->mode == R_CRYPTO_CIPHER_MODE_POLY1305) {
+    pre = R_TLS_RECORD_HDR_SIZE;
+    tagsize = R_CHACHA20POLY1305_TAG_SIZE;
+  } else if (cipher->info->mode == R_CRYPTO_CIPHER_MODE_GCM) {
+    pre = R_TLS_RECORD_HDR_SIZE + R_TLS_AEAD_EXPLICIT_NONCE_SIZE;
+    tagsize = cipher->info->blocksize;
+  } else {
+    return 0;
+  }
+
+  if (prefix != NULL)
+    *prefix = pre;
+  return pre + tagsize;
+}
+
+rboolean
+r_tls_seal_record_aead (ruint8 * out, rsize outsize, rsize * reclen,
+    RTLSContentType type, RTLSVersion version,
+    const ruint8 * plain, rsize plainlen, ruint64 seqno,
+    const RCryptoCipher * cipher, const ruint8 * salt)
+{
+  ruint8 seqbe[sizeof (ruint64)];
+  ruint8 nonce[R_TLS_AEAD_NONCE_SIZE_MAX];
+  ruint8 aad[R_TLS_AEAD_AAD_SIZE];
+  rsize prefix = 0, overhead, i;
+
+  if (R_UNLIKELY (out == NULL || reclen == NULL || salt == NULL)) return FALSE;
+  if (R_UNLIKELY (plain == NULL && plainlen > 0)) return FALSE;
+  if ((overhead = r_tls_aead_record_overhead (cipher, &prefix)) == 0)
+    return FALSE;
+  if (R_UNLIKELY (cipher->info->ivsize != R_TLS_AEAD_NONCE_SIZE_MAX))
+    return FALSE;
+  if (R_UNLIKELY (plainlen + overhead - R_TLS_RECORD_HDR_SIZE > RUINT16_MAX ||
+        outsize < plainlen + overhead))
+    return FALSE;
+
+  /* Header and explicit nonce land ahead of the plaintext, so sealing in
+   * place never overwrites what is still to be read. */
+  out[0] = (ruint8) type;
+  r_store_be16 (out + 1, (ruint16) version);
+  r_store_be16 (out + 3, (ruint16) (plainlen + overhead - R_TLS_RECORD_HDR_SIZE));
+  r_store_be64 (seqbe, seqno);
+  r_tls_aead_aad (aad, seqbe, out, plainlen);
+
+  if (cipher->info->mode == R_CRYPTO_CIPHER_MODE_POLY1305) {
+    r_memcpy (nonce, salt, R_TLS_AEAD_NONCE_SIZE_MAX);
+    for (i = 0; i < sizeof (ruint64); i++)
+      nonce[R_TLS_AEAD_NONCE_SIZE_MAX - sizeof (ruint64) + i] ^= seqbe[i];
+  } else {
+    rsize saltsize = R_TLS_AEAD_NONCE_SIZE_MAX - R_TLS_AEAD_EXPLICIT_NONCE_SIZE;
+    r_memcpy (out + R_TLS_RECORD_HDR_SIZE, seqbe, sizeof (seqbe));
+    r_memcpy (nonce, salt, saltsize);
+    r_memcpy (nonce + saltsize, seqbe, sizeof (seqbe));
+  }
+
+  if (r_crypto_cipher_encrypt_aead (cipher, out + prefix, plainlen, plain,
+        aad, sizeof (aad), nonce, sizeof (nonce),
+        out + prefix + plainlen, overhead - prefix) != R_CRYPTO_CIPHER_OK)
+    return FALSE;
+
+  *reclen = plainlen + overhead;
+  return TRUE;
+}
+
 static RTLSError
 r_tls_parser_parse_handshake_internal (const RTLSParser * parser,
     RTLSHandshakeType * type, const ruint8 ** body, const ruint8 ** end)
@@ -420,6 +420,7 @@ static const RTLSCallbacks g__r_http_client_tls_callbacks = {
   r_http_client_tls_verify,              /* verify_cert */
   r_http_client_tls_closed,              /* closed */
   NULL,                                  /* post_handshake_auth */
+  NULL,                                  /* priv_key_op */
 };
 
 static RHttpClientConn *
@@ -62,6 +62,9 @@ struct RHttpServer {
   /* The handler context being dispatched, so r_http_server_get_peer_cert
    * can reach the connection's verified client certificate. */
   RHttpServerHandlerCtx * cur;
+  /* Try kernel TLS for the sending / receiving direction of HTTPS connections. */
+  rboolean ktls_tx;
+  rboolean ktls_rx;
 };
 
 typedef struct {
@@ -71,6 +74,8 @@ typedef struct {
 
   RTLSServer * tls;     /* per-connection TLS engine; NULL for plaintext */
   RHttpVhost * vhost;   /* SNI-selected vhost for this connection, or NULL */
+  rboolean ktls_settled;        /* kTLS is on, or will not be: stop trying */
+  rboolean ktls_rx_settled;     /* likewise for receiving */
 
   RHttpRequest * req;
   rssize bodysize;
@@ -147,6 +152,48 @@ r_http_client_ctx_response_sent (rpointer data, RBuffer * buf, REvTCP * evtcp)
   r_http_client_ctx_close (ctx, NULL, NULL);
 }
 
+static rboolean
+r_http_client_ctx_tls_tx_record (rpointer data, RTLSContentType type,
+    RBuffer * buf, rpointer session)
+{
+  RHttpClientCtx * ctx = data;
+  (void) session;
+
+  if (type == R_TLS_CONTENT_TYPE_APPLICATION_DATA)
+    return r_ev_tcp_send_and_forget (ctx->evtcp, buf);
+  return r_ev_tcp_send_ktls_record (ctx->evtcp, type, buf, NULL, NULL, NULL);
+}
+
+static rboolean
+r_http_client_ctx_tls_tx_keys (rpointer data, const RTLSTrafficKeys * keys,
+    rpointer session)
+{
+  RHttpClientCtx * ctx = data;
+  RSocketStatus res;
+  (void) session;
+
+  /* Handshake records still queued: try again with the next response. */
+  if ((res = r_ev_tcp_set_ktls_tx (ctx->evtcp, keys)) == R_SOCKET_WOULD_BLOCK)
+    ctx->ktls_settled = FALSE;
+  return res == R_SOCKET_OK;
+}
+
+/* Move sealing to the kernel ahead of the response where it can; the
+ * session keeps sealing itself where it cannot. */
+static void
+r_http_client_ctx_try_ktls_tx (RHttpClientCtx * ctx)
+{
+  if (!ctx->server->ktls_tx || ctx->ktls_settled)
+    return;
+
+  ctx->ktls_settled = TRUE;
+  if (r_tls_server_set_tx_offload (ctx->tls, r_http_client_ctx_tls_tx_record,
+        r_http_client_ctx_tls_tx_keys) == R_TLS_ERROR_OK) {
+    R_LOG_DEBUG ("%p: kTLS on "R_EV_IO_FORMAT, ctx->server,
+        R_EV_IO_ARGS (ctx->evtcp));
+  }
+}
+
 static void
 r_http_client_ctx_tcp_response_ready (rpointer data, RHttpResponse * res,
     RHttpServer * server)
@@ -176,6 +223,7 @@ r_http_client_ctx_tcp_response_ready (rpointer data, RHttpResponse * res,
     R_LOG_BUF_DUMP (R_LOG_LEVEL_TRACE, buf);
 
     if (ctx->tls != NULL) {
+      r_http_client_ctx_try_ktls_tx (ctx);
       /* send_appdata flushes encrypted records via the out callback. On close,
        * the queued response + close_notify drain through r_ev_tcp_close's
        * graceful flush before the FIN. This runs from the deferred handler
@@ -789,8 +837,53 @@ static const RTLSCallbacks g__r_http_tls_callbacks = {
   r_http_client_ctx_tls_verify_peer, /* verify_cert (mutual TLS) */
   r_http_client_ctx_tls_closed,      /* closed */
   NULL,                              /* post_handshake_auth */
+  NULL,                              /* priv_key_op */
 };
 
+static void
+r_http_client_ctx_tls_record (rpointer data, RTLSContentType type,
+    RBuffer * buf, REvTCP * evtcp)
+{
+  RHttpClientCtx * ctx = data;
+  (void) evtcp;
+
+  /* Same callback chain as r_http_client_ctx_tls_recv, already opened. */
+  r_ref_ref (ctx);
+  r_tls_server_incoming_record (ctx->tls, type, buf);
+  r_ref_unref (ctx);
+}
+
+static rboolean
+r_http_client_ctx_tls_rx_keys (rpointer data, const RTLSTrafficKeys * keys,
+    rpointer session)
+{
+  RHttpClientCtx * ctx = data;
+  (void) session;
+
+  return r_ev_tcp_set_ktls_rx (ctx->evtcp, keys,
+      r_http_client_ctx_tls_record) == R_SOCKET_OK;
+}
+
+/* Move opening to the kernel once the handshake is done and we stand at
+ * a record boundary; until then (WRONG_STATE) try again after each read. */
+static void
+r_http_client_ctx_try_ktls_rx (RHttpClientCtx * ctx)
+{
+  RTLSError err;
+
+  if (!ctx->server->ktls_rx || ctx->ktls_rx_settled)
+    return;
+
+  err = r_tls_server_set_rx_offload (ctx->tls, r_http_client_ctx_tls_rx_keys);
+  if (err == R_TLS_ERROR_WRONG_STATE)
+    return;
+  ctx->ktls_rx_settled = TRUE;
+  if (err == R_TLS_ERROR_OK) {
+    R_LOG_DEBUG ("%p: kTLS receive on "R_EV_IO_FORMAT, ctx->server,
+        R_EV_IO_ARGS (ctx->evtcp));
+  }
+}
+
 static void
 r_http_client_ctx_tls_recv (rpointer data, RBuffer * buf, REvTCP * evtcp)
 {
@@ -807,6 +900,7 @@ r_http_client_ctx_tls_recv (rpointer data, RBuffer * buf, REvTCP * evtcp)
    * error/closed callbacks; hold a reference so the ctx survives the chain. */
   r_ref_ref (ctx);
   r_tls_server_incoming_data (ctx->tls, buf);
+  r_http_client_ctx_try_ktls_rx (ctx);
   r_ref_unref (ctx);
 }
 
@@ -946,6 +1040,20 @@ r_http_server_get_client_cert_mode (RHttpServer * server)
   return server != NULL ? server->client_cert_mode : R_TLS_CLIENT_CERT_MODE_NONE;
 }
 
+void
+r_http_server_set_ktls_tx (RHttpServer * server, rboolean enable)
+{
+  if (R_UNLIKELY (server == NULL)) return;
+  server->ktls_tx = enable;
+}
+
+void
+r_http_server_set_ktls_rx (RHttpServer * server, rboolean enable)
+{
+  if (R_UNLIKELY (server == NULL)) return;
+  server->ktls_rx = enable;
+}
+
 void
 r_http_server_set_client_trust_store (RHttpServer * server, RTrustStore * store)
 {
@@ -22,6 +22,10 @@
 
 #include <rlib/rio.h>
 
+#if defined (HAVE_POSIX_SOCKETS) && defined (HAVE_SENDFILE)
+#include <sys/sendfile.h>
+#endif
+
 static inline RSocketStatus
 r_socket_err_to_socket_status (int err)
 {
@@ -769,6 +773,218 @@ r_io_socket_send_message (RIOHandle handle, const RSocketAddress * address,
 #endif
 }
 
+RSocketStatus
+r_io_socket_send_file (RIOHandle handle, RIOHandle file, ruint64 offset,
+    rsize size, rsize * sent)
+{
+#if defined (HAVE_POSIX_SOCKETS) && defined (HAVE_SENDFILE)
+  off_t off = (off_t)offset;
+  rssize res;
+
+  if (R_UNLIKELY (handle == R_IO_HANDLE_INVALID)) return R_SOCKET_INVAL;
+  if (R_UNLIKELY (file == R_IO_HANDLE_INVALID)) return R_SOCKET_INVAL;
+
+  do {
+    res = sendfile (R_IO_HANDLE_TO_SOCKET_HANDLE (handle), file, &off, size);
+  } while (res < 0 && errno == EINTR);
+
+  if (res >= 0) {
+    if (sent != NULL)
+      *sent = (rsize)res;
+    return R_SOCKET_OK;
+  }
+
+  /* A source that can't be mapped (a pipe, a socket): copy it instead */
+  if (errno == EINVAL || errno == ENOSYS)
+    return R_SOCKET_NOT_SUPPORTED;
+  return r_socket_errno_to_socket_status ();
+#else
+  if (R_UNLIKELY (handle == R_IO_HANDLE_INVALID)) return R_SOCKET_INVAL;
+  if (R_UNLIKELY (file == R_IO_HANDLE_INVALID)) return R_SOCKET_INVAL;
+  (void) offset;
+  (void) size;
+  (void) sent;
+  return R_SOCKET_NOT_SUPPORTED;
+#endif
+}
+
+/* recvmmsg / sendmmsg move up to R_SOCKET_DATAGRAM_BATCH_MAX datagrams per
+ * syscall; elsewhere the batch degrades to a recvfrom / sendto loop. Only the
+ * first datagram of a receive may wait on a blocking socket. */
+#if defined (HAVE_POSIX_SOCKETS) && defined (HAVE_RECVMMSG)
+static void
+r_io_socket_datagrams_setup (struct mmsghdr * msgs, struct iovec * iov,
+    RSocketDatagram * dgrams, rsize n, rboolean recv)
+{
+  rsize i;
+
+  r_memclear (msgs, n * sizeof (struct mmsghdr));
+  for (i = 0; i < n; i++) {
+    iov[i].iov_base = dgrams[i].data;
+    iov[i].iov_len = dgrams[i].size;
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+    if (dgrams[i].address != NULL) {
+      msgs[i].msg_hdr.msg_name = &dgrams[i].address->addr;
+      msgs[i].msg_hdr.msg_namelen = recv ?
+        sizeof (dgrams[i].address->addr) : dgrams[i].address->addrlen;
+    }
+  }
+}
+#endif
+
+RSocketStatus
+r_io_socket_receive_datagrams (RIOHandle handle, RSocketDatagram * dgrams,
+    rsize count, rsize * received)
+{
+#if defined (HAVE_POSIX_SOCKETS) && defined (HAVE_RECVMMSG)
+  struct mmsghdr msgs[R_SOCKET_DATAGRAM_BATCH_MAX];
+  struct iovec iov[R_SOCKET_DATAGRAM_BATCH_MAX];
+  rsize i, n, done = 0;
+  int res;
+#elif defined (HAVE_WINSOCK2) || defined (HAVE_POSIX_SOCKETS)
+  rsize done = 0;
+  int res, flags = 0;
+#endif
+
+  if (R_UNLIKELY (handle == R_IO_HANDLE_INVALID)) return R_SOCKET_INVAL;
+  if (R_UNLIKELY (dgrams == NULL || count == 0)) return R_SOCKET_INVAL;
+
+#if defined (HAVE_POSIX_SOCKETS) && defined (HAVE_RECVMMSG)
+  while (done < count) {
+    n = MIN (count - done, R_SOCKET_DATAGRAM_BATCH_MAX);
+    r_io_socket_datagrams_setup (msgs, iov, &dgrams[done], n, TRUE);
+    do {
+      res = recvmmsg (R_IO_HANDLE_TO_SOCKET_HANDLE (handle), msgs, (unsigned int)n,
+          done > 0 ? MSG_DONTWAIT : MSG_WAITFORONE, NULL);
+    } while (res < 0 && R_SOCKET_ERRNO == EINTR);
+
+    if (res < 0) {
+      if (done > 0)
+        break;
+      return r_socket_errno_to_socket_status ();
+    }
+
+    for (i = 0; i < (rsize)res; i++) {
+      dgrams[done + i].len = msgs[i].msg_len;
+      if (dgrams[done + i].address != NULL)
+        dgrams[done + i].address->addrlen = msgs[i].msg_hdr.msg_namelen;
+    }
+    done += (rsize)res;
+    if ((rsize)res < n)
+      break;
+  }
+
+  if (received != NULL)
+    *received = done;
+  return R_SOCKET_OK;
+#elif defined (HAVE_WINSOCK2) || defined (HAVE_POSIX_SOCKETS)
+  do {
+    RSocketDatagram * d = &dgrams[done];
+    struct sockaddr * sa = NULL;
+    socklen_t * salen = NULL;
+
+    if (d->address != NULL) {
+      d->address->addrlen = sizeof (d->address->addr);
+      sa = (struct sockaddr *)&d->address->addr;
+      salen = &d->address->addrlen;
+    }
+    do {
+      res = (int)recvfrom (R_IO_HANDLE_TO_SOCKET_HANDLE (handle), d->data,
+          (int)d->size, flags, sa, salen);
+    } while (res < 0 && R_SOCKET_ERRNO == EINTR);
+
+    if (res < 0) {
+      if (done > 0)
+        break;
+      return r_socket_errno_to_socket_status ();
+    }
+
+    d->len = (rsize)res;
+    done++;
+#ifdef MSG_DONTWAIT
+    flags = MSG_DONTWAIT;
+#else
+    /* No per-call non-blocking flag (Winsock): one datagram per call. */
+    break;
+#endif
+  } while (done < count);
+
+  if (received != NULL)
+    *received = done;
+  return R_SOCKET_OK;
+#else
+  (void) received;
+  return R_SOCKET_NOT_SUPPORTED;
+#endif
+}
+
+RSocketStatus
+r_io_socket_send_datagrams (RIOHandle handle, RSocketDatagram * dgrams,
+    rsize count, rsize * sent)
+{
+#if defined (HAVE_POSIX_SOCKETS) && defined (HAVE_SENDMMSG)
+  struct mmsghdr msgs[R_SOCKET_DATAGRAM_BATCH_MAX];
+  struct iovec iov[R_SOCKET_DATAGRAM_BATCH_MAX];
+  rsize i, n, done = 0;
+  int res;
+#elif defined (HAVE_WINSOCK2) || defined (HAVE_POSIX_SOCKETS)
+  rsize done = 0;
+  int res;
+#endif
+
+  if (R_UNLIKELY (handle == R_IO_HANDLE_INVALID)) return R_SOCKET_INVAL;
+  if (R_UNLIKELY (dgrams == NULL || count == 0)) return R_SOCKET_INVAL;
+
+#if defined (HAVE_POSIX_SOCKETS) && defined (HAVE_SENDMMSG)
+  while (done < count) {
+    n = MIN (count - done, R_SOCKET_DATAGRAM_BATCH_MAX);
+    r_io_socket_datagrams_setup (msgs, iov, &dgrams[done], n, FALSE);
+    do {
+      res = sendmmsg (R_IO_HANDLE_TO_SOCKET_HANDLE (handle), msgs, (unsigned int)n, 0);
+    } while (res < 0 && R_SOCKET_ERRNO == EINTR);
+
+    if (res < 0) {
+      if (done > 0)
+        break;
+      return r_socket_errno_to_socket_status ();
+    }
+
+    for (i = 0; i < (rsize)res; i++)
+      dgrams[done + i].len = msgs[i].msg_len;
+    done += (rsize)res;
+    if ((rsize)res < n)
+      break;
+  }
+#elif defined (HAVE_WINSOCK2) || defined (HAVE_POSIX_SOCKETS)
+  for (; done < count; done++) {
+    RSocketDatagram * d = &dgrams[done];
+    do {
+      res = (int)sendto (R_IO_HANDLE_TO_SOCKET_HANDLE (handle), d->data,
+          (int)d->size, 0,
+          d->address != NULL ? (const struct sockaddr *)&d->address->addr : NULL,
+          d->address != NULL ? d->address->addrlen : 0);
+    } while (res < 0 && R_SOCKET_ERRNO == EINTR);
+
+    if (res < 0) {
+      if (done > 0)
+        break;
+      return r_socket_errno_to_socket_status ();
+    }
+    d->len = (rsize)res;
+  }
+#else
+  (void) sent;
+  return R_SOCKET_NOT_SUPPORTED;
+#endif
+
+#if defined (HAVE_WINSOCK2) || defined (HAVE_POSIX_SOCKETS)
+  if (sent != NULL)
+    *sent = done;
+  return R_SOCKET_OK;
+#endif
+}
+
 RSocketStatus
 r_io_get_socket_ipv4_multicast_loop (RIOHandle handle, rboolean * mloop)
 {
@@ -0,0 +1,359 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2016 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+
+#include "config.h"
+#include "rsocket-private.h"
+#include <rlib/net/rktls.h>
+
+#include <rlib/rmem.h>
+
+#if defined (HAVE_POSIX_SOCKETS) && defined (HAVE_LINUX_TLS_H)
+#define R_KTLS_LINUX  1
+#include <netinet/tcp.h>
+#include <linux/tls.h>
+#ifndef SOL_TLS
+#define SOL_TLS       282
+#endif
+#ifndef TCP_ULP
+#define TCP_ULP       31
+#endif
+#endif
+
+#ifdef R_KTLS_LINUX
+typedef union {
+  struct tls_crypto_info info;
+  struct tls12_crypto_info_aes_gcm_128 gcm128;
+  struct tls12_crypto_info_aes_gcm_256 gcm256;
+  struct tls12_crypto_info_chacha20_poly1305 chacha;
+} RKtlsCryptoInfo;
+
+/* Translate @keys into the kernel's crypto_info. GCM splits the nonce into a
+ * 4-byte salt and an 8-byte iv: for TLS 1.3 that is the static IV cut in two,
+ * for TLS 1.2 the implicit salt plus the first explicit nonce, which we keep
+ * equal to the sequence number like the user-space record layer does. */
+static rboolean
+r_ktls_crypto_info (RKtlsCryptoInfo * ci, socklen_t * len,
+    const RTLSTrafficKeys * keys)
+{
+  ruint8 seq[8];
+  rboolean tls13;
+
+  r_memclear (ci, sizeof (RKtlsCryptoInfo));
+  if (keys->version == R_TLS_VERSION_TLS_1_3) {
+    ci->info.version = TLS_1_3_VERSION;
+    tls13 = TRUE;
+  } else if (keys->version == R_TLS_VERSION_TLS_1_2) {
+    ci->info.version = TLS_1_2_VERSION;
+    tls13 = FALSE;
+  } else {
+    return FALSE;
+  }
+  r_store_be64 (seq, keys->seqno);
+
+  if (keys->cipher->type == R_CRYPTO_CIPHER_ALGO_AES &&
+      keys->cipher->mode == R_CRYPTO_CIPHER_MODE_GCM) {
+    /* Both GCM layouts share the iv / key / salt / rec_seq order. */
+    ruint8 * iv, * key, * salt, * recseq;
+
+    if (keys->keylen == TLS_CIPHER_AES_GCM_128_KEY_SIZE) {
+      ci->info.cipher_type = TLS_CIPHER_AES_GCM_128;
+      iv = ci->gcm128.iv; key = ci->gcm128.key;
+      salt = ci->gcm128.salt; recseq = ci->gcm128.rec_seq;
+      *len = sizeof (ci->gcm128);
+    } else if (keys->keylen == TLS_CIPHER_AES_GCM_256_KEY_SIZE) {
+      ci->info.cipher_type = TLS_CIPHER_AES_GCM_256;
+      iv = ci->gcm256.iv; key = ci->gcm256.key;
+      salt = ci->gcm256.salt; recseq = ci->gcm256.rec_seq;
+      *len = sizeof (ci->gcm256);
+    } else {
+      return FALSE;
+    }
+
+    if (tls13) {
+      if (keys->ivlen != 12)
+        return FALSE;
+      r_memcpy (salt, keys->iv, 4);
+      r_memcpy (iv, keys->iv + 4, 8);
+    } else {
+      if (keys->ivlen != 4)
+        return FALSE;
+      r_memcpy (salt, keys->iv, 4);
+      r_memcpy (iv, seq, 8);
+    }
+    r_memcpy (key, keys->key, keys->keylen);
+    r_memcpy (recseq, seq, 8);
+    return TRUE;
+  }
+
+  if (keys->cipher->type == R_CRYPTO_CIPHER_ALGO_CHACHA20 &&
+      keys->cipher->mode == R_CRYPTO_CIPHER_MODE_POLY1305) {
+    if (keys->keylen != TLS_CIPHER_CHACHA20_POLY1305_KEY_SIZE ||
+        keys->ivlen != TLS_CIPHER_CHACHA20_POLY1305_IV_SIZE)
+      return FALSE;
+    ci->info.cipher_type = TLS_CIPHER_CHACHA20_POLY1305;
+    r_memcpy (ci->chacha.iv, keys->iv, keys->ivlen);
+    r_memcpy (ci->chacha.key, keys->key, keys->keylen);
+    r_memcpy (ci->chacha.rec_seq, seq, 8);
+    *len = sizeof (ci->chacha);
+    return TRUE;
+  }
+
+  return FALSE;
+}
+#endif
+
+static RSocketStatus
+r_ktls_set (RSocket * socket, const RTLSTrafficKeys * keys, int direction)
+{
+#ifdef R_KTLS_LINUX
+  RKtlsCryptoInfo ci;
+  socklen_t len = 0;
+  int fd, res;
+#else
+  (void) direction;
+#endif
+
+  if (R_UNLIKELY (socket == NULL || keys == NULL || keys->cipher == NULL))
+    return R_SOCKET_INVAL;
+  if (R_UNLIKELY (socket->type != R_SOCKET_TYPE_STREAM))
+    return R_SOCKET_INVALID_OP;
+
+#ifdef R_KTLS_LINUX
+  if (!r_ktls_crypto_info (&ci, &len, keys)) {
+    r_memclear_secure (&ci, sizeof (ci));
+    return R_SOCKET_NOT_SUPPORTED;
+  }
+
+  fd = R_IO_HANDLE_TO_SOCKET_HANDLE (socket->handle);
+  /* EEXIST: the ULP is already attached, i.e. this is a rekey. */
+  if (setsockopt (fd, IPPROTO_TCP, TCP_ULP, "tls", sizeof ("tls")) != 0 &&
+      errno != EEXIST) {
+    r_memclear_secure (&ci, sizeof (ci));
+    return (errno == ENOTCONN) ? R_SOCKET_NOT_CONNECTED : R_SOCKET_NOT_SUPPORTED;
+  }
+
+  /* The tls ULP passes a direction without keys straight to TCP, so a
+   * refusal here (unknown cipher, no rekey support: EBUSY) leaves the socket
+   * usable for user-space records. */
+  res = setsockopt (fd, SOL_TLS, direction, &ci, len);
+  r_memclear_secure (&ci, sizeof (ci));
+  return (res == 0) ? R_SOCKET_OK : R_SOCKET_NOT_SUPPORTED;
+#else
+  return R_SOCKET_NOT_SUPPORTED;
+#endif
+}
+
+RSocketStatus
+r_ktls_set_tx (RSocket * socket, const RTLSTrafficKeys * keys)
+{
+#ifdef R_KTLS_LINUX
+  return r_ktls_set (socket, keys, TLS_TX);
+#else
+  return r_ktls_set (socket, keys, 0);
+#endif
+}
+
+RSocketStatus
+r_ktls_set_rx (RSocket * socket, const RTLSTrafficKeys * keys)
+{
+#ifdef R_KTLS_LINUX
+  return r_ktls_set (socket, keys, TLS_RX);
+#else
+  return r_ktls_set (socket, keys, 0);
+#endif
+}
+
+RSocketStatus
+r_ktls_send_record (RSocket * socket, RTLSContentType type,
+    RBuffer * buf, rsize * sent)
+{
+#ifdef R_KTLS_LINUX
+  union {
+    struct cmsghdr hdr;
+    ruint8 data[CMSG_SPACE (sizeof (ruint8))];
+  } ctrl;
+  struct msghdr msg;
+  struct cmsghdr * cmsg;
+  RMemMapInfo * info;
+  rsize i, mem_count;
+  rssize res;
+#endif
+
+  if (R_UNLIKELY (socket == NULL || buf == NULL))
+    return R_SOCKET_INVAL;
+
+#ifdef R_KTLS_LINUX
+  mem_count = r_buffer_mem_count (buf);
+  info = r_alloca (mem_count * sizeof (RMemMapInfo));
+
+  r_memclear (&msg, sizeof (msg));
+  r_memclear (&ctrl, sizeof (ctrl));
+  msg.msg_iovlen = mem_count;
+  msg.msg_iov = r_alloca (mem_count * sizeof (struct iovec));
+  msg.msg_control = ctrl.data;
+  msg.msg_controllen = sizeof (ctrl.data);
+
+  cmsg = CMSG_FIRSTHDR (&msg);
+  cmsg->cmsg_level = SOL_TLS;
+  cmsg->cmsg_type = TLS_SET_RECORD_TYPE;
+  cmsg->cmsg_len = CMSG_LEN (sizeof (ruint8));
+  *CMSG_DATA (cmsg) = (ruint8) type;
+
+  for (i = 0; i < mem_count; i++) {
+    RMem * mem = r_buffer_mem_peek (buf, (ruint)i);
+    if (r_mem_map (mem, &info[i], R_MEM_MAP_READ)) {
+      msg.msg_iov[i].iov_base = info[i].data;
+      msg.msg_iov[i].iov_len = info[i].size;
+    } else {
+      msg.msg_iov[i].iov_base = "";
+      msg.msg_iov[i].iov_len = 0;
+    }
+    r_mem_unref (mem);
+  }
+
+  do {
+    res = sendmsg (R_IO_HANDLE_TO_SOCKET_HANDLE (socket->handle), &msg, 0);
+  } while (res < 0 && errno == EINTR);
+
+  for (i = 0; i < mem_count; i++) {
+    RMem * mem = r_buffer_mem_peek (buf, (ruint)i);
+    r_mem_unmap (mem, &info[i]);
+    r_mem_unref (mem);
+  }
+
+  if (res >= 0) {
+    if (sent != NULL)
+      *sent = (rsize)res;
+    return R_SOCKET_OK;
+  }
+
+  switch (errno) {
+    case EAGAIN:
+#if EWOULDBLOCK != EAGAIN
+    case EWOULDBLOCK:
+#endif
+      return R_SOCKET_WOULD_BLOCK;
+    case EPIPE:
+    case ECONNRESET:
+      return R_SOCKET_CONN_RESET;
+    case ENOTCONN:
+      return R_SOCKET_NOT_CONNECTED;
+    default:
+      return R_SOCKET_ERROR;
+  }
+#else
+  (void) type;
+  (void) sent;
+  return R_SOCKET_NOT_SUPPORTED;
+#endif
+}
+
+RSocketStatus
+r_ktls_receive_record (RSocket * socket, RTLSContentType * type,
+    RBuffer * buf, rsize * received)
+{
+#ifdef R_KTLS_LINUX
+  union {
+    struct cmsghdr hdr;
+    ruint8 data[CMSG_SPACE (sizeof (ruint8))];
+  } ctrl;
+  struct msghdr msg;
+  struct cmsghdr * cmsg;
+  RMemMapInfo * info;
+  rsize i, mem_count, b;
+  rssize res;
+#endif
+
+  if (R_UNLIKELY (socket == NULL || type == NULL || buf == NULL))
+    return R_SOCKET_INVAL;
+
+#ifdef R_KTLS_LINUX
+  mem_count = r_buffer_mem_count (buf);
+  info = r_alloca (mem_count * sizeof (RMemMapInfo));
+
+  r_memclear (&msg, sizeof (msg));
+  r_memclear (&ctrl, sizeof (ctrl));
+  msg.msg_iovlen = mem_count;
+  msg.msg_iov = r_alloca (mem_count * sizeof (struct iovec));
+  /* With room for the record type the kernel hands other records over one
+   * at a time instead of failing the read with EIO. */
+  msg.msg_control = ctrl.data;
+  msg.msg_controllen = sizeof (ctrl.data);
+
+  for (i = 0; i < mem_count; i++) {
+    RMem * mem = r_buffer_mem_peek (buf, (ruint)i);
+    if (r_mem_map (mem, &info[i], R_MEM_MAP_WRITE)) {
+      msg.msg_iov[i].iov_base = info[i].data;
+      msg.msg_iov[i].iov_len = info[i].size;
+    } else {
+      msg.msg_iov[i].iov_base = "";
+      msg.msg_iov[i].iov_len = 0;
+    }
+    r_mem_unref (mem);
+  }
+
+  do {
+    res = recvmsg (R_IO_HANDLE_TO_SOCKET_HANDLE (socket->handle), &msg, 0);
+  } while (res < 0 && errno == EINTR);
+  b = res > 0 ? (rsize)res : 0;
+
+  for (i = 0; i < mem_count; i++) {
+    RMem * mem = r_buffer_mem_peek (buf, (ruint)i);
+    r_mem_unmap (mem, &info[i]);
+    if (b >= mem->size) {
+      b -= mem->size;
+    } else {
+      r_mem_resize (mem, mem->offset, b);
+      b = 0;
+    }
+    r_mem_unref (mem);
+  }
+
+  if (res >= 0) {
+    *type = R_TLS_CONTENT_TYPE_APPLICATION_DATA;
+    for (cmsg = CMSG_FIRSTHDR (&msg); cmsg != NULL; cmsg = CMSG_NXTHDR (&msg, cmsg)) {
+      if (cmsg->cmsg_level == SOL_TLS && cmsg->cmsg_type == TLS_GET_RECORD_TYPE)
+        *type = (RTLSContentType) *CMSG_DATA (cmsg);
+    }
+    if (received != NULL)
+      *received = (rsize)res;
+    return R_SOCKET_OK;
+  }
+
+  switch (errno) {
+    case EAGAIN:
+#if EWOULDBLOCK != EAGAIN
+    case EWOULDBLOCK:
+#endif
+      return R_SOCKET_WOULD_BLOCK;
+    case ECONNRESET:
+      return R_SOCKET_CONN_RESET;
+    case ENOTCONN:
+      return R_SOCKET_NOT_CONNECTED;
+    case EMSGSIZE:
+      return R_SOCKET_MSG_SIZE;
+    default:
+      /* EBADMSG: a record failed to authenticate; EKEYEXPIRED: a KeyUpdate
+       * was read but the next keys never installed. */
+      return R_SOCKET_ERROR;
+  }
+#else
+  (void) received;
+  return R_SOCKET_NOT_SUPPORTED;
+#endif
+}
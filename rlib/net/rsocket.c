@@ -489,3 +489,24 @@ r_socket_send_message (RSocket * socket, const RSocketAddress * address,
   return r_io_socket_send_message (socket->handle, address, buffer, sent);
 }
 
+RSocketStatus
+r_socket_send_file (RSocket * socket, RIOHandle file, ruint64 offset,
+    rsize size, rsize * sent)
+{
+  return r_io_socket_send_file (socket->handle, file, offset, size, sent);
+}
+
+RSocketStatus
+r_socket_receive_datagrams (RSocket * socket, RSocketDatagram * dgrams,
+    rsize count, rsize * received)
+{
+  return r_io_socket_receive_datagrams (socket->handle, dgrams, count, received);
+}
+
+RSocketStatus
+r_socket_send_datagrams (RSocket * socket, RSocketDatagram * dgrams,
+    rsize count, rsize * sent)
+{
+  return r_io_socket_send_datagrams (socket->handle, dgrams, count, sent);
+}
+
@@ -169,6 +169,18 @@ struct RTLSClient {
   rboolean early13_sent;                /* early_data offered and records emitted */
   rboolean early13_accepted;            /* server echoed early_data in EncryptedExtensions */
 
+  /* Transmit / receive offload (r_tls_client_set_tx_offload,
+   * r_tls_client_set_rx_offload): set once the lower layer took the keys of
+   * that direction; records then go to tx_record unsealed, and arrive opened
+   * via incoming_record. */
+  RTLSTxRecordCb tx_record;
+  RTLSTxKeysCb tx_keys;
+  RTLSRxKeysCb rx_keys;
+  ruint8 txkey[R_TLS_TRAFFIC_KEY_MAX];  /* <=1.2 client write key, kept for the export */
+  rsize txkeylen;
+  ruint8 rxkey[R_TLS_TRAFFIC_KEY_MAX];  /* <=1.2 server write key, likewise */
+  rsize rxkeylen;
+
   RBuffer * inbuf;
   RQueue qsend;
   RQueue deferred13;                    /* DTLS 1.3 next-epoch records awaiting keys */
@@ -283,6 +295,8 @@ r_tls_client_free (RTLSClient * client)
   r_dtls13_rtx_clear (&client->rtx, client->loop);
   r_memclear_secure (client->mastersecret, sizeof (client->mastersecret));
   r_memclear_secure (&client->sched13, sizeof (client->sched13));
+  r_memclear_secure (client->txkey, sizeof (client->txkey));
+  r_memclear_secure (client->rxkey, sizeof (client->rxkey));
   r_free (client);
 }
 
@@ -612,12 +626,37 @@ r_tls_client_cipher_encrypt (RTLSClient * client, RBuffer * buf)
   return ret;
 }
 
+/* Hand one record's plaintext to the transmit offload. */
+static RTLSError
+r_tls_client_tx_record (RTLSClient * client, RTLSContentType ct, RBuffer * buf)
+{
+  return client->tx_record (client->userdata, ct, buf, client) ?
+    R_TLS_ERROR_OK : R_TLS_ERROR_QUEUE_FULL;
+}
+
 static RTLSError
 r_tls_client_send_record (RTLSClient * client, RBuffer * buf)
 {
   RTLSError ret;
   RBuffer * encbuf;
 
+  if (client->tx_record != NULL) {
+    RMemMapInfo info = R_MEM_MAP_INFO_INIT;
+    RBuffer * payload;
+    ruint8 ct;
+
+    if (!r_buffer_map (buf, &info, R_MEM_MAP_READ))
+      return R_TLS_ERROR_OOM;
+    ct = info.data[0];
+    r_buffer_unmap (buf, &info);
+    if ((payload = r_buffer_view (buf, R_TLS_RECORD_HDR_SIZE, -1)) == NULL)
+      return R_TLS_ERROR_OOM;
+    if ((ret = r_tls_client_tx_record (client, ct, payload)) == R_TLS_ERROR_OK)
+      client->client.seqno++;
+    r_buffer_unref (payload);
+    return ret;
+  }
+
   if ((encbuf = client->encrypt (client, buf)) != NULL) {
     if (r_queue_push (&client->qsend, encbuf) != NULL) {
       client->client.seqno++;
@@ -1581,6 +1620,15 @@ r_tls_client_protect_record13_one (RTLSClient * client, RTLSContentType ct,
   rboolean ok = FALSE;
   RTLSError ret = R_TLS_ERROR_OOM;
 
+  if (client->tx_record != NULL) {
+    if ((rec = r_buffer_new_dup (plain, plainlen)) == NULL)
+      return R_TLS_ERROR_OOM;
+    if ((ret = r_tls_client_tx_record (client, ct, rec)) == R_TLS_ERROR_OK)
+      client->rk_write.seq++;
+    r_buffer_unref (rec);
+    return ret;
+  }
+
   if ((rec = r_buffer_new_alloc (NULL, cap, NULL)) == NULL)
     return R_TLS_ERROR_OOM;
   if (r_buffer_map (rec, &info, R_MEM_MAP_WRITE)) {
@@ -2465,6 +2513,14 @@ r_tls_client_expand_master_secret (RTLSClient * client)
         ret = R_TLS_ERROR_OOM;
     }
     if (ret == R_TLS_ERROR_OK && (size = client->csinfo->cipher->keybits / 8) > 0) {
+      /* The raw keys are needed again only to hand the record layer off. */
+      if (size <= sizeof (client->txkey)) {
+        r_memcpy (client->txkey, ptr, size);
+        r_memcpy (client->rxkey, ptr + size, size);
+        client->txkeylen = client->rxkeylen = size;
+      } else {
+        client->txkeylen = client->rxkeylen = 0;
+      }
       client->client.cipher = r_crypto_cipher_new (client->csinfo->cipher, ptr); ptr += size;
       client->server.cipher = r_crypto_cipher_new (client->csinfo->cipher, ptr); ptr += size;
       if (client->client.cipher == NULL || client->server.cipher == NULL)
@@ -3294,6 +3350,56 @@ r_tls_client_store_ticket13 (RTLSClient * client, const RTLSParser * parser)
   client->new_session = s;
 }
 
+/* Fill @keys with our current write- or read-direction record state, for the
+ * transmit / receive offload. Only AEAD suites over TLS (not DTLS) are
+ * expressible. */
+static rboolean
+r_tls_client_traffic_keys (RTLSClient * client, rboolean write,
+    RTLSTrafficKeys * keys)
+{
+  const RCryptoCipherInfo * ci;
+
+  r_memclear (keys, sizeof (RTLSTrafficKeys));
+  if (client->tls13) {
+    const RTLS13RecordKeys * rk = write ? &client->rk_write : &client->rk_read;
+
+    ci = client->cs13_cipher;
+    if (client->dtls13 || ci == NULL || ci->keybits / 8 > sizeof (keys->key) ||
+        rk->ivlen > sizeof (keys->iv))
+      return FALSE;
+    keys->version = R_TLS_VERSION_TLS_1_3;
+    keys->keylen = ci->keybits / 8;
+    if (!r_tls13_expand_label (client->cs13_hash,
+          write ? client->sched13.cap : client->sched13.sap,
+          R_STR_WITH_SIZE_ARGS ("key"), NULL, 0, keys->key, keys->keylen))
+      return FALSE;
+    r_memcpy (keys->iv, rk->iv, rk->ivlen);
+    keys->ivlen = rk->ivlen;
+    keys->seqno = rk->seq;
+  } else {
+    const RTLSConnectionState * cs = write ? &client->client : &client->server;
+    const ruint8 * key = write ? client->txkey : client->rxkey;
+    rsize keylen = write ? client->txkeylen : client->rxkeylen;
+
+    if (client->version != R_TLS_VERSION_TLS_1_2 || client->csinfo == NULL ||
+        cs->cipher == NULL || cs->fixediv == NULL ||
+        !r_crypto_cipher_is_aead (cs->cipher) || keylen == 0)
+      return FALSE;
+    ci = client->csinfo->cipher;
+    keys->version = R_TLS_VERSION_TLS_1_2;
+    r_memcpy (keys->key, key, keylen);
+    keys->keylen = keylen;
+    keys->ivlen = (ci->mode == R_CRYPTO_CIPHER_MODE_GCM) ?
+        ci->ivsize - R_TLS_AEAD_EXPLICIT_NONCE_SIZE : ci->ivsize;
+    if (keys->ivlen > sizeof (keys->iv))
+      return FALSE;
+    r_memcpy (keys->iv, cs->fixediv, keys->ivlen);
+    keys->seqno = cs->seqno;
+  }
+  keys->cipher = ci;
+  return TRUE;
+}
+
 /* Send a post-handshake KeyUpdate (RFC 8446 4.6.3) and rotate our sending key.
  * Unlike handshake-phase messages it is framed but not folded into the
  * transcript. It goes out under the current write key; every record after it
@@ -3330,6 +3436,18 @@ r_tls_client_send_key_update13 (RTLSClient * client, rboolean request_peer_updat
       !r_tls_client_install_keys13 (client, &client->rk_write, client->sched13.cap,
         (ruint16) (client->rk_write.epoch + 1)))
     return R_TLS_ERROR_ENCRYPTION_FAILED;
+
+  /* An offloading lower layer rekeys behind the KeyUpdate it was handed. */
+  if (client->tx_keys != NULL) {
+    RTLSTrafficKeys keys;
+    rboolean ok;
+
+    ok = r_tls_client_traffic_keys (client, TRUE, &keys) &&
+      client->tx_keys (client->userdata, &keys, client);
+    r_memclear_secure (&keys, sizeof (keys));
+    if (!ok)
+      return R_TLS_ERROR_ENCRYPTION_FAILED;
+  }
   return R_TLS_ERROR_OK;
 }
 
@@ -3356,6 +3474,21 @@ r_tls_client_recv_key_update13 (RTLSClient * client, const RTLSParser * parser)
     return R_TLS_ERROR_ENCRYPTION_FAILED;
   }
 
+  /* An offloading lower layer opens the records behind this one; having
+   * consumed them, it cannot hand them back as ciphertext if it fails. */
+  if (client->rx_keys != NULL) {
+    RTLSTrafficKeys keys;
+    rboolean ok;
+
+    ok = r_tls_client_traffic_keys (client, FALSE, &keys) &&
+      client->rx_keys (client->userdata, &keys, client);
+    r_memclear_secure (&keys, sizeof (keys));
+    if (!ok) {
+      r_tls_client_send_alert (client, R_TLS_ALERT_TYPE_INTERNAL_ERROR);
+      return R_TLS_ERROR_ENCRYPTION_FAILED;
+    }
+  }
+
   if (request == R_TLS_KEY_UPDATE_REQUESTED)
     return r_tls_client_send_key_update13 (client, FALSE);
   return R_TLS_ERROR_OK;
@@ -3666,8 +3799,8 @@ r_tls_client_replay_deferred13 (RTLSClient * client)
   }
 }
 
-rboolean
-r_tls_client_incoming_data (RTLSClient * client, RBuffer * buffer)
+static rboolean
+r_tls_client_incoming (RTLSClient * client, RBuffer * buffer)
 {
   static RTLSClientStateFunc statefuncs[] = {
     r_tls_client_state_error,
@@ -3685,9 +3818,6 @@ r_tls_client_incoming_data (RTLSClient * client, RBuffer * buffer)
   RTLSParser parser = R_TLS_PARSER_INIT;
   RTLSError err;
 
-  if (R_UNLIKELY (client == NULL)) return FALSE;
-  if (R_UNLIKELY (buffer == NULL)) return FALSE;
-
   if (client->inbuf == NULL) {
     client->inbuf = r_buffer_ref (buffer);
   } else {
@@ -3708,7 +3838,10 @@ r_tls_client_incoming_data (RTLSClient * client, RBuffer * buffer)
 
     client->recordver = parser.version;
 
-    if (client->dtls13) {
+    if (client->rx_keys != NULL) {
+      /* Receive offloaded: the lower layer opened the record already and
+       * r_tls_client_incoming_record framed it in the clear. */
+    } else if (client->dtls13) {
       /* DTLS 1.3: protected records use the unified header (its first byte has
        * the 001 fixed bits); deprotect them once read keys are installed. */
       if (client->rk_read.cipher != NULL &&
@@ -3754,6 +3887,11 @@ r_tls_client_incoming_data (RTLSClient * client, RBuffer * buffer)
         continue;
       if (client->rk_read.cipher != NULL &&
           parser.content == R_TLS_CONTENT_TYPE_APPLICATION_DATA) {
+        if (parser.fragment.size > R_TLS13_MAX_CIPHERTEXT) {
+          r_tls_client_send_alert (client, R_TLS_ALERT_TYPE_RECORD_OVERFLOW);
+          err = R_TLS_ERROR_RECORD_OVERFLOW;
+          break;
+        }
         if ((err = r_tls_parser_unprotect13 (&parser, client->rk_read.cipher,
                 client->rk_read.iv, client->rk_read.ivlen,
                 client->rk_read.seq)) != R_TLS_ERROR_OK) {
@@ -3779,6 +3917,16 @@ r_tls_client_incoming_data (RTLSClient * client, RBuffer * buffer)
 
     client->server.seqno++;
 
+    /* No plaintext fragment may exceed 2^14, negotiated limit or not (RFC
+     * 5246 6.2.1, RFC 8446 5.1); DTLS drops the record instead. */
+    if (parser.fragment.size > R_TLS_MAX_PLAINTEXT) {
+      if (r_tls_parser_is_dtls (&parser))
+        continue;
+      r_tls_client_send_alert (client, R_TLS_ALERT_TYPE_RECORD_OVERFLOW);
+      err = R_TLS_ERROR_RECORD_OVERFLOW;
+      break;
+    }
+
     /* Honour a negotiated record_size_limit (RFC 8449): a post-handshake record
      * whose plaintext -- content-type byte included -- exceeds the limit we
      * advertised is a fatal record_overflow. The handshake flight is exempt (see
@@ -3848,7 +3996,11 @@ r_tls_client_incoming_data (RTLSClient * client, RBuffer * buffer)
     r_tls_client_send_out (client);
     r_tls_client_replay_deferred13 (client);
   } else {
-    if (client->inbuf != NULL) {
+    /* An incomplete record is kept until the rest of it arrives over the
+     * stream; a short DTLS datagram will never be completed. */
+    if (client->inbuf != NULL && (err != R_TLS_ERROR_BUF_TOO_SMALL ||
+          r_tls_version_is_dtls (client->version) ||
+          r_tls_version_is_dtls (parser.version))) {
       r_buffer_unref (client->inbuf);
       client->inbuf = NULL;
     }
@@ -3858,6 +4010,141 @@ r_tls_client_incoming_data (RTLSClient * client, RBuffer * buffer)
   return TRUE;
 }
 
+rboolean
+r_tls_client_incoming_data (RTLSClient * client, RBuffer * buffer)
+{
+  if (R_UNLIKELY (client == NULL)) return FALSE;
+  if (R_UNLIKELY (buffer == NULL)) return FALSE;
+  /* Offloaded: ciphertext never reaches us any more. */
+  if (R_UNLIKELY (client->rx_keys != NULL)) return FALSE;
+
+  return r_tls_client_incoming (client, buffer);
+}
+
+rboolean
+r_tls_client_incoming_record (RTLSClient * client, RTLSContentType type,
+    RBuffer * buf)
+{
+  RBuffer * rec;
+  RMemMapInfo out = R_MEM_MAP_INFO_INIT;
+  rsize size;
+  rboolean ret;
+
+  if (R_UNLIKELY (client == NULL || buf == NULL)) return FALSE;
+  if (R_UNLIKELY (client->rx_keys == NULL)) return FALSE;
+
+  /* Record boundaries and sequence numbers are the lower layer's business;
+   * it may well hand several records' worth of application data over. */
+  if (type == R_TLS_CONTENT_TYPE_APPLICATION_DATA) {
+    if (R_UNLIKELY (client->state != R_TLS_CLIENT_APPDATA)) return FALSE;
+    client->cb.appdata (client->userdata, buf, client);
+    return TRUE;
+  }
+
+  /* Anything else is rare and small: frame it as a plaintext record and let
+   * the usual record processing take it from there. */
+  if ((size = r_buffer_get_size (buf)) > R_TLS_MAX_PLAINTEXT) {
+    r_tls_client_send_alert (client, R_TLS_ALERT_TYPE_RECORD_OVERFLOW);
+    return FALSE;
+  }
+  if ((rec = r_buffer_new_alloc (NULL, R_TLS_RECORD_HDR_SIZE + size, NULL)) == NULL)
+    return FALSE;
+  if (!r_buffer_map (rec, &out, R_MEM_MAP_WRITE)) {
+    r_buffer_unref (rec);
+    return FALSE;
+  }
+  out.data[0] = (ruint8) type;
+  r_store_be16 (out.data + 1, R_TLS_VERSION_TLS_1_2);
+  r_store_be16 (out.data + 3, (ruint16) size);
+  r_buffer_extract (buf, 0, out.data + R_TLS_RECORD_HDR_SIZE, size);
+  r_buffer_unmap (rec, &out);
+
+  ret = r_tls_client_incoming (client, rec);
+  r_buffer_unref (rec);
+  return ret;
+}
+
+/* Application data over TLS with an AEAD (every 1.3 suite) is sealed straight
+ * from the caller's bytes; DTLS and CBC suites build a plaintext record first. */
+static rboolean
+r_tls_client_seals_appdata (const RTLSClient * client)
+{
+  if (r_tls_version_is_dtls (client->version))
+    return FALSE;
+  if (client->tls13)
+    return client->rk_write.cipher != NULL;
+  return client->client.cipher != NULL && client->client.fixediv != NULL &&
+    r_crypto_cipher_is_aead (client->client.cipher);
+}
+
+/* Seal @data[@size] as application data records of up to the peer's cap each,
+ * all into one buffer queued as a single send. */
+static RTLSError
+r_tls_client_seal_appdata (RTLSClient * client, const ruint8 * data, rsize size)
+{
+  RBuffer * buf;
+  RMemMapInfo info = R_MEM_MAP_INFO_INIT;
+  rsize cap = (client->tls13 && client->peer_record_size_limit != 0) ?
+      (rsize) client->peer_record_size_limit - 1 : R_TLS_MAX_PLAINTEXT;
+  rsize nrec = (size > 0) ? (size + cap - 1) / cap : 1;
+  rsize overhead, total, off = 0, pos = 0;
+  RTLSError ret = R_TLS_ERROR_OK;
+
+  if (client->tls13)
+    overhead = R_TLS_RECORD_HDR_SIZE + 1 + R_TLS13_AEAD_TAG_SIZE;
+  else if ((overhead = r_tls_aead_record_overhead (client->client.cipher, NULL)) == 0)
+    return R_TLS_ERROR_ENCRYPTION_FAILED;
+  total = size + nrec * overhead;
+
+  if ((buf = r_buffer_new_alloc (NULL, total, NULL)) == NULL)
+    return R_TLS_ERROR_OOM;
+  if (!r_buffer_map (buf, &info, R_MEM_MAP_WRITE)) {
+    r_buffer_unref (buf);
+    return R_TLS_ERROR_OOM;
+  }
+
+  do {
+    rsize chunk = MIN (cap, size - off), reclen = 0;
+
+    if (client->tls13) {
+      ruint8 * p = info.data + pos;
+      if (r_tls13_record_protect (client->rk_write.cipher,
+            client->rk_write.iv, client->rk_write.ivlen, client->rk_write.seq,
+            R_TLS_CONTENT_TYPE_APPLICATION_DATA, data + off, chunk,
+            p + R_TLS_RECORD_HDR_SIZE, total - pos - R_TLS_RECORD_HDR_SIZE,
+            &reclen)) {
+        p[0] = (ruint8) R_TLS_CONTENT_TYPE_APPLICATION_DATA;
+        r_store_be16 (p + 1, R_TLS_VERSION_TLS_1_2);
+        r_store_be16 (p + 3, (ruint16) reclen);
+        reclen += R_TLS_RECORD_HDR_SIZE;
+        client->rk_write.seq++;
+      } else {
+        ret = R_TLS_ERROR_ENCRYPTION_FAILED;
+      }
+    } else {
+      if (r_tls_seal_record_aead (info.data + pos, total - pos, &reclen,
+            R_TLS_CONTENT_TYPE_APPLICATION_DATA, client->version,
+            data + off, chunk, client->client.seqno,
+            client->client.cipher, client->client.fixediv))
+        client->client.seqno++;
+      else
+        ret = R_TLS_ERROR_ENCRYPTION_FAILED;
+    }
+    off += chunk;
+    pos += reclen;
+  } while (ret == R_TLS_ERROR_OK && off < size);
+  r_buffer_unmap (buf, &info);
+
+  if (ret == R_TLS_ERROR_OK) {
+    r_buffer_set_size (buf, pos);
+    if (r_queue_push (&client->qsend, buf) != NULL)
+      return R_TLS_ERROR_OK;
+    ret = R_TLS_ERROR_QUEUE_FULL;
+  }
+  r_buffer_unref (buf);
+  return ret;
+}
+
 rboolean
 r_tls_client_send_appdata (RTLSClient * client, RBuffer * buffer)
 {
@@ -3869,8 +4156,23 @@ r_tls_client_send_appdata (RTLSClient * client, RBuffer * buffer)
 
   if (R_UNLIKELY (client == NULL || buffer == NULL)) return FALSE;
   if (R_UNLIKELY (client->state != R_TLS_CLIENT_APPDATA)) return FALSE;
+
+  /* Offloaded: the lower layer frames and seals the stream itself. */
+  if (client->tx_record != NULL)
+    return r_tls_client_tx_record (client,
+        R_TLS_CONTENT_TYPE_APPLICATION_DATA, buffer) == R_TLS_ERROR_OK;
+
   if (R_UNLIKELY (!r_buffer_map (buffer, &in, R_MEM_MAP_READ))) return FALSE;
 
+  if (r_tls_client_seals_appdata (client)) {
+    ret = r_tls_client_seal_appdata (client, in.data, in.size);
+    r_buffer_unmap (buffer, &in);
+    if (ret != R_TLS_ERROR_OK)
+      return FALSE;
+    r_tls_client_send_out (client);
+    return TRUE;
+  }
+
   if (client->tls13) {
     ret = r_tls_client_protect_record13 (client,
         R_TLS_CONTENT_TYPE_APPLICATION_DATA, in.data, in.size);
@@ -3913,6 +4215,69 @@ r_tls_client_send_appdata (RTLSClient * client, RBuffer * buffer)
   return TRUE;
 }
 
+RTLSError
+r_tls_client_set_tx_offload (RTLSClient * client,
+    RTLSTxRecordCb record, RTLSTxKeysCb keys)
+{
+  RTLSTrafficKeys tk;
+  rboolean ok;
+
+  if (R_UNLIKELY (client == NULL || record == NULL || keys == NULL))
+    return R_TLS_ERROR_INVAL;
+  if (R_UNLIKELY (client->state != R_TLS_CLIENT_APPDATA || client->tx_record != NULL))
+    return R_TLS_ERROR_WRONG_STATE;
+  /* The lower layer fills records up to 2^14 on its own. */
+  if (client->peer_record_size_limit != 0)
+    return R_TLS_ERROR_NOT_SUPPORTED;
+  if (!r_tls_client_traffic_keys (client, TRUE, &tk)) {
+    r_memclear_secure (&tk, sizeof (tk));
+    return R_TLS_ERROR_NOT_SUPPORTED;
+  }
+
+  /* Whatever we sealed ourselves goes first. */
+  r_tls_client_send_out (client);
+  ok = keys (client->userdata, &tk, client);
+  r_memclear_secure (&tk, sizeof (tk));
+  if (!ok)
+    return R_TLS_ERROR_NOT_SUPPORTED;
+
+  R_LOG_DEBUG ("%p - transmit offloaded", client);
+  client->tx_record = record;
+  client->tx_keys = keys;
+  return R_TLS_ERROR_OK;
+}
+
+RTLSError
+r_tls_client_set_rx_offload (RTLSClient * client, RTLSRxKeysCb keys)
+{
+  RTLSTrafficKeys tk;
+  rboolean ok;
+
+  if (R_UNLIKELY (client == NULL || keys == NULL))
+    return R_TLS_ERROR_INVAL;
+  if (R_UNLIKELY (client->state != R_TLS_CLIENT_APPDATA || client->rx_keys != NULL))
+    return R_TLS_ERROR_WRONG_STATE;
+  /* The lower layer takes over at a record boundary: the rest of a partly
+   * received record has to be fed in first. */
+  if (client->inbuf != NULL)
+    return R_TLS_ERROR_WRONG_STATE;
+  if (client->peer_record_size_limit != 0)
+    return R_TLS_ERROR_NOT_SUPPORTED;
+  if (!r_tls_client_traffic_keys (client, FALSE, &tk)) {
+    r_memclear_secure (&tk, sizeof (tk));
+    return R_TLS_ERROR_NOT_SUPPORTED;
+  }
+
+  ok = keys (client->userdata, &tk, client);
+  r_memclear_secure (&tk, sizeof (tk));
+  if (!ok)
+    return R_TLS_ERROR_NOT_SUPPORTED;
+
+  R_LOG_DEBUG ("%p - receive offloaded", client);
+  client->rx_keys = keys;
+  return R_TLS_ERROR_OK;
+}
+
 rboolean
 r_tls_client_key_update (RTLSClient * client, rboolean request_peer_update)
 {
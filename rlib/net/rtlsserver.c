@@ -122,6 +122,8 @@ struct RTLSServer {
   RPrng * prng;
   RCryptoCert * cert;
   RCryptoKey * privkey;
+  RTLSPrivKeyOp * privop;               /* offloaded signature in flight: the handshake is suspended */
+  rboolean privop_dispatching;          /* inside cb.priv_key_op; a completion there is synchronous */
 
   RTLSClientCertMode client_cert_mode;  /* mTLS policy; default NONE */
   rboolean client_cert_received;        /* a non-empty client cert was parsed */
@@ -188,6 +190,23 @@ struct RTLSServer {
   ruint8 ph_ctx[32];                    /* certificate_request_context we sent */
   ruint8 ph_ctxlen;
 
+  /* Transmit offload (r_tls_server_set_tx_offload): set once the lower layer
+   * took the write keys; records then go to tx_record unsealed. */
+  RTLSTxRecordCb tx_record;
+  RTLSTxKeysCb tx_keys;
+  ruint8 txkey[R_TLS_TRAFFIC_KEY_MAX];  /* <=1.2 server write key, kept for the export */
+  rsize txkeylen;
+  /* Receive offload (r_tls_server_set_rx_offload): set once the lower layer
+   * took the read keys; records then arrive opened, via incoming_record. */
+  RTLSRxKeysCb rx_keys;
+  ruint8 rxkey[R_TLS_TRAFFIC_KEY_MAX];  /* <=1.2 client write key, likewise */
+  rsize rxkeylen;
+
+  /* Application data held back by r_tls_server_cork, sealed as full records. */
+  rboolean corked;
+  ruint8 * cork;                        /* one record's worth of plaintext */
+  rsize corklen;
+
   RBuffer * inbuf;
   RQueue qsend;
   RQueue deferred13;                    /* DTLS 1.3 next-epoch records awaiting keys */
@@ -288,6 +307,12 @@ r_tls_server_free (RTLSServer * server)
   /* Scrub key material before releasing the struct. */
   r_memclear_secure (server->mastersecret, sizeof (server->mastersecret));
   r_memclear_secure (&server->sched13, sizeof (server->sched13));
+  r_memclear_secure (server->txkey, sizeof (server->txkey));
+  r_memclear_secure (server->rxkey, sizeof (server->rxkey));
+  if (server->cork != NULL) {
+    r_memclear_secure (server->cork, R_TLS_MAX_PLAINTEXT);
+    r_free (server->cork);
+  }
   r_free (server);
 }
 
@@ -648,12 +673,37 @@ r_tls_server_cipher_encrypt (RTLSServer * server, RBuffer * buf)
   return ret;
 }
 
+/* Hand one record's plaintext to the transmit offload. */
+static RTLSError
+r_tls_server_tx_record (RTLSServer * server, RTLSContentType ct, RBuffer * buf)
+{
+  return server->tx_record (server->userdata, ct, buf, server) ?
+    R_TLS_ERROR_OK : R_TLS_ERROR_QUEUE_FULL;
+}
+
 static RTLSError
 r_tls_server_send_record_one (RTLSServer * server, RBuffer * buf)
 {
   RTLSError ret;
   RBuffer * encbuf;
 
+  if (server->tx_record != NULL) {
+    RMemMapInfo info = R_MEM_MAP_INFO_INIT;
+    RBuffer * payload;
+    ruint8 ct;
+
+    if (!r_buffer_map (buf, &info, R_MEM_MAP_READ))
+      return R_TLS_ERROR_OOM;
+    ct = info.data[0];
+    r_buffer_unmap (buf, &info);
+    if ((payload = r_buffer_view (buf, R_TLS_RECORD_HDR_SIZE, -1)) == NULL)
+      return R_TLS_ERROR_OOM;
+    if ((ret = r_tls_server_tx_record (server, ct, payload)) == R_TLS_ERROR_OK)
+      server->server.seqno++;
+    r_buffer_unref (payload);
+    return ret;
+  }
+
   if ((encbuf = server->encrypt (server, buf)) != NULL) {
     if (r_queue_push (&server->qsend, encbuf) != NULL) {
       server->server.seqno++;
@@ -1134,12 +1184,130 @@ r_tls_server_write_certificate (RTLSServer * server)
   return ret;
 }
 
+/* Where the handshake picks up once an offloaded signature completes. */
+typedef enum {
+  R_TLS_PRIV_KEY_OP_RESUME_KEY_EXCHANGE,    /* 1.2: ServerKeyExchange onwards */
+  R_TLS_PRIV_KEY_OP_RESUME_FLIGHT13,        /* 1.3: CertificateVerify onwards */
+} RTLSPrivKeyOpResume;
+
+struct RTLSPrivKeyOp {
+  RTLSServer * server;                  /* ref'd until complete */
+  RTLSPrivKeyOpResume resume;
+  RCryptoKey * key;
+  RPrng * prng;                         /* private: the session's is not thread-safe */
+  RTLSSignatureScheme scheme;
+  RMsgDigestType mdtype;
+  ruint8 in[R_TLS13_CERT_VERIFY_TBS_MAX];   /* digest, or the content for PureEdDSA */
+  rsize inlen;
+  ruint8 sig[512];
+  rsize siglen;
+  RTLSError result;
+  rboolean completed;
+};
+
+/* Sign @in under @scheme. RSA-PSS goes straight to the PSS primitive rather
+ * than switching the shared key's padding, which would race with another
+ * session signing on a worker thread. */
+static RTLSError
+r_tls_server_sign_with_key (RCryptoKey * key, RPrng * prng,
+    RTLSSignatureScheme scheme, RMsgDigestType mdtype,
+    const ruint8 * in, rsize inlen, ruint8 * sig, rsize * siglen)
+{
+  RCryptoResult res;
+
+  if (scheme == R_TLS_SIGN_SCHEME_RSA_PSS_SHA256)
+    res = r_rsa_pss_sign_hash (key, prng, mdtype, in, inlen, sig, siglen);
+  else
+    res = r_crypto_key_sign (key, prng, mdtype, in, inlen, sig, siglen);
+
+  return (res == R_CRYPTO_OK) ? R_TLS_ERROR_OK : R_TLS_ERROR_HANDSHAKE_FAILURE;
+}
+
+static void
+r_tls_priv_key_op_free (RTLSPrivKeyOp * op)
+{
+  r_tls_server_unref (op->server);
+  r_crypto_key_unref (op->key);
+  r_prng_unref (op->prng);
+  r_memclear_secure (op, sizeof (RTLSPrivKeyOp));
+  r_free (op);
+}
+
+RTLSError
+r_tls_priv_key_op_run (RTLSPrivKeyOp * op)
+{
+  if (R_UNLIKELY (op == NULL)) return R_TLS_ERROR_INVAL;
+
+  op->siglen = sizeof (op->sig);
+  op->result = r_tls_server_sign_with_key (op->key, op->prng, op->scheme,
+      op->mdtype, op->in, op->inlen, op->sig, &op->siglen);
+  return op->result;
+}
+
+/* Sign for the handshake, through cb.priv_key_op when one is installed.
+ * Returns R_TLS_ERROR_PENDING when the callback took the operation: the
+ * handshake is then suspended on server->privop and continues at @resume
+ * from r_tls_priv_key_op_complete. Otherwise @sig / @siglen hold the
+ * signature. */
+static RTLSError
+r_tls_server_sign (RTLSServer * server, RTLSPrivKeyOpResume resume,
+    RTLSSignatureScheme scheme, RMsgDigestType mdtype,
+    const ruint8 * in, rsize inlen, ruint8 * sig, rsize * siglen)
+{
+  RTLSPrivKeyOp * op;
+  RTLSError ret;
+  rboolean taken;
+
+  if (server->cb.priv_key_op == NULL || inlen > sizeof (((RTLSPrivKeyOp *)0)->in))
+    return r_tls_server_sign_with_key (server->privkey, server->prng,
+        scheme, mdtype, in, inlen, sig, siglen);
+
+  if ((op = r_mem_new0 (RTLSPrivKeyOp)) == NULL)
+    return R_TLS_ERROR_OOM;
+  if ((op->prng = r_prng_new_crypto ()) == NULL) {
+    r_free (op);
+    return R_TLS_ERROR_OOM;
+  }
+  op->server = r_tls_server_ref (server);
+  op->resume = resume;
+  op->key = r_crypto_key_ref (server->privkey);
+  op->scheme = scheme;
+  op->mdtype = mdtype;
+  r_memcpy (op->in, in, inlen);
+  op->inlen = inlen;
+  op->result = R_TLS_ERROR_HANDSHAKE_FAILURE;
+
+  server->privop = op;
+  server->privop_dispatching = TRUE;
+  taken = server->cb.priv_key_op (server->userdata, op, server);
+  server->privop_dispatching = FALSE;
+  if (taken && !op->completed) {
+    R_LOG_DEBUG ("%p - private key operation offloaded", server);
+    return R_TLS_ERROR_PENDING;
+  }
+
+  server->privop = NULL;
+  ret = taken ? op->result : r_tls_priv_key_op_run (op);
+  if (ret == R_TLS_ERROR_OK) {
+    if (op->siglen <= *siglen) {
+      r_memcpy (sig, op->sig, op->siglen);
+      *siglen = op->siglen;
+    } else {
+      ret = R_TLS_ERROR_BUF_TOO_SMALL;
+    }
+  }
+  r_tls_priv_key_op_free (op);
+  return ret;
+}
+
+static RTLSError
+r_tls_server_write_key_exchange_signed (RTLSServer * server,
+    const ruint8 * sig, rsize sigsize);
+
 static RTLSError
 r_tls_server_write_key_exchange (RTLSServer * server)
 {
-  RBuffer * buf;
   RTLSError ret;
-  RMemMapInfo info;
   ruint8 point[R_TLS_ECDHE_POINT_MAX];  /* SEC 1 uncompressed, up to P-521 */
   ruint8 tbs[2 * R_TLS_HELLO_RANDOM_BYTES + 4 + sizeof (point)];
   ruint8 hash[64];
@@ -1148,7 +1316,6 @@ r_tls_server_write_key_exchange (RTLSServer * server)
   ruint8 pointlen;
   RMsgDigest * md;
   RTLSSupportedGroup named_curve;
-  RTLSSignatureScheme sigscheme;
 
   /* Only ephemeral (ECDHE) suites send a ServerKeyExchange; static RSA does
    * not, and the orchestrator only bumps the message sequence when we do. */
@@ -1188,9 +1355,29 @@ r_tls_server_write_key_exchange (RTLSServer * server)
 
   /* The signature scheme follows the certificate key (RSA or ECDSA); both hash
    * with SHA-256, so the digest above is unchanged. */
-  sigscheme = r_tls_sign_scheme_for_key (server->privkey);
-  if (r_crypto_key_sign (server->privkey, server->prng, R_MSG_DIGEST_TYPE_SHA256,
-        hash, hashsize, sig, &sigsize) != R_CRYPTO_OK)
+  if ((ret = r_tls_server_sign (server, R_TLS_PRIV_KEY_OP_RESUME_KEY_EXCHANGE,
+          r_tls_sign_scheme_for_key (server->privkey), R_MSG_DIGEST_TYPE_SHA256,
+          hash, hashsize, sig, &sigsize)) != R_TLS_ERROR_OK)
+    return ret;
+
+  return r_tls_server_write_key_exchange_signed (server, sig, sigsize);
+}
+
+/* Frame the ServerKeyExchange around a finished signature. The ECPoint is
+ * re-encoded from the ephemeral key, which is all the signed params are. */
+static RTLSError
+r_tls_server_write_key_exchange_signed (RTLSServer * server,
+    const ruint8 * sig, rsize sigsize)
+{
+  RBuffer * buf;
+  RTLSError ret;
+  RMemMapInfo info;
+  ruint8 point[R_TLS_ECDHE_POINT_MAX];
+  ruint8 pointlen;
+  RTLSSupportedGroup named_curve = (RTLSSupportedGroup)server->ecdhe_curve;
+
+  if (!r_tls_ecdhe_point_write (server->ecdhe_key, server->ecdhe_curve,
+        point, sizeof (point), &pointlen))
     return R_TLS_ERROR_HANDSHAKE_FAILURE;
 
   R_LOG_DEBUG ("%p - server key exchange (ECDHE)", server);
@@ -1218,7 +1405,7 @@ r_tls_server_write_key_exchange (RTLSServer * server)
     if (ret == R_TLS_ERROR_OK &&
         (ret = r_tls_write_hs_server_key_exchange_ecdhe (info.data + hssize,
             info.size - hssize, &bodylen, R_TLS_EC_TYPE_NAMED_CURVE, named_curve,
-            point, pointlen, sigscheme,
+            point, pointlen, r_tls_sign_scheme_for_key (server->privkey),
             sig, (ruint16)sigsize)) == R_TLS_ERROR_OK) {
       r_msg_digest_update (server->hshash, info.data + hdrsize,
           (hssize + bodylen) - hdrsize);
@@ -2355,6 +2542,15 @@ r_tls_server_protect_record13_one (RTLSServer * server, RTLSContentType ct,
   rboolean ok = FALSE;
   RTLSError ret = R_TLS_ERROR_OOM;
 
+  if (server->tx_record != NULL) {
+    if ((rec = r_buffer_new_dup (plain, plainlen)) == NULL)
+      return R_TLS_ERROR_OOM;
+    if ((ret = r_tls_server_tx_record (server, ct, rec)) == R_TLS_ERROR_OK)
+      server->rk_write.seq++;
+    r_buffer_unref (rec);
+    return ret;
+  }
+
   if ((rec = r_buffer_new_alloc (NULL, cap, NULL)) == NULL)
     return R_TLS_ERROR_OOM;
   if (r_buffer_map (rec, &info, R_MEM_MAP_WRITE)) {
@@ -2529,7 +2725,8 @@ r_tls_server_install_keys13 (RTLSServer * server, RTLS13RecordKeys * rk,
   return r_tls13_traffic_keys (server->cs13_hash, secret, server->cs13_cipher, rk);
 }
 
-/* Sign the CertificateVerify content with the negotiated scheme. */
+/* Sign the CertificateVerify content with the negotiated scheme. Returns
+ * R_TLS_ERROR_PENDING when the signature was offloaded. */
 static RTLSError
 r_tls_server_sign_certificate_verify13 (RTLSServer * server,
     const ruint8 * th, rsize hlen, ruint8 * sig, rsize * siglen)
@@ -2550,10 +2747,8 @@ r_tls_server_sign_certificate_verify13 (RTLSServer * server,
 
   if (mdtype == R_MSG_DIGEST_TYPE_NONE) {
     /* PureEdDSA signs the content directly, without a pre-hash. */
-    if (r_crypto_key_sign (server->privkey, server->prng, mdtype,
-          tbs, tbslen, sig, siglen) != R_CRYPTO_OK)
-      return R_TLS_ERROR_HANDSHAKE_FAILURE;
-    return R_TLS_ERROR_OK;
+    return r_tls_server_sign (server, R_TLS_PRIV_KEY_OP_RESUME_FLIGHT13,
+        server->cv_scheme, mdtype, tbs, tbslen, sig, siglen);
   }
 
   if ((md = r_msg_digest_new (mdtype)) == NULL)
@@ -2565,13 +2760,8 @@ r_tls_server_sign_certificate_verify13 (RTLSServer * server,
   if (!ok)
     return R_TLS_ERROR_HANDSHAKE_FAILURE;
 
-  if (server->cv_scheme == R_TLS_SIGN_SCHEME_RSA_PSS_SHA256)
-    r_rsa_priv_key_set_padding (server->privkey, R_RSA_PADDING_PKCS1_V21);
-  if (r_crypto_key_sign (server->privkey, server->prng, mdtype,
-        digest, dlen, sig, siglen) != R_CRYPTO_OK)
-    return R_TLS_ERROR_HANDSHAKE_FAILURE;
-
-  return R_TLS_ERROR_OK;
+  return r_tls_server_sign (server, R_TLS_PRIV_KEY_OP_RESUME_FLIGHT13,
+      server->cv_scheme, mdtype, digest, dlen, sig, siglen);
 }
 
 /* Build the leaf CertificateEntry Extension list (RFC 8446 4.4.2.1): an OCSP
@@ -2621,14 +2811,19 @@ r_tls_server_build_leaf_cert_exts (RTLSServer * server, ruint16 * out)
   return exts;
 }
 
+static RTLSError
+r_tls_server_write_flight13_end (RTLSServer * server,
+    const ruint8 * sig, rsize siglen);
+
 /* Send the encrypted server flight (EncryptedExtensions, Certificate,
  * CertificateVerify, Finished) and derive the application secrets. The
- * ServerHello goes out in the clear first. */
+ * ServerHello goes out in the clear first. Returns R_TLS_ERROR_PENDING when
+ * the CertificateVerify signature was offloaded. */
 static RTLSError
 r_tls_server_write_flight13 (RTLSServer * server)
 {
   ruint8 ecdhe[R_TLS_KE_SECRET_MAX], th[R_TLS13_SECRET_MAX];
-  ruint8 sig[512], finkey[R_TLS13_SECRET_MAX], vd[R_TLS13_SECRET_MAX];
+  ruint8 sig[512];
   ruint8 body[4096];
   rsize ecdhelen = 0, siglen = sizeof (sig), bodylen = 0;
   rsize hlen = r_msg_digest_type_size (server->cs13_hash);
@@ -2746,12 +2941,33 @@ r_tls_server_write_flight13 (RTLSServer * server)
     if (ret != R_TLS_ERROR_OK)
       return ret;
 
-    /* CertificateVerify over Transcript-Hash(ClientHello..Certificate). */
+    /* CertificateVerify over Transcript-Hash(ClientHello..Certificate). An
+     * offloaded signature suspends the flight here; the rest is written by
+     * r_tls_server_write_flight13_end once it completes. */
     if (!r_msg_digest_get_data (server->hshash, th, hlen, NULL))
       return R_TLS_ERROR_HANDSHAKE_FAILURE;
     if ((ret = r_tls_server_sign_certificate_verify13 (server, th, hlen,
             sig, &siglen)) != R_TLS_ERROR_OK)
       return ret;
+    return r_tls_server_write_flight13_end (server, sig, siglen);
+  }
+
+  return r_tls_server_write_flight13_end (server, NULL, 0);
+}
+
+/* Finish the server flight: the CertificateVerify carrying @sig (none on a
+ * resumed handshake), Finished, and the application secrets. */
+static RTLSError
+r_tls_server_write_flight13_end (RTLSServer * server,
+    const ruint8 * sig, rsize siglen)
+{
+  ruint8 th[R_TLS13_SECRET_MAX], finkey[R_TLS13_SECRET_MAX], vd[R_TLS13_SECRET_MAX];
+  ruint8 body[4096];
+  rsize bodylen = 0;
+  rsize hlen = r_msg_digest_type_size (server->cs13_hash);
+  RTLSError ret;
+
+  if (sig != NULL) {
     if ((ret = r_tls_write_hs_certificate_verify (body, sizeof (body), &bodylen,
             server->cv_scheme, sig, (ruint16) siglen)) != R_TLS_ERROR_OK)
       return ret;
@@ -3391,6 +3607,14 @@ r_tls_server_expand_master_secret (RTLSServer * server)
     /* Key */
     if (ret == R_TLS_ERROR_OK && (size = server->csinfo->cipher->keybits / 8) > 0) {
       R_LOG_DEBUG ("Key from keyblock of size %u", (ruint)size);
+      /* The raw keys are needed again only to hand the record layer off. */
+      if (size <= sizeof (server->rxkey)) {
+        r_memcpy (server->rxkey, ptr, size);
+        r_memcpy (server->txkey, ptr + size, size);
+        server->rxkeylen = server->txkeylen = size;
+      } else {
+        server->rxkeylen = server->txkeylen = 0;
+      }
       server->client.cipher = r_crypto_cipher_new (server->csinfo->cipher, ptr); ptr += size;
       server->server.cipher = r_crypto_cipher_new (server->csinfo->cipher, ptr); ptr += size;
       if (server->client.cipher == NULL || server->server.cipher == NULL)
@@ -3457,6 +3681,147 @@ r_tls_server_parse_finished (RTLSServer * server, const RTLSParser * parser)
 
 static void r_tls_server_send_out (RTLSServer * server);
 
+/* Largest application-data plaintext per record: 2^14, or what a negotiated
+ * max_fragment_length (<=1.2) / record_size_limit (1.3) allows. */
+static rsize
+r_tls_server_appdata_cap (const RTLSServer * server)
+{
+  if (server->tls13)
+    return (server->peer_record_size_limit != 0) ?
+      (rsize) server->peer_record_size_limit - 1 : R_TLS_MAX_PLAINTEXT;
+  return server->max_fragment ?
+    ((rsize) 1u << (8 + server->max_fragment)) : R_TLS_MAX_PLAINTEXT;
+}
+
+/* Application data over TLS with an AEAD (every 1.3 suite) is sealed straight
+ * from the caller's bytes; DTLS and CBC suites build a plaintext record first. */
+static rboolean
+r_tls_server_seals_appdata (const RTLSServer * server)
+{
+  if (r_tls_version_is_dtls (server->version))
+    return FALSE;
+  if (server->tls13)
+    return server->rk_write.cipher != NULL;
+  return server->server.cipher != NULL && server->server.fixediv != NULL &&
+    r_crypto_cipher_is_aead (server->server.cipher);
+}
+
+/* Seal @data[@size] as application data records of up to the cap each, all
+ * into one buffer queued as a single send: one allocation and one pass over
+ * the payload, however many records it takes. */
+static RTLSError
+r_tls_server_seal_appdata (RTLSServer * server, const ruint8 * data, rsize size)
+{
+  RBuffer * buf;
+  RMemMapInfo info = R_MEM_MAP_INFO_INIT;
+  rsize cap = r_tls_server_appdata_cap (server);
+  rsize nrec = (size > 0) ? (size + cap - 1) / cap : 1;
+  rsize overhead, total, off = 0, pos = 0;
+  RTLSError ret = R_TLS_ERROR_OK;
+
+  if (server->tls13)
+    overhead = R_TLS_RECORD_HDR_SIZE + 1 + R_TLS13_AEAD_TAG_SIZE;
+  else if ((overhead = r_tls_aead_record_overhead (server->server.cipher, NULL)) == 0)
+    return R_TLS_ERROR_ENCRYPTION_FAILED;
+  total = size + nrec * overhead;
+
+  if ((buf = r_buffer_new_alloc (NULL, total, NULL)) == NULL)
+    return R_TLS_ERROR_OOM;
+  if (!r_buffer_map (buf, &info, R_MEM_MAP_WRITE)) {
+    r_buffer_unref (buf);
+    return R_TLS_ERROR_OOM;
+  }
+
+  do {
+    rsize chunk = MIN (cap, size - off), reclen = 0;
+
+    if (server->tls13) {
+      ruint8 * p = info.data + pos;
+      if (r_tls13_record_protect (server->rk_write.cipher,
+            server->rk_write.iv, server->rk_write.ivlen, server->rk_write.seq,
+            R_TLS_CONTENT_TYPE_APPLICATION_DATA, data + off, chunk,
+            p + R_TLS_RECORD_HDR_SIZE, total - pos - R_TLS_RECORD_HDR_SIZE,
+            &reclen)) {
+        p[0] = (ruint8) R_TLS_CONTENT_TYPE_APPLICATION_DATA;
+        r_store_be16 (p + 1, R_TLS_VERSION_TLS_1_2);
+        r_store_be16 (p + 3, (ruint16) reclen);
+        reclen += R_TLS_RECORD_HDR_SIZE;
+        server->rk_write.seq++;
+      } else {
+        ret = R_TLS_ERROR_ENCRYPTION_FAILED;
+      }
+    } else {
+      if (r_tls_seal_record_aead (info.data + pos, total - pos, &reclen,
+            R_TLS_CONTENT_TYPE_APPLICATION_DATA, server->version,
+            data + off, chunk, server->server.seqno,
+            server->server.cipher, server->server.fixediv))
+        server->server.seqno++;
+      else
+        ret = R_TLS_ERROR_ENCRYPTION_FAILED;
+    }
+    off += chunk;
+    pos += reclen;
+  } while (ret == R_TLS_ERROR_OK && off < size);
+  r_buffer_unmap (buf, &info);
+
+  if (ret == R_TLS_ERROR_OK) {
+    r_buffer_set_size (buf, pos);
+    if (r_queue_push (&server->qsend, buf) != NULL)
+      return R_TLS_ERROR_OK;
+    ret = R_TLS_ERROR_QUEUE_FULL;
+  }
+  r_buffer_unref (buf);
+  return ret;
+}
+
+/* Corked application data: top up the pending record, seal whole records
+ * straight from @data, and keep the tail for the next call or the flush. */
+static RTLSError
+r_tls_server_cork_append (RTLSServer * server, const ruint8 * data, rsize size)
+{
+  rsize cap = r_tls_server_appdata_cap (server), n;
+  RTLSError ret;
+
+  if (server->cork == NULL &&
+      (server->cork = r_malloc (R_TLS_MAX_PLAINTEXT)) == NULL)
+    return R_TLS_ERROR_OOM;
+
+  if (server->corklen > 0) {
+    n = MIN (size, cap - server->corklen);
+    r_memcpy (server->cork + server->corklen, data, n);
+    server->corklen += n;
+    data += n;
+    size -= n;
+    if (server->corklen < cap)
+      return R_TLS_ERROR_OK;
+    server->corklen = 0;
+    if ((ret = r_tls_server_seal_appdata (server, server->cork, cap)) != R_TLS_ERROR_OK)
+      return ret;
+  }
+
+  if ((n = size - size % cap) > 0) {
+    if ((ret = r_tls_server_seal_appdata (server, data, n)) != R_TLS_ERROR_OK)
+      return ret;
+    data += n;
+    size -= n;
+  }
+
+  r_memcpy (server->cork, data, size);
+  server->corklen = size;
+  return R_TLS_ERROR_OK;
+}
+
+static RTLSError
+r_tls_server_cork_flush (RTLSServer * server)
+{
+  rsize len = server->corklen;
+
+  if (len == 0)
+    return R_TLS_ERROR_OK;
+  server->corklen = 0;
+  return r_tls_server_seal_appdata (server, server->cork, len);
+}
+
 /* Build an alert record and queue it for sending; the caller flushes. */
 static RTLSError
 r_tls_server_emit_alert (RTLSServer * server, RTLSAlertLevel level,
@@ -3469,6 +3834,11 @@ r_tls_server_emit_alert (RTLSServer * server, RTLSAlertLevel level,
    * negotiation). */
   RTLSVersion ver = (server->version != 0) ? server->version : server->recordver;
 
+  /* Held-back application data goes out ahead of a close_notify. */
+  if (alert == R_TLS_ALERT_TYPE_CLOSE_NOTIFY &&
+      (ret = r_tls_server_cork_flush (server)) != R_TLS_ERROR_OK)
+    return ret;
+
   /* Once 1.3 write keys are installed, alerts are AEAD-protected as
    * application_data (RFC 8446 5); only the pre-key handshake alerts are
    * plaintext. */
@@ -3697,6 +4067,16 @@ r_tls_server_try_resume (RTLSServer * server)
   return R_TLS_ERROR_OK;
 }
 
+/* The tail of the full <= 1.2 server flight, after the ServerKeyExchange. */
+static void
+r_tls_server_write_flight_end (RTLSServer * server)
+{
+  if (r_tls_server_write_cert_req (server) == R_TLS_ERROR_OK)
+    server->server.msgseq++;
+  if (r_tls_server_write_hello_done (server) == R_TLS_ERROR_OK)
+    server->server.msgseq++;
+}
+
 static RTLSError
 r_tls_server_state_hello (RTLSServer * server, const RTLSParser * parser)
 {
@@ -3709,7 +4089,8 @@ r_tls_server_state_hello (RTLSServer * server, const RTLSParser * parser)
      * CH2 and run the 1.3 flight. */
     if ((err = r_tls_server_nego_hello13_retry (server)) == R_TLS_ERROR_OK) {
       r_tls_server_hs_fold13 (server, parser->fragment.data, parser->fragment.size);
-      if ((err = r_tls_server_write_flight13 (server)) == R_TLS_ERROR_OK)
+      if ((err = r_tls_server_write_flight13 (server)) == R_TLS_ERROR_OK ||
+          err == R_TLS_ERROR_PENDING)
         err = r_tls_server_change_state (server, R_TLS_SERVER_FINISHED);
     }
     if (err != R_TLS_ERROR_OK)
@@ -3791,7 +4172,8 @@ r_tls_server_state_hello (RTLSServer * server, const RTLSParser * parser)
 
       if (server->tls13) {
         /* Send ServerHello..Finished, then await the client Finished. */
-        if ((err = r_tls_server_write_flight13 (server)) == R_TLS_ERROR_OK)
+        if ((err = r_tls_server_write_flight13 (server)) == R_TLS_ERROR_OK ||
+            err == R_TLS_ERROR_PENDING)
           err = r_tls_server_change_state (server, R_TLS_SERVER_FINISHED);
         if (err != R_TLS_ERROR_OK)
           r_tls_server_send_alert (server, r_tls_server_alert_for_error (err));
@@ -3819,12 +4201,17 @@ r_tls_server_state_hello (RTLSServer * server, const RTLSParser * parser)
         server->server.msgseq++;
       if (r_tls_server_write_certificate (server) == R_TLS_ERROR_OK)
         server->server.msgseq++;
-      if (r_tls_server_write_key_exchange (server) == R_TLS_ERROR_OK)
-        server->server.msgseq++;
-      if (r_tls_server_write_cert_req (server) == R_TLS_ERROR_OK)
-        server->server.msgseq++;
-      if (r_tls_server_write_hello_done (server) == R_TLS_ERROR_OK)
-        server->server.msgseq++;
+      switch (r_tls_server_write_key_exchange (server)) {
+        case R_TLS_ERROR_PENDING:
+          /* The rest of the flight follows the offloaded signature. */
+          break;
+        case R_TLS_ERROR_OK:
+          server->server.msgseq++;
+          R_ATTR_FALLTHROUGH;
+        default:
+          r_tls_server_write_flight_end (server);
+          break;
+      }
       break;
     default:
       r_tls_server_send_alert (server, r_tls_server_alert_for_error (err));
@@ -4067,6 +4454,56 @@ r_tls_server_state_finished (RTLSServer * server, const RTLSParser * parser)
   return err;
 }
 
+/* Fill @keys with our current write- or read-direction record state, for the
+ * transmit / receive offload. Only AEAD suites over TLS (not DTLS) are
+ * expressible. */
+static rboolean
+r_tls_server_traffic_keys (RTLSServer * server, rboolean write,
+    RTLSTrafficKeys * keys)
+{
+  const RCryptoCipherInfo * ci;
+
+  r_memclear (keys, sizeof (RTLSTrafficKeys));
+  if (server->tls13) {
+    const RTLS13RecordKeys * rk = write ? &server->rk_write : &server->rk_read;
+
+    ci = server->cs13_cipher;
+    if (server->dtls13 || ci == NULL || ci->keybits / 8 > sizeof (keys->key) ||
+        rk->ivlen > sizeof (keys->iv))
+      return FALSE;
+    keys->version = R_TLS_VERSION_TLS_1_3;
+    keys->keylen = ci->keybits / 8;
+    if (!r_tls13_expand_label (server->cs13_hash,
+          write ? server->sched13.sap : server->sched13.cap,
+          R_STR_WITH_SIZE_ARGS ("key"), NULL, 0, keys->key, keys->keylen))
+      return FALSE;
+    r_memcpy (keys->iv, rk->iv, rk->ivlen);
+    keys->ivlen = rk->ivlen;
+    keys->seqno = rk->seq;
+  } else {
+    const RTLSConnectionState * sp = write ? &server->server : &server->client;
+    const ruint8 * key = write ? server->txkey : server->rxkey;
+    rsize keylen = write ? server->txkeylen : server->rxkeylen;
+
+    if (server->version != R_TLS_VERSION_TLS_1_2 || server->csinfo == NULL ||
+        sp->cipher == NULL || sp->fixediv == NULL ||
+        !r_crypto_cipher_is_aead (sp->cipher) || keylen == 0)
+      return FALSE;
+    ci = server->csinfo->cipher;
+    keys->version = R_TLS_VERSION_TLS_1_2;
+    r_memcpy (keys->key, key, keylen);
+    keys->keylen = keylen;
+    keys->ivlen = (ci->mode == R_CRYPTO_CIPHER_MODE_GCM) ?
+        ci->ivsize - R_TLS_AEAD_EXPLICIT_NONCE_SIZE : ci->ivsize;
+    if (keys->ivlen > sizeof (keys->iv))
+      return FALSE;
+    r_memcpy (keys->iv, sp->fixediv, keys->ivlen);
+    keys->seqno = sp->seqno;
+  }
+  keys->cipher = ci;
+  return TRUE;
+}
+
 /* Send a post-handshake KeyUpdate (RFC 8446 4.6.3) and rotate our sending key.
  * Unlike handshake-phase messages it is framed but not folded into the
  * transcript. It goes out under the current write key; every record after it
@@ -4103,6 +4540,18 @@ r_tls_server_send_key_update13 (RTLSServer * server, rboolean request_peer_updat
       !r_tls_server_install_keys13 (server, &server->rk_write, server->sched13.sap,
         (ruint16) (server->rk_write.epoch + 1)))
     return R_TLS_ERROR_ENCRYPTION_FAILED;
+
+  /* An offloading lower layer rekeys behind the KeyUpdate it was handed. */
+  if (server->tx_keys != NULL) {
+    RTLSTrafficKeys keys;
+    rboolean ok;
+
+    ok = r_tls_server_traffic_keys (server, TRUE, &keys) &&
+      server->tx_keys (server->userdata, &keys, server);
+    r_memclear_secure (&keys, sizeof (keys));
+    if (!ok)
+      return R_TLS_ERROR_ENCRYPTION_FAILED;
+  }
   return R_TLS_ERROR_OK;
 }
 
@@ -4129,6 +4578,21 @@ r_tls_server_recv_key_update13 (RTLSServer * server, const RTLSParser * parser)
     return R_TLS_ERROR_ENCRYPTION_FAILED;
   }
 
+  /* An offloading lower layer opens the records behind this one; having
+   * consumed them, it cannot hand them back as ciphertext if it fails. */
+  if (server->rx_keys != NULL) {
+    RTLSTrafficKeys keys;
+    rboolean ok;
+
+    ok = r_tls_server_traffic_keys (server, FALSE, &keys) &&
+      server->rx_keys (server->userdata, &keys, server);
+    r_memclear_secure (&keys, sizeof (keys));
+    if (!ok) {
+      r_tls_server_send_alert (server, R_TLS_ALERT_TYPE_INTERNAL_ERROR);
+      return R_TLS_ERROR_ENCRYPTION_FAILED;
+    }
+  }
+
   if (request == R_TLS_KEY_UPDATE_REQUESTED)
     return r_tls_server_send_key_update13 (server, FALSE);
   return R_TLS_ERROR_OK;
@@ -4578,8 +5042,8 @@ r_tls_server_replay_deferred13 (RTLSServer * server)
   }
 }
 
-rboolean
-r_tls_server_incoming_data (RTLSServer * server, RBuffer * buffer)
+static rboolean
+r_tls_server_incoming (RTLSServer * server, RBuffer * buffer)
 {
   static RTLSServerStateFunc statefuncs[] = {
     r_tls_server_state_error,
@@ -4599,9 +5063,6 @@ r_tls_server_incoming_data (RTLSServer * server, RBuffer * buffer)
   RTLSParser parser = R_TLS_PARSER_INIT;
   RTLSError err;
 
-  if (R_UNLIKELY (server == NULL)) return FALSE;
-  if (R_UNLIKELY (buffer == NULL)) return FALSE;
-
   if (server->inbuf == NULL) {
     server->inbuf = r_buffer_ref (buffer);
   } else {
@@ -4609,6 +5070,11 @@ r_tls_server_incoming_data (RTLSServer * server, RBuffer * buffer)
       return FALSE;
   }
 
+  /* Suspended on an offloaded private-key operation: hold the input until
+   * r_tls_priv_key_op_complete resumes the handshake. */
+  if (server->privop != NULL)
+    return TRUE;
+
   /* Once Connection IDs are negotiated, incoming protected records carry our CID,
    * so the parser needs its length to locate the sequence number and payload. */
   if (server->cid_negotiated)
@@ -4624,7 +5090,10 @@ r_tls_server_incoming_data (RTLSServer * server, RBuffer * buffer)
      * correctly even before the version is negotiated. */
     server->recordver = parser.version;
 
-    if (server->dtls13) {
+    if (server->rx_keys != NULL) {
+      /* Receive offloaded: the lower layer opened the record already and
+       * r_tls_server_incoming_record framed it in the clear. */
+    } else if (server->dtls13) {
       /* DTLS 1.3: protected records use the unified header (001 fixed bits in
        * the first byte); the epoch-0 ClientHello before read keys exist is a
        * plaintext DTLSPlaintext that passes through to the state handler. */
@@ -4669,6 +5138,11 @@ r_tls_server_incoming_data (RTLSServer * server, RBuffer * buffer)
         continue;
       if (server->rk_read.cipher != NULL &&
           parser.content == R_TLS_CONTENT_TYPE_APPLICATION_DATA) {
+        if (parser.fragment.size > R_TLS13_MAX_CIPHERTEXT) {
+          r_tls_server_send_alert (server, R_TLS_ALERT_TYPE_RECORD_OVERFLOW);
+          err = R_TLS_ERROR_RECORD_OVERFLOW;
+          break;
+        }
         if ((err = r_tls_parser_unprotect13 (&parser, server->rk_read.cipher,
                 server->rk_read.iv, server->rk_read.ivlen,
                 server->rk_read.seq)) != R_TLS_ERROR_OK) {
@@ -4716,6 +5190,16 @@ r_tls_server_incoming_data (RTLSServer * server, RBuffer * buffer)
       }
     }
 
+    /* No plaintext fragment may exceed 2^14, negotiated limit or not (RFC
+     * 5246 6.2.1, RFC 8446 5.1); DTLS drops the record instead. */
+    if (parser.fragment.size > R_TLS_MAX_PLAINTEXT) {
+      if (r_tls_parser_is_dtls (&parser))
+        continue;
+      r_tls_server_send_alert (server, R_TLS_ALERT_TYPE_RECORD_OVERFLOW);
+      err = R_TLS_ERROR_RECORD_OVERFLOW;
+      break;
+    }
+
     /* Honour a negotiated max_fragment_length: a plaintext fragment larger than
      * the cap is a fatal record_overflow (RFC 6066). */
     if (server->max_fragment != 0 &&
@@ -4791,6 +5275,12 @@ r_tls_server_incoming_data (RTLSServer * server, RBuffer * buffer)
         err = statefuncs[server->state] (server, &parser);
       } while (err == R_TLS_ERROR_NOT_NEEDED);
     }
+
+    if (server->privop != NULL) {
+      /* The handshake suspended: keep the records behind this one. */
+      server->inbuf = r_tls_parser_next (&parser);
+      break;
+    }
   }
 
   r_tls_parser_clear (&parser);
@@ -4811,7 +5301,11 @@ r_tls_server_incoming_data (RTLSServer * server, RBuffer * buffer)
         server->recordver = parser.version;
       r_tls_server_send_alert (server, r_tls_server_alert_for_error (err));
     }
-    if (server->inbuf != NULL) {
+    /* Over a stream the rest of the record follows in a later read; a DTLS
+     * datagram is complete, so a short one is garbage. */
+    if (server->inbuf != NULL && (err != R_TLS_ERROR_BUF_TOO_SMALL ||
+          r_tls_version_is_dtls (server->version) ||
+          r_tls_version_is_dtls (parser.version))) {
       r_buffer_unref (server->inbuf);
       server->inbuf = NULL;
     }
@@ -4821,6 +5315,148 @@ r_tls_server_incoming_data (RTLSServer * server, RBuffer * buffer)
   return TRUE;
 }
 
+rboolean
+r_tls_server_incoming_data (RTLSServer * server, RBuffer * buffer)
+{
+  if (R_UNLIKELY (server == NULL)) return FALSE;
+  if (R_UNLIKELY (buffer == NULL)) return FALSE;
+  /* Offloaded: ciphertext never reaches us any more. */
+  if (R_UNLIKELY (server->rx_keys != NULL)) return FALSE;
+
+  return r_tls_server_incoming (server, buffer);
+}
+
+rboolean
+r_tls_server_incoming_record (RTLSServer * server, RTLSContentType type,
+    RBuffer * buf)
+{
+  RBuffer * rec;
+  RMemMapInfo out = R_MEM_MAP_INFO_INIT;
+  rsize size;
+  rboolean ret;
+
+  if (R_UNLIKELY (server == NULL || buf == NULL)) return FALSE;
+  if (R_UNLIKELY (server->rx_keys == NULL)) return FALSE;
+
+  /* Record boundaries and sequence numbers are the lower layer's business;
+   * it may well hand several records' worth of application data over. */
+  if (type == R_TLS_CONTENT_TYPE_APPLICATION_DATA) {
+    if (R_UNLIKELY (server->state != R_TLS_SERVER_APPDATA)) return FALSE;
+    server->cb.appdata (server->userdata, buf, server);
+    return TRUE;
+  }
+
+  /* Anything else is rare and small: frame it as a plaintext record and let
+   * the usual record processing take it from there. */
+  if ((size = r_buffer_get_size (buf)) > R_TLS_MAX_PLAINTEXT) {
+    r_tls_server_send_alert (server, R_TLS_ALERT_TYPE_RECORD_OVERFLOW);
+    return FALSE;
+  }
+  if ((rec = r_buffer_new_alloc (NULL, R_TLS_RECORD_HDR_SIZE + size, NULL)) == NULL)
+    return FALSE;
+  if (!r_buffer_map (rec, &out, R_MEM_MAP_WRITE)) {
+    r_buffer_unref (rec);
+    return FALSE;
+  }
+  out.data[0] = (ruint8) type;
+  out.data[1] = (ruint8) (R_TLS_VERSION_TLS_1_2 >> 8);
+  out.data[2] = (ruint8) (R_TLS_VERSION_TLS_1_2 & 0xff);
+  out.data[3] = (ruint8) (size >> 8);
+  out.data[4] = (ruint8) (size & 0xff);
+  r_buffer_extract (buf, 0, out.data + R_TLS_RECORD_HDR_SIZE, size);
+  r_buffer_unmap (rec, &out);
+
+  ret = r_tls_server_incoming (server, rec);
+  r_buffer_unref (rec);
+  return ret;
+}
+
+void
+r_tls_priv_key_op_complete (RTLSPrivKeyOp * op)
+{
+  RTLSServer * server;
+  RBuffer * pending;
+  RTLSError err;
+
+  if (R_UNLIKELY (op == NULL)) return;
+
+  server = op->server;
+  op->completed = TRUE;
+  /* Completed from within the callback: r_tls_server_sign carries on inline. */
+  if (server->privop_dispatching)
+    return;
+
+  server->privop = NULL;
+  if (server->state != R_TLS_SERVER_ERROR) {
+    if ((err = op->result) == R_TLS_ERROR_OK) {
+      switch (op->resume) {
+        case R_TLS_PRIV_KEY_OP_RESUME_KEY_EXCHANGE:
+          if ((err = r_tls_server_write_key_exchange_signed (server,
+                  op->sig, op->siglen)) == R_TLS_ERROR_OK)
+            server->server.msgseq++;
+          r_tls_server_write_flight_end (server);
+          err = R_TLS_ERROR_OK;
+          break;
+        case R_TLS_PRIV_KEY_OP_RESUME_FLIGHT13:
+          err = r_tls_server_write_flight13_end (server, op->sig, op->siglen);
+          break;
+      }
+    }
+
+    if (err == R_TLS_ERROR_OK) {
+      r_tls_server_send_out (server);
+      /* Replay whatever arrived while suspended. */
+      if ((pending = server->inbuf) != NULL) {
+        server->inbuf = NULL;
+        if (r_buffer_get_size (pending) > 0)
+          r_tls_server_incoming_data (server, pending);
+        r_buffer_unref (pending);
+      }
+    } else {
+      r_tls_server_send_alert (server, r_tls_server_alert_for_error (err));
+    }
+  }
+
+  r_tls_priv_key_op_free (op);
+}
+
+static void
+r_tls_priv_key_op_task (rpointer data, RTaskQueue * q, RTask * t)
+{
+  (void) q;
+  (void) t;
+
+  r_tls_priv_key_op_run (data);
+}
+
+static void
+r_tls_priv_key_op_task_done (rpointer data, REvLoop * loop)
+{
+  (void) loop;
+
+  r_tls_priv_key_op_complete (data);
+}
+
+rboolean
+r_tls_server_offload_priv_key_op (rpointer ctx, RTLSPrivKeyOp * op,
+    rpointer session)
+{
+  RTLSServer * server = session;
+  RTask * task;
+
+  (void) ctx;
+
+  if (R_UNLIKELY (op == NULL || server == NULL)) return FALSE;
+  if (server->loop == NULL)
+    return FALSE;
+
+  if ((task = r_ev_loop_add_task (server->loop, r_tls_priv_key_op_task,
+          r_tls_priv_key_op_task_done, op, NULL)) == NULL)
+    return FALSE;
+  r_task_unref (task);
+  return TRUE;
+}
+
 rboolean
 r_tls_server_send_appdata (RTLSServer * server, RBuffer * buffer)
 {
@@ -4833,8 +5469,26 @@ r_tls_server_send_appdata (RTLSServer * server, RBuffer * buffer)
   if (R_UNLIKELY (server == NULL || buffer == NULL)) return FALSE;
   /* Application data may only flow once the handshake has finished. */
   if (R_UNLIKELY (server->state != R_TLS_SERVER_APPDATA)) return FALSE;
+
+  /* Offloaded: the lower layer frames and seals the stream itself. */
+  if (server->tx_record != NULL)
+    return r_tls_server_tx_record (server,
+        R_TLS_CONTENT_TYPE_APPLICATION_DATA, buffer) == R_TLS_ERROR_OK;
+
   if (R_UNLIKELY (!r_buffer_map (buffer, &in, R_MEM_MAP_READ))) return FALSE;
 
+  if (r_tls_server_seals_appdata (server)) {
+    if (server->corked)
+      ret = r_tls_server_cork_append (server, in.data, in.size);
+    else
+      ret = r_tls_server_seal_appdata (server, in.data, in.size);
+    r_buffer_unmap (buffer, &in);
+    if (ret != R_TLS_ERROR_OK)
+      return FALSE;
+    r_tls_server_send_out (server);
+    return TRUE;
+  }
+
   if (server->tls13) {
     ret = r_tls_server_protect_record13 (server,
         R_TLS_CONTENT_TYPE_APPLICATION_DATA, in.data, in.size);
@@ -4877,6 +5531,73 @@ r_tls_server_send_appdata (RTLSServer * server, RBuffer * buffer)
   return TRUE;
 }
 
+RTLSError
+r_tls_server_set_tx_offload (RTLSServer * server,
+    RTLSTxRecordCb record, RTLSTxKeysCb keys)
+{
+  RTLSTrafficKeys tk;
+  rboolean ok;
+
+  if (R_UNLIKELY (server == NULL || record == NULL || keys == NULL))
+    return R_TLS_ERROR_INVAL;
+  if (R_UNLIKELY (server->state != R_TLS_SERVER_APPDATA || server->tx_record != NULL))
+    return R_TLS_ERROR_WRONG_STATE;
+  /* The lower layer fills records up to 2^14 on its own. */
+  if (server->max_fragment != 0 || server->peer_record_size_limit != 0)
+    return R_TLS_ERROR_NOT_SUPPORTED;
+  if (!r_tls_server_traffic_keys (server, TRUE, &tk)) {
+    r_memclear_secure (&tk, sizeof (tk));
+    return R_TLS_ERROR_NOT_SUPPORTED;
+  }
+
+  /* Whatever we sealed ourselves goes first. */
+  if (r_tls_server_cork_flush (server) != R_TLS_ERROR_OK) {
+    r_memclear_secure (&tk, sizeof (tk));
+    return R_TLS_ERROR_ENCRYPTION_FAILED;
+  }
+  r_tls_server_send_out (server);
+  ok = keys (server->userdata, &tk, server);
+  r_memclear_secure (&tk, sizeof (tk));
+  if (!ok)
+    return R_TLS_ERROR_NOT_SUPPORTED;
+
+  R_LOG_DEBUG ("%p - transmit offloaded", server);
+  server->tx_record = record;
+  server->tx_keys = keys;
+  return R_TLS_ERROR_OK;
+}
+
+RTLSError
+r_tls_server_set_rx_offload (RTLSServer * server, RTLSRxKeysCb keys)
+{
+  RTLSTrafficKeys tk;
+  rboolean ok;
+
+  if (R_UNLIKELY (server == NULL || keys == NULL))
+    return R_TLS_ERROR_INVAL;
+  if (R_UNLIKELY (server->state != R_TLS_SERVER_APPDATA || server->rx_keys != NULL))
+    return R_TLS_ERROR_WRONG_STATE;
+  /* The lower layer takes over at a record boundary: the rest of a partly
+   * received record has to be fed in first. */
+  if (server->inbuf != NULL)
+    return R_TLS_ERROR_WRONG_STATE;
+  if (server->max_fragment != 0 || server->peer_record_size_limit != 0)
+    return R_TLS_ERROR_NOT_SUPPORTED;
+  if (!r_tls_server_traffic_keys (server, FALSE, &tk)) {
+    r_memclear_secure (&tk, sizeof (tk));
+    return R_TLS_ERROR_NOT_SUPPORTED;
+  }
+
+  ok = keys (server->userdata, &tk, server);
+  r_memclear_secure (&tk, sizeof (tk));
+  if (!ok)
+    return R_TLS_ERROR_NOT_SUPPORTED;
+
+  R_LOG_DEBUG ("%p - receive offloaded", server);
+  server->rx_keys = keys;
+  return R_TLS_ERROR_OK;
+}
+
 rboolean
 r_tls_server_key_update (RTLSServer * server, rboolean request_peer_update)
 {
@@ -4886,13 +5607,40 @@ r_tls_server_key_update (RTLSServer * server, rboolean request_peer_update)
   if (R_UNLIKELY (!server->tls13 || server->state != R_TLS_SERVER_APPDATA))
     return FALSE;
 
-  if (r_tls_server_send_key_update13 (server, request_peer_update) != R_TLS_ERROR_OK)
+  /* Held-back data belongs to the current key generation. */
+  if (r_tls_server_cork_flush (server) != R_TLS_ERROR_OK ||
+      r_tls_server_send_key_update13 (server, request_peer_update) != R_TLS_ERROR_OK)
     return FALSE;
 
   r_tls_server_send_out (server);
   return TRUE;
 }
 
+rboolean
+r_tls_server_cork (RTLSServer * server)
+{
+  if (R_UNLIKELY (server == NULL)) return FALSE;
+  if (R_UNLIKELY (server->state != R_TLS_SERVER_APPDATA)) return FALSE;
+
+  server->corked = TRUE;
+  return TRUE;
+}
+
+rboolean
+r_tls_server_uncork (RTLSServer * server)
+{
+  RTLSError ret;
+
+  if (R_UNLIKELY (server == NULL)) return FALSE;
+  if (!server->corked) return TRUE;
+
+  server->corked = FALSE;
+  if ((ret = r_tls_server_cork_flush (server)) != R_TLS_ERROR_OK)
+    return FALSE;
+  r_tls_server_send_out (server);
+  return TRUE;
+}
+
 rboolean
 r_tls_server_close (RTLSServer * server)
 {
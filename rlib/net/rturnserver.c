@@ -0,0 +1,1192 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2017 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+
+#include "config.h"
+#include "../rlib-private.h"
+#include <rlib/net/rturnserver.h>
+
+#include <rlib/ev/revloop.h>
+#include <rlib/ev/revudp.h>
+#include <rlib/net/proto/rstun.h>
+
+#include <rlib/concurrency/ratomic.h>
+#include <rlib/concurrency/rtaskqueue.h>
+#include <rlib/concurrency/rthreads.h>
+#include <rlib/data/rbitset.h>
+#include <rlib/data/rhashtable.h>
+#include <rlib/os/rsys.h>
+
+#include <rlib/rmem.h>
+#include <rlib/rrand.h>
+#include <rlib/rstr.h>
+
+#define R_LOG_CAT_DEFAULT &turnsrvcat
+R_LOG_CATEGORY_DEFINE_STATIC (turnsrvcat, "turnserver", "RLib TURN server",
+    R_CLR_FG_WHITE | R_CLR_BG_CYAN | R_CLR_FMT_BOLD);
+
+void
+r_turn_server_init (void)
+{
+  r_log_category_register (&turnsrvcat);
+}
+
+/* Housekeeping: expire allocations, publish counters, notice stop. */
+#define R_TURN_SERVER_TICK        (100 * R_MSECOND)
+/* Datagrams per receive / send batch. */
+#define R_TURN_SERVER_BATCH       R_SOCKET_DATAGRAM_BATCH_MAX
+/* Buffer per datagram; relayed data must leave room for a Data indication. */
+#define R_TURN_SERVER_MTU         2048
+#define R_TURN_SERVER_MAX_DATA    (R_TURN_SERVER_MTU - 64)
+/* USERNAME is limited to 513 bytes (RFC 8489 14.3). */
+#define R_TURN_SERVER_MAX_USERNAME  513
+
+typedef struct RTurnWorker RTurnWorker;
+
+typedef struct {
+  RSocketAddress * peer;            /* only the IP is matched */
+  RClockTime expires;
+} RTurnPerm;
+
+typedef struct {
+  ruint16 number;
+  RSocketAddress * peer;
+  RClockTime expires;
+} RTurnChannel;
+
+typedef struct {
+  RTurnWorker * worker;
+  RSocketAddress * client;
+  const ruint8 * key;               /* borrowed from the server's user table */
+  REvUDP * relay;
+  RSocketAddress * relayaddr;
+  RClockTime expires;
+
+  RHashTable * perms;               /* peer IP -> RTurnPerm * */
+  RHashTable * chan_by_number;      /* number -> RTurnChannel * (owner) */
+  RHashTable * chan_by_peer;        /* peer address -> RTurnChannel * */
+
+  ruint64 tokens;                   /* bandwidth quota bucket, in bytes */
+  RClockTime tokens_ts;
+} RTurnAlloc;
+
+struct RTurnWorker {
+  RTurnServer * server;
+  REvLoop * loop;
+  REvUDP * listener;
+  RThread * thread;
+  RClockEntry * tick;
+  RClockTime now;
+  RPrng * prng;                     /* Data indication transaction IDs */
+
+  RHashTable * allocs;              /* client address -> RTurnAlloc * */
+
+  /* Receive batches: one for the listener, one shared by every relay
+   * socket on this loop (callbacks never nest). */
+  RSocketDatagram in[R_TURN_SERVER_BATCH];
+  RSocketDatagram relayin[R_TURN_SERVER_BATCH];
+
+  /* Output gathered while processing a batch. Datagrams to clients are
+   * built into the worker's own buffers and all leave the listener;
+   * datagrams to peers point into the listener batch they were received in
+   * and are flushed before it is reused. */
+  RSocketDatagram toclient[R_TURN_SERVER_BATCH];
+  rsize nclient;
+  RSocketDatagram topeer[R_TURN_SERVER_BATCH];
+  REvUDP * topeer_relay[R_TURN_SERVER_BATCH];
+  RSocketAddress * topeer_owned[R_TURN_SERVER_BATCH];
+  rsize npeer;
+  rboolean flush_pending;
+  ruint8 * mem;
+
+  RTurnServerStats stats;
+  RMutex stats_mutex;
+  RTurnServerStats published;
+};
+
+struct RTurnServer {
+  RRef ref;
+
+  rchar * realm;
+  rchar * nonce;
+  RHashTable * users;               /* user name -> MD5(user:realm:pass) */
+  RTurnServerQuota quota;
+
+  RSocketAddress * relayip;
+  RSocketAddress * local;
+  RTaskQueue * tq;
+  raint running;
+  raint allocations;
+
+  ruint nworkers;
+  RTurnWorker * workers;
+};
+
+static void r_turn_worker_flush (RTurnWorker * worker);
+
+/* --- address hashing ----------------------------------------------------- */
+
+static rsize
+r_turn_addr_hash_full (const RSocketAddress * addr, rboolean port)
+{
+  ruint64 h = (ruint64) r_socket_address_get_family (addr);
+  ruint8 ip6[16];
+  ruint i;
+
+  if (h == R_SOCKET_FAMILY_IPV4) {
+    h = (h << 32) ^ r_socket_address_ipv4_get_ip (addr);
+    if (port)
+      h ^= (ruint64) r_socket_address_ipv4_get_port (addr) << 40;
+  } else if (r_socket_address_ipv6_get_ip_bytes (addr, ip6)) {
+    for (i = 0; i < sizeof (ip6); i += 4)
+      h = (h * RUINT64_CONSTANT (0x100000001b3)) ^ RUINT32_FROM_BE (*(ruint32 *)&ip6[i]);
+    if (port)
+      h ^= (ruint64) r_socket_address_ipv6_get_port (addr) << 40;
+  }
+
+  h *= RUINT64_CONSTANT (0x9e3779b97f4a7c15);
+  return (rsize) (h ^ (h >> 29));
+}
+
+static rboolean
+r_turn_addr_equal_ip (const RSocketAddress * a, const RSocketAddress * b)
+{
+  RSocketFamily fa = r_socket_address_get_family (a);
+  ruint8 ia[16], ib[16];
+
+  if (fa != r_socket_address_get_family (b))
+    return FALSE;
+  if (fa == R_SOCKET_FAMILY_IPV4)
+    return r_socket_address_ipv4_get_ip (a) == r_socket_address_ipv4_get_ip (b);
+  return r_socket_address_ipv6_get_ip_bytes (a, ia) &&
+    r_socket_address_ipv6_get_ip_bytes (b, ib) && r_memcmp (ia, ib, 16) == 0;
+}
+
+static rsize
+r_turn_addr_hash (rconstpointer key)
+{
+  return r_turn_addr_hash_full (key, TRUE);
+}
+
+static rboolean
+r_turn_addr_equal (rconstpointer a, rconstpointer b)
+{
+  return r_socket_address_is_equal (a, b);
+}
+
+static rsize
+r_turn_addr_ip_hash (rconstpointer key)
+{
+  return r_turn_addr_hash_full (key, FALSE);
+}
+
+static rboolean
+r_turn_addr_ip_equal (rconstpointer a, rconstpointer b)
+{
+  return r_turn_addr_equal_ip (a, b);
+}
+
+static rsize
+r_turn_number_hash (rconstpointer key)
+{
+  return RPOINTER_TO_SIZE (key) * 0x9e3779b1;
+}
+
+static rboolean
+r_turn_number_equal (rconstpointer a, rconstpointer b)
+{
+  return a == b;
+}
+
+/* --- allocations --------------------------------------------------------- */
+
+static void
+r_turn_perm_free (rpointer data)
+{
+  RTurnPerm * perm = data;
+  r_socket_address_unref (perm->peer);
+  r_free (perm);
+}
+
+static void
+r_turn_channel_free (rpointer data)
+{
+  RTurnChannel * chan = data;
+  r_socket_address_unref (chan->peer);
+  r_free (chan);
+}
+
+static void
+r_turn_alloc_free (rpointer data)
+{
+  RTurnAlloc * alloc = data;
+  RTurnWorker * worker = alloc->worker;
+
+  /* Queued output may still reference this allocation's relay. */
+  r_turn_worker_flush (worker);
+
+  if (alloc->relay != NULL) {
+    r_ev_udp_recv_stop (alloc->relay);
+    r_ev_udp_unref (alloc->relay);
+  }
+  if (alloc->relayaddr != NULL)
+    r_socket_address_unref (alloc->relayaddr);
+  r_hash_table_unref (alloc->chan_by_peer);
+  r_hash_table_unref (alloc->chan_by_number);
+  r_hash_table_unref (alloc->perms);
+  r_socket_address_unref (alloc->client);
+  r_free (alloc);
+
+  worker->stats.allocations--;
+  r_atomic_int_fetch_sub (&worker->server->allocations, 1);
+}
+
+static rboolean
+r_turn_alloc_has_perm (RTurnAlloc * alloc, const RSocketAddress * peer)
+{
+  RTurnPerm * perm = r_hash_table_lookup (alloc->perms, peer);
+  return perm != NULL && perm->expires > alloc->worker->now;
+}
+
+static rboolean
+r_turn_perm_expired (rpointer key, rpointer value, rpointer user)
+{
+  (void) key;
+  return ((RTurnPerm *) value)->expires <= *(const RClockTime *) user;
+}
+
+/* Install or refresh the permission for @peer's IP. */
+static rboolean
+r_turn_alloc_add_perm (RTurnAlloc * alloc, const RSocketAddress * peer)
+{
+  RTurnWorker * worker = alloc->worker;
+  ruint max = worker->server->quota.max_permissions;
+  RTurnPerm * perm;
+
+  if ((perm = r_hash_table_lookup (alloc->perms, peer)) == NULL) {
+    if (max > 0 && r_hash_table_size (alloc->perms) >= max) {
+      r_hash_table_remove_with_func (alloc->perms, r_turn_perm_expired, &worker->now);
+      if (r_hash_table_size (alloc->perms) >= max)
+        return FALSE;
+    }
+    if ((perm = r_mem_new (RTurnPerm)) == NULL)
+      return FALSE;
+    perm->peer = r_socket_address_copy (peer);
+    r_hash_table_insert (alloc->perms, perm->peer, perm);
+  }
+
+  perm->expires = worker->now + R_TURN_SERVER_PERM_LIFETIME * R_SECOND;
+  return TRUE;
+}
+
+static RTurnChannel *
+r_turn_alloc_channel_by_number (RTurnAlloc * alloc, ruint16 number)
+{
+  RTurnChannel * chan = r_hash_table_lookup (alloc->chan_by_number,
+      RSIZE_TO_POINTER (number));
+  return (chan != NULL && chan->expires > alloc->worker->now) ? chan : NULL;
+}
+
+static RTurnChannel *
+r_turn_alloc_channel_by_peer (RTurnAlloc * alloc, const RSocketAddress * peer)
+{
+  RTurnChannel * chan = r_hash_table_lookup (alloc->chan_by_peer, peer);
+  return (chan != NULL && chan->expires > alloc->worker->now) ? chan : NULL;
+}
+
+/* Take @size bytes out of the allocation's bandwidth bucket, which refills
+ * at the quota rate and holds one second's worth. */
+static rboolean
+r_turn_alloc_consume (RTurnAlloc * alloc, rsize size)
+{
+  RTurnWorker * worker = alloc->worker;
+  ruint64 rate = worker->server->quota.max_bps / 8;
+
+  if (rate == 0)
+    return TRUE;
+
+  if (worker->now > alloc->tokens_ts) {
+    alloc->tokens += (worker->now - alloc->tokens_ts) * rate / R_SECOND;
+    alloc->tokens = MIN (alloc->tokens, rate);
+    alloc->tokens_ts = worker->now;
+  }
+  if (alloc->tokens < size)
+    return FALSE;
+
+  alloc->tokens -= size;
+  return TRUE;
+}
+
+/* --- output batching ----------------------------------------------------- */
+
+static void
+r_turn_worker_publish (RTurnWorker * worker)
+{
+  r_mutex_lock (&worker->stats_mutex);
+  worker->published = worker->stats;
+  r_mutex_unlock (&worker->stats_mutex);
+}
+
+static void
+r_turn_worker_flush (RTurnWorker * worker)
+{
+  rsize i, j;
+
+  if (worker->nclient > 0) {
+    r_ev_udp_send_batch (worker->listener, worker->toclient, worker->nclient);
+    worker->nclient = 0;
+  }
+
+  /* Send runs of datagrams leaving the same relayed socket together. */
+  for (i = 0; i < worker->npeer; i = j) {
+    for (j = i + 1; j < worker->npeer &&
+        worker->topeer_relay[j] == worker->topeer_relay[i]; j++);
+    r_ev_udp_send_batch (worker->topeer_relay[i], &worker->topeer[i], j - i);
+  }
+  for (i = 0; i < worker->npeer; i++) {
+    if (worker->topeer_owned[i] != NULL) {
+      r_socket_address_unref (worker->topeer_owned[i]);
+      worker->topeer_owned[i] = NULL;
+    }
+  }
+  worker->npeer = 0;
+}
+
+static void
+r_turn_worker_flush_cb (rpointer data, REvLoop * loop)
+{
+  RTurnWorker * worker = data;
+  (void) loop;
+
+  worker->flush_pending = FALSE;
+  r_turn_worker_flush (worker);
+  r_turn_worker_publish (worker);
+}
+
+/* A buffer of R_TURN_SERVER_MTU bytes for the next datagram to a client. */
+static ruint8 *
+r_turn_worker_client_buf (RTurnWorker * worker)
+{
+  if (worker->nclient == R_TURN_SERVER_BATCH)
+    r_turn_worker_flush (worker);
+  return worker->toclient[worker->nclient].data;
+}
+
+static void
+r_turn_worker_queue_client (RTurnWorker * worker, RSocketAddress * to, rsize len)
+{
+  if (len > 0) {
+    worker->toclient[worker->nclient].address = to;
+    worker->toclient[worker->nclient].size = len;
+    worker->nclient++;
+  }
+}
+
+static void
+r_turn_worker_queue_peer (RTurnWorker * worker, REvUDP * relay,
+    RSocketAddress * to, RSocketAddress * owned, rconstpointer data, rsize size)
+{
+  if (worker->npeer == R_TURN_SERVER_BATCH)
+    r_turn_worker_flush (worker);
+
+  worker->topeer[worker->npeer].address = to;
+  worker->topeer[worker->npeer].data = (rpointer) data;
+  worker->topeer[worker->npeer].size = size;
+  worker->topeer_relay[worker->npeer] = relay;
+  worker->topeer_owned[worker->npeer] = owned;
+  worker->npeer++;
+}
+
+/* --- relay: peer -> client ----------------------------------------------- */
+
+/* A datagram from a peer goes to the client as ChannelData on a bound
+ * channel, otherwise as a Data indication. Only permitted peers get through
+ * (RFC 8656 11.3). */
+static void
+r_turn_alloc_relay_recv (rpointer data, RSocketDatagram * dgrams, rsize count,
+    REvUDP * evudp)
+{
+  RTurnAlloc * alloc = data;
+  RTurnWorker * worker = alloc->worker;
+  RTurnChannel * chan;
+  RStunMsgCtx ctx;
+  ruint8 tid[R_STUN_TRANSACTION_ID_SIZE];
+  ruint8 * out;
+  rsize i, len;
+  (void) evudp;
+
+  worker->now = r_clock_get_time (r_ev_loop_get_clock (worker->loop));
+  worker->stats.batches++;
+
+  for (i = 0; i < count; i++) {
+    RSocketDatagram * d = &dgrams[i];
+
+    if (d->len > R_TURN_SERVER_MAX_DATA ||
+        !r_turn_alloc_has_perm (alloc, d->address) ||
+        !r_turn_alloc_consume (alloc, d->len)) {
+      worker->stats.dropped++;
+      continue;
+    }
+
+    out = r_turn_worker_client_buf (worker);
+    if ((chan = r_turn_alloc_channel_by_peer (alloc, d->address)) != NULL) {
+      len = r_stun_channel_data_encode (out, R_TURN_SERVER_MTU, chan->number,
+          d->data, d->len);
+    } else {
+      r_prng_fill (worker->prng, tid, sizeof (tid));
+      if (r_stun_msg_begin (&ctx, out, R_TURN_SERVER_MTU, R_STUN_CLASS_INDICATION,
+            R_STUN_METHOD_DATA, tid)) {
+        r_stun_msg_add_xor_address (&ctx, R_STUN_ATTR_TYPE_XOR_PEER_ADDRESS, d->address);
+        r_stun_msg_add_data (&ctx, d->data, d->len);
+        len = r_stun_msg_end (&ctx, TRUE);
+      } else {
+        len = 0;
+      }
+    }
+
+    r_turn_worker_queue_client (worker, alloc->client, len);
+    worker->stats.client_packets++;
+    worker->stats.client_bytes += d->len;
+  }
+
+  /* Relayed sockets each get their own readiness event; gather everything
+   * they produce this loop iteration into one send batch. */
+  if (worker->nclient > 0 && !worker->flush_pending) {
+    worker->flush_pending = r_ev_loop_add_callback (worker->loop, FALSE,
+        r_turn_worker_flush_cb, worker, NULL);
+  }
+}
+
+/* --- requests ------------------------------------------------------------ */
+
+/* Verify USERNAME + MESSAGE-INTEGRITY against the long-term credentials;
+ * the user's key, or NULL. */
+static const ruint8 *
+r_turn_worker_check_auth (RTurnWorker * worker, rconstpointer msg)
+{
+  RStunAttrTLV tlv = R_STUN_ATTR_TLV_INIT, mi = R_STUN_ATTR_TLV_INIT;
+  rchar user[R_TURN_SERVER_MAX_USERNAME + 1];
+  const ruint8 * key;
+  rboolean have_user = FALSE, have_mi = FALSE;
+
+  if (r_stun_attr_tlv_first (msg, &tlv)) {
+    do {
+      if (tlv.type == R_STUN_ATTR_TYPE_USERNAME && tlv.len < sizeof (user)) {
+        r_memcpy (user, tlv.value, tlv.len);
+        user[tlv.len] = 0;
+        have_user = TRUE;
+      } else if (tlv.type == R_STUN_ATTR_TYPE_MESSAGE_INTEGRITY) {
+        mi = tlv;
+        have_mi = TRUE;
+      }
+    } while (r_stun_attr_tlv_next (msg, &tlv));
+  }
+
+  if (!have_user || !have_mi ||
+      (key = r_hash_table_lookup (worker->server->users, user)) == NULL ||
+      !r_stun_msg_check_integrity_short_cred (msg, &mi, key, 16))
+    return NULL;
+
+  return key;
+}
+
+static void
+r_turn_worker_reply_error (RTurnWorker * worker, RSocketAddress * to,
+    rconstpointer msg, const ruint8 * key, ruint code, const rchar * reason)
+{
+  RStunMsgCtx ctx;
+
+  if (r_stun_msg_begin (&ctx, r_turn_worker_client_buf (worker), R_TURN_SERVER_MTU,
+        R_STUN_CLASS_ERROR_RESPONSE, r_stun_msg_type (msg) & R_STUN_TYPE_METHOD_MASK,
+        r_stun_msg_transaction_id (msg))) {
+    r_stun_msg_add_error_code (&ctx, code, reason);
+    if (key != NULL) {
+      r_stun_msg_add_message_integrity_short_cred (&ctx, key, 16);
+    } else {
+      r_stun_msg_add_string (&ctx, R_STUN_ATTR_TYPE_REALM, worker->server->realm, -1);
+      r_stun_msg_add_string (&ctx, R_STUN_ATTR_TYPE_NONCE, worker->server->nonce, -1);
+    }
+    r_turn_worker_queue_client (worker, to, r_stun_msg_end (&ctx, TRUE));
+  }
+}
+
+static void
+r_turn_worker_reply_success (RTurnWorker * worker, RSocketAddress * to,
+    rconstpointer msg, const ruint8 * key, RTurnAlloc * alloc, rboolean lifetime)
+{
+  RStunMsgCtx ctx;
+  ruint32 secs;
+
+  if (r_stun_msg_begin (&ctx, r_turn_worker_client_buf (worker), R_TURN_SERVER_MTU,
+        R_STUN_CLASS_SUCCESS_RESPONSE, r_stun_msg_type (msg) & R_STUN_TYPE_METHOD_MASK,
+        r_stun_msg_transaction_id (msg))) {
+    if (alloc != NULL && r_stun_msg_method_is_allocate (msg)) {
+      r_stun_msg_add_xor_address (&ctx, R_STUN_ATTR_TYPE_XOR_RELAYED_ADDRESS, alloc->relayaddr);
+      r_stun_msg_add_xor_address (&ctx, R_STUN_ATTR_TYPE_XOR_MAPPED_ADDRESS, to);
+    }
+    if (lifetime) {
+      secs = (alloc != NULL && alloc->expires > worker->now) ?
+        (ruint32) ((alloc->expires - worker->now + R_SECOND / 2) / R_SECOND) : 0;
+      r_stun_msg_add_lifetime (&ctx, secs);
+    }
+    r_stun_msg_add_message_integrity_short_cred (&ctx, key, 16);
+    r_turn_worker_queue_client (worker, to, r_stun_msg_end (&ctx, TRUE));
+  }
+}
+
+/* Requested LIFETIME, clamped to the server's range. */
+static ruint32
+r_turn_msg_lifetime (rconstpointer msg)
+{
+  RStunAttrTLV tlv = R_STUN_ATTR_TLV_INIT;
+  ruint32 ret = R_TURN_SERVER_LIFETIME;
+
+  if (r_stun_attr_tlv_first (msg, &tlv)) {
+    do {
+      if (tlv.type == R_STUN_ATTR_TYPE_LIFETIME && tlv.len >= 4)
+        ret = r_stun_attr_tlv_parse_lifetime (msg, &tlv);
+    } while (r_stun_attr_tlv_next (msg, &tlv));
+  }
+
+  return ret > 0 ? CLAMP (ret, R_TURN_SERVER_LIFETIME, R_TURN_SERVER_MAX_LIFETIME) : 0;
+}
+
+/* Takes over a slot already reserved in server->allocations; freeing the
+ * allocation, also on failure here, gives it back. */
+static RTurnAlloc *
+r_turn_worker_new_alloc (RTurnWorker * worker, RSocketAddress * client,
+    const ruint8 * key, ruint32 lifetime)
+{
+  RTurnServer * server = worker->server;
+  RTurnAlloc * alloc;
+
+  if ((alloc = r_mem_new0 (RTurnAlloc)) == NULL) {
+    r_atomic_int_fetch_sub (&server->allocations, 1);
+    return NULL;
+  }
+
+  alloc->worker = worker;
+  alloc->client = r_socket_address_copy (client);
+  alloc->key = key;
+  alloc->expires = worker->now + lifetime * R_SECOND;
+  alloc->perms = r_hash_table_new_full (r_turn_addr_ip_hash, r_turn_addr_ip_equal,
+      NULL, r_turn_perm_free);
+  alloc->chan_by_number = r_hash_table_new_full (r_turn_number_hash,
+      r_turn_number_equal, NULL, r_turn_channel_free);
+  alloc->chan_by_peer = r_hash_table_new (r_turn_addr_hash, r_turn_addr_equal);
+  alloc->tokens = server->quota.max_bps / 8;
+  alloc->tokens_ts = worker->now;
+
+  worker->stats.allocations++;
+
+  alloc->relay = r_ev_udp_new (r_socket_address_get_family (server->relayip), worker->loop);
+  if (alloc->relay == NULL || !r_ev_udp_bind (alloc->relay, server->relayip, FALSE) ||
+      (alloc->relayaddr = r_ev_udp_get_local_address (alloc->relay)) == NULL ||
+      !r_ev_udp_recv_batch_start (alloc->relay, worker->relayin, R_TURN_SERVER_BATCH,
+        r_turn_alloc_relay_recv, alloc, NULL)) {
+    R_LOG_WARNING ("worker %p failed to set up relayed socket", worker);
+    r_turn_alloc_free (alloc);
+    return NULL;
+  }
+
+  worker->stats.allocations_total++;
+  return alloc;
+}
+
+static void
+r_turn_worker_handle_allocate (RTurnWorker * worker, rconstpointer msg,
+    RSocketAddress * from, const ruint8 * key, RTurnAlloc * alloc)
+{
+  RStunAttrTLV tlv = R_STUN_ATTR_TLV_INIT;
+  ruint max = worker->server->quota.max_allocations;
+  ruint32 lifetime;
+
+  /* A retransmitted Allocate gets the same answer (RFC 8656 7.2). */
+  if (alloc != NULL) {
+    r_turn_worker_reply_success (worker, from, msg, key, alloc, TRUE);
+    return;
+  }
+
+  if (r_stun_attr_tlv_first (msg, &tlv)) {
+    do {
+      if (tlv.type == R_STUN_ATTR_TYPE_REQUESTED_TRANSPORT &&
+          r_stun_attr_tlv_parse_requested_transport_protocol (msg, &tlv) !=
+          R_SOCKET_PROTOCOL_UDP) {
+        r_turn_worker_reply_error (worker, from, msg, key, 442, "Unsupported Transport Protocol");
+        return;
+      }
+    } while (r_stun_attr_tlv_next (msg, &tlv));
+  }
+
+  /* Reserve the slot before checking, workers allocate concurrently */
+  if ((ruint) r_atomic_int_fetch_add (&worker->server->allocations, 1) >= max &&
+      max > 0) {
+    r_atomic_int_fetch_sub (&worker->server->allocations, 1);
+    worker->stats.quota_rejects++;
+    r_turn_worker_reply_error (worker, from, msg, key, 486, "Allocation Quota Reached");
+    return;
+  }
+
+  if ((lifetime = r_turn_msg_lifetime (msg)) == 0)
+    lifetime = R_TURN_SERVER_LIFETIME;
+  if ((alloc = r_turn_worker_new_alloc (worker, from, key, lifetime)) == NULL) {
+    r_turn_worker_reply_error (worker, from, msg, key, 508, "Insufficient Capacity");
+    return;
+  }
+
+  r_hash_table_insert (worker->allocs, alloc->client, alloc);
+  r_turn_worker_reply_success (worker, from, msg, key, alloc, TRUE);
+}
+
+static void
+r_turn_worker_handle_refresh (RTurnWorker * worker, rconstpointer msg,
+    RSocketAddress * from, const ruint8 * key, RTurnAlloc * alloc)
+{
+  ruint32 lifetime = r_turn_msg_lifetime (msg);
+
+  if (alloc == NULL) {
+    r_turn_worker_reply_error (worker, from, msg, key, 437, "Allocation Mismatch");
+  } else if (lifetime == 0) {
+    r_hash_table_remove (worker->allocs, from);
+    r_turn_worker_reply_success (worker, from, msg, key, NULL, TRUE);
+  } else {
+    alloc->expires = worker->now + lifetime * R_SECOND;
+    r_turn_worker_reply_success (worker, from, msg, key, alloc, TRUE);
+  }
+}
+
+static void
+r_turn_worker_handle_create_permission (RTurnWorker * worker, rconstpointer msg,
+    RSocketAddress * from, const ruint8 * key, RTurnAlloc * alloc)
+{
+  RStunAttrTLV tlv = R_STUN_ATTR_TLV_INIT;
+  RSocketAddress * peer;
+  rboolean ok = TRUE, any = FALSE;
+
+  if (alloc == NULL) {
+    r_turn_worker_reply_error (worker, from, msg, key, 437, "Allocation Mismatch");
+    return;
+  }
+
+  if (r_stun_attr_tlv_first (msg, &tlv)) {
+    do {
+      if (tlv.type == R_STUN_ATTR_TYPE_XOR_PEER_ADDRESS &&
+          (peer = r_stun_attr_tlv_parse_xor_address (msg, &tlv)) != NULL) {
+        any = TRUE;
+        ok = r_turn_alloc_add_perm (alloc, peer);
+        r_socket_address_unref (peer);
+      }
+    } while (ok && r_stun_attr_tlv_next (msg, &tlv));
+  }
+
+  if (!any) {
+    r_turn_worker_reply_error (worker, from, msg, key, 400, "Bad Request");
+  } else if (!ok) {
+    worker->stats.quota_rejects++;
+    r_turn_worker_reply_error (worker, from, msg, key, 508, "Insufficient Capacity");
+  } else {
+    r_turn_worker_reply_success (worker, from, msg, key, NULL, FALSE);
+  }
+}
+
+static void
+r_turn_worker_handle_channel_bind (RTurnWorker * worker, rconstpointer msg,
+    RSocketAddress * from, const ruint8 * key, RTurnAlloc * alloc)
+{
+  RStunAttrTLV tlv = R_STUN_ATTR_TLV_INIT;
+  RSocketAddress * peer = NULL;
+  RTurnChannel * bynum, * bypeer;
+  ruint max = worker->server->quota.max_channels;
+  ruint16 number = 0;
+
+  if (alloc == NULL) {
+    r_turn_worker_reply_error (worker, from, msg, key, 437, "Allocation Mismatch");
+    return;
+  }
+
+  if (r_stun_attr_tlv_first (msg, &tlv)) {
+    do {
+      if (tlv.type == R_STUN_ATTR_TYPE_CHANNEL_NUMBER && tlv.len >= 2)
+        number = RUINT16_FROM_BE (*(const ruint16 *) tlv.value);
+      else if (tlv.type == R_STUN_ATTR_TYPE_XOR_PEER_ADDRESS && peer == NULL)
+        peer = r_stun_attr_tlv_parse_xor_address (msg, &tlv);
+    } while (r_stun_attr_tlv_next (msg, &tlv));
+  }
+
+  /* The number and the peer may each only be bound to each other
+   * (RFC 8656 12.1). */
+  bynum = r_hash_table_lookup (alloc->chan_by_number, RSIZE_TO_POINTER (number));
+  bypeer = peer != NULL ? r_hash_table_lookup (alloc->chan_by_peer, peer) : NULL;
+  if (peer == NULL || number < R_STUN_CHANNEL_NUMBER_MIN ||
+      number > R_STUN_CHANNEL_NUMBER_MAX || bynum != bypeer) {
+    r_turn_worker_reply_error (worker, from, msg, key, 400, "Bad Request");
+  } else if ((bynum == NULL && max > 0 &&
+        r_hash_table_size (alloc->chan_by_number) >= max) ||
+      !r_turn_alloc_add_perm (alloc, peer)) {
+    worker->stats.quota_rejects++;
+    r_turn_worker_reply_error (worker, from, msg, key, 508, "Insufficient Capacity");
+  } else {
+    if (bynum == NULL && (bynum = r_mem_new (RTurnChannel)) != NULL) {
+      bynum->number = number;
+      bynum->peer = r_socket_address_ref (peer);
+      r_hash_table_insert (alloc->chan_by_number, RSIZE_TO_POINTER (number), bynum);
+      r_hash_table_insert (alloc->chan_by_peer, bynum->peer, bynum);
+    }
+    if (bynum != NULL)
+      bynum->expires = worker->now + R_TURN_SERVER_CHAN_LIFETIME * R_SECOND;
+    r_turn_worker_reply_success (worker, from, msg, key, NULL, FALSE);
+  }
+
+  if (peer != NULL)
+    r_socket_address_unref (peer);
+}
+
+/* --- relay: client -> peer ----------------------------------------------- */
+
+static void
+r_turn_worker_handle_send (RTurnWorker * worker, rconstpointer msg, RTurnAlloc * alloc)
+{
+  RStunAttrTLV tlv = R_STUN_ATTR_TLV_INIT;
+  RSocketAddress * peer = NULL;
+  rconstpointer data = NULL;
+  rsize dlen = 0;
+
+  if (r_stun_attr_tlv_first (msg, &tlv)) {
+    do {
+      if (tlv.type == R_STUN_ATTR_TYPE_XOR_PEER_ADDRESS && peer == NULL) {
+        peer = r_stun_attr_tlv_parse_xor_address (msg, &tlv);
+      } else if (tlv.type == R_STUN_ATTR_TYPE_DATA) {
+        data = tlv.value;
+        dlen = tlv.len;
+      }
+    } while (r_stun_attr_tlv_next (msg, &tlv));
+  }
+
+  if (peer != NULL && data != NULL && r_turn_alloc_has_perm (alloc, peer) &&
+      r_turn_alloc_consume (alloc, dlen)) {
+    r_turn_worker_queue_peer (worker, alloc->relay, peer, peer, data, dlen);
+    worker->stats.peer_packets++;
+    worker->stats.peer_bytes += dlen;
+  } else {
+    worker->stats.dropped++;
+    if (peer != NULL)
+      r_socket_address_unref (peer);
+  }
+}
+
+static void
+r_turn_worker_handle_channel_data (RTurnWorker * worker,
+    const RSocketDatagram * d, RTurnAlloc * alloc)
+{
+  RTurnChannel * chan;
+  rconstpointer data;
+  ruint16 number;
+  rsize dlen;
+
+  if (alloc != NULL &&
+      r_stun_channel_data_parse (d->data, d->len, &number, &data, &dlen) &&
+      (chan = r_turn_alloc_channel_by_number (alloc, number)) != NULL &&
+      r_turn_alloc_has_perm (alloc, chan->peer) &&
+      r_turn_alloc_consume (alloc, dlen)) {
+    r_turn_worker_queue_peer (worker, alloc->relay, chan->peer, NULL, data, dlen);
+    worker->stats.peer_packets++;
+    worker->stats.peer_bytes += dlen;
+  } else {
+    worker->stats.dropped++;
+  }
+}
+
+static void
+r_turn_worker_recv (rpointer data, RSocketDatagram * dgrams, rsize count,
+    REvUDP * evudp)
+{
+  RTurnWorker * worker = data;
+  RTurnAlloc * alloc;
+  const ruint8 * key;
+  rsize i;
+  (void) evudp;
+
+  worker->now = r_clock_get_time (r_ev_loop_get_clock (worker->loop));
+  worker->stats.batches++;
+
+  for (i = 0; i < count; i++) {
+    RSocketDatagram * d = &dgrams[i];
+    rconstpointer msg = d->data;
+
+    alloc = r_hash_table_lookup (worker->allocs, d->address);
+    if (alloc != NULL && alloc->expires <= worker->now) {
+      r_hash_table_remove (worker->allocs, d->address);
+      alloc = NULL;
+    }
+
+    if (r_stun_is_channel_data (msg, d->len)) {
+      r_turn_worker_handle_channel_data (worker, d, alloc);
+    } else if (!r_stun_is_valid_msg (msg, d->len)) {
+      worker->stats.dropped++;
+    } else if (r_stun_msg_is_indication (msg)) {
+      if (alloc != NULL && r_stun_msg_method_is_send (msg))
+        r_turn_worker_handle_send (worker, msg, alloc);
+      else
+        worker->stats.dropped++;
+    } else if (r_stun_msg_is_request (msg)) {
+      worker->stats.requests++;
+      if ((key = r_turn_worker_check_auth (worker, msg)) == NULL) {
+        worker->stats.auth_failures++;
+        r_turn_worker_reply_error (worker, d->address, msg, NULL, 401, "Unauthorized");
+      } else if (alloc != NULL && alloc->key != key) {
+        r_turn_worker_reply_error (worker, d->address, msg, key, 441, "Wrong Credentials");
+      } else if (r_stun_msg_method_is_allocate (msg)) {
+        r_turn_worker_handle_allocate (worker, msg, d->address, key, alloc);
+      } else if (r_stun_msg_method_is_refresh (msg)) {
+        r_turn_worker_handle_refresh (worker, msg, d->address, key, alloc);
+      } else if (r_stun_msg_method_is_create_permission (msg)) {
+        r_turn_worker_handle_create_permission (worker, msg, d->address, key, alloc);
+      } else if (r_stun_msg_method_is_channel_bind (msg)) {
+        r_turn_worker_handle_channel_bind (worker, msg, d->address, key, alloc);
+      } else {
+        r_turn_worker_reply_error (worker, d->address, msg, key, 400, "Bad Request");
+      }
+    }
+  }
+
+  /* Replies and relayed data reference this batch: send before the next
+   * receive reuses it. */
+  r_turn_worker_flush (worker);
+  r_turn_worker_publish (worker);
+}
+
+/* --- workers ------------------------------------------------------------- */
+
+static rboolean
+r_turn_alloc_expired (rpointer key, rpointer value, rpointer user)
+{
+  (void) key;
+  return ((RTurnAlloc *) value)->expires <= *(const RClockTime *) user;
+}
+
+static void
+r_turn_worker_tick (rpointer data, REvLoop * loop)
+{
+  RTurnWorker * worker = data;
+
+  worker->tick = NULL;
+  if (!r_atomic_int_load (&worker->server->running)) {
+    r_ev_loop_stop (loop);
+    return;
+  }
+
+  worker->now = r_clock_get_time (r_ev_loop_get_clock (loop));
+  r_hash_table_remove_with_func (worker->allocs, r_turn_alloc_expired, &worker->now);
+  r_turn_worker_publish (worker);
+
+  r_ev_loop_add_callback_later (loop, &worker->tick, R_TURN_SERVER_TICK,
+      r_turn_worker_tick, worker, NULL);
+}
+
+static rpointer
+r_turn_worker_run (rpointer data)
+{
+  RTurnWorker * worker = data;
+
+  r_ev_loop_run (worker->loop, R_EV_LOOP_RUN_LOOP);
+  return NULL;
+}
+
+static rboolean
+r_turn_worker_setup (RTurnWorker * worker, RTurnServer * server,
+    const RSocketAddress * listen)
+{
+  ruint8 * mem;
+  rsize i;
+
+  worker->server = server;
+  worker->prng = r_rand_prng_new ();
+  r_mutex_init (&worker->stats_mutex);
+
+  if ((worker->mem = mem = r_malloc (3 * R_TURN_SERVER_BATCH * R_TURN_SERVER_MTU)) == NULL)
+    return FALSE;
+  for (i = 0; i < R_TURN_SERVER_BATCH; i++) {
+    worker->in[i].address = r_socket_address_new ();
+    worker->in[i].data = mem;
+    worker->in[i].size = R_TURN_SERVER_MTU;
+    mem += R_TURN_SERVER_MTU;
+    worker->relayin[i].address = r_socket_address_new ();
+    worker->relayin[i].data = mem;
+    worker->relayin[i].size = R_TURN_SERVER_MTU;
+    mem += R_TURN_SERVER_MTU;
+    worker->toclient[i].data = mem;
+    mem += R_TURN_SERVER_MTU;
+  }
+
+  worker->allocs = r_hash_table_new_full (r_turn_addr_hash, r_turn_addr_equal,
+      NULL, r_turn_alloc_free);
+  if ((worker->loop = r_ev_loop_new_full (NULL, server->tq)) == NULL ||
+      (worker->listener = r_ev_udp_new (r_socket_address_get_family (listen),
+          worker->loop)) == NULL)
+    return FALSE;
+
+  /* Every worker binds the same address; SO_REUSEPORT spreads clients. */
+  if (!r_ev_udp_bind (worker->listener, listen, TRUE) ||
+      !r_ev_udp_recv_batch_start (worker->listener, worker->in, R_TURN_SERVER_BATCH,
+        r_turn_worker_recv, worker, NULL))
+    return FALSE;
+
+  return r_ev_loop_add_callback_later (worker->loop, &worker->tick,
+      R_TURN_SERVER_TICK, r_turn_worker_tick, worker, NULL);
+}
+
+static void
+r_turn_worker_clear (RTurnWorker * worker)
+{
+  rsize i;
+
+  if (worker->server == NULL)
+    return;
+
+  if (worker->tick != NULL) {
+    r_ev_loop_cancel_timer (worker->loop, worker->tick);
+    worker->tick = NULL;
+  }
+  if (worker->allocs != NULL) {
+    r_hash_table_remove_all (worker->allocs);
+    r_hash_table_unref (worker->allocs);
+  }
+  r_turn_worker_flush (worker);
+  if (worker->listener != NULL) {
+    r_ev_udp_recv_stop (worker->listener);
+    r_ev_udp_unref (worker->listener);
+  }
+  if (worker->loop != NULL)
+    r_ev_loop_unref (worker->loop);
+
+  for (i = 0; i < R_TURN_SERVER_BATCH; i++) {
+    if (worker->in[i].address != NULL)
+      r_socket_address_unref (worker->in[i].address);
+    if (worker->relayin[i].address != NULL)
+      r_socket_address_unref (worker->relayin[i].address);
+  }
+  r_free (worker->mem);
+  if (worker->prng != NULL)
+    r_prng_unref (worker->prng);
+  r_mutex_clear (&worker->stats_mutex);
+  worker->server = NULL;
+}
+
+/* Pin worker @idx to the @idx'th allowed CPU when there's one per core. */
+static RThread *
+r_turn_worker_start_thread (RTurnWorker * worker, ruint idx, ruint count)
+{
+  RBitset * allowed, * cpuset;
+  rsize cpu, seen = 0;
+
+  if (count > 1 && count <= r_sys_cpu_allowed_count () &&
+      r_bitset_init_stack (allowed, r_sys_cpuset_max ()) &&
+      r_bitset_init_stack (cpuset, r_sys_cpuset_max ()) &&
+      r_sys_cpuset_allowed (allowed)) {
+    for (cpu = 0; cpu < r_sys_cpuset_max (); cpu++) {
+      if (r_bitset_is_bit_set (allowed, cpu) && seen++ == idx) {
+        r_bitset_clear (cpuset);
+        r_bitset_set_bit (cpuset, cpu, TRUE);
+        return r_thread_new_full ("turnsrv", cpuset, r_turn_worker_run, worker);
+      }
+    }
+  }
+
+  return r_thread_new ("turnsrv", r_turn_worker_run, worker);
+}
+
+/* --- server -------------------------------------------------------------- */
+
+static void
+r_turn_server_free (RTurnServer * server)
+{
+  r_turn_server_stop (server);
+  r_hash_table_unref (server->users);
+  r_free (server->nonce);
+  r_free (server->realm);
+  r_free (server);
+}
+
+RTurnServer *
+r_turn_server_new (const rchar * realm)
+{
+  RTurnServer * ret;
+  ruint8 rnd[8];
+
+  if (R_UNLIKELY (realm == NULL)) return NULL;
+
+  if ((ret = r_mem_new0 (RTurnServer)) != NULL) {
+    r_ref_init (ret, r_turn_server_free);
+    ret->realm = r_strdup (realm);
+    ret->users = r_hash_table_new_full (r_str_hash, r_str_equal, r_free, r_free);
+    r_rand_entropy_fill (rnd, sizeof (rnd));
+    ret->nonce = r_str_mem_hex (rnd, sizeof (rnd));
+    ret->quota.max_permissions = 64;
+    ret->quota.max_channels = 64;
+  }
+
+  return ret;
+}
+
+rboolean
+r_turn_server_add_user (RTurnServer * server, const rchar * user,
+    const rchar * pass)
+{
+  ruint8 * key;
+
+  if (R_UNLIKELY (server == NULL || user == NULL || pass == NULL)) return FALSE;
+  if (R_UNLIKELY (server->workers != NULL)) return FALSE;
+
+  if ((key = r_malloc (16)) == NULL)
+    return FALSE;
+  if (!r_stun_turn_long_term_key (user, server->realm, pass, key)) {
+    r_free (key);
+    return FALSE;
+  }
+
+  r_hash_table_insert (server->users, r_strdup (user), key);
+  return TRUE;
+}
+
+rboolean
+r_turn_server_set_quota (RTurnServer * server, const RTurnServerQuota * quota)
+{
+  if (R_UNLIKELY (server == NULL || quota == NULL)) return FALSE;
+  if (R_UNLIKELY (server->workers != NULL)) return FALSE;
+
+  server->quota = *quota;
+  return TRUE;
+}
+
+rboolean
+r_turn_server_start (RTurnServer * server, const RSocketAddress * listen,
+    const RSocketAddress * relay, ruint workers)
+{
+  ruint i;
+
+  if (R_UNLIKELY (server == NULL || listen == NULL || relay == NULL)) return FALSE;
+  if (R_UNLIKELY (server->workers != NULL)) return FALSE;
+
+#ifdef SO_REUSEPORT
+  if (workers == 0)
+    workers = MAX (r_sys_cpu_allowed_count (), 1);
+#else
+  workers = 1;
+#endif
+
+  if ((server->workers = r_mem_new0_n (RTurnWorker, workers)) == NULL)
+    return FALSE;
+  server->nworkers = workers;
+  server->relayip = r_socket_address_copy (relay);
+  server->tq = r_task_queue_new (1, 1);
+
+  /* The first worker resolves an ephemeral port the rest then share. */
+  for (i = 0; i < workers; i++) {
+    if (!r_turn_worker_setup (&server->workers[i], server,
+          server->local != NULL ? server->local : listen)) {
+      R_LOG_ERROR ("TURN server %p failed to start worker %u", server, i);
+      r_turn_server_stop (server);
+      return FALSE;
+    }
+    if (server->local == NULL)
+      server->local = r_ev_udp_get_local_address (server->workers[0].listener);
+  }
+
+  r_atomic_int_store (&server->running, 1);
+  for (i = 0; i < workers; i++)
+    server->workers[i].thread = r_turn_worker_start_thread (&server->workers[i], i, workers);
+
+  R_LOG_INFO ("TURN server %p running %u workers", server, workers);
+  return TRUE;
+}
+
+void
+r_turn_server_stop (RTurnServer * server)
+{
+  ruint i;
+
+  if (R_UNLIKELY (server == NULL)) return;
+  if (server->workers == NULL)
+    return;
+
+  r_atomic_int_store (&server->running, 0);
+  for (i = 0; i < server->nworkers; i++) {
+    if (server->workers[i].thread != NULL) {
+      r_thread_join (server->workers[i].thread);
+      r_thread_unref (server->workers[i].thread);
+    }
+  }
+  for (i = 0; i < server->nworkers; i++)
+    r_turn_worker_clear (&server->workers[i]);
+
+  r_free (server->workers);
+  server->workers = NULL;
+  server->nworkers = 0;
+  if (server->local != NULL) {
+    r_socket_address_unref (server->local);
+    server->local = NULL;
+  }
+  if (server->relayip != NULL) {
+    r_socket_address_unref (server->relayip);
+    server->relayip = NULL;
+  }
+  if (server->tq != NULL) {
+    r_task_queue_unref (server->tq);
+    server->tq = NULL;
+  }
+}
+
+RSocketAddress *
+r_turn_server_get_local_address (RTurnServer * server)
+{
+  if (R_UNLIKELY (server == NULL)) return NULL;
+  return server->local != NULL ? r_socket_address_ref (server->local) : NULL;
+}
+
+ruint
+r_turn_server_get_worker_count (const RTurnServer * server)
+{
+  return server != NULL ? server->nworkers : 0;
+}
+
+void
+r_turn_server_get_stats (RTurnServer * server, RTurnServerStats * stats)
+{
+  RTurnWorker * worker;
+  ruint i;
+
+  if (R_UNLIKELY (stats == NULL)) return;
+  r_memclear (stats, sizeof (RTurnServerStats));
+  if (R_UNLIKELY (server == NULL)) return;
+
+  for (i = 0; i < server->nworkers; i++) {
+    worker = &server->workers[i];
+    r_mutex_lock (&worker->stats_mutex);
+    stats->allocations += worker->published.allocations;
+    stats->allocations_total += worker->published.allocations_total;
+    stats->requests += worker->published.requests;
+    stats->auth_failures += worker->published.auth_failures;
+    stats->quota_rejects += worker->published.quota_rejects;
+    stats->peer_packets += worker->published.peer_packets;
+    stats->peer_bytes += worker->published.peer_bytes;
+    stats->client_packets += worker->published.client_packets;
+    stats->client_bytes += worker->published.client_bytes;
+    stats->dropped += worker->published.dropped;
+    stats->batches += worker->published.batches;
+    r_mutex_unlock (&worker->stats_mutex);
+  }
+}
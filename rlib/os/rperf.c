@@ -0,0 +1,320 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2016 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+
+#include "config.h"
+#include "rlib-private.h"
+
+#include <rlib/os/rperf.h>
+
+#include <rlib/rlog.h>
+#include <rlib/rmem.h>
+
+#if defined (HAVE_LINUX_PERF_EVENT_H)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+#define R_PERF_USE_PERF_EVENT   1
+#endif
+
+#define R_LOG_CAT_DEFAULT &rlib_logcat
+
+static const rchar * g__r_perf_counter_names[] = {
+  "cycles",
+  "instructions",
+  "cache-misses",
+  "branch-misses",
+  "context-switches",
+};
+
+struct RPerfCounters {
+  RRef ref;
+
+  ruint32 mask;
+  rboolean active;
+#ifdef R_PERF_USE_PERF_EVENT
+  int leader;
+  int fd[R_PERF_COUNTER_COUNT];
+  /* Counter for each value in a PERF_FORMAT_GROUP read, in open order */
+  RPerfCounter order[R_PERF_COUNTER_COUNT];
+  ruint n;
+  /* time_enabled / time_running are not cleared by PERF_EVENT_IOC_RESET */
+  ruint64 enabled, running;
+#endif
+};
+
+const rchar *
+r_perf_counter_name (RPerfCounter c)
+{
+  if (R_UNLIKELY ((ruint)c >= R_PERF_COUNTER_COUNT)) return NULL;
+  return g__r_perf_counter_names[c];
+}
+
+rdouble
+r_perf_sample_ipc (const RPerfSample * s)
+{
+  if (!r_perf_sample_has (s, R_PERF_COUNTER_CYCLES) ||
+      !r_perf_sample_has (s, R_PERF_COUNTER_INSTRUCTIONS) ||
+      s->value[R_PERF_COUNTER_CYCLES] == 0)
+    return 0.0;
+
+  return (rdouble)s->value[R_PERF_COUNTER_INSTRUCTIONS] /
+    (rdouble)s->value[R_PERF_COUNTER_CYCLES];
+}
+
+void
+r_perf_sample_sub (RPerfSample * dest, const RPerfSample * a,
+    const RPerfSample * b)
+{
+  ruint i;
+
+  dest->valid = a->valid & b->valid;
+  for (i = 0; i < R_PERF_COUNTER_COUNT; i++) {
+    dest->value[i] = (a->value[i] > b->value[i]) ?
+      a->value[i] - b->value[i] : 0;
+  }
+}
+
+void
+r_perf_sample_add (RPerfSample * dest, const RPerfSample * s)
+{
+  ruint i;
+
+  dest->valid &= s->valid;
+  for (i = 0; i < R_PERF_COUNTER_COUNT; i++)
+    dest->value[i] += s->value[i];
+}
+
+#ifdef R_PERF_USE_PERF_EVENT
+static const struct {
+  ruint32 type;
+  ruint64 config;
+} g__r_perf_events[] = {
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+  { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+};
+
+static int
+r_perf_event_open (RPerfCounter c, int group)
+{
+  struct perf_event_attr attr;
+  int fd;
+
+  r_memset (&attr, 0, sizeof (attr));
+  attr.size = sizeof (attr);
+  attr.type = g__r_perf_events[c].type;
+  attr.config = g__r_perf_events[c].config;
+  attr.disabled = (group < 0);
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP |
+    PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+  fd = (int)syscall (SYS_perf_event_open, &attr, 0, -1, group, PERF_FLAG_FD_CLOEXEC);
+  if (fd < 0 && (errno == EACCES || errno == EPERM) &&
+      c != R_PERF_COUNTER_CONTEXT_SWITCHES) {
+    /* perf_event_paranoid >= 2; switches are only ever seen in kernel */
+    attr.exclude_kernel = 1;
+    fd = (int)syscall (SYS_perf_event_open, &attr, 0, -1, group, PERF_FLAG_FD_CLOEXEC);
+  }
+
+  return fd;
+}
+
+static rboolean
+r_perf_counters_read_group (RPerfCounters * pc, ruint64 * enabled,
+    ruint64 * running, ruint64 * values)
+{
+  ruint64 buf[3 + R_PERF_COUNTER_COUNT];
+  rsize size = (3 + pc->n) * sizeof (ruint64);
+
+  if (read (pc->leader, buf, size) != (ssize_t)size || buf[0] != pc->n)
+    return FALSE;
+
+  *enabled = buf[1];
+  *running = buf[2];
+  r_memcpy (values, &buf[3], pc->n * sizeof (ruint64));
+  return TRUE;
+}
+#endif
+
+static void
+r_perf_counters_free (RPerfCounters * pc)
+{
+#ifdef R_PERF_USE_PERF_EVENT
+  ruint i;
+
+  for (i = 0; i < R_PERF_COUNTER_COUNT; i++) {
+    if (pc->fd[i] >= 0)
+      close (pc->fd[i]);
+  }
+#endif
+
+  r_free (pc);
+}
+
+RPerfCounters *
+r_perf_counters_new (ruint32 mask)
+{
+#ifdef R_PERF_USE_PERF_EVENT
+  RPerfCounters * ret;
+  ruint i;
+
+  if (R_UNLIKELY ((ret = r_mem_new0 (RPerfCounters)) == NULL))
+    return NULL;
+
+  r_ref_init (ret, r_perf_counters_free);
+  ret->leader = -1;
+  for (i = 0; i < R_PERF_COUNTER_COUNT; i++) {
+    ret->fd[i] = -1;
+    if ((mask & R_PERF_COUNTER_BIT (i)) == 0)
+      continue;
+
+    if ((ret->fd[i] = r_perf_event_open ((RPerfCounter)i, ret->leader)) < 0) {
+      R_LOG_DEBUG ("perf counter %s not available: %d",
+          g__r_perf_counter_names[i], errno);
+      continue;
+    }
+
+    if (ret->leader < 0)
+      ret->leader = ret->fd[i];
+    ret->mask |= R_PERF_COUNTER_BIT (i);
+    ret->order[ret->n++] = (RPerfCounter)i;
+  }
+
+  if (ret->mask == 0) {
+    r_perf_counters_unref (ret);
+    ret = NULL;
+  }
+
+  return ret;
+#else
+  (void) mask;
+  return NULL;
+#endif
+}
+
+ruint32
+r_perf_counters_get_mask (const RPerfCounters * pc)
+{
+  return pc != NULL ? pc->mask : 0;
+}
+
+rboolean
+r_perf_counters_start (RPerfCounters * pc)
+{
+#ifdef R_PERF_USE_PERF_EVENT
+  ruint64 values[R_PERF_COUNTER_COUNT];
+
+  if (R_UNLIKELY (pc == NULL)) return FALSE;
+
+  if (!r_perf_counters_read_group (pc, &pc->enabled, &pc->running, values))
+    return FALSE;
+
+  if (ioctl (pc->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP) != 0 ||
+      ioctl (pc->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) != 0)
+    return FALSE;
+
+  pc->active = TRUE;
+  return TRUE;
+#else
+  (void) pc;
+  return FALSE;
+#endif
+}
+
+rboolean
+r_perf_counters_read (RPerfCounters * pc, RPerfSample * s)
+{
+#ifdef R_PERF_USE_PERF_EVENT
+  ruint64 values[R_PERF_COUNTER_COUNT], enabled, running;
+  ruint i;
+
+  if (R_UNLIKELY (pc == NULL || s == NULL)) return FALSE;
+
+  r_memset (s, 0, sizeof (RPerfSample));
+  if (!r_perf_counters_read_group (pc, &enabled, &running, values))
+    return FALSE;
+
+  enabled -= pc->enabled;
+  running -= pc->running;
+  /* Enabled but never scheduled onto the PMU; nothing to scale from */
+  if (running == 0 && enabled > 0)
+    return FALSE;
+
+  for (i = 0; i < pc->n; i++) {
+    /* Scale up when the PMU had to be multiplexed with other groups */
+    if (running < enabled)
+      values[i] = (ruint64)((rdouble)values[i] * enabled / running);
+    s->value[pc->order[i]] = values[i];
+  }
+  s->valid = pc->mask;
+
+  return TRUE;
+#else
+  (void) pc;
+  if (s != NULL)
+    r_memset (s, 0, sizeof (RPerfSample));
+  return FALSE;
+#endif
+}
+
+rboolean
+r_perf_counters_stop (RPerfCounters * pc, RPerfSample * s)
+{
+#ifdef R_PERF_USE_PERF_EVENT
+  if (R_UNLIKELY (pc == NULL)) return FALSE;
+
+  if (ioctl (pc->leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP) != 0)
+    return FALSE;
+  pc->active = FALSE;
+#endif
+
+  return s != NULL ? r_perf_counters_read (pc, s) : TRUE;
+}
+
+rboolean
+r_perf_counters_pause (RPerfCounters * pc)
+{
+  if (pc == NULL || !pc->active)
+    return FALSE;
+
+  return r_perf_counters_stop (pc, NULL);
+}
+
+rboolean
+r_perf_counters_resume (RPerfCounters * pc)
+{
+#ifdef R_PERF_USE_PERF_EVENT
+  if (R_UNLIKELY (pc == NULL)) return FALSE;
+
+  /* Neither the counts nor the enabled / running times move while
+   * disabled, so no rebasing is needed here */
+  if (ioctl (pc->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) != 0)
+    return FALSE;
+
+  pc->active = TRUE;
+  return TRUE;
+#else
+  (void) pc;
+  return FALSE;
+#endif
+}
@@ -59,6 +59,7 @@
   F(AVX512BW,    "AVX-512BW")                             \
   F(AVX512DQ,    "AVX-512DQ")                             \
   F(AVX512VL,    "AVX-512VL")                             \
+  F(AVX512IFMA,  "AVX-512IFMA")                           \
   F(SHA_NI,      "SHA-NI")                                \
   F(BMI1,        "BMI1")                                  \
   F(BMI2,        "BMI2")                                  \
@@ -199,6 +200,7 @@ r_cpu_detect (void)
       if (ebx & (1u << 17)) ret |= R_CPU_FEATURE_AVX512DQ;
       if (ebx & (1u << 30)) ret |= R_CPU_FEATURE_AVX512BW;
       if (ebx & (1u << 31)) ret |= R_CPU_FEATURE_AVX512VL;
+      if (ebx & (1u << 21)) ret |= R_CPU_FEATURE_AVX512IFMA;
     }
   }
 
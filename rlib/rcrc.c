@@ -17,6 +17,7 @@
  */
 
 #include "config.h"
+#include "rlib-private.h"
 #include <rlib/rcrc.h>
 #include <rlib/rcpufeatures.h>
 #include <rlib/rmem.h>
@@ -31,6 +32,20 @@
 # include <intrin.h>
 #endif
 
+#if defined(HAVE_WMMINTRIN_H) && defined(HAVE_TMMINTRIN_H)
+# include <wmmintrin.h>           /* PCLMULQDQ */
+# include <tmmintrin.h>           /* SSSE3 (PSHUFB - bzip2 byte order) */
+# define R_CRC_FOLD_PCLMUL
+#elif defined(HAVE_ARM_NEON_H) && (defined(__GNUC__) || defined(__clang__))
+# include <arm_neon.h>            /* PMULL */
+# define R_CRC_FOLD_PMULL
+#endif
+
+/* Shortest input worth handing to a folding kernel: one 64 byte
+ * stripe of four 128 bit lanes. Anything shorter goes straight to the
+ * slicing-by-16 loop. */
+#define R_CRC_FOLD_MIN            64
+
 static const ruint32 g__r_crc32_tbl[] = {
   0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f, 0xe963a535, 0x9e6495a3,
   0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988, 0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91,
@@ -135,15 +150,308 @@ static const ruint32 g__r_crc32bzip2_tbl[] = {
   0xafb010b1, 0xab710d06, 0xa6322bdf, 0xa2f33668, 0xbcb4666d, 0xb8757bda, 0xb5365d03, 0xb1f740b4,
 };
 
+/* Slicing-by-16 tables, filled by r_crc_init from the byte tables
+ * above: [k][n] is the CRC of byte n followed by k zero bytes, so
+ * sixteen independent lookups consume 16 input bytes per iteration. */
+static ruint32 g__r_crc32_slice_tbl[16][256];
+static ruint32 g__r_crc32bzip2_slice_tbl[16][256];
+
+void
+r_crc_init (void)
+{
+  ruint k, n;
+
+  for (n = 0; n < 256; n++) {
+    g__r_crc32_slice_tbl[0][n] = g__r_crc32_tbl[n];
+    g__r_crc32bzip2_slice_tbl[0][n] = g__r_crc32bzip2_tbl[n];
+  }
+  for (k = 1; k < 16; k++) {
+    for (n = 0; n < 256; n++) {
+      ruint32 c = g__r_crc32_slice_tbl[k - 1][n];
+      g__r_crc32_slice_tbl[k][n] = (c >> 8) ^ g__r_crc32_tbl[c & 0xff];
+      c = g__r_crc32bzip2_slice_tbl[k - 1][n];
+      g__r_crc32bzip2_slice_tbl[k][n] = (c << 8) ^ g__r_crc32bzip2_tbl[c >> 24];
+    }
+  }
+}
+
+/* The slicing and folding kernels take and return the raw CRC register;
+ * the public entry points apply the pre / post inversion. */
+static ruint32
+r_crc32_slice16 (ruint32 crc, const ruint8 * ptr, rsize size)
+{
+  const ruint32 (*t)[256] = (const ruint32 (*)[256]) g__r_crc32_slice_tbl;
+
+  while (size >= 16) {
+    ruint32 w0 = r_load_le32 (ptr +  0) ^ crc;
+    ruint32 w1 = r_load_le32 (ptr +  4);
+    ruint32 w2 = r_load_le32 (ptr +  8);
+    ruint32 w3 = r_load_le32 (ptr + 12);
+
+    crc = t[15][w0 & 0xff] ^ t[14][(w0 >> 8) & 0xff] ^
+          t[13][(w0 >> 16) & 0xff] ^ t[12][w0 >> 24] ^
+          t[11][w1 & 0xff] ^ t[10][(w1 >> 8) & 0xff] ^
+          t[ 9][(w1 >> 16) & 0xff] ^ t[ 8][w1 >> 24] ^
+          t[ 7][w2 & 0xff] ^ t[ 6][(w2 >> 8) & 0xff] ^
+          t[ 5][(w2 >> 16) & 0xff] ^ t[ 4][w2 >> 24] ^
+          t[ 3][w3 & 0xff] ^ t[ 2][(w3 >> 8) & 0xff] ^
+          t[ 1][(w3 >> 16) & 0xff] ^ t[ 0][w3 >> 24];
+    ptr += 16;
+    size -= 16;
+  }
+  while (size--)
+    crc = (g__r_crc32_tbl[(crc ^ *ptr++) & 0xff]) ^ (crc >> 8);
+  return crc;
+}
+
+static ruint32
+r_crc32bzip2_slice16 (ruint32 crc, const ruint8 * ptr, rsize size)
+{
+  const ruint32 (*t)[256] = (const ruint32 (*)[256]) g__r_crc32bzip2_slice_tbl;
+
+  while (size >= 16) {
+    ruint32 w0 = r_load_be32 (ptr +  0) ^ crc;
+    ruint32 w1 = r_load_be32 (ptr +  4);
+    ruint32 w2 = r_load_be32 (ptr +  8);
+    ruint32 w3 = r_load_be32 (ptr + 12);
+
+    crc = t[15][w0 >> 24] ^ t[14][(w0 >> 16) & 0xff] ^
+          t[13][(w0 >> 8) & 0xff] ^ t[12][w0 & 0xff] ^
+          t[11][w1 >> 24] ^ t[10][(w1 >> 16) & 0xff] ^
+          t[ 9][(w1 >> 8) & 0xff] ^ t[ 8][w1 & 0xff] ^
+          t[ 7][w2 >> 24] ^ t[ 6][(w2 >> 16) & 0xff] ^
+          t[ 5][(w2 >> 8) & 0xff] ^ t[ 4][w2 & 0xff] ^
+          t[ 3][w3 >> 24] ^ t[ 2][(w3 >> 16) & 0xff] ^
+          t[ 1][(w3 >> 8) & 0xff] ^ t[ 0][w3 & 0xff];
+    ptr += 16;
+    size -= 16;
+  }
+  while (size--)
+    crc = (g__r_crc32bzip2_tbl[((crc >> 24) ^ *ptr++) & 0xff]) ^ (crc << 8);
+  return crc;
+}
+
+/* Carry-less multiply folding (Gopal et al., "Fast CRC Computation for
+ * Generic Polynomials Using PCLMULQDQ"). Four 128 bit lanes each fold
+ * 512 bits forward per round, then collapse into one lane folding 128
+ * bits at a time. A lane A = H * x^64 + L moved D bits forward is
+ * congruent to H * (x^(D+64) mod P) + L * (x^D mod P), so each fold is
+ * two 64x32 bit multiplies. Rather than a Barrett reduction, the last
+ * lane is written back out as 16 message bytes and finished by the
+ * slicing loop from a zero register.
+ *
+ * Constants for P = 0x104C11DB7. The reflected (IEEE) ones are the
+ * 32 bit reflections shifted left by one, as the reflected product
+ * lands one bit low. The non-reflected (bzip2) ones are used as is on
+ * byte-reversed lanes. Each pair is { L multiplier, H multiplier }. */
+#define R_CRC32_K_512_LO          RUINT64_CONSTANT (0x154442bd4)
+#define R_CRC32_K_512_HI          RUINT64_CONSTANT (0x1c6e41596)
+#define R_CRC32_K_128_LO          RUINT64_CONSTANT (0x1751997d0)
+#define R_CRC32_K_128_HI          RUINT64_CONSTANT (0x0ccaa009e)
+#define R_CRC32BZIP2_K_512_LO     RUINT64_CONSTANT (0x0e6228b11)
+#define R_CRC32BZIP2_K_512_HI     RUINT64_CONSTANT (0x08833794c)
+#define R_CRC32BZIP2_K_128_LO     RUINT64_CONSTANT (0x0e8a45605)
+#define R_CRC32BZIP2_K_128_HI     RUINT64_CONSTANT (0x0c5b9cd4c)
+
+#ifdef R_CRC_FOLD_PCLMUL
+# if defined(__GNUC__) || defined(__clang__)
+#  define R_CRC_X86_TARGET __attribute__((target("pclmul,ssse3")))
+# else
+#  define R_CRC_X86_TARGET
+# endif
+
+R_CRC_X86_TARGET
+static inline __m128i
+r_crc_fold_pclmul (__m128i x, __m128i k, __m128i next)
+{
+  return _mm_xor_si128 (next, _mm_xor_si128 (
+        _mm_clmulepi64_si128 (x, k, 0x00), _mm_clmulepi64_si128 (x, k, 0x11)));
+}
+
+/* @size is a multiple of 16 and at least R_CRC_FOLD_MIN. */
+R_CRC_X86_TARGET
+static ruint32
+r_crc32_fold_pclmul (ruint32 crc, const ruint8 * ptr, rsize size)
+{
+  const __m128i k512 = _mm_set_epi64x (R_CRC32_K_512_HI, R_CRC32_K_512_LO);
+  const __m128i k128 = _mm_set_epi64x (R_CRC32_K_128_HI, R_CRC32_K_128_LO);
+  __m128i x0, x1, x2, x3;
+  ruint8 tmp[16];
+
+  x0 = _mm_xor_si128 (_mm_loadu_si128 ((const __m128i *) (ptr +  0)),
+      _mm_cvtsi32_si128 ((int) crc));
+  x1 = _mm_loadu_si128 ((const __m128i *) (ptr + 16));
+  x2 = _mm_loadu_si128 ((const __m128i *) (ptr + 32));
+  x3 = _mm_loadu_si128 ((const __m128i *) (ptr + 48));
+  for (ptr += 64, size -= 64; size >= 64; ptr += 64, size -= 64) {
+    x0 = r_crc_fold_pclmul (x0, k512, _mm_loadu_si128 ((const __m128i *) (ptr +  0)));
+    x1 = r_crc_fold_pclmul (x1, k512, _mm_loadu_si128 ((const __m128i *) (ptr + 16)));
+    x2 = r_crc_fold_pclmul (x2, k512, _mm_loadu_si128 ((const __m128i *) (ptr + 32)));
+    x3 = r_crc_fold_pclmul (x3, k512, _mm_loadu_si128 ((const __m128i *) (ptr + 48)));
+  }
+
+  x0 = r_crc_fold_pclmul (x0, k128, x1);
+  x0 = r_crc_fold_pclmul (x0, k128, x2);
+  x0 = r_crc_fold_pclmul (x0, k128, x3);
+  for (; size >= 16; ptr += 16, size -= 16)
+    x0 = r_crc_fold_pclmul (x0, k128, _mm_loadu_si128 ((const __m128i *) ptr));
+
+  _mm_storeu_si128 ((__m128i *) tmp, x0);
+  return r_crc32_slice16 (0, tmp, sizeof (tmp));
+}
+
+R_CRC_X86_TARGET
+static ruint32
+r_crc32bzip2_fold_pclmul (ruint32 crc, const ruint8 * ptr, rsize size)
+{
+  const __m128i k512 = _mm_set_epi64x (R_CRC32BZIP2_K_512_HI, R_CRC32BZIP2_K_512_LO);
+  const __m128i k128 = _mm_set_epi64x (R_CRC32BZIP2_K_128_HI, R_CRC32BZIP2_K_128_LO);
+  const __m128i bswap = _mm_setr_epi8 (15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+  __m128i x0, x1, x2, x3;
+  ruint8 tmp[16];
+
+#define R_CRC_LOAD_BE128(p) \
+  _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *) (p)), bswap)
+  x0 = _mm_xor_si128 (R_CRC_LOAD_BE128 (ptr +  0), _mm_set_epi32 ((int) crc, 0, 0, 0));
+  x1 = R_CRC_LOAD_BE128 (ptr + 16);
+  x2 = R_CRC_LOAD_BE128 (ptr + 32);
+  x3 = R_CRC_LOAD_BE128 (ptr + 48);
+  for (ptr += 64, size -= 64; size >= 64; ptr += 64, size -= 64) {
+    x0 = r_crc_fold_pclmul (x0, k512, R_CRC_LOAD_BE128 (ptr +  0));
+    x1 = r_crc_fold_pclmul (x1, k512, R_CRC_LOAD_BE128 (ptr + 16));
+    x2 = r_crc_fold_pclmul (x2, k512, R_CRC_LOAD_BE128 (ptr + 32));
+    x3 = r_crc_fold_pclmul (x3, k512, R_CRC_LOAD_BE128 (ptr + 48));
+  }
+
+  x0 = r_crc_fold_pclmul (x0, k128, x1);
+  x0 = r_crc_fold_pclmul (x0, k128, x2);
+  x0 = r_crc_fold_pclmul (x0, k128, x3);
+  for (; size >= 16; ptr += 16, size -= 16)
+    x0 = r_crc_fold_pclmul (x0, k128, R_CRC_LOAD_BE128 (ptr));
+#undef R_CRC_LOAD_BE128
+
+  _mm_storeu_si128 ((__m128i *) tmp, _mm_shuffle_epi8 (x0, bswap));
+  return r_crc32bzip2_slice16 (0, tmp, sizeof (tmp));
+}
+#endif /* R_CRC_FOLD_PCLMUL */
+
+#ifdef R_CRC_FOLD_PMULL
+# define R_CRC_ARM_TARGET __attribute__((target("+crypto")))
+
+/* Mirrors r_crc_fold_pclmul; @k holds { L multiplier, H multiplier }. */
+R_CRC_ARM_TARGET
+static inline uint64x2_t
+r_crc_fold_pmull (uint64x2_t x, uint64x2_t k, uint64x2_t next)
+{
+  uint64x2_t lo = vreinterpretq_u64_p128 (vmull_p64 (
+        (poly64_t) vgetq_lane_u64 (x, 0), (poly64_t) vgetq_lane_u64 (k, 0)));
+  uint64x2_t hi = vreinterpretq_u64_p128 (vmull_p64 (
+        (poly64_t) vgetq_lane_u64 (x, 1), (poly64_t) vgetq_lane_u64 (k, 1)));
+  return veorq_u64 (next, veorq_u64 (lo, hi));
+}
+
+R_CRC_ARM_TARGET
+static inline uint64x2_t
+r_crc_load_be128_neon (const ruint8 * ptr)
+{
+  uint8x16_t v = vrev64q_u8 (vld1q_u8 (ptr));
+  return vreinterpretq_u64_u8 (vextq_u8 (v, v, 8));
+}
+
+R_CRC_ARM_TARGET
+static ruint32
+r_crc32_fold_pmull (ruint32 crc, const ruint8 * ptr, rsize size)
+{
+  const uint64x2_t k512 = vcombine_u64 (vcreate_u64 (R_CRC32_K_512_LO),
+      vcreate_u64 (R_CRC32_K_512_HI));
+  const uint64x2_t k128 = vcombine_u64 (vcreate_u64 (R_CRC32_K_128_LO),
+      vcreate_u64 (R_CRC32_K_128_HI));
+  uint64x2_t x0, x1, x2, x3;
+  ruint8 tmp[16];
+
+  x0 = veorq_u64 (vreinterpretq_u64_u8 (vld1q_u8 (ptr +  0)),
+      vcombine_u64 (vcreate_u64 (crc), vcreate_u64 (0)));
+  x1 = vreinterpretq_u64_u8 (vld1q_u8 (ptr + 16));
+  x2 = vreinterpretq_u64_u8 (vld1q_u8 (ptr + 32));
+  x3 = vreinterpretq_u64_u8 (vld1q_u8 (ptr + 48));
+  for (ptr += 64, size -= 64; size >= 64; ptr += 64, size -= 64) {
+    x0 = r_crc_fold_pmull (x0, k512, vreinterpretq_u64_u8 (vld1q_u8 (ptr +  0)));
+    x1 = r_crc_fold_pmull (x1, k512, vreinterpretq_u64_u8 (vld1q_u8 (ptr + 16)));
+    x2 = r_crc_fold_pmull (x2, k512, vreinterpretq_u64_u8 (vld1q_u8 (ptr + 32)));
+    x3 = r_crc_fold_pmull (x3, k512, vreinterpretq_u64_u8 (vld1q_u8 (ptr + 48)));
+  }
+
+  x0 = r_crc_fold_pmull (x0, k128, x1);
+  x0 = r_crc_fold_pmull (x0, k128, x2);
+  x0 = r_crc_fold_pmull (x0, k128, x3);
+  for (; size >= 16; ptr += 16, size -= 16)
+    x0 = r_crc_fold_pmull (x0, k128, vreinterpretq_u64_u8 (vld1q_u8 (ptr)));
+
+  vst1q_u8 (tmp, vreinterpretq_u8_u64 (x0));
+  return r_crc32_slice16 (0, tmp, sizeof (tmp));
+}
+
+R_CRC_ARM_TARGET
+static ruint32
+r_crc32bzip2_fold_pmull (ruint32 crc, const ruint8 * ptr, rsize size)
+{
+  const uint64x2_t k512 = vcombine_u64 (vcreate_u64 (R_CRC32BZIP2_K_512_LO),
+      vcreate_u64 (R_CRC32BZIP2_K_512_HI));
+  const uint64x2_t k128 = vcombine_u64 (vcreate_u64 (R_CRC32BZIP2_K_128_LO),
+      vcreate_u64 (R_CRC32BZIP2_K_128_HI));
+  uint64x2_t x0, x1, x2, x3;
+  uint8x16_t v;
+  ruint8 tmp[16];
+
+  x0 = veorq_u64 (r_crc_load_be128_neon (ptr +  0),
+      vcombine_u64 (vcreate_u64 (0), vcreate_u64 ((ruint64) crc << 32)));
+  x1 = r_crc_load_be128_neon (ptr + 16);
+  x2 = r_crc_load_be128_neon (ptr + 32);
+  x3 = r_crc_load_be128_neon (ptr + 48);
+  for (ptr += 64, size -= 64; size >= 64; ptr += 64, size -= 64) {
+    x0 = r_crc_fold_pmull (x0, k512, r_crc_load_be128_neon (ptr +  0));
+    x1 = r_crc_fold_pmull (x1, k512, r_crc_load_be128_neon (ptr + 16));
+    x2 = r_crc_fold_pmull (x2, k512, r_crc_load_be128_neon (ptr + 32));
+    x3 = r_crc_fold_pmull (x3, k512, r_crc_load_be128_neon (ptr + 48));
+  }
+
+  x0 = r_crc_fold_pmull (x0, k128, x1);
+  x0 = r_crc_fold_pmull (x0, k128, x2);
+  x0 = r_crc_fold_pmull (x0, k128, x3);
+  for (; size >= 16; ptr += 16, size -= 16)
+    x0 = r_crc_fold_pmull (x0, k128, r_crc_load_be128_neon (ptr));
+
+  v = vrev64q_u8 (vreinterpretq_u8_u64 (x0));
+  vst1q_u8 (tmp, vextq_u8 (v, v, 8));
+  return r_crc32bzip2_slice16 (0, tmp, sizeof (tmp));
+}
+#endif /* R_CRC_FOLD_PMULL */
+
 ruint32
 r_crc32_update (ruint32 crc, rconstpointer buffer, rsize size)
 {
   const ruint8 * ptr = buffer;
 
   crc = ~crc;
-  while (size--)
-    crc = (g__r_crc32_tbl[(crc ^ *ptr++) & 0xff]) ^ (crc >> 8);
-  return ~crc;
+  if (size >= R_CRC_FOLD_MIN) {
+    rsize folded = size & ~(rsize) 15;
+#if defined(R_CRC_FOLD_PCLMUL)
+    if (r_cpu_has (R_CPU_FEATURE_PCLMUL)) {
+      crc = r_crc32_fold_pclmul (crc, ptr, folded);
+      ptr += folded;
+      size -= folded;
+    }
+#elif defined(R_CRC_FOLD_PMULL)
+    if (r_cpu_has (R_CPU_FEATURE_ARM_PMULL)) {
+      crc = r_crc32_fold_pmull (crc, ptr, folded);
+      ptr += folded;
+      size -= folded;
+    }
+#else
+    (void) folded;
+#endif
+  }
+  return ~r_crc32_slice16 (crc, ptr, size);
 }
 
 static ruint32
@@ -245,8 +553,110 @@ r_crc32bzip2_update (ruint32 crc, rconstpointer buffer, rsize size)
   const ruint8 * ptr = buffer;
 
   crc = ~crc;
-  while (size--)
-    crc = (g__r_crc32bzip2_tbl[((crc >> 24) ^ *ptr++) & 0xff]) ^ (crc << 8);
-  return ~crc;
+  if (size >= R_CRC_FOLD_MIN) {
+    rsize folded = size & ~(rsize) 15;
+#if defined(R_CRC_FOLD_PCLMUL)
+    if (r_cpu_has (R_CPU_FEATURE_PCLMUL) && r_cpu_has (R_CPU_FEATURE_SSSE3)) {
+      crc = r_crc32bzip2_fold_pclmul (crc, ptr, folded);
+      ptr += folded;
+      size -= folded;
+    }
+#elif defined(R_CRC_FOLD_PMULL)
+    if (r_cpu_has (R_CPU_FEATURE_ARM_PMULL)) {
+      crc = r_crc32bzip2_fold_pmull (crc, ptr, folded);
+      ptr += folded;
+      size -= folded;
+    }
+#else
+    (void) folded;
+#endif
+  }
+  return ~r_crc32bzip2_slice16 (crc, ptr, size);
+}
+
+/* GF(2) arithmetic modulo the CRC polynomial for r_crc*_combine, after
+ * zlib's crc32_combine. Reflected form: bit 31 is x^0. */
+static ruint32
+r_crc_multmodp_refl (ruint32 a, ruint32 b, ruint32 poly)
+{
+  ruint32 m = (ruint32) 1 << 31, p = 0;
+
+  for (;;) {
+    if (a & m) {
+      p ^= b;
+      if ((a & (m - 1)) == 0)
+        break;
+    }
+    m >>= 1;
+    b = (b & 1) ? (b >> 1) ^ poly : b >> 1;
+  }
+  return p;
+}
+
+/* x^(8 * @len) mod P, by square-and-multiply over the bits of @len. */
+static ruint32
+r_crc_xpow8nmodp_refl (ruint64 len, ruint32 poly)
+{
+  ruint32 sq = (ruint32) 1 << 23;    /* x^8 */
+  ruint32 p = (ruint32) 1 << 31;     /* x^0 */
+
+  for (; len > 0; len >>= 1) {
+    if (len & 1)
+      p = r_crc_multmodp_refl (sq, p, poly);
+    sq = r_crc_multmodp_refl (sq, sq, poly);
+  }
+  return p;
+}
+
+/* Non-reflected form: bit 0 is x^0. */
+static ruint32
+r_crc_multmodp (ruint32 a, ruint32 b, ruint32 poly)
+{
+  ruint32 p = 0;
+  ruint i;
+
+  for (i = 0; i < 32; i++) {
+    if (a & 1)
+      p ^= b;
+    a >>= 1;
+    b = (b & 0x80000000) ? (b << 1) ^ poly : b << 1;
+  }
+  return p;
+}
+
+static ruint32
+r_crc_xpow8nmodp (ruint64 len, ruint32 poly)
+{
+  ruint32 sq = (ruint32) 1 << 8;     /* x^8 */
+  ruint32 p = 1;                              /* x^0 */
+
+  for (; len > 0; len >>= 1) {
+    if (len & 1)
+      p = r_crc_multmodp (sq, p, poly);
+    sq = r_crc_multmodp (sq, sq, poly);
+  }
+  return p;
+}
+
+/* The pre / post inversions cancel: CRC(A || B) is CRC(A) shifted over
+ * |B| zero bytes, xor CRC(B). */
+ruint32
+r_crc32_combine (ruint32 crc1, ruint32 crc2, ruint64 len2)
+{
+  return r_crc_multmodp_refl (r_crc_xpow8nmodp_refl (len2, 0xedb88320), crc1,
+      0xedb88320) ^ crc2;
 }
 
+ruint32
+r_crc32c_combine (ruint32 crc1, ruint32 crc2, ruint64 len2)
+{
+  return r_crc_multmodp_refl (r_crc_xpow8nmodp_refl (len2, 0x82f63b78), crc1,
+      0x82f63b78) ^ crc2;
+}
+
+ruint32
+r_crc32bzip2_combine (ruint32 crc1, ruint32 crc2, ruint64 len2)
+{
+  return r_crc_multmodp (r_crc_xpow8nmodp (len2, 0x04c11db7), crc1,
+      0x04c11db7) ^ crc2;
+}
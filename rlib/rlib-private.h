@@ -28,11 +28,27 @@
 R_API_HIDDEN void r_ref__init (void);
 R_API_HIDDEN void r_ref__deinit (void);
 
+R_API_HIDDEN void r_crc_init (void);
+
+R_API_HIDDEN void r_hash_funcs_init (void);
+
 R_API_HIDDEN void r_ev_loop_init (void);
 R_API_HIDDEN void r_ev_loop_deinit (void);
 
 R_API_HIDDEN void r_log_init (void);
 R_API_HIDDEN void r_log_deinit (void);
+/* The default handler's uncoloured line prefix, for sinks that format off
+ * the logging thread; returns the length written (truncated to fit). */
+R_API_HIDDEN rsize r_log_format_prefix (rchar * buf, rsize size,
+    RClockTime ts, rpointer thread, RLogCategory * cat, RLogLevel lvl,
+    const rchar * file, ruint line, const rchar * func);
+R_API_HIDDEN void r_log_bin_init (RClockTime tsstart);
+R_API_HIDDEN void r_log_bin_deinit (void);
+/* Set while a binary trace file is open; routes R_LOG_* sites into it. */
+R_API_HIDDEN extern rauint _r_log_bin_enabled;
+R_API_HIDDEN void r_log_bin_record (RLogSite * site, RLogCategory * cat,
+    RLogLevel lvl, const rchar * file, ruint line, const rchar * func,
+    const rchar * fmt, va_list args);
 
 R_API_HIDDEN void r_http_client_init (void);
 R_API_HIDDEN void r_http_server_init (void);
@@ -52,6 +68,11 @@ R_API_HIDDEN void r_srtp_init (void);
 R_API_HIDDEN void r_task_queue_init (void);
 
 R_API_HIDDEN void r_test_init (void);
+/* The test the runner has in flight (also inside its forked child). */
+R_API_HIDDEN const struct RTest * r_test_get_current (rsize * __i);
+/* Count and print perf counters around an RTEST_BENCH body. */
+R_API_HIDDEN void r_test_bench_perf_begin (void);
+R_API_HIDDEN void r_test_bench_perf_end (void);
 
 R_API_HIDDEN void r_thread_init (void);
 R_API_HIDDEN void r_thread_deinit (void);
@@ -61,6 +82,8 @@ R_API_HIDDEN void r_time_init (void);
 R_API_HIDDEN void r_tls_client_init (void);
 R_API_HIDDEN void r_tls_server_init (void);
 
+R_API_HIDDEN void r_turn_server_init (void);
+
 R_API_HIDDEN R_LOG_CATEGORY_DEFINE_EXTERN (rlib_logcat);
 
 #endif /* __RLIB_PRIVATE_H__ */
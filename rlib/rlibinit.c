@@ -29,6 +29,10 @@ R_LOG_CATEGORY_DEFINE (rlib_logcat, "rlib", "Internal RLib logger",
 
 R_INITIALIZER (rlib_init)
 {
+  /* The string hash seed must be fixed before anything builds a
+   * string-keyed table. */
+  r_hash_funcs_init ();
+
   /* r_log_init captures g__r_log_ts_start via r_time_get_ts_monotonic;
    * on Apple Silicon (and any platform whose monotonic source needs a
    * runtime-detected scaling factor) that has to happen after r_time_init
@@ -41,6 +45,7 @@ R_INITIALIZER (rlib_init)
     r_log_category_set_threshold (&rlib_logcat, R_LOG_LEVEL_WARNING);
 
   r_ref__init ();
+  r_crc_init ();
   r_ev_loop_init ();
   r_http_client_init ();
   r_http_server_init ();
@@ -54,6 +59,7 @@ R_INITIALIZER (rlib_init)
   r_test_init ();
   r_tls_client_init ();
   r_tls_server_init ();
+  r_turn_server_init ();
 }
 
 R_DEINITIALIZER (rlib_deinit)
@@ -19,6 +19,7 @@
 #include "config.h"
 #include "rlib-private.h"
 #include <rlib/rlog.h>
+#include <rlib/rlogbin.h>
 
 #include <rlib/data/rlist.h>
 #include <rlib/file/rfile.h>
@@ -115,11 +116,16 @@ r_log_init (void)
     r_log_category_set_threshold (R_LOG_CAT_ASSERT, R_LOG_LEVEL_ERROR);
 
   g__r_log_ts_start = r_time_get_ts_monotonic ();
+
+  r_log_bin_init (g__r_log_ts_start);
+  if ((env = r_getenv ("R_DEBUG_BIN_FILE")) != NULL)
+    r_log_bin_open (env);
 }
 
 void
 r_log_deinit (void)
 {
+  r_log_bin_deinit ();
   r_slist_destroy (g__r_log_cats);
   g__r_log_cats = NULL;
   r_strv_free (g__r_log_dbg_strv);
@@ -295,6 +301,29 @@ r_logv (RLogCategory * cat, RLogLevel lvl, const rchar * file, ruint line,
   r_free (msg);
 }
 
+void
+r_log_site (RLogSite * site, RLogCategory * cat, RLogLevel lvl,
+    const rchar * file, ruint line, const rchar * func,
+    const rchar * fmt, ...)
+{
+  va_list args;
+
+  if (R_UNLIKELY (cat == NULL))
+    abort ();
+  if (lvl > cat->threshold && !g__r_log_ignore_threshold)
+    return;
+
+  va_start (args, fmt);
+  if (R_UNLIKELY (r_atomic_uint_load (&_r_log_bin_enabled))) {
+    r_log_bin_record (site, cat, lvl, file, line, func, fmt, args);
+  } else {
+    rchar * msg = r_strvprintf (fmt, args);
+    r_log_it (cat, lvl, file, line, func, msg);
+    r_free (msg);
+  }
+  va_end (args);
+}
+
 void
 r_log_msg (RLogCategory * cat, RLogLevel lvl,
     const rchar * file, ruint line, const rchar * func, const rchar * msg)
@@ -393,14 +422,6 @@ r_log_override_default_handler (RLogFunc func, rpointer data, rpointer * old)
   return oldfunc;
 }
 
-void
-r_log_default_handler (RLogCategory * cat, RLogLevel lvl,
-    const rchar * file, ruint line, const rchar * func,
-    const rchar * msg, rpointer user_data)
-{
-  FILE * f = user_data == NULL ? stderr : (FILE *)user_data;
-  RClockTime elapsed = r_time_get_ts_monotonic () - g__r_log_ts_start;
-
 #define CLK_FMT "%"R_TIME_FORMAT
 #define PID_FMT "%5d"
 #if RLIB_SIZEOF_VOID_P == 8
@@ -412,6 +433,14 @@ r_log_default_handler (RLogCategory * cat, RLogLevel lvl,
 #define CAT_FMT "%16s %s:%d:%s ()"
 #define MSG_FMT "%s"
 
+void
+r_log_default_handler (RLogCategory * cat, RLogLevel lvl,
+    const rchar * file, ruint line, const rchar * func,
+    const rchar * msg, rpointer user_data)
+{
+  FILE * f = user_data == NULL ? stderr : (FILE *)user_data;
+  RClockTime elapsed = r_time_get_ts_monotonic () - g__r_log_ts_start;
+
 #ifdef R_OS_UNIX
   if (g__r_log_color && r_isatty(r_fileno(f))) {
     rchar clr[R_TTY_MAX_CC];
@@ -436,6 +465,23 @@ r_log_default_handler (RLogCategory * cat, RLogLevel lvl,
   fflush (f);
 }
 
+rsize
+r_log_format_prefix (rchar * buf, rsize size, RClockTime ts, rpointer thread,
+    RLogCategory * cat, RLogLevel lvl,
+    const rchar * file, ruint line, const rchar * func)
+{
+  RClockTime elapsed = ts - g__r_log_ts_start;
+  int ret;
+
+  ret = r_snprintf (buf, size, CLK_FMT" "PID_FMT" "THR_FMT" "LVL_FMT" "CAT_FMT" ",
+      R_TIME_ARGS (elapsed), r_proc_get_id (), thread,
+      r_log_level_get_name (lvl), cat->name, file, line, func);
+
+  if (R_UNLIKELY (ret < 0))
+    return 0;
+  return MIN ((rsize)ret, size - 1);
+}
+
 
 static void
 r_log_keep_last_log_last (const RLogKeepLastCtx * ctx)
@@ -0,0 +1,539 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2015  Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+
+#include "config.h"
+#include "rlib-private.h"
+#include <rlib/rlogasync.h>
+
+#include <rlib/concurrency/ratomic.h>
+#include <rlib/concurrency/rthreads.h>
+#include <rlib/file/rio.h>
+#include <rlib/rio.h>
+#include <rlib/rmem.h>
+#include <rlib/rstr.h>
+#include <rlib/rtime.h>
+
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif
+#include <errno.h>
+
+#ifdef HAVE_SYS_UIO_H
+typedef struct iovec RLogAsyncVec;
+#else
+typedef struct {
+  rpointer iov_base;
+  rsize iov_len;
+} RLogAsyncVec;
+#endif
+
+#define R_LOG_ASYNC_RING_SIZE_MIN       4096
+/* Two vectors per line (prefix, message); 1024 is the POSIX IOV_MAX floor
+ * on every platform we build for. */
+#define R_LOG_ASYNC_BATCH_VECS          1024
+#define R_LOG_ASYNC_SCRATCH_SIZE        (128 * 1024)
+/* Longest prefix (or drop report) the writer ever formats. */
+#define R_LOG_ASYNC_PREFIX_MAX          1024
+#define R_LOG_ASYNC_ALIGN(n)            (((n) + 7) & ~(ruint)7)
+#define R_LOG_ASYNC_LVL_PAD             0xffff
+
+/* A record never wraps: if it does not fit before the end of the ring, a
+ * padding record (lvl == R_LOG_ASYNC_LVL_PAD) fills the rest and the record
+ * starts over at offset 0. */
+typedef struct {
+  ruint32 size;                 /* whole record, 8-byte aligned */
+  ruint16 lvl;
+  ruint16 reserved;
+  ruint32 line;
+  ruint32 msglen;               /* including the trailing newline */
+  RLogCategory * cat;
+  const rchar * file;
+  const rchar * func;
+  rpointer thread;
+  RClockTime ts;
+  rchar msg[];
+} RLogAsyncRec;
+
+/* Single producer (its logging thread), single consumer (the writer). The
+ * positions are free-running and masked on access. */
+typedef struct RLogAsyncRing RLogAsyncRing;
+struct RLogAsyncRing {
+  rauint refs;                  /* the logging thread's and the sink's */
+  rauint closed;                /* the logging thread has exited */
+  ruint sinkid;
+  RLogAsyncRing * next;         /* sink's ring list; written by the writer */
+  rauint dropped;               /* not yet reported */
+  ruint size;
+
+  rauint head;                  /* written by the producer */
+  rauint tail;                  /* written by the writer */
+  ruint8 data[];
+};
+
+struct RLogAsync {
+  RRef ref;
+
+  ruint id;
+  RIOHandle handle;
+  rboolean ownhandle;
+  RLogAsyncOverflow overflow;
+  ruint ringsize;
+  rauint dropped;
+
+  raptr rings;                  /* (RLogAsyncRing *) */
+  RThread * writer;
+  RLogAsyncVec * vec;
+  rchar * scratch;
+
+  RMutex lock;
+  RCond wakecond;               /* wakes the writer */
+  RCond flushcond;              /* wakes flushers */
+  rauint sleeping;
+  rauint stop;
+  rauint flushreq;
+  ruint flushdone;
+};
+
+static rauint g__r_log_async_id;
+
+static void
+r_log_async_ring_unref (RLogAsyncRing * ring)
+{
+  if (r_atomic_uint_fetch_sub (&ring->refs, 1) == 1)
+    r_free (ring);
+}
+
+/* The logging thread is done with its ring; the writer drains and drops it. */
+static void
+r_log_async_ring_release (RLogAsyncRing * ring)
+{
+  r_atomic_uint_store (&ring->closed, 1);
+  r_log_async_ring_unref (ring);
+}
+
+/* One ring per thread, for the sink that thread logged to last. A thread
+ * switching to another sink closes its old ring and starts a new one. */
+static RTss g__r_log_async_tss = R_TSS_INIT (r_log_async_ring_release);
+
+static void
+r_log_async_wake (RLogAsync * sink)
+{
+  ruint one = 1;
+
+  if (r_atomic_uint_load (&sink->sleeping) &&
+      r_atomic_uint_cmp_xchg_strong (&sink->sleeping, &one, 0)) {
+    r_mutex_lock (&sink->lock);
+    r_cond_signal (&sink->wakecond);
+    r_mutex_unlock (&sink->lock);
+  }
+}
+
+static RLogAsyncRing *
+r_log_async_ring_get (RLogAsync * sink)
+{
+  RLogAsyncRing * ring = r_tss_get (&g__r_log_async_tss);
+  rpointer old;
+
+  if (R_LIKELY (ring != NULL && ring->sinkid == sink->id))
+    return ring;
+
+  if (ring != NULL)
+    r_log_async_ring_release (ring);
+
+  if ((ring = r_malloc (sizeof (RLogAsyncRing) + sink->ringsize)) != NULL) {
+    r_atomic_uint_store (&ring->refs, 2);
+    r_atomic_uint_store (&ring->closed, 0);
+    ring->sinkid = sink->id;
+    r_atomic_uint_store (&ring->dropped, 0);
+    ring->size = sink->ringsize;
+    r_atomic_uint_store (&ring->head, 0);
+    r_atomic_uint_store (&ring->tail, 0);
+
+    old = r_atomic_ptr_load (&sink->rings);
+    do {
+      ring->next = old;
+    } while (!r_atomic_ptr_cmp_xchg_weak (&sink->rings, &old, ring));
+  }
+
+  r_tss_set (&g__r_log_async_tss, ring);
+  return ring;
+}
+
+/* Find room for @need contiguous bytes; returns the position to write at. */
+static rboolean
+r_log_async_ring_reserve (RLogAsync * sink, RLogAsyncRing * ring,
+    ruint need, ruint * pos)
+{
+  ruint head = r_atomic_uint_load (&ring->head);
+  ruint off = head & (ring->size - 1);
+  ruint tillend = ring->size - off;
+  ruint total = need <= tillend ? need : tillend + need;
+
+  while (ring->size - (head - r_atomic_uint_load (&ring->tail)) < total) {
+    if (sink->overflow != R_LOG_ASYNC_OVERFLOW_BLOCK)
+      return FALSE;
+    r_log_async_wake (sink);
+    r_thread_yield ();
+  }
+
+  if (need > tillend) {
+    RLogAsyncRec * pad = (RLogAsyncRec *)(ring->data + off);
+    pad->size = tillend;
+    pad->lvl = R_LOG_ASYNC_LVL_PAD;
+    head += tillend;
+  }
+
+  *pos = head;
+  return TRUE;
+}
+
+void
+r_log_async_handler (RLogCategory * cat, RLogLevel lvl,
+    const rchar * file, ruint line, const rchar * func,
+    const rchar * msg, rpointer user_data)
+{
+  RLogAsync * sink = user_data;
+  RLogAsyncRing * ring;
+  RLogAsyncRec * rec;
+  rsize len = r_strlen (msg);
+  ruint need, pos;
+
+  if (R_UNLIKELY ((ring = r_log_async_ring_get (sink)) == NULL))
+    goto drop;
+
+  /* Keep every record within half the ring so one can always follow. */
+  if (len + 1 > ring->size / 2 - sizeof (RLogAsyncRec))
+    len = ring->size / 2 - sizeof (RLogAsyncRec) - 1;
+  need = R_LOG_ASYNC_ALIGN ((ruint)(sizeof (RLogAsyncRec) + len + 1));
+
+  if (!r_log_async_ring_reserve (sink, ring, need, &pos)) {
+    if (sink->overflow == R_LOG_ASYNC_OVERFLOW_COUNT)
+      r_atomic_uint_fetch_add (&ring->dropped, 1);
+    goto drop;
+  }
+
+  rec = (RLogAsyncRec *)(ring->data + (pos & (ring->size - 1)));
+  rec->size = need;
+  rec->lvl = (ruint16)lvl;
+  rec->line = line;
+  rec->msglen = (ruint32)len + 1;
+  rec->cat = cat;
+  rec->file = file;
+  rec->func = func;
+  rec->thread = r_thread_current ();
+  rec->ts = r_time_get_ts_monotonic ();
+  r_memcpy (rec->msg, msg, len);
+  rec->msg[len] = '\n';
+
+  r_atomic_uint_store (&ring->head, pos + need);
+  r_log_async_wake (sink);
+  return;
+
+drop:
+  r_atomic_uint_fetch_add (&sink->dropped, 1);
+}
+
+static void
+r_log_async_write (RLogAsync * sink, RLogAsyncVec * vec, int n)
+{
+  while (n > 0) {
+    rssize res;
+#ifdef HAVE_SYS_UIO_H
+    res = writev (sink->handle, vec, n);
+#else
+    res = r_io_write (sink->handle, vec->iov_base, vec->iov_len);
+#endif
+    if (res < 0) {
+      if (errno == EINTR || errno == EAGAIN)
+        continue;
+      break;
+    }
+
+    while (n > 0 && (rsize)res >= vec->iov_len) {
+      res -= vec->iov_len;
+      vec++;
+      n--;
+    }
+    if (n > 0) {
+      vec->iov_base = (ruint8 *)vec->iov_base + res;
+      vec->iov_len -= res;
+    }
+  }
+}
+
+/* Write out everything @ring held when the call started; returns the
+ * number of records written. */
+static rsize
+r_log_async_drain_ring (RLogAsync * sink, RLogAsyncRing * ring)
+{
+  ruint head = r_atomic_uint_load (&ring->head);
+  ruint pos = r_atomic_uint_load (&ring->tail);
+  ruint dropped;
+  rsize ret = 0;
+  rboolean report;
+
+  do {
+    rsize used = 0;
+    int n = 0;
+
+    while (pos != head && n + 2 <= R_LOG_ASYNC_BATCH_VECS &&
+        used + R_LOG_ASYNC_PREFIX_MAX <= R_LOG_ASYNC_SCRATCH_SIZE) {
+      RLogAsyncRec * rec = (RLogAsyncRec *)(ring->data + (pos & (ring->size - 1)));
+      rsize len;
+
+      pos += rec->size;
+      if (rec->lvl == R_LOG_ASYNC_LVL_PAD)
+        continue;
+
+      len = r_log_format_prefix (sink->scratch + used, R_LOG_ASYNC_PREFIX_MAX,
+          rec->ts, rec->thread, rec->cat, (RLogLevel)rec->lvl,
+          rec->file, rec->line, rec->func);
+      sink->vec[n].iov_base = sink->scratch + used;
+      sink->vec[n++].iov_len = len;
+      sink->vec[n].iov_base = rec->msg;
+      sink->vec[n++].iov_len = rec->msglen;
+      used += len;
+      ret++;
+    }
+
+    /* The report needs a full prefix worth of scratch as well; when this
+     * batch filled it up, go round once more and report in the next one. */
+    report = pos == head && sink->overflow == R_LOG_ASYNC_OVERFLOW_COUNT &&
+      r_atomic_uint_load (&ring->dropped) > 0;
+    if (report && n + 1 <= R_LOG_ASYNC_BATCH_VECS &&
+        used + R_LOG_ASYNC_PREFIX_MAX <= R_LOG_ASYNC_SCRATCH_SIZE &&
+        (dropped = r_atomic_uint_exchange (&ring->dropped, 0)) > 0) {
+      rsize len = r_log_format_prefix (sink->scratch + used,
+          R_LOG_ASYNC_PREFIX_MAX, r_time_get_ts_monotonic (), NULL,
+          &rlib_logcat, R_LOG_LEVEL_WARNING, __FILE__, __LINE__, R_STRFUNC);
+      report = FALSE;
+      len += r_snprintf (sink->scratch + used + len, R_LOG_ASYNC_PREFIX_MAX - len,
+          "log ring full, dropped %u messages\n", dropped);
+      sink->vec[n].iov_base = sink->scratch + used;
+      sink->vec[n++].iov_len = MIN (len, R_LOG_ASYNC_PREFIX_MAX - 1);
+    }
+
+    if (n > 0)
+      r_log_async_write (sink, sink->vec, n);
+    r_atomic_uint_store (&ring->tail, pos);
+  } while (pos != head || report);
+
+  return ret;
+}
+
+static rsize
+r_log_async_drain (RLogAsync * sink)
+{
+  RLogAsyncRing * ring, * next, ** link;
+  rpointer first;
+  rsize ret = 0;
+
+  for (ring = r_atomic_ptr_load (&sink->rings); ring != NULL; ring = next) {
+    /* Read before draining: a closed ring gets no more records. */
+    rboolean closed = r_atomic_uint_load (&ring->closed);
+
+    next = ring->next;
+    ret += r_log_async_drain_ring (sink, ring);
+    if (!closed)
+      continue;
+
+    /* Unlink it. Logging threads only ever push a new head, so only the
+     * head needs a CAS; behind it the list is the writer's alone. */
+    first = ring;
+    if (!r_atomic_ptr_cmp_xchg_strong (&sink->rings, &first, next)) {
+      for (link = (RLogAsyncRing **)&sink->rings; *link != ring; link = &(*link)->next);
+      *link = next;
+    }
+    r_log_async_ring_unref (ring);
+  }
+
+  return ret;
+}
+
+static rboolean
+r_log_async_pending (RLogAsync * sink)
+{
+  RLogAsyncRing * ring;
+
+  if (r_atomic_uint_load (&sink->stop) ||
+      r_atomic_uint_load (&sink->flushreq) != sink->flushdone)
+    return TRUE;
+
+  for (ring = r_atomic_ptr_load (&sink->rings); ring != NULL; ring = ring->next) {
+    if (r_atomic_uint_load (&ring->head) != r_atomic_uint_load (&ring->tail) ||
+        r_atomic_uint_load (&ring->closed))
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+static rpointer
+r_log_async_writer (rpointer data)
+{
+  RLogAsync * sink = data;
+
+  for (;;) {
+    ruint req = r_atomic_uint_load (&sink->flushreq);
+    rboolean stop = r_atomic_uint_load (&sink->stop);
+    rsize n = r_log_async_drain (sink);
+
+    r_mutex_lock (&sink->lock);
+    if (req != sink->flushdone) {
+      sink->flushdone = req;
+      r_cond_broadcast (&sink->flushcond);
+    }
+    if (stop) {
+      r_mutex_unlock (&sink->lock);
+      break;
+    }
+
+    /* A logging thread commits its record before it checks 'sleeping';
+     * the writer raises 'sleeping' before its final look. One of them
+     * sees the other. */
+    if (n == 0) {
+      r_atomic_uint_store (&sink->sleeping, 1);
+      if (!r_log_async_pending (sink)) {
+        while (r_atomic_uint_load (&sink->sleeping))
+          r_cond_wait (&sink->wakecond, &sink->lock);
+      }
+      r_atomic_uint_store (&sink->sleeping, 0);
+    }
+    r_mutex_unlock (&sink->lock);
+  }
+
+  return NULL;
+}
+
+static void
+r_log_async_free (RLogAsync * sink)
+{
+  RLogAsyncRing * ring, * next;
+
+  r_mutex_lock (&sink->lock);
+  r_atomic_uint_store (&sink->stop, 1);
+  r_atomic_uint_store (&sink->sleeping, 0);
+  r_cond_signal (&sink->wakecond);
+  r_mutex_unlock (&sink->lock);
+
+  r_thread_join (sink->writer);
+  r_thread_unref (sink->writer);
+
+  for (ring = r_atomic_ptr_load (&sink->rings); ring != NULL; ring = next) {
+    next = ring->next;
+    r_log_async_ring_unref (ring);
+  }
+
+  if (sink->ownhandle)
+    r_io_close (sink->handle);
+  r_cond_clear (&sink->flushcond);
+  r_cond_clear (&sink->wakecond);
+  r_mutex_clear (&sink->lock);
+  r_free (sink->scratch);
+  r_free (sink->vec);
+  r_free (sink);
+}
+
+static RLogAsync *
+r_log_async_new_internal (RIOHandle handle, rboolean ownhandle,
+    RLogAsyncOverflow overflow, rsize ringsize)
+{
+  RLogAsync * ret;
+  ruint size = R_LOG_ASYNC_RING_SIZE_MIN;
+
+  if (ringsize == 0)
+    ringsize = R_LOG_ASYNC_RING_SIZE_DEFAULT;
+  while (size < ringsize && size < RUINT32_MAX / 4)
+    size <<= 1;
+
+  if ((ret = r_mem_new0 (RLogAsync)) != NULL) {
+    r_ref_init (ret, r_log_async_free);
+    ret->id = r_atomic_uint_fetch_add (&g__r_log_async_id, 1) + 1;
+    ret->handle = handle;
+    ret->ownhandle = ownhandle;
+    ret->overflow = overflow;
+    ret->ringsize = size;
+    ret->vec = r_mem_new_n (RLogAsyncVec, R_LOG_ASYNC_BATCH_VECS);
+    ret->scratch = r_malloc (R_LOG_ASYNC_SCRATCH_SIZE);
+    r_mutex_init (&ret->lock);
+    r_cond_init (&ret->wakecond);
+    r_cond_init (&ret->flushcond);
+
+    if (R_UNLIKELY (ret->vec == NULL || ret->scratch == NULL ||
+        (ret->writer = r_thread_new ("rlog-async", r_log_async_writer, ret)) == NULL)) {
+      r_cond_clear (&ret->flushcond);
+      r_cond_clear (&ret->wakecond);
+      r_mutex_clear (&ret->lock);
+      r_free (ret->scratch);
+      r_free (ret->vec);
+      r_free (ret);
+      ret = NULL;
+    }
+  }
+
+  return ret;
+}
+
+RLogAsync *
+r_log_async_new (RIOHandle handle, RLogAsyncOverflow overflow, rsize ringsize)
+{
+  if (R_UNLIKELY (handle == R_IO_HANDLE_INVALID)) return NULL;
+  return r_log_async_new_internal (handle, FALSE, overflow, ringsize);
+}
+
+RLogAsync *
+r_log_async_new_file (const rchar * path, RLogAsyncOverflow overflow,
+    rsize ringsize)
+{
+  RLogAsync * ret;
+  RIOHandle handle;
+
+  if (R_UNLIKELY (path == NULL)) return NULL;
+
+  handle = r_io_open_file (path, R_FILE_CREATE_ALWAYS, R_FILE_WRITE,
+      R_FILE_SHARE_READ, R_FILE_FLAG_CLOEXEC, NULL);
+  if (handle == R_IO_HANDLE_INVALID)
+    return NULL;
+
+  if ((ret = r_log_async_new_internal (handle, TRUE, overflow, ringsize)) == NULL)
+    r_io_close (handle);
+  return ret;
+}
+
+void
+r_log_async_flush (RLogAsync * sink)
+{
+  ruint req;
+
+  if (R_UNLIKELY (sink == NULL)) return;
+
+  r_mutex_lock (&sink->lock);
+  req = r_atomic_uint_fetch_add (&sink->flushreq, 1) + 1;
+  r_atomic_uint_store (&sink->sleeping, 0);
+  r_cond_signal (&sink->wakecond);
+  while ((int)(sink->flushdone - req) < 0)
+    r_cond_wait (&sink->flushcond, &sink->lock);
+  r_mutex_unlock (&sink->lock);
+}
+
+ruint
+r_log_async_dropped (RLogAsync * sink)
+{
+  if (R_UNLIKELY (sink == NULL)) return 0;
+  return r_atomic_uint_load (&sink->dropped);
+}
@@ -0,0 +1,601 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2015  Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+
+#include "config.h"
+#include "rlib-private.h"
+#include <rlib/rlogbin.h>
+
+#include <rlib/concurrency/ratomic.h>
+#include <rlib/concurrency/rthreads.h>
+#include <rlib/file/rio.h>
+#include <rlib/os/rproc.h>
+#include <rlib/rio.h>
+#include <rlib/rmem.h>
+#include <rlib/rstr.h>
+#include <rlib/rtime.h>
+#include <rlib/types/rendianness.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define R_LOG_BIN_VERSION               1
+#define R_LOG_BIN_CHUNK_SITE            1
+#define R_LOG_BIN_CHUNK_DATA            2
+#define R_LOG_BIN_SITE_PREFORMATTED     0x01
+/* On-disk argument kinds */
+#define R_LOG_BIN_KIND_I32              1
+#define R_LOG_BIN_KIND_I64              2
+#define R_LOG_BIN_KIND_F64              3
+#define R_LOG_BIN_KIND_STR              4
+#define R_LOG_BIN_STR_NULL              0xffffffff
+
+#define R_LOG_BIN_BUF_SIZE              (64 * 1024)
+/* Chunk header plus the thread the records belong to. */
+#define R_LOG_BIN_DATA_HDR              (2 * sizeof (ruint32) + sizeof (ruint64))
+/* Messages that had to be formatted up front are truncated to this. */
+#define R_LOG_BIN_MSG_MAX               (16 * 1024)
+
+/* RLogSite.nargs for a format that can not be recorded argument by argument */
+#define R_LOG_SITE_PREFORMATTED         0xff
+
+/* C argument types, as they have to be fetched with va_arg */
+typedef enum {
+  R_LOG_BIN_ARG_INT = 1,
+  R_LOG_BIN_ARG_LONG,
+  R_LOG_BIN_ARG_LLONG,
+  R_LOG_BIN_ARG_SIZE,
+  R_LOG_BIN_ARG_INTMAX,
+  R_LOG_BIN_ARG_PTRDIFF,
+  R_LOG_BIN_ARG_PTR,
+  R_LOG_BIN_ARG_DOUBLE,
+  R_LOG_BIN_ARG_LDOUBLE,
+  R_LOG_BIN_ARG_STR,
+  R_LOG_BIN_ARG_PREC,       /* int from a '.*' precision */
+} RLogBinArg;
+
+typedef struct {
+  rchar magic[8];
+  ruint16 version;
+  ruint8 ptrsize;
+  ruint8 longsize;
+  ruint8 littleendian;
+  ruint8 reserved[3];
+  ruint32 pid;
+  ruint32 reserved2;
+  ruint64 tsstart;
+} RLogBinHeader;
+
+/* A thread's pending DATA chunk. data starts with room for the chunk
+ * header, which is filled in when the chunk is written. */
+typedef struct RLogBinBuf RLogBinBuf;
+struct RLogBinBuf {
+  RLogBinBuf * prev;
+  RLogBinBuf * next;
+  rpointer thread;
+  ruint session;
+  rsize used;
+  ruint8 data[R_LOG_BIN_BUF_SIZE];
+};
+
+rauint _r_log_bin_enabled = 0;
+
+/* Protects the handle, site ids and the buffer list. */
+static RMutex g__r_log_bin_lock;
+static RIOHandle g__r_log_bin_handle = R_IO_HANDLE_INVALID;
+static RClockTime g__r_log_bin_ts_start;
+/* Bumped on every open; sites and buffers from older sessions are stale. */
+static rauint g__r_log_bin_session = 0;
+static ruint g__r_log_bin_next_id = 0;
+static RLogBinBuf * g__r_log_bin_bufs = NULL;
+
+static void r_log_bin_thread_done (rpointer data);
+static RTss g__r_log_bin_tss = R_TSS_INIT (r_log_bin_thread_done);
+
+static void
+r_log_bin_buf_write_locked (RLogBinBuf * buf)
+{
+  if (buf->used > R_LOG_BIN_DATA_HDR &&
+      buf->session == r_atomic_uint_load (&g__r_log_bin_session) &&
+      g__r_log_bin_handle != R_IO_HANDLE_INVALID) {
+    ruint32 hdr[2] = { R_LOG_BIN_CHUNK_DATA, (ruint32)(buf->used - 2 * sizeof (ruint32)) };
+    ruint64 thread = (ruint64)RPOINTER_TO_SIZE (buf->thread);
+
+    r_memcpy (buf->data, hdr, sizeof (hdr));
+    r_memcpy (buf->data + sizeof (hdr), &thread, sizeof (thread));
+    r_io_write (g__r_log_bin_handle, buf->data, buf->used);
+  }
+
+  buf->used = R_LOG_BIN_DATA_HDR;
+}
+
+static void
+r_log_bin_buf_write (RLogBinBuf * buf)
+{
+  r_mutex_lock (&g__r_log_bin_lock);
+  r_log_bin_buf_write_locked (buf);
+  r_mutex_unlock (&g__r_log_bin_lock);
+}
+
+static void
+r_log_bin_buf_unlink_locked (RLogBinBuf * buf)
+{
+  if (buf->prev != NULL)
+    buf->prev->next = buf->next;
+  else
+    g__r_log_bin_bufs = buf->next;
+  if (buf->next != NULL)
+    buf->next->prev = buf->prev;
+}
+
+static void
+r_log_bin_thread_done (rpointer data)
+{
+  RLogBinBuf * buf = data;
+
+  r_mutex_lock (&g__r_log_bin_lock);
+  r_log_bin_buf_write_locked (buf);
+  r_log_bin_buf_unlink_locked (buf);
+  r_mutex_unlock (&g__r_log_bin_lock);
+  r_free (buf);
+}
+
+static RLogBinBuf *
+r_log_bin_thread_buf (ruint session)
+{
+  RLogBinBuf * buf;
+
+  if (R_UNLIKELY ((buf = r_tss_get (&g__r_log_bin_tss)) == NULL)) {
+    buf = r_mem_new (RLogBinBuf);
+    buf->thread = r_thread_current ();
+    buf->session = session;
+    buf->used = R_LOG_BIN_DATA_HDR;
+    buf->prev = NULL;
+
+    r_mutex_lock (&g__r_log_bin_lock);
+    if ((buf->next = g__r_log_bin_bufs) != NULL)
+      buf->next->prev = buf;
+    g__r_log_bin_bufs = buf;
+    r_mutex_unlock (&g__r_log_bin_lock);
+
+    r_tss_set (&g__r_log_bin_tss, buf);
+  } else if (R_UNLIKELY (buf->session != session)) {
+    buf->session = session;
+    buf->used = R_LOG_BIN_DATA_HDR;
+  }
+
+  return buf;
+}
+
+/* Append to the record that starts at *rec. If the buffer is full, what
+ * precedes the record is written out and the record moved to the front. */
+static void
+r_log_bin_buf_append (RLogBinBuf * buf, rsize * rec,
+    rconstpointer data, rsize size)
+{
+  if (R_UNLIKELY (buf->used + size > sizeof (buf->data))) {
+    rsize partial = buf->used - *rec;
+
+    buf->used = *rec;
+    r_log_bin_buf_write (buf);
+    r_memmove (buf->data + R_LOG_BIN_DATA_HDR, buf->data + *rec, partial);
+    buf->used = R_LOG_BIN_DATA_HDR + partial;
+    *rec = R_LOG_BIN_DATA_HDR;
+  }
+
+  r_memcpy (buf->data + buf->used, data, size);
+  buf->used += size;
+}
+
+static void
+r_log_bin_buf_append_str (RLogBinBuf * buf, rsize * rec,
+    const rchar * str, rsize max)
+{
+  const rchar * end;
+  ruint32 len;
+
+  if (str != NULL) {
+    end = r_strnchr (str, 0, max);
+    len = (ruint32)(end != NULL ? (rsize)(end - str) : max);
+    r_log_bin_buf_append (buf, rec, &len, sizeof (len));
+    r_log_bin_buf_append (buf, rec, str, len);
+  } else {
+    len = R_LOG_BIN_STR_NULL;
+    r_log_bin_buf_append (buf, rec, &len, sizeof (len));
+  }
+}
+
+/* Fill argt with the C types fmt consumes; R_LOG_SITE_PREFORMATTED if it
+ * uses anything that can not be replayed from the raw values. */
+static ruint8
+r_log_bin_parse_fmt (const rchar * fmt, ruint8 * argt)
+{
+  ruint8 n = 0;
+  const rchar * p = fmt;
+
+  while ((p = r_strchr (p, '%')) != NULL) {
+    rboolean litprec = FALSE;
+    rchar len = 0;
+
+    if (*++p == '%') {
+      p++;
+      continue;
+    }
+
+    while (*p != 0 && r_strchr ("-+ #0'", *p) != NULL)
+      p++;
+    if (*p == '*') {
+      if (n >= R_LOG_SITE_MAX_ARGS)
+        return R_LOG_SITE_PREFORMATTED;
+      argt[n++] = R_LOG_BIN_ARG_INT;
+      p++;
+    } else {
+      while (*p >= '0' && *p <= '9')
+        p++;
+      if (*p == '$')
+        return R_LOG_SITE_PREFORMATTED;
+    }
+    if (*p == '.') {
+      if (*++p == '*') {
+        if (n >= R_LOG_SITE_MAX_ARGS)
+          return R_LOG_SITE_PREFORMATTED;
+        argt[n++] = R_LOG_BIN_ARG_PREC;
+        p++;
+      } else {
+        while (*p >= '0' && *p <= '9')
+          p++;
+        litprec = TRUE;
+      }
+    }
+
+    switch (*p) {
+      case 'h':
+        len = *p++;
+        if (*p == 'h')
+          p++;
+        break;
+      case 'l':
+        len = *p++;
+        if (*p == 'l') {
+          len = 'q';
+          p++;
+        }
+        break;
+      case 'q': case 'L': case 'j': case 'z': case 't':
+        len = *p++;
+        break;
+      default:
+        break;
+    }
+
+    if (n >= R_LOG_SITE_MAX_ARGS)
+      return R_LOG_SITE_PREFORMATTED;
+
+    switch (*p++) {
+      case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+        switch (len) {
+          case 'l': argt[n++] = R_LOG_BIN_ARG_LONG; break;
+          case 'q': case 'L': argt[n++] = R_LOG_BIN_ARG_LLONG; break;
+          case 'j': argt[n++] = R_LOG_BIN_ARG_INTMAX; break;
+          case 'z': argt[n++] = R_LOG_BIN_ARG_SIZE; break;
+          case 't': argt[n++] = R_LOG_BIN_ARG_PTRDIFF; break;
+          default: argt[n++] = R_LOG_BIN_ARG_INT; break;
+        }
+        break;
+      case 'c':
+        if (len != 0)
+          return R_LOG_SITE_PREFORMATTED;
+        argt[n++] = R_LOG_BIN_ARG_INT;
+        break;
+      case 'e': case 'E': case 'f': case 'F':
+      case 'g': case 'G': case 'a': case 'A':
+        argt[n++] = (len == 'L') ? R_LOG_BIN_ARG_LDOUBLE : R_LOG_BIN_ARG_DOUBLE;
+        break;
+      case 's':
+        /* A '.*' precision bounds the copy at record time, but a literal
+         * one isn't kept anywhere; the string may not be terminated. */
+        if (len != 0 || litprec)
+          return R_LOG_SITE_PREFORMATTED;
+        argt[n++] = R_LOG_BIN_ARG_STR;
+        break;
+      case 'p':
+        argt[n++] = R_LOG_BIN_ARG_PTR;
+        break;
+      default:
+        /* %n, %m, wide characters, truncated format, ... */
+        return R_LOG_SITE_PREFORMATTED;
+    }
+  }
+
+  return n;
+}
+
+static ruint8
+r_log_bin_arg_kind (ruint8 argt)
+{
+  switch (argt) {
+    case R_LOG_BIN_ARG_INT:
+    case R_LOG_BIN_ARG_PREC:    return R_LOG_BIN_KIND_I32;
+    case R_LOG_BIN_ARG_DOUBLE:
+    case R_LOG_BIN_ARG_LDOUBLE: return R_LOG_BIN_KIND_F64;
+    case R_LOG_BIN_ARG_STR:     return R_LOG_BIN_KIND_STR;
+    default:                    return R_LOG_BIN_KIND_I64;
+  }
+}
+
+static void
+r_log_bin_write_site_locked (const RLogSite * site, RLogCategory * cat,
+    RLogLevel lvl, const rchar * file, ruint line, const rchar * func,
+    const rchar * fmt)
+{
+  const rchar * strs[4];
+  rsize slen[4], size, i;
+  ruint8 nargs, flags, * chunk, * p;
+  ruint32 u32;
+  ruint16 u16;
+
+  strs[0] = cat->name;
+  strs[1] = file != NULL ? file : "";
+  strs[2] = func != NULL ? func : "";
+  strs[3] = fmt;
+  size = 2 * sizeof (ruint32) + 2 * sizeof (ruint32) + 2 + sizeof (ruint16);
+  for (i = 0; i < R_N_ELEMENTS (strs); i++)
+    size += (slen[i] = r_strlen (strs[i]) + 1);
+
+  if (site->nargs == R_LOG_SITE_PREFORMATTED) {
+    flags = R_LOG_BIN_SITE_PREFORMATTED;
+    nargs = 1;
+  } else {
+    flags = 0;
+    nargs = site->nargs;
+  }
+  size += nargs;
+
+  p = chunk = r_malloc (size);
+  u32 = R_LOG_BIN_CHUNK_SITE;
+  r_memcpy (p, &u32, sizeof (u32));                     p += sizeof (u32);
+  u32 = (ruint32)(size - 2 * sizeof (ruint32));
+  r_memcpy (p, &u32, sizeof (u32));                     p += sizeof (u32);
+  u32 = site->id;
+  r_memcpy (p, &u32, sizeof (u32));                     p += sizeof (u32);
+  u32 = line;
+  r_memcpy (p, &u32, sizeof (u32));                     p += sizeof (u32);
+  *p++ = (ruint8)lvl;
+  *p++ = flags;
+  u16 = nargs;
+  r_memcpy (p, &u16, sizeof (u16));                     p += sizeof (u16);
+  if (flags & R_LOG_BIN_SITE_PREFORMATTED) {
+    *p++ = R_LOG_BIN_KIND_STR;
+  } else {
+    for (i = 0; i < nargs; i++)
+      *p++ = r_log_bin_arg_kind (site->argt[i]);
+  }
+  for (i = 0; i < R_N_ELEMENTS (strs); i++) {
+    r_memcpy (p, strs[i], slen[i]);
+    p += slen[i];
+  }
+
+  r_io_write (g__r_log_bin_handle, chunk, size);
+  r_free (chunk);
+}
+
+/* FALSE if the trace file was closed (or reopened) in the meantime */
+static rboolean
+r_log_bin_site_register (RLogSite * site, RLogCategory * cat, RLogLevel lvl,
+    const rchar * file, ruint line, const rchar * func, const rchar * fmt,
+    ruint session)
+{
+  rboolean ret = TRUE;
+
+  r_mutex_lock (&g__r_log_bin_lock);
+  if (session != r_atomic_uint_load (&g__r_log_bin_session) ||
+      g__r_log_bin_handle == R_IO_HANDLE_INVALID) {
+    ret = FALSE;
+  } else if (r_atomic_uint_load (&site->session) != session) {
+    site->nargs = r_log_bin_parse_fmt (fmt, site->argt);
+    site->id = g__r_log_bin_next_id++;
+    r_log_bin_write_site_locked (site, cat, lvl, file, line, func, fmt);
+    r_atomic_uint_store (&site->session, session);
+  }
+  r_mutex_unlock (&g__r_log_bin_lock);
+
+  return ret;
+}
+
+void
+r_log_bin_record (RLogSite * site, RLogCategory * cat, RLogLevel lvl,
+    const rchar * file, ruint line, const rchar * func,
+    const rchar * fmt, va_list args)
+{
+  ruint session = r_atomic_uint_load (&g__r_log_bin_session);
+  ruint64 ts = r_time_get_ts_monotonic ();
+  RLogBinBuf * buf;
+  ruint32 id;
+  rsize rec;
+  ruint8 i;
+  int prec = -1;
+
+  if (R_UNLIKELY (r_atomic_uint_load (&site->session) != session) &&
+      !r_log_bin_site_register (site, cat, lvl, file, line, func, fmt, session)) {
+    rchar * msg = r_strvprintf (fmt, args);
+    r_log_msg (cat, lvl, file, line, func, msg);
+    r_free (msg);
+    return;
+  }
+
+  buf = r_log_bin_thread_buf (session);
+  rec = buf->used;
+  id = site->id;
+  r_log_bin_buf_append (buf, &rec, &id, sizeof (id));
+  r_log_bin_buf_append (buf, &rec, &ts, sizeof (ts));
+
+  if (site->nargs == R_LOG_SITE_PREFORMATTED) {
+    rchar * msg = r_strvprintf (fmt, args);
+    r_log_bin_buf_append_str (buf, &rec, msg, R_LOG_BIN_MSG_MAX);
+    r_free (msg);
+    return;
+  }
+
+  for (i = 0; i < site->nargs; i++) {
+    ruint64 u64;
+    ruint32 u32;
+    rdouble dbl;
+    rsize max;
+
+    switch (site->argt[i]) {
+      case R_LOG_BIN_ARG_INT:
+        u32 = (ruint32)va_arg (args, int);
+        r_log_bin_buf_append (buf, &rec, &u32, sizeof (u32));
+        continue;
+      case R_LOG_BIN_ARG_PREC:
+        prec = va_arg (args, int);
+        u32 = (ruint32)prec;
+        r_log_bin_buf_append (buf, &rec, &u32, sizeof (u32));
+        continue;
+      case R_LOG_BIN_ARG_LONG:
+        u64 = (ruint64)(rint64)va_arg (args, long);
+        break;
+      case R_LOG_BIN_ARG_LLONG:
+        u64 = (ruint64)va_arg (args, long long);
+        break;
+      case R_LOG_BIN_ARG_SIZE:
+        u64 = (ruint64)va_arg (args, rsize);
+        break;
+      case R_LOG_BIN_ARG_INTMAX:
+        u64 = (ruint64)va_arg (args, intmax_t);
+        break;
+      case R_LOG_BIN_ARG_PTRDIFF:
+        u64 = (ruint64)va_arg (args, ptrdiff_t);
+        break;
+      case R_LOG_BIN_ARG_PTR:
+        u64 = (ruint64)RPOINTER_TO_SIZE (va_arg (args, rpointer));
+        break;
+      case R_LOG_BIN_ARG_DOUBLE:
+        dbl = va_arg (args, double);
+        r_log_bin_buf_append (buf, &rec, &dbl, sizeof (dbl));
+        continue;
+      case R_LOG_BIN_ARG_LDOUBLE:
+        dbl = (rdouble)va_arg (args, long double);
+        r_log_bin_buf_append (buf, &rec, &dbl, sizeof (dbl));
+        continue;
+      case R_LOG_BIN_ARG_STR:
+      default:
+        /* printf reads no further than the precision, nor may we */
+        max = R_LOG_BIN_STR_MAX;
+        if (i > 0 && site->argt[i - 1] == R_LOG_BIN_ARG_PREC && prec >= 0)
+          max = MIN ((rsize)prec, max);
+        r_log_bin_buf_append_str (buf, &rec, va_arg (args, const rchar *), max);
+        continue;
+    }
+
+    r_log_bin_buf_append (buf, &rec, &u64, sizeof (u64));
+  }
+}
+
+rboolean
+r_log_bin_open (const rchar * path)
+{
+  RLogBinHeader hdr;
+  RIOHandle handle;
+
+  if (R_UNLIKELY (path == NULL)) return FALSE;
+
+  r_log_bin_close ();
+
+  handle = r_io_open_file (path, R_FILE_CREATE_ALWAYS, R_FILE_WRITE,
+      R_FILE_SHARE_READ, R_FILE_FLAG_CLOEXEC, NULL);
+  if (handle == R_IO_HANDLE_INVALID)
+    return FALSE;
+
+  r_memset (&hdr, 0, sizeof (hdr));
+  r_memcpy (hdr.magic, "RLOGBIN1", sizeof (hdr.magic));
+  hdr.version = R_LOG_BIN_VERSION;
+  hdr.ptrsize = sizeof (rpointer);
+  hdr.longsize = sizeof (long);
+  hdr.littleendian = (R_BYTE_ORDER == R_LITTLE_ENDIAN);
+  hdr.pid = (ruint32)r_proc_get_id ();
+  hdr.tsstart = g__r_log_bin_ts_start;
+  if (r_io_write (handle, &hdr, sizeof (hdr)) != (rssize)sizeof (hdr)) {
+    r_io_close (handle);
+    return FALSE;
+  }
+
+  r_mutex_lock (&g__r_log_bin_lock);
+  g__r_log_bin_handle = handle;
+  g__r_log_bin_next_id = 0;
+  r_atomic_uint_fetch_add (&g__r_log_bin_session, 1);
+  r_mutex_unlock (&g__r_log_bin_lock);
+
+  r_atomic_uint_store (&_r_log_bin_enabled, 1);
+  return TRUE;
+}
+
+void
+r_log_bin_close (void)
+{
+  RLogBinBuf * buf;
+
+  r_atomic_uint_store (&_r_log_bin_enabled, 0);
+
+  r_mutex_lock (&g__r_log_bin_lock);
+  if (g__r_log_bin_handle != R_IO_HANDLE_INVALID) {
+    for (buf = g__r_log_bin_bufs; buf != NULL; buf = buf->next)
+      r_log_bin_buf_write_locked (buf);
+    r_io_close (g__r_log_bin_handle);
+    g__r_log_bin_handle = R_IO_HANDLE_INVALID;
+  }
+  r_mutex_unlock (&g__r_log_bin_lock);
+}
+
+void
+r_log_bin_flush (void)
+{
+  RLogBinBuf * buf;
+
+  if ((buf = r_tss_get (&g__r_log_bin_tss)) != NULL)
+    r_log_bin_buf_write (buf);
+}
+
+rboolean
+r_log_bin_is_enabled (void)
+{
+  return r_atomic_uint_load (&_r_log_bin_enabled) != 0;
+}
+
+void
+r_log_bin_init (RClockTime tsstart)
+{
+  r_mutex_init (&g__r_log_bin_lock);
+  g__r_log_bin_ts_start = tsstart;
+}
+
+void
+r_log_bin_deinit (void)
+{
+  RLogBinBuf * buf;
+
+  r_log_bin_close ();
+
+  /* Other threads' buffers go when those threads exit. */
+  if ((buf = r_tss_get (&g__r_log_bin_tss)) != NULL) {
+    r_tss_set (&g__r_log_bin_tss, NULL);
+    r_mutex_lock (&g__r_log_bin_lock);
+    r_log_bin_buf_unlink_locked (buf);
+    r_mutex_unlock (&g__r_log_bin_lock);
+    r_free (buf);
+  }
+}
@@ -259,13 +259,8 @@ r_memdup_aggv (rsize * out, va_list args)
 rpointer
 r_mem_scan_byte (rconstpointer mem, rsize size, ruint8 byte)
 {
-  if (R_LIKELY (mem != NULL)) {
-    const ruint8 * ptr = mem, * end;
-    for (end = ptr + size; ptr < end; ptr++) {
-      if (*ptr == byte)
-        return (rpointer)ptr;
-    }
-  }
+  if (R_LIKELY (mem != NULL && size > 0))
+    return memchr (mem, byte, size);
 
   return NULL;
 }
@@ -25,6 +25,7 @@
 #include <rlib/rtc/rrtctypes.h>
 #include <rlib/rtc/rrtcicecandidate.h>
 #include <rlib/rtc/rrtcicetransport.h>
+#include <rlib/rtc/rrtccongestion.h>
 #include <rlib/rtc/rrtccryptotransport.h>
 #include <rlib/rtc/rrtcrtplistener.h>
 #include <rlib/rtc/rrtcrtpreceiver.h>
@@ -36,9 +37,11 @@
 #include <rlib/net/rtlsserver.h>
 #include <rlib/net/rtlsclient.h>
 #include <rlib/net/rsrtp.h>
+#include <rlib/net/proto/rstun.h>
 
 #include <rlib/data/rhashtable.h>
 #include <rlib/data/rptrarray.h>
+#include <rlib/data/rqueue.h>
 
 #include <rlib/rlog.h>
 
@@ -114,7 +117,13 @@ struct RRtcRtpSender {
   RRtcCryptoTransport * rtp;
   RRtcCryptoTransport * rtcp;
 
-  /*REvLoop * loop;*/
+  /* Congestion control, see r_rtc_rtp_sender_enable_congestion_control */
+  RRtcBwe * bwe;
+  RRtcPacer * pacer;
+  ruint8 twcc_id;
+  ruint16 twcc_seq;
+
+  REvLoop * loop;
   rchar id[24 + 1];
 };
 
@@ -123,6 +132,82 @@ R_API_HIDDEN RRtcRtpSender * r_rtc_rtp_sender_new (RPrng * prng,
     const RRtcRtpSenderCallbacks * cbs, rpointer data, RDestroyNotify notify,
     RRtcCryptoTransport * rtp, RRtcCryptoTransport * rtcp) R_ATTR_MALLOC;
 
+R_API_HIDDEN void r_rtc_rtp_sender_handle_rtcp (RRtcRtpSender * s,
+    RBuffer * buf);
+
+
+#define R_RTC_BWE_HISTORY   4096
+
+typedef struct {
+  RClockTime sent;
+  rsize size;
+  ruint16 seq;
+} RRtcBweSentPacket;
+
+typedef struct {
+  RClockTime first_send;
+  RClockTime last_send;
+  RClockTime last_arrival;
+} RRtcBwePacketGroup;
+
+#define R_RTC_BWE_TRENDLINE_WINDOW  20
+
+struct RRtcBwe {
+  RRef ref;
+
+  rdouble bitrate;
+  rdouble min_bps, max_bps;
+
+  /* Send history, indexed by transport-wide sequence number */
+  RRtcBweSentPacket history[R_RTC_BWE_HISTORY];
+
+  /* Inter-group delay variation */
+  RRtcBwePacketGroup cur, prev;
+
+  /* Trendline filter */
+  rdouble acc_delay, smoothed_delay;
+  rdouble tl_x[R_RTC_BWE_TRENDLINE_WINDOW];
+  rdouble tl_y[R_RTC_BWE_TRENDLINE_WINDOW];
+  rsize tl_count;
+  RClockTime first_arrival;
+  ruint num_deltas;
+  rdouble trend, prev_trend;
+
+  /* Overuse detector */
+  rdouble threshold;
+  RClockTime threshold_update;
+  rdouble overusing;    /* ms spent above threshold, < 0 if not */
+  ruint overuse_count;
+  RRtcBweUsage usage;
+
+  /* Rate control */
+  RClockTime rate_update;
+  RClockTime last_decrease;
+  rdouble acked_bps;
+  RClockTime acked_start, acked_last;
+  rsize acked_bytes;
+  rsize loss_lost, loss_total;
+  rdouble loss;
+};
+
+struct RRtcPacer {
+  RRef ref;
+
+  REvLoop * loop;
+  RRtcPacerSendFunc send;
+  rpointer data;
+  RDestroyNotify notify;
+
+  ruint64 bps;
+  rint64 budget;
+  RClockTime last;
+  RClockEntry * timer;
+
+  RQueueList queue;
+  rsize queue_bytes;
+};
+
+
 struct RRtcRtpListener {
   RRef ref;
 
@@ -233,6 +318,8 @@ struct RRtcIceTransport {
   rchar * pwd;
   rchar * rufrag;         /* remote ICE ufrag (from the peer's SDP) */
   rchar * rpwd;           /* remote ICE pwd, keys outbound check integrity */
+  RStunBindingResponder * responder; /* keyed with pwd: answers and verifies inbound checks */
+  RHmac * rpwdhmac;       /* keyed with rpwd: signs our checks, verifies their responses */
   ruint64 tiebreaker;     /* ICE-CONTROLLING / ICE-CONTROLLED tiebreaker */
 
   RRtcIceComponent component;
@@ -0,0 +1,541 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2017 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+
+#include "config.h"
+#include "rrtc-private.h"
+#include <rlib/rtc/rrtccongestion.h>
+
+#include <rlib/rmem.h>
+
+/* Delay-based estimator, modelled on the send-side half of Google
+ * Congestion Control (draft-ietf-rmcat-gcc-02):
+ *  - packets sent within R_RTC_BWE_BURST of each other form a group;
+ *  - the difference between inter-group arrival and send deltas is the
+ *    change in queuing delay, accumulated and smoothed;
+ *  - a least-squares line over the last R_RTC_BWE_TRENDLINE_WINDOW points
+ *    gives the delay trend, compared against an adaptive threshold;
+ *  - the rate controller backs off to a fraction of the acknowledged
+ *    throughput on overuse and grows multiplicatively otherwise. */
+#define R_RTC_BWE_BURST             (5 * R_MSECOND)
+#define R_RTC_BWE_SMOOTHING         0.9
+#define R_RTC_BWE_TREND_GAIN        4.0
+#define R_RTC_BWE_TREND_DELTAS_MAX  60
+#define R_RTC_BWE_THRESHOLD_INIT    12.5
+#define R_RTC_BWE_THRESHOLD_MIN     6.0
+#define R_RTC_BWE_THRESHOLD_MAX     600.0
+#define R_RTC_BWE_K_UP              0.0087
+#define R_RTC_BWE_K_DOWN            0.039
+#define R_RTC_BWE_OVERUSE_TIME      10.0
+#define R_RTC_BWE_BETA              0.85
+#define R_RTC_BWE_INCREASE          0.08
+#define R_RTC_BWE_DECREASE_INTERVAL (300 * R_MSECOND)
+#define R_RTC_BWE_ACKED_WINDOW_INIT (500 * R_MSECOND)
+#define R_RTC_BWE_ACKED_WINDOW      (150 * R_MSECOND)
+#define R_RTC_BWE_LOSS_HIGH         0.1
+#define R_RTC_BWE_LOSS_MIN_PACKETS  20
+
+#define R_RTC_BWE_MS(t)             ((rdouble)(t) / R_MSECOND)
+
+static void
+r_rtc_bwe_free (RRtcBwe * bwe)
+{
+  r_free (bwe);
+}
+
+RRtcBwe *
+r_rtc_bwe_new (ruint64 start_bps, ruint64 min_bps, ruint64 max_bps)
+{
+  RRtcBwe * ret;
+  rsize i;
+
+  if (R_UNLIKELY (start_bps == 0)) return NULL;
+  if (R_UNLIKELY (start_bps < min_bps)) return NULL;
+  if (R_UNLIKELY (max_bps > 0 && start_bps > max_bps)) return NULL;
+
+  if ((ret = r_mem_new0 (RRtcBwe)) != NULL) {
+    r_ref_init (ret, r_rtc_bwe_free);
+
+    ret->bitrate = (rdouble)start_bps;
+    ret->min_bps = (rdouble)min_bps;
+    ret->max_bps = max_bps > 0 ? (rdouble)max_bps : (rdouble)RUINT64_MAX;
+
+    for (i = 0; i < R_RTC_BWE_HISTORY; i++)
+      ret->history[i].sent = R_CLOCK_TIME_NONE;
+
+    ret->cur.first_send = ret->prev.first_send = R_CLOCK_TIME_NONE;
+    ret->first_arrival = R_CLOCK_TIME_NONE;
+    ret->threshold = R_RTC_BWE_THRESHOLD_INIT;
+    ret->threshold_update = R_CLOCK_TIME_NONE;
+    ret->overusing = -1.0;
+    ret->usage = R_RTC_BWE_NORMAL;
+    ret->rate_update = R_CLOCK_TIME_NONE;
+    ret->last_decrease = R_CLOCK_TIME_NONE;
+    ret->acked_start = R_CLOCK_TIME_NONE;
+  }
+
+  return ret;
+}
+
+void
+r_rtc_bwe_on_packet_sent (RRtcBwe * bwe, ruint16 tseq, rsize size,
+    RClockTime now)
+{
+  RRtcBweSentPacket * pkt = &bwe->history[tseq % R_RTC_BWE_HISTORY];
+
+  pkt->sent = now;
+  pkt->size = size;
+  pkt->seq = tseq;
+}
+
+static void
+r_rtc_bwe_update_threshold (RRtcBwe * bwe, rdouble modified, RClockTime now)
+{
+  rdouble absmod = ABS (modified);
+  rdouble dt, k;
+
+  if (!R_CLOCK_TIME_IS_VALID (bwe->threshold_update))
+    bwe->threshold_update = now;
+
+  /* Don't let sudden spikes (e.g. a route change) drag the threshold up */
+  if (absmod > bwe->threshold + 15.0) {
+    bwe->threshold_update = now;
+    return;
+  }
+
+  k = absmod < bwe->threshold ? R_RTC_BWE_K_DOWN : R_RTC_BWE_K_UP;
+  dt = R_RTC_BWE_MS (now - bwe->threshold_update);
+  if (dt > 100.0)
+    dt = 100.0;
+  bwe->threshold += k * (absmod - bwe->threshold) * dt;
+  bwe->threshold = CLAMP (bwe->threshold,
+      R_RTC_BWE_THRESHOLD_MIN, R_RTC_BWE_THRESHOLD_MAX);
+  bwe->threshold_update = now;
+}
+
+static void
+r_rtc_bwe_detect (RRtcBwe * bwe, rdouble send_delta, RClockTime now)
+{
+  rdouble modified;
+
+  modified = MIN (bwe->num_deltas, R_RTC_BWE_TREND_DELTAS_MAX) *
+    bwe->trend * R_RTC_BWE_TREND_GAIN;
+
+  if (modified > bwe->threshold) {
+    if (bwe->overusing < 0.0)
+      bwe->overusing = send_delta / 2;
+    else
+      bwe->overusing += send_delta;
+    bwe->overuse_count++;
+    if (bwe->overusing > R_RTC_BWE_OVERUSE_TIME && bwe->overuse_count > 1 &&
+        bwe->trend >= bwe->prev_trend) {
+      bwe->overusing = 0.0;
+      bwe->overuse_count = 0;
+      bwe->usage = R_RTC_BWE_OVERUSE;
+    }
+  } else if (modified < -bwe->threshold) {
+    bwe->overusing = -1.0;
+    bwe->overuse_count = 0;
+    bwe->usage = R_RTC_BWE_UNDERUSE;
+  } else {
+    bwe->overusing = -1.0;
+    bwe->overuse_count = 0;
+    bwe->usage = R_RTC_BWE_NORMAL;
+  }
+
+  bwe->prev_trend = bwe->trend;
+  r_rtc_bwe_update_threshold (bwe, modified, now);
+}
+
+static void
+r_rtc_bwe_update_trendline (RRtcBwe * bwe, rdouble delay_delta,
+    rdouble send_delta, RClockTime arrival)
+{
+  rsize i;
+
+  if (bwe->num_deltas < 1000)
+    bwe->num_deltas++;
+  if (!R_CLOCK_TIME_IS_VALID (bwe->first_arrival))
+    bwe->first_arrival = arrival;
+
+  bwe->acc_delay += delay_delta;
+  bwe->smoothed_delay = R_RTC_BWE_SMOOTHING * bwe->smoothed_delay +
+    (1.0 - R_RTC_BWE_SMOOTHING) * bwe->acc_delay;
+
+  if (bwe->tl_count == R_RTC_BWE_TRENDLINE_WINDOW) {
+    r_memmove (bwe->tl_x, bwe->tl_x + 1, sizeof (bwe->tl_x) - sizeof (rdouble));
+    r_memmove (bwe->tl_y, bwe->tl_y + 1, sizeof (bwe->tl_y) - sizeof (rdouble));
+    bwe->tl_count--;
+  }
+  bwe->tl_x[bwe->tl_count] = R_RTC_BWE_MS (arrival - bwe->first_arrival);
+  bwe->tl_y[bwe->tl_count] = bwe->smoothed_delay;
+  bwe->tl_count++;
+
+  if (bwe->tl_count == R_RTC_BWE_TRENDLINE_WINDOW) {
+    rdouble xavg = 0.0, yavg = 0.0, num = 0.0, den = 0.0;
+
+    for (i = 0; i < bwe->tl_count; i++) {
+      xavg += bwe->tl_x[i];
+      yavg += bwe->tl_y[i];
+    }
+    xavg /= bwe->tl_count;
+    yavg /= bwe->tl_count;
+    for (i = 0; i < bwe->tl_count; i++) {
+      num += (bwe->tl_x[i] - xavg) * (bwe->tl_y[i] - yavg);
+      den += (bwe->tl_x[i] - xavg) * (bwe->tl_x[i] - xavg);
+    }
+    if (den != 0.0)
+      bwe->trend = num / den;
+  }
+
+  r_rtc_bwe_detect (bwe, send_delta, arrival);
+}
+
+static void
+r_rtc_bwe_add_packet (RRtcBwe * bwe, RClockTime sent, RClockTime arrival)
+{
+  if (R_CLOCK_TIME_IS_VALID (bwe->cur.first_send)) {
+    if (sent < bwe->cur.first_send + R_RTC_BWE_BURST) {
+      if (sent > bwe->cur.last_send)
+        bwe->cur.last_send = sent;
+      if (arrival > bwe->cur.last_arrival)
+        bwe->cur.last_arrival = arrival;
+      return;
+    }
+
+    /* New group: compare the completed one with its predecessor */
+    if (R_CLOCK_TIME_IS_VALID (bwe->prev.first_send) &&
+        bwe->cur.last_arrival >= bwe->prev.last_arrival) {
+      rdouble send_delta, arrival_delta;
+
+      send_delta = R_RTC_BWE_MS (bwe->cur.last_send - bwe->prev.last_send);
+      arrival_delta = R_RTC_BWE_MS (bwe->cur.last_arrival - bwe->prev.last_arrival);
+      r_rtc_bwe_update_trendline (bwe, arrival_delta - send_delta, send_delta,
+          bwe->cur.last_arrival);
+    }
+    bwe->prev = bwe->cur;
+  }
+
+  bwe->cur.first_send = bwe->cur.last_send = sent;
+  bwe->cur.last_arrival = arrival;
+}
+
+static void
+r_rtc_bwe_add_acked (RRtcBwe * bwe, rsize size, RClockTime arrival)
+{
+  RClockTime window;
+
+  if (!R_CLOCK_TIME_IS_VALID (bwe->acked_start)) {
+    bwe->acked_start = bwe->acked_last = arrival;
+    bwe->acked_bytes = 0;
+  }
+
+  bwe->acked_bytes += size;
+  if (arrival > bwe->acked_last)
+    bwe->acked_last = arrival;
+
+  window = bwe->acked_bps > 0.0 ? R_RTC_BWE_ACKED_WINDOW : R_RTC_BWE_ACKED_WINDOW_INIT;
+  if (bwe->acked_last - bwe->acked_start >= window) {
+    rdouble sample = (rdouble)bwe->acked_bytes * 8 * R_SECOND /
+      (rdouble)(bwe->acked_last - bwe->acked_start);
+
+    if (bwe->acked_bps > 0.0)
+      bwe->acked_bps = 0.8 * bwe->acked_bps + 0.2 * sample;
+    else
+      bwe->acked_bps = sample;
+    bwe->acked_start = bwe->acked_last;
+    bwe->acked_bytes = 0;
+  }
+}
+
+static void
+r_rtc_bwe_update_rate (RRtcBwe * bwe, rboolean loss_update, RClockTime now)
+{
+  rboolean can_decrease = !R_CLOCK_TIME_IS_VALID (bwe->last_decrease) ||
+    now >= bwe->last_decrease + R_RTC_BWE_DECREASE_INTERVAL;
+  RClockTime dt;
+
+  if (!R_CLOCK_TIME_IS_VALID (bwe->rate_update))
+    bwe->rate_update = now;
+  dt = MIN (now - bwe->rate_update, R_SECOND);
+  bwe->rate_update = now;
+
+  switch (bwe->usage) {
+    case R_RTC_BWE_OVERUSE:
+      if (can_decrease) {
+        rdouble target = R_RTC_BWE_BETA *
+          (bwe->acked_bps > 0.0 ? bwe->acked_bps : bwe->bitrate);
+        if (target < bwe->bitrate)
+          bwe->bitrate = target;
+        bwe->last_decrease = now;
+      }
+      break;
+    case R_RTC_BWE_NORMAL:
+      {
+        /* Don't run away from what the path has shown it can carry */
+        rdouble cap = bwe->acked_bps > 0.0 ?
+          1.5 * bwe->acked_bps + 10000.0 : bwe->max_bps;
+        if (bwe->bitrate < cap) {
+          bwe->bitrate *= 1.0 + R_RTC_BWE_INCREASE * dt / R_SECOND;
+          if (bwe->bitrate > cap)
+            bwe->bitrate = cap;
+        }
+      }
+      break;
+    case R_RTC_BWE_UNDERUSE:
+    default:
+      /* Hold while queues drain */
+      break;
+  }
+
+  if (loss_update && bwe->loss > R_RTC_BWE_LOSS_HIGH && can_decrease) {
+    bwe->bitrate *= 1.0 - 0.5 * bwe->loss;
+    bwe->last_decrease = now;
+  }
+
+  bwe->bitrate = CLAMP (bwe->bitrate, bwe->min_bps, bwe->max_bps);
+}
+
+RRtcError
+r_rtc_bwe_on_feedback (RRtcBwe * bwe, const RRTCPPacket * packet,
+    RClockTime now)
+{
+  RRTCPTWCCInfo info;
+  RClockTime * arrival;
+  rsize i, lost = 0, received = 0;
+
+  if (R_UNLIKELY (packet == NULL)) return R_RTC_INVAL;
+  if (R_UNLIKELY (!r_rtcp_packet_twcc_get_info (packet, &info))) return R_RTC_INVAL;
+  if (R_UNLIKELY ((arrival = r_malloc (info.count * sizeof (RClockTime))) == NULL))
+    return R_RTC_OOM;
+  if (r_rtcp_packet_twcc_get_arrivals (packet, arrival, info.count) != R_RTCP_PARSE_OK) {
+    r_free (arrival);
+    return R_RTC_INVAL;
+  }
+
+  for (i = 0; i < info.count; i++) {
+    ruint16 seq = (ruint16)(info.base_seq + i);
+    RRtcBweSentPacket * pkt = &bwe->history[seq % R_RTC_BWE_HISTORY];
+
+    /* Unknown, too old, or already reported */
+    if (pkt->seq != seq || !R_CLOCK_TIME_IS_VALID (pkt->sent))
+      continue;
+
+    if (R_CLOCK_TIME_IS_VALID (arrival[i])) {
+      r_rtc_bwe_add_packet (bwe, pkt->sent, arrival[i]);
+      r_rtc_bwe_add_acked (bwe, pkt->size, arrival[i]);
+      pkt->sent = R_CLOCK_TIME_NONE;
+      received++;
+    } else {
+      lost++;
+    }
+  }
+  r_free (arrival);
+
+  /* Only trust the loss fraction over a reasonable number of packets; at
+   * low rates a single report may cover just a handful. */
+  bwe->loss_lost += lost;
+  bwe->loss_total += lost + received;
+  if (bwe->loss_total >= R_RTC_BWE_LOSS_MIN_PACKETS) {
+    bwe->loss = (rdouble)bwe->loss_lost / bwe->loss_total;
+    bwe->loss_lost = bwe->loss_total = 0;
+    r_rtc_bwe_update_rate (bwe, TRUE, now);
+  } else {
+    r_rtc_bwe_update_rate (bwe, FALSE, now);
+  }
+
+  return R_RTC_OK;
+}
+
+ruint64
+r_rtc_bwe_get_bitrate (const RRtcBwe * bwe)
+{
+  return (ruint64)bwe->bitrate;
+}
+
+ruint64
+r_rtc_bwe_get_acked_bitrate (const RRtcBwe * bwe)
+{
+  return (ruint64)bwe->acked_bps;
+}
+
+rdouble
+r_rtc_bwe_get_loss (const RRtcBwe * bwe)
+{
+  return bwe->loss;
+}
+
+RRtcBweUsage
+r_rtc_bwe_get_usage (const RRtcBwe * bwe)
+{
+  return bwe->usage;
+}
+
+
+/* Never let the bucket hold less than one full-size packet, or a low rate
+ * would never release anything. */
+#define R_RTC_PACER_MIN_BUDGET      1500
+
+static void
+r_rtc_pacer_free (RRtcPacer * pacer)
+{
+  if (pacer->timer != NULL)
+    r_ev_loop_cancel_timer (pacer->loop, pacer->timer);
+  r_queue_list_clear (&pacer->queue, r_buffer_unref);
+  r_ev_loop_unref (pacer->loop);
+
+  if (pacer->notify != NULL)
+    pacer->notify (pacer->data);
+  r_free (pacer);
+}
+
+static rint64
+r_rtc_pacer_max_budget (const RRtcPacer * pacer)
+{
+  rint64 ret = (rint64)(pacer->bps * R_RTC_PACER_INTERVAL / (8 * R_SECOND));
+  return MAX (ret, R_RTC_PACER_MIN_BUDGET);
+}
+
+RRtcPacer *
+r_rtc_pacer_new (REvLoop * loop, ruint64 bps,
+    RRtcPacerSendFunc send, rpointer data, RDestroyNotify notify)
+{
+  RRtcPacer * ret;
+
+  if (R_UNLIKELY (loop == NULL)) return NULL;
+  if (R_UNLIKELY (send == NULL)) return NULL;
+
+  if ((ret = r_mem_new0 (RRtcPacer)) != NULL) {
+    r_ref_init (ret, r_rtc_pacer_free);
+
+    ret->loop = r_ev_loop_ref (loop);
+    ret->send = send;
+    ret->data = data;
+    ret->notify = notify;
+    ret->bps = bps;
+    ret->budget = r_rtc_pacer_max_budget (ret);
+    ret->last = r_clock_get_time (r_ev_loop_get_clock (loop));
+    r_queue_list_init (&ret->queue);
+  }
+
+  return ret;
+}
+
+static void r_rtc_pacer_tick (rpointer data, REvLoop * loop);
+
+static void
+r_rtc_pacer_process (RRtcPacer * pacer)
+{
+  RClockTime now = r_clock_get_time (r_ev_loop_get_clock (pacer->loop));
+  RBuffer * buf;
+
+  if (now > pacer->last) {
+    RClockTime elapsed = MIN (now - pacer->last, R_SECOND);
+    pacer->budget += (rint64)(pacer->bps * elapsed / (8 * R_SECOND));
+    pacer->budget = MIN (pacer->budget, r_rtc_pacer_max_budget (pacer));
+    pacer->last = now;
+  }
+
+  while (pacer->budget > 0 && (buf = r_queue_list_pop (&pacer->queue)) != NULL) {
+    rsize size = r_buffer_get_size (buf);
+
+    pacer->queue_bytes -= size;
+    pacer->budget -= size;
+    pacer->send (pacer->data, buf);
+    r_buffer_unref (buf);
+  }
+
+  if (pacer->queue.size > 0 && pacer->timer == NULL) {
+    r_ev_loop_add_callback_later (pacer->loop, &pacer->timer,
+        R_RTC_PACER_INTERVAL, r_rtc_pacer_tick, pacer, NULL);
+  }
+}
+
+static void
+r_rtc_pacer_tick (rpointer data, REvLoop * loop)
+{
+  RRtcPacer * pacer = data;
+
+  (void) loop;
+
+  pacer->timer = NULL;
+  r_rtc_pacer_process (pacer);
+}
+
+void
+r_rtc_pacer_set_bitrate (RRtcPacer * pacer, ruint64 bps)
+{
+  /* Settle the budget accrued at the old rate first */
+  r_rtc_pacer_process (pacer);
+  pacer->bps = bps;
+
+  if (bps == 0)
+    r_rtc_pacer_flush (pacer);
+}
+
+ruint64
+r_rtc_pacer_get_bitrate (const RRtcPacer * pacer)
+{
+  return pacer->bps;
+}
+
+RRtcError
+r_rtc_pacer_enqueue (RRtcPacer * pacer, RBuffer * buf)
+{
+  if (R_UNLIKELY (buf == NULL)) return R_RTC_INVAL;
+
+  if (pacer->bps == 0 && pacer->queue.size == 0)
+    return pacer->send (pacer->data, buf);
+
+  if (R_UNLIKELY (r_queue_list_push (&pacer->queue, r_buffer_ref (buf)) == NULL)) {
+    r_buffer_unref (buf);
+    return R_RTC_OOM;
+  }
+  pacer->queue_bytes += r_buffer_get_size (buf);
+
+  r_rtc_pacer_process (pacer);
+  return R_RTC_OK;
+}
+
+void
+r_rtc_pacer_flush (RRtcPacer * pacer)
+{
+  RBuffer * buf;
+
+  if (pacer->timer != NULL) {
+    r_ev_loop_cancel_timer (pacer->loop, pacer->timer);
+    pacer->timer = NULL;
+  }
+
+  while ((buf = r_queue_list_pop (&pacer->queue)) != NULL) {
+    pacer->queue_bytes -= r_buffer_get_size (buf);
+    pacer->send (pacer->data, buf);
+    r_buffer_unref (buf);
+  }
+}
+
+rsize
+r_rtc_pacer_get_queue_size (const RRtcPacer * pacer)
+{
+  return pacer->queue.size;
+}
+
+rsize
+r_rtc_pacer_get_queue_bytes (const RRtcPacer * pacer)
+{
+  return pacer->queue_bytes;
+}
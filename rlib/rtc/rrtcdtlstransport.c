@@ -281,6 +281,7 @@ r_rtc_crypto_transport_new_dtls (RRtcIceTransport * ice, RPrng * prng,
     NULL,
     NULL,
     NULL,
+    NULL,
   };
   static RTLSCallbacks cli_cbs = {
     NULL,
@@ -291,6 +292,7 @@ r_rtc_crypto_transport_new_dtls (RRtcIceTransport * ice, RPrng * prng,
     NULL,
     NULL,
     NULL,
+    NULL,
   };
 
   if (R_UNLIKELY (ice == NULL)) return NULL;
@@ -221,6 +221,8 @@ r_rtc_ice_transport_free (RRtcIceTransport * ice)
   r_hash_table_unref (ice->candidateSockets);
   r_hash_table_unref (ice->bindAddrs);
 
+  r_stun_binding_responder_free (ice->responder);
+  r_hmac_free (ice->rpwdhmac);
   r_free (ice->rpwd);
   r_free (ice->rufrag);
   r_free (ice->pwd);
@@ -246,6 +248,8 @@ r_rtc_ice_transport_new (
 
     ret->ufrag = r_strdup_size (ufrag, usize);
     ret->pwd = r_strdup_size (pwd, psize);
+    if (ret->pwd != NULL)
+      ret->responder = r_stun_binding_responder_new (ret->pwd, r_strlen (ret->pwd));
     ret->tiebreaker = r_rand_entropy_u64 ();
     ret->candidateSockets = r_hash_table_new_full (NULL, NULL,
         r_rtc_ice_candidate_unref, r_rtc_ice_udp_destroy);
@@ -376,25 +380,25 @@ r_rtc_ice_reply (const RRtcIceSrc * src, RBuffer * buf)
     r_ev_udp_send (src->udp, buf, src->addr, NULL, NULL, NULL);
 }
 
+/* Keepalives and checks are answered from the responder's template: only
+ * the transaction ID and XOR-MAPPED-ADDRESS change between responses. */
 static RBuffer *
 r_rtc_ice_transport_create_stun_response_binding (RRtcIceTransport * ice,
     RSocketAddress * addr, const ruint8 transaction_id[R_STUN_TRANSACTION_ID_SIZE])
 {
   RBuffer * ret;
 
-  if ((ret = r_buffer_new_alloc (NULL, 1024, NULL)) != NULL) {
+  if ((ret = r_buffer_new_alloc (NULL, R_STUN_BINDING_RESPONSE_MAX_SIZE, NULL)) != NULL) {
     RMemMapInfo info = R_MEM_MAP_INFO_INIT;
+    rsize size = 0;
 
     if (r_buffer_map (ret, &info, R_MEM_MAP_WRITE)) {
-      RStunMsgCtx ctx;
-      rsize size;
-
-      r_stun_msg_begin (&ctx, info.data, info.size,
-            R_STUN_CLASS_SUCCESS_RESPONSE, R_STUN_METHOD_BINDING, transaction_id);
-      r_stun_msg_add_xor_address (&ctx, R_STUN_ATTR_TYPE_XOR_MAPPED_ADDRESS, addr);
-      r_stun_msg_add_message_integrity_short_cred (&ctx, ice->pwd, r_strlen (ice->pwd));
-      size = r_stun_msg_end (&ctx, TRUE);
+      size = r_stun_binding_responder_build (ice->responder, info.data, info.size,
+          transaction_id, addr);
       r_buffer_unmap (ret, &info);
+    }
+
+    if (size > 0) {
       r_buffer_set_size (ret, size);
     } else {
       r_buffer_unref (ret);
@@ -568,7 +572,7 @@ r_rtc_ice_build_check (RRtcIceTransport * ice, RRtcIceCheckPair * pair)
         r_stun_msg_add_attribute (&ctx, &tlv);
       }
 
-      r_stun_msg_add_message_integrity_short_cred (&ctx, ice->rpwd, r_strlen (ice->rpwd));
+      r_stun_msg_add_message_integrity_hmac (&ctx, ice->rpwdhmac);
       size = r_stun_msg_end (&ctx, TRUE);
       r_buffer_unmap (ret, &info);
       r_buffer_set_size (ret, size);
@@ -1758,20 +1762,18 @@ r_rtc_ice_select_pair (RRtcIceTransport * ice, RRtcIceCheckPair * pair)
     ice->ready (ice->data, ice);
 }
 
-/* Verify a message's short-term-credential MESSAGE-INTEGRITY against @pwd
- * (our local password for inbound requests, the remote password for the
- * responses to our checks). */
+/* Find a message's short-term-credential MESSAGE-INTEGRITY attribute. Our
+ * local password keys inbound requests (ice->responder), the remote
+ * password the responses to our checks (ice->rpwdhmac). */
 static rboolean
-r_rtc_ice_check_integrity (rconstpointer msg, const rchar * pwd)
+r_rtc_ice_find_integrity (rconstpointer msg, RStunAttrTLV * tlv)
 {
-  RStunAttrTLV tlv = R_STUN_ATTR_TLV_INIT;
-
-  if (pwd == NULL || !r_stun_attr_tlv_first (msg, &tlv))
+  if (!r_stun_attr_tlv_first (msg, tlv))
     return FALSE;
   do {
-    if (tlv.type == R_STUN_ATTR_TYPE_MESSAGE_INTEGRITY)
-      return r_stun_msg_check_integrity_short_cred (msg, &tlv, pwd, r_strlen (pwd));
-  } while (r_stun_attr_tlv_next (msg, &tlv));
+    if (tlv->type == R_STUN_ATTR_TYPE_MESSAGE_INTEGRITY)
+      return TRUE;
+  } while (r_stun_attr_tlv_next (msg, tlv));
 
   return FALSE;
 }
@@ -1804,7 +1806,8 @@ r_rtc_ice_handle_binding_request (RRtcIceTransport * ice, rconstpointer msg,
   RBuffer * outbuf;
 
   /* The peer keys its requests with our local password. */
-  if (!r_rtc_ice_check_integrity (msg, ice->pwd)) {
+  if (!r_rtc_ice_find_integrity (msg, &tlv) ||
+      !r_stun_binding_responder_check_integrity (ice->responder, msg, &tlv)) {
     R_LOG_WARNING ("RtcIceTransport %p check request failed integrity", ice);
     return;
   }
@@ -1912,6 +1915,7 @@ r_rtc_ice_handle_binding_response (RRtcIceTransport * ice, rconstpointer msg,
     const RSocketAddress * from)
 {
   const ruint8 * tid = r_stun_msg_transaction_id (msg);
+  RStunAttrTLV tlv = R_STUN_ATTR_TLV_INIT;
   rsize i, c;
 
   rboolean err = r_stun_msg_is_err_resp (msg);
@@ -1921,7 +1925,8 @@ r_rtc_ice_handle_binding_response (RRtcIceTransport * ice, rconstpointer msg,
     return;
 
   /* The response is keyed with the peer's password (our remote pwd). */
-  if (!r_rtc_ice_check_integrity (msg, ice->rpwd)) {
+  if (!r_rtc_ice_find_integrity (msg, &tlv) ||
+      !r_stun_msg_check_integrity_hmac (msg, &tlv, ice->rpwdhmac)) {
     R_LOG_WARNING ("RtcIceTransport %p check response failed integrity", ice);
     return;
   }
@@ -2769,8 +2774,10 @@ r_rtc_ice_transport_set_remote_credentials (RRtcIceTransport * ice,
 
   r_free (ice->rufrag);
   r_free (ice->rpwd);
+  r_hmac_free (ice->rpwdhmac);
   ice->rufrag = r_strdup_size (ufrag, usize);
   ice->rpwd = r_strdup_size (pwd, psize);
+  ice->rpwdhmac = r_hmac_new (R_MSG_DIGEST_TYPE_SHA1, ice->rpwd, r_strlen (ice->rpwd));
   return R_RTC_OK;
 }
 
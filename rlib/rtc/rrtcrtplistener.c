@@ -65,70 +65,16 @@ r_rtc_rtp_listener_new (void)
   return ret;
 }
 
-/* Locate the RFC 8285 header-extension element with id @id and return
- * its value pointer / length. Handles both the one-byte (0xBEDE) and
- * two-byte (0x100n) profiles. */
-static rboolean
-r_rtc_rtp_ext_element (const RRTPBuffer * rtp, ruint16 id,
-    const ruint8 ** out, rsize * outsize)
-{
-  ruint16 profile, size;
-  const ruint8 * data;
-  rsize p = 0;
-
-  if (id == 0 || !r_rtp_buffer_get_extension (rtp, &profile, &data, &size))
-    return FALSE;
-
-  if (profile == 0xBEDE) {
-    while (p < size) {
-      ruint8 eid = data[p] >> 4;
-      ruint8 elen = (data[p] & 0x0F) + 1;
-      p++;
-      if (eid == 0)             /* padding */
-        continue;
-      if (eid == 15)            /* reserved: stop parsing (RFC 8285 4.2) */
-        break;
-      if (p + elen > size)
-        break;
-      if (eid == id) {
-        *out = data + p;
-        *outsize = elen;
-        return TRUE;
-      }
-      p += elen;
-    }
-  } else if ((profile & 0xFFF0) == 0x1000) {
-    while (p < size) {
-      ruint8 eid = data[p++];
-      ruint8 elen;
-      if (eid == 0)             /* padding */
-        continue;
-      if (p >= size)            /* truncated: missing length octet */
-        break;
-      elen = data[p++];
-      if (p + elen > size)
-        break;
-      if (eid == id) {
-        *out = data + p;
-        *outsize = elen;
-        return TRUE;
-      }
-      p += elen;
-    }
-  }
-
-  return FALSE;
-}
-
 /* Read the RID carried in header extension @extid into @rid (>= R_RTC_RID_MAX
  * + 1 bytes). Returns FALSE if absent or too long to name an encoding. */
 static rboolean
 r_rtc_rtp_listener_read_rid (const RRTPBuffer * rtp, ruint16 extid, rchar * rid)
 {
-  const ruint8 * val;
+  ruint8 * val;
   rsize len;
 
-  if (extid == 0 || !r_rtc_rtp_ext_element (rtp, extid, &val, &len) ||
+  if (extid == 0 || extid > 0xff ||
+      !r_rtp_buffer_get_hdrext_element (rtp, (ruint8)extid, &val, &len) ||
       len > R_RTC_RID_MAX)
     return FALSE;
 
@@ -223,11 +169,12 @@ r_rtc_rtp_listener_handle_rtp (RRtcRtpListener * l,
      * subsequent packets take the fast path above. */
     r = NULL;
     if (l->recv_mid_ext_id != 0 && r_hash_table_size (l->recv_extmap) > 0) {
-      const ruint8 * mid;
+      ruint8 * mid;
       rsize midsize;
 
-      if (r_rtc_rtp_ext_element (&rtp, l->recv_mid_ext_id, &mid, &midsize) &&
-          midsize < 256) {
+      if (l->recv_mid_ext_id <= 0xff &&
+          r_rtp_buffer_get_hdrext_element (&rtp, (ruint8)l->recv_mid_ext_id,
+              &mid, &midsize) && midsize < 256) {
         rchar key[256];
 
         r_memcpy (key, mid, midsize);
@@ -279,7 +226,7 @@ r_rtc_rtp_listener_collect_sender (RRtcRtpListener * l, ruint32 ssrc,
     return;
   if ((s = r_hash_table_lookup (l->send_ssrcmap, RSIZE_TO_POINTER (ssrc))) == NULL)
     return;
-  if (s->cbs.rtcp == NULL)
+  if (s->cbs.rtcp == NULL && s->bwe == NULL)
     return;
   if (r_ptr_array_find (targets, s) != R_PTR_ARRAY_INVALID_IDX)
     return;
@@ -513,7 +460,7 @@ r_rtc_rtp_listener_handle_rtcp (RRtcRtpListener * l,
       RRtcRtpSender * s = r_ptr_array_get (targets, i);
       RBuffer * sbuf = r_ptr_array_get (sbufs, i);
       if (sbuf != NULL) {
-        s->cbs.rtcp (s->data, sbuf, s);
+        r_rtc_rtp_sender_handle_rtcp (s, sbuf);
         r_buffer_unref (sbuf);
       }
     }
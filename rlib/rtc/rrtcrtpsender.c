@@ -28,6 +28,12 @@
 static void
 r_rtc_rtp_sender_free (RRtcRtpSender * s)
 {
+  if (s->pacer != NULL)
+    r_rtc_pacer_unref (s->pacer);
+  if (s->bwe != NULL)
+    r_rtc_bwe_unref (s->bwe);
+  if (s->loop != NULL)
+    r_ev_loop_unref (s->loop);
   r_rtc_crypto_transport_unref (s->rtp);
   r_rtc_crypto_transport_unref (s->rtcp);
 
@@ -82,6 +88,93 @@ r_rtc_rtp_sender_get_mid (RRtcRtpSender * s)
   return s->mid;
 }
 
+/* Last stop before the wire for RTP: stamp the transport-wide sequence
+ * number as late as possible so it follows the order packets really leave.
+ * r_rtc_rtp_sender_send already turned away packets without the element. */
+static RRtcError
+r_rtc_rtp_sender_transmit (rpointer data, RBuffer * packet)
+{
+  RRtcRtpSender * s = data;
+
+  if (s->bwe != NULL) {
+    RRTPBuffer rtp = R_RTP_BUFFER_INIT;
+    rboolean stamped = FALSE;
+
+    if (r_rtp_buffer_map (&rtp, packet, R_MEM_MAP_WRITE)) {
+      stamped = r_rtp_buffer_set_transport_cc (&rtp, s->twcc_id, s->twcc_seq);
+      r_rtp_buffer_unmap (&rtp, packet);
+    }
+    if (stamped) {
+      r_rtc_bwe_on_packet_sent (s->bwe, s->twcc_seq++,
+          r_buffer_get_size (packet), r_clock_get_time (r_ev_loop_get_clock (s->loop)));
+    }
+  }
+
+  return r_rtc_crypto_transport_send (s->rtp, packet);
+}
+
+RRtcError
+r_rtc_rtp_sender_enable_congestion_control (RRtcRtpSender * s,
+    ruint8 twcc_id, ruint64 start_bps, ruint64 min_bps, ruint64 max_bps)
+{
+  RRtcBwe * bwe;
+
+  if (R_UNLIKELY (twcc_id == 0 || twcc_id >= 15)) return R_RTC_INVAL;
+  if (R_UNLIKELY (s->params != NULL)) return R_RTC_WRONG_STATE;
+  if (R_UNLIKELY ((bwe = r_rtc_bwe_new (start_bps, min_bps, max_bps)) == NULL))
+    return R_RTC_INVAL;
+
+  if (s->bwe != NULL)
+    r_rtc_bwe_unref (s->bwe);
+  s->bwe = bwe;
+  s->twcc_id = twcc_id;
+
+  return R_RTC_OK;
+}
+
+RRtcBwe *
+r_rtc_rtp_sender_get_bwe (RRtcRtpSender * s)
+{
+  return s->bwe != NULL ? r_rtc_bwe_ref (s->bwe) : NULL;
+}
+
+ruint64
+r_rtc_rtp_sender_get_pacing_bitrate (RRtcRtpSender * s)
+{
+  return s->pacer != NULL ? r_rtc_pacer_get_bitrate (s->pacer) : 0;
+}
+
+void
+r_rtc_rtp_sender_handle_rtcp (RRtcRtpSender * s, RBuffer * buf)
+{
+  if (s->bwe != NULL && s->loop != NULL) {
+    RRTCPBuffer rtcp = R_RTCP_BUFFER_INIT;
+    RRTCPPacket * packet;
+    rboolean updated = FALSE;
+
+    if (r_rtcp_buffer_map (&rtcp, buf, R_MEM_MAP_READ)) {
+      RClockTime now = r_clock_get_time (r_ev_loop_get_clock (s->loop));
+
+      for (packet = r_rtcp_buffer_get_first_packet (&rtcp); packet != NULL;
+          packet = r_rtcp_buffer_get_next_packet (&rtcp, packet)) {
+        if (r_rtcp_packet_get_type (packet) == R_RTCP_PT_RTPFB &&
+            r_rtcp_packet_fb_get_fmt (packet) == R_RTCP_RTPFB_FMT_TWCC &&
+            r_rtc_bwe_on_feedback (s->bwe, packet, now) == R_RTC_OK)
+          updated = TRUE;
+      }
+      r_rtcp_buffer_unmap (&rtcp, buf);
+    }
+
+    if (updated && s->pacer != NULL) {
+      r_rtc_pacer_set_bitrate (s->pacer,
+          r_rtc_bwe_get_bitrate (s->bwe) * R_RTC_PACER_FACTOR / 100);
+    }
+  }
+
+  if (s->cbs.rtcp != NULL)
+    s->cbs.rtcp (s->data, buf, s);
+}
+
 RRtcError
 r_rtc_rtp_sender_start (RRtcRtpSender * s,
     RRtcRtpParameters * params, REvLoop * loop)
@@ -90,7 +183,19 @@ r_rtc_rtp_sender_start (RRtcRtpSender * s,
   if (R_UNLIKELY (loop == NULL)) return R_RTC_INVAL;
   if (R_UNLIKELY (s->params != NULL)) return R_RTC_WRONG_STATE;
 
+  if (s->bwe != NULL) {
+    RRtcPacer * pacer = r_rtc_pacer_new (loop,
+        r_rtc_bwe_get_bitrate (s->bwe) * R_RTC_PACER_FACTOR / 100,
+        r_rtc_rtp_sender_transmit, s, NULL);
+    if (R_UNLIKELY (pacer == NULL))
+      return R_RTC_OOM;
+    s->pacer = pacer;
+  }
+
   s->params = r_rtc_rtp_parameters_ref (params);
+  if (s->loop != NULL)
+    r_ev_loop_unref (s->loop);
+  s->loop = r_ev_loop_ref (loop);
 
   r_rtc_crypto_transport_add_sender (s->rtp, s);
   r_rtc_crypto_transport_update_sender (s->rtp, s, params);
@@ -113,6 +218,12 @@ r_rtc_rtp_sender_stop (RRtcRtpSender * s)
   r_rtc_rtp_parameters_unref (s->params);
   s->params = NULL;
 
+  if (s->pacer != NULL) {
+    r_rtc_pacer_flush (s->pacer);
+    r_rtc_pacer_unref (s->pacer);
+    s->pacer = NULL;
+  }
+
   if (s->rtp != s->rtcp)
     r_rtc_crypto_transport_remove_sender (s->rtcp, s);
   return r_rtc_crypto_transport_remove_sender (s->rtp, s);
@@ -122,7 +233,7 @@ RRtcError
 r_rtc_rtp_sender_send (RRtcRtpSender * s, RBuffer * packet)
 {
   RMemMapInfo info = R_MEM_MAP_INFO_INIT;
-  RRtcCryptoTransport * tx;
+  rboolean rtcp = FALSE;
 
   if (R_UNLIKELY (packet == NULL)) return R_RTC_INVAL;
 
@@ -131,13 +242,30 @@ r_rtc_rtp_sender_send (RRtcRtpSender * s, RBuffer * packet)
    * without rtcp-mux they're separate (own UDP socket, own DTLS) and
    * pushing RTCP through the RTP transport would send it to the wrong
    * peer endpoint. */
-  tx = s->rtp;
   if (r_buffer_map (packet, &info, R_MEM_MAP_READ)) {
-    if (r_rtcp_is_valid_hdr (info.data, info.size))
-      tx = s->rtcp;
+    rtcp = r_rtcp_is_valid_hdr (info.data, info.size);
     r_buffer_unmap (packet, &info);
   }
 
-  return r_rtc_crypto_transport_send (tx, packet);
+  /* RTCP isn't paced nor counted towards the transport-wide sequence */
+  if (rtcp)
+    return r_rtc_crypto_transport_send (s->rtcp, packet);
+
+  /* A packet without the element would go out unseen by the estimator */
+  if (s->bwe != NULL) {
+    RRTPBuffer rtp = R_RTP_BUFFER_INIT;
+    ruint16 seq;
+    rboolean slot = FALSE;
+
+    if (r_rtp_buffer_map (&rtp, packet, R_MEM_MAP_READ)) {
+      slot = r_rtp_buffer_get_transport_cc (&rtp, s->twcc_id, &seq);
+      r_rtp_buffer_unmap (&rtp, packet);
+    }
+    if (!slot)
+      return R_RTC_INVAL;
+  }
+  if (s->pacer != NULL)
+    return r_rtc_pacer_enqueue (s->pacer, packet);
+  return r_rtc_rtp_sender_transmit (s, packet);
 }
 
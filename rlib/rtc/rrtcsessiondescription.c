@@ -23,6 +23,7 @@
 
 #include <rlib/rassert.h>
 #include <rlib/rbase64.h>
+#include <rlib/rcrc.h>
 #include <rlib/rmem.h>
 #include <rlib/rstr.h>
 
@@ -713,14 +714,21 @@ r_rtc_session_description_parse_sdp_mline (RRtcSessionDescription * sd,
     if (!bundled || r_str_chunk_split (&bundlegroup, " ", &trans, NULL) < 1)
       r_memcpy (&trans, mid, sizeof (RStrChunk));
   } else {
-    /* FIXME: Better way of generating some form of random??? */
-    rsize hash, hashsize;
-    if (r_sdp_media_buf_attrib_count (media) > 0)
-      hashsize = media->attrib[media->acount - 1].val.str - media->type.str;
-    else
+    /* Derive the mid from a CRC32 of the media section; unlike the seeded
+     * table hash it gives the same mid for the same offer on every run. */
+    ruint8 crc[sizeof (ruint32)];
+    rsize hashsize;
+    if (r_sdp_media_buf_attrib_count (media) > 0) {
+      /* Up to the end of the last attribute; flags like a=sendrecv have no value. */
+      const RStrKV * last = &media->attrib[media->acount - 1];
+      if (last->val.str != NULL)
+        hashsize = (last->val.str + last->val.size) - media->type.str;
+      else
+        hashsize = (last->key.str + last->key.size) - media->type.str;
+    } else
       hashsize = r_str_idx_of_c (media->type.str, -1, '\n');
-    hash = r_str_hash_sized (media->type.str, hashsize);
-    midchunk.str = r_base64_encode_dup (RSIZE_TO_POINTER (hash), sizeof (rsize), &midchunk.size);
+    r_store_be32 (crc, r_crc32 (media->type.str, hashsize));
+    midchunk.str = r_base64_encode_dup (crc, sizeof (crc), &midchunk.size);
     mid = &midchunk;
     r_memcpy (&trans, mid, sizeof (RStrChunk));
     bundled = FALSE;
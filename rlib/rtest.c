@@ -219,6 +219,20 @@ r_test_init (void)
     r_log_category_set_threshold (R_LOG_CAT_DEFAULT, R_LOG_LEVEL_ERROR);
 }
 
+const RTest *
+r_test_get_current (rsize * __i)
+{
+  const RTestRun * run;
+
+  if (g__r_test_current_report == NULL)
+    return NULL;
+
+  run = &g__r_test_current_report->runs[g__r_test_current_run_idx];
+  if (__i != NULL)
+    *__i = run->__i;
+  return run->test;
+}
+
 #define R_TEST_DUMP_RECENT 10
 
 /* Print the in-progress report to f: counts, the test currently running
@@ -1128,7 +1142,13 @@ _r_test_run_body (const RTest * test, rsize __i, RTestRunNoForkCtx * ctx)
 {
   _r_test_mark_position (test->name, (ruint)__i, test->suite, FALSE);
   if (test->setup != NULL)    test->setup (test->fdata);
-  test->func (__i, test->fdata);
+  if (test->type & R_TEST_FLAG_BENCH) {
+    r_test_bench_perf_begin ();
+    test->func (__i, test->fdata);
+    r_test_bench_perf_end ();
+  } else {
+    test->func (__i, test->fdata);
+  }
   if (test->teardown != NULL) test->teardown (test->fdata);
 
   return (ctx->failpos != NULL) ? R_TEST_RUN_STATE_FAILED
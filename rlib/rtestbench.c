@@ -0,0 +1,997 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2015-2018 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+
+#include "config.h"
+#include "rlib-private.h"
+#include <rlib/rtest.h>
+
+#include <rlib/concurrency/rthreads.h>
+#include <rlib/data/rbitset.h>
+#include <rlib/data/rhashtable.h>
+#include <rlib/data/rstring.h>
+#include <rlib/file/rfile.h>
+#include <rlib/file/rfs.h>
+#include <rlib/format/rjson.h>
+#include <rlib/format/rjsonwriter.h>
+#include <rlib/os/rsys.h>
+#include <rlib/os/rtty.h>
+#include <rlib/rmem.h>
+#include <rlib/rstr.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+#if defined (R_ARCH_X86_64) || defined (R_ARCH_X86)
+#if defined (_MSC_VER)
+#include <intrin.h>
+#define R_TEST_BENCH_CYCLES()         __rdtsc ()
+#else
+#define R_TEST_BENCH_CYCLES()         __builtin_ia32_rdtsc ()
+#endif
+#else
+#define R_TEST_BENCH_CYCLES()         0
+#endif
+
+#define R_TEST_BENCH_ITERS_MAX        (RUINT64_CONSTANT (1) << 40)
+/* Counters reported next to the times; cycles go in their own column */
+#define R_TEST_BENCH_PERF_MASK        (R_PERF_COUNTER_MASK_ALL & \
+    ~R_PERF_COUNTER_BIT (R_PERF_COUNTER_CYCLES))
+
+typedef struct {
+  rchar * test;
+  rchar * label;
+  RTestBenchResult res;
+} RTestBenchEntry;
+
+typedef struct {
+  RTestBenchEntry * entries;
+  rsize count;
+  rsize alloc;
+} RTestBenchEntries;
+
+static RTestBenchConfig g__r_test_bench_config = R_TEST_BENCH_CONFIG_INIT;
+static RTestBenchFormat g__r_test_bench_format = R_TEST_BENCH_FORMAT_JSON;
+static rchar * g__r_test_bench_output = NULL;
+static rchar * g__r_test_bench_baseline = NULL;
+static rdouble g__r_test_bench_threshold = R_TEST_BENCH_THRESHOLD_DEFAULT;
+/* Results are appended here, one line each, so that forked tests can hand
+ * them back to the runner. NULL while nothing is being collected. */
+static rchar * g__r_test_bench_spool = NULL;
+/* Counters are per thread. r_test_bench_run and the whole RTEST_BENCH
+ * body each get their own group since the former nests in the latter. */
+static RTss g__r_test_bench_perf_run = R_TSS_INIT (r_ref_unref);
+static RTss g__r_test_bench_perf_body = R_TSS_INIT (r_ref_unref);
+
+void
+r_test_bench_get_config (RTestBenchConfig * config)
+{
+  *config = g__r_test_bench_config;
+}
+
+void
+r_test_bench_set_config (const RTestBenchConfig * config)
+{
+  g__r_test_bench_config = *config;
+}
+
+static int
+r_test_bench_cmp_double (const void * a, const void * b)
+{
+  rdouble x = *(const rdouble *)a, y = *(const rdouble *)b;
+  return (x > y) - (x < y);
+}
+
+/* Linearly interpolated quantile of n sorted values */
+static rdouble
+r_test_bench_quantile (const rdouble * sorted, rsize n, rdouble q)
+{
+  rdouble pos = q * (rdouble)(n - 1);
+  rsize lo = (rsize)pos;
+
+  if (lo + 1 >= n)
+    return sorted[n - 1];
+  return sorted[lo] + (sorted[lo + 1] - sorted[lo]) * (pos - (rdouble)lo);
+}
+
+static RPerfCounters *
+r_test_bench_perf_get (RTss * tss)
+{
+  RPerfCounters * pc;
+
+  if ((pc = r_tss_get (tss)) == NULL &&
+      (pc = r_perf_counters_new (R_PERF_COUNTER_MASK_ALL)) != NULL)
+    r_tss_set (tss, pc);
+
+  return pc;
+}
+
+/* Counters are started and stopped outside of the timed region */
+static RClockTime
+r_test_bench_sample (RTestBenchFunc func, rpointer data, ruint64 iters,
+    ruint64 * cycles, RPerfCounters * pc, RPerfSample * perf)
+{
+  RClockTime start;
+  ruint64 c;
+
+  if (pc != NULL)
+    r_perf_counters_start (pc);
+  c = R_TEST_BENCH_CYCLES ();
+  start = r_time_get_ts_monotonic ();
+  func (data, iters);
+  start = r_time_get_ts_monotonic () - start;
+  *cycles = R_TEST_BENCH_CYCLES () - c;
+  if (pc != NULL && r_perf_counters_stop (pc, perf) &&
+      r_perf_sample_has (perf, R_PERF_COUNTER_CYCLES))
+    *cycles = perf->value[R_PERF_COUNTER_CYCLES];
+
+  return start;
+}
+
+/* Smallest power-of-ten-ish iteration count that makes one sample last
+ * at least target; doubles as the first warmup. */
+static ruint64
+r_test_bench_calibrate (RTestBenchFunc func, rpointer data, RClockTime target)
+{
+  ruint64 iters = 1, next, cycles;
+  RClockTime elapsed;
+
+  while (iters < R_TEST_BENCH_ITERS_MAX &&
+      (elapsed = r_test_bench_sample (func, data, iters, &cycles, NULL, NULL)) < target) {
+    if (elapsed == 0)
+      next = iters * 100;
+    else
+      next = (ruint64)((rdouble)iters * 1.2 * (rdouble)target / (rdouble)elapsed);
+    iters = CLAMP (next, iters + 1, iters * 100);
+  }
+
+  return MIN (iters, R_TEST_BENCH_ITERS_MAX);
+}
+
+static void
+r_test_bench_stats (RTestBenchResult * res, rdouble * ns, rdouble * cyc)
+{
+  rdouble q1, q3, lo, hi, sum = 0.0, sq = 0.0;
+  rsize i, n = res->reps, kept = 0;
+
+  qsort (ns, n, sizeof (rdouble), r_test_bench_cmp_double);
+  res->min = ns[0];
+  res->median = r_test_bench_quantile (ns, n, 0.5);
+  res->p95 = r_test_bench_quantile (ns, n, 0.95);
+
+  q1 = r_test_bench_quantile (ns, n, 0.25);
+  q3 = r_test_bench_quantile (ns, n, 0.75);
+  lo = q1 - 1.5 * (q3 - q1);
+  hi = q3 + 1.5 * (q3 - q1);
+  for (i = 0; i < n; i++) {
+    if (ns[i] < lo || ns[i] > hi)
+      continue;
+    sum += ns[i];
+    kept++;
+  }
+  res->outliers = (ruint)(n - kept);
+  res->mean = sum / (rdouble)kept;
+  for (i = 0; i < n; i++) {
+    if (ns[i] >= lo && ns[i] <= hi)
+      sq += (ns[i] - res->mean) * (ns[i] - res->mean);
+  }
+  res->stddev = kept > 1 ? sqrt (sq / (rdouble)(kept - 1)) : 0.0;
+
+  qsort (cyc, n, sizeof (rdouble), r_test_bench_cmp_double);
+  res->cycles = r_test_bench_quantile (cyc, n, 0.5);
+}
+
+static void
+r_test_bench_perf_result (RTestBenchResult * res, const RPerfSample * total)
+{
+  rdouble n = (rdouble)res->iters * res->reps;
+
+  res->perf = total->valid & R_TEST_BENCH_PERF_MASK;
+  res->instructions = total->value[R_PERF_COUNTER_INSTRUCTIONS] / n;
+  res->cache_misses = total->value[R_PERF_COUNTER_CACHE_MISSES] / n;
+  res->branch_misses = total->value[R_PERF_COUNTER_BRANCH_MISSES] / n;
+  res->ctxswitches = total->value[R_PERF_COUNTER_CONTEXT_SWITCHES];
+}
+
+/* ", 12.3 instructions/op (2.10 IPC), 0.01 cache-misses/op, ..." */
+static void
+r_test_bench_perf_append (RString * str, const RPerfSample * s, rdouble n)
+{
+  const rchar * per = n > 1.0 ? "/op" : "";
+  ruint i;
+
+  for (i = 0; i < R_PERF_COUNTER_COUNT; i++) {
+    if (!r_perf_sample_has (s, i))
+      continue;
+
+    if (i == R_PERF_COUNTER_CONTEXT_SWITCHES || n <= 1.0) {
+      r_string_append_printf (str, ", %"RUINT64_FMT" %s",
+          s->value[i], r_perf_counter_name (i));
+    } else {
+      r_string_append_printf (str, ", %.2f %s%s",
+          s->value[i] / n, r_perf_counter_name (i), per);
+    }
+    if (i == R_PERF_COUNTER_INSTRUCTIONS && r_perf_sample_ipc (s) > 0.0)
+      r_string_append_printf (str, " (%.2f IPC)", r_perf_sample_ipc (s));
+  }
+}
+
+static void
+r_test_bench_print (const rchar * label, const RTestBenchResult * res)
+{
+  RClockTime total = (RClockTime)(res->mean * (rdouble)res->iters * res->reps);
+  rchar extra[64] = "";
+
+  if (res->bytes > 0) {
+    r_snprintf (extra, sizeof (extra), ", %.1f MiB/s",
+        (rdouble)res->bytes * R_SECOND / res->median / (1024.0 * 1024.0));
+  } else if (res->cycles > 0.0) {
+    r_snprintf (extra, sizeof (extra), ", %.1f cycles/op", res->cycles);
+  }
+
+  r_print ("%"R_TIME_FORMAT"  %s: %.1f ns/op median%s "
+      "(p95 %.1f, min %.1f, sd %.1f, %u outliers; %"RUINT64_FMT" iters x %u)\n",
+      R_TIME_ARGS (total), label, res->median, extra,
+      res->p95, res->min, res->stddev, res->outliers, res->iters, res->reps);
+}
+
+static void
+r_test_bench_print_perf (const rchar * what, const RPerfSample * s, rdouble n)
+{
+  RString * str;
+  rchar * line;
+
+  if ((str = r_string_new_sized (128)) == NULL)
+    return;
+
+  r_test_bench_perf_append (str, s, n);
+  line = r_string_free_keep (str);
+  /* Skip the leading ", " */
+  r_print ("%"R_TIME_FORMAT"    %s: %s\n", R_TIME_ARGS (0), what,
+      line[0] != 0 ? line + 2 : "n/a");
+  r_free (line);
+}
+
+void
+r_test_bench_perf_begin (void)
+{
+  RPerfCounters * pc;
+
+  if ((pc = r_test_bench_perf_get (&g__r_test_bench_perf_body)) != NULL)
+    r_perf_counters_start (pc);
+}
+
+void
+r_test_bench_perf_end (void)
+{
+  RPerfCounters * pc;
+  RPerfSample s;
+
+  if ((pc = r_tss_get (&g__r_test_bench_perf_body)) != NULL &&
+      r_perf_counters_stop (pc, &s))
+    r_test_bench_print_perf ("perf, whole test", &s, 1.0);
+}
+
+rboolean
+r_test_bench_run (const rchar * label, RTestBenchFunc func, rpointer data,
+    rsize bytes, RTestBenchResult * result)
+{
+  RTestBenchConfig * cfg = &g__r_test_bench_config;
+  RTestBenchResult res;
+  RBitset * oldaff = NULL;
+  RPerfCounters * pc, * body;
+  RPerfSample perf, total;
+  rdouble * ns, * cyc;
+  ruint64 cycles;
+  rboolean paused;
+  ruint i;
+
+  if (R_UNLIKELY (func == NULL || cfg->reps == 0)) return FALSE;
+
+  if (cfg->cpu >= 0) {
+    RBitset * cpuset;
+    ruint max = r_sys_cpuset_max ();
+
+    if ((ruint)cfg->cpu < max &&
+        r_bitset_init_heap (oldaff, max) && r_bitset_init_stack (cpuset, max) &&
+        r_thread_get_affinity (r_thread_current (), oldaff) &&
+        r_bitset_set_bit (cpuset, (rsize)cfg->cpu, TRUE) &&
+        r_thread_set_affinity (r_thread_current (), cpuset)) {
+      r_thread_yield ();
+    } else {
+      r_free (oldaff);
+      oldaff = NULL;
+    }
+  }
+
+  r_memset (&res, 0, sizeof (res));
+  res.iters = r_test_bench_calibrate (func, data, cfg->target);
+  res.reps = cfg->reps;
+  res.bytes = bytes;
+
+  for (i = 0; i < cfg->warmup; i++)
+    r_test_bench_sample (func, data, res.iters, &cycles, NULL, NULL);
+
+  /* Both groups at once would have the PMU multiplex the per-op counts;
+   * the whole test counters sit out the measured repetitions instead. */
+  body = r_tss_get (&g__r_test_bench_perf_body);
+  paused = r_perf_counters_pause (body);
+  pc = r_test_bench_perf_get (&g__r_test_bench_perf_run);
+  r_memset (&total, 0, sizeof (total));
+  total.valid = r_perf_counters_get_mask (pc);
+  ns = r_mem_new_n (rdouble, res.reps);
+  cyc = r_mem_new_n (rdouble, res.reps);
+  for (i = 0; i < res.reps; i++) {
+    ns[i] = (rdouble)r_test_bench_sample (func, data, res.iters, &cycles,
+        pc, &perf) / (rdouble)res.iters;
+    cyc[i] = (rdouble)cycles / (rdouble)res.iters;
+    if (pc != NULL)
+      r_perf_sample_add (&total, &perf);
+  }
+  if (paused)
+    r_perf_counters_resume (body);
+  r_test_bench_stats (&res, ns, cyc);
+  r_test_bench_perf_result (&res, &total);
+  r_free (ns);
+  r_free (cyc);
+
+  if (oldaff != NULL) {
+    r_thread_set_affinity (r_thread_current (), oldaff);
+    r_free (oldaff);
+  }
+
+  r_test_bench_print (label, &res);
+  if (total.valid != 0)
+    r_test_bench_print_perf ("perf", &total, (rdouble)res.iters * res.reps);
+  r_test_bench_record (label, &res);
+  if (result != NULL)
+    *result = res;
+  return TRUE;
+}
+
+/* Results file columns; the spool uses the same order. The first
+ * R_TEST_BENCH_COLUMNS_BASE are always set, the perf ones may be empty. */
+static const rchar * g__r_test_bench_columns[] = {
+  "test", "label", "iters", "reps", "outliers", "bytes",
+  "min_ns", "median_ns", "p95_ns", "mean_ns", "stddev_ns", "cycles",
+  "instructions", "ipc", "cache_misses", "branch_misses", "context_switches",
+};
+#define R_TEST_BENCH_COLUMNS_BASE     12
+
+static rdouble
+r_test_bench_result_ipc (const RTestBenchResult * res)
+{
+  return (res->cycles > 0.0 &&
+      (res->perf & R_PERF_COUNTER_BIT (R_PERF_COUNTER_INSTRUCTIONS)) != 0) ?
+    res->instructions / res->cycles : 0.0;
+}
+
+/* The perf columns of a spool or CSV line, empty when not measured */
+static void
+r_test_bench_fprint_perf (FILE * f, rchar sep, const RTestBenchResult * res)
+{
+  if (res->perf & R_PERF_COUNTER_BIT (R_PERF_COUNTER_INSTRUCTIONS)) {
+    r_fprintf (f, "%c%.17g%c", sep, res->instructions, sep);
+    if (r_test_bench_result_ipc (res) > 0.0)
+      r_fprintf (f, "%.17g", r_test_bench_result_ipc (res));
+  } else {
+    r_fprintf (f, "%c%c", sep, sep);
+  }
+  fputc (sep, f);
+  if (res->perf & R_PERF_COUNTER_BIT (R_PERF_COUNTER_CACHE_MISSES))
+    r_fprintf (f, "%.17g", res->cache_misses);
+  fputc (sep, f);
+  if (res->perf & R_PERF_COUNTER_BIT (R_PERF_COUNTER_BRANCH_MISSES))
+    r_fprintf (f, "%.17g", res->branch_misses);
+  fputc (sep, f);
+  if (res->perf & R_PERF_COUNTER_BIT (R_PERF_COUNTER_CONTEXT_SWITCHES))
+    r_fprintf (f, "%"RUINT64_FMT, res->ctxswitches);
+}
+
+void
+r_test_bench_record (const rchar * label, const RTestBenchResult * res)
+{
+  const RTest * test;
+  rchar path[256] = "", * l, * p;
+  FILE * f;
+
+  if (g__r_test_bench_spool == NULL || label == NULL || res == NULL)
+    return;
+
+  if ((test = r_test_get_current (NULL)) != NULL)
+    r_test_fill_path (test, path, sizeof (path));
+
+  /* The spool is tab and line separated */
+  for (p = l = r_strdup (label); *p != 0; p++) {
+    if (*p == '\t' || *p == '\n' || *p == '\r')
+      *p = ' ';
+  }
+
+  if ((f = r_fopen (g__r_test_bench_spool, "a")) != NULL) {
+    r_fprintf (f, "%s\t%s\t%"RUINT64_FMT"\t%u\t%u\t%"RSIZE_FMT"\t"
+        "%.17g\t%.17g\t%.17g\t%.17g\t%.17g\t%.17g",
+        path, l, res->iters, res->reps, res->outliers, res->bytes,
+        res->min, res->median, res->p95, res->mean, res->stddev, res->cycles);
+    r_test_bench_fprint_perf (f, '\t', res);
+    fputc ('\n', f);
+    fclose (f);
+  }
+  r_free (l);
+}
+
+void
+r_test_bench_record_once (const rchar * label, ruint64 iters, rsize bytes,
+    RClockTime elapsed)
+{
+  RTestBenchResult res;
+
+  if (g__r_test_bench_spool == NULL || iters == 0)
+    return;
+
+  r_memset (&res, 0, sizeof (res));
+  res.iters = iters;
+  res.reps = 1;
+  res.bytes = bytes;
+  res.min = res.median = res.p95 = res.mean =
+    (rdouble)elapsed / (rdouble)iters;
+  r_test_bench_record (label, &res);
+}
+
+static RTestBenchEntry *
+r_test_bench_entries_add (RTestBenchEntries * entries)
+{
+  if (entries->count == entries->alloc) {
+    entries->alloc = MAX (entries->alloc * 2, 32);
+    entries->entries = r_realloc (entries->entries,
+        entries->alloc * sizeof (RTestBenchEntry));
+  }
+  r_memset (&entries->entries[entries->count], 0, sizeof (RTestBenchEntry));
+  return &entries->entries[entries->count++];
+}
+
+static void
+r_test_bench_entries_clear (RTestBenchEntries * entries)
+{
+  rsize i;
+
+  for (i = 0; i < entries->count; i++) {
+    r_free (entries->entries[i].test);
+    r_free (entries->entries[i].label);
+  }
+  r_free (entries->entries);
+  r_memset (entries, 0, sizeof (RTestBenchEntries));
+}
+
+static void
+r_test_bench_entry_set_numbers (RTestBenchEntry * e, rchar ** v)
+{
+  e->res.iters = r_str_to_uint64 (v[0], NULL, 10, NULL);
+  e->res.reps = (ruint)r_str_to_uint64 (v[1], NULL, 10, NULL);
+  e->res.outliers = (ruint)r_str_to_uint64 (v[2], NULL, 10, NULL);
+  e->res.bytes = (rsize)r_str_to_uint64 (v[3], NULL, 10, NULL);
+  e->res.min = r_str_to_double (v[4], NULL, NULL);
+  e->res.median = r_str_to_double (v[5], NULL, NULL);
+  e->res.p95 = r_str_to_double (v[6], NULL, NULL);
+  e->res.mean = r_str_to_double (v[7], NULL, NULL);
+  e->res.stddev = r_str_to_double (v[8], NULL, NULL);
+  e->res.cycles = r_str_to_double (v[9], NULL, NULL);
+}
+
+/* v: instructions, ipc, cache_misses, branch_misses, context_switches */
+static void
+r_test_bench_entry_set_perf (RTestBenchEntry * e, rchar ** v)
+{
+  if (*v[0] != 0) {
+    e->res.perf |= R_PERF_COUNTER_BIT (R_PERF_COUNTER_INSTRUCTIONS);
+    e->res.instructions = r_str_to_double (v[0], NULL, NULL);
+  }
+  if (*v[2] != 0) {
+    e->res.perf |= R_PERF_COUNTER_BIT (R_PERF_COUNTER_CACHE_MISSES);
+    e->res.cache_misses = r_str_to_double (v[2], NULL, NULL);
+  }
+  if (*v[3] != 0) {
+    e->res.perf |= R_PERF_COUNTER_BIT (R_PERF_COUNTER_BRANCH_MISSES);
+    e->res.branch_misses = r_str_to_double (v[3], NULL, NULL);
+  }
+  if (*v[4] != 0) {
+    e->res.perf |= R_PERF_COUNTER_BIT (R_PERF_COUNTER_CONTEXT_SWITCHES);
+    e->res.ctxswitches = r_str_to_uint64 (v[4], NULL, 10, NULL);
+  }
+}
+
+static void
+r_test_bench_read_spool (const rchar * path, RTestBenchEntries * entries)
+{
+  rchar * data, ** lines, ** l;
+  rsize size;
+
+  if (!r_file_read_all (path, (ruint8 **)&data, &size))
+    return;
+
+  data = r_realloc (data, size + 1);
+  data[size] = 0;
+  lines = r_strsplit (data, "\n", RSIZE_MAX);
+  for (l = lines; *l != NULL; l++) {
+    rchar ** v = r_strsplit (*l, "\t", RSIZE_MAX);
+
+    if (r_strv_len (v) == R_N_ELEMENTS (g__r_test_bench_columns)) {
+      RTestBenchEntry * e = r_test_bench_entries_add (entries);
+      e->test = r_strdup (v[0]);
+      e->label = r_strdup (v[1]);
+      r_test_bench_entry_set_numbers (e, v + 2);
+      r_test_bench_entry_set_perf (e, v + R_TEST_BENCH_COLUMNS_BASE);
+    }
+    r_strv_free (v);
+  }
+  r_strv_free (lines);
+  r_free (data);
+}
+
+static void
+r_test_bench_write_json_value (RJsonWriter * w, const rchar * key,
+    rboolean valid, rdouble value)
+{
+  r_json_writer_key (w, key, -1);
+  if (valid)
+    r_json_writer_double (w, value);
+  else
+    r_json_writer_null (w);
+}
+
+static void
+r_test_bench_write_json_perf (RJsonWriter * w, const RTestBenchResult * res)
+{
+  const rchar * const * col = g__r_test_bench_columns + R_TEST_BENCH_COLUMNS_BASE;
+
+  r_test_bench_write_json_value (w, col[0],
+      res->perf & R_PERF_COUNTER_BIT (R_PERF_COUNTER_INSTRUCTIONS),
+      res->instructions);
+  r_test_bench_write_json_value (w, col[1],
+      r_test_bench_result_ipc (res) > 0.0, r_test_bench_result_ipc (res));
+  r_test_bench_write_json_value (w, col[2],
+      res->perf & R_PERF_COUNTER_BIT (R_PERF_COUNTER_CACHE_MISSES),
+      res->cache_misses);
+  r_test_bench_write_json_value (w, col[3],
+      res->perf & R_PERF_COUNTER_BIT (R_PERF_COUNTER_BRANCH_MISSES),
+      res->branch_misses);
+  r_test_bench_write_json_value (w, col[4],
+      res->perf & R_PERF_COUNTER_BIT (R_PERF_COUNTER_CONTEXT_SWITCHES),
+      (rdouble)res->ctxswitches);
+}
+
+static void
+r_test_bench_write_json (FILE * f, const RTestBenchEntries * entries)
+{
+  RJsonWriter w;
+  RString * str = r_string_new_sized (4096);
+  rchar * json;
+  rsize i;
+
+  r_json_writer_init_string (&w, str, R_JSON_NOFLAGS);
+  r_json_writer_begin_object (&w);
+  r_json_writer_key (&w, "config", -1);
+  r_json_writer_begin_object (&w);
+  r_json_writer_key (&w, "target_ns", -1);
+  r_json_writer_int (&w, (rint64)g__r_test_bench_config.target);
+  r_json_writer_key (&w, "warmup", -1);
+  r_json_writer_int (&w, g__r_test_bench_config.warmup);
+  r_json_writer_key (&w, "reps", -1);
+  r_json_writer_int (&w, g__r_test_bench_config.reps);
+  r_json_writer_key (&w, "cpu", -1);
+  r_json_writer_int (&w, g__r_test_bench_config.cpu);
+  r_json_writer_end_object (&w);
+
+  r_json_writer_key (&w, "results", -1);
+  r_json_writer_begin_array (&w);
+  for (i = 0; i < entries->count; i++) {
+    const RTestBenchEntry * e = &entries->entries[i];
+
+    r_json_writer_begin_object (&w);
+    r_json_writer_key (&w, g__r_test_bench_columns[0], -1);
+    r_json_writer_string (&w, e->test, -1);
+    r_json_writer_key (&w, g__r_test_bench_columns[1], -1);
+    r_json_writer_string (&w, e->label, -1);
+    r_json_writer_key (&w, g__r_test_bench_columns[2], -1);
+    r_json_writer_int (&w, (rint64)e->res.iters);
+    r_json_writer_key (&w, g__r_test_bench_columns[3], -1);
+    r_json_writer_int (&w, e->res.reps);
+    r_json_writer_key (&w, g__r_test_bench_columns[4], -1);
+    r_json_writer_int (&w, e->res.outliers);
+    r_json_writer_key (&w, g__r_test_bench_columns[5], -1);
+    r_json_writer_int (&w, (rint64)e->res.bytes);
+    r_json_writer_key (&w, g__r_test_bench_columns[6], -1);
+    r_json_writer_double (&w, e->res.min);
+    r_json_writer_key (&w, g__r_test_bench_columns[7], -1);
+    r_json_writer_double (&w, e->res.median);
+    r_json_writer_key (&w, g__r_test_bench_columns[8], -1);
+    r_json_writer_double (&w, e->res.p95);
+    r_json_writer_key (&w, g__r_test_bench_columns[9], -1);
+    r_json_writer_double (&w, e->res.mean);
+    r_json_writer_key (&w, g__r_test_bench_columns[10], -1);
+    r_json_writer_double (&w, e->res.stddev);
+    r_json_writer_key (&w, g__r_test_bench_columns[11], -1);
+    r_json_writer_double (&w, e->res.cycles);
+    r_test_bench_write_json_perf (&w, &e->res);
+    r_json_writer_end_object (&w);
+  }
+  r_json_writer_end_array (&w);
+  r_json_writer_end_object (&w);
+  r_json_writer_finish (&w);
+
+  r_fprintf (f, "%s\n", (json = r_string_free_keep (str)));
+  r_free (json);
+}
+
+static void
+r_test_bench_write_csv_str (FILE * f, const rchar * str)
+{
+  fputc ('"', f);
+  for (; *str != 0; str++) {
+    if (*str == '"')
+      fputc ('"', f);
+    fputc (*str, f);
+  }
+  fputc ('"', f);
+}
+
+static void
+r_test_bench_write_csv (FILE * f, const RTestBenchEntries * entries)
+{
+  rsize i;
+
+  for (i = 0; i < R_N_ELEMENTS (g__r_test_bench_columns); i++)
+    r_fprintf (f, "%s%s", i > 0 ? "," : "", g__r_test_bench_columns[i]);
+  fputc ('\n', f);
+
+  for (i = 0; i < entries->count; i++) {
+    const RTestBenchEntry * e = &entries->entries[i];
+
+    r_test_bench_write_csv_str (f, e->test);
+    fputc (',', f);
+    r_test_bench_write_csv_str (f, e->label);
+    r_fprintf (f, ",%"RUINT64_FMT",%u,%u,%"RSIZE_FMT",%.17g,%.17g,%.17g,%.17g,%.17g,%.17g",
+        e->res.iters, e->res.reps, e->res.outliers, e->res.bytes,
+        e->res.min, e->res.median, e->res.p95, e->res.mean, e->res.stddev,
+        e->res.cycles);
+    r_test_bench_fprint_perf (f, ',', &e->res);
+    fputc ('\n', f);
+  }
+}
+
+/* Split one CSV record (RFC 4180 quoting) into a fresh strv */
+static rchar **
+r_test_bench_csv_split (const rchar ** data)
+{
+  const rchar * p = *data;
+  RString * field = r_string_new_sized (64);
+  rchar ** ret = r_mem_new0_n (rchar *, R_N_ELEMENTS (g__r_test_bench_columns) + 1);
+  rsize n = 0;
+  rboolean quoted = FALSE;
+
+  for (;; p++) {
+    if (quoted) {
+      if (*p == 0) {
+        break;
+      } else if (*p == '"' && p[1] == '"') {
+        r_string_append_c (field, '"');
+        p++;
+      } else if (*p == '"') {
+        quoted = FALSE;
+      } else {
+        r_string_append_c (field, *p);
+      }
+    } else if (*p == '"') {
+      quoted = TRUE;
+    } else if (*p == ',' || *p == '\n' || *p == '\r' || *p == 0) {
+      if (n < R_N_ELEMENTS (g__r_test_bench_columns))
+        ret[n++] = r_string_free_keep (field);
+      else
+        r_string_free (field);
+      field = r_string_new_sized (64);
+      if (*p != ',')
+        break;
+    } else {
+      r_string_append_c (field, *p);
+    }
+  }
+
+  while (*p == '\r' || *p == '\n')
+    p++;
+  *data = p;
+  r_string_free (field);
+  return ret;
+}
+
+static void
+r_test_bench_read_csv (const rchar * data, RTestBenchEntries * entries)
+{
+  rchar ** v;
+
+  /* Skip the header */
+  r_strv_free (r_test_bench_csv_split (&data));
+  while (*data != 0) {
+    v = r_test_bench_csv_split (&data);
+    if (r_strv_len (v) >= R_TEST_BENCH_COLUMNS_BASE) {
+      RTestBenchEntry * e = r_test_bench_entries_add (entries);
+      e->test = r_strdup (v[0]);
+      e->label = r_strdup (v[1]);
+      r_test_bench_entry_set_numbers (e, v + 2);
+      if (r_strv_len (v) == R_N_ELEMENTS (g__r_test_bench_columns))
+        r_test_bench_entry_set_perf (e, v + R_TEST_BENCH_COLUMNS_BASE);
+    }
+    r_strv_free (v);
+  }
+}
+
+static rdouble
+r_test_bench_json_double (RJsonValue * obj, const rchar * key)
+{
+  RJsonValue * v = r_json_value_get_object_field (obj, key);
+  return v != NULL ? r_json_value_get_number_double (v) : 0.0;
+}
+
+static rdouble
+r_test_bench_json_perf (RJsonValue * obj, RPerfCounter c, const rchar * key,
+    RTestBenchEntry * e)
+{
+  RJsonValue * v = r_json_value_get_object_field (obj, key);
+
+  if (v == NULL || r_json_value_is_null (v))
+    return 0.0;
+  e->res.perf |= R_PERF_COUNTER_BIT (c);
+  return r_json_value_get_number_double (v);
+}
+
+static void
+r_test_bench_read_json (const rchar * data, rsize size,
+    RTestBenchEntries * entries)
+{
+  RJsonValue * root, * results;
+  rsize i, count;
+
+  if ((root = r_json_parse (data, size, NULL)) == NULL)
+    return;
+
+  if ((results = r_json_value_get_object_field (root, "results")) != NULL) {
+    count = r_json_value_get_array_size (results);
+    for (i = 0; i < count; i++) {
+      RJsonValue * obj = r_json_value_get_array_value (results, i);
+      RJsonValue * test = r_json_value_get_object_field (obj, "test");
+      RJsonValue * label = r_json_value_get_object_field (obj, "label");
+      RTestBenchEntry * e;
+
+      if (test == NULL || label == NULL)
+        continue;
+
+      e = r_test_bench_entries_add (entries);
+      e->test = r_strdup (r_json_value_get_string (test));
+      e->label = r_strdup (r_json_value_get_string (label));
+      e->res.iters = (ruint64)r_test_bench_json_double (obj, "iters");
+      e->res.reps = (ruint)r_test_bench_json_double (obj, "reps");
+      e->res.outliers = (ruint)r_test_bench_json_double (obj, "outliers");
+      e->res.bytes = (rsize)r_test_bench_json_double (obj, "bytes");
+      e->res.min = r_test_bench_json_double (obj, "min_ns");
+      e->res.median = r_test_bench_json_double (obj, "median_ns");
+      e->res.p95 = r_test_bench_json_double (obj, "p95_ns");
+      e->res.mean = r_test_bench_json_double (obj, "mean_ns");
+      e->res.stddev = r_test_bench_json_double (obj, "stddev_ns");
+      e->res.cycles = r_test_bench_json_double (obj, "cycles");
+      e->res.instructions = r_test_bench_json_perf (obj,
+          R_PERF_COUNTER_INSTRUCTIONS, "instructions", e);
+      e->res.cache_misses = r_test_bench_json_perf (obj,
+          R_PERF_COUNTER_CACHE_MISSES, "cache_misses", e);
+      e->res.branch_misses = r_test_bench_json_perf (obj,
+          R_PERF_COUNTER_BRANCH_MISSES, "branch_misses", e);
+      e->res.ctxswitches = (ruint64)r_test_bench_json_perf (obj,
+          R_PERF_COUNTER_CONTEXT_SWITCHES, "context_switches", e);
+    }
+  }
+
+  r_json_value_unref (root);
+}
+
+static rboolean
+r_test_bench_read_baseline (const rchar * path, RTestBenchEntries * entries)
+{
+  rchar * data;
+  const rchar * p;
+  rsize size;
+
+  if (!r_file_read_all (path, (ruint8 **)&data, &size))
+    return FALSE;
+
+  data = r_realloc (data, size + 1);
+  data[size] = 0;
+  for (p = data; *p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'; p++);
+  if (*p == '{')
+    r_test_bench_read_json (data, size, entries);
+  else
+    r_test_bench_read_csv (data, entries);
+  r_free (data);
+
+  return TRUE;
+}
+
+static rsize
+r_test_bench_compare (FILE * f, const RTestBenchEntries * cur,
+    const RTestBenchEntries * base)
+{
+  RHashTable * index;
+  rsize i, regressions = 0, improvements = 0, compared = 0;
+
+  index = r_hash_table_new_full (r_str_hash, r_str_equal, r_free, NULL);
+  for (i = 0; i < base->count; i++) {
+    r_hash_table_insert (index, r_strprintf ("%s\t%s",
+          base->entries[i].test, base->entries[i].label), &base->entries[i]);
+  }
+
+  r_fprintf (f, "\nBenchmark comparison against %s (threshold %.1f%%):\n",
+      g__r_test_bench_baseline, g__r_test_bench_threshold * 100.0);
+  for (i = 0; i < cur->count; i++) {
+    const RTestBenchEntry * e = &cur->entries[i];
+    const RTestBenchEntry * b;
+    rchar * key = r_strprintf ("%s\t%s", e->test, e->label);
+    rdouble change;
+
+    b = r_hash_table_lookup (index, key);
+    r_free (key);
+    if (b == NULL || b->res.median <= 0.0)
+      continue;
+
+    compared++;
+    change = (e->res.median - b->res.median) / b->res.median;
+    if (change > g__r_test_bench_threshold) {
+      regressions++;
+      r_fprintf (f, "  REGRESSION: %s %s: %.1f -> %.1f ns/op (%+.1f%%)",
+          e->test, e->label, b->res.median, e->res.median, change * 100.0);
+    } else if (change < -g__r_test_bench_threshold) {
+      improvements++;
+      r_fprintf (f, "  IMPROVED:   %s %s: %.1f -> %.1f ns/op (%+.1f%%)",
+          e->test, e->label, b->res.median, e->res.median, change * 100.0);
+    } else {
+      continue;
+    }
+
+    /* An unchanged instruction count points at noise, not the code */
+    if ((e->res.perf & b->res.perf &
+          R_PERF_COUNTER_BIT (R_PERF_COUNTER_INSTRUCTIONS)) != 0) {
+      r_fprintf (f, ", %.1f -> %.1f instructions/op",
+          b->res.instructions, e->res.instructions);
+    }
+    fputc ('\n', f);
+  }
+  r_fprintf (f, "  %"RSIZE_FMT" compared, %"RSIZE_FMT" regressions, "
+      "%"RSIZE_FMT" improvements, %"RSIZE_FMT" without baseline\n",
+      compared, regressions, improvements, cur->count - compared);
+
+  r_hash_table_unref (index);
+  return regressions;
+}
+
+rboolean
+r_test_bench_output_begin (RTestBenchFormat format, const rchar * output,
+    const rchar * baseline, rdouble threshold)
+{
+  FILE * f;
+
+  if (output == NULL && baseline == NULL)
+    return FALSE;
+
+  r_free (g__r_test_bench_output);
+  r_free (g__r_test_bench_baseline);
+  r_free (g__r_test_bench_spool);
+  g__r_test_bench_format = format;
+  g__r_test_bench_output = r_strdup (output);
+  g__r_test_bench_baseline = r_strdup (baseline);
+  g__r_test_bench_threshold = threshold;
+
+  g__r_test_bench_spool = r_fs_path_new_tmpname_full (NULL, "rtestbench", NULL);
+  if (g__r_test_bench_spool == NULL || (f = r_fopen (g__r_test_bench_spool, "w")) == NULL) {
+    r_free (g__r_test_bench_spool);
+    g__r_test_bench_spool = NULL;
+    return FALSE;
+  }
+  fclose (f);
+  return TRUE;
+}
+
+rsize
+r_test_bench_output_end (FILE * f)
+{
+  RTestBenchEntries cur = { NULL, 0, 0 }, base = { NULL, 0, 0 };
+  rsize ret = 0;
+  FILE * out;
+
+  if (g__r_test_bench_spool == NULL)
+    return 0;
+
+  r_test_bench_read_spool (g__r_test_bench_spool, &cur);
+  remove (g__r_test_bench_spool);
+  r_free (g__r_test_bench_spool);
+  g__r_test_bench_spool = NULL;
+
+  if (g__r_test_bench_output != NULL) {
+    if ((out = r_fopen (g__r_test_bench_output, "w")) != NULL) {
+      if (g__r_test_bench_format == R_TEST_BENCH_FORMAT_CSV)
+        r_test_bench_write_csv (out, &cur);
+      else
+        r_test_bench_write_json (out, &cur);
+      fclose (out);
+    } else {
+      r_fprintf (f, "Could not write benchmark results to %s\n",
+          g__r_test_bench_output);
+    }
+  }
+
+  if (g__r_test_bench_baseline != NULL) {
+    if (r_test_bench_read_baseline (g__r_test_bench_baseline, &base)) {
+      ret = r_test_bench_compare (f, &cur, &base);
+    } else {
+      r_fprintf (f, "Could not read benchmark baseline %s\n",
+          g__r_test_bench_baseline);
+    }
+  }
+
+  r_test_bench_entries_clear (&cur);
+  r_test_bench_entries_clear (&base);
+  r_free (g__r_test_bench_output);
+  r_free (g__r_test_bench_baseline);
+  g__r_test_bench_output = g__r_test_bench_baseline = NULL;
+  return ret;
+}
+
+rboolean
+r_test_bench_setup_from_args (RArgParseCtx * ctx)
+{
+  RTestBenchConfig cfg;
+  RTestBenchFormat format = R_TEST_BENCH_FORMAT_JSON;
+  rdouble threshold = R_TEST_BENCH_THRESHOLD_DEFAULT;
+  rchar * str, * output, * baseline;
+  rboolean ret = TRUE;
+
+  r_test_bench_get_config (&cfg);
+  if (r_arg_parse_ctx_has_option (ctx, "bench-reps"))
+    cfg.reps = (ruint)MAX (r_arg_parse_ctx_get_option_int (ctx, "bench-reps"), 1);
+  if (r_arg_parse_ctx_has_option (ctx, "bench-warmup"))
+    cfg.warmup = (ruint)MAX (r_arg_parse_ctx_get_option_int (ctx, "bench-warmup"), 0);
+  if (r_arg_parse_ctx_has_option (ctx, "bench-time"))
+    cfg.target = MAX (r_arg_parse_ctx_get_option_int (ctx, "bench-time"), 1) * R_MSECOND;
+  if (r_arg_parse_ctx_has_option (ctx, "bench-cpu"))
+    cfg.cpu = r_arg_parse_ctx_get_option_int (ctx, "bench-cpu");
+  if (r_arg_parse_ctx_has_option (ctx, "bench-threshold"))
+    threshold = r_arg_parse_ctx_get_option_double (ctx, "bench-threshold") / 100.0;
+  r_test_bench_set_config (&cfg);
+
+  if ((str = r_arg_parse_ctx_get_option_string (ctx, "bench-format")) != NULL) {
+    if (r_str_equals (str, "csv")) {
+      format = R_TEST_BENCH_FORMAT_CSV;
+    } else if (!r_str_equals (str, "json")) {
+      r_print ("Unknown benchmark format '%s', use json or csv\n", str);
+      ret = FALSE;
+    }
+    r_free (str);
+  }
+
+  output = r_arg_parse_ctx_get_option_filename (ctx, "bench-output");
+  baseline = r_arg_parse_ctx_get_option_filename (ctx, "bench-baseline");
+  if (ret && (output != NULL || baseline != NULL))
+    ret = r_test_bench_output_begin (format, output, baseline, threshold);
+  r_free (output);
+  r_free (baseline);
+
+  return ret;
+}
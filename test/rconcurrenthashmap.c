@@ -0,0 +1,267 @@
+#include <rlib/rlib.h>
+
+#define CHM_KEY(i)    RSIZE_TO_POINTER ((rsize)(i) + 1)
+
+static void
+test_chm_count_notify (rpointer ptr)
+{
+  (*(rsize *)ptr)++;
+}
+
+RTEST (rconcurrenthashmap, new_and_destroy, RTEST_FAST)
+{
+  RConcurrentHashMap * map;
+
+  r_assert_cmpptr ((map = r_concurrent_hash_map_new (NULL, NULL)), !=, NULL);
+  r_assert_cmpuint (r_concurrent_hash_map_size (map), ==, 0);
+  r_assert (!r_concurrent_hash_map_contains (map, CHM_KEY (0)));
+  r_assert (!r_concurrent_hash_map_remove (map, CHM_KEY (0)));
+  r_concurrent_hash_map_unref (map);
+}
+RTEST_END;
+
+RTEST (rconcurrenthashmap, insert_lookup_remove, RTEST_FAST)
+{
+  RConcurrentHashMap * map;
+  rpointer val = NULL;
+  rsize i;
+
+  r_assert_cmpptr ((map = r_concurrent_hash_map_new (NULL, NULL)), !=, NULL);
+  for (i = 0; i < 10000; i++) {
+    r_assert_cmpint (r_concurrent_hash_map_insert (map, CHM_KEY (i),
+          RSIZE_TO_POINTER (i * 2)), ==, R_HASH_TABLE_OK);
+  }
+  r_assert_cmpuint (r_concurrent_hash_map_size (map), ==, 10000);
+
+  for (i = 0; i < 10000; i++) {
+    r_assert (r_concurrent_hash_map_lookup (map, CHM_KEY (i), &val));
+    r_assert_cmpuint (RPOINTER_TO_SIZE (val), ==, i * 2);
+  }
+  r_assert (!r_concurrent_hash_map_lookup (map, CHM_KEY (10000), &val));
+
+  for (i = 0; i < 10000; i += 2)
+    r_assert (r_concurrent_hash_map_remove (map, CHM_KEY (i)));
+  r_assert_cmpuint (r_concurrent_hash_map_size (map), ==, 5000);
+  for (i = 0; i < 10000; i++)
+    r_assert_cmpint (r_concurrent_hash_map_contains (map, CHM_KEY (i)), ==, i & 1);
+
+  r_concurrent_hash_map_unref (map);
+}
+RTEST_END;
+
+RTEST (rconcurrenthashmap, str_keys, RTEST_FAST)
+{
+  RConcurrentHashMap * map;
+  rpointer val = NULL;
+
+  r_assert_cmpptr ((map = r_concurrent_hash_map_new_full (r_str_hash, r_str_equal,
+          r_free, NULL, NULL)), !=, NULL);
+  r_assert_cmpint (r_concurrent_hash_map_insert (map, r_strdup ("foo"),
+        RUINT_TO_POINTER (1)), ==, R_HASH_TABLE_OK);
+  r_assert_cmpint (r_concurrent_hash_map_insert (map, r_strdup ("bar"),
+        RUINT_TO_POINTER (2)), ==, R_HASH_TABLE_OK);
+  r_assert_cmpint (r_concurrent_hash_map_insert (map, r_strdup ("foo"),
+        RUINT_TO_POINTER (3)), ==, R_HASH_TABLE_REPLACE);
+
+  r_assert (r_concurrent_hash_map_lookup (map, "foo", &val));
+  r_assert_cmpptr (val, ==, RUINT_TO_POINTER (3));
+  r_assert (r_concurrent_hash_map_lookup (map, "bar", &val));
+  r_assert_cmpptr (val, ==, RUINT_TO_POINTER (2));
+  r_assert (!r_concurrent_hash_map_contains (map, "baz"));
+  r_assert_cmpuint (r_concurrent_hash_map_size (map), ==, 2);
+
+  r_concurrent_hash_map_unref (map);
+}
+RTEST_END;
+
+RTEST (rconcurrenthashmap, insert_if_absent, RTEST_FAST)
+{
+  RConcurrentHashMap * map;
+  rpointer existing = NULL;
+
+  r_assert_cmpptr ((map = r_concurrent_hash_map_new (NULL, NULL)), !=, NULL);
+  r_assert (r_concurrent_hash_map_insert_if_absent (map, CHM_KEY (1),
+        RUINT_TO_POINTER (10), &existing));
+  r_assert_cmpptr (existing, ==, NULL);
+  r_assert (!r_concurrent_hash_map_insert_if_absent (map, CHM_KEY (1),
+        RUINT_TO_POINTER (20), &existing));
+  r_assert_cmpptr (existing, ==, RUINT_TO_POINTER (10));
+  r_assert (r_concurrent_hash_map_lookup (map, CHM_KEY (1), &existing));
+  r_assert_cmpptr (existing, ==, RUINT_TO_POINTER (10));
+  r_assert_cmpuint (r_concurrent_hash_map_size (map), ==, 1);
+  r_concurrent_hash_map_unref (map);
+}
+RTEST_END;
+
+static rpointer
+test_chm_compute (rconstpointer key, rpointer value, rpointer user)
+{
+  rsize * v = value;
+  (void) key;
+
+  switch (*v) {
+    case 1:   return v;           /* keep */
+    case 2:   return NULL;        /* remove */
+    default:  return user;        /* replace */
+  }
+}
+
+RTEST (rconcurrenthashmap, compute_if_present, RTEST_FAST)
+{
+  RConcurrentHashMap * map;
+  rsize keys = 0, vals[4] = { 1, 2, 3, 4 };
+  rsize freed_keys[4] = { 0 };
+  rpointer val = NULL;
+
+  r_assert_cmpptr ((map = r_concurrent_hash_map_new_full (NULL, NULL,
+          test_chm_count_notify, NULL, NULL)), !=, NULL);
+  r_assert (r_concurrent_hash_map_insert (map, &freed_keys[0], &vals[0]) == R_HASH_TABLE_OK);
+  r_assert (r_concurrent_hash_map_insert (map, &freed_keys[1], &vals[1]) == R_HASH_TABLE_OK);
+  r_assert (r_concurrent_hash_map_insert (map, &freed_keys[2], &vals[2]) == R_HASH_TABLE_OK);
+
+  r_assert (!r_concurrent_hash_map_compute_if_present (map, &keys,
+        test_chm_compute, &vals[3]));
+
+  r_assert (r_concurrent_hash_map_compute_if_present (map, &freed_keys[0],
+        test_chm_compute, &vals[3]));
+  r_assert (r_concurrent_hash_map_lookup (map, &freed_keys[0], &val));
+  r_assert_cmpptr (val, ==, &vals[0]);
+
+  r_assert (r_concurrent_hash_map_compute_if_present (map, &freed_keys[1],
+        test_chm_compute, &vals[3]));
+  r_assert (!r_concurrent_hash_map_contains (map, &freed_keys[1]));
+
+  r_assert (r_concurrent_hash_map_compute_if_present (map, &freed_keys[2],
+        test_chm_compute, &vals[3]));
+  r_assert (r_concurrent_hash_map_lookup (map, &freed_keys[2], &val));
+  r_assert_cmpptr (val, ==, &vals[3]);
+  r_assert_cmpuint (r_concurrent_hash_map_size (map), ==, 2);
+
+  /* The replaced entry kept its key: only the destroy reclaims it, once. */
+  r_concurrent_hash_map_unref (map);
+  r_assert_cmpuint (freed_keys[0], ==, 1);
+  r_assert_cmpuint (freed_keys[2], ==, 1);
+  r_assert_cmpuint (freed_keys[1], <=, 1);
+}
+RTEST_END;
+
+static void
+test_chm_sum (rpointer key, rpointer value, rpointer user)
+{
+  rsize * sum = user;
+  sum[0] += RPOINTER_TO_SIZE (key);
+  sum[1] += RPOINTER_TO_SIZE (value);
+}
+
+RTEST (rconcurrenthashmap, foreach, RTEST_FAST)
+{
+  RConcurrentHashMap * map;
+  rsize i, sum[2] = { 0, 0 };
+
+  r_assert_cmpptr ((map = r_concurrent_hash_map_new (NULL, NULL)), !=, NULL);
+  for (i = 0; i < 1000; i++)
+    r_concurrent_hash_map_insert (map, CHM_KEY (i), RSIZE_TO_POINTER (1));
+  r_concurrent_hash_map_foreach (map, test_chm_sum, sum);
+  r_assert_cmpuint (sum[0], ==, 1000 * 1001 / 2);
+  r_assert_cmpuint (sum[1], ==, 1000);
+  r_concurrent_hash_map_unref (map);
+}
+RTEST_END;
+
+typedef struct {
+  RRef ref;
+  rsize key;
+  rsize magic;
+} TestChmVal;
+
+#define TEST_CHM_MAGIC    0x5eed5eedu
+#define TEST_CHM_KEYS     512
+
+static void
+test_chm_val_free (TestChmVal * v)
+{
+  v->magic = 0;
+  r_free (v);
+}
+
+static TestChmVal *
+test_chm_val_new (rsize key)
+{
+  TestChmVal * ret = r_mem_new (TestChmVal);
+  r_ref_init (ret, test_chm_val_free);
+  ret->key = key;
+  ret->magic = TEST_CHM_MAGIC;
+  return ret;
+}
+
+typedef struct {
+  RConcurrentHashMap * map;
+  ruint seed;
+  rboolean writer;
+} TestChmThread;
+
+static rpointer
+test_chm_stress_thread (rpointer data)
+{
+  TestChmThread * t = data;
+  ruint x = t->seed;
+  rsize n, bad = 0;
+
+  for (n = 0; n < 20000; n++) {
+    rsize k;
+
+    x = x * 1103515245u + 12345u;
+    k = (x >> 8) % TEST_CHM_KEYS;
+
+    if (t->writer && (x & 0x3) == 0) {
+      if (x & 0x10)
+        r_concurrent_hash_map_remove (t->map, CHM_KEY (k));
+      else
+        r_concurrent_hash_map_insert (t->map, CHM_KEY (k), test_chm_val_new (k));
+    } else {
+      TestChmVal * v;
+      if (r_concurrent_hash_map_lookup (t->map, CHM_KEY (k), (rpointer *)&v)) {
+        if (v->magic != TEST_CHM_MAGIC || v->key != k)
+          bad++;
+        r_ref_unref (v);
+      }
+    }
+  }
+
+  return RSIZE_TO_POINTER (bad);
+}
+
+RTEST (rconcurrenthashmap, concurrent_readers_writers, RTEST_FAST)
+{
+  RConcurrentHashMap * map;
+  TestChmThread t[8];
+  RThread * th[8];
+  rsize i;
+
+  r_assert_cmpptr ((map = r_concurrent_hash_map_new_full (NULL, NULL,
+          NULL, r_ref_unref, r_ref_ref)), !=, NULL);
+  for (i = 0; i < TEST_CHM_KEYS; i += 2)
+    r_concurrent_hash_map_insert (map, CHM_KEY (i), test_chm_val_new (i));
+
+  for (i = 0; i < R_N_ELEMENTS (th); i++) {
+    t[i].map = map;
+    t[i].seed = (ruint)i * 7919u + 1;
+    t[i].writer = (i & 1) == 0;
+    r_assert_cmpptr ((th[i] = r_thread_new (NULL, test_chm_stress_thread, &t[i])), !=, NULL);
+  }
+  for (i = 0; i < R_N_ELEMENTS (th); i++) {
+    r_assert_cmpptr (r_thread_join (th[i]), ==, NULL);
+    r_thread_unref (th[i]);
+  }
+
+  for (i = 0; i < TEST_CHM_KEYS; i++) {
+    TestChmVal * v;
+    if (r_concurrent_hash_map_lookup (map, CHM_KEY (i), (rpointer *)&v)) {
+      r_assert_cmpuint (v->key, ==, i);
+      r_ref_unref (v);
+    }
+  }
+
+  r_concurrent_hash_map_unref (map);
+}
+RTEST_END;
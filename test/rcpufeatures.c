@@ -82,6 +82,7 @@ RTEST (rcpufeatures, arch_groups_disjoint, RTEST_FAST)
                          R_CPU_FEATURE_AVX        | R_CPU_FEATURE_AVX2     |
                          R_CPU_FEATURE_AVX512F    | R_CPU_FEATURE_AVX512BW |
                          R_CPU_FEATURE_AVX512DQ   | R_CPU_FEATURE_AVX512VL |
+                         R_CPU_FEATURE_AVX512IFMA |
                          R_CPU_FEATURE_SHA_NI     | R_CPU_FEATURE_BMI1     |
                          R_CPU_FEATURE_BMI2       | R_CPU_FEATURE_POPCNT   |
                          R_CPU_FEATURE_F16C       | R_CPU_FEATURE_RDRAND   |
@@ -32,3 +32,89 @@ RTEST (rcrc, crc32bzip, RTEST_FAST)
 }
 RTEST_END;
 
+
+/* Bit-at-a-time references for the accelerated paths. */
+static ruint32
+r_crc_test_ref_refl (ruint32 poly, const ruint8 * ptr, rsize size)
+{
+  ruint32 crc = 0xffffffff;
+  ruint i;
+
+  while (size--) {
+    crc ^= *ptr++;
+    for (i = 0; i < 8; i++)
+      crc = (crc & 1) ? (crc >> 1) ^ poly : crc >> 1;
+  }
+  return ~crc;
+}
+
+static ruint32
+r_crc_test_ref_bzip2 (const ruint8 * ptr, rsize size)
+{
+  ruint32 crc = 0xffffffff;
+  ruint i;
+
+  while (size--) {
+    crc ^= (ruint32) *ptr++ << 24;
+    for (i = 0; i < 8; i++)
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+  }
+  return ~crc;
+}
+
+RTEST (rcrc, lengths_and_alignments, RTEST_FAST)
+{
+  ruint8 buf[1024 + 16];
+  RPrng * prng = r_rand_prng_new ();
+  rsize off, len;
+
+  r_prng_fill (prng, buf, sizeof (buf));
+  /* Every tail length around the 16 byte slice / 64 byte fold
+   * boundaries, from every alignment. */
+  for (off = 0; off < 16; off++) {
+    for (len = 0; len <= 300; len++) {
+      r_assert_cmphex (r_crc32 (buf + off, len), ==,
+          r_crc_test_ref_refl (0xedb88320, buf + off, len));
+      r_assert_cmphex (r_crc32c (buf + off, len), ==,
+          r_crc_test_ref_refl (0x82f63b78, buf + off, len));
+      r_assert_cmphex (r_crc32bzip2 (buf + off, len), ==,
+          r_crc_test_ref_bzip2 (buf + off, len));
+    }
+  }
+  r_assert_cmphex (r_crc32 (buf, 1024), ==, r_crc_test_ref_refl (0xedb88320, buf, 1024));
+  r_assert_cmphex (r_crc32bzip2 (buf, 1024), ==, r_crc_test_ref_bzip2 (buf, 1024));
+
+  /* Streaming across uneven chunks matches one-shot. */
+  r_assert_cmphex (r_crc32_update (r_crc32 (buf, 77), buf + 77, 700), ==,
+      r_crc32 (buf, 777));
+  r_assert_cmphex (r_crc32bzip2_update (r_crc32bzip2 (buf, 130), buf + 130, 647), ==,
+      r_crc32bzip2 (buf, 777));
+
+  r_prng_unref (prng);
+}
+RTEST_END;
+
+RTEST (rcrc, combine, RTEST_FAST)
+{
+  ruint8 buf[4096];
+  RPrng * prng = r_rand_prng_new ();
+  static const rsize splits[] = { 0, 1, 9, 63, 64, 1000, 4095, 4096 };
+  rsize i;
+
+  r_prng_fill (prng, buf, sizeof (buf));
+  for (i = 0; i < R_N_ELEMENTS (splits); i++) {
+    rsize a = splits[i], b = sizeof (buf) - a;
+
+    r_assert_cmphex (r_crc32_combine (r_crc32 (buf, a), r_crc32 (buf + a, b), b), ==,
+        r_crc32 (buf, sizeof (buf)));
+    r_assert_cmphex (r_crc32c_combine (r_crc32c (buf, a), r_crc32c (buf + a, b), b), ==,
+        r_crc32c (buf, sizeof (buf)));
+    r_assert_cmphex (r_crc32bzip2_combine (r_crc32bzip2 (buf, a),
+          r_crc32bzip2 (buf + a, b), b), ==, r_crc32bzip2 (buf, sizeof (buf)));
+  }
+
+  r_assert_cmphex (r_crc32_combine (r_crc32 (r_crc_test_vec, 4),
+        r_crc32 (r_crc_test_vec + 4, 5), 5), ==, 0xcbf43926);
+  r_prng_unref (prng);
+}
+RTEST_END;
@@ -85,10 +85,10 @@ RTEST_END;
 RTEST (rcryptomac, free_wipes_keyblock, R_TEST_TYPE_FAST)
 {
   /* Sentinel-tagged HMAC key: shorter than the SHA-256 block size
-   * so r_hmac_new takes the zero-padding branch into keyblock, then
-   * r_hmac_reset folds it into the inner/outer pads. Both code
-   * paths must wipe before release; otherwise the sentinel survives
-   * in the freed-buffer pile. */
+   * so r_hmac_new takes the zero-padding branch into its scratch
+   * keyblock before absorbing the ipad/opad blocks into the cached
+   * pad states. Both must be wiped before release; otherwise the
+   * sentinel survives in the freed-buffer pile. */
   static const ruint8 sentinel_key[24] = {
     0xCA, 0xFE, 0xBA, 0xBE, 0xDE, 0xAD, 0xBE, 0xEF,
     0xFE, 0xED, 0xFA, 0xCE, 0xBA, 0xAD, 0xF0, 0x0D,
@@ -171,3 +171,24 @@ RTEST (rcryptomac, hmac_verify, R_TEST_TYPE_FAST)
 }
 RTEST_END;
 
+
+RTEST (rcryptomac, hmac_reset_reuses_key, R_TEST_TYPE_FAST)
+{
+  RHmac * hmac;
+  rchar * tmp;
+  ruint i;
+
+  /* Reset restores the precomputed pad states, so one keyed object
+   * produces the same MAC as a fresh one, message after message. */
+  r_assert_cmpptr ((hmac = r_hmac_new (R_MSG_DIGEST_TYPE_MD5, "Jefe", 4)), !=, NULL);
+  for (i = 0; i < 3; i++) {
+    r_assert (r_hmac_update (hmac, "what do ya want ", 16));
+    r_assert (r_hmac_update (hmac, "for nothing?", 12));
+    r_assert_cmpstr ((tmp = r_hmac_get_hex (hmac)), ==,
+        "750c783e6ab0b503eaa86e310a5db738");
+    r_free (tmp);
+    r_hmac_reset (hmac);
+  }
+  r_hmac_free (hmac);
+}
+RTEST_END;
@@ -307,6 +307,69 @@ RTEST (rdh, gen_named_roundtrip, RTEST_SLOW)
 }
 RTEST_END;
 
+RTEST_LOOP (rdh, gen_named_fixed_base, RTEST_SLOW, 0, R_DH_GROUP_COUNT)
+{
+  /* Named-group keygen goes through the cached generator comb and
+   * compute_shared through the cached Montgomery context; both must
+   * agree with the plain window exponentiation. */
+  RCryptoKey * a_priv, * b_priv, * b_pub;
+  RPrng * prng;
+  rmpint p, g, x, y, expected;
+  ruint8 shared[1024], ref[1024];
+  rsize size = sizeof (shared), pbytes;
+
+  r_assert_cmpptr ((prng = r_rand_prng_new ()), !=, NULL);
+  r_assert_cmpptr ((a_priv = r_dh_priv_key_new_gen_named (__i, prng)), !=, NULL);
+  r_assert_cmpptr ((b_priv = r_dh_priv_key_new_gen_named (__i, prng)), !=, NULL);
+
+  r_mpint_init (&p);
+  r_mpint_init (&g);
+  r_mpint_init (&x);
+  r_mpint_init (&y);
+  r_mpint_init (&expected);
+  r_assert (r_dh_pub_key_get_p (a_priv, &p));
+  r_assert (r_dh_pub_key_get_g (a_priv, &g));
+  r_assert (r_dh_priv_key_get_x (a_priv, &x));
+  r_assert (r_dh_pub_key_get_y (a_priv, &y));
+  r_assert (r_mpint_expmod (&expected, &g, &x, &p));
+  r_assert_cmpint (r_mpint_cmp (&y, &expected), ==, 0);
+
+  r_assert (r_dh_pub_key_get_y (b_priv, &y));
+  r_assert_cmpptr ((b_pub = r_dh_pub_key_new (&p, &g, &y)), !=, NULL);
+  r_assert_cmpint (r_dh_compute_shared (a_priv, b_pub, shared, &size),
+      ==, R_CRYPTO_OK);
+  pbytes = (r_mpint_bits_used (&p) + 7) / 8;
+  r_assert_cmpuint (size, ==, pbytes);
+  r_assert (r_mpint_expmod (&expected, &y, &x, &p));
+  r_assert (r_mpint_to_binary_with_size (&expected, ref, pbytes));
+  r_assert_cmpmem (shared, ==, ref, pbytes);
+
+  /* A full-width x (e.g. imported) on the same group must not be cut
+   * short at the generated keys' exponent width */
+  r_crypto_key_unref (a_priv);
+  r_assert (r_mpint_sub_i32 (&x, &p, 2));
+  r_assert (r_mpint_sub (&x, &x, &expected));
+  r_assert (r_mpint_expmod (&expected, &g, &x, &p));
+  r_assert_cmpptr ((a_priv = r_dh_priv_key_new (&p, &g, &expected, &x)), !=, NULL);
+  size = sizeof (shared);
+  r_assert_cmpint (r_dh_compute_shared (a_priv, b_pub, shared, &size),
+      ==, R_CRYPTO_OK);
+  r_assert (r_mpint_expmod (&expected, &y, &x, &p));
+  r_assert (r_mpint_to_binary_with_size (&expected, ref, pbytes));
+  r_assert_cmpmem (shared, ==, ref, pbytes);
+
+  r_mpint_clear (&p);
+  r_mpint_clear (&g);
+  r_mpint_clear (&x);
+  r_mpint_clear (&y);
+  r_mpint_clear (&expected);
+  r_crypto_key_unref (a_priv);
+  r_crypto_key_unref (b_priv);
+  r_crypto_key_unref (b_pub);
+  r_prng_unref (prng);
+}
+RTEST_END;
+
 static RCryptoKey *
 encode_then_decode_pub (const RCryptoKey * pub)
 {
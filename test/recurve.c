@@ -236,6 +236,184 @@ RTEST_LOOP (recurve, scalar_mul_known_answer, RTEST_SLOW,
 }
 RTEST_END;
 
+/* secp256r1 / secp384r1 run on their own field code: a comb when the
+ * base is G and a 4-bit window otherwise. Cross-check both against
+ * the generic affine add and each other, including the scalars that
+ * make the accumulator meet the table entries. */
+static const REcurveID nist_curves[] = {
+  R_ECURVE_ID_SECP256R1,
+  R_ECURVE_ID_SECP384R1,
+};
+
+RTEST_LOOP (recurve, nist_scalar_mul_consistency, RTEST_FAST,
+    0, R_N_ELEMENTS (nist_curves))
+{
+  static const rchar * big_hex[] = {
+    "0x123456789abcdef0fedcba9876543210deadbeefcafef00d0123456789abcdef",
+    "0x7fffffffffffffffffffffffffffffffffffffffffffffff8000000000000001",
+  };
+  REcurve curve;
+  REcurveAffinePoint expected, product, G2, P, Q, tmp;
+  rmpint k, k2, a, b;
+  ruint32 i;
+
+  r_assert (r_ecurve_init (&curve, nist_curves[__i]));
+  r_ecurve_point_init (&expected);
+  r_ecurve_point_init (&product);
+  r_ecurve_point_init (&G2);
+  r_ecurve_point_init (&P);
+  r_ecurve_point_init (&Q);
+  r_ecurve_point_init (&tmp);
+  r_mpint_init (&k);
+  r_mpint_init (&k2);
+
+  /* Comb: k * G against k repeated affine additions. */
+  r_ecurve_point_set_infinity (&expected);
+  for (i = 1; i <= 40; i++) {
+    r_assert (r_ecurve_point_add (&expected, &expected, &curve.G, &curve));
+    r_mpint_set_u32 (&k, i);
+    r_assert (r_ecurve_point_scalar_mul (&product, &k, &curve.G, &curve));
+    r_assert (!product.is_infinity);
+    r_assert_cmpint (r_mpint_cmp (&product.x, &expected.x), ==, 0);
+    r_assert_cmpint (r_mpint_cmp (&product.y, &expected.y), ==, 0);
+  }
+
+  /* Window: k * (2G) == (2k) * G, for small k and for large ones. */
+  r_assert (r_ecurve_point_dbl (&G2, &curve.G, &curve));
+  for (i = 1; i <= 20; i++) {
+    r_mpint_set_u32 (&k, i);
+    r_mpint_set_u32 (&k2, 2 * i);
+    r_assert (r_ecurve_point_scalar_mul (&product, &k, &G2, &curve));
+    r_assert (r_ecurve_point_scalar_mul (&expected, &k2, &curve.G, &curve));
+    r_assert_cmpint (r_mpint_cmp (&product.x, &expected.x), ==, 0);
+    r_assert_cmpint (r_mpint_cmp (&product.y, &expected.y), ==, 0);
+  }
+  for (i = 0; i < R_N_ELEMENTS (big_hex); i++) {
+    r_mpint_clear (&k);
+    r_mpint_init_str (&k, big_hex[i], NULL, 16);
+    r_assert (r_mpint_add (&k2, &k, &k));
+    r_assert (r_ecurve_point_scalar_mul (&product, &k, &G2, &curve));
+    r_assert (r_ecurve_point_scalar_mul (&expected, &k2, &curve.G, &curve));
+    r_assert_cmpint (r_mpint_cmp (&product.x, &expected.x), ==, 0);
+    r_assert_cmpint (r_mpint_cmp (&product.y, &expected.y), ==, 0);
+    r_assert (r_ecurve_point_is_on_curve (&product, &curve));
+  }
+
+  /* (n - 1) * G == -G through both paths. */
+  r_assert (r_mpint_sub_u32 (&k, &curve.n, 1));
+  r_assert (r_ecurve_point_neg (&expected, &curve.G, &curve));
+  r_assert (r_ecurve_point_scalar_mul (&product, &k, &curve.G, &curve));
+  r_assert_cmpint (r_mpint_cmp (&product.x, &expected.x), ==, 0);
+  r_assert_cmpint (r_mpint_cmp (&product.y, &expected.y), ==, 0);
+  r_assert (r_ecurve_point_neg (&expected, &G2, &curve));
+  r_assert (r_ecurve_point_scalar_mul (&product, &k, &G2, &curve));
+  r_assert_cmpint (r_mpint_cmp (&product.x, &expected.x), ==, 0);
+  r_assert_cmpint (r_mpint_cmp (&product.y, &expected.y), ==, 0);
+  r_assert (r_ecurve_point_scalar_mul (&product, &curve.n, &G2, &curve));
+  r_assert (product.is_infinity);
+
+  /* Diffie-Hellman symmetry: a * (b * G) == b * (a * G). */
+  r_mpint_init_str (&a, big_hex[0], NULL, 16);
+  r_mpint_init_str (&b, big_hex[1], NULL, 16);
+  r_assert (r_ecurve_point_scalar_mul (&P, &a, &curve.G, &curve));
+  r_assert (r_ecurve_point_scalar_mul (&Q, &b, &curve.G, &curve));
+  r_assert (r_ecurve_point_scalar_mul (&tmp, &b, &P, &curve));
+  r_assert (r_ecurve_point_scalar_mul (&product, &a, &Q, &curve));
+  r_assert_cmpint (r_mpint_cmp (&product.x, &tmp.x), ==, 0);
+  r_assert_cmpint (r_mpint_cmp (&product.y, &tmp.y), ==, 0);
+
+  r_ecurve_point_clear (&expected);
+  r_ecurve_point_clear (&product);
+  r_ecurve_point_clear (&G2);
+  r_ecurve_point_clear (&P);
+  r_ecurve_point_clear (&Q);
+  r_ecurve_point_clear (&tmp);
+  r_mpint_clear (&k);
+  r_mpint_clear (&k2);
+  r_mpint_clear (&a);
+  r_mpint_clear (&b);
+  r_ecurve_clear (&curve);
+}
+RTEST_END;
+
+RTEST_LOOP (recurve, double_scalar_mul_vartime, RTEST_FAST,
+    0, R_N_ELEMENTS (all_curves))
+{
+  static const rchar * u_hex[] = {
+    "0x0", "0x1", "0x2", "0x3f", "0x40", "0x41",
+    "0x123456789abcdef0fedcba9876543210deadbeefcafef00d0123456789abcdef",
+    "0x8000000000000000000000000000000000000000000000000000000000000001",
+  };
+  REcurve curve;
+  REcurveAffinePoint Q, u1G, u2Q, expected, product;
+  rmpint u1, u2, d;
+  rsize i, j;
+
+  r_assert (r_ecurve_init (&curve, all_curves[__i]));
+  r_ecurve_point_init (&Q);
+  r_ecurve_point_init (&u1G);
+  r_ecurve_point_init (&u2Q);
+  r_ecurve_point_init (&expected);
+  r_ecurve_point_init (&product);
+  r_mpint_init_str (&d, "0xc0ffee1234567", NULL, 16);
+  r_assert (r_ecurve_point_scalar_mul (&Q, &d, &curve.G, &curve));
+
+  for (i = 0; i < R_N_ELEMENTS (u_hex); i++) {
+    for (j = 0; j < R_N_ELEMENTS (u_hex); j += 3) {
+      r_mpint_init_str (&u1, u_hex[i], NULL, 16);
+      r_mpint_init_str (&u2, u_hex[j], NULL, 16);
+      r_assert (r_mpint_mod (&u1, &u1, &curve.n));
+      r_assert (r_mpint_mod (&u2, &u2, &curve.n));
+
+      r_assert (r_ecurve_point_scalar_mul (&u1G, &u1, &curve.G, &curve));
+      r_assert (r_ecurve_point_scalar_mul (&u2Q, &u2, &Q, &curve));
+      r_assert (r_ecurve_point_add (&expected, &u1G, &u2Q, &curve));
+      r_assert (r_ecurve_point_double_scalar_mul_vartime (&product, &u1, &u2, &Q, &curve));
+      r_assert_cmpint (product.is_infinity, ==, expected.is_infinity);
+      if (!expected.is_infinity) {
+        r_assert_cmpint (r_mpint_cmp (&product.x, &expected.x), ==, 0);
+        r_assert_cmpint (r_mpint_cmp (&product.y, &expected.y), ==, 0);
+      }
+
+      r_mpint_clear (&u1);
+      r_mpint_clear (&u2);
+    }
+  }
+
+  /* Both halves landing on the same point, and cancelling out:
+   * u1 G + u2 G with u1 == u2, then with u1 == n - u2. */
+  r_mpint_init_str (&u1, u_hex[6], NULL, 16);
+  r_assert (r_mpint_mod (&u1, &u1, &curve.n));
+  r_assert (r_ecurve_point_double_scalar_mul_vartime (&product, &u1, &u1, &curve.G, &curve));
+  r_mpint_init (&u2);
+  r_assert (r_mpint_add (&u2, &u1, &u1));
+  r_assert (r_mpint_mod (&u2, &u2, &curve.n));
+  r_assert (r_ecurve_point_scalar_mul (&expected, &u2, &curve.G, &curve));
+  r_assert_cmpint (r_mpint_cmp (&product.x, &expected.x), ==, 0);
+  r_assert_cmpint (r_mpint_cmp (&product.y, &expected.y), ==, 0);
+  r_assert (r_mpint_sub (&u2, &curve.n, &u1));
+  r_assert (r_ecurve_point_double_scalar_mul_vartime (&product, &u1, &u2, &curve.G, &curve));
+  r_assert (product.is_infinity);
+
+  /* An infinite Q contributes nothing. */
+  r_ecurve_point_set_infinity (&Q);
+  r_assert (r_ecurve_point_double_scalar_mul_vartime (&product, &u1, &u2, &Q, &curve));
+  r_assert (r_ecurve_point_scalar_mul (&expected, &u1, &curve.G, &curve));
+  r_assert_cmpint (r_mpint_cmp (&product.x, &expected.x), ==, 0);
+  r_assert_cmpint (r_mpint_cmp (&product.y, &expected.y), ==, 0);
+
+  r_ecurve_point_clear (&Q);
+  r_ecurve_point_clear (&u1G);
+  r_ecurve_point_clear (&u2Q);
+  r_ecurve_point_clear (&expected);
+  r_ecurve_point_clear (&product);
+  r_mpint_clear (&u1);
+  r_mpint_clear (&u2);
+  r_mpint_clear (&d);
+  r_ecurve_clear (&curve);
+}
+RTEST_END;
+
 RTEST (recurve, id_from_oid, RTEST_FAST)
 {
   REcurveID id;
@@ -111,6 +111,54 @@ RTEST (revloop, current, RTEST_FAST)
 }
 RTEST_END;
 
+static void
+perf_sample_cb (rpointer data, REvLoop * loop, const RPerfSample * sample,
+    rsize iterations)
+{
+  rsize * counts = data;
+
+  (void) loop;
+  r_assert_cmpuint (sample->valid, !=, 0);
+  r_assert_cmpuint (iterations, >, 0);
+  r_assert_cmpuint (iterations, <=, 2);
+  counts[0]++;
+  counts[1] += iterations;
+}
+
+RTEST (revloop, perf_sampler, RTEST_FAST | RTEST_SYSTEM)
+{
+  REvLoop * loop;
+  RPerfSample total;
+  rsize counts[2] = { 0, 0 }, idle = 5, iterations;
+
+  r_assert_cmpptr ((loop = r_ev_loop_new ()), !=, NULL);
+  r_assert (!r_ev_loop_get_perf_stats (loop, &total, NULL));
+  r_assert (!r_ev_loop_set_perf_sampler (loop, R_PERF_COUNTER_MASK_ALL, 0,
+        NULL, NULL, NULL));
+  r_assert (r_ev_loop_set_perf_sampler (loop, R_PERF_COUNTER_MASK_ALL, 2,
+        perf_sample_cb, counts, NULL));
+
+  r_assert (r_ev_loop_add_idle (loop, idle_cb, &idle, NULL));
+  r_assert_cmpuint (r_ev_loop_run (loop, R_EV_LOOP_RUN_LOOP), ==, 0);
+  r_assert_cmpuint (r_ev_loop_get_iterations (loop), ==, 5);
+
+  /* Without any counters there's nothing to sample */
+  if (r_ev_loop_get_perf_stats (loop, &total, &iterations)) {
+    r_assert_cmpuint (total.valid, !=, 0);
+    r_assert_cmpuint (iterations, ==, 5);
+    r_assert_cmpuint (counts[0], ==, 3);
+    r_assert_cmpuint (counts[1], ==, 5);
+  } else {
+    r_assert_cmpuint (counts[0], ==, 0);
+  }
+
+  r_assert (r_ev_loop_set_perf_sampler (loop, 0, 0, NULL, NULL, NULL));
+  r_assert (!r_ev_loop_get_perf_stats (loop, &total, NULL));
+
+  r_ev_loop_unref (loop);
+}
+RTEST_END;
+
 static void
 increment_rsize (rpointer data, REvLoop * loop)
 {
@@ -38,6 +38,23 @@ data_counted (rpointer data, RBuffer * buf, REvTCP * evtcp)
     *((rsize *)data) += r_buffer_get_size (buf);
 }
 
+/* Check received bytes against the (offset * 7) pattern as they arrive. */
+static void
+data_pattern_checked (rpointer data, RBuffer * buf, REvTCP * evtcp)
+{
+  rsize * offset = data;
+  RMemMapInfo info = R_MEM_MAP_INFO_INIT;
+  rsize i;
+
+  (void) evtcp;
+  if (buf == NULL)
+    return;
+  r_assert (r_buffer_map (buf, &info, R_MEM_MAP_READ));
+  for (i = 0; i < info.size; i++, (*offset)++)
+    r_assert_cmpuint (info.data[i], ==, (ruint8) (*offset * 7));
+  r_buffer_unmap (buf, &info);
+}
+
 typedef struct {
   rsize bytes;
   rboolean eos;
@@ -307,6 +324,140 @@ RTEST (revtcp, queued_send_recv, RTEST_FAST | RTEST_SYSTEM)
 }
 RTEST_END;
 
+/* A single send larger than the socket buffers goes out over several
+ * partial writes; every byte must arrive, in order. */
+RTEST (revtcp, large_send_recv, RTEST_FAST | RTEST_SYSTEM)
+{
+  REvLoop * loop;
+  RClock * clock;
+  RSocketAddress * addr;
+  REvTCP * server, * servcli = NULL, * client;
+  rboolean conn = FALSE;
+  rsize received = 0;
+  ruint8 * payload;
+  rsize i;
+  const rsize size = 16 * 1024 * 1024;
+
+  r_assert_cmpptr ((payload = r_malloc (size)), !=, NULL);
+  for (i = 0; i < size; i++)
+    payload[i] = (ruint8) (i * 7);
+
+  r_assert_cmpptr ((clock = r_test_clock_new (FALSE)), !=, NULL);
+  r_assert_cmpptr ((loop = r_ev_loop_new_full (clock, NULL)), !=, NULL);
+  r_clock_unref (clock);
+
+  r_assert_cmpptr ((client = r_ev_tcp_new (R_SOCKET_FAMILY_IPV4, loop)), !=, NULL);
+  r_assert_cmpptr ((server = r_ev_tcp_new (R_SOCKET_FAMILY_IPV4, loop)), !=, NULL);
+  r_assert_cmpptr ((addr = r_socket_address_ipv4_new_uint8 (127, 0, 0, 1, 0)), !=, NULL);
+  r_assert_cmpint (r_ev_tcp_bind (server, addr, TRUE), ==, R_SOCKET_OK);
+  r_socket_address_unref (addr);
+  r_assert_cmpptr ((addr = r_ev_tcp_get_local_address (server)), !=, NULL);
+  r_assert_cmpint (r_ev_tcp_listen (server, 10, new_connection_ready, &servcli, NULL), ==, R_SOCKET_OK);
+  r_assert_cmpint (r_ev_tcp_connect (client, addr, client_connected, &conn, NULL), ==, R_SOCKET_WOULD_BLOCK);
+  r_socket_address_unref (addr);
+
+  while (servcli == NULL)
+    r_assert_cmpuint (r_ev_loop_run (loop, R_EV_LOOP_RUN_ONCE), >, 0);
+  r_assert (conn);
+  r_assert (r_ev_tcp_close (server, NULL, NULL, NULL));
+  r_ev_tcp_unref (server);
+
+  r_assert (r_ev_tcp_recv_start (servcli, NULL, data_pattern_checked, &received, NULL));
+  r_assert (r_ev_tcp_send_take (client, payload, size, NULL, NULL, NULL));
+
+  while (received < size)
+    r_assert_cmpuint (r_ev_loop_run (loop, R_EV_LOOP_RUN_ONCE), >, 0);
+  r_assert_cmpuint (received, ==, size);
+  r_assert (r_ev_tcp_recv_stop (servcli));
+
+  r_assert (r_ev_tcp_close (client, NULL, NULL, NULL));
+  r_assert (r_ev_tcp_close (servcli, NULL, NULL, NULL));
+  r_assert_cmpuint (r_ev_loop_run (loop, R_EV_LOOP_RUN_LOOP), ==, 0);
+
+  r_ev_tcp_unref (client);
+  r_ev_tcp_unref (servcli);
+  r_ev_loop_unref (loop);
+}
+RTEST_END;
+
+#if defined (R_OS_LINUX)
+static void
+file_sent (rpointer data, RBuffer * buf, REvTCP * evtcp)
+{
+  (void) evtcp;
+  r_assert_cmpptr (buf, ==, NULL);
+  *((rboolean *)data) = TRUE;
+}
+
+/* A file range queued between two plain sends goes out through sendfile,
+ * over several partial writes, in order with the buffers around it. */
+RTEST (revtcp, send_file, RTEST_FAST | RTEST_SYSTEM)
+{
+  REvLoop * loop;
+  RClock * clock;
+  RSocketAddress * addr;
+  REvTCP * server, * servcli = NULL, * client;
+  rboolean conn = FALSE, sent = FALSE;
+  rsize received = 0;
+  RFile * file;
+  ruint8 * payload;
+  rsize i, res;
+  const rsize size = 4 * 1024 * 1024, head = 1000, tail = 500;
+
+  r_assert_cmpptr ((payload = r_malloc (size)), !=, NULL);
+  for (i = 0; i < size; i++)
+    payload[i] = (ruint8) (i * 7);
+  r_assert_cmpptr ((file = r_file_new_tmp_full (NULL, "revtcp", "w+", NULL)), !=, NULL);
+  r_assert_cmpint (r_file_write (file, payload, size, &res), ==, R_FILE_ERROR_OK);
+  r_assert_cmpuint (res, ==, size);
+  r_file_flush (file);
+
+  r_assert_cmpptr ((clock = r_test_clock_new (FALSE)), !=, NULL);
+  r_assert_cmpptr ((loop = r_ev_loop_new_full (clock, NULL)), !=, NULL);
+  r_clock_unref (clock);
+
+  r_assert_cmpptr ((client = r_ev_tcp_new (R_SOCKET_FAMILY_IPV4, loop)), !=, NULL);
+  r_assert_cmpptr ((server = r_ev_tcp_new (R_SOCKET_FAMILY_IPV4, loop)), !=, NULL);
+  r_assert_cmpptr ((addr = r_socket_address_ipv4_new_uint8 (127, 0, 0, 1, 0)), !=, NULL);
+  r_assert_cmpint (r_ev_tcp_bind (server, addr, TRUE), ==, R_SOCKET_OK);
+  r_socket_address_unref (addr);
+  r_assert_cmpptr ((addr = r_ev_tcp_get_local_address (server)), !=, NULL);
+  r_assert_cmpint (r_ev_tcp_listen (server, 10, new_connection_ready, &servcli, NULL), ==, R_SOCKET_OK);
+  r_assert_cmpint (r_ev_tcp_connect (client, addr, client_connected, &conn, NULL), ==, R_SOCKET_WOULD_BLOCK);
+  r_socket_address_unref (addr);
+
+  while (servcli == NULL)
+    r_assert_cmpuint (r_ev_loop_run (loop, R_EV_LOOP_RUN_ONCE), >, 0);
+  r_assert (conn);
+  r_assert (r_ev_tcp_close (server, NULL, NULL, NULL));
+  r_ev_tcp_unref (server);
+
+  r_assert (!r_ev_tcp_send_file (client, r_file_get_fd (file), 0, 0, NULL, NULL, NULL));
+  r_assert (r_ev_tcp_recv_start (servcli, NULL, data_pattern_checked, &received, NULL));
+  r_assert (r_ev_tcp_send_dup (client, payload, head, NULL, NULL, NULL));
+  r_assert (r_ev_tcp_send_file (client, r_file_get_fd (file), head,
+        size - head - tail, file_sent, &sent, NULL));
+  r_assert (r_ev_tcp_send_dup (client, payload + size - tail, tail, NULL, NULL, NULL));
+
+  while (received < size)
+    r_assert_cmpuint (r_ev_loop_run (loop, R_EV_LOOP_RUN_ONCE), >, 0);
+  r_assert_cmpuint (received, ==, size);
+  r_assert (sent);
+  r_assert (r_ev_tcp_recv_stop (servcli));
+
+  r_assert (r_ev_tcp_close (client, NULL, NULL, NULL));
+  r_assert (r_ev_tcp_close (servcli, NULL, NULL, NULL));
+  r_assert_cmpuint (r_ev_loop_run (loop, R_EV_LOOP_RUN_LOOP), ==, 0);
+
+  r_ev_tcp_unref (client);
+  r_ev_tcp_unref (servcli);
+  r_ev_loop_unref (loop);
+  r_file_unref (file);
+  r_free (payload);
+}
+RTEST_END;
+#endif
+
 /* These two exercise an abortive close (peer RST) and assert the client
  * observes it promptly. Every backend manages this except a forced Windows
  * rpoll build: there, an abortive RST on a loopback socket is intermittently
@@ -0,0 +1,123 @@
+#include <rlib/rlib.h>
+
+/* Reference vectors from the SipHash paper: key 00..0f, message 00..(n-1). */
+RTEST (rhashfuncs, siphash24_vectors, RTEST_FAST)
+{
+  ruint8 key[16], msg[64];
+  ruint i;
+
+  for (i = 0; i < sizeof (key); i++)
+    key[i] = (ruint8)i;
+  for (i = 0; i < sizeof (msg); i++)
+    msg[i] = (ruint8)i;
+
+  r_assert_cmphex (r_siphash24 (key, msg, 0), ==, RUINT64_CONSTANT (0x726fdb47dd0e0e31));
+  r_assert_cmphex (r_siphash24 (key, msg, 1), ==, RUINT64_CONSTANT (0x74f839c593dc67fd));
+  r_assert_cmphex (r_siphash24 (key, msg, 15), ==, RUINT64_CONSTANT (0xa129ca6149be45e5));
+  r_assert_cmphex (r_siphash24 (key, msg, 63), ==, RUINT64_CONSTANT (0x958a324ceb064572));
+}
+RTEST_END;
+
+/* Reference vectors of wyhash final4 (seed = vector index). */
+RTEST (rhashfuncs, hash_bytes_vectors, RTEST_FAST)
+{
+  static const struct {
+    const rchar * msg;
+    ruint64 hash;
+  } vectors[] = {
+    { "", RUINT64_CONSTANT (0x0409638ee2bde459) },
+    { "a", RUINT64_CONSTANT (0xa8412d091b5fe0a9) },
+    { "abc", RUINT64_CONSTANT (0x32dd92e4b2915153) },
+    { "message digest", RUINT64_CONSTANT (0x8619124089a3a16b) },
+    { "abcdefghijklmnopqrstuvwxyz", RUINT64_CONSTANT (0x7a43afb61d7f5f40) },
+    { "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789",
+      RUINT64_CONSTANT (0xff42329b90e50d58) },
+    { "12345678901234567890123456789012345678901234567890123456789012345678901234567890",
+      RUINT64_CONSTANT (0xc39cab13b115aad3) },
+  };
+  ruint i;
+
+  for (i = 0; i < R_N_ELEMENTS (vectors); i++) {
+    r_assert_cmphex (r_hash_bytes (vectors[i].msg, r_strlen (vectors[i].msg), i),
+        ==, vectors[i].hash);
+  }
+}
+RTEST_END;
+
+/* Both entry points hash a string identically at every length, across the
+ * short, striped and (where available) AES paths. */
+RTEST (rhashfuncs, str_hash_sized_matches, RTEST_FAST)
+{
+  rchar buf[700];
+  ruint i;
+
+  for (i = 0; i < sizeof (buf) - 1; i++)
+    buf[i] = (rchar)('a' + (i * 7) % 26);
+
+  for (i = 0; i < sizeof (buf); i++) {
+    rchar c = buf[i];
+    buf[i] = 0;
+    r_assert_cmpuint (r_str_hash (buf), ==, r_str_hash_sized (buf, i));
+    r_assert_cmpuint (r_str_hash (buf), ==, r_str_hash_sized (buf, -1));
+    r_assert_cmpuint (r_str_hash_keyed (buf), ==, r_str_hash_keyed_sized (buf, i));
+    r_assert_cmpuint (r_str_hash_keyed (buf), ==, r_str_hash_keyed_sized (buf, -1));
+    buf[i] = c;
+  }
+
+  r_assert_cmpuint (r_str_hash (NULL), ==, r_str_hash (""));
+  r_assert_cmpuint (r_str_hash_sized (NULL, 0), ==, r_str_hash (""));
+  r_assert_cmpuint (r_str_hash_keyed (NULL), ==, r_str_hash_keyed (""));
+}
+RTEST_END;
+
+/* Flipping any single byte changes the hash -- head, stripes and the
+ * overlapping tail all feed the result. */
+RTEST (rhashfuncs, str_hash_every_byte_counts, RTEST_FAST)
+{
+  static const rsize lens[] = { 3, 8, 16, 17, 47, 48, 49, 100, 255, 256, 257, 319, 1000 };
+  ruint8 buf[1000];
+  rsize i, l;
+
+  for (i = 0; i < sizeof (buf); i++)
+    buf[i] = (ruint8)(i * 131 + 7);
+
+  for (l = 0; l < R_N_ELEMENTS (lens); l++) {
+    rsize len = lens[l];
+    rsize h = r_str_hash_sized ((const rchar *)buf, len);
+    rsize k = r_str_hash_keyed_sized ((const rchar *)buf, len);
+    ruint64 b = r_hash_bytes (buf, len, 42);
+
+    for (i = 0; i < len; i++) {
+      buf[i] ^= 0x01;
+      r_assert_cmpuint (r_str_hash_sized ((const rchar *)buf, len), !=, h);
+      r_assert_cmpuint (r_str_hash_keyed_sized ((const rchar *)buf, len), !=, k);
+      r_assert_cmphex (r_hash_bytes (buf, len, 42), !=, b);
+      buf[i] ^= 0x01;
+    }
+    /* ... and so does the length itself */
+    r_assert_cmpuint (r_str_hash_sized ((const rchar *)buf, len - 1), !=, h);
+  }
+}
+RTEST_END;
+
+/* String tables keyed with the SipHash variant behave like any other. */
+RTEST (rhashfuncs, hash_table_keyed_str, RTEST_FAST)
+{
+  RHashTable * ht;
+  rsize i;
+
+  r_assert_cmpptr ((ht = r_hash_table_new_full (r_str_hash_keyed, r_str_equal,
+          r_free, NULL)), !=, NULL);
+  for (i = 0; i < 1000; i++) {
+    r_assert_cmpint (r_hash_table_insert (ht, r_strprintf ("hdr-%"RSIZE_FMT, i),
+          RSIZE_TO_POINTER (i + 1)), ==, R_HASH_TABLE_OK);
+  }
+  for (i = 0; i < 1000; i++) {
+    rchar * key = r_strprintf ("hdr-%"RSIZE_FMT, i);
+    r_assert_cmpuint (RPOINTER_TO_SIZE (r_hash_table_lookup (ht, key)), ==, i + 1);
+    r_free (key);
+  }
+  r_assert_cmpptr (r_hash_table_lookup (ht, "hdr-1000"), ==, NULL);
+  r_hash_table_unref (ht);
+}
+RTEST_END;
@@ -216,3 +216,61 @@ RTEST (rhashset, sequential_items_stay_well_distributed, RTEST_FAST)
   r_hash_set_unref (hs);
 }
 RTEST_END;
+
+RTEST (rhashset, grouped_insert_remove, RTEST_FAST)
+{
+  RHashSet * hs;
+  rpointer p;
+  rsize i;
+  const rsize n = 10000;
+
+  r_assert_cmpptr ((hs = r_hash_set_new_with_flags (NULL, NULL, NULL,
+          R_HASH_FLAG_GROUPED)), !=, NULL);
+  r_assert_cmpuint (r_hash_set_current_alloc_size (hs), ==, 0);
+  r_assert (!r_hash_set_contains (hs, RUINT_TO_POINTER (0)));
+  r_assert (!r_hash_set_remove (hs, RUINT_TO_POINTER (0)));
+
+  for (i = 0; i < n; i++) {
+    r_assert (r_hash_set_insert (hs, RSIZE_TO_POINTER (i)));
+    r_assert (!r_hash_set_contains (hs, RSIZE_TO_POINTER (n + i)));
+  }
+  r_assert_cmpuint (r_hash_set_size (hs), ==, n);
+  r_assert_cmpuint (r_hash_set_max_probe (hs), <=, 8);
+  r_assert (r_hash_set_contains_full (hs, RSIZE_TO_POINTER (42), &p));
+  r_assert_cmpuint (RPOINTER_TO_SIZE (p), ==, 42);
+
+  for (i = 0; i < n; i += 2)
+    r_assert (r_hash_set_remove (hs, RSIZE_TO_POINTER (i)));
+  r_assert_cmpuint (r_hash_set_size (hs), ==, n / 2);
+  for (i = 0; i < n; i++)
+    r_assert_cmpint (r_hash_set_contains (hs, RSIZE_TO_POINTER (i)), ==, (i & 1) != 0);
+
+  r_assert (r_hash_set_steal (hs, RSIZE_TO_POINTER (1), &p));
+  r_assert_cmpuint (RPOINTER_TO_SIZE (p), ==, 1);
+  r_assert (!r_hash_set_steal (hs, RSIZE_TO_POINTER (1), &p));
+  r_assert_cmpptr (p, ==, NULL);
+
+  r_hash_set_remove_all (hs);
+  r_assert_cmpuint (r_hash_set_size (hs), ==, 0);
+  r_assert (!r_hash_set_contains (hs, RSIZE_TO_POINTER (3)));
+  r_hash_set_unref (hs);
+}
+RTEST_END;
+
+RTEST (rhashset, grouped_str_notify, RTEST_FAST)
+{
+  RHashSet * hs;
+
+  r_assert_cmpptr ((hs = r_hash_set_new_with_flags (r_str_hash, r_str_equal,
+          r_free, R_HASH_FLAG_GROUPED)), !=, NULL);
+  r_assert (r_hash_set_insert (hs, r_strdup ("foo")));
+  r_assert (r_hash_set_insert (hs, r_strdup ("bar")));
+  r_assert (r_hash_set_insert (hs, r_strdup ("foo")));
+  r_assert_cmpuint (r_hash_set_size (hs), ==, 2);
+  r_assert (r_hash_set_contains (hs, "foo"));
+  r_assert (!r_hash_set_contains (hs, "baz"));
+  r_assert (r_hash_set_remove (hs, "bar"));
+  r_assert (!r_hash_set_contains (hs, "bar"));
+  r_hash_set_unref (hs);
+}
+RTEST_END;
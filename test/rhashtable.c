@@ -382,3 +382,162 @@ RTEST (rhashtable, sequential_keys_stay_well_distributed, RTEST_FAST)
   r_hash_table_unref (ht);
 }
 RTEST_END;
+
+RTEST (rhashtable, grouped_insert_1_remove, RTEST_FAST)
+{
+  RHashTable * ht;
+  rpointer k, v;
+
+  r_assert_cmpptr ((ht = r_hash_table_new_with_flags (NULL, NULL, NULL, NULL,
+          R_HASH_FLAG_GROUPED)), !=, NULL);
+  /* Nothing is allocated before the first insert. */
+  r_assert_cmpuint (r_hash_table_current_alloc_size (ht), ==, 0);
+  r_assert_cmpint (r_hash_table_contains (ht, RUINT_TO_POINTER (0)), ==, R_HASH_TABLE_NOT_FOUND);
+  r_assert_cmpint (r_hash_table_remove (ht, RUINT_TO_POINTER (0)), ==, R_HASH_TABLE_NOT_FOUND);
+
+  r_assert_cmpint (r_hash_table_insert (ht,
+        RUINT_TO_POINTER (0), RUINT_TO_POINTER (42)), ==, R_HASH_TABLE_OK);
+  r_assert_cmpuint (r_hash_table_current_alloc_size (ht), ==, 16);
+  r_assert_cmpuint (r_hash_table_size (ht), ==, 1);
+  r_assert_cmpuint (RPOINTER_TO_UINT (r_hash_table_lookup (ht,
+          RUINT_TO_POINTER (0))), ==, 42);
+  r_assert_cmpint (r_hash_table_lookup_full (ht, RUINT_TO_POINTER (0),
+        &k, &v), ==, R_HASH_TABLE_OK);
+  r_assert_cmpuint (RPOINTER_TO_UINT (k), ==, 0);
+  r_assert_cmpuint (RPOINTER_TO_UINT (v), ==, 42);
+
+  r_assert_cmpint (r_hash_table_insert (ht,
+        RUINT_TO_POINTER (0), RUINT_TO_POINTER (43)), ==, R_HASH_TABLE_OK);
+  r_assert_cmpuint (r_hash_table_size (ht), ==, 1);
+  r_assert_cmpuint (RPOINTER_TO_UINT (r_hash_table_lookup (ht,
+          RUINT_TO_POINTER (0))), ==, 43);
+
+  r_assert_cmpint (r_hash_table_remove (ht, RUINT_TO_POINTER (42)), ==, R_HASH_TABLE_NOT_FOUND);
+  r_assert_cmpint (r_hash_table_remove (ht, RUINT_TO_POINTER (0)), ==, R_HASH_TABLE_OK);
+  r_assert_cmpuint (r_hash_table_size (ht), ==, 0);
+  r_assert_cmpint (r_hash_table_contains (ht, RUINT_TO_POINTER (0)), ==, R_HASH_TABLE_NOT_FOUND);
+
+  r_hash_table_unref (ht);
+}
+RTEST_END;
+
+RTEST (rhashtable, grouped_many_keys, RTEST_FAST)
+{
+  RHashTable * ht;
+  rsize i;
+  const rsize n = 20000;
+
+  r_assert_cmpptr ((ht = r_hash_table_new_with_flags (NULL, NULL, NULL, NULL,
+          R_HASH_FLAG_GROUPED)), !=, NULL);
+  for (i = 0; i < n; i++) {
+    r_assert_cmpint (r_hash_table_insert (ht, RSIZE_TO_POINTER (i + 1),
+          RSIZE_TO_POINTER (i + 1)), ==, R_HASH_TABLE_OK);
+    r_assert_cmpint (r_hash_table_contains (ht, RSIZE_TO_POINTER (n + i + 1)),
+        ==, R_HASH_TABLE_NOT_FOUND);
+  }
+  r_assert_cmpuint (r_hash_table_size (ht), ==, n);
+  r_assert_cmpuint (r_hash_table_current_alloc_size (ht), >=, n);
+  r_assert_cmpuint (r_hash_table_max_probe (ht), <=, 8);
+
+  for (i = 0; i < n; i++)
+    r_assert_cmpuint (RPOINTER_TO_UINT (r_hash_table_lookup (ht,
+            RSIZE_TO_POINTER (i + 1))), ==, i + 1);
+
+  r_hash_table_remove_all (ht);
+  r_assert_cmpuint (r_hash_table_size (ht), ==, 0);
+  r_assert_cmpint (r_hash_table_contains (ht, RSIZE_TO_POINTER (1)), ==, R_HASH_TABLE_NOT_FOUND);
+  r_hash_table_unref (ht);
+}
+RTEST_END;
+
+/* Erase-heavy churn on a table kept at a constant size: deleted slots must be
+ * reclaimed in place (rebuilds at the same capacity) instead of growing the
+ * table without bound, and no live key may become unfindable. */
+RTEST (rhashtable, grouped_erase_churn, RTEST_FAST)
+{
+  RHashTable * ht;
+  rsize i, cap;
+  const rsize n = 1000, rounds = 50000;
+
+  r_assert_cmpptr ((ht = r_hash_table_new_with_flags (NULL, NULL, NULL, NULL,
+          R_HASH_FLAG_GROUPED)), !=, NULL);
+  for (i = 0; i < n; i++)
+    r_assert_cmpint (r_hash_table_insert (ht, RSIZE_TO_POINTER (i),
+          RSIZE_TO_POINTER (i)), ==, R_HASH_TABLE_OK);
+  cap = r_hash_table_current_alloc_size (ht);
+
+  for (i = 0; i < rounds; i++) {
+    r_assert_cmpint (r_hash_table_remove (ht, RSIZE_TO_POINTER (i)), ==, R_HASH_TABLE_OK);
+    r_assert_cmpint (r_hash_table_insert (ht, RSIZE_TO_POINTER (i + n),
+          RSIZE_TO_POINTER (i + n)), ==, R_HASH_TABLE_OK);
+  }
+
+  r_assert_cmpuint (r_hash_table_size (ht), ==, n);
+  r_assert_cmpuint (r_hash_table_current_alloc_size (ht), ==, cap);
+  for (i = 0; i < n; i++) {
+    r_assert_cmpuint (RPOINTER_TO_UINT (r_hash_table_lookup (ht,
+            RSIZE_TO_POINTER (rounds + i))), ==, rounds + i);
+    r_assert_cmpint (r_hash_table_contains (ht, RSIZE_TO_POINTER (i)),
+        ==, R_HASH_TABLE_NOT_FOUND);
+  }
+
+  r_hash_table_unref (ht);
+}
+RTEST_END;
+
+RTEST (rhashtable, grouped_str_notify_steal, RTEST_FAST)
+{
+  RHashTable * ht;
+  RBuffer * buf;
+  rpointer k, v;
+  ruint sum = 0;
+
+  r_assert_cmpptr ((buf = r_buffer_new ()), !=, NULL);
+  r_assert_cmpptr ((ht = r_hash_table_new_with_flags (r_str_hash, r_str_equal,
+          r_free, r_buffer_unref, R_HASH_FLAG_GROUPED)), !=, NULL);
+
+  r_assert_cmpint (r_hash_table_insert (ht, r_strdup ("foo"),
+        r_buffer_ref (buf)), ==, R_HASH_TABLE_OK);
+  r_assert_cmpint (r_hash_table_insert (ht, r_strdup ("bar"),
+        r_buffer_ref (buf)), ==, R_HASH_TABLE_OK);
+  r_assert_cmpint (r_hash_table_insert (ht, r_strdup ("baz"),
+        r_buffer_ref (buf)), ==, R_HASH_TABLE_OK);
+  r_assert_cmpuint (r_ref_refcount (buf), ==, 4);
+
+  /* Replacing notifies the old key and value. */
+  r_assert_cmpint (r_hash_table_insert (ht, r_strdup ("foo"),
+        r_buffer_ref (buf)), ==, R_HASH_TABLE_OK);
+  r_assert_cmpuint (r_ref_refcount (buf), ==, 4);
+  r_assert_cmpuint (r_hash_table_size (ht), ==, 3);
+
+  r_assert_cmpint (r_hash_table_steal (ht, "bar", &k, &v), ==, R_HASH_TABLE_OK);
+  r_assert_cmpstr (k, ==, "bar");
+  r_assert_cmpptr (v, ==, buf);
+  r_assert_cmpuint (r_ref_refcount (buf), ==, 4);
+  r_free (k);
+  r_buffer_unref (v);
+  r_assert_cmpint (r_hash_table_steal (ht, "bar", &k, &v), ==, R_HASH_TABLE_NOT_FOUND);
+  r_assert_cmpptr (k, ==, NULL);
+
+  r_assert_cmpint (r_hash_table_remove (ht, "baz"), ==, R_HASH_TABLE_OK);
+  r_assert_cmpuint (r_ref_refcount (buf), ==, 2);
+  r_assert_cmpuint (r_hash_table_size (ht), ==, 1);
+
+  r_hash_table_unref (ht);
+  r_assert_cmpuint (r_ref_refcount (buf), ==, 1);
+  r_buffer_unref (buf);
+
+  r_assert_cmpptr ((ht = r_hash_table_new_with_flags (r_str_hash, r_str_equal,
+          NULL, NULL, R_HASH_FLAG_GROUPED)), !=, NULL);
+  r_assert_cmpint (r_hash_table_insert (ht, "a", RUINT_TO_POINTER (42)), ==, R_HASH_TABLE_OK);
+  r_assert_cmpint (r_hash_table_insert (ht, "b", RUINT_TO_POINTER (22)), ==, R_HASH_TABLE_OK);
+  r_assert_cmpint (r_hash_table_insert (ht, "c", RUINT_TO_POINTER (42)), ==, R_HASH_TABLE_OK);
+  r_hash_table_foreach (ht, sum_value_uints, &sum);
+  r_assert_cmpuint (sum, ==, 42 + 22 + 42);
+  r_assert_cmpint (r_hash_table_remove_all_values (ht, RUINT_TO_POINTER (42)),
+      ==, R_HASH_TABLE_OK);
+  r_assert_cmpuint (r_hash_table_size (ht), ==, 1);
+  r_assert_cmpuint (RPOINTER_TO_UINT (r_hash_table_lookup (ht, "b")), ==, 22);
+  r_hash_table_unref (ht);
+}
+RTEST_END;
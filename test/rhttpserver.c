@@ -346,7 +346,7 @@ r_test_tls_client_appdata (rpointer data, RBuffer * buf, rpointer session)
 
 static const RTLSCallbacks g_test_tls_client_cbs = {
   NULL, r_test_tls_client_hs_done, r_test_tls_client_out,
-  r_test_tls_client_appdata, NULL, NULL, NULL, NULL,
+  r_test_tls_client_appdata, NULL, NULL, NULL, NULL, NULL,
 };
 
 static void
@@ -374,7 +374,8 @@ r_test_tls_client_connected (rpointer data, REvTCP * evtcp, int status)
   r_assert (r_ev_tcp_recv_start (c->tcp, NULL, r_test_tls_client_recv, c, NULL));
 }
 
-RTEST (rhttpserver, https_get, RTEST_FAST | RTEST_SYSTEM)
+static void
+r_test_https_get (rboolean ktls)
 {
   REvLoop * loop;
   RClock * clock;
@@ -389,6 +390,8 @@ RTEST (rhttpserver, https_get, RTEST_FAST | RTEST_SYSTEM)
   r_clock_unref (clock);
 
   r_assert_cmpptr ((srv = r_http_server_new (loop)), !=, NULL);
+  r_http_server_set_ktls_tx (srv, ktls);
+  r_http_server_set_ktls_rx (srv, ktls);
   r_assert_cmpptr ((cert = r_pem_parse_cert_from_data (testcertpem, -1)), !=, NULL);
   r_assert_cmpptr ((pk = r_pem_parse_key_from_data (testpkpem, -1, NULL, 0)), !=, NULL);
 
@@ -429,6 +432,20 @@ RTEST (rhttpserver, https_get, RTEST_FAST | RTEST_SYSTEM)
   r_socket_address_unref (addr);
   r_ev_loop_unref (loop);
 }
+
+RTEST (rhttpserver, https_get, RTEST_FAST | RTEST_SYSTEM)
+{
+  r_test_https_get (FALSE);
+}
+RTEST_END;
+
+/* Kernel TLS seals the response and opens the request where the kernel can
+ * (the tls module and the negotiated suite), the session itself where it
+ * cannot; either way the client reads the same response. */
+RTEST (rhttpserver, https_get_ktls, RTEST_FAST | RTEST_SYSTEM)
+{
+  r_test_https_get (TRUE);
+}
 RTEST_END;
 
 /* A plaintext HTTP request against a TLS listener: the bytes are not a valid
@@ -90,3 +90,38 @@ RTEST (rhzrptr, read_replace, RTEST_FAST)
 }
 RTEST_END;
 
+
+static void
+test_hzr_count_notify (rpointer ptr)
+{
+  (*(rsize *)ptr)++;
+}
+
+RTEST (rhzrptr, retire_reclaims, RTEST_FAST)
+{
+  RHzrPtrRec * rec = r_hzr_ptr_rec_new ();
+  rsize counts[1024] = { 0 };
+  rsize i, freed = 0;
+
+  /* Keep a hazard on the first one: every other retired pointer gets
+   * reclaimed once the retired list outgrows the scan threshold. */
+  r_hzr_ptr_protect (rec, &counts[0]);
+  for (i = 0; i < R_N_ELEMENTS (counts); i++)
+    r_hzr_ptr_retire (&counts[i], test_hzr_count_notify);
+
+  r_assert_cmpuint (counts[0], ==, 0);
+  for (i = 1; i < R_N_ELEMENTS (counts); i++) {
+    r_assert_cmpuint (counts[i], <=, 1);
+    freed += counts[i];
+  }
+  r_assert_cmpuint (freed, >, R_N_ELEMENTS (counts) / 2);
+
+  /* Dropping the hazard lets the next scan reclaim it too. */
+  r_hzr_ptr_protect (rec, NULL);
+  for (i = 1; counts[0] == 0 && i < R_N_ELEMENTS (counts); i++)
+    r_hzr_ptr_retire (&counts[i], NULL);
+  r_assert_cmpuint (counts[0], ==, 1);
+
+  r_hzr_ptr_rec_free (rec);
+}
+RTEST_END;
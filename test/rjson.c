@@ -186,6 +186,56 @@ RTEST (rjson, create_object, RTEST_FAST)
 }
 RTEST_END;
 
+/* Large objects are looked up through a hash index; field order and
+ * first-duplicate-wins must match the small-object linear search. */
+RTEST (rjson, object_field_index, RTEST_FAST)
+{
+  RJsonValue * obj, * k, * v, * tmp;
+  rchar name[16];
+  ruint i;
+
+  r_assert_cmpptr ((obj = r_json_object_new ()), !=, NULL);
+  for (i = 0; i < 100; i++) {
+    r_snprintf (name, sizeof (name), "field%u", i);
+    k = r_json_string_new_unescaped (name, -1);
+    v = r_json_number_new_double (i);
+    r_assert_cmpint (r_json_object_add_field (obj, k, v), ==, R_JSON_OK);
+    r_json_value_unref (k);
+    r_json_value_unref (v);
+  }
+  k = r_json_string_new_static_unescaped ("field7");
+  v = r_json_null_new ();
+  r_assert_cmpint (r_json_object_add_field (obj, k, v), ==, R_JSON_OK);
+  r_json_value_unref (k);
+  r_json_value_unref (v);
+
+  for (i = 0; i < 100; i++) {
+    r_snprintf (name, sizeof (name), "field%u", i);
+    r_assert_cmpptr ((tmp = r_json_value_get_object_field (obj, name)), !=, NULL);
+    r_assert_cmpint (r_json_value_get_number_int (tmp), ==, (int) i);
+    r_json_value_unref (tmp);
+  }
+  r_assert_cmpptr (r_json_value_get_object_field (obj, "field100"), ==, NULL);
+  r_assert_cmpptr (r_json_value_get_object_field (obj, "field"), ==, NULL);
+
+  /* Fields added after the index was built. */
+  k = r_json_string_new_static_unescaped ("late");
+  v = r_json_true_new ();
+  r_assert_cmpint (r_json_object_add_field (obj, k, v), ==, R_JSON_OK);
+  r_json_value_unref (k);
+  r_json_value_unref (v);
+  r_assert_cmpptr ((tmp = r_json_value_get_object_field (obj, "late")), !=, NULL);
+  r_assert_cmpint (tmp->type, ==, R_JSON_TYPE_TRUE);
+  r_json_value_unref (tmp);
+
+  r_assert_cmpuint (r_json_value_get_object_field_count (obj), ==, 102);
+  r_assert_cmpstr (r_json_value_get_object_field_name (obj, 0), ==, "field0");
+  r_assert_cmpstr (r_json_value_get_object_field_name (obj, 100), ==, "field7");
+  r_assert_cmpstr (r_json_value_get_object_field_name (obj, 101), ==, "late");
+  r_json_value_unref (obj);
+}
+RTEST_END;
+
 RTEST (rjson, create_array, RTEST_FAST)
 {
   RJsonValue * array, * tmp;
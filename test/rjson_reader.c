@@ -0,0 +1,160 @@
+#include <rlib/rlib.h>
+
+typedef struct {
+  ruint count;
+  RJsonResult res[16];
+  RJsonType type[16];
+  int num[16];
+  rsize maxpending;
+} JsonReaderRecords;
+
+static void
+json_reader_collect (rpointer data, RJsonTape * tape, RJsonResult res, RJsonReader * reader)
+{
+  JsonReaderRecords * recs = data;
+  RJsonTapeValue root = r_json_tape_get_root (tape);
+
+  (void) reader;
+  r_assert_cmpuint (recs->count, <, R_N_ELEMENTS (recs->res));
+  recs->res[recs->count] = res;
+  recs->type[recs->count] = r_json_tape_value_get_type (root);
+  switch (recs->type[recs->count]) {
+    case R_JSON_TYPE_OBJECT:
+      recs->num[recs->count] = r_json_tape_value_get_number_int (
+          r_json_tape_value_get_object_field_value (root, 0));
+      break;
+    case R_JSON_TYPE_ARRAY:
+      recs->num[recs->count] = r_json_tape_value_get_number_int (
+          r_json_tape_value_get_array_value (root, 0));
+      break;
+    case R_JSON_TYPE_NUMBER:
+      recs->num[recs->count] = r_json_tape_value_get_number_int (root);
+      break;
+    default:
+      recs->num[recs->count] = 0;
+      break;
+  }
+  recs->count++;
+}
+
+/* Feed @doc in chunks of @chunk bytes. */
+static RJsonResult
+json_reader_feed (RJsonReader * reader, const rchar * doc, rsize chunk, JsonReaderRecords * recs)
+{
+  rsize off, len = r_strlen (doc);
+
+  for (off = 0; off < len; off += chunk) {
+    r_assert_cmpint (r_json_reader_push (reader, doc + off, MIN (chunk, len - off)), ==, R_JSON_OK);
+    recs->maxpending = MAX (recs->maxpending, r_json_reader_get_pending_size (reader));
+  }
+  return r_json_reader_end (reader);
+}
+
+RTEST (rjson_reader, ndjson, RTEST_FAST)
+{
+  static const rchar doc[] =
+    "{\"a\":1}\n{\"a\":2,\"s\":\"}\\\"{\"}\r\n[3, {\"x\":[]}]\n\n\"str\"\n42\ntrue";
+  rsize chunk;
+
+  for (chunk = 1; chunk <= sizeof (doc); chunk++) {
+    JsonReaderRecords recs;
+    RJsonReader * reader;
+
+    r_memclear (&recs, sizeof (recs));
+    r_assert_cmpptr ((reader = r_json_reader_new (json_reader_collect, &recs, NULL)), !=, NULL);
+    r_assert_cmpint (json_reader_feed (reader, doc, chunk, &recs), ==, R_JSON_OK);
+
+    r_assert_cmpuint (recs.count, ==, 6);
+    r_assert_cmpuint (r_json_reader_get_record_count (reader), ==, 6);
+    r_assert_cmpint (recs.res[0], ==, R_JSON_OK);
+    r_assert_cmpint (recs.type[0], ==, R_JSON_TYPE_OBJECT);
+    r_assert_cmpint (recs.num[0], ==, 1);
+    r_assert_cmpint (recs.res[1], ==, R_JSON_OK);
+    r_assert_cmpint (recs.num[1], ==, 2);
+    r_assert_cmpint (recs.res[2], ==, R_JSON_OK);
+    r_assert_cmpint (recs.type[2], ==, R_JSON_TYPE_ARRAY);
+    r_assert_cmpint (recs.num[2], ==, 3);
+    r_assert_cmpint (recs.type[3], ==, R_JSON_TYPE_STRING);
+    r_assert_cmpint (recs.type[4], ==, R_JSON_TYPE_NUMBER);
+    r_assert_cmpint (recs.num[4], ==, 42);
+    r_assert_cmpint (recs.res[5], ==, R_JSON_OK);
+    r_assert_cmpint (recs.type[5], ==, R_JSON_TYPE_TRUE);
+    r_assert_cmpuint (r_json_reader_get_pending_size (reader), ==, 0);
+    r_json_reader_unref (reader);
+  }
+}
+RTEST_END;
+
+RTEST (rjson_reader, concatenated, RTEST_FAST)
+{
+  static const rchar doc[] = "{\"a\":5}{\"b\":6}[7]\"x\"8 [9]";
+  JsonReaderRecords recs;
+  RJsonReader * reader;
+
+  r_memclear (&recs, sizeof (recs));
+  r_assert_cmpptr ((reader = r_json_reader_new (json_reader_collect, &recs, NULL)), !=, NULL);
+  r_assert_cmpint (json_reader_feed (reader, doc, 3, &recs), ==, R_JSON_OK);
+  r_assert_cmpuint (recs.count, ==, 6);
+  r_assert_cmpint (recs.num[0], ==, 5);
+  r_assert_cmpint (recs.num[1], ==, 6);
+  r_assert_cmpint (recs.num[2], ==, 7);
+  r_assert_cmpint (recs.type[3], ==, R_JSON_TYPE_STRING);
+  r_assert_cmpint (recs.num[4], ==, 8);
+  r_assert_cmpint (recs.num[5], ==, 9);
+  r_json_reader_unref (reader);
+}
+RTEST_END;
+
+RTEST (rjson_reader, bad_records, RTEST_FAST)
+{
+  static const rchar doc[] = "{\"a\":1}\n{\"a\":}\n]\n{\"a\":3}\n{\"a\":";
+  JsonReaderRecords recs;
+  RJsonReader * reader;
+
+  r_memclear (&recs, sizeof (recs));
+  r_assert_cmpptr ((reader = r_json_reader_new (json_reader_collect, &recs, NULL)), !=, NULL);
+  r_assert_cmpint (json_reader_feed (reader, doc, 5, &recs), ==, R_JSON_END);
+  r_assert_cmpuint (recs.count, ==, 5);
+  r_assert_cmpint (recs.res[0], ==, R_JSON_OK);
+  r_assert_cmpint (recs.res[1], !=, R_JSON_OK);
+  r_assert_cmpint (recs.type[1], ==, R_JSON_TYPE_NONE);
+  r_assert_cmpint (recs.res[2], !=, R_JSON_OK);
+  r_assert_cmpint (recs.res[3], ==, R_JSON_OK);
+  r_assert_cmpint (recs.num[3], ==, 3);
+  r_assert_cmpint (recs.res[4], ==, R_JSON_END);
+
+  /* The reader starts over after end. */
+  r_assert_cmpint (json_reader_feed (reader, "[10]", 2, &recs), ==, R_JSON_OK);
+  r_assert_cmpuint (recs.count, ==, 6);
+  r_assert_cmpint (recs.num[5], ==, 10);
+  r_json_reader_unref (reader);
+}
+RTEST_END;
+
+RTEST (rjson_reader, max_record_size, RTEST_FAST)
+{
+  static const rchar doc[] =
+    "{\"a\":1}\n{\"long\":\"xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx\"}\n{\"a\":2}\n";
+  JsonReaderRecords recs;
+  RJsonReader * reader;
+
+  r_memclear (&recs, sizeof (recs));
+  r_assert_cmpptr ((reader = r_json_reader_new (json_reader_collect, &recs, NULL)), !=, NULL);
+  r_json_reader_set_max_record_size (reader, 16);
+  r_assert_cmpint (json_reader_feed (reader, doc, 4, &recs), ==, R_JSON_OK);
+  r_assert_cmpuint (recs.maxpending, <=, 16);
+  r_assert_cmpuint (recs.count, ==, 3);
+  r_assert_cmpint (recs.num[0], ==, 1);
+  r_assert_cmpint (recs.res[1], ==, R_JSON_OUT_OF_RANGE);
+  r_assert_cmpint (recs.res[2], ==, R_JSON_OK);
+  r_assert_cmpint (recs.num[2], ==, 2);
+
+  /* The same record within a single chunk. */
+  r_memclear (&recs, sizeof (recs));
+  r_assert_cmpint (json_reader_feed (reader, doc, sizeof (doc), &recs), ==, R_JSON_OK);
+  r_assert_cmpuint (recs.count, ==, 3);
+  r_assert_cmpint (recs.res[1], ==, R_JSON_OUT_OF_RANGE);
+  r_assert_cmpint (recs.num[2], ==, 2);
+  r_json_reader_unref (reader);
+}
+RTEST_END;
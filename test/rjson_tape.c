@@ -0,0 +1,260 @@
+#include <rlib/rlib.h>
+
+static const rchar json_tape_doc[] =
+  "{ \"name\": \"rlib\", \"esc\": \"a\\\"b\\\\c\\u00e6\", \"n\": -42,\n"
+  "  \"pi\": 3.25, \"big\": 12345678901234567890, \"t\": true, \"f\": false,\n"
+  "  \"z\": null, \"arr\": [ 1, [], {}, [ \"x\" ] ], \"obj\": { \"k\": [ 0 ] } }";
+
+RTEST (rjson_tape, scalars, RTEST_FAST)
+{
+  RJsonTape * tape;
+  RJsonResult res;
+  const rchar * str;
+  rsize len;
+
+  r_assert_cmpptr (r_json_tape_parse (NULL, 4, &res), ==, NULL);
+  r_assert_cmpint (res, ==, R_JSON_INVAL);
+
+  r_assert_cmpptr ((tape = r_json_tape_parse (R_STR_WITH_SIZE_ARGS (" null "), &res)), !=, NULL);
+  r_assert_cmpint (res, ==, R_JSON_OK);
+  r_assert (r_json_tape_value_is_null (r_json_tape_get_root (tape)));
+  r_json_tape_unref (tape);
+
+  r_assert_cmpptr ((tape = r_json_tape_parse (R_STR_WITH_SIZE_ARGS ("-0.5e1"), &res)), !=, NULL);
+  r_assert_cmpint (r_json_tape_value_get_type (r_json_tape_get_root (tape)), ==, R_JSON_TYPE_NUMBER);
+  r_assert_cmpdouble (r_json_tape_value_get_number_double (r_json_tape_get_root (tape)), ==, -5.0);
+  r_assert_cmpint (r_json_tape_value_get_number_int (r_json_tape_get_root (tape)), ==, -5);
+  r_json_tape_unref (tape);
+
+  r_assert_cmpptr ((tape = r_json_tape_parse (R_STR_WITH_SIZE_ARGS ("\"hello\""), &res)), !=, NULL);
+  r_assert_cmpptr ((str = r_json_tape_value_get_string (r_json_tape_get_root (tape), &len)), !=, NULL);
+  r_assert_cmpuint (len, ==, 5);
+  r_assert_cmpmem (str, ==, "hello", 5);
+  r_json_tape_unref (tape);
+}
+RTEST_END;
+
+RTEST (rjson_tape, document, RTEST_FAST)
+{
+  RJsonTape * tape;
+  RJsonTapeValue root, v, arr;
+  RJsonResult res;
+  const rchar * str;
+  rsize len;
+
+  r_assert_cmpptr ((tape = r_json_tape_parse (R_STR_WITH_SIZE_ARGS (json_tape_doc), &res)), !=, NULL);
+  r_assert_cmpint (res, ==, R_JSON_OK);
+  root = r_json_tape_get_root (tape);
+  r_assert_cmpint (r_json_tape_value_get_type (root), ==, R_JSON_TYPE_OBJECT);
+  r_assert_cmpuint (r_json_tape_value_get_object_field_count (root), ==, 10);
+
+  /* Unescaped strings point into the source, escaped ones are copied. */
+  str = r_json_tape_value_get_string (r_json_tape_value_get_object_field (root, "name"), &len);
+  r_assert_cmpuint (len, ==, 4);
+  r_assert (str > json_tape_doc && str < json_tape_doc + sizeof (json_tape_doc));
+  str = r_json_tape_value_get_string (r_json_tape_value_get_object_field (root, "esc"), &len);
+  r_assert_cmpuint (len, ==, 7);
+  r_assert_cmpmem (str, ==, "a\"b\\c\xc3\xa6", 7);
+
+  r_assert_cmpint (r_json_tape_value_get_number_int (r_json_tape_value_get_object_field (root, "n")), ==, -42);
+  r_assert_cmpdouble (r_json_tape_value_get_number_double (r_json_tape_value_get_object_field (root, "pi")), ==, 3.25);
+  r_assert_cmpdouble (r_json_tape_value_get_number_double (r_json_tape_value_get_object_field (root, "big")), ==, 12345678901234567890.0);
+  r_assert (r_json_tape_value_is_true (r_json_tape_value_get_object_field (root, "t")));
+  r_assert (r_json_tape_value_is_false (r_json_tape_value_get_object_field (root, "f")));
+  r_assert (r_json_tape_value_is_null (r_json_tape_value_get_object_field (root, "z")));
+
+  v = r_json_tape_value_get_object_field (root, "missing");
+  r_assert_cmpptr (v.tape, ==, NULL);
+  r_assert_cmpint (r_json_tape_value_get_type (v), ==, R_JSON_TYPE_NONE);
+  r_assert_cmpptr (r_json_tape_value_get_string (v, &len), ==, NULL);
+
+  arr = r_json_tape_value_get_object_field (root, "arr");
+  r_assert_cmpuint (r_json_tape_value_get_array_size (arr), ==, 4);
+  r_assert_cmpint (r_json_tape_value_get_number_int (r_json_tape_value_get_array_value (arr, 0)), ==, 1);
+  r_assert_cmpuint (r_json_tape_value_get_array_size (r_json_tape_value_get_array_value (arr, 1)), ==, 0);
+  r_assert_cmpuint (r_json_tape_value_get_object_field_count (r_json_tape_value_get_array_value (arr, 2)), ==, 0);
+  v = r_json_tape_value_get_array_value (r_json_tape_value_get_array_value (arr, 3), 0);
+  r_assert_cmpmem (r_json_tape_value_get_string (v, &len), ==, "x", 1);
+  r_assert_cmpptr (r_json_tape_value_get_array_value (arr, 4).tape, ==, NULL);
+
+  str = r_json_tape_value_get_object_field_name (root, 9, &len);
+  r_assert_cmpuint (len, ==, 3);
+  r_assert_cmpmem (str, ==, "obj", 3);
+  v = r_json_tape_value_get_object_field_value (root, 9);
+  v = r_json_tape_value_get_array_value (r_json_tape_value_get_object_field (v, "k"), 0);
+  r_assert_cmpint (r_json_tape_value_get_number_int (v), ==, 0);
+  r_assert_cmpptr (r_json_tape_value_get_object_field_name (root, 10, &len), ==, NULL);
+
+  r_json_tape_unref (tape);
+}
+RTEST_END;
+
+static void
+json_tape_count_field (rpointer key, rpointer value, rpointer user)
+{
+  const RStrChunk * k = key;
+  const RJsonTapeValue * v = value;
+  rsize * sum = user;
+
+  r_assert_cmpuint (k->size, ==, 1);
+  *sum += (rsize) r_json_tape_value_get_number_int (*v);
+}
+
+static void
+json_tape_count_value (rpointer data, rpointer user)
+{
+  const RJsonTapeValue * v = data;
+  rsize * sum = user;
+
+  *sum += (rsize) r_json_tape_value_get_number_int (*v);
+}
+
+RTEST (rjson_tape, foreach, RTEST_FAST)
+{
+  RJsonTape * tape;
+  rsize sum = 0;
+
+  r_assert_cmpptr ((tape = r_json_tape_parse (R_STR_WITH_SIZE_ARGS (
+            "{\"a\":1,\"b\":[2,3],\"c\":4}"), NULL)), !=, NULL);
+  r_json_tape_value_foreach_object_field (r_json_tape_get_root (tape),
+      json_tape_count_field, &sum);
+  r_assert_cmpuint (sum, ==, 5);
+  sum = 0;
+  r_json_tape_value_foreach_array_value (
+      r_json_tape_value_get_object_field (r_json_tape_get_root (tape), "b"),
+      json_tape_count_value, &sum);
+  r_assert_cmpuint (sum, ==, 5);
+  r_json_tape_unref (tape);
+}
+RTEST_END;
+
+RTEST (rjson_tape, large_array, RTEST_FAST)
+{
+  /* More entries than the 24 bit count field holds. */
+  const rsize n = 0x1000010;
+  RString * str = r_string_new_sized (n * 2 + 2);
+  RJsonTape * tape;
+  rchar * json;
+  rsize i, len;
+
+  r_string_append_c (str, '[');
+  for (i = 0; i < n; i++)
+    r_string_append_len (str, i == 0 ? "0" : ",0", i == 0 ? 1 : 2);
+  r_string_append_c (str, ']');
+  len = r_string_length (str);
+  json = r_string_free_keep (str);
+
+  r_assert_cmpptr ((tape = r_json_tape_parse (json, len, NULL)), !=, NULL);
+  r_assert_cmpuint (r_json_tape_value_get_array_size (r_json_tape_get_root (tape)), ==, n);
+  r_json_tape_unref (tape);
+  r_free (json);
+}
+RTEST_END;
+
+RTEST (rjson_tape, errors, RTEST_FAST)
+{
+  RJsonResult res;
+
+  r_assert_cmpptr (r_json_tape_parse (R_STR_WITH_SIZE_ARGS ("{\"a\":1"), &res), ==, NULL);
+  r_assert_cmpint (res, ==, R_JSON_END);
+  r_assert_cmpptr (r_json_tape_parse (R_STR_WITH_SIZE_ARGS ("[1,2"), &res), ==, NULL);
+  r_assert_cmpint (res, ==, R_JSON_END);
+  r_assert_cmpptr (r_json_tape_parse (R_STR_WITH_SIZE_ARGS ("\"abc"), &res), ==, NULL);
+  r_assert_cmpint (res, ==, R_JSON_STRING_NOT_TERMINATED);
+  r_assert_cmpptr (r_json_tape_parse (R_STR_WITH_SIZE_ARGS ("{1:2}"), &res), ==, NULL);
+  r_assert_cmpint (res, ==, R_JSON_OBJECT_FIELD_NOT_PARSED);
+  r_assert_cmpptr (r_json_tape_parse (R_STR_WITH_SIZE_ARGS ("{\"a\" 2}"), &res), ==, NULL);
+  r_assert_cmpint (res, ==, R_JSON_OBJECT_FIELD_NOT_PARSED);
+  r_assert_cmpptr (r_json_tape_parse (R_STR_WITH_SIZE_ARGS ("[01]"), &res), ==, NULL);
+  r_assert_cmpint (res, ==, R_JSON_NUMBER_NOT_PARSED);
+  r_assert_cmpptr (r_json_tape_parse (R_STR_WITH_SIZE_ARGS ("[1.]"), &res), ==, NULL);
+  r_assert_cmpint (res, ==, R_JSON_NUMBER_NOT_PARSED);
+  r_assert_cmpptr (r_json_tape_parse (R_STR_WITH_SIZE_ARGS ("[tru]"), &res), ==, NULL);
+  r_assert_cmpint (res, ==, R_JSON_TYPE_NOT_PARSED);
+  r_assert_cmpptr (r_json_tape_parse (R_STR_WITH_SIZE_ARGS ("[1 2]"), &res), ==, NULL);
+  r_assert_cmpint (res, ==, R_JSON_TYPE_NOT_PARSED);
+  r_assert_cmpptr (r_json_tape_parse (R_STR_WITH_SIZE_ARGS ("true false"), &res), ==, NULL);
+  r_assert_cmpint (res, ==, R_JSON_TYPE_NOT_PARSED);
+  r_assert_cmpptr (r_json_tape_parse (R_STR_WITH_SIZE_ARGS ("\"\\u12\""), &res), ==, NULL);
+  r_assert_cmpint (res, ==, R_JSON_FAILED_TO_UNESCAPE_STRING);
+  r_assert_cmpptr (r_json_tape_parse (R_STR_WITH_SIZE_ARGS ("[1x]"), &res), ==, NULL);
+  r_assert_cmpint (res, ==, R_JSON_TYPE_NOT_PARSED);
+  r_assert_cmpptr (r_json_tape_parse (R_STR_WITH_SIZE_ARGS ("{\"a\":truex}"), &res), ==, NULL);
+  r_assert_cmpint (res, ==, R_JSON_OBJECT_FIELD_NOT_PARSED);
+  r_assert_cmpptr (r_json_tape_parse (R_STR_WITH_SIZE_ARGS ("[\"a\"\"b\"]"), &res), ==, NULL);
+  r_assert_cmpint (res, ==, R_JSON_TYPE_NOT_PARSED);
+  r_assert_cmpptr (r_json_tape_parse (R_STR_WITH_SIZE_ARGS ("[\"a\\\"]"), &res), ==, NULL);
+  r_assert_cmpint (res, ==, R_JSON_STRING_NOT_TERMINATED);
+  r_assert_cmpptr (r_json_tape_parse (R_STR_WITH_SIZE_ARGS ("  \n "), &res), ==, NULL);
+  r_assert_cmpint (res, ==, R_JSON_END);
+}
+RTEST_END;
+
+/* Slide escapes and quotes across the 64 byte blocks of the structural
+ * index. */
+RTEST (rjson_tape, block_boundaries, RTEST_FAST)
+{
+  static const rchar body[] = "[\"x\\\\\",\"y\\\"z\",{\"k\\\"\":\"}] ,\"},-7,true,\"\\\\\\\\\\\"\"]";
+  rchar doc[256];
+  ruint shift;
+
+  for (shift = 0; shift < 140; shift++) {
+    RJsonTape * tape;
+    RJsonTapeValue root, obj;
+    RJsonResult res;
+    const rchar * str;
+    rsize len;
+
+    r_memset (doc, ' ', shift);
+    r_memcpy (doc + shift, body, sizeof (body) - 1);
+
+    r_assert_cmpptr ((tape = r_json_tape_parse (doc, shift + sizeof (body) - 1, &res)), !=, NULL);
+    r_assert_cmpint (res, ==, R_JSON_OK);
+    root = r_json_tape_get_root (tape);
+    r_assert_cmpuint (r_json_tape_value_get_array_size (root), ==, 6);
+
+    str = r_json_tape_value_get_string (r_json_tape_value_get_array_value (root, 0), &len);
+    r_assert_cmpuint (len, ==, 2);
+    r_assert_cmpmem (str, ==, "x\\", len);
+    str = r_json_tape_value_get_string (r_json_tape_value_get_array_value (root, 1), &len);
+    r_assert_cmpuint (len, ==, 3);
+    r_assert_cmpmem (str, ==, "y\"z", len);
+    obj = r_json_tape_value_get_array_value (root, 2);
+    r_assert_cmpuint (r_json_tape_value_get_object_field_count (obj), ==, 1);
+    str = r_json_tape_value_get_object_field_name (obj, 0, &len);
+    r_assert_cmpuint (len, ==, 2);
+    r_assert_cmpmem (str, ==, "k\"", len);
+    str = r_json_tape_value_get_string (r_json_tape_value_get_object_field_value (obj, 0), &len);
+    r_assert_cmpuint (len, ==, 4);
+    r_assert_cmpmem (str, ==, "}] ,", len);
+    r_assert_cmpint (r_json_tape_value_get_number_int (r_json_tape_value_get_array_value (root, 3)), ==, -7);
+    r_assert (r_json_tape_value_is_true (r_json_tape_value_get_array_value (root, 4)));
+    str = r_json_tape_value_get_string (r_json_tape_value_get_array_value (root, 5), &len);
+    r_assert_cmpuint (len, ==, 3);
+    r_assert_cmpmem (str, ==, "\\\\\"", len);
+    r_json_tape_unref (tape);
+  }
+}
+RTEST_END;
+
+RTEST (rjson_tape, parser_and_buffer, RTEST_FAST)
+{
+  RJsonParser * parser;
+  RJsonTape * tape;
+  RBuffer * buf;
+  rchar * copy = r_strdup (json_tape_doc);
+  rsize len;
+
+  /* The tape keeps the buffer alive after the parser is gone. */
+  r_assert_cmpptr ((buf = r_buffer_new_take (copy, sizeof (json_tape_doc) - 1)), !=, NULL);
+  r_assert_cmpptr ((parser = r_json_parser_new_buffer (buf)), !=, NULL);
+  r_buffer_unref (buf);
+  r_assert_cmpptr ((tape = r_json_parser_parse_tape (parser, NULL)), !=, NULL);
+  r_json_parser_unref (parser);
+
+  r_assert_cmpmem (r_json_tape_value_get_string (
+        r_json_tape_value_get_object_field (r_json_tape_get_root (tape), "name"), &len), ==, "rlib", 4);
+  r_assert_cmpuint (r_json_tape_get_memory_size (tape), >, 0);
+  r_json_tape_unref (tape);
+}
+RTEST_END;
@@ -0,0 +1,298 @@
+#include <rlib/rlib.h>
+
+static const rchar json_writer_doc[] =
+  "{\"id\":1,\"name\":\"Foo\",\"tags\":[\"a\",\"b\",[],{}],\"nested\":"
+  "{\"neg\":-42,\"big\":9007199254740991,\"t\":true,\"f\":false,\"n\":null},"
+  "\"empty\":\"\"}";
+
+static void
+json_writer_emit_doc (RJsonWriter * w)
+{
+  r_json_writer_begin_object (w);
+  r_json_writer_key (w, "id", -1);
+  r_json_writer_int (w, 1);
+  r_json_writer_key (w, "name", -1);
+  r_json_writer_string (w, "Foo", -1);
+  r_json_writer_key (w, "tags", -1);
+  r_json_writer_begin_array (w);
+  r_json_writer_string (w, "a", -1);
+  r_json_writer_string (w, "bc", 1);
+  r_json_writer_begin_array (w);
+  r_json_writer_end_array (w);
+  r_json_writer_begin_object (w);
+  r_json_writer_end_object (w);
+  r_json_writer_end_array (w);
+  r_json_writer_key (w, "nested", -1);
+  r_json_writer_begin_object (w);
+  r_json_writer_key (w, "neg", -1);
+  r_json_writer_int (w, -42);
+  r_json_writer_key (w, "big", -1);
+  r_json_writer_double (w, 9007199254740991.0);
+  r_json_writer_key (w, "t", -1);
+  r_json_writer_bool (w, TRUE);
+  r_json_writer_key (w, "f", -1);
+  r_json_writer_bool (w, FALSE);
+  r_json_writer_key (w, "n", -1);
+  r_json_writer_null (w);
+  r_json_writer_end_object (w);
+  r_json_writer_key (w, "empty", -1);
+  r_json_writer_string (w, "", 0);
+  r_json_writer_end_object (w);
+}
+
+RTEST (rjson_writer, matches_tree_serializer, RTEST_FAST)
+{
+  static const RJsonFlags flags[] = { R_JSON_COMPACT, R_JSON_NOFLAGS, R_JSON_USE_TABS };
+  RJsonValue * v;
+  RJsonResult res;
+  rsize i;
+
+  r_assert_cmpptr ((v = r_json_parse (R_STR_WITH_SIZE_ARGS (json_writer_doc), &res)), !=, NULL);
+
+  for (i = 0; i < R_N_ELEMENTS (flags); i++) {
+    RJsonWriter w;
+    RBuffer * expected;
+    RString * str;
+    rchar * exp, * out;
+    rsize size;
+
+    r_assert_cmpptr ((expected = r_json_value_to_buffer (v, flags[i], &res)), !=, NULL);
+    r_assert_cmpptr ((exp = r_buffer_extract_dup_all (expected, &size)), !=, NULL);
+    exp = r_realloc (exp, size + 1);
+    exp[size] = 0;
+
+    str = r_string_new (NULL);
+    r_json_writer_init_string (&w, str, flags[i]);
+    json_writer_emit_doc (&w);
+    r_assert_cmpint (r_json_writer_finish (&w), ==, R_JSON_OK);
+    r_assert_cmpstr ((out = r_string_free_keep (str)), ==, exp);
+    r_free (out);
+
+    /* A tree value embedded through the writer comes out the same. */
+    str = r_string_new (NULL);
+    r_json_writer_init_string (&w, str, flags[i]);
+    r_assert_cmpint (r_json_writer_value (&w, v), ==, R_JSON_OK);
+    r_assert_cmpint (r_json_writer_finish (&w), ==, R_JSON_OK);
+    r_assert_cmpstr ((out = r_string_free_keep (str)), ==, exp);
+    r_free (out);
+
+    r_free (exp);
+    r_buffer_unref (expected);
+  }
+
+  r_json_value_unref (v);
+}
+RTEST_END;
+
+RTEST (rjson_writer, escape, RTEST_FAST)
+{
+  static const rchar in[] =
+    "plain text that is long enough for a vector block \"q\" \\ /\n\t\b\f\r\x01\x1f"
+    " \xc3\xa6\xc3\xb8\xc3\xa5 \xf0\x9f\x98\x80 \x7f end";
+  RJsonWriter w;
+  RString * str;
+  rchar * out;
+  RJsonValue * v;
+  RJsonResult res;
+
+  str = r_string_new (NULL);
+  r_json_writer_init_string (&w, str, R_JSON_COMPACT);
+  r_json_writer_begin_array (&w);
+  r_json_writer_string (&w, in, -1);
+  r_json_writer_string (&w, "a\0b", 3);
+  r_json_writer_end_array (&w);
+  r_assert_cmpint (r_json_writer_finish (&w), ==, R_JSON_OK);
+  out = r_string_free_keep (str);
+  r_assert_cmpstr (out, ==,
+      "[\"plain text that is long enough for a vector block \\\"q\\\" \\\\ /\\n\\t\\b\\f\\r\\u0001\\u001f"
+      " \\u00e6\\u00f8\\u00e5 \\ud83d\\ude00 \x7f end\",\"a\\u0000b\"]");
+
+  /* ... and reads back to the original bytes. */
+  r_assert_cmpptr ((v = r_json_parse (out, r_strlen (out), &res)), !=, NULL);
+  r_assert_cmpstr (r_json_value_get_string (r_json_value_get_array_value (v, 0)), ==, in);
+  r_json_value_unref (v);
+  r_free (out);
+}
+RTEST_END;
+
+RTEST (rjson_writer, non_ascii_matches_tree_serializer, RTEST_FAST)
+{
+  static const rchar doc[] =
+    "[\"bl\xc3\xa5" "b\xc3\xa6r \xe2\x82\xac \xf0\x9f\x98\x80\",\"\\u00e6\"]";
+  RJsonWriter w;
+  RJsonValue * v;
+  RJsonResult res;
+  RBuffer * expected;
+  RString * str;
+  rchar * exp, * out;
+  rsize size;
+
+  r_assert_cmpptr ((v = r_json_parse (R_STR_WITH_SIZE_ARGS (doc), &res)), !=, NULL);
+  r_assert_cmpptr ((expected = r_json_value_to_buffer (v, R_JSON_COMPACT, &res)), !=, NULL);
+  r_assert_cmpptr ((exp = r_buffer_extract_dup_all (expected, &size)), !=, NULL);
+  exp = r_realloc (exp, size + 1);
+  exp[size] = 0;
+  r_buffer_unref (expected);
+  r_assert_cmpstr (exp, ==,
+      "[\"bl\\u00e5b\\u00e6r \\u20ac \\ud83d\\ude00\",\"\\u00e6\"]");
+
+  str = r_string_new (NULL);
+  r_json_writer_init_string (&w, str, R_JSON_COMPACT);
+  r_json_writer_begin_array (&w);
+  r_json_writer_string (&w, "bl\xc3\xa5" "b\xc3\xa6r \xe2\x82\xac \xf0\x9f\x98\x80", -1);
+  r_json_writer_string (&w, "\xc3\xa6", -1);
+  r_json_writer_end_array (&w);
+  r_assert_cmpint (r_json_writer_finish (&w), ==, R_JSON_OK);
+  r_assert_cmpstr ((out = r_string_free_keep (str)), ==, exp);
+  r_free (out);
+
+  /* Malformed UTF-8 can't be escaped, as with the tree serializer */
+  str = r_string_new (NULL);
+  r_json_writer_init_string (&w, str, R_JSON_COMPACT);
+  r_assert_cmpint (r_json_writer_string (&w, "ab\xc3", -1), ==,
+      R_JSON_FAILED_TO_UNESCAPE_STRING);
+  r_assert_cmpint (r_json_writer_finish (&w), ==, R_JSON_FAILED_TO_UNESCAPE_STRING);
+  r_string_free (str);
+
+  r_free (exp);
+  r_json_value_unref (v);
+}
+RTEST_END;
+
+RTEST (rjson_writer, numbers, RTEST_FAST)
+{
+  static const struct { rdouble v; const rchar * str; } nums[] = {
+    { 0.0, "0" },
+    { -3.0, "-3" },
+    { 0.5, "0.5" },
+    { -0.25, "-0.25" },
+    { 3.14159, "3.14159" },
+    { 0.001, "0.001" },
+    { 1234.000001, "1234.000001" },
+    { 1e300, "1e+300" },
+    { 0.1 + 0.2, "0.30000000000000004" },
+    { 1.0 / 3.0, "0.3333333333333333" },
+  };
+  static const struct { rint64 v; const rchar * str; } ints[] = {
+    { 0, "0" },
+    { 7, "7" },
+    { 10, "10" },
+    { -99, "-99" },
+    { 1000000007, "1000000007" },
+    { RINT64_MAX, "9223372036854775807" },
+    { RINT64_MIN, "-9223372036854775808" },
+  };
+  rsize i;
+
+  for (i = 0; i < R_N_ELEMENTS (nums); i++) {
+    RJsonWriter w;
+    RString * str = r_string_new (NULL);
+    rchar * out;
+
+    r_json_writer_init_string (&w, str, R_JSON_COMPACT);
+    r_assert_cmpint (r_json_writer_double (&w, nums[i].v), ==, R_JSON_OK);
+    r_assert_cmpint (r_json_writer_finish (&w), ==, R_JSON_OK);
+    r_assert_cmpstr ((out = r_string_free_keep (str)), ==, nums[i].str);
+    r_assert_cmpdouble (r_str_to_double (out, NULL, NULL), ==, nums[i].v);
+    r_free (out);
+  }
+
+  for (i = 0; i < R_N_ELEMENTS (ints); i++) {
+    RJsonWriter w;
+    RString * str = r_string_new (NULL);
+    rchar * out;
+
+    r_json_writer_init_string (&w, str, R_JSON_COMPACT);
+    r_assert_cmpint (r_json_writer_int (&w, ints[i].v), ==, R_JSON_OK);
+    r_assert_cmpint (r_json_writer_finish (&w), ==, R_JSON_OK);
+    r_assert_cmpstr ((out = r_string_free_keep (str)), ==, ints[i].str);
+    r_free (out);
+  }
+}
+RTEST_END;
+
+RTEST (rjson_writer, misuse, RTEST_FAST)
+{
+  RJsonWriter w;
+  RString * str;
+  rchar * out;
+
+  str = r_string_new (NULL);
+
+  /* Value in an object without a key. */
+  r_json_writer_init_string (&w, str, R_JSON_COMPACT);
+  r_assert_cmpint (r_json_writer_begin_object (&w), ==, R_JSON_OK);
+  r_assert_cmpint (r_json_writer_int (&w, 1), ==, R_JSON_WRONG_TYPE);
+  r_assert_cmpint (r_json_writer_key (&w, "a", -1), ==, R_JSON_WRONG_TYPE);
+  r_assert_cmpint (r_json_writer_finish (&w), ==, R_JSON_WRONG_TYPE);
+
+  /* Key in an array, mismatched end, key without value. */
+  r_json_writer_init_string (&w, str, R_JSON_COMPACT);
+  r_json_writer_begin_array (&w);
+  r_assert_cmpint (r_json_writer_key (&w, "a", -1), ==, R_JSON_WRONG_TYPE);
+  r_assert_cmpint (r_json_writer_finish (&w), ==, R_JSON_WRONG_TYPE);
+  r_json_writer_init_string (&w, str, R_JSON_COMPACT);
+  r_json_writer_begin_array (&w);
+  r_assert_cmpint (r_json_writer_end_object (&w), ==, R_JSON_WRONG_TYPE);
+  r_assert_cmpint (r_json_writer_finish (&w), ==, R_JSON_WRONG_TYPE);
+  r_json_writer_init_string (&w, str, R_JSON_COMPACT);
+  r_json_writer_begin_object (&w);
+  r_json_writer_key (&w, "a", -1);
+  r_assert_cmpint (r_json_writer_end_object (&w), ==, R_JSON_WRONG_TYPE);
+  r_assert_cmpint (r_json_writer_finish (&w), ==, R_JSON_WRONG_TYPE);
+
+  /* Two top-level values, unfinished document, bad numbers. */
+  r_json_writer_init_string (&w, str, R_JSON_COMPACT);
+  r_assert_cmpint (r_json_writer_null (&w), ==, R_JSON_OK);
+  r_assert_cmpint (r_json_writer_null (&w), ==, R_JSON_WRONG_TYPE);
+  r_assert_cmpint (r_json_writer_finish (&w), ==, R_JSON_WRONG_TYPE);
+  r_json_writer_init_string (&w, str, R_JSON_COMPACT);
+  r_assert_cmpint (r_json_writer_finish (&w), ==, R_JSON_END);
+  r_json_writer_init_string (&w, str, R_JSON_COMPACT);
+  r_json_writer_begin_array (&w);
+  r_assert_cmpint (r_json_writer_finish (&w), ==, R_JSON_END);
+  r_json_writer_init_string (&w, str, R_JSON_COMPACT);
+  r_assert_cmpint (r_json_writer_double (&w, RDOUBLE_NAN), ==, R_JSON_INVAL);
+  r_assert_cmpint (r_json_writer_finish (&w), ==, R_JSON_INVAL);
+
+  r_free ((out = r_string_free_keep (str)));
+}
+RTEST_END;
+
+RTEST (rjson_writer, buffer_segments, RTEST_FAST)
+{
+  RJsonWriter w;
+  RBuffer * buf;
+  RJsonValue * v;
+  RJsonResult res;
+  rchar * data, name[16];
+  rsize i, size;
+
+  r_assert_cmpptr ((buf = r_buffer_new ()), !=, NULL);
+  r_json_writer_init_buffer (&w, buf, 300, R_JSON_NOFLAGS);
+  r_json_writer_begin_array (&w);
+  for (i = 0; i < 200; i++) {
+    r_json_writer_begin_object (&w);
+    r_snprintf (name, sizeof (name), "k%"RSIZE_FMT, i);
+    r_json_writer_key (&w, name, -1);
+    r_json_writer_int (&w, (rint64) i);
+    r_json_writer_key (&w, "s", -1);
+    r_json_writer_string (&w, "segment boundaries fall anywhere in this string", -1);
+    r_json_writer_end_object (&w);
+  }
+  r_json_writer_end_array (&w);
+  r_assert_cmpint (r_json_writer_finish (&w), ==, R_JSON_OK);
+
+  /* Output went into many segments of at most 300 bytes. */
+  r_assert_cmpuint (r_buffer_mem_count (buf), >, 1);
+  r_assert_cmpptr ((data = r_buffer_extract_dup_all (buf, &size)), !=, NULL);
+  r_assert_cmpuint (size, ==, r_buffer_get_size (buf));
+  r_assert_cmpptr ((v = r_json_parse (data, size, &res)), !=, NULL);
+  r_assert_cmpuint (r_json_value_get_array_size (v), ==, 200);
+  r_assert_cmpint (r_json_value_get_number_int (
+        r_json_value_get_object_field_value (r_json_value_get_array_value (v, 199), 0)), ==, 199);
+  r_json_value_unref (v);
+  r_free (data);
+  r_buffer_unref (buf);
+}
+RTEST_END;
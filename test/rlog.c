@@ -94,3 +94,277 @@ RTEST_F (rlog, threshold, RTEST_FAST)
 }
 RTEST_END;
 
+
+static rchar *
+rlog_async_read_back (RIOHandle handle)
+{
+  rsize size = (rsize)r_io_filesize (handle);
+  rchar * ret = r_malloc (size + 1);
+
+  r_assert_cmpint (r_io_seek (handle, 0, R_SEEK_MODE_SET), ==, 0);
+  r_assert_cmpint (r_io_read (handle, ret, size), ==, (rssize)size);
+  ret[size] = 0;
+  return ret;
+}
+
+static rsize
+rlog_async_count (const rchar * str, const rchar * needle)
+{
+  rsize ret = 0;
+  while ((str = r_str_ptr_of_str (str, -1, needle, -1)) != NULL) {
+    ret++;
+    str++;
+  }
+  return ret;
+}
+
+typedef struct {
+  rsize first;
+  rsize count;
+} RLogAsyncTestThread;
+
+static rpointer
+rlog_async_thread (rpointer data)
+{
+  RLogAsyncTestThread * t = data;
+  rsize i;
+
+  for (i = 0; i < t->count; i++)
+    R_LOG_INFO ("async-msg %"RSIZE_FMT, t->first + i);
+  return NULL;
+}
+
+RTEST (rlog, async_sink_threads, RTEST_FAST | RTEST_SYSTEM)
+{
+  RLogAsyncTestThread t[4];
+  RThread * th[4];
+  RLogAsync * sink;
+  RIOHandle handle;
+  RLogFunc oldfunc;
+  rpointer olddata;
+  rchar * out, * line;
+  rsize i;
+
+  r_assert_cmpint ((handle = r_io_open_tmp_full (NULL, "rlogasync", R_FILE_RDWR,
+          R_FILE_SHARE_EXCLUSIVE, R_FILE_FLAG_TEMPORARY, NULL, NULL)), !=, R_IO_HANDLE_INVALID);
+  /* A small ring and BLOCK: nothing may get lost however far ahead the
+   * logging threads run. */
+  r_assert_cmpptr ((sink = r_log_async_new (handle, R_LOG_ASYNC_OVERFLOW_BLOCK, 4096)), !=, NULL);
+
+  r_log_category_set_threshold (R_LOG_CAT_DEFAULT, R_LOG_LEVEL_INFO);
+  oldfunc = r_log_override_default_handler (r_log_async_handler, sink, &olddata);
+  for (i = 0; i < R_N_ELEMENTS (th); i++) {
+    t[i].first = i * 2000;
+    t[i].count = 2000;
+    r_assert_cmpptr ((th[i] = r_thread_new (NULL, rlog_async_thread, &t[i])), !=, NULL);
+  }
+  R_LOG_WARNING ("async-msg main");
+  for (i = 0; i < R_N_ELEMENTS (th); i++) {
+    r_thread_join (th[i]);
+    r_thread_unref (th[i]);
+  }
+  r_log_async_flush (sink);
+  r_log_override_default_handler (oldfunc, olddata, NULL);
+
+  r_assert_cmpuint (r_log_async_dropped (sink), ==, 0);
+  out = rlog_async_read_back (handle);
+  r_assert_cmpuint (rlog_async_count (out, "async-msg"), ==, 8001);
+  r_assert_cmpuint (rlog_async_count (out, "\n"), ==, 8001);
+  r_assert_cmpptr ((line = r_str_ptr_of_str (out, -1, "async-msg 7999\n", -1)), !=, NULL);
+  r_assert_cmpptr (r_str_ptr_of_str (out, -1, "INFO", -1), !=, NULL);
+  r_assert_cmpptr (r_str_ptr_of_str (out, -1, "logtest", -1), !=, NULL);
+  r_free (out);
+
+  r_log_async_unref (sink);
+  r_assert (r_io_close (handle));
+}
+RTEST_END;
+
+#ifdef R_OS_UNIX
+#include <unistd.h>
+
+static rpointer
+rlog_async_pipe_reader (rpointer data)
+{
+  int fd = RPOINTER_TO_INT (data);
+  rsize size = 0, alloc = 64 * 1024;
+  rchar * ret = r_malloc (alloc);
+  rssize res;
+
+  while ((res = read (fd, ret + size, alloc - size - 1)) > 0) {
+    if ((size += res) + 1 == alloc)
+      ret = r_realloc (ret, (alloc *= 2));
+  }
+  ret[size] = 0;
+  return ret;
+}
+
+RTEST (rlog, async_sink_overflow_count, RTEST_FAST | RTEST_SYSTEM)
+{
+  RLogAsync * sink;
+  RLogFunc oldfunc;
+  rpointer olddata;
+  RThread * reader;
+  rchar * out;
+  const rchar * p;
+  rsize i, reported = 0;
+  ruint dropped;
+  int fds[2];
+
+  /* Nobody reads the pipe until everything is logged: the writer stalls
+   * once the pipe is full and the ring overflows behind it. */
+  r_assert_cmpint (pipe (fds), ==, 0);
+  r_assert_cmpptr ((sink = r_log_async_new (fds[1], R_LOG_ASYNC_OVERFLOW_COUNT, 4096)), !=, NULL);
+
+  r_log_category_set_threshold (R_LOG_CAT_DEFAULT, R_LOG_LEVEL_INFO);
+  oldfunc = r_log_override_default_handler (r_log_async_handler, sink, &olddata);
+  for (i = 0; i < 5000; i++)
+    R_LOG_INFO ("async-msg %"RSIZE_FMT, i);
+
+  r_assert_cmpptr ((reader = r_thread_new (NULL, rlog_async_pipe_reader,
+          RINT_TO_POINTER (fds[0]))), !=, NULL);
+  r_log_async_flush (sink);
+  r_log_override_default_handler (oldfunc, olddata, NULL);
+  dropped = r_log_async_dropped (sink);
+  r_log_async_unref (sink);
+  close (fds[1]);
+
+  out = r_thread_join (reader);
+  r_thread_unref (reader);
+  close (fds[0]);
+
+  r_assert_cmpuint (dropped, >, 0);
+  for (p = out; (p = r_str_ptr_of_str (p, -1, "dropped ", -1)) != NULL; p++)
+    reported += r_str_to_uint (p + 8, NULL, 10, NULL);
+  r_assert_cmpuint (reported, ==, dropped);
+  r_assert_cmpuint (rlog_async_count (out, "async-msg"), ==, 5000 - dropped);
+  r_free (out);
+}
+RTEST_END;
+typedef struct {
+  rsize sites;
+  rsize preformatted;
+  rsize records;
+  rsize strhits;
+} RLogBinTestStats;
+
+static void
+rlog_bin_parse (const ruint8 * data, rsize size, const rchar * str,
+    RLogBinTestStats * st)
+{
+  ruint8 kinds[64][R_LOG_SITE_MAX_ARGS];
+  ruint16 nargs[64];
+  ruint32 u32[2], id, len;
+  rsize off, end, i;
+  int pass;
+
+  r_assert_cmpuint (size, >=, 32);
+  r_assert_cmpint (r_memcmp (data, "RLOGBIN1", 8), ==, 0);
+  r_memset (st, 0, sizeof (RLogBinTestStats));
+
+  /* Sites first, records can refer to sites registered later on */
+  for (pass = 0; pass < 2; pass++) {
+    for (off = 32; off < size; off = end) {
+      r_memcpy (u32, data + off, sizeof (u32));
+      off += sizeof (u32);
+      r_assert_cmpuint ((end = off + u32[1]), <=, size);
+
+      if (pass == 0 && u32[0] == 1) {
+        r_memcpy (&id, data + off, sizeof (id));
+        r_assert_cmpuint (id, <, 64);
+        r_memcpy (&nargs[id], data + off + 10, sizeof (ruint16));
+        r_memcpy (kinds[id], data + off + 12, nargs[id]);
+        st->sites++;
+        if (data[off + 9] & 1)
+          st->preformatted++;
+      } else if (pass == 1 && u32[0] == 2) {
+        for (off += sizeof (ruint64); off < end; st->records++) {
+          r_memcpy (&id, data + off, sizeof (id));
+          r_assert_cmpuint (id, <, 64);
+          off += sizeof (ruint32) + sizeof (ruint64);
+          for (i = 0; i < nargs[id]; i++) {
+            switch (kinds[id][i]) {
+              case 1: off += 4; break;
+              case 2: case 3: off += 8; break;
+              default:
+                r_memcpy (&len, data + off, sizeof (len));
+                off += sizeof (len);
+                if (len == 0xffffffff)
+                  break;
+                if (len == r_strlen (str) && r_memcmp (data + off, str, len) == 0)
+                  st->strhits++;
+                off += len;
+                break;
+            }
+          }
+          r_assert_cmpuint (off, <=, end);
+        }
+      }
+    }
+  }
+}
+
+static rpointer
+rlog_bin_thread (rpointer data)
+{
+  RLogAsyncTestThread * t = data;
+  rsize i;
+
+  for (i = 0; i < t->count; i++)
+    R_LOG_INFO ("bin-msg %"RSIZE_FMT" %s %.2f", t->first + i, "bin-str", 0.5);
+  return NULL;
+}
+
+RTEST (rlog, bin_trace, RTEST_FAST | RTEST_SYSTEM)
+{
+  RLogAsyncTestThread t[4];
+  RThread * th[4];
+  RLogBinTestStats st;
+  RLogKeepLastCtx ctx;
+  rchar * path;
+  ruint8 * data;
+  rsize i, size;
+  /* Not terminated, only the precision bounds the read */
+  const rchar slice[8] = { 'b', 'i', 'n', '-', 's', 't', 'r', 'X' };
+
+  r_assert_cmpptr ((path = r_fs_path_new_tmpname_full (NULL, "rlogbin", NULL)), !=, NULL);
+  r_log_category_set_threshold (R_LOG_CAT_DEFAULT, R_LOG_LEVEL_INFO);
+  r_assert (r_log_bin_open (path));
+  r_assert (r_log_bin_is_enabled ());
+
+  /* 5000 records per thread overflow the per-thread buffer a few times,
+   * the rest is written out when the threads exit. */
+  for (i = 0; i < R_N_ELEMENTS (th); i++) {
+    t[i].first = i * 5000;
+    t[i].count = 5000;
+    r_assert_cmpptr ((th[i] = r_thread_new (NULL, rlog_bin_thread, &t[i])), !=, NULL);
+  }
+  R_LOG_INFO ("bin-pos %1$d", 42);
+  R_LOG_INFO ("bin-slice %.*s", 7, slice);
+  R_LOG_INFO ("bin-lit %.7s", slice);
+  R_LOG_DEBUG ("bin-filtered");
+  for (i = 0; i < R_N_ELEMENTS (th); i++) {
+    r_thread_join (th[i]);
+    r_thread_unref (th[i]);
+  }
+  r_log_bin_close ();
+  r_assert (!r_log_bin_is_enabled ());
+
+  r_log_keep_last_begin (&ctx, R_LOG_CAT_DEFAULT);
+  R_LOG_INFO ("bin-after %d", 1);
+  r_assert_cmpstr (ctx.last.msg, ==, "bin-after 1");
+  r_log_keep_last_end (&ctx, FALSE, TRUE);
+
+  r_assert (r_file_read_all (path, &data, &size));
+  rlog_bin_parse (data, size, "bin-str", &st);
+  r_assert_cmpuint (st.sites, ==, 4);
+  r_assert_cmpuint (st.preformatted, ==, 2);
+  r_assert_cmpuint (st.records, ==, 20003);
+  r_assert_cmpuint (st.strhits, ==, 20001);
+  r_free (data);
+
+  r_assert_cmpint (unlink (path), ==, 0);
+  r_free (path);
+}
+RTEST_END;
+#endif
@@ -521,8 +521,9 @@ r_test_mpint_mul_ref (rmpint * ref, const rmpint * a, const rmpint * b)
   r_mpint_clear (&term);
 }
 
-/* The 1024- and 2048-bit fixed-size Comba path must agree with the schoolbook
- * reference for random full-size operands (and their squares). */
+/* The 1024- and 2048-bit fixed-size path (Comba, under Karatsuba at these
+ * sizes) must agree with the schoolbook reference for random full-size
+ * operands (and their squares). */
 RTEST (rmpint, mul_comba, RTEST_FAST)
 {
   static const ruint16 ndig[] = { 32, 64 };   /* 1024-bit, 2048-bit */
@@ -569,6 +570,74 @@ RTEST (rmpint, mul_comba, RTEST_FAST)
 }
 RTEST_END;
 
+/* Karatsuba recursion across odd splits, unequal (padded) operand widths,
+ * widths on both sides of the stack scratch cap (RMPINT_DEF_DIGITS) and
+ * carry-heavy patterns: all-ones digits maximise every carry chain and
+ * equal halves make |a0 - a1| zero. */
+RTEST (rmpint, mul_karatsuba, RTEST_FAST)
+{
+  static const struct { ruint16 na, nb; } sizes[] = {
+    { 31, 31 }, { 32, 32 }, { 33, 33 }, { 47, 47 }, { 65, 65 }, { 96, 96 },
+    { 127, 127 }, { 128, 128 }, { 200, 200 }, { 256, 256 },
+    { 64, 63 }, { 63, 64 }, { 64, 40 }, { 96, 48 }, { 128, 70 }, { 257, 256 },
+  };
+  rmpint a = R_MPINT_INIT, b = R_MPINT_INIT;
+  rmpint prod = R_MPINT_INIT, ref = R_MPINT_INIT;
+  RPrng * prng;
+  rsize si;
+
+  r_assert_cmpptr ((prng = r_prng_new_mt ()), !=, NULL);
+
+  for (si = 0; si < R_N_ELEMENTS (sizes); si++) {
+    ruint8 bufa[257 * sizeof (rmpint_digit)], bufb[257 * sizeof (rmpint_digit)];
+    rsize na = sizes[si].na * sizeof (rmpint_digit);
+    rsize nb = sizes[si].nb * sizeof (rmpint_digit);
+    int it;
+
+    for (it = 0; it < 6; it++) {
+      switch (it) {
+        case 0:
+          r_memset (bufa, 0xff, na);
+          r_memset (bufb, 0xff, nb);
+          break;
+        case 1:
+          /* Equal halves on a, a single high bit on b. */
+          r_assert (r_prng_fill (prng, bufa, na / 2));
+          r_memcpy (bufa + na - na / 2, bufa, na / 2);
+          if (na & 1) bufa[na / 2] = 0x5a;
+          r_memset (bufb, 0, nb);
+          bufb[0] = 0x80;
+          break;
+        default:
+          r_assert (r_prng_fill (prng, bufa, na));
+          r_assert (r_prng_fill (prng, bufb, nb));
+          bufa[0] |= 0x80;
+          bufb[0] |= 0x80;
+          break;
+      }
+      r_mpint_init_binary (&a, bufa, na);
+      r_mpint_init_binary (&b, bufb, nb);
+
+      r_assert (r_mpint_mul (&prod, &a, &b));
+      r_test_mpint_mul_ref (&ref, &a, &b);
+      r_assert_cmpint (r_mpint_cmp (&prod, &ref), ==, 0);
+
+      /* In place, as the Montgomery ladders use it. */
+      r_test_mpint_mul_ref (&ref, &a, &a);
+      r_assert (r_mpint_mul (&a, &a, &a));
+      r_assert_cmpint (r_mpint_cmp (&a, &ref), ==, 0);
+
+      r_mpint_clear (&a);
+      r_mpint_clear (&b);
+    }
+  }
+
+  r_mpint_clear (&prod);
+  r_mpint_clear (&ref);
+  r_prng_unref (prng);
+}
+RTEST_END;
+
 RTEST (rmpint, div, RTEST_FAST)
 {
   rmpint n = R_MPINT_INIT, d = R_MPINT_INIT, q = R_MPINT_INIT, r = R_MPINT_INIT, cmp;
@@ -640,6 +640,68 @@ RTEST (rmpint_fe_big, expmod_rsa_2048, RTEST_FAST)
 }
 RTEST_END;
 
+RTEST (rmpint_fe_big, expmod_wide_moduli, RTEST_FAST)
+{
+  /* Widths on both sides of the IFMA dispatch threshold and of the
+   * 8-limb vector boundaries, including all-ones moduli that sit right
+   * under R. r_mpint_fe_big_expmod_ct and r_mpint_expmod pick the
+   * 52-bit IFMA kernel when the CPU has it; r_mpint_expmod_ct never
+   * does, so it is the independent reference. */
+  static const ruint bits[] = { 480, 512, 544, 1024, 1056, 1536, 2048, 3072, 4096 };
+  rmpint m, base, exp, expected, got;
+  RPrng * prng;
+  rsize bi;
+
+  r_assert_cmpptr ((prng = r_prng_new_mt ()), !=, NULL);
+  r_mpint_init (&m);
+  r_mpint_init (&base);
+  r_mpint_init (&exp);
+  r_mpint_init (&expected);
+  r_mpint_init (&got);
+
+  for (bi = 0; bi < R_N_ELEMENTS (bits); bi++) {
+    ruint8 buf[512];
+    rsize size = bits[bi] / 8;
+    int it;
+
+    for (it = 0; it < 3; it++) {
+      if (it == 0) {
+        r_memset (buf, 0xff, size);
+      } else {
+        r_assert (r_prng_fill (prng, buf, size));
+        buf[0] |= 0x80;
+        buf[size - 1] |= 1;
+      }
+      r_mpint_set_binary (&m, buf, size);
+
+      r_assert (r_prng_fill (prng, buf, size));
+      r_mpint_set_binary (&exp, buf, size);
+      if (it == 1) {
+        /* base = m - 1 */
+        r_assert (r_mpint_sub_i32 (&base, &m, 1));
+      } else {
+        r_assert (r_prng_fill (prng, buf, size));
+        r_mpint_set_binary (&base, buf, size);
+        r_assert (r_mpint_mod (&base, &base, &m));
+      }
+
+      r_assert (r_mpint_expmod_ct (&expected, &base, &exp, &m, bits[bi]));
+      r_assert (big_expmod_via (&got, &base, &exp, &m, bits[bi]));
+      r_assert_cmpint (r_mpint_cmp (&got, &expected), ==, 0);
+      r_assert (r_mpint_expmod (&got, &base, &exp, &m));
+      r_assert_cmpint (r_mpint_cmp (&got, &expected), ==, 0);
+    }
+  }
+
+  r_mpint_clear (&m);
+  r_mpint_clear (&base);
+  r_mpint_clear (&exp);
+  r_mpint_clear (&expected);
+  r_mpint_clear (&got);
+  r_prng_unref (prng);
+}
+RTEST_END;
+
 HEAVY_RTEST (rmpint_fe_big, expmod_rsa_8192, RTEST_FASTSLOW)
 {
   /* Same cross-check at RSA-8192. Slow enough on a debug build to
@@ -197,6 +197,36 @@ RTEST (rmsgdigest, sha1, R_TEST_TYPE_FAST)
 }
 RTEST_END;
 
+RTEST (rmsgdigest, copy, R_TEST_TYPE_FAST)
+{
+  RMsgDigest * md, * cpy, * other;
+  rchar * hex;
+
+  r_assert_cmpptr ((md = r_msg_digest_new_sha1 ()), !=, NULL);
+  r_assert (r_msg_digest_update (md, "foo", 3));
+  r_assert_cmpptr ((cpy = r_msg_digest_copy (md)), !=, NULL);
+
+  /* Both continue independently from the copied midstate. */
+  r_assert (r_msg_digest_update (md, "bar", 3));
+  r_assert (r_msg_digest_update (cpy, "bar", 3));
+  r_assert_cmpstr ((hex = r_msg_digest_get_hex (cpy)), ==,
+      "8843d7f92416211de9ebb963ff4ce28125932878");
+  r_free (hex);
+
+  r_assert (r_msg_digest_copy_state (cpy, md));
+  r_assert_cmpstr ((hex = r_msg_digest_get_hex (cpy)), ==,
+      "8843d7f92416211de9ebb963ff4ce28125932878");
+  r_free (hex);
+
+  r_assert_cmpptr ((other = r_msg_digest_new_md5 ()), !=, NULL);
+  r_assert (!r_msg_digest_copy_state (other, md));
+  r_msg_digest_free (other);
+
+  r_msg_digest_free (cpy);
+  r_msg_digest_free (md);
+}
+RTEST_END;
+
 RTEST (rmsgdigest, new_dispatch, R_TEST_TYPE_FAST)
 {
   /* r_msg_digest_new must dispatch to every implemented digest, not
@@ -0,0 +1,89 @@
+#include <rlib/ros.h>
+
+RTEST (rperf, sample, RTEST_FAST)
+{
+  RPerfSample a, b, d;
+
+  r_memset (&a, 0, sizeof (a));
+  r_memset (&b, 0, sizeof (b));
+  a.valid = R_PERF_COUNTER_MASK_ALL;
+  a.value[R_PERF_COUNTER_CYCLES] = 1000;
+  a.value[R_PERF_COUNTER_INSTRUCTIONS] = 2500;
+  b.valid = R_PERF_COUNTER_BIT (R_PERF_COUNTER_CYCLES) |
+    R_PERF_COUNTER_BIT (R_PERF_COUNTER_INSTRUCTIONS);
+  b.value[R_PERF_COUNTER_CYCLES] = 500;
+  b.value[R_PERF_COUNTER_INSTRUCTIONS] = 500;
+
+  r_assert_cmpdouble (r_perf_sample_ipc (&a), ==, 2.5);
+  r_perf_sample_sub (&d, &a, &b);
+  r_assert_cmpuint (d.valid, ==, b.valid);
+  r_assert_cmpuint (d.value[R_PERF_COUNTER_CYCLES], ==, 500);
+  r_assert_cmpdouble (r_perf_sample_ipc (&d), ==, 4.0);
+  r_perf_sample_add (&a, &b);
+  r_assert_cmpuint (a.valid, ==, b.valid);
+  r_assert_cmpuint (a.value[R_PERF_COUNTER_CYCLES], ==, 1500);
+  r_assert (!r_perf_sample_has (&a, R_PERF_COUNTER_CACHE_MISSES));
+
+  d.valid = R_PERF_COUNTER_BIT (R_PERF_COUNTER_CYCLES);
+  r_assert_cmpdouble (r_perf_sample_ipc (&d), ==, 0.0);
+
+  r_assert_cmpstr (r_perf_counter_name (R_PERF_COUNTER_CACHE_MISSES), ==, "cache-misses");
+  r_assert_cmpptr (r_perf_counter_name (R_PERF_COUNTER_COUNT), ==, NULL);
+}
+RTEST_END;
+
+RTEST (rperf, counters, RTEST_FAST | RTEST_SYSTEM)
+{
+  RPerfCounters * pc;
+  RPerfSample s, d;
+  volatile ruint64 acc = 0;
+  ruint i;
+
+  r_assert_cmpuint (r_perf_counters_get_mask (NULL), ==, 0);
+  r_assert (!r_perf_counters_start (NULL));
+
+  /* No perf_event_open, no PMU or not permitted; nothing more to check */
+  if ((pc = r_perf_counters_new (R_PERF_COUNTER_MASK_ALL)) == NULL)
+    return;
+
+  r_assert_cmpuint (r_perf_counters_get_mask (pc), !=, 0);
+  r_assert_cmpuint (r_perf_counters_get_mask (pc) & ~R_PERF_COUNTER_MASK_ALL, ==, 0);
+
+  r_assert (r_perf_counters_start (pc));
+  for (i = 0; i < 100000; i++)
+    acc += i;
+  r_thread_usleep (1000);
+  r_assert (r_perf_counters_read (pc, &s));
+  r_assert_cmpuint (s.valid, ==, r_perf_counters_get_mask (pc));
+  r_assert (r_perf_counters_stop (pc, &s));
+  r_assert_cmpuint (s.valid, ==, r_perf_counters_get_mask (pc));
+
+  if (r_perf_sample_has (&s, R_PERF_COUNTER_INSTRUCTIONS))
+    r_assert_cmpuint (s.value[R_PERF_COUNTER_INSTRUCTIONS], >=, 100000);
+  if (r_perf_sample_has (&s, R_PERF_COUNTER_CONTEXT_SWITCHES))
+    r_assert_cmpuint (s.value[R_PERF_COUNTER_CONTEXT_SWITCHES], >=, 1);
+
+  /* Stopped counters don't move */
+  r_thread_usleep (1000);
+  r_assert (r_perf_counters_read (pc, &d));
+  r_assert_cmpuint (d.valid, ==, s.valid);
+  for (i = 0; i < R_PERF_COUNTER_COUNT; i++)
+    r_assert_cmpuint (d.value[i], ==, s.value[i]);
+
+  /* Resuming adds on to what was counted before the pause */
+  r_assert (!r_perf_counters_pause (pc));
+  r_assert (r_perf_counters_resume (pc));
+  r_thread_usleep (1000);
+  r_assert (r_perf_counters_pause (pc));
+  r_assert (!r_perf_counters_pause (pc));
+  r_assert (r_perf_counters_read (pc, &d));
+  for (i = 0; i < R_PERF_COUNTER_COUNT; i++)
+    r_assert_cmpuint (d.value[i], >=, s.value[i]);
+  if (r_perf_sample_has (&s, R_PERF_COUNTER_CONTEXT_SWITCHES)) {
+    r_assert_cmpuint (d.value[R_PERF_COUNTER_CONTEXT_SWITCHES], >,
+        s.value[R_PERF_COUNTER_CONTEXT_SWITCHES]);
+  }
+
+  r_perf_counters_unref (pc);
+}
+RTEST_END;
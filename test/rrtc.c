@@ -1221,6 +1221,87 @@ RTEST_F (rrtc, send_recv, RTEST_FAST)
 }
 RTEST_END;
 
+RTEST_F (rrtc, sender_congestion_control, RTEST_FAST)
+{
+  /* alice sends over a link that loses every fourth packet; bob reports
+   * what arrived as TWCC feedback, which has alice back off her estimate
+   * and the pacer with it. */
+  static const ruint8 pay[100] = { 0 };
+  ruint8 ext[R_RTP_TRANSPORT_CC_EXT_SIZE];
+  RClockTime arrival[40];
+  RRTPBuffer rtp = R_RTP_BUFFER_INIT;
+  RBuffer * buf, * payload, * pop;
+  RRtcRtpParameters * p;
+  RRtcBwe * bwe;
+  ruint64 start = 10000000, pacing;
+  ruint16 i, seq;
+
+  r_assert_cmpint (r_rtc_rtp_sender_enable_congestion_control (fixture->alice.send,
+        0, start, 50000, 0), ==, R_RTC_INVAL);
+  r_assert_cmpint (r_rtc_rtp_sender_enable_congestion_control (fixture->alice.send,
+        3, start, 50000, 0), ==, R_RTC_OK);
+  r_assert_cmpuint (r_rtc_rtp_sender_get_pacing_bitrate (fixture->alice.send), ==, 0);
+
+  r_assert_cmpptr ((p = r_rtc_rtp_parameters_new (R_STR_WITH_SIZE_ARGS ("audio"))), !=, NULL);
+  r_assert_cmpint (r_rtc_rtp_parameters_add_encoding_simple (p, 0xdeadbeef,
+        R_RTP_PT_PCMU), ==, R_RTC_OK);
+  r_assert_cmpint (r_rtc_rtp_sender_start (fixture->alice.send, p, fixture->loop), ==, R_RTC_OK);
+  r_assert_cmpint (r_rtc_rtp_receiver_start (fixture->bob.recv, p, fixture->loop), ==, R_RTC_OK);
+  r_rtc_rtp_parameters_unref (p);
+  r_assert_cmpuint ((pacing = r_rtc_rtp_sender_get_pacing_bitrate (fixture->alice.send)),
+      ==, start * R_RTC_PACER_FACTOR / 100);
+
+  /* Without a transport-cc element to stamp the packet is refused */
+  r_assert_cmpptr ((buf = r_buffer_new_rtp_buffer_alloc (0, 0, 0)), !=, NULL);
+  r_assert_cmpint (r_rtc_rtp_sender_send (fixture->alice.send, buf), ==, R_RTC_INVAL);
+  r_buffer_unref (buf);
+
+  /* The pacer budget at 25 Mbps covers the whole burst */
+  r_assert (r_rtp_transport_cc_ext_write (ext, 3, 0xffff));
+  r_assert_cmpptr ((payload = r_buffer_new_dup (pay, sizeof (pay))), !=, NULL);
+  for (i = 0; i < R_N_ELEMENTS (arrival); i++) {
+    r_assert_cmpptr ((buf = r_buffer_new_rtp_buffer_ext (payload, 0, 0,
+            0xbede, ext, sizeof (ext))), !=, NULL);
+    r_assert (r_rtp_buffer_map (&rtp, buf, R_MEM_MAP_WRITE));
+    r_rtp_buffer_set_ssrc (&rtp, 0xdeadbeef);
+    r_assert (r_rtp_buffer_unmap (&rtp, buf));
+    r_assert_cmpint (r_rtc_rtp_sender_send (fixture->alice.send, buf), ==, R_RTC_OK);
+    r_buffer_unref (buf);
+  }
+  r_buffer_unref (payload);
+
+  r_assert_cmpuint (r_queue_size (&fixture->bob.rtp), ==, R_N_ELEMENTS (arrival));
+  for (i = 0; i < R_N_ELEMENTS (arrival); i++) {
+    r_assert_cmpptr ((pop = r_queue_pop (&fixture->bob.rtp)), !=, NULL);
+    r_assert (r_rtp_buffer_map (&rtp, pop, R_MEM_MAP_READ));
+    r_assert (r_rtp_buffer_get_transport_cc (&rtp, 3, &seq));
+    r_assert_cmpuint (seq, ==, i);
+    r_assert (r_rtp_buffer_unmap (&rtp, pop));
+    r_buffer_unref (pop);
+    arrival[i] = (i % 4 == 3) ? R_CLOCK_TIME_NONE : (RClockTime)(20 + i) * R_MSECOND;
+  }
+
+  r_assert_cmpptr ((buf = r_buffer_new ()), !=, NULL);
+  r_assert (r_rtcp_buffer_add_twcc (buf, 0xb0b0b0b0, 0xdeadbeef, 0, 0,
+        arrival, R_N_ELEMENTS (arrival)));
+  r_assert_cmpint (r_rtc_rtp_sender_send (fixture->bob.send, buf), ==, R_RTC_OK);
+  r_buffer_unref (buf);
+  r_assert_cmpuint (r_queue_size (&fixture->alice.send_rtcp), ==, 1);
+
+  r_assert_cmpptr ((bwe = r_rtc_rtp_sender_get_bwe (fixture->alice.send)), !=, NULL);
+  r_assert_cmpdouble (r_rtc_bwe_get_loss (bwe), ==, 0.25);
+  r_assert_cmpuint (r_rtc_bwe_get_bitrate (bwe), <, start);
+  r_assert_cmpuint (r_rtc_rtp_sender_get_pacing_bitrate (fixture->alice.send), ==,
+      r_rtc_bwe_get_bitrate (bwe) * R_RTC_PACER_FACTOR / 100);
+  r_assert_cmpuint (r_rtc_rtp_sender_get_pacing_bitrate (fixture->alice.send), <, pacing);
+  r_rtc_bwe_unref (bwe);
+
+  r_assert_cmpint (r_rtc_rtp_sender_stop (fixture->alice.send), ==, R_RTC_OK);
+  r_assert_cmpint (r_rtc_rtp_receiver_stop (fixture->bob.recv), ==, R_RTC_OK);
+  r_assert_cmpuint (r_rtc_rtp_sender_get_pacing_bitrate (fixture->alice.send), ==, 0);
+}
+RTEST_END;
+
 RTEST_F (rrtc, crypto_transport_close, RTEST_FAST)
 {
   /* r_rtc_crypto_transport_close closes the underlying ICE transport and
@@ -0,0 +1,278 @@
+#include <rlib/rrtc.h>
+
+/* Single bottleneck link: fixed capacity, drop-tail queue bounded by a
+ * maximum queuing delay, random loss from a deterministic LCG. */
+typedef struct {
+  ruint64 capacity;
+  RClockTime propagation;
+  RClockTime queue_max;
+  ruint loss_permille;
+  ruint32 lcg;
+  RClockTime busy_until;
+} SimLink;
+
+#define SIM_PACKET_SIZE     1200
+#define SIM_FEEDBACK        (100 * R_MSECOND)
+#define SIM_HISTORY         4096
+
+static RClockTime
+sim_link_send (SimLink * link, RClockTime now, rsize size)
+{
+  link->lcg = link->lcg * 1103515245 + 12345;
+  if ((link->lcg >> 16) % 1000 < link->loss_permille)
+    return R_CLOCK_TIME_NONE;
+
+  if (link->busy_until < now)
+    link->busy_until = now;
+  if (link->busy_until - now > link->queue_max)
+    return R_CLOCK_TIME_NONE;
+  link->busy_until += size * 8 * R_SECOND / link->capacity;
+  return link->busy_until + link->propagation;
+}
+
+/* Run @bwe as an unpaced sender at its own estimate over @link for
+ * @duration, with TWCC feedback every SIM_FEEDBACK carried back over the
+ * same propagation delay. Returns the mean estimate over the last @tail. */
+static ruint64
+sim_run (RRtcBwe * bwe, SimLink * link, RClockTime duration, RClockTime tail)
+{
+  RClockTime * arrival = r_mem_new_n (RClockTime, SIM_HISTORY);
+  RClockTime fb[SIM_HISTORY];
+  RClockTime t, next_send = 0, next_fb = SIM_FEEDBACK, fb_due = R_CLOCK_TIME_NONE;
+  ruint16 seq = 0, base = 0;
+  RBuffer * pending = NULL;
+  ruint64 sum = 0, samples = 0;
+  ruint8 fbcount = 0;
+
+  link->busy_until = 0;
+  for (t = 0; t < duration; t += R_MSECOND) {
+    while (next_send <= t) {
+      arrival[seq % SIM_HISTORY] = sim_link_send (link, next_send, SIM_PACKET_SIZE);
+      r_rtc_bwe_on_packet_sent (bwe, seq++, SIM_PACKET_SIZE, next_send);
+      next_send += SIM_PACKET_SIZE * 8 * R_SECOND / r_rtc_bwe_get_bitrate (bwe);
+    }
+
+    if (t >= next_fb) {
+      ruint16 s, last = base, count;
+
+      /* Report everything up to the newest packet received by now */
+      for (s = base; s != seq; s++) {
+        RClockTime a = arrival[s % SIM_HISTORY];
+        if (R_CLOCK_TIME_IS_VALID (a) && a <= t)
+          last = s + 1;
+      }
+      count = last - base;
+      if (count > 0 && pending == NULL) {
+        for (s = 0; s < count; s++)
+          fb[s] = arrival[(ruint16)(base + s) % SIM_HISTORY];
+        r_assert_cmpptr ((pending = r_buffer_new ()), !=, NULL);
+        r_assert (r_rtcp_buffer_add_twcc (pending, 1, 2, fbcount++, base, fb, count));
+        fb_due = t + link->propagation;
+        base = last;
+      }
+      next_fb += SIM_FEEDBACK;
+    }
+
+    if (pending != NULL && t >= fb_due) {
+      RRTCPBuffer rtcp = R_RTCP_BUFFER_INIT;
+
+      r_assert (r_rtcp_buffer_map (&rtcp, pending, R_MEM_MAP_READ));
+      r_assert_cmpint (r_rtc_bwe_on_feedback (bwe,
+            r_rtcp_buffer_get_first_packet (&rtcp), t), ==, R_RTC_OK);
+      r_assert (r_rtcp_buffer_unmap (&rtcp, pending));
+      r_buffer_unref (pending);
+      pending = NULL;
+    }
+
+    if (t >= duration - tail && t % (100 * R_MSECOND) == 0) {
+      sum += r_rtc_bwe_get_bitrate (bwe);
+      samples++;
+    }
+  }
+
+  if (pending != NULL)
+    r_buffer_unref (pending);
+  r_free (arrival);
+  return samples > 0 ? sum / samples : 0;
+}
+
+RTEST (rrtccongestion, bwe_new, RTEST_FAST)
+{
+  RRtcBwe * bwe;
+
+  r_assert_cmpptr (r_rtc_bwe_new (0, 0, 0), ==, NULL);
+  r_assert_cmpptr (r_rtc_bwe_new (100000, 200000, 0), ==, NULL);
+  r_assert_cmpptr (r_rtc_bwe_new (300000, 0, 200000), ==, NULL);
+
+  r_assert_cmpptr ((bwe = r_rtc_bwe_new (300000, 50000, 0)), !=, NULL);
+  r_assert_cmpuint (r_rtc_bwe_get_bitrate (bwe), ==, 300000);
+  r_assert_cmpuint (r_rtc_bwe_get_acked_bitrate (bwe), ==, 0);
+  r_assert_cmpint (r_rtc_bwe_get_usage (bwe), ==, R_RTC_BWE_NORMAL);
+  r_assert_cmpint (r_rtc_bwe_on_feedback (bwe, NULL, 0), ==, R_RTC_INVAL);
+  r_rtc_bwe_unref (bwe);
+}
+RTEST_END;
+
+RTEST (rrtccongestion, bwe_bottleneck_converges, RTEST_FAST)
+{
+  SimLink link = { 1000000, 50 * R_MSECOND, 250 * R_MSECOND, 10, 1, 0 };
+  RRtcBwe * bwe;
+  ruint64 avg;
+
+  r_assert_cmpptr ((bwe = r_rtc_bwe_new (300000, 50000, 5000000)), !=, NULL);
+  avg = sim_run (bwe, &link, 60 * R_SECOND, 20 * R_SECOND);
+  r_assert_cmpuint (avg, >=, link.capacity / 2);
+  r_assert_cmpuint (avg, <=, link.capacity * 6 / 5);
+  r_assert_cmpuint (r_rtc_bwe_get_acked_bitrate (bwe), <=, link.capacity * 11 / 10);
+  r_rtc_bwe_unref (bwe);
+}
+RTEST_END;
+
+RTEST (rrtccongestion, bwe_ramp_up_and_cap, RTEST_FAST)
+{
+  SimLink link = { 50000000, 20 * R_MSECOND, 250 * R_MSECOND, 0, 1, 0 };
+  RRtcBwe * bwe;
+
+  r_assert_cmpptr ((bwe = r_rtc_bwe_new (300000, 50000, 2000000)), !=, NULL);
+  sim_run (bwe, &link, 15 * R_SECOND, 0);
+  r_assert_cmpuint (r_rtc_bwe_get_bitrate (bwe), >, 2 * 300000);
+  r_assert_cmpuint (r_rtc_bwe_get_bitrate (bwe), <, 2000000);
+  r_rtc_bwe_unref (bwe);
+
+  r_assert_cmpptr ((bwe = r_rtc_bwe_new (300000, 50000, 2000000)), !=, NULL);
+  sim_run (bwe, &link, 40 * R_SECOND, 0);
+  r_assert_cmpuint (r_rtc_bwe_get_bitrate (bwe), ==, 2000000);
+  r_assert_cmpint (r_rtc_bwe_get_usage (bwe), ==, R_RTC_BWE_NORMAL);
+  r_rtc_bwe_unref (bwe);
+}
+RTEST_END;
+
+RTEST (rrtccongestion, bwe_backs_off_on_loss, RTEST_FAST)
+{
+  SimLink link = { 50000000, 20 * R_MSECOND, 250 * R_MSECOND, 250, 1, 0 };
+  RRtcBwe * bwe;
+
+  r_assert_cmpptr ((bwe = r_rtc_bwe_new (1000000, 50000, 0)), !=, NULL);
+  sim_run (bwe, &link, 5 * R_SECOND, 0);
+  r_assert_cmpdouble (r_rtc_bwe_get_loss (bwe), >, 0.1);
+  r_assert_cmpuint (r_rtc_bwe_get_bitrate (bwe), <, 500000);
+  r_assert_cmpuint (r_rtc_bwe_get_bitrate (bwe), >=, 50000);
+  r_rtc_bwe_unref (bwe);
+}
+RTEST_END;
+
+
+typedef struct {
+  RClock * clock;
+  RClockTime sent[32];
+  rsize count;
+} PacerSink;
+
+static RRtcError
+pacer_sink_send (rpointer data, RBuffer * buf)
+{
+  PacerSink * sink = data;
+  (void) buf;
+
+  if (sink->count < R_N_ELEMENTS (sink->sent))
+    sink->sent[sink->count] = r_clock_get_time (sink->clock);
+  sink->count++;
+  return R_RTC_OK;
+}
+
+static rboolean
+update_clock_qmsec_func (rpointer data, REvLoop * loop)
+{
+  RClock * clock = data;
+  (void) loop;
+
+  return r_test_clock_update_time (clock, r_clock_get_time (clock) + R_MSECOND / 4);
+}
+
+RTEST (rrtccongestion, pacer_spacing, RTEST_FAST)
+{
+  static ruint8 pkt[1000];
+  PacerSink sink = { NULL, { 0 }, 0 };
+  REvLoop * loop;
+  RRtcPacer * pacer;
+  RBuffer * buf;
+  rsize i;
+
+  r_assert_cmpptr ((sink.clock = r_test_clock_new (FALSE)), !=, NULL);
+  r_assert_cmpptr ((loop = r_ev_loop_new_full (sink.clock, NULL)), !=, NULL);
+  r_assert (r_ev_loop_add_prepare (loop, update_clock_qmsec_func,
+        r_clock_ref (sink.clock), r_clock_unref));
+
+  /* 800 kbps: 1000 bytes every 10 ms once the initial budget is spent */
+  r_assert_cmpptr ((pacer = r_rtc_pacer_new (loop, 800000,
+          pacer_sink_send, &sink, NULL)), !=, NULL);
+  r_assert_cmpuint (r_rtc_pacer_get_bitrate (pacer), ==, 800000);
+  r_assert_cmpptr ((buf = r_buffer_new_dup (pkt, sizeof (pkt))), !=, NULL);
+  r_assert_cmpint (r_rtc_pacer_enqueue (pacer, NULL), ==, R_RTC_INVAL);
+  for (i = 0; i < 20; i++)
+    r_assert_cmpint (r_rtc_pacer_enqueue (pacer, buf), ==, R_RTC_OK);
+  r_buffer_unref (buf);
+
+  r_assert_cmpuint (sink.count, ==, 2);
+  r_assert_cmpuint (r_rtc_pacer_get_queue_size (pacer), ==, 18);
+  r_assert_cmpuint (r_rtc_pacer_get_queue_bytes (pacer), ==, 18 * sizeof (pkt));
+
+  r_assert_cmpuint (r_ev_loop_run (loop, R_EV_LOOP_RUN_LOOP), ==, 0);
+  r_assert_cmpuint (sink.count, ==, 20);
+  r_assert_cmpuint (r_rtc_pacer_get_queue_size (pacer), ==, 0);
+  r_assert_cmpuint (r_rtc_pacer_get_queue_bytes (pacer), ==, 0);
+  for (i = 3; i < sink.count; i++) {
+    r_assert_cmpuint (sink.sent[i] - sink.sent[i - 1], >=, 5 * R_MSECOND);
+    r_assert_cmpuint (sink.sent[i] - sink.sent[i - 1], <=, 15 * R_MSECOND);
+  }
+  r_assert_cmpuint (sink.sent[19], >=, 170 * R_MSECOND);
+  r_assert_cmpuint (sink.sent[19], <=, 200 * R_MSECOND);
+
+  r_rtc_pacer_unref (pacer);
+  r_ev_loop_unref (loop);
+  r_clock_unref (sink.clock);
+}
+RTEST_END;
+
+RTEST (rrtccongestion, pacer_unpaced_and_flush, RTEST_FAST)
+{
+  static ruint8 pkt[1000];
+  PacerSink sink = { NULL, { 0 }, 0 };
+  REvLoop * loop;
+  RRtcPacer * pacer;
+  RBuffer * buf;
+  rsize i;
+
+  r_assert_cmpptr ((sink.clock = r_test_clock_new (FALSE)), !=, NULL);
+  r_assert_cmpptr ((loop = r_ev_loop_new_full (sink.clock, NULL)), !=, NULL);
+  r_assert_cmpptr (r_rtc_pacer_new (NULL, 0, pacer_sink_send, &sink, NULL), ==, NULL);
+  r_assert_cmpptr (r_rtc_pacer_new (loop, 0, NULL, &sink, NULL), ==, NULL);
+
+  r_assert_cmpptr ((pacer = r_rtc_pacer_new (loop, 0,
+          pacer_sink_send, &sink, NULL)), !=, NULL);
+  r_assert_cmpptr ((buf = r_buffer_new_dup (pkt, sizeof (pkt))), !=, NULL);
+  for (i = 0; i < 10; i++)
+    r_assert_cmpint (r_rtc_pacer_enqueue (pacer, buf), ==, R_RTC_OK);
+  r_assert_cmpuint (sink.count, ==, 10);
+
+  /* Queue up at a low rate, then drop pacing: everything goes out at once */
+  r_rtc_pacer_set_bitrate (pacer, 100000);
+  for (i = 0; i < 10; i++)
+    r_assert_cmpint (r_rtc_pacer_enqueue (pacer, buf), ==, R_RTC_OK);
+  r_assert_cmpuint (r_rtc_pacer_get_queue_size (pacer), >, 0);
+  r_rtc_pacer_set_bitrate (pacer, 0);
+  r_assert_cmpuint (r_rtc_pacer_get_queue_size (pacer), ==, 0);
+  r_assert_cmpuint (sink.count, ==, 20);
+
+  /* Unreffing with packets queued cancels the timer and drops them */
+  r_rtc_pacer_set_bitrate (pacer, 100000);
+  for (i = 0; i < 10; i++)
+    r_assert_cmpint (r_rtc_pacer_enqueue (pacer, buf), ==, R_RTC_OK);
+  r_buffer_unref (buf);
+  r_rtc_pacer_unref (pacer);
+  r_assert_cmpuint (r_ev_loop_run (loop, R_EV_LOOP_RUN_NOWAIT), ==, 0);
+
+  r_ev_loop_unref (loop);
+  r_clock_unref (sink.clock);
+}
+RTEST_END;
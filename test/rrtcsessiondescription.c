@@ -1234,3 +1234,35 @@ RTEST (rrtcsessiondescription, protocol_string, RTEST_FAST)
 }
 RTEST_END;
 
+
+RTEST (rrtcsessiondescription, generated_mid_is_stable, RTEST_FAST)
+{
+  /* A media section without a=mid gets a generated mid; it must depend only
+   * on the SDP text so the same offer maps to the same mid on every run. */
+  static const rchar sdp[] =
+    "v=0\r\n"
+    "o=- 123 2 IN IP4 127.0.0.1\r\n"
+    "s=-\r\n"
+    "t=0 0\r\n"
+    "m=audio 9 UDP/TLS/RTP/SAVPF 111\r\n"
+    "c=IN IP4 0.0.0.0\r\n"
+    "a=rtpmap:111 opus/48000/2\r\n"
+    "a=sendrecv\r\n";
+  RRtcSessionDescription * sd;
+  RRtcMediaLineInfo * mline;
+  RBuffer * buf;
+  RRtcError err;
+
+  r_assert_cmpptr ((buf = r_buffer_new_dup (sdp, sizeof (sdp) - 1)), !=, NULL);
+  r_assert_cmpptr ((sd = r_rtc_session_description_new_from_sdp (
+          R_RTC_SIGNAL_OFFER, buf, &err)), !=, NULL);
+  r_assert_cmpint (err, ==, R_RTC_OK);
+  r_buffer_unref (buf);
+
+  r_assert_cmpptr ((mline = r_rtc_session_description_get_media_line_by_idx (sd, 0)), !=, NULL);
+  /* Big-endian CRC32 of "audio 9 ...\r\na=sendrecv", base64 encoded. */
+  r_assert_cmpstr (mline->mid, ==, "BiiRFg==");
+
+  r_rtc_session_description_unref (sd);
+}
+RTEST_END;
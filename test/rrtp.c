@@ -826,6 +826,47 @@ RTEST (rrtp, write_ext_hdr, RTEST_FAST)
 }
 RTEST_END;
 
+RTEST (rrtp, transport_cc_ext, RTEST_FAST)
+{
+  RBuffer * buf, * payload;
+  RRTPBuffer rtp = R_RTP_BUFFER_INIT;
+  static const ruint8 pay[4] = { 0xaa, 0xbb, 0xcc, 0xdd };
+  static const ruint8 wire[] = { 0x31, 0x12, 0x34, 0x00 };
+  ruint8 ext[R_RTP_TRANSPORT_CC_EXT_SIZE];
+  ruint16 seq = 0;
+
+  r_assert (!r_rtp_transport_cc_ext_write (ext, 0, 0x1234));
+  r_assert (!r_rtp_transport_cc_ext_write (ext, 15, 0x1234));
+  r_assert (r_rtp_transport_cc_ext_write (ext, 3, 0x1234));
+  r_assert_cmpmem (ext, ==, wire, sizeof (wire));
+
+  r_assert_cmpptr ((payload = r_buffer_new_dup (pay, sizeof (pay))), !=, NULL);
+  r_assert_cmpptr ((buf = r_buffer_new_rtp_buffer_ext (payload, 0, 0,
+          0xbede, ext, sizeof (ext))), !=, NULL);
+  r_buffer_unref (payload);
+
+  r_assert (r_rtp_buffer_map (&rtp, buf, R_MEM_MAP_READ));
+  r_assert (r_rtp_buffer_get_transport_cc (&rtp, 3, &seq));
+  r_assert_cmphex (seq, ==, 0x1234);
+  r_assert (!r_rtp_buffer_get_transport_cc (&rtp, 4, &seq));
+  r_assert (r_rtp_buffer_unmap (&rtp, buf));
+
+  /* Stamp a new sequence number in place */
+  r_assert (r_rtp_buffer_map (&rtp, buf, R_MEM_MAP_WRITE));
+  r_assert (r_rtp_buffer_set_transport_cc (&rtp, 3, 0xbeef));
+  r_assert (!r_rtp_buffer_set_transport_cc (&rtp, 4, 0xbeef));
+  r_assert (r_rtp_buffer_unmap (&rtp, buf));
+
+  r_assert (r_rtp_buffer_map (&rtp, buf, R_MEM_MAP_READ));
+  r_assert (r_rtp_buffer_get_transport_cc (&rtp, 3, &seq));
+  r_assert_cmphex (seq, ==, 0xbeef);
+  r_assert_cmpuint (rtp.pay.size, ==, sizeof (pay));
+  r_assert_cmpmem (rtp.pay.data, ==, pay, sizeof (pay));
+  r_assert (r_rtp_buffer_unmap (&rtp, buf));
+  r_buffer_unref (buf);
+}
+RTEST_END;
+
 RTEST (rrtp, estimate_seq_idx, RTEST_FAST)
 {
   r_assert_cmpuint (r_rtp_estimate_seq_idx (0, 0), ==, 0);
@@ -1190,3 +1231,98 @@ RTEST (rrtcp, write_feedback, RTEST_FAST)
   r_buffer_unref (buf);
 }
 RTEST_END;
+
+RTEST (rrtcp, twcc_wire, RTEST_FAST)
+{
+  static const ruint8 wire[] = {
+    0x8f, 0xcd, 0x00, 0x05, 0xaa, 0xaa, 0x00, 0x01, 0xbb, 0xbb, 0x00, 0x02,
+    0x00, 0x01, 0x00, 0x03, 0x00, 0x00, 0x01, 0x07, 0xa8, 0x00, 0x00, 0x04
+  };
+  RClockTime arrival[3] = {
+    R_RTCP_TWCC_REF_UNIT, R_CLOCK_TIME_NONE, R_RTCP_TWCC_REF_UNIT + R_MSECOND
+  };
+  RClockTime parsed[3];
+  RBuffer * buf;
+  RRTCPBuffer rtcp = R_RTCP_BUFFER_INIT;
+  RRTCPPacket * pkt;
+  RRTCPTWCCInfo info;
+
+  r_assert_cmpptr ((buf = r_buffer_new ()), !=, NULL);
+  r_assert (!r_rtcp_buffer_add_twcc (buf, 0, 0, 0, 0, arrival, 0));
+  r_assert (r_rtcp_buffer_add_twcc (buf, 0xaaaa0001, 0xbbbb0002, 7, 1, arrival, 3));
+  r_assert_cmpuint (r_buffer_get_size (buf), ==, sizeof (wire));
+  r_assert_cmpint (r_buffer_memcmp (buf, 0, wire, sizeof (wire)), ==, 0);
+
+  r_assert (r_rtcp_buffer_map (&rtcp, buf, R_MEM_MAP_READ));
+  r_assert_cmpptr ((pkt = r_rtcp_buffer_get_first_packet (&rtcp)), !=, NULL);
+  r_assert_cmpuint (r_rtcp_packet_get_type (pkt), ==, R_RTCP_PT_RTPFB);
+  r_assert_cmpuint (r_rtcp_packet_fb_get_fmt (pkt), ==, R_RTCP_RTPFB_FMT_TWCC);
+  r_assert (r_rtcp_packet_twcc_get_info (pkt, &info));
+  r_assert_cmpuint (info.base_seq, ==, 1);
+  r_assert_cmpuint (info.count, ==, 3);
+  r_assert_cmpuint (info.reftime, ==, 1);
+  r_assert_cmpuint (info.fbcount, ==, 7);
+  r_assert_cmpint (r_rtcp_packet_twcc_get_arrivals (pkt, parsed, 2), ==,
+      R_RTCP_PARSE_BUF_TOO_SMALL);
+  r_assert_cmpint (r_rtcp_packet_twcc_get_arrivals (pkt, parsed, 3), ==,
+      R_RTCP_PARSE_OK);
+  r_assert_cmpuint (parsed[0], ==, arrival[0]);
+  r_assert_cmpuint (parsed[1], ==, R_CLOCK_TIME_NONE);
+  r_assert_cmpuint (parsed[2], ==, arrival[2]);
+  r_assert (r_rtcp_buffer_unmap (&rtcp, buf));
+  r_buffer_unref (buf);
+}
+RTEST_END;
+
+RTEST (rrtcp, twcc_roundtrip, RTEST_FAST)
+{
+  /* Small, large and negative deltas, a long lost run (run-length chunk),
+   * mixed vectors and a base sequence number about to wrap. */
+  RClockTime arrival[64], parsed[64], t = 42 * R_SECOND + 3 * R_MSECOND;
+  RBuffer * buf;
+  RRTCPBuffer rtcp = R_RTCP_BUFFER_INIT;
+  RRTCPPacket * pkt;
+  RRTCPTWCCInfo info;
+  rsize i;
+
+  for (i = 0; i < R_N_ELEMENTS (arrival); i++) {
+    if (i >= 20 && i < 40) {
+      arrival[i] = R_CLOCK_TIME_NONE;
+      continue;
+    }
+    if (i == 5)
+      t += 300 * R_MSECOND;                 /* large */
+    else if (i == 9)
+      t -= 2 * R_MSECOND;                   /* reordered: negative delta */
+    else
+      t += (i % 4) * R_RTCP_TWCC_DELTA_UNIT;
+    arrival[i] = t;
+  }
+  arrival[50] = R_CLOCK_TIME_NONE;
+
+  r_assert_cmpptr ((buf = r_buffer_new ()), !=, NULL);
+  r_assert (r_rtcp_buffer_add_twcc (buf, 1, 2, 255, 65530, arrival,
+        R_N_ELEMENTS (arrival)));
+  r_assert_cmpuint (r_buffer_get_size (buf) % 4, ==, 0);
+
+  r_assert (r_rtcp_buffer_map (&rtcp, buf, R_MEM_MAP_READ));
+  r_assert_cmpptr ((pkt = r_rtcp_buffer_get_first_packet (&rtcp)), !=, NULL);
+  r_assert (r_rtcp_packet_twcc_get_info (pkt, &info));
+  r_assert_cmpuint (info.base_seq, ==, 65530);
+  r_assert_cmpuint (info.count, ==, R_N_ELEMENTS (arrival));
+  r_assert_cmpuint (info.fbcount, ==, 255);
+  r_assert_cmpint (r_rtcp_packet_twcc_get_arrivals (pkt, parsed,
+        R_N_ELEMENTS (parsed)), ==, R_RTCP_PARSE_OK);
+  for (i = 0; i < R_N_ELEMENTS (arrival); i++)
+    r_assert_cmpuint (parsed[i], ==, arrival[i]);
+  r_assert (r_rtcp_buffer_unmap (&rtcp, buf));
+  r_buffer_unref (buf);
+
+  /* Consecutive arrivals more than a 16-bit delta apart can't be encoded */
+  arrival[1] = arrival[0] + 10 * R_SECOND;
+  r_assert_cmpptr ((buf = r_buffer_new ()), !=, NULL);
+  r_assert (!r_rtcp_buffer_add_twcc (buf, 1, 2, 0, 0, arrival, 2));
+  r_assert_cmpuint (r_buffer_get_size (buf), ==, 0);
+  r_buffer_unref (buf);
+}
+RTEST_END;
@@ -157,3 +157,28 @@ RTEST (rslist, merge, RTEST_FAST)
 }
 RTEST_END;
 
+
+static rboolean
+slist_not_deadbeef (rpointer data, rpointer user)
+{
+  (void)user;
+  return data != PTR_DEADBEEF;
+}
+
+RTEST (rslist, foreach_remove, RTEST_FAST)
+{
+  RSList * head = NULL;
+
+  r_assert_cmpptr ((head = r_slist_prepend (head, PTR_CAFEBABE)), !=, NULL);
+  r_assert_cmpptr ((head = r_slist_prepend (head, PTR_DEADBEEF)), !=, NULL);
+  r_assert_cmpptr ((head = r_slist_prepend (head, PTR_BAADFOOD)), !=, NULL);
+  r_assert_cmpptr ((head = r_slist_prepend (head, PTR_CAFEBABE)), !=, NULL);
+
+  /* Removes the head, a middle and the last link. */
+  r_assert_cmpuint (r_slist_foreach_remove (&head, slist_not_deadbeef, NULL), ==, 3);
+  r_assert_cmpuint (r_slist_len (head), ==, 1);
+  r_assert_cmpptr (head->data, ==, PTR_DEADBEEF);
+
+  r_slist_destroy (head);
+}
+RTEST_END;
@@ -357,6 +357,67 @@ RTEST (rsocket, sendto_recvfrom, RTEST_FAST | RTEST_SYSTEM)
 }
 RTEST_END;
 
+RTEST (rsocket, send_recv_datagrams, RTEST_FAST | RTEST_SYSTEM)
+{
+  RSocket * sock1, * sock2;
+  RSocketAddress * addr1, * addr2;
+  RSocketDatagram tx[8], rx[8];
+  ruint8 txbuf[8][64], rxbuf[8][128];
+  rsize i, n = 0;
+
+  r_assert_cmpptr ((sock1 = r_socket_new (R_SOCKET_FAMILY_IPV4,
+          R_SOCKET_TYPE_DATAGRAM, R_SOCKET_PROTOCOL_UDP)), !=, NULL);
+  r_assert_cmpptr ((sock2 = r_socket_new (R_SOCKET_FAMILY_IPV4,
+          R_SOCKET_TYPE_DATAGRAM, R_SOCKET_PROTOCOL_UDP)), !=, NULL);
+  r_assert_cmpptr ((addr1 = r_socket_address_ipv4_new_uint8 (127, 0, 0, 1, 0)), !=, NULL);
+  r_assert_cmpint (r_socket_bind (sock1, addr1, TRUE), ==, R_SOCKET_OK);
+  r_assert_cmpint (r_socket_bind (sock2, addr1, TRUE), ==, R_SOCKET_OK);
+  r_socket_address_unref (addr1);
+  r_assert_cmpptr ((addr1 = r_socket_get_local_address (sock1)), !=, NULL);
+  r_assert_cmpptr ((addr2 = r_socket_get_local_address (sock2)), !=, NULL);
+  r_assert (r_socket_set_blocking (sock2, FALSE));
+
+  /* Nothing queued: would block, nothing received. */
+  for (i = 0; i < R_N_ELEMENTS (rx); i++) {
+    rx[i].address = r_socket_address_new ();
+    rx[i].data = rxbuf[i];
+    rx[i].size = sizeof (rxbuf[i]);
+    rx[i].len = 0;
+  }
+  r_assert_cmpint (r_socket_receive_datagrams (sock2, rx, R_N_ELEMENTS (rx), &n), ==, R_SOCKET_WOULD_BLOCK);
+  r_assert_cmpuint (n, ==, 0);
+
+  /* Datagrams of distinct sizes keep their boundaries. */
+  for (i = 0; i < R_N_ELEMENTS (tx); i++) {
+    r_memset (txbuf[i], (int) i, sizeof (txbuf[i]));
+    tx[i].address = addr2;
+    tx[i].data = txbuf[i];
+    tx[i].size = i + 1;
+  }
+  r_assert_cmpint (r_socket_send_datagrams (sock1, tx, 5, &n), ==, R_SOCKET_OK);
+  r_assert_cmpuint (n, ==, 5);
+
+  for (i = 0; i < 1000 && r_socket_receive_datagrams (sock2, rx, R_N_ELEMENTS (rx), &n) != R_SOCKET_OK; i++)
+    r_thread_usleep (1000);
+  r_assert_cmpuint (n, >, 0);
+  r_assert_cmpuint (n, <=, 5);
+  for (i = 0; i < n; i++) {
+    r_assert_cmpuint (rx[i].len, ==, i + 1);
+    r_assert_cmpmem (rx[i].data, ==, txbuf[i], i + 1);
+    r_assert (r_socket_address_is_equal (rx[i].address, addr1));
+  }
+
+  for (i = 0; i < R_N_ELEMENTS (rx); i++)
+    r_socket_address_unref (rx[i].address);
+  r_assert_cmpint (r_socket_close (sock1), ==, R_SOCKET_OK);
+  r_assert_cmpint (r_socket_close (sock2), ==, R_SOCKET_OK);
+  r_socket_unref (sock1);
+  r_socket_unref (sock2);
+  r_socket_address_unref (addr1);
+  r_socket_address_unref (addr2);
+}
+RTEST_END;
+
 RTEST (rsocket, sendmsg_recvmsg, RTEST_FAST | RTEST_SYSTEM)
 {
   RSocket * sock1, * sock2;
@@ -664,3 +664,84 @@ RTEST (rstun, attribute_builders, RTEST_FAST)
   r_assert (seen_err && seen_life && seen_chan && seen_data && seen_realm);
 }
 RTEST_END;
+
+RTEST (rstun, binding_responder_matches_generic, RTEST_FAST)
+{
+  static const ruint8 ip6[16] = {
+    0x20, 0x01, 0x0d, 0xb8, 0x12, 0x34, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0xca, 0xfe, 0x00, 0x01
+  };
+  static const ruint8 tid[R_STUN_TRANSACTION_ID_SIZE] = {
+    0x6f, 0x67, 0x2f, 0x45, 0x4b, 0x78, 0x77, 0x64, 0x38, 0x44, 0x61, 0x34
+  };
+  const rchar * pwd = "jdZU5MNMAUnq+FM5FHHArfdN1Ys9uw==";
+  ruint8 fast[R_STUN_BINDING_RESPONSE_MAX_SIZE], generic[128];
+  RStunBindingResponder * resp;
+  RSocketAddress * addrs[2];
+  RStunAttrTLV tlv = R_STUN_ATTR_TLV_INIT;
+  RStunMsgCtx ctx;
+  rsize i, size;
+
+  r_assert_cmpptr ((resp = r_stun_binding_responder_new (pwd, r_strlen (pwd))), !=, NULL);
+  addrs[0] = r_socket_address_ipv4_new_uint8 (148, 122, 175, 42, 54198);
+  addrs[1] = r_socket_address_ipv6_new_from_bytes (ip6, 0x4242);
+
+  for (i = 0; i < R_N_ELEMENTS (addrs); i++) {
+    r_assert (r_stun_msg_begin (&ctx, generic, sizeof (generic),
+          R_STUN_CLASS_SUCCESS_RESPONSE, R_STUN_METHOD_BINDING, tid));
+    r_assert (r_stun_msg_add_xor_address (&ctx, R_STUN_ATTR_TYPE_XOR_MAPPED_ADDRESS, addrs[i]));
+    r_assert (r_stun_msg_add_message_integrity_short_cred (&ctx, pwd, r_strlen (pwd)));
+    size = r_stun_msg_end (&ctx, TRUE);
+
+    r_assert_cmpuint (r_stun_binding_responder_build (resp, fast, size - 1, tid, addrs[i]), ==, 0);
+    r_assert_cmpuint (r_stun_binding_responder_build (resp, fast, sizeof (fast), tid, addrs[i]), ==, size);
+    r_assert_cmpmem (fast, ==, generic, size);
+
+    r_assert (r_stun_attr_tlv_first (fast, &tlv));
+    r_assert (r_stun_attr_tlv_next (fast, &tlv));
+    r_assert_cmphex (tlv.type, ==, R_STUN_ATTR_TYPE_MESSAGE_INTEGRITY);
+    r_assert (r_stun_binding_responder_check_integrity (resp, fast, &tlv));
+    fast[R_STUN_HEADER_SIZE + 6] ^= 1;
+    r_assert (!r_stun_binding_responder_check_integrity (resp, fast, &tlv));
+
+    r_socket_address_unref (addrs[i]);
+  }
+
+  r_stun_binding_responder_free (resp);
+}
+RTEST_END;
+
+RTEST (rstun, message_integrity_hmac_reuse, RTEST_FAST)
+{
+  const rchar * pwd = "VOkJxbRl1RmTxUk/WvJxBt";
+  ruint8 buf[128];
+  RStunAttrTLV tlv = R_STUN_ATTR_TLV_INIT;
+  RStunMsgCtx ctx;
+  RHmac * hmac;
+  ruint i;
+
+  r_assert_cmpptr ((hmac = r_hmac_new (R_MSG_DIGEST_TYPE_SHA1, pwd, r_strlen (pwd))), !=, NULL);
+
+  /* The same keyed HMAC signs and verifies message after message. */
+  for (i = 0; i < 3; i++) {
+    ruint8 tid[R_STUN_TRANSACTION_ID_SIZE];
+
+    r_memset (tid, 0x10 + i, sizeof (tid));
+    r_assert (r_stun_msg_begin (&ctx, buf, sizeof (buf),
+          R_STUN_CLASS_REQUEST, R_STUN_METHOD_BINDING, tid));
+    r_assert (r_stun_msg_add_string (&ctx, R_STUN_ATTR_TYPE_USERNAME, "evtj:h6vY", -1));
+    r_assert (r_stun_msg_add_message_integrity_hmac (&ctx, hmac));
+    r_stun_msg_end (&ctx, TRUE);
+
+    r_assert (r_stun_attr_tlv_first (buf, &tlv));
+    r_assert (r_stun_attr_tlv_next (buf, &tlv));
+    r_assert_cmphex (tlv.type, ==, R_STUN_ATTR_TYPE_MESSAGE_INTEGRITY);
+    r_assert (r_stun_msg_check_integrity_hmac (buf, &tlv, hmac));
+    r_assert (r_stun_msg_check_integrity_short_cred (buf, &tlv, pwd, r_strlen (pwd)));
+    r_assert (!r_stun_msg_check_integrity_short_cred (buf, &tlv, "wrong", 5));
+  }
+
+  r_assert (!r_stun_msg_check_integrity_hmac (buf, &tlv, NULL));
+  r_hmac_free (hmac);
+}
+RTEST_END;
@@ -96,6 +96,62 @@ RTEST (rtest, assert_logs, RTEST_FAST)
 }
 RTEST_END;
 
+static void
+bench_spin (rpointer data, ruint64 iters)
+{
+  volatile ruint64 * acc = data;
+  ruint64 n;
+
+  for (n = 0; n < iters; n++)
+    *acc += n;
+}
+
+RTEST (rtest, bench_run, RTEST_FAST)
+{
+  RTestBenchConfig cfg = R_TEST_BENCH_CONFIG_INIT, old;
+  RTestBenchResult res;
+  volatile ruint64 acc = 0;
+  rchar * path;
+
+  r_test_bench_get_config (&old);
+  cfg.target = 100 * R_USECOND;
+  cfg.reps = 8;
+  r_test_bench_set_config (&cfg);
+
+  r_assert (r_test_bench_run ("spin", bench_spin, (rpointer)&acc, 0, &res));
+  r_assert_cmpuint (res.reps, ==, 8);
+  r_assert_cmpuint (res.iters, >, 0);
+  r_assert_cmpuint (res.outliers, <, 8);
+  r_assert_cmpdouble (res.min, <=, res.median);
+  r_assert_cmpdouble (res.median, <=, res.p95);
+
+  cfg.reps = 0;
+  r_test_bench_set_config (&cfg);
+  r_assert (!r_test_bench_run ("spin", bench_spin, (rpointer)&acc, 0, NULL));
+  r_test_bench_set_config (&old);
+
+  r_assert_cmpptr ((path = r_fs_path_new_tmpname_full (NULL, "rtestbench", ".csv")), !=, NULL);
+  r_assert (r_test_bench_output_begin (R_TEST_BENCH_FORMAT_CSV, path, NULL, 0.1));
+  r_test_bench_record ("a, \"quoted\" label", &res);
+  r_test_bench_record_once ("once", 10, 64, 10 * R_USECOND);
+  r_assert_cmpuint (r_test_bench_output_end (stdout), ==, 0);
+
+  /* Compare against itself; identical medians are never regressions */
+  r_assert (r_test_bench_output_begin (R_TEST_BENCH_FORMAT_JSON, NULL, path, 0.1));
+  r_test_bench_record ("a, \"quoted\" label", &res);
+  r_test_bench_record_once ("once", 10, 64, 10 * R_USECOND);
+  r_assert_cmpuint (r_test_bench_output_end (stdout), ==, 0);
+
+  /* ... but a 2x slower one is */
+  r_assert (r_test_bench_output_begin (R_TEST_BENCH_FORMAT_JSON, NULL, path, 0.1));
+  r_test_bench_record_once ("once", 10, 64, 20 * R_USECOND);
+  r_assert_cmpuint (r_test_bench_output_end (stdout), ==, 1);
+
+  remove (path);
+  r_free (path);
+}
+RTEST_END;
+
 /********************************************************/
 /* Main entry point and test runner                     */
 /********************************************************/
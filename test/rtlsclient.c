@@ -187,6 +187,18 @@ RTEST_FIXTURE_STRUCT (rtlsclient)
   RCryptoCert * sni_cert;        /* cert the cb installs for the SNI host, or NULL */
   RCryptoKey * sni_key;
 
+  ruint priv_key_ops;            /* operations handed to the server's priv_key_op */
+  rboolean priv_key_op_hold;     /* keep them in held_op instead of offloading */
+  RTLSPrivKeyOp * held_op;
+
+  rboolean tx_decline;           /* the transmit-offload keys cb declines */
+  ruint tx_installs;             /* write keys handed to the keys cb */
+  RTLSTrafficKeys tx_keys;       /* ...the latest, sealing what tx_record gets */
+  rboolean rx_decline;           /* the receive-offload keys cb declines */
+  ruint rx_installs;             /* read keys handed to the keys cb */
+  RTLSTrafficKeys rx_keys;       /* ...the latest, opening what the pump feeds */
+  rpointer rx_session;           /* the side whose receiving is offloaded */
+
   RClock * clock;
   REvLoop * evloop;
   RPrng * prng;
@@ -323,6 +335,21 @@ r_tlsclient_test_srv_ph_auth (rpointer ctx, rboolean ok, rpointer session)
   fixture->srv_ph_auth_ok = ok;
 }
 
+/* Offload handshake signatures to the loop's task queue, or hold them for the
+ * test to run and complete by hand. */
+static rboolean
+r_tlsclient_test_srv_priv_key_op (rpointer ctx, RTLSPrivKeyOp * op, rpointer session)
+{
+  RTEST_FIXTURE_STRUCT (rtlsclient) * fixture = ctx;
+
+  fixture->priv_key_ops++;
+  if (fixture->priv_key_op_hold) {
+    fixture->held_op = op;
+    return TRUE;
+  }
+  return r_tls_server_offload_priv_key_op (NULL, op, session);
+}
+
 static const RTLSCallbacks srvcbs = {
   r_tlsclient_test_prefer_ecdhe,
   r_tlsclient_test_srv_hs_done,
@@ -332,6 +359,18 @@ static const RTLSCallbacks srvcbs = {
   NULL,
   r_tlsclient_test_srv_closed,
   r_tlsclient_test_srv_ph_auth,
+  NULL,
+};
+static const RTLSCallbacks srvcbs_priv_key_op = {
+  r_tlsclient_test_prefer_ecdhe,
+  r_tlsclient_test_srv_hs_done,
+  r_tlsclient_test_srv_out,
+  r_tlsclient_test_srv_app,
+  r_tlsclient_test_srv_error,
+  NULL,
+  r_tlsclient_test_srv_closed,
+  r_tlsclient_test_srv_ph_auth,
+  r_tlsclient_test_srv_priv_key_op,
 };
 static const RTLSCallbacks clicbs = {
   r_tlsclient_test_prefer_ecdhe,
@@ -342,6 +381,7 @@ static const RTLSCallbacks clicbs = {
   r_tlsclient_test_verify_cert,
   r_tlsclient_test_cli_closed,
   NULL,
+  NULL,
 };
 
 RTEST_FIXTURE_SETUP (rtlsclient)
@@ -365,6 +405,16 @@ RTEST_FIXTURE_SETUP (rtlsclient)
   fixture->sni_seen[0] = '\0';
   fixture->sni_cert = NULL;
   fixture->sni_key = NULL;
+  fixture->priv_key_ops = 0;
+  fixture->priv_key_op_hold = FALSE;
+  fixture->held_op = NULL;
+  fixture->tx_decline = FALSE;
+  fixture->tx_installs = 0;
+  r_memclear (&fixture->tx_keys, sizeof (fixture->tx_keys));
+  fixture->rx_decline = FALSE;
+  fixture->rx_installs = 0;
+  r_memclear (&fixture->rx_keys, sizeof (fixture->rx_keys));
+  fixture->rx_session = NULL;
 
   r_queue_init (&fixture->srv_out);
   r_queue_init (&fixture->cli_out);
@@ -401,9 +451,56 @@ RTEST_FIXTURE_TEARDOWN (rtlsclient)
   r_prng_unref (fixture->prng);
 }
 
+/* The receive offload's lower layer, emulated like kernel TLS: open each
+ * record of @buf under the keys the offloaded side exported and hand it over
+ * opened. The sequence number moves on first, as a KeyUpdate in the record
+ * reinstalls the keys from within incoming_record. */
+static void
+r_test_tls_rx_open (RTEST_FIXTURE_STRUCT (rtlsclient) * fixture, RBuffer * buf)
+{
+  RTLSParser parser = R_TLS_PARSER_INIT;
+  RTLSTrafficKeys * keys = &fixture->rx_keys;
+  RTLSError err;
+
+  buf = r_buffer_ref (buf);
+  for (err = r_tls_parser_init_buffer (&parser, buf);
+      err == R_TLS_ERROR_OK;
+      err = r_tls_parser_init_next (&parser, &buf)) {
+    RCryptoCipher * cipher;
+    RBuffer * rec;
+    ruint64 seqno = keys->seqno++;
+
+    r_buffer_unref (buf);
+    buf = NULL;
+
+    r_assert_cmpptr ((cipher = r_crypto_cipher_new (keys->cipher, keys->key)), !=, NULL);
+    if (keys->version == R_TLS_VERSION_TLS_1_3) {
+      r_assert_cmpint (r_tls_parser_unprotect13 (&parser, cipher,
+            keys->iv, keys->ivlen, seqno), ==, R_TLS_ERROR_OK);
+    } else {
+      parser.seqno = seqno;
+      r_assert_cmpint (r_tls_parser_decrypt (&parser, cipher, NULL, FALSE,
+            keys->iv), ==, R_TLS_ERROR_OK);
+    }
+    r_crypto_cipher_unref (cipher);
+
+    r_assert_cmpptr ((rec = r_buffer_view (parser.buf, parser.offset,
+            parser.fragment.size)), !=, NULL);
+    if (fixture->rx_session == fixture->server)
+      r_tls_server_incoming_record (fixture->server, parser.content, rec);
+    else
+      r_tls_client_incoming_record (fixture->client, parser.content, rec);
+    r_buffer_unref (rec);
+  }
+  r_tls_parser_clear (&parser);
+  if (buf != NULL)
+    r_buffer_unref (buf);
+}
+
 /* Shuttle records between the two endpoints until neither has anything more
- * to send. Each out callback emits one record per buffer, so feeding them
- * back individually works for both TLS and DTLS. */
+ * to send. Each out callback emits whole records -- one per buffer, or several
+ * back to back for TLS application data -- so feeding them back individually
+ * works for both TLS and DTLS. */
 static void
 r_test_tls_loopback_pump (RTEST_FIXTURE_STRUCT (rtlsclient) * fixture)
 {
@@ -414,18 +511,32 @@ r_test_tls_loopback_pump (RTEST_FIXTURE_STRUCT (rtlsclient) * fixture)
     rboolean progress = FALSE;
 
     while ((buf = r_queue_pop (&fixture->cli_out)) != NULL) {
-      r_tls_server_incoming_data (fixture->server, buf);
+      if (fixture->rx_session == fixture->server)
+        r_test_tls_rx_open (fixture, buf);
+      else
+        r_tls_server_incoming_data (fixture->server, buf);
       r_buffer_unref (buf);
       progress = TRUE;
     }
     while ((buf = r_queue_pop (&fixture->srv_out)) != NULL) {
-      r_tls_client_incoming_data (fixture->client, buf);
+      if (fixture->rx_session == fixture->client)
+        r_test_tls_rx_open (fixture, buf);
+      else
+        r_tls_client_incoming_data (fixture->client, buf);
       r_buffer_unref (buf);
       progress = TRUE;
     }
 
-    if (!progress)
+    if (!progress) {
+      /* Offloaded signatures finish on the loop, releasing the rest of the
+       * server's flight. */
+      if (fixture->priv_key_ops > 0 && !fixture->priv_key_op_hold) {
+        r_ev_loop_run (fixture->evloop, R_EV_LOOP_RUN_LOOP);
+        if (r_queue_size (&fixture->srv_out) > 0)
+          continue;
+      }
       break;
+    }
   }
 }
 
@@ -870,6 +981,662 @@ RTEST_F (rtlsclient, tls13_key_update, RTEST_FAST)
 }
 RTEST_END;
 
+/* Transmit offload with the lower layer emulated in the test: the keys cb
+ * keeps what the session exported and the record cb seals with it, like kernel
+ * TLS would, onto the out queue. The peer decrypting that proves the export. */
+static rboolean
+r_tlsclient_test_tx_keys (rpointer ctx, const RTLSTrafficKeys * keys,
+    rpointer session)
+{
+  RTEST_FIXTURE_STRUCT (rtlsclient) * fixture = ctx;
+  (void) session;
+
+  if (fixture->tx_decline)
+    return FALSE;
+  fixture->tx_keys = *keys;
+  fixture->tx_installs++;
+  return TRUE;
+}
+
+static rboolean
+r_tlsclient_test_rx_keys (rpointer ctx, const RTLSTrafficKeys * keys,
+    rpointer session)
+{
+  RTEST_FIXTURE_STRUCT (rtlsclient) * fixture = ctx;
+
+  if (fixture->rx_decline)
+    return FALSE;
+  fixture->rx_keys = *keys;
+  fixture->rx_installs++;
+  fixture->rx_session = session;
+  return TRUE;
+}
+
+static RBuffer *
+r_test_tls_seal_record (RTLSTrafficKeys * keys, RTLSContentType type,
+    RBuffer * buf)
+{
+  RMemMapInfo in = R_MEM_MAP_INFO_INIT, out = R_MEM_MAP_INFO_INIT;
+  RCryptoCipher * cipher;
+  RBuffer * rec = NULL;
+
+  r_assert_cmpptr ((cipher = r_crypto_cipher_new (keys->cipher, keys->key)), !=, NULL);
+  r_assert (r_buffer_map (buf, &in, R_MEM_MAP_READ));
+  if (keys->version == R_TLS_VERSION_TLS_1_3) {
+    rsize enclen = 0;
+
+    r_assert_cmpptr ((rec = r_buffer_new_alloc (NULL,
+            R_TLS_RECORD_HDR_SIZE + in.size + 1 + R_TLS13_AEAD_TAG_SIZE, NULL)), !=, NULL);
+    r_assert (r_buffer_map (rec, &out, R_MEM_MAP_WRITE));
+    r_assert (r_tls13_record_protect (cipher, keys->iv, keys->ivlen, keys->seqno,
+          type, in.data, in.size, out.data + R_TLS_RECORD_HDR_SIZE,
+          out.size - R_TLS_RECORD_HDR_SIZE, &enclen));
+    out.data[0] = R_TLS_CONTENT_TYPE_APPLICATION_DATA;
+    r_store_be16 (out.data + 1, R_TLS_VERSION_TLS_1_2);
+    r_store_be16 (out.data + 3, (ruint16) enclen);
+    r_buffer_unmap (rec, &out);
+    r_buffer_set_size (rec, R_TLS_RECORD_HDR_SIZE + enclen);
+  } else {
+    RBuffer * plain;
+
+    r_assert_cmpptr ((plain = r_buffer_new_alloc (NULL,
+            R_TLS_RECORD_HDR_SIZE + in.size, NULL)), !=, NULL);
+    r_assert (r_buffer_map (plain, &out, R_MEM_MAP_WRITE));
+    out.data[0] = (ruint8) type;
+    r_store_be16 (out.data + 1, R_TLS_VERSION_TLS_1_2);
+    r_store_be16 (out.data + 3, (ruint16) in.size);
+    r_memcpy (out.data + R_TLS_RECORD_HDR_SIZE, in.data, in.size);
+    r_buffer_unmap (plain, &out);
+    r_assert_cmpptr ((rec = r_tls_encrypt_buffer_aead (plain, keys->seqno,
+            cipher, keys->iv)), !=, NULL);
+    r_buffer_unref (plain);
+  }
+  r_buffer_unmap (buf, &in);
+  r_crypto_cipher_unref (cipher);
+
+  keys->seqno++;
+  return rec;
+}
+
+static rboolean
+r_tlsclient_test_srv_tx_record (rpointer ctx, RTLSContentType type,
+    RBuffer * buf, rpointer session)
+{
+  RTEST_FIXTURE_STRUCT (rtlsclient) * fixture = ctx;
+  (void) session;
+  return r_queue_push (&fixture->srv_out,
+      r_test_tls_seal_record (&fixture->tx_keys, type, buf)) != NULL;
+}
+
+static rboolean
+r_tlsclient_test_cli_tx_record (rpointer ctx, RTLSContentType type,
+    RBuffer * buf, rpointer session)
+{
+  RTEST_FIXTURE_STRUCT (rtlsclient) * fixture = ctx;
+  (void) session;
+  return r_queue_push (&fixture->cli_out,
+      r_test_tls_seal_record (&fixture->tx_keys, type, buf)) != NULL;
+}
+
+static void
+r_test_tls_tx_offload (RTEST_FIXTURE_STRUCT (rtlsclient) * fixture,
+    RTLSVersion version)
+{
+  static const ruint8 s2c[] = { 'o', 'f', 'f', 'l', 'o', 'a', 'd', 'e', 'd' };
+  static const ruint8 c2s[] = { 's', 't', 'i', 'l', 'l', ' ', 'u', 's' };
+  RBuffer * app;
+
+  r_assert_cmpint (r_tls_server_set_tx_offload (fixture->server,
+        r_tlsclient_test_srv_tx_record, r_tlsclient_test_tx_keys),
+      ==, R_TLS_ERROR_WRONG_STATE);
+
+  r_assert_cmpint (r_tls_server_start (fixture->server, fixture->evloop, fixture->prng),
+      ==, R_TLS_ERROR_OK);
+  r_assert_cmpint (r_tls_client_start (fixture->client, fixture->evloop, fixture->prng,
+        version), ==, R_TLS_ERROR_OK);
+  r_test_tls_loopback_pump (fixture);
+  r_assert (fixture->cli_hs_done);
+  r_assert (fixture->srv_hs_done);
+
+  r_assert_cmpint (r_tls_server_set_tx_offload (fixture->server,
+        r_tlsclient_test_srv_tx_record, r_tlsclient_test_tx_keys),
+      ==, R_TLS_ERROR_OK);
+  r_assert_cmpuint (fixture->tx_installs, ==, 1);
+  r_assert_cmpint (fixture->tx_keys.version, ==, version);
+  r_assert_cmpint (r_tls_server_set_tx_offload (fixture->server,
+        r_tlsclient_test_srv_tx_record, r_tlsclient_test_tx_keys),
+      ==, R_TLS_ERROR_WRONG_STATE);
+
+  r_assert_cmpptr ((app = r_buffer_new_wrapped (R_MEM_FLAG_NONE,
+          (rpointer)s2c, sizeof (s2c), sizeof (s2c), 0, NULL, NULL)), !=, NULL);
+  r_assert (r_tls_server_send_appdata (fixture->server, app));
+  r_test_tls_loopback_pump (fixture);
+  r_test_tls_assert_appdata (&fixture->cli_app, s2c, sizeof (s2c));
+
+  /* A KeyUpdate goes out under the old keys, then the new ones arrive. */
+  if (version == R_TLS_VERSION_TLS_1_3) {
+    r_assert (r_tls_server_key_update (fixture->server, FALSE));
+    r_assert_cmpuint (fixture->tx_installs, ==, 2);
+    r_assert_cmpuint (fixture->tx_keys.seqno, ==, 0);
+    r_assert (r_tls_server_send_appdata (fixture->server, app));
+    r_test_tls_loopback_pump (fixture);
+    r_test_tls_assert_appdata (&fixture->cli_app, s2c, sizeof (s2c));
+  }
+  r_buffer_unref (app);
+
+  /* Receiving stays in the session. */
+  r_assert_cmpptr ((app = r_buffer_new_wrapped (R_MEM_FLAG_NONE,
+          (rpointer)c2s, sizeof (c2s), sizeof (c2s), 0, NULL, NULL)), !=, NULL);
+  r_assert (r_tls_client_send_appdata (fixture->client, app));
+  r_buffer_unref (app);
+  r_test_tls_loopback_pump (fixture);
+  r_test_tls_assert_appdata (&fixture->srv_app, c2s, sizeof (c2s));
+
+  /* So do alerts. */
+  r_assert (r_tls_server_close (fixture->server));
+  r_test_tls_loopback_pump (fixture);
+  r_assert (fixture->cli_closed);
+  r_assert (!fixture->cli_error);
+  r_assert (!fixture->srv_error);
+}
+
+RTEST_F (rtlsclient, tls13_tx_offload, RTEST_FAST)
+{
+  r_test_tls_tx_offload (fixture, R_TLS_VERSION_TLS_1_3);
+}
+RTEST_END;
+
+RTEST_F (rtlsclient, tls13_tx_offload_chacha20, RTEST_FAST)
+{
+  fixture->force_suite = R_TLS_CS_CHACHA20_POLY1305_SHA256;
+  r_test_tls_tx_offload (fixture, R_TLS_VERSION_TLS_1_3);
+}
+RTEST_END;
+
+RTEST_F (rtlsclient, tls_tx_offload_gcm, RTEST_FAST)
+{
+  fixture->force_suite = R_TLS_CS_ECDHE_RSA_WITH_AES_128_GCM_SHA256;
+  r_test_tls_tx_offload (fixture, R_TLS_VERSION_TLS_1_2);
+}
+RTEST_END;
+
+RTEST_F (rtlsclient, tls_tx_offload_chacha20, RTEST_FAST)
+{
+  fixture->force_suite = R_TLS_CS_ECDHE_RSA_WITH_CHACHA20_POLY1305_SHA256;
+  r_test_tls_tx_offload (fixture, R_TLS_VERSION_TLS_1_2);
+}
+RTEST_END;
+
+/* Without a taker -- a CBC suite, or the lower layer declining, as kernel TLS
+ * does without the tls module -- the session keeps sealing records itself. */
+static void
+r_test_tls_tx_offload_refused (RTEST_FIXTURE_STRUCT (rtlsclient) * fixture,
+    RTLSVersion version)
+{
+  static const ruint8 s2c[] = { 'i', 'n', 'l', 'i', 'n', 'e' };
+  RBuffer * app;
+
+  r_assert_cmpint (r_tls_server_start (fixture->server, fixture->evloop, fixture->prng),
+      ==, R_TLS_ERROR_OK);
+  r_assert_cmpint (r_tls_client_start (fixture->client, fixture->evloop, fixture->prng,
+        version), ==, R_TLS_ERROR_OK);
+  r_test_tls_loopback_pump (fixture);
+  r_assert (fixture->srv_hs_done);
+
+  r_assert_cmpint (r_tls_server_set_tx_offload (fixture->server,
+        r_tlsclient_test_srv_tx_record, r_tlsclient_test_tx_keys),
+      ==, R_TLS_ERROR_NOT_SUPPORTED);
+  r_assert_cmpuint (fixture->tx_installs, ==, 0);
+
+  r_assert_cmpptr ((app = r_buffer_new_wrapped (R_MEM_FLAG_NONE,
+          (rpointer)s2c, sizeof (s2c), sizeof (s2c), 0, NULL, NULL)), !=, NULL);
+  r_assert (r_tls_server_send_appdata (fixture->server, app));
+  r_buffer_unref (app);
+  r_test_tls_loopback_pump (fixture);
+  r_test_tls_assert_appdata (&fixture->cli_app, s2c, sizeof (s2c));
+}
+
+RTEST_F (rtlsclient, tls13_tx_offload_declined, RTEST_FAST)
+{
+  fixture->tx_decline = TRUE;
+  r_test_tls_tx_offload_refused (fixture, R_TLS_VERSION_TLS_1_3);
+}
+RTEST_END;
+
+RTEST_F (rtlsclient, tls_tx_offload_cbc_refused, RTEST_FAST)
+{
+  fixture->force_suite = R_TLS_CS_ECDHE_RSA_WITH_AES_128_CBC_SHA256;
+  r_test_tls_tx_offload_refused (fixture, R_TLS_VERSION_TLS_1_2);
+}
+RTEST_END;
+
+RTEST_F (rtlsclient, dtls13_tx_offload_refused, RTEST_FAST)
+{
+  r_test_tls_tx_offload_refused (fixture, R_TLS_VERSION_DTLS_1_3);
+}
+RTEST_END;
+
+/* Receive offload with the lower layer emulated by r_test_tls_rx_open: the
+ * server gets the client's records opened, including a KeyUpdate that has to
+ * reinstall the read keys before the records behind it. */
+static void
+r_test_tls_rx_offload (RTEST_FIXTURE_STRUCT (rtlsclient) * fixture,
+    RTLSVersion version)
+{
+  static const ruint8 c2s[] = { 'o', 'f', 'f', 'l', 'o', 'a', 'd', 'e', 'd' };
+  static const ruint8 s2c[] = { 's', 't', 'i', 'l', 'l', ' ', 'u', 's' };
+  RBuffer * app, * rec, * part;
+
+  r_assert_cmpint (r_tls_server_set_rx_offload (fixture->server,
+        r_tlsclient_test_rx_keys), ==, R_TLS_ERROR_WRONG_STATE);
+
+  r_assert_cmpint (r_tls_server_start (fixture->server, fixture->evloop, fixture->prng),
+      ==, R_TLS_ERROR_OK);
+  r_assert_cmpint (r_tls_client_start (fixture->client, fixture->evloop, fixture->prng,
+        version), ==, R_TLS_ERROR_OK);
+  r_test_tls_loopback_pump (fixture);
+  r_assert (fixture->cli_hs_done);
+  r_assert (fixture->srv_hs_done);
+
+  /* Not while the session holds part of a record. */
+  r_assert_cmpptr ((app = r_buffer_new_wrapped (R_MEM_FLAG_NONE,
+          (rpointer)c2s, sizeof (c2s), sizeof (c2s), 0, NULL, NULL)), !=, NULL);
+  r_assert (r_tls_client_send_appdata (fixture->client, app));
+  r_assert_cmpptr ((rec = r_queue_pop (&fixture->cli_out)), !=, NULL);
+  r_assert_cmpptr ((part = r_buffer_view (rec, 0, 3)), !=, NULL);
+  r_assert (r_tls_server_incoming_data (fixture->server, part));
+  r_buffer_unref (part);
+  r_assert_cmpint (r_tls_server_set_rx_offload (fixture->server,
+        r_tlsclient_test_rx_keys), ==, R_TLS_ERROR_WRONG_STATE);
+  r_assert_cmpptr ((part = r_buffer_view (rec, 3, -1)), !=, NULL);
+  r_assert (r_tls_server_incoming_data (fixture->server, part));
+  r_buffer_unref (part);
+  r_test_tls_assert_appdata (&fixture->srv_app, c2s, sizeof (c2s));
+
+  r_assert_cmpint (r_tls_server_set_rx_offload (fixture->server,
+        r_tlsclient_test_rx_keys), ==, R_TLS_ERROR_OK);
+  r_assert_cmpuint (fixture->rx_installs, ==, 1);
+  r_assert_cmpint (fixture->rx_keys.version, ==, version);
+  /* Past the one record read; TLS 1.2 counts the Finished under these keys. */
+  r_assert_cmpuint (fixture->rx_keys.seqno, ==,
+      version == R_TLS_VERSION_TLS_1_3 ? 1 : 2);
+  r_assert_cmpint (r_tls_server_set_rx_offload (fixture->server,
+        r_tlsclient_test_rx_keys), ==, R_TLS_ERROR_WRONG_STATE);
+  /* Ciphertext has nowhere to go any more. */
+  r_assert (!r_tls_server_incoming_data (fixture->server, rec));
+  r_buffer_unref (rec);
+
+  r_assert (r_tls_client_send_appdata (fixture->client, app));
+  r_test_tls_loopback_pump (fixture);
+  r_test_tls_assert_appdata (&fixture->srv_app, c2s, sizeof (c2s));
+
+  /* The KeyUpdate hands the lower layer the next keys; one asking for our
+   * own update is answered by the session as usual. */
+  if (version == R_TLS_VERSION_TLS_1_3) {
+    r_assert (r_tls_client_key_update (fixture->client, TRUE));
+    r_test_tls_loopback_pump (fixture);
+    r_assert_cmpuint (fixture->rx_installs, ==, 2);
+    r_assert_cmpuint (fixture->rx_keys.seqno, ==, 0);
+    r_assert (r_tls_client_send_appdata (fixture->client, app));
+    r_test_tls_loopback_pump (fixture);
+    r_test_tls_assert_appdata (&fixture->srv_app, c2s, sizeof (c2s));
+  }
+  r_buffer_unref (app);
+
+  /* Sending stays in the session. */
+  r_assert_cmpptr ((app = r_buffer_new_wrapped (R_MEM_FLAG_NONE,
+          (rpointer)s2c, sizeof (s2c), sizeof (s2c), 0, NULL, NULL)), !=, NULL);
+  r_assert (r_tls_server_send_appdata (fixture->server, app));
+  r_buffer_unref (app);
+  r_test_tls_loopback_pump (fixture);
+  r_test_tls_assert_appdata (&fixture->cli_app, s2c, sizeof (s2c));
+
+  /* Alerts come in opened too. */
+  r_assert (r_tls_client_close (fixture->client));
+  r_test_tls_loopback_pump (fixture);
+  r_assert (fixture->srv_closed);
+  r_assert (!fixture->cli_error);
+  r_assert (!fixture->srv_error);
+}
+
+RTEST_F (rtlsclient, tls13_rx_offload, RTEST_FAST)
+{
+  r_test_tls_rx_offload (fixture, R_TLS_VERSION_TLS_1_3);
+}
+RTEST_END;
+
+RTEST_F (rtlsclient, tls13_rx_offload_chacha20, RTEST_FAST)
+{
+  fixture->force_suite = R_TLS_CS_CHACHA20_POLY1305_SHA256;
+  r_test_tls_rx_offload (fixture, R_TLS_VERSION_TLS_1_3);
+}
+RTEST_END;
+
+RTEST_F (rtlsclient, tls_rx_offload_gcm, RTEST_FAST)
+{
+  fixture->force_suite = R_TLS_CS_ECDHE_RSA_WITH_AES_128_GCM_SHA256;
+  r_test_tls_rx_offload (fixture, R_TLS_VERSION_TLS_1_2);
+}
+RTEST_END;
+
+/* Declined up front, the session keeps opening records itself. */
+RTEST_F (rtlsclient, tls13_rx_offload_declined, RTEST_FAST)
+{
+  static const ruint8 c2s[] = { 'i', 'n', 'l', 'i', 'n', 'e' };
+  RBuffer * app;
+
+  fixture->rx_decline = TRUE;
+  r_assert_cmpint (r_tls_server_start (fixture->server, fixture->evloop, fixture->prng),
+      ==, R_TLS_ERROR_OK);
+  r_assert_cmpint (r_tls_client_start (fixture->client, fixture->evloop, fixture->prng,
+        R_TLS_VERSION_TLS_1_3), ==, R_TLS_ERROR_OK);
+  r_test_tls_loopback_pump (fixture);
+  r_assert (fixture->srv_hs_done);
+
+  r_assert_cmpint (r_tls_server_set_rx_offload (fixture->server,
+        r_tlsclient_test_rx_keys), ==, R_TLS_ERROR_NOT_SUPPORTED);
+  r_assert_cmpptr (fixture->rx_session, ==, NULL);
+
+  r_assert_cmpptr ((app = r_buffer_new_wrapped (R_MEM_FLAG_NONE,
+          (rpointer)c2s, sizeof (c2s), sizeof (c2s), 0, NULL, NULL)), !=, NULL);
+  r_assert (r_tls_client_send_appdata (fixture->client, app));
+  r_buffer_unref (app);
+  r_test_tls_loopback_pump (fixture);
+  r_test_tls_assert_appdata (&fixture->srv_app, c2s, sizeof (c2s));
+}
+RTEST_END;
+
+/* Once offloaded there is no way back: failing to rekey the lower layer on a
+ * KeyUpdate fails the session. */
+RTEST_F (rtlsclient, tls13_rx_offload_rekey_failed, RTEST_FAST)
+{
+  r_assert_cmpint (r_tls_server_start (fixture->server, fixture->evloop, fixture->prng),
+      ==, R_TLS_ERROR_OK);
+  r_assert_cmpint (r_tls_client_start (fixture->client, fixture->evloop, fixture->prng,
+        R_TLS_VERSION_TLS_1_3), ==, R_TLS_ERROR_OK);
+  r_test_tls_loopback_pump (fixture);
+  r_assert (fixture->srv_hs_done);
+  r_assert_cmpint (r_tls_server_set_rx_offload (fixture->server,
+        r_tlsclient_test_rx_keys), ==, R_TLS_ERROR_OK);
+
+  fixture->rx_decline = TRUE;
+  r_assert (r_tls_client_key_update (fixture->client, FALSE));
+  r_test_tls_loopback_pump (fixture);
+  r_assert (fixture->srv_error);
+  r_assert_cmpint (fixture->srv_alert, ==, R_TLS_ALERT_TYPE_INTERNAL_ERROR);
+}
+RTEST_END;
+
+/* The client offloads both directions, so every record either way passes
+ * through the emulated lower layer, KeyUpdates included. */
+static void
+r_test_tls_client_offload (RTEST_FIXTURE_STRUCT (rtlsclient) * fixture,
+    RTLSVersion version)
+{
+  static const ruint8 c2s[] = { 'u', 'p' };
+  static const ruint8 s2c[] = { 'd', 'o', 'w', 'n' };
+  RBuffer * up, * down;
+
+  r_assert_cmpint (r_tls_server_start (fixture->server, fixture->evloop, fixture->prng),
+      ==, R_TLS_ERROR_OK);
+  r_assert_cmpint (r_tls_client_start (fixture->client, fixture->evloop, fixture->prng,
+        version), ==, R_TLS_ERROR_OK);
+  r_test_tls_loopback_pump (fixture);
+  r_assert (fixture->cli_hs_done);
+
+  r_assert_cmpint (r_tls_client_set_tx_offload (fixture->client,
+        r_tlsclient_test_cli_tx_record, r_tlsclient_test_tx_keys), ==, R_TLS_ERROR_OK);
+  r_assert_cmpint (r_tls_client_set_rx_offload (fixture->client,
+        r_tlsclient_test_rx_keys), ==, R_TLS_ERROR_OK);
+  r_assert_cmpptr (fixture->rx_session, ==, fixture->client);
+  r_assert_cmpint (fixture->tx_keys.version, ==, version);
+  r_assert_cmpint (fixture->rx_keys.version, ==, version);
+
+  r_assert_cmpptr ((up = r_buffer_new_wrapped (R_MEM_FLAG_NONE,
+          (rpointer)c2s, sizeof (c2s), sizeof (c2s), 0, NULL, NULL)), !=, NULL);
+  r_assert_cmpptr ((down = r_buffer_new_wrapped (R_MEM_FLAG_NONE,
+          (rpointer)s2c, sizeof (s2c), sizeof (s2c), 0, NULL, NULL)), !=, NULL);
+  r_assert (r_tls_client_send_appdata (fixture->client, up));
+  r_assert (r_tls_server_send_appdata (fixture->server, down));
+  r_test_tls_loopback_pump (fixture);
+  r_test_tls_assert_appdata (&fixture->srv_app, c2s, sizeof (c2s));
+  r_test_tls_assert_appdata (&fixture->cli_app, s2c, sizeof (s2c));
+
+  /* Our KeyUpdate rekeys sending, the server's answer rekeys receiving. */
+  if (version == R_TLS_VERSION_TLS_1_3) {
+    r_assert (r_tls_client_key_update (fixture->client, TRUE));
+    r_test_tls_loopback_pump (fixture);
+    r_assert_cmpuint (fixture->tx_installs, ==, 2);
+    r_assert_cmpuint (fixture->rx_installs, ==, 2);
+    r_assert (r_tls_client_send_appdata (fixture->client, up));
+    r_assert (r_tls_server_send_appdata (fixture->server, down));
+    r_test_tls_loopback_pump (fixture);
+    r_test_tls_assert_appdata (&fixture->srv_app, c2s, sizeof (c2s));
+    r_test_tls_assert_appdata (&fixture->cli_app, s2c, sizeof (s2c));
+  }
+  r_buffer_unref (up);
+  r_buffer_unref (down);
+
+  r_assert (r_tls_server_close (fixture->server));
+  r_test_tls_loopback_pump (fixture);
+  r_assert (fixture->cli_closed);
+  r_assert (!fixture->cli_error);
+  r_assert (!fixture->srv_error);
+}
+
+RTEST_F (rtlsclient, tls13_client_offload, RTEST_FAST)
+{
+  r_test_tls_client_offload (fixture, R_TLS_VERSION_TLS_1_3);
+}
+RTEST_END;
+
+RTEST_F (rtlsclient, tls_client_offload_gcm, RTEST_FAST)
+{
+  fixture->force_suite = R_TLS_CS_ECDHE_RSA_WITH_AES_128_GCM_SHA256;
+  r_test_tls_client_offload (fixture, R_TLS_VERSION_TLS_1_2);
+}
+RTEST_END;
+
+/* Number of TLS records laid back to back in @buf. */
+static ruint
+r_test_tls_record_count (RBuffer * buf)
+{
+  RMemMapInfo info = R_MEM_MAP_INFO_INIT;
+  rsize pos;
+  ruint n = 0;
+
+  r_assert (r_buffer_map (buf, &info, R_MEM_MAP_READ));
+  for (pos = 0; pos + R_TLS_RECORD_HDR_SIZE <= info.size; n++)
+    pos += R_TLS_RECORD_HDR_SIZE + r_load_be16 (info.data + pos + 3);
+  r_assert_cmpuint (pos, ==, info.size);
+  r_buffer_unmap (buf, &info);
+  return n;
+}
+
+/* Application data beyond 2^14 bytes goes out as full-size records, all
+ * sealed into a single buffer per send, in both directions. */
+static void
+r_test_tls_bulk_appdata (RTEST_FIXTURE_STRUCT (rtlsclient) * fixture,
+    RTLSVersion version)
+{
+  const rsize size = 2 * R_TLS_MAX_PLAINTEXT + 1000;
+  ruint8 * payload;
+  RBuffer * app, * buf;
+  rsize i;
+
+  r_assert_cmpptr ((payload = r_malloc (size)), !=, NULL);
+  for (i = 0; i < size; i++)
+    payload[i] = (ruint8) (i * 7);
+
+  r_assert_cmpint (r_tls_server_start (fixture->server, fixture->evloop, fixture->prng),
+      ==, R_TLS_ERROR_OK);
+  r_assert_cmpint (r_tls_client_start (fixture->client, fixture->evloop, fixture->prng,
+        version), ==, R_TLS_ERROR_OK);
+  r_test_tls_loopback_pump (fixture);
+  r_assert (fixture->srv_hs_done);
+  r_assert (fixture->cli_hs_done);
+
+  r_assert_cmpptr ((app = r_buffer_new_wrapped (R_MEM_FLAG_NONE,
+          payload, size, size, 0, NULL, NULL)), !=, NULL);
+  r_assert (r_tls_server_send_appdata (fixture->server, app));
+  r_assert (r_tls_client_send_appdata (fixture->client, app));
+  r_buffer_unref (app);
+
+  r_assert_cmpuint (r_queue_size (&fixture->srv_out), ==, 1);
+  r_assert_cmpptr ((buf = r_queue_peek (&fixture->srv_out)), !=, NULL);
+  r_assert_cmpuint (r_test_tls_record_count (buf), ==, 3);
+  r_assert_cmpuint (r_queue_size (&fixture->cli_out), ==, 1);
+  r_assert_cmpptr ((buf = r_queue_peek (&fixture->cli_out)), !=, NULL);
+  r_assert_cmpuint (r_test_tls_record_count (buf), ==, 3);
+
+  r_test_tls_loopback_pump (fixture);
+  r_test_tls_assert_appdata (&fixture->cli_app, payload, size);
+  r_test_tls_assert_appdata (&fixture->srv_app, payload, size);
+  r_assert (!fixture->cli_error);
+  r_assert (!fixture->srv_error);
+  r_free (payload);
+}
+
+RTEST_F (rtlsclient, tls13_bulk_appdata, RTEST_FAST)
+{
+  r_test_tls_bulk_appdata (fixture, R_TLS_VERSION_TLS_1_3);
+}
+RTEST_END;
+
+RTEST_F (rtlsclient, tls_bulk_appdata_gcm, RTEST_FAST)
+{
+  fixture->force_suite = R_TLS_CS_ECDHE_RSA_WITH_AES_128_GCM_SHA256;
+  r_test_tls_bulk_appdata (fixture, R_TLS_VERSION_TLS_1_2);
+}
+RTEST_END;
+
+RTEST_F (rtlsclient, tls_bulk_appdata_chacha20, RTEST_FAST)
+{
+  fixture->force_suite = R_TLS_CS_ECDHE_RSA_WITH_CHACHA20_POLY1305_SHA256;
+  r_test_tls_bulk_appdata (fixture, R_TLS_VERSION_TLS_1_2);
+}
+RTEST_END;
+
+/* Hand @q's buffers over in @chunk byte reads, like a stream socket would. */
+static void
+r_test_tls_deliver_split (RQueue * q, RTLSClient * client, RTLSServer * server,
+    rsize chunk)
+{
+  RBuffer * buf, * part;
+  rsize off, size;
+
+  while ((buf = r_queue_pop (q)) != NULL) {
+    size = r_buffer_get_size (buf);
+    for (off = 0; off < size; off += chunk) {
+      r_assert_cmpptr ((part = r_buffer_view (buf, off,
+              (rssize) MIN (chunk, size - off))), !=, NULL);
+      if (client != NULL)
+        r_assert (r_tls_client_incoming_data (client, part));
+      else
+        r_assert (r_tls_server_incoming_data (server, part));
+      r_buffer_unref (part);
+    }
+    r_buffer_unref (buf);
+  }
+}
+
+/* Records cut across reads are buffered until the rest arrives. */
+RTEST_F (rtlsclient, tls13_appdata_split_reads, RTEST_FAST)
+{
+  const rsize size = R_TLS_MAX_PLAINTEXT + 1000;
+  ruint8 * payload;
+  RBuffer * app;
+  rsize i;
+
+  r_assert_cmpptr ((payload = r_malloc (size)), !=, NULL);
+  for (i = 0; i < size; i++)
+    payload[i] = (ruint8) (i * 3);
+
+  r_assert_cmpint (r_tls_server_start (fixture->server, fixture->evloop, fixture->prng),
+      ==, R_TLS_ERROR_OK);
+  r_assert_cmpint (r_tls_client_start (fixture->client, fixture->evloop, fixture->prng,
+        R_TLS_VERSION_TLS_1_3), ==, R_TLS_ERROR_OK);
+  r_test_tls_loopback_pump (fixture);
+  r_assert (fixture->cli_hs_done);
+
+  r_assert_cmpptr ((app = r_buffer_new_wrapped (R_MEM_FLAG_NONE,
+          payload, size, size, 0, NULL, NULL)), !=, NULL);
+  r_assert (r_tls_server_send_appdata (fixture->server, app));
+  r_assert (r_tls_client_send_appdata (fixture->client, app));
+  r_buffer_unref (app);
+
+  r_test_tls_deliver_split (&fixture->srv_out, fixture->client, NULL, 1000);
+  r_test_tls_deliver_split (&fixture->cli_out, NULL, fixture->server, 3);
+  r_test_tls_assert_appdata (&fixture->cli_app, payload, size);
+  r_test_tls_assert_appdata (&fixture->srv_app, payload, size);
+  r_assert (!fixture->cli_error);
+  r_assert (!fixture->srv_error);
+  r_free (payload);
+}
+RTEST_END;
+
+/* Corked, small writes are held back and coalesce into one record on uncork;
+ * what is still held when the session closes goes out ahead of close_notify. */
+static void
+r_test_tls_cork (RTEST_FIXTURE_STRUCT (rtlsclient) * fixture, RTLSVersion version)
+{
+  ruint8 payload[100 * 10];
+  RBuffer * app, * buf;
+  rsize i;
+
+  for (i = 0; i < sizeof (payload); i++)
+    payload[i] = (ruint8) (i & 0xff);
+
+  r_assert_cmpint (r_tls_server_start (fixture->server, fixture->evloop, fixture->prng),
+      ==, R_TLS_ERROR_OK);
+  r_assert (!r_tls_server_cork (fixture->server));      /* not established */
+  r_assert_cmpint (r_tls_client_start (fixture->client, fixture->evloop, fixture->prng,
+        version), ==, R_TLS_ERROR_OK);
+  r_test_tls_loopback_pump (fixture);
+  r_assert (fixture->srv_hs_done);
+
+  r_assert (r_tls_server_cork (fixture->server));
+  for (i = 0; i < sizeof (payload); i += 10) {
+    r_assert_cmpptr ((app = r_buffer_new_wrapped (R_MEM_FLAG_NONE,
+            payload + i, 10, 10, 0, NULL, NULL)), !=, NULL);
+    r_assert (r_tls_server_send_appdata (fixture->server, app));
+    r_buffer_unref (app);
+  }
+  r_assert_cmpuint (r_queue_size (&fixture->srv_out), ==, 0);
+  r_assert (r_tls_server_uncork (fixture->server));
+  r_assert_cmpuint (r_queue_size (&fixture->srv_out), ==, 1);
+  r_assert_cmpptr ((buf = r_queue_peek (&fixture->srv_out)), !=, NULL);
+  r_assert_cmpuint (r_test_tls_record_count (buf), ==, 1);
+  r_test_tls_loopback_pump (fixture);
+  r_test_tls_assert_appdata (&fixture->cli_app, payload, sizeof (payload));
+
+  r_assert (r_tls_server_cork (fixture->server));
+  r_assert_cmpptr ((app = r_buffer_new_wrapped (R_MEM_FLAG_NONE,
+          payload, 10, 10, 0, NULL, NULL)), !=, NULL);
+  r_assert (r_tls_server_send_appdata (fixture->server, app));
+  r_buffer_unref (app);
+  r_assert_cmpuint (r_queue_size (&fixture->srv_out), ==, 0);
+  r_assert (r_tls_server_close (fixture->server));
+  r_assert_cmpuint (r_queue_size (&fixture->srv_out), ==, 2);
+  r_test_tls_loopback_pump (fixture);
+  r_test_tls_assert_appdata (&fixture->cli_app, payload, 10);
+  r_assert (fixture->cli_closed);
+  r_assert (!fixture->cli_error);
+}
+
+RTEST_F (rtlsclient, tls13_cork, RTEST_FAST)
+{
+  r_test_tls_cork (fixture, R_TLS_VERSION_TLS_1_3);
+}
+RTEST_END;
+
+RTEST_F (rtlsclient, tls_cork_gcm, RTEST_FAST)
+{
+  fixture->force_suite = R_TLS_CS_ECDHE_RSA_WITH_AES_128_GCM_SHA256;
+  r_test_tls_cork (fixture, R_TLS_VERSION_TLS_1_2);
+}
+RTEST_END;
+
 /* ALPN (RFC 7301): the client offers a protocol list, the server selects by its
  * own preference from the overlap, and both endpoints report the same choice.
  * Parameterised by @version to cover the 1.2 ServerHello and the 1.3
@@ -1015,27 +1782,33 @@ HEAVY_RTEST_F (rtlsclient, tls13_loopback_group_ffdhe8192, RTEST_SLOW)
 RTEST_END;
 
 /* Drain @from, asserting every record's ciphertext fits a @limit-byte plaintext
- * cap (RFC 8449: header + inner plaintext<=limit + AEAD tag), feed each into the
- * server (@to_server) or client, and return the record count. */
+ * cap (RFC 8449: header + inner plaintext<=limit + AEAD tag), feed each buffer
+ * into the server (@to_server) or client, and return the record count. One
+ * buffer may carry several records back to back. */
 static ruint
 r_test_tls_relay_capped (RQueue * from, ruint16 limit,
     rboolean to_server, RTEST_FIXTURE_STRUCT (rtlsclient) * fixture)
 {
-  RBuffer * rec;
+  RBuffer * buf;
   RMemMapInfo info = R_MEM_MAP_INFO_INIT;
+  rsize pos, reclen;
   ruint n = 0;
 
-  while ((rec = r_queue_pop (from)) != NULL) {
-    r_assert (r_buffer_map (rec, &info, R_MEM_MAP_READ));
-    r_assert_cmpuint (info.size, <=,
-        R_TLS_RECORD_HDR_SIZE + (rsize) limit + R_TLS13_AEAD_TAG_SIZE);
-    r_buffer_unmap (rec, &info);
+  while ((buf = r_queue_pop (from)) != NULL) {
+    r_assert (r_buffer_map (buf, &info, R_MEM_MAP_READ));
+    for (pos = 0; pos < info.size; pos += reclen, n++) {
+      r_assert_cmpuint (pos + R_TLS_RECORD_HDR_SIZE, <=, info.size);
+      reclen = R_TLS_RECORD_HDR_SIZE + r_load_be16 (info.data + pos + 3);
+      r_assert_cmpuint (reclen, <=,
+          R_TLS_RECORD_HDR_SIZE + (rsize) limit + R_TLS13_AEAD_TAG_SIZE);
+    }
+    r_assert_cmpuint (pos, ==, info.size);
+    r_buffer_unmap (buf, &info);
     if (to_server)
-      r_tls_server_incoming_data (fixture->server, rec);
+      r_tls_server_incoming_data (fixture->server, buf);
     else
-      r_tls_client_incoming_data (fixture->client, rec);
-    r_buffer_unref (rec);
-    n++;
+      r_tls_client_incoming_data (fixture->client, buf);
+    r_buffer_unref (buf);
   }
   return n;
 }
@@ -1134,6 +1907,51 @@ RTEST_F (rtlsclient, tls13_record_size_limit_incoming_overflow, RTEST_FAST)
 }
 RTEST_END;
 
+/* Without any negotiated limit, a protected record longer than 2^14 + 256
+ * (RFC 8446 5.2) and a plaintext longer than 2^14 are both still fatal. */
+static void
+r_test_tls13_incoming_overflow (RTEST_FIXTURE_STRUCT (rtlsclient) * fixture,
+    RTLSContentType type, ruint16 fraglen)
+{
+  static ruint8 big[R_TLS_RECORD_HDR_SIZE + R_TLS_MAX_CIPHERTEXT];
+  RBuffer * rec;
+
+  r_assert_cmpint (r_tls_server_start (fixture->server, fixture->evloop, fixture->prng),
+      ==, R_TLS_ERROR_OK);
+  r_assert_cmpint (r_tls_client_start (fixture->client, fixture->evloop, fixture->prng,
+        R_TLS_VERSION_TLS_1_3), ==, R_TLS_ERROR_OK);
+  r_test_tls_loopback_pump (fixture);
+  r_assert (fixture->cli_hs_done);
+  r_assert (!fixture->cli_error);
+
+  r_memclear (big, sizeof (big));
+  big[0] = type;
+  r_store_be16 (&big[1], R_TLS_VERSION_TLS_1_2);
+  r_store_be16 (&big[3], fraglen);
+  r_assert_cmpptr ((rec = r_buffer_new_wrapped (R_MEM_FLAG_NONE, big,
+          R_TLS_RECORD_HDR_SIZE + fraglen, R_TLS_RECORD_HDR_SIZE + fraglen,
+          0, NULL, NULL)), !=, NULL);
+  r_tls_client_incoming_data (fixture->client, rec);
+  r_buffer_unref (rec);
+
+  r_assert (fixture->cli_error);
+  r_assert_cmpuint (fixture->cli_alert, ==, R_TLS_ALERT_TYPE_RECORD_OVERFLOW);
+}
+
+RTEST_F (rtlsclient, tls13_incoming_ciphertext_overflow, RTEST_FAST)
+{
+  r_test_tls13_incoming_overflow (fixture, R_TLS_CONTENT_TYPE_APPLICATION_DATA,
+      R_TLS13_MAX_CIPHERTEXT + 1);
+}
+RTEST_END;
+
+RTEST_F (rtlsclient, tls13_incoming_plaintext_overflow, RTEST_FAST)
+{
+  r_test_tls13_incoming_overflow (fixture, R_TLS_CONTENT_TYPE_HANDSHAKE,
+      R_TLS_MAX_PLAINTEXT + 1);
+}
+RTEST_END;
+
 /* The limit must lie in 64 .. 2^14; 0 disables the extension. */
 RTEST_F (rtlsclient, tls13_record_size_limit_invalid, RTEST_FAST)
 {
@@ -4042,3 +4860,100 @@ RTEST_F (rtlsclient, tls13_post_handshake_auth_not_offered, RTEST_FAST)
   r_assert (!fixture->srv_ph_auth_called);
 }
 RTEST_END;
+
+/* Swap the fixture's server for one that routes its handshake signatures
+ * through r_tlsclient_test_srv_priv_key_op. */
+static void
+r_test_tls_server_use_priv_key_op (RTEST_FIXTURE_STRUCT (rtlsclient) * fixture,
+    rboolean hold)
+{
+  RCryptoCert * cert;
+  RCryptoKey * pk;
+
+  r_tls_server_unref (fixture->server);
+  r_assert_cmpptr ((fixture->server = r_tls_server_new (&srvcbs_priv_key_op,
+          fixture, NULL)), !=, NULL);
+  r_assert_cmpptr ((cert = r_pem_parse_cert_from_data (testcertpem, -1)), !=, NULL);
+  r_assert_cmpptr ((pk = r_pem_parse_key_from_data (testpkpem, -1, NULL, 0)), !=, NULL);
+  r_assert_cmpint (r_tls_server_set_cert (fixture->server, cert, pk), ==, R_TLS_ERROR_OK);
+  r_crypto_key_unref (pk);
+  r_crypto_cert_unref (cert);
+  fixture->priv_key_op_hold = hold;
+}
+
+/* The 1.3 CertificateVerify signature runs on the loop's task queue; the
+ * handshake resumes when it is posted back. */
+RTEST_F (rtlsclient, tls13_priv_key_op_offload, RTEST_FAST)
+{
+  r_test_tls_server_use_priv_key_op (fixture, FALSE);
+  r_test_tls13_loopback (fixture);
+  r_assert_cmpuint (fixture->priv_key_ops, ==, 1);
+}
+RTEST_END;
+
+/* Same for the 1.2 ServerKeyExchange signature. */
+RTEST_F (rtlsclient, tls_priv_key_op_offload, RTEST_FAST)
+{
+  r_test_tls_server_use_priv_key_op (fixture, FALSE);
+  r_test_tls_loopback (fixture, R_TLS_VERSION_TLS_1_2);
+  r_assert_cmpuint (fixture->priv_key_ops, ==, 1);
+}
+RTEST_END;
+
+/* While the signature is outstanding the server flight stops short of the
+ * CertificateVerify; completing the held op releases the rest. */
+RTEST_F (rtlsclient, tls13_priv_key_op_suspend, RTEST_FAST)
+{
+  static const ruint8 c2s[] = { 'a', 's', 'y', 'n', 'c' };
+  RBuffer * app;
+
+  r_test_tls_server_use_priv_key_op (fixture, TRUE);
+  r_assert_cmpint (r_tls_server_start (fixture->server, fixture->evloop, fixture->prng),
+      ==, R_TLS_ERROR_OK);
+  r_assert_cmpint (r_tls_client_start (fixture->client, fixture->evloop, fixture->prng,
+        R_TLS_VERSION_TLS_1_3), ==, R_TLS_ERROR_OK);
+  r_test_tls_loopback_pump (fixture);
+
+  r_assert_cmpuint (fixture->priv_key_ops, ==, 1);
+  r_assert_cmpptr (fixture->held_op, !=, NULL);
+  r_assert (!fixture->srv_hs_done);
+  r_assert (!fixture->cli_hs_done);
+  r_assert (!fixture->cli_error);
+
+  r_assert_cmpint (r_tls_priv_key_op_run (fixture->held_op), ==, R_TLS_ERROR_OK);
+  r_tls_priv_key_op_complete (fixture->held_op);
+  fixture->held_op = NULL;
+  r_test_tls_loopback_pump (fixture);
+
+  r_assert (fixture->cli_hs_done);
+  r_assert (fixture->srv_hs_done);
+  r_assert_cmpptr ((app = r_buffer_new_wrapped (R_MEM_FLAG_NONE,
+          (rpointer)c2s, sizeof (c2s), sizeof (c2s), 0, NULL, NULL)), !=, NULL);
+  r_assert (r_tls_client_send_appdata (fixture->client, app));
+  r_buffer_unref (app);
+  r_test_tls_loopback_pump (fixture);
+  r_test_tls_assert_appdata (&fixture->srv_app, c2s, sizeof (c2s));
+}
+RTEST_END;
+
+/* An op completed without a result aborts the handshake. */
+RTEST_F (rtlsclient, tls13_priv_key_op_failed, RTEST_FAST)
+{
+  r_test_tls_server_use_priv_key_op (fixture, TRUE);
+  r_assert_cmpint (r_tls_server_start (fixture->server, fixture->evloop, fixture->prng),
+      ==, R_TLS_ERROR_OK);
+  r_assert_cmpint (r_tls_client_start (fixture->client, fixture->evloop, fixture->prng,
+        R_TLS_VERSION_TLS_1_3), ==, R_TLS_ERROR_OK);
+  r_test_tls_loopback_pump (fixture);
+  r_assert_cmpptr (fixture->held_op, !=, NULL);
+
+  r_tls_priv_key_op_complete (fixture->held_op);
+  fixture->held_op = NULL;
+  r_test_tls_loopback_pump (fixture);
+
+  r_assert (fixture->srv_error);
+  r_assert (fixture->cli_error);
+  r_assert (!fixture->srv_hs_done);
+  r_assert (!fixture->cli_hs_done);
+}
+RTEST_END;
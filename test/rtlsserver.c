@@ -151,6 +151,7 @@ RTEST_FIXTURE_SETUP (rtlsserver)
     r_tlsserver_test_verify_cert,
     r_tlsserver_test_closed,
     NULL,
+    NULL,
   };
   RCryptoCert * cert;
   RCryptoKey * pk;
@@ -2195,6 +2196,7 @@ r_test_tls_server_new_cfg (rpointer ctx)
   static const RTLSCallbacks cbs = {
     NULL, r_tlsserver_test_hs_done, r_tlsserver_test_buffer_out,
     r_tlsserver_test_buffer_appdata, r_tlsserver_test_error, NULL, NULL, NULL,
+    NULL,
   };
   RTLSServer * srv;
   RCryptoCert * cert;
@@ -3174,12 +3176,12 @@ RTEST_F (rtlsserver, dtls_bad_record_silently_discarded, RTEST_FAST)
 }
 RTEST_END;
 
-/* A record whose fragment length exceeds the 2^14 limit is rejected at the
- * record layer with a fatal record_overflow (RFC 5246 7.2.2). */
+/* A record whose fragment length exceeds the 2^14 + 2048 ciphertext limit is
+ * rejected at the record layer with a fatal record_overflow (RFC 5246 7.2.2). */
 RTEST_F (rtlsserver, tls_alert_record_overflow, RTEST_FAST)
 {
-  /* TLS 1.2 handshake record header claiming a 0x4000-byte fragment. */
-  static const ruint8 pkt[] = { 0x16, 0x03, 0x03, 0x40, 0x00 };
+  /* TLS 1.2 handshake record header claiming a 0x4801-byte fragment. */
+  static const ruint8 pkt[] = { 0x16, 0x03, 0x03, 0x48, 0x01 };
   RBuffer * buf;
   RTLSParser parser = R_TLS_PARSER_INIT;
   RTLSAlertLevel alevel;
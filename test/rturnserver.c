@@ -0,0 +1,350 @@
+#include <rlib/rnet.h>
+
+#define TURN_TEST_USER    "user"
+#define TURN_TEST_PASS    "pass"
+#define TURN_TEST_REALM   "rlib"
+
+typedef struct {
+  RSocket * sock;
+  RSocketAddress * server;
+  ruint8 key[16];
+  ruint8 tid[R_STUN_TRANSACTION_ID_SIZE];
+  rchar nonce[64];
+  ruint8 buf[2048];
+  rsize len;
+} TurnTestClient;
+
+/* Poll @sock for up to two seconds; the received size, or 0 on timeout. */
+static rsize
+turn_test_recv (RSocket * sock, ruint8 * buf, rsize size)
+{
+  RSocketAddress * from = r_socket_address_new ();
+  rsize ret = 0;
+  ruint i;
+
+  for (i = 0; i < 2000; i++) {
+    if (r_socket_receive_from (sock, from, buf, size, &ret) == R_SOCKET_OK)
+      break;
+    ret = 0;
+    r_thread_usleep (1000);
+  }
+
+  r_socket_address_unref (from);
+  return ret;
+}
+
+static RSocket *
+turn_test_socket (ruint8 lastoctet)
+{
+  RSocketAddress * addr = r_socket_address_ipv4_new_uint8 (127, 0, 0, lastoctet, 0);
+  RSocket * ret = r_socket_new (R_SOCKET_FAMILY_IPV4, R_SOCKET_TYPE_DATAGRAM,
+      R_SOCKET_PROTOCOL_UDP);
+
+  r_assert_cmpint (r_socket_bind (ret, addr, FALSE), ==, R_SOCKET_OK);
+  r_assert (r_socket_set_blocking (ret, FALSE));
+  r_socket_address_unref (addr);
+  return ret;
+}
+
+static void
+turn_test_client_init (TurnTestClient * client, RTurnServer * server)
+{
+  r_memclear (client, sizeof (TurnTestClient));
+  client->sock = turn_test_socket (1);
+  client->server = r_turn_server_get_local_address (server);
+  r_assert (r_stun_turn_long_term_key (TURN_TEST_USER, TURN_TEST_REALM,
+        TURN_TEST_PASS, client->key));
+}
+
+static void
+turn_test_client_clear (TurnTestClient * client)
+{
+  r_socket_address_unref (client->server);
+  r_socket_close (client->sock);
+  r_socket_unref (client->sock);
+}
+
+static void
+turn_test_begin (TurnTestClient * client, RStunMsgCtx * ctx, RStunClass cls,
+    RStunMethod method)
+{
+  r_assert (r_rand_entropy_fill (client->tid, sizeof (client->tid)));
+  r_assert (r_stun_msg_begin (ctx, client->buf, sizeof (client->buf),
+        cls, method, client->tid));
+}
+
+static void
+turn_test_send (TurnTestClient * client, const ruint8 * buf, rsize len)
+{
+  rsize sent = 0;
+  r_assert_cmpint (r_socket_send_to (client->sock, client->server, buf, len, &sent),
+      ==, R_SOCKET_OK);
+  r_assert_cmpuint (sent, ==, len);
+}
+
+/* Sign (when a nonce was handed out), send and wait for the response;
+ * its ERROR-CODE, or 0 for a success response. */
+static ruint
+turn_test_transact (TurnTestClient * client, RStunMsgCtx * ctx)
+{
+  RStunAttrTLV tlv = R_STUN_ATTR_TLV_INIT;
+  ruint ret = 0;
+
+  if (client->nonce[0] != 0) {
+    r_assert (r_stun_msg_add_string (ctx, R_STUN_ATTR_TYPE_USERNAME, TURN_TEST_USER, -1));
+    r_assert (r_stun_msg_add_string (ctx, R_STUN_ATTR_TYPE_REALM, TURN_TEST_REALM, -1));
+    r_assert (r_stun_msg_add_string (ctx, R_STUN_ATTR_TYPE_NONCE, client->nonce, -1));
+    r_assert (r_stun_msg_add_message_integrity_short_cred (ctx, client->key, 16));
+  }
+  turn_test_send (client, client->buf, r_stun_msg_end (ctx, TRUE));
+
+  r_assert_cmpuint ((client->len = turn_test_recv (client->sock,
+          client->buf, sizeof (client->buf))), >, 0);
+  r_assert (r_stun_is_valid_msg (client->buf, client->len));
+  r_assert_cmpmem (r_stun_msg_transaction_id (client->buf), ==, client->tid,
+      R_STUN_TRANSACTION_ID_SIZE);
+
+  if (r_stun_msg_is_err_resp (client->buf) && r_stun_attr_tlv_first (client->buf, &tlv)) {
+    do {
+      if (tlv.type == R_STUN_ATTR_TYPE_ERROR_CODE)
+        ret = r_stun_attr_tlv_parse_error_code (client->buf, &tlv);
+      else if (tlv.type == R_STUN_ATTR_TYPE_NONCE && tlv.len < sizeof (client->nonce))
+        r_memcpy (client->nonce, tlv.value, tlv.len);
+    } while (r_stun_attr_tlv_next (client->buf, &tlv));
+  } else {
+    r_assert (r_stun_msg_is_success_resp (client->buf));
+  }
+
+  return ret;
+}
+
+static RSocketAddress *
+turn_test_find_address (TurnTestClient * client, RStunAttrType type)
+{
+  RStunAttrTLV tlv = R_STUN_ATTR_TLV_INIT;
+
+  if (r_stun_attr_tlv_first (client->buf, &tlv)) {
+    do {
+      if (tlv.type == type)
+        return r_stun_attr_tlv_parse_xor_address (client->buf, &tlv);
+    } while (r_stun_attr_tlv_next (client->buf, &tlv));
+  }
+
+  return NULL;
+}
+
+static ruint
+turn_test_allocate (TurnTestClient * client)
+{
+  static const ruint8 udp[] = { R_SOCKET_PROTOCOL_UDP, 0, 0, 0 };
+  RStunAttrTLV tlv = { NULL, R_STUN_ATTR_TYPE_REQUESTED_TRANSPORT, sizeof (udp), udp };
+  RStunMsgCtx ctx;
+
+  turn_test_begin (client, &ctx, R_STUN_CLASS_REQUEST, R_STUN_METHOD_ALLOCATE);
+  r_assert (r_stun_msg_add_attribute (&ctx, &tlv));
+  return turn_test_transact (client, &ctx);
+}
+
+static ruint
+turn_test_create_permission (TurnTestClient * client, const RSocketAddress * peer)
+{
+  RStunMsgCtx ctx;
+
+  turn_test_begin (client, &ctx, R_STUN_CLASS_REQUEST, R_STUN_METHOD_CREATE_PERMISSION);
+  r_assert (r_stun_msg_add_xor_address (&ctx, R_STUN_ATTR_TYPE_XOR_PEER_ADDRESS, peer));
+  return turn_test_transact (client, &ctx);
+}
+
+static ruint
+turn_test_refresh (TurnTestClient * client, ruint32 lifetime)
+{
+  RStunMsgCtx ctx;
+
+  turn_test_begin (client, &ctx, R_STUN_CLASS_REQUEST, R_STUN_METHOD_REFRESH);
+  r_assert (r_stun_msg_add_lifetime (&ctx, lifetime));
+  return turn_test_transact (client, &ctx);
+}
+
+static RTurnServer *
+turn_test_server_new (const RTurnServerQuota * quota, ruint workers)
+{
+  RTurnServer * ret;
+  RSocketAddress * listen, * relay;
+
+  r_assert_cmpptr ((ret = r_turn_server_new (TURN_TEST_REALM)), !=, NULL);
+  r_assert (r_turn_server_add_user (ret, TURN_TEST_USER, TURN_TEST_PASS));
+  if (quota != NULL)
+    r_assert (r_turn_server_set_quota (ret, quota));
+
+  listen = r_socket_address_ipv4_new_uint8 (127, 0, 0, 1, 0);
+  relay = r_socket_address_ipv4_new_uint8 (127, 0, 0, 1, 0);
+  r_assert (r_turn_server_start (ret, listen, relay, workers));
+  r_assert_cmpuint (r_turn_server_get_worker_count (ret), >, 0);
+  r_assert (!r_turn_server_add_user (ret, "late", "user"));
+  r_socket_address_unref (relay);
+  r_socket_address_unref (listen);
+
+  return ret;
+}
+
+/* Counters are published after each batch is answered; give the worker a
+ * moment to catch up with what the test has already seen on the wire. */
+#define TURN_TEST_WAIT_STATS(server, stats, cond) R_STMT_START {              \
+  ruint _i;                                                                   \
+  for (_i = 0; _i < 2000; _i++) {                                             \
+    r_turn_server_get_stats (server, stats);                                  \
+    if (cond) break;                                                          \
+    r_thread_usleep (1000);                                                   \
+  }                                                                           \
+} R_STMT_END
+
+RTEST (rturnserver, relay, RTEST_FAST | RTEST_SYSTEM)
+{
+  static const ruint8 hello[] = "hello peer";
+  static const ruint8 world[] = "hello client";
+  RTurnServer * server;
+  TurnTestClient client;
+  RTurnServerStats stats;
+  RSocketAddress * relayaddr, * mapped, * peeraddr;
+  RSocket * peer;
+  RStunAttrTLV tlv = R_STUN_ATTR_TLV_INIT;
+  RStunMsgCtx ctx;
+  ruint8 buf[256];
+  rconstpointer data;
+  rsize len, sent;
+  ruint16 number;
+
+  server = turn_test_server_new (NULL, 2);
+  turn_test_client_init (&client, server);
+  peer = turn_test_socket (1);
+  peeraddr = r_socket_get_local_address (peer);
+
+  /* Unauthenticated: challenged with REALM + NONCE. */
+  r_assert_cmpuint (turn_test_allocate (&client), ==, 401);
+  r_assert_cmpstr (client.nonce, !=, "");
+  r_assert_cmpuint (turn_test_allocate (&client), ==, 0);
+  r_assert_cmpptr ((relayaddr = turn_test_find_address (&client,
+          R_STUN_ATTR_TYPE_XOR_RELAYED_ADDRESS)), !=, NULL);
+  r_assert_cmpptr ((mapped = turn_test_find_address (&client,
+          R_STUN_ATTR_TYPE_XOR_MAPPED_ADDRESS)), !=, NULL);
+  r_socket_address_unref (mapped);
+  /* Retransmission is answered with the same relayed address. */
+  r_assert_cmpuint (turn_test_allocate (&client), ==, 0);
+  r_assert_cmpptr ((mapped = turn_test_find_address (&client,
+          R_STUN_ATTR_TYPE_XOR_RELAYED_ADDRESS)), !=, NULL);
+  r_assert (r_socket_address_is_equal (mapped, relayaddr));
+  r_socket_address_unref (mapped);
+
+  /* Send indication through the permission to the peer. */
+  r_assert_cmpuint (turn_test_create_permission (&client, peeraddr), ==, 0);
+  turn_test_begin (&client, &ctx, R_STUN_CLASS_INDICATION, R_STUN_METHOD_SEND);
+  r_assert (r_stun_msg_add_xor_address (&ctx, R_STUN_ATTR_TYPE_XOR_PEER_ADDRESS, peeraddr));
+  r_assert (r_stun_msg_add_data (&ctx, hello, sizeof (hello)));
+  turn_test_send (&client, client.buf, r_stun_msg_end (&ctx, TRUE));
+  r_assert_cmpuint (turn_test_recv (peer, buf, sizeof (buf)), ==, sizeof (hello));
+  r_assert_cmpmem (buf, ==, hello, sizeof (hello));
+
+  /* Peer answers; without a channel the client gets a Data indication. */
+  r_assert_cmpint (r_socket_send_to (peer, relayaddr, world, sizeof (world), &sent), ==, R_SOCKET_OK);
+  r_assert_cmpuint ((len = turn_test_recv (client.sock, buf, sizeof (buf))), >, 0);
+  r_assert (r_stun_is_valid_msg (buf, len));
+  r_assert (r_stun_msg_is_indication (buf));
+  r_assert (r_stun_msg_method_is_data (buf));
+  data = NULL;
+  r_assert (r_stun_attr_tlv_first (buf, &tlv));
+  do {
+    if (tlv.type == R_STUN_ATTR_TYPE_DATA)
+      data = tlv.value;
+  } while (r_stun_attr_tlv_next (buf, &tlv));
+  r_assert_cmpptr (data, !=, NULL);
+  r_assert_cmpmem (data, ==, world, sizeof (world));
+
+  /* Channels, both directions. */
+  turn_test_begin (&client, &ctx, R_STUN_CLASS_REQUEST, R_STUN_METHOD_CHANNEL_BIND);
+  r_assert (r_stun_msg_add_channel_number (&ctx, 0x4001));
+  r_assert (r_stun_msg_add_xor_address (&ctx, R_STUN_ATTR_TYPE_XOR_PEER_ADDRESS, peeraddr));
+  r_assert_cmpuint (turn_test_transact (&client, &ctx), ==, 0);
+  turn_test_begin (&client, &ctx, R_STUN_CLASS_REQUEST, R_STUN_METHOD_CHANNEL_BIND);
+  r_assert (r_stun_msg_add_channel_number (&ctx, 0x4002));
+  r_assert (r_stun_msg_add_xor_address (&ctx, R_STUN_ATTR_TYPE_XOR_PEER_ADDRESS, peeraddr));
+  r_assert_cmpuint (turn_test_transact (&client, &ctx), ==, 400);
+
+  len = r_stun_channel_data_encode (buf, sizeof (buf), 0x4001, hello, sizeof (hello));
+  turn_test_send (&client, buf, len);
+  r_assert_cmpuint (turn_test_recv (peer, buf, sizeof (buf)), ==, sizeof (hello));
+  r_assert_cmpmem (buf, ==, hello, sizeof (hello));
+
+  r_assert_cmpint (r_socket_send_to (peer, relayaddr, world, sizeof (world), &sent), ==, R_SOCKET_OK);
+  r_assert_cmpuint ((len = turn_test_recv (client.sock, buf, sizeof (buf))), >, 0);
+  r_assert (r_stun_is_channel_data (buf, len));
+  r_assert (r_stun_channel_data_parse (buf, len, &number, &data, &len));
+  r_assert_cmphex (number, ==, 0x4001);
+  r_assert_cmpuint (len, ==, sizeof (world));
+  r_assert_cmpmem (data, ==, world, sizeof (world));
+
+  TURN_TEST_WAIT_STATS (server, &stats, stats.peer_packets >= 2 && stats.client_packets >= 2);
+  r_assert_cmpuint (stats.allocations, ==, 1);
+  r_assert_cmpuint (stats.allocations_total, ==, 1);
+  r_assert_cmpuint (stats.auth_failures, ==, 1);
+  r_assert_cmpuint (stats.peer_packets, ==, 2);
+  r_assert_cmpuint (stats.peer_bytes, ==, 2 * sizeof (hello));
+  r_assert_cmpuint (stats.client_packets, ==, 2);
+  r_assert_cmpuint (stats.client_bytes, ==, 2 * sizeof (world));
+
+  /* Lifetime 0 deletes the allocation; refreshing it again is a mismatch. */
+  r_assert_cmpuint (turn_test_refresh (&client, 0), ==, 0);
+  r_assert_cmpuint (turn_test_refresh (&client, 0), ==, 437);
+  TURN_TEST_WAIT_STATS (server, &stats, stats.allocations == 0);
+  r_assert_cmpuint (stats.allocations, ==, 0);
+
+  r_socket_address_unref (relayaddr);
+  r_socket_address_unref (peeraddr);
+  r_socket_close (peer);
+  r_socket_unref (peer);
+  turn_test_client_clear (&client);
+  r_turn_server_unref (server);
+}
+RTEST_END;
+
+RTEST (rturnserver, quota, RTEST_FAST | RTEST_SYSTEM)
+{
+  RTurnServerQuota quota = { 1, 1, 0, 0 };
+  RTurnServer * server;
+  TurnTestClient client1, client2;
+  RTurnServerStats stats;
+  RSocketAddress * peer1, * peer2;
+
+  server = turn_test_server_new (&quota, 1);
+  r_assert (!r_turn_server_set_quota (server, &quota));
+  turn_test_client_init (&client1, server);
+  turn_test_client_init (&client2, server);
+  peer1 = r_socket_address_ipv4_new_uint8 (127, 0, 0, 1, 5000);
+  peer2 = r_socket_address_ipv4_new_uint8 (127, 0, 0, 2, 5000);
+
+  r_assert_cmpuint (turn_test_allocate (&client1), ==, 401);
+  r_assert_cmpuint (turn_test_allocate (&client1), ==, 0);
+  r_assert_cmpuint (turn_test_allocate (&client2), ==, 401);
+  r_assert_cmpuint (turn_test_allocate (&client2), ==, 486);
+
+  r_assert_cmpuint (turn_test_create_permission (&client1, peer1), ==, 0);
+  /* Same IP, other port: the same permission. */
+  r_socket_address_unref (peer1);
+  peer1 = r_socket_address_ipv4_new_uint8 (127, 0, 0, 1, 5001);
+  r_assert_cmpuint (turn_test_create_permission (&client1, peer1), ==, 0);
+  r_assert_cmpuint (turn_test_create_permission (&client1, peer2), ==, 508);
+
+  TURN_TEST_WAIT_STATS (server, &stats, stats.quota_rejects >= 2);
+  r_assert_cmpuint (stats.allocations, ==, 1);
+  r_assert_cmpuint (stats.quota_rejects, ==, 2);
+
+  /* Freed allocations release the server-wide quota. */
+  r_assert_cmpuint (turn_test_refresh (&client1, 0), ==, 0);
+  r_assert_cmpuint (turn_test_allocate (&client2), ==, 0);
+
+  r_socket_address_unref (peer1);
+  r_socket_address_unref (peer2);
+  turn_test_client_clear (&client1);
+  turn_test_client_clear (&client2);
+  r_turn_server_unref (server);
+}
+RTEST_END;
@@ -0,0 +1,226 @@
+#!/usr/bin/env python3
+"""Decode a binary trace written by r_log_bin_open() (or R_DEBUG_BIN_FILE)
+into the same text lines the default log handler prints.
+
+Usage:
+  ./tools/rlogbin_decode.py [--no-sort] <trace.bin> [output.log]
+
+Records are buffered per thread and written a chunk at a time, so the
+file is not in time order; lines are sorted by timestamp unless --no-sort
+is given, which keeps the file order (each thread's lines stay in order
+either way).
+
+The format specifiers are replayed with Python's % operator, so output
+matches printf for everything rlib logs in practice; %a is printed with
+float.hex() and the ' flag is ignored.
+"""
+import re
+import struct
+import sys
+
+MAGIC = b"RLOGBIN1"
+HEADER_SIZE = 32
+CHUNK_SITE = 1
+CHUNK_DATA = 2
+SITE_PREFORMATTED = 0x01
+KIND_I32, KIND_I64, KIND_F64, KIND_STR = 1, 2, 3, 4
+STR_NULL = 0xFFFFFFFF
+
+LEVELS = ["", "ERROR", "CRITICAL", "WARNING", "FIXME", "INFO", "DEBUG", "TRACE"]
+
+SPEC_RE = re.compile(
+    r"%(?P<flags>[-+ #0']*)(?P<width>\*|\d+)?(?:\.(?P<prec>\*|\d*))?"
+    r"(?P<len>hh|h|ll|l|q|L|j|z|t)?(?P<conv>[diouxXceEfFgGaAsp%])")
+
+
+class Site:
+    def __init__(self, line, lvl, flags, kinds, cat, file, func, fmt):
+        self.line = line
+        self.lvl = lvl
+        self.flags = flags
+        self.kinds = kinds
+        self.cat = cat
+        self.file = file
+        self.func = func
+        self.fmt = fmt
+
+
+class Trace:
+    def __init__(self, data):
+        if len(data) < HEADER_SIZE or data[:8] != MAGIC:
+            raise ValueError("not an rlib binary trace")
+        self.endian = "<" if data[12] else ">"
+        (self.version, self.ptrsize, self.longsize) = struct.unpack_from(
+            self.endian + "HBB", data, 8)
+        if self.version != 1:
+            raise ValueError("unsupported trace version %d" % self.version)
+        (self.pid, self.tsstart) = struct.unpack_from(self.endian + "I4xQ", data, 16)
+        self.data = data
+        self.sites = {}
+        self.chunks = []
+
+        off = HEADER_SIZE
+        while off + 8 <= len(data):
+            ctype, csize = struct.unpack_from(self.endian + "II", data, off)
+            off += 8
+            end = off + csize
+            if end > len(data):
+                sys.stderr.write("warning: trace truncated\n")
+                break
+            if ctype == CHUNK_SITE:
+                self._parse_site(off, end)
+            elif ctype == CHUNK_DATA:
+                self.chunks.append((off, end))
+            off = end
+
+    def _parse_site(self, off, end):
+        sid, line, lvl, flags, nargs = struct.unpack_from(
+            self.endian + "IIBBH", self.data, off)
+        off += 12
+        kinds = list(self.data[off:off + nargs])
+        off += nargs
+        strs = self.data[off:end].split(b"\0")[:4]
+        cat, file, func, fmt = [s.decode("utf-8", "replace") for s in strs]
+        self.sites[sid] = Site(line, lvl, flags, kinds, cat, file, func, fmt)
+
+    def records(self):
+        """Yield (ts, thread, site, args) in file order."""
+        data, e = self.data, self.endian
+        for off, end in self.chunks:
+            (thread,) = struct.unpack_from(e + "Q", data, off)
+            off += 8
+            while off < end:
+                sid, ts = struct.unpack_from(e + "IQ", data, off)
+                off += 12
+                site = self.sites[sid]
+                args = []
+                for kind in site.kinds:
+                    if kind == KIND_I32:
+                        args.append(struct.unpack_from(e + "i", data, off)[0])
+                        off += 4
+                    elif kind == KIND_I64:
+                        args.append(struct.unpack_from(e + "q", data, off)[0])
+                        off += 8
+                    elif kind == KIND_F64:
+                        args.append(struct.unpack_from(e + "d", data, off)[0])
+                        off += 8
+                    else:
+                        (n,) = struct.unpack_from(e + "I", data, off)
+                        off += 4
+                        if n == STR_NULL:
+                            args.append(None)
+                        else:
+                            args.append(data[off:off + n].decode("utf-8", "replace"))
+                            off += n
+                yield ts, thread, site, args
+
+    def int_bits(self, length):
+        if length in ("hh",):
+            return 8
+        if length == "h":
+            return 16
+        if length == "l":
+            return self.longsize * 8
+        if length in ("ll", "q", "L", "j"):
+            return 64
+        if length in ("z", "t"):
+            return self.ptrsize * 8
+        return 32
+
+    def pointer(self, value):
+        value &= (1 << (self.ptrsize * 8)) - 1
+        return "0x%x" % value if value else "(nil)"
+
+    def format(self, site, args):
+        if site.flags & SITE_PREFORMATTED:
+            return args[0] if args[0] is not None else ""
+
+        it = iter(args)
+
+        def repl(m):
+            conv = m.group("conv")
+            if conv == "%":
+                return "%"
+            flags = m.group("flags").replace("'", "")
+            width = m.group("width") or ""
+            prec = m.group("prec")
+            if width == "*":
+                w = next(it)
+                if w < 0:
+                    flags += "-"
+                width = str(abs(w))
+            if prec == "*":
+                p = next(it)
+                prec = str(p) if p >= 0 else None
+            value = next(it)
+            spec = "%" + flags + width + ("." + prec if prec is not None else "")
+
+            if conv in "diouxX":
+                bits = self.int_bits(m.group("len"))
+                value &= (1 << bits) - 1
+                if conv in "di":
+                    if value >> (bits - 1):
+                        value -= 1 << bits
+                    return (spec + "d") % value
+                if conv == "u":
+                    return (spec + "d") % value
+                if conv == "o" and "#" in flags:
+                    s = (spec.replace("#", "") + "o") % value
+                    return s if value == 0 else re.sub(r"^(\s*)", r"\g<1>0", s, 1)
+                return (spec + conv) % value
+            if conv == "c":
+                return (spec + "c") % chr(value & 0xFF)
+            if conv in "aA":
+                s = float(value).hex()
+                return ((spec.split(".")[0] + "s") % (s.upper() if conv == "A" else s))
+            if conv in "eEfFgG":
+                return (spec + conv) % value
+            if conv == "s":
+                return (spec + "s") % ("(null)" if value is None else value)
+            # p
+            return (spec.split(".")[0] + "s") % self.pointer(value)
+
+        try:
+            return SPEC_RE.sub(repl, site.fmt)
+        except (StopIteration, TypeError, ValueError) as err:
+            return "%s <undecodable: %s>" % (site.fmt, err)
+
+    def line(self, ts, thread, site, args):
+        elapsed = ts - self.tsstart
+        secs, ns = divmod(elapsed, 1000000000)
+        thr = self.pointer(thread).rjust(14 if self.ptrsize == 8 else 10)
+        lvl = LEVELS[site.lvl] if site.lvl < len(LEVELS) else str(site.lvl)
+        return "%u:%02u:%02u.%09u %5d %s %-8s %16s %s:%d:%s () %s" % (
+            secs // 3600, (secs // 60) % 60, secs % 60, ns, self.pid, thr,
+            lvl, site.cat, site.file, site.line, site.func,
+            self.format(site, args))
+
+
+def main(argv):
+    sort = True
+    if "--no-sort" in argv:
+        argv.remove("--no-sort")
+        sort = False
+    if len(argv) not in (2, 3):
+        sys.stderr.write(__doc__)
+        return 2
+
+    with open(argv[1], "rb") as f:
+        trace = Trace(f.read())
+
+    records = trace.records()
+    if sort:
+        records = sorted(records, key=lambda r: r[0])
+
+    out = open(argv[2], "w") if len(argv) == 3 else sys.stdout
+    try:
+        for rec in records:
+            out.write(trace.line(*rec) + "\n")
+    finally:
+        if out is not sys.stdout:
+            out.close()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))